@@ -38,6 +38,7 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <netinet/in.h>
@@ -103,9 +104,15 @@ static void gather_stats(struct upipe *upipe, struct uref *uref)
                 ))))
         upipe_err_va(upipe, "Couldn't get stats from rtpfb");
 
+    size_t buffered_bytes = 0;
+    uint64_t repaired_bytes = 0;
+    if (unlikely(!ubase_check(upipe_rtpfb_get_buffer_stats(upipe_rtpfb,
+                &buffered_bytes, &repaired_bytes))))
+        upipe_err_va(upipe, "Couldn't get buffer stats from rtpfb");
+
     unsigned nack_overflow = (repairs && repairs < nacks) ? (nacks - repairs ) * 100 / repairs : 0;
-    upipe_notice_va(upipe, "%5u (%3zu) %5u\t%zu repairs %zu NACKS (%u%% too much)\tlost %zu\tduplicates %zu",
-            last_output_seqnum, buffers, expected_seqnum, repairs, nacks, nack_overflow, loss, dups);
+    upipe_notice_va(upipe, "%5u (%3zu, %zu bytes) %5u\t%zu repairs (%"PRIu64" bytes) %zu NACKS (%u%% too much)\tlost %zu\tduplicates %zu",
+            last_output_seqnum, buffers, buffered_bytes, expected_seqnum, repairs, repaired_bytes, nacks, nack_overflow, loss, dups);
 }
 
 static void sink_timeout(struct upump *upump)
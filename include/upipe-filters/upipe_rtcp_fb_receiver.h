@@ -27,6 +27,8 @@ enum upipe_rtcpfb_command {
 
     /** get counters (uint64_t *) */
     UPIPE_RTCPFB_GET_STATS,
+    /** get buffer counters (size_t *, size_t *, uint64_t *) */
+    UPIPE_RTCPFB_GET_BUFFER_STATS,
 };
 
 static inline int upipe_rtcpfb_get_stats(struct upipe *upipe,
@@ -36,6 +38,26 @@ static inline int upipe_rtcpfb_get_stats(struct upipe *upipe,
                          UPIPE_RTCPFB_SIGNATURE, retrans);
 }
 
+/** @This returns the number of packets and octets buffered for
+ * retransmission, and the number of octets retransmitted since the last
+ * call.
+ *
+ * @param upipe description structure of the pipe
+ * @param buffered filled in with the number of buffered packets
+ * @param buffered_bytes filled in with the number of buffered octets
+ * @param retrans_bytes filled in with the number of retransmitted octets
+ * @return an error code
+ */
+static inline int upipe_rtcpfb_get_buffer_stats(struct upipe *upipe,
+                                                size_t *buffered,
+                                                size_t *buffered_bytes,
+                                                uint64_t *retrans_bytes)
+{
+    return upipe_control(upipe, UPIPE_RTCPFB_GET_BUFFER_STATS,
+                         UPIPE_RTCPFB_SIGNATURE, buffered, buffered_bytes,
+                         retrans_bytes);
+}
+
 /** @This returns the management structure for rtcpfb pipes.
  *
  * @return pointer to manager
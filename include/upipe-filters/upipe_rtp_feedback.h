@@ -39,6 +39,8 @@ enum upipe_rtpfb_command {
     UPIPE_RTPFB_GET_STATS,
     /** get round-trip time (uint64_t *) */
     UPIPE_RTPFB_GET_RTT,
+    /** get buffer counters (size_t *, uint64_t *) */
+    UPIPE_RTPFB_GET_BUFFER_STATS,
 };
 
 static inline int upipe_rtpfb_output_get_name(struct upipe *upipe, const char **name_p)
@@ -69,6 +71,24 @@ static inline int upipe_rtpfb_get_rtt(struct upipe *upipe, uint64_t *rtt)
                          UPIPE_RTPFB_SIGNATURE, rtt);
 }
 
+/** @This returns the number of octets buffered, and the number of
+ * retransmitted octets received since the last call.
+ *
+ * @param upipe description structure of the pipe
+ * @param buffered_bytes filled in with the number of buffered octets
+ * @param repaired_bytes filled in with the number of octets repaired by
+ * retransmissions
+ * @return an error code
+ */
+static inline int upipe_rtpfb_get_buffer_stats(struct upipe *upipe,
+                                               size_t *buffered_bytes,
+                                               uint64_t *repaired_bytes)
+{
+    return upipe_control(upipe, UPIPE_RTPFB_GET_BUFFER_STATS,
+                         UPIPE_RTPFB_SIGNATURE, buffered_bytes,
+                         repaired_bytes);
+}
+
 /** @This returns the management structure for rtpfb pipes.
  *
  * @return pointer to manager
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe sink module packaging a transport stream to HLS
+ *
+ * The sink cuts its input, typically the output of a ts_mux pipe, into
+ * segment files on random access points and maintains a media playlist
+ * and a master playlist in a directory. The input is dropped until the
+ * first random access point. Playlists are written to a temporary file
+ * and renamed, so that readers never see a partial file.
+ *
+ * When a part duration is set, the media playlist also advertises LL-HLS
+ * partial segments, as byte ranges of the segment being written, and a
+ * preload hint for the next part.
+ *
+ * The following attributes of the input flow definition are used when
+ * present: m3u.playlist.target_duration, m3u.playlist.media_sequence,
+ * m3u.playlist.type, and m3u.master.bandwidth, codecs and resolution for
+ * the master playlist.
+ */
+
+#ifndef _UPIPE_HLS_UPIPE_HLS_SINK_H_
+/** @hidden */
+# define _UPIPE_HLS_UPIPE_HLS_SINK_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/upipe.h"
+
+#define UPIPE_HLS_SINK_SIGNATURE UBASE_FOURCC('h','l','s','k')
+
+/** @This extends @ref upipe_command with specific hls sink commands. */
+enum upipe_hls_sink_command {
+    UPIPE_HLS_SINK_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the output directory and the playlist name
+     * (const char *, const char *) */
+    UPIPE_HLS_SINK_SET_PATH,
+    /** sets the master playlist file name, or NULL to disable it
+     * (const char *) */
+    UPIPE_HLS_SINK_SET_MASTER,
+    /** sets the target segment duration (uint64_t) */
+    UPIPE_HLS_SINK_SET_TARGET_DURATION,
+    /** sets the target part duration, or 0 to disable LL-HLS (uint64_t) */
+    UPIPE_HLS_SINK_SET_PART_DURATION,
+    /** sets the number of segments in the playlist, or 0 to keep all of
+     * them (unsigned int) */
+    UPIPE_HLS_SINK_SET_WINDOW,
+};
+
+/** @This converts hls sink specific command to a string.
+ *
+ * @param cmd @ref upipe_hls_sink_command to convert
+ * @return the corresponding string or NULL if not a valid
+ * @ref upipe_hls_sink_command
+ */
+static inline const char *upipe_hls_sink_command_str(int cmd)
+{
+    switch ((enum upipe_hls_sink_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_HLS_SINK_SET_PATH);
+    UBASE_CASE_TO_STR(UPIPE_HLS_SINK_SET_MASTER);
+    UBASE_CASE_TO_STR(UPIPE_HLS_SINK_SET_TARGET_DURATION);
+    UBASE_CASE_TO_STR(UPIPE_HLS_SINK_SET_PART_DURATION);
+    UBASE_CASE_TO_STR(UPIPE_HLS_SINK_SET_WINDOW);
+    case UPIPE_HLS_SINK_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This sets the output directory and the name of the media playlist.
+ * The media playlist is written to dir/name.m3u8 and the segments to
+ * dir/name-N.ts. Changing the path mid-stream ends the current playlist,
+ * and starts a new one from the first media sequence number; the segments
+ * of the previous playlist are left on disk.
+ *
+ * @param upipe description structure of the pipe
+ * @param dir output directory, which must exist
+ * @param name base name of the media playlist and segments
+ * @return an error code
+ */
+static inline int upipe_hls_sink_set_path(struct upipe *upipe,
+                                          const char *dir, const char *name)
+{
+    return upipe_control(upipe, UPIPE_HLS_SINK_SET_PATH,
+                         UPIPE_HLS_SINK_SIGNATURE, dir, name);
+}
+
+/** @This sets the file name of the master playlist, in the output
+ * directory. The default is master.m3u8.
+ *
+ * @param upipe description structure of the pipe
+ * @param master file name of the master playlist, or NULL to disable it
+ * @return an error code
+ */
+static inline int upipe_hls_sink_set_master(struct upipe *upipe,
+                                            const char *master)
+{
+    return upipe_control(upipe, UPIPE_HLS_SINK_SET_MASTER,
+                         UPIPE_HLS_SINK_SIGNATURE, master);
+}
+
+/** @This sets the target duration of the segments. Segments are cut on
+ * the first random access point after this duration. The target duration
+ * advertised in the playlist is this duration rounded up to the second,
+ * fixed when the first segment is opened; a segment exceeding it is cut
+ * without waiting for a random access point.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration target duration in units of UCLOCK_FREQ
+ * @return an error code
+ */
+static inline int upipe_hls_sink_set_target_duration(struct upipe *upipe,
+                                                     uint64_t duration)
+{
+    return upipe_control(upipe, UPIPE_HLS_SINK_SET_TARGET_DURATION,
+                         UPIPE_HLS_SINK_SIGNATURE, duration);
+}
+
+/** @This sets the target duration of the LL-HLS partial segments.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration part duration in units of UCLOCK_FREQ, or 0 to disable
+ * partial segments
+ * @return an error code
+ */
+static inline int upipe_hls_sink_set_part_duration(struct upipe *upipe,
+                                                   uint64_t duration)
+{
+    return upipe_control(upipe, UPIPE_HLS_SINK_SET_PART_DURATION,
+                         UPIPE_HLS_SINK_SIGNATURE, duration);
+}
+
+/** @This sets the number of segments listed in the media playlist. Older
+ * segment files are deleted.
+ *
+ * @param upipe description structure of the pipe
+ * @param window number of segments, or 0 to keep all segments
+ * @return an error code
+ */
+static inline int upipe_hls_sink_set_window(struct upipe *upipe,
+                                            unsigned int window)
+{
+    return upipe_control(upipe, UPIPE_HLS_SINK_SET_WINDOW,
+                         UPIPE_HLS_SINK_SIGNATURE, window);
+}
+
+/** @This returns the management structure for hls sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_hls_sink_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !_UPIPE_HLS_UPIPE_HLS_SINK_H_ */
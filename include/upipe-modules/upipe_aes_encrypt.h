@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe module encrypting block flows with AES-128 in CBC mode
+ * The key and initialization vector are given by the aes attributes of the
+ * input flow definition (see @ref uref_aes_set_key and
+ * @ref uref_aes_set_iv). The output flow definition is then block.aes. and
+ * keeps these attributes, so that it may be fed to an aes decrypt pipe.
+ * Flows without a key are forwarded unchanged.
+ */
+
+#ifndef _UPIPE_MODULES_UPIPE_AES_ENCRYPT_H_
+# define _UPIPE_MODULES_UPIPE_AES_ENCRYPT_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/upipe.h"
+
+#define UPIPE_AES_ENCRYPT_SIGNATURE     UBASE_FOURCC('a','e','s','e')
+
+/** @This enumerates the padding options. */
+enum upipe_aes_encrypt_padding {
+    /** no padding, a trailing partial block is dropped */
+    UPIPE_AES_ENCRYPT_PADDING_NONE,
+    /** PKCS-7 padding */
+    UPIPE_AES_ENCRYPT_PADDING_PKCS7,
+};
+
+/** @This extends upipe_command with specific commands for upipe_aes_encrypt
+ * pipes.
+ */
+enum upipe_aes_encrypt_command {
+    UPIPE_AES_ENCRYPT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** set PKCS-7 padding (enum upipe_aes_encrypt_padding) */
+    UPIPE_AES_ENCRYPT_SET_PADDING,
+};
+
+/** @This sets padding support. PKCS-7 padding is added to the last block
+ * of the flow, signaled by the block end flag or by a new flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param type padding type to use
+ * @return an error code
+ */
+static inline int
+upipe_aes_encrypt_set_padding(struct upipe *upipe,
+                              enum upipe_aes_encrypt_padding type)
+{
+    return upipe_control(upipe, UPIPE_AES_ENCRYPT_SET_PADDING,
+                         UPIPE_AES_ENCRYPT_SIGNATURE, type);
+}
+
+/** @This returns the management structure for aes encrypt pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_aes_encrypt_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !_UPIPE_MODULES_UPIPE_AES_ENCRYPT_H_ */
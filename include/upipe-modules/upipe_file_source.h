@@ -21,6 +21,47 @@ extern "C" {
 
 #define UPIPE_FSRC_SIGNATURE UBASE_FOURCC('f','s','r','c')
 
+/** @This extends upipe_command with specific commands. */
+enum upipe_fsrc_command {
+    UPIPE_FSRC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** get the size of the mapped windows (uint64_t *) */
+    UPIPE_FSRC_GET_MMAP,
+    /** set the size of the mapped windows (uint64_t) */
+    UPIPE_FSRC_SET_MMAP,
+};
+
+/** @This returns the size of the windows used to map regular files.
+ *
+ * @param upipe description structure of the pipe
+ * @param window_size_p filled in with the size of the windows (0 if
+ * disabled)
+ * @return an error code
+ */
+static inline int upipe_fsrc_get_mmap(struct upipe *upipe,
+                                      uint64_t *window_size_p)
+{
+    return upipe_control(upipe, UPIPE_FSRC_GET_MMAP, UPIPE_FSRC_SIGNATURE,
+                         window_size_p);
+}
+
+/** @This sets the size of the windows used to map regular files. When
+ * enabled, regular files are mapped in memory instead of being read, and
+ * the output urefs point directly to the mapped pages, without any copy.
+ * A uref kept downstream keeps its whole window mapped, and the files must
+ * not be truncated while they are mapped (see @ref ubuf_block_mmap_mgr_alloc).
+ *
+ * @param upipe description structure of the pipe
+ * @param window_size size of the windows (0 to disable, default)
+ * @return an error code
+ */
+static inline int upipe_fsrc_set_mmap(struct upipe *upipe,
+                                      uint64_t window_size)
+{
+    return upipe_control(upipe, UPIPE_FSRC_SET_MMAP, UPIPE_FSRC_SIGNATURE,
+                         window_size);
+}
+
 /** @This returns the management structure for all file sources.
  *
  * @return pointer to manager
@@ -32,6 +32,48 @@ UREF_ATTR_UNSIGNED(msrc_flow, offset, "msrc.offset", rotate offset)
 #define UPIPE_MSRC_DEF_ROTATE UINT64_C(97200000000)
 #define UPIPE_MSRC_DEF_OFFSET UINT64_C(0)
 
+/** @This extends upipe_command with specific commands. */
+enum upipe_msrc_command {
+    UPIPE_MSRC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** get the size of the mapped windows (uint64_t *) */
+    UPIPE_MSRC_GET_MMAP,
+    /** set the size of the mapped windows (uint64_t) */
+    UPIPE_MSRC_SET_MMAP,
+};
+
+/** @This returns the size of the windows used to map the segments.
+ *
+ * @param upipe description structure of the pipe
+ * @param window_size_p filled in with the size of the windows (0 if
+ * disabled)
+ * @return an error code
+ */
+static inline int upipe_msrc_get_mmap(struct upipe *upipe,
+                                      uint64_t *window_size_p)
+{
+    return upipe_control(upipe, UPIPE_MSRC_GET_MMAP, UPIPE_MSRC_SIGNATURE,
+                         window_size_p);
+}
+
+/** @This sets the size of the windows used to map the segments. When
+ * enabled, the data files are mapped in memory instead of being read, and
+ * the output urefs point directly to the mapped pages. The timestamps are
+ * also read from the mapped aux files. A uref kept downstream keeps its
+ * whole window mapped, and the files must not be truncated while they are
+ * mapped (see @ref ubuf_block_mmap_mgr_alloc).
+ *
+ * @param upipe description structure of the pipe
+ * @param window_size size of the windows (0 to disable, default)
+ * @return an error code
+ */
+static inline int upipe_msrc_set_mmap(struct upipe *upipe,
+                                      uint64_t window_size)
+{
+    return upipe_control(upipe, UPIPE_MSRC_SET_MMAP, UPIPE_MSRC_SIGNATURE,
+                         window_size);
+}
+
 /** @This returns the management structure for msrc pipes.
  *
  * @return pointer to manager
@@ -14,6 +14,11 @@
  * @item queue_length @item maximum length of the queue (<= 255)
  * @end table
  *
+ * A queue source allocated with @ref upipe_qsrc_alloc_spsc instead uses a
+ * single-producer single-consumer queue, which accepts a single queue sink
+ * at a time, but has no practical limit on its length and spares system calls
+ * and wake-ups on busy links (see @ref uqueue_init_spsc).
+ *
  * Also note that this module is exceptional in that upipe_release() may be
  * called from another thread. The release function is thread-safe.
  */
@@ -32,6 +37,8 @@ extern "C" {
 #include <assert.h>
 
 #define UPIPE_QSRC_SIGNATURE UBASE_FOURCC('q','s','r','c')
+/** signature of the allocator of single-producer single-consumer queues */
+#define UPIPE_QSRC_SPSC_SIGNATURE UBASE_FOURCC('q','s','r','s')
 
 /** @This extends upipe_command with specific commands for queue source. */
 enum upipe_qsrc_command {
@@ -86,6 +93,25 @@ UPIPE_HELPER_ALLOC(qsrc, UPIPE_QSRC_SIGNATURE)
 #undef ARGS
 #undef ARGS_DECL
 
+/** @This allocates a queue source pipe using a single-producer
+ * single-consumer queue. Only one queue sink may be attached to it at a time.
+ *
+ * @param mgr management structure for queue source pipes
+ * @param uprobe structure used to raise events (belongs to the callee)
+ * @param queue_length maximum length of the queue (max 2^31)
+ * @param spin number of busy-polling iterations before waiting for the
+ * queue to be filled again
+ * @return pointer to allocated pipe, or NULL in case of failure
+ */
+static inline struct upipe *upipe_qsrc_alloc_spsc(struct upipe_mgr *mgr,
+                                                  struct uprobe *uprobe,
+                                                  unsigned int queue_length,
+                                                  unsigned int spin)
+{
+    return upipe_alloc(mgr, uprobe, UPIPE_QSRC_SPSC_SIGNATURE, queue_length,
+                       spin);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -81,14 +81,33 @@ struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
                                        uint16_t msg_pool_depth,
                                        struct umutex *mutex);
 
+/** @This returns a management structure for xfer pipes whose event queues,
+ * fed by the remote event loop only, are single-producer single-consumer.
+ * The queue of commands to the remote event loop stays multiple-producer,
+ * so the xfer pipes may still be controlled from several threads.
+ *
+ * @param queue_length maximum length of the event queues (max 2^31); the
+ * queue of commands is limited to 255 elements
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param mutex mutual exclusion primitives to access the event loop, or NULL
+ * @param spin number of busy-polling iterations before waiting for the
+ * queues to be filled again
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xfer_mgr_alloc_spsc(uint32_t queue_length,
+                                            uint16_t msg_pool_depth,
+                                            struct umutex *mutex,
+                                            unsigned int spin);
+
 /** @This attaches a upipe_xfer_mgr to a given event loop. The xfer manager
  * will call upump_alloc_XXX and upump_start, so it must be done in a context
  * where it is possible, which generally means that this command is done in
  * the same thread that runs the event loop (upump managers aren't generally
  * thread-safe).
  *
- * Please note that an xfer_mgr must be attached to a upump manager before it
- * can be released.
+ * Please note that an xfer_mgr must be attached to a upump manager before
+ * any xfer pipe is allocated. A manager that was never attached is freed
+ * straight away when it is released.
  *
  * @param mgr xfer_mgr structure
  * @param upump_mgr event loop to attach
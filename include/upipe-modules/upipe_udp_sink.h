@@ -21,6 +21,7 @@ extern "C" {
 #include "upipe/upipe.h"
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <time.h>
 
 #define UPIPE_UDPSINK_SIGNATURE UBASE_FOURCC('u','s','n','k')
 
@@ -34,6 +35,16 @@ enum upipe_udpsink_command {
     UPIPE_UDPSINK_SET_FD,
     /** set remote address (const struct sockaddr *, socklen_t) **/
     UPIPE_UDPSINK_SET_PEER,
+    /** get the maximum number of datagrams sent at once (unsigned int *) **/
+    UPIPE_UDPSINK_GET_BATCH,
+    /** set the maximum number of datagrams sent at once (unsigned int) **/
+    UPIPE_UDPSINK_SET_BATCH,
+    /** enable UDP generic segmentation offload (int) **/
+    UPIPE_UDPSINK_SET_GSO,
+    /** enable kernel pacing with SO_TXTIME (clockid_t) **/
+    UPIPE_UDPSINK_SET_TXTIME,
+    /** get the number of packets dropped by the kernel (uint64_t *) **/
+    UPIPE_UDPSINK_GET_TXTIME_DROPPED,
 };
 
 /** @This returns the management structure for all udp sinks.
@@ -79,6 +90,88 @@ static inline int upipe_udpsink_set_peer(struct upipe *upipe,
     return upipe_control(upipe, UPIPE_UDPSINK_SET_PEER, UPIPE_UDPSINK_SIGNATURE,
             addr, addrlen);
 }
+
+/** @This returns the maximum number of datagrams sent at once.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the number of datagrams
+ * @return an error code
+ */
+static inline int upipe_udpsink_get_batch(struct upipe *upipe,
+                                          unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_GET_BATCH,
+                         UPIPE_UDPSINK_SIGNATURE, batch_p);
+}
+
+/** @This sets the maximum number of datagrams sent at once. When greater
+ * than 1, the urefs that are due according to their cr_sys and the latency
+ * are collected and sent with a single sendmmsg() call, once the batch is
+ * full, at the end of a list of urefs, before waiting for the next
+ * deadline, or at the latest on the next iteration of the event loop (1 ms
+ * later without uclock).
+ *
+ * @param upipe description structure of the pipe
+ * @param batch maximum number of datagrams (1 to disable, default)
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_batch(struct upipe *upipe,
+                                          unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_BATCH,
+                         UPIPE_UDPSINK_SIGNATURE, batch);
+}
+
+/** @This enables UDP generic segmentation offload (UDP_SEGMENT) in batch
+ * mode. Batches of equal-sized datagrams are then sent as a single
+ * datagram segmented by the kernel or the network interface.
+ *
+ * @param upipe description structure of the pipe
+ * @param gso true to enable GSO
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_gso(struct upipe *upipe, bool gso)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_GSO,
+                         UPIPE_UDPSINK_SIGNATURE, gso ? 1 : 0);
+}
+
+/** @This enables the pacing of packets by the kernel with SO_TXTIME. Each
+ * packet is sent up to 100 ms ahead of time with a SCM_TXTIME deadline
+ * derived from its cr_sys and the latency, and the qdisc (etf or fq) of the
+ * interface releases it. If SO_TXTIME is not available, the sink keeps
+ * pacing packets with a timer.
+ *
+ * The kernel doesn't allow to clear SO_TXTIME on a socket. When disabled,
+ * the deadline mode and the error reports are turned off and the packets
+ * are sent without deadline, which fq sends straight away but etf drops:
+ * open the socket again to use etf without SO_TXTIME.
+ *
+ * @param upipe description structure of the pipe
+ * @param clockid clock of the deadlines, typically CLOCK_TAI for etf and
+ * CLOCK_MONOTONIC for fq, or -1 to disable
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_txtime(struct upipe *upipe,
+                                           clockid_t clockid)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_TXTIME,
+                         UPIPE_UDPSINK_SIGNATURE, (int)clockid);
+}
+
+/** @This returns the number of packets dropped by the kernel because they
+ * missed their SO_TXTIME deadline.
+ *
+ * @param upipe description structure of the pipe
+ * @param dropped_p filled in with the number of dropped packets
+ * @return an error code
+ */
+static inline int upipe_udpsink_get_txtime_dropped(struct upipe *upipe,
+                                                   uint64_t *dropped_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_GET_TXTIME_DROPPED,
+                         UPIPE_UDPSINK_SIGNATURE, dropped_p);
+}
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,29 @@ enum upipe_udpsrc_command {
     UPIPE_UDPSRC_GET_FD,
     /** set socket fd (int) */
     UPIPE_UDPSRC_SET_FD,
+    /** get the maximum number of datagrams read per wakeup (unsigned int *) */
+    UPIPE_UDPSRC_GET_BATCH,
+    /** set the maximum number of datagrams read per wakeup (unsigned int) */
+    UPIPE_UDPSRC_SET_BATCH,
+    /** get the type of reception timestamps
+     * (enum upipe_udpsrc_timestamp *) */
+    UPIPE_UDPSRC_GET_TIMESTAMP,
+    /** set the type of reception timestamps (enum upipe_udpsrc_timestamp) */
+    UPIPE_UDPSRC_SET_TIMESTAMP,
+};
+
+/** @This defines the sources of the reception time (cr_sys). */
+enum upipe_udpsrc_timestamp {
+    /** time of the wakeup of the event loop (default) */
+    UPIPE_UDPSRC_TIMESTAMP_NONE = 0,
+    /** kernel software timestamps (SO_TIMESTAMPNS) */
+    UPIPE_UDPSRC_TIMESTAMP_SOFTWARE,
+    /** raw hardware timestamps (SO_TIMESTAMPING), with a fallback to
+     * software timestamps; hardware timestamping must be enabled on the
+     * interface (SIOCSHWTSTAMP), and the uclock must be a uclock_ptp
+     * bound to the receiving interface; hardware timestamps that are not
+     * within one second of the uclock are ignored */
+    UPIPE_UDPSRC_TIMESTAMP_HARDWARE,
 };
 
 /** @This extends uprobe_throw with specific events. */
@@ -64,6 +87,64 @@ static inline int upipe_udpsrc_set_fd(struct upipe *upipe, int fd)
                          fd);
 }
 
+/** @This returns the maximum number of datagrams read per wakeup.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the number of datagrams
+ * @return an error code
+ */
+static inline int upipe_udpsrc_get_batch(struct upipe *upipe,
+                                         unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_GET_BATCH, UPIPE_UDPSRC_SIGNATURE,
+                         batch_p);
+}
+
+/** @This sets the maximum number of datagrams read per wakeup. When greater
+ * than 1, the pipe pre-allocates as many urefs and drains the socket with a
+ * single recvmmsg() call. On an io_uring event loop, as many recvmsg
+ * operations are kept in flight instead. Received urefs are output in
+ * arrival order.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch maximum number of datagrams (1 to disable, default)
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_batch(struct upipe *upipe,
+                                         unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_BATCH, UPIPE_UDPSRC_SIGNATURE,
+                         batch);
+}
+
+/** @This returns the type of reception timestamps.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp_p filled in with the type of timestamps
+ * @return an error code
+ */
+static inline int upipe_udpsrc_get_timestamp(struct upipe *upipe,
+        enum upipe_udpsrc_timestamp *timestamp_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_GET_TIMESTAMP,
+                         UPIPE_UDPSRC_SIGNATURE, timestamp_p);
+}
+
+/** @This sets the type of reception timestamps. Kernel timestamps are
+ * converted to the uclock domain, so that the cr_sys of the output urefs
+ * does not depend on the scheduling of the event loop.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp type of timestamps
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_timestamp(struct upipe *upipe,
+        enum upipe_udpsrc_timestamp timestamp)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_TIMESTAMP,
+                         UPIPE_UDPSRC_SIGNATURE, timestamp);
+}
+
 /** @This returns the management structure for all udp socket sources.
  *
  * @return pointer to manager
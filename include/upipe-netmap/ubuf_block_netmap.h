@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats with netmap storage
+ *
+ * The manager owns a netmap descriptor opened with extra buffers. A ubuf
+ * is allocated from a receive slot by swapping the buffer of the slot with
+ * a spare buffer, so that the packet stays in place until the ubuf is
+ * freed, while the slot is immediately given back to the ring. Plain
+ * block allocations, such as copies of netmap ubufs, are served from an
+ * internal memory block manager.
+ */
+
+#ifndef _UPIPE_NETMAP_UBUF_BLOCK_NETMAP_H_
+/** @hidden */
+#define _UPIPE_NETMAP_UBUF_BLOCK_NETMAP_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/ubase.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+
+#include <stdint.h>
+
+/** @hidden */
+struct nm_desc;
+/** @hidden */
+struct netmap_ring;
+/** @hidden */
+struct netmap_slot;
+
+/** @This is the signature to use to allocate from a netmap slot. */
+#define UBUF_BLOCK_NETMAP_ALLOC_SLOT UBASE_FOURCC('n','t','m','b')
+
+/** @This returns a new ubuf holding the buffer of a netmap slot. The
+ * buffer of the slot is replaced by a spare buffer and flagged as changed.
+ * This fails if there is no spare buffer left, in which case the caller is
+ * expected to copy the packet.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param ring netmap ring the slot belongs to
+ * @param slot netmap slot to take the buffer from
+ * @param offset offset of the block in the buffer
+ * @param size size of the block
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_block_netmap_alloc_slot(struct ubuf_mgr *mgr,
+        struct netmap_ring *ring, struct netmap_slot *slot,
+        int offset, int size)
+{
+    return ubuf_alloc(mgr, UBUF_BLOCK_NETMAP_ALLOC_SLOT, ring, slot,
+                      offset, size);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * using netmap buffers. The manager takes ownership of the netmap
+ * descriptor, and closes it when the last ubuf is freed. On error, the
+ * descriptor is left untouched.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param d netmap descriptor, opened with extra buffers (nr_arg3)
+ * @return pointer to manager, or NULL in case of error, or if the
+ * descriptor has no extra buffer
+ */
+struct ubuf_mgr *ubuf_block_netmap_mgr_alloc(uint16_t ubuf_pool_depth,
+                                             struct nm_desc *d);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
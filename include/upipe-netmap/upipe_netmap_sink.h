@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe sink module for netmap sockets
+ *
+ * The sink copies its input into the slots of the first transmit ring of a
+ * netmap port, given by @ref upipe_set_uri, for instance "netmap:eth0-0",
+ * a VALE port "vale0:tx" or a netmap pipe "netmap:eth0{1". By default the
+ * input buffers are complete ethernet frames; when @ref
+ * upipe_netmap_sink_set_udp is called, they are UDP payloads and the
+ * ethernet, IPv4 and UDP headers are added by the sink.
+ */
+
+#ifndef _UPIPE_NETMAP_UPIPE_NETMAP_SINK_H_
+/** @hidden */
+#define _UPIPE_NETMAP_UPIPE_NETMAP_SINK_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/upipe.h"
+
+#include <stdint.h>
+
+#define UPIPE_NETMAP_SINK_SIGNATURE UBASE_FOURCC('n','t','m','k')
+
+/** @This extends @ref upipe_command with specific netmap sink commands. */
+enum upipe_netmap_sink_command {
+    UPIPE_NETMAP_SINK_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the UDP addresses of the output packets (const char *,
+     * const char *, const uint8_t *, const uint8_t *) */
+    UPIPE_NETMAP_SINK_SET_UDP,
+};
+
+/** @This converts netmap sink specific command to a string.
+ *
+ * @param cmd @ref upipe_netmap_sink_command to convert
+ * @return the corresponding string or NULL if not a valid
+ * @ref upipe_netmap_sink_command
+ */
+static inline const char *upipe_netmap_sink_command_str(int cmd)
+{
+    switch ((enum upipe_netmap_sink_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_NETMAP_SINK_SET_UDP);
+    case UPIPE_NETMAP_SINK_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This sets the addresses of the output UDP packets. The destination MAC
+ * address defaults to the multicast address derived from the destination
+ * IP address, or to the broadcast address for unicast destinations, and
+ * the source MAC address defaults to zero.
+ *
+ * @param upipe description structure of the pipe
+ * @param src source address and port (ip:port)
+ * @param dst destination address and port (ip:port), or NULL to send the
+ * input buffers as complete ethernet frames
+ * @param src_mac source MAC address (6 octets), or NULL
+ * @param dst_mac destination MAC address (6 octets), or NULL
+ * @return an error code
+ */
+static inline int upipe_netmap_sink_set_udp(struct upipe *upipe,
+                                            const char *src, const char *dst,
+                                            const uint8_t *src_mac,
+                                            const uint8_t *dst_mac)
+{
+    return upipe_control(upipe, UPIPE_NETMAP_SINK_SET_UDP,
+                         UPIPE_NETMAP_SINK_SIGNATURE, src, dst,
+                         src_mac, dst_mac);
+}
+
+/** @This returns the management structure for netmap sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_netmap_sink_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
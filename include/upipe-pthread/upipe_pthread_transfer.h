@@ -21,6 +21,7 @@ extern "C" {
 #include "upipe/upipe.h"
 #include "upipe/uprobe.h"
 #include "upipe/upump.h"
+#include "upipe-pthread/upump_pthread_pool.h"
 
 #include <stdint.h>
 #include <pthread.h>
@@ -202,6 +203,60 @@ static inline struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_prio_named_va(
             priority, string), NULL)
 }
 
+/** @This returns a management structure for transfer pipes, using a new
+ * pthread placed on a set of CPUs and a NUMA node. The preferred memory policy
+ * of the thread is set to the node, so that the buffers first touched by the
+ * pipes running in the thread are node-local. If no list of CPUs is given,
+ * the thread runs on the CPUs of the node. The placement is reported as a
+ * notice on the probe when the thread starts; errors only trigger warnings.
+ * You would need one management structure per target thread.
+ *
+ * @param queue_length maximum length of the internal queue of commands
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param uprobe_pthread_upump_mgr pointer to optional probe, that will be set
+ * with the created upump_mgr
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @param mutex mutual exclusion pimitives to access the event loop, or NULL
+ * @param pthread_id_p reference to created thread ID (may be NULL)
+ * @param attr pthread attributes
+ * @param priority priority of the thread or INT_MAX to leave it unchanged
+ * @param name custom name or NULL
+ * @param cpus list of CPUs the thread runs on, such as "0-3,8", or NULL
+ * @param numa_node NUMA node of the thread, or -1
+ * @param fifo_priority SCHED_FIFO priority of the thread, or 0 to leave the
+ * scheduling policy unchanged
+ * @return pointer to xfer manager
+ */
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_placed(
+    uint8_t queue_length, uint16_t msg_pool_depth,
+    struct uprobe *uprobe_pthread_upump_mgr,
+    upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+    uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+    pthread_t *pthread_id_p, const pthread_attr_t *restrict attr,
+    int priority, const char *name, const char *cpus, int numa_node,
+    int fifo_priority);
+
+/** @This returns a management structure for transfer pipes, whose remote
+ * pipes are run by the worker threads of a pool rather than by a dedicated
+ * thread. A new lane of the pool is allocated for the manager, so that
+ * many managers may share a small number of threads.
+ *
+ * @param queue_length maximum length of the internal queue of commands
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param pool pool of worker threads
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * of the lane
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool of the lane
+ * @return pointer to xfer manager
+ */
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_pool(uint8_t queue_length,
+        uint16_t msg_pool_depth, struct upump_pthread_pool *pool,
+        uint16_t upump_pool_depth, uint16_t upump_blocker_pool_depth);
+
 #ifdef __cplusplus
 }
 #endif
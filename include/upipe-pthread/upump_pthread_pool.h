@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short pool of POSIX threads running many independent pipelines
+ *
+ * A pool runs a fixed number of worker threads, each with its own event loop
+ * allocated by a regular upump manager (for instance
+ * @ref upump_ev_mgr_alloc_loop). Pipelines do not use these event loops
+ * directly: each of them is given a lane, which is a upump manager allocated
+ * with @ref upump_pthread_pool_mgr_alloc.
+ *
+ * The events of the pumps of a lane are watched by the event loop of the
+ * worker the lane is assigned to. When they trigger, the lane is queued on
+ * that worker, and its callbacks are run by the first worker available:
+ * idle workers steal queued lanes from busy ones. The callbacks of a lane
+ * never run concurrently, so the pipes of a lane need no locking.
+ *
+ * The pumps of a lane may be allocated and controlled from any thread, as
+ * long as this is not done concurrently with the callbacks of the lane, for
+ * instance while setting up the pipeline before it is started.
+ */
+
+#ifndef _UPIPE_PTHREAD_UPUMP_PTHREAD_POOL_H_
+/** @hidden */
+#define _UPIPE_PTHREAD_UPUMP_PTHREAD_POOL_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/ubase.h"
+#include "upipe/uprobe.h"
+#include "upipe/upump.h"
+
+#include <stdint.h>
+
+#define UPUMP_PTHREAD_POOL_SIGNATURE UBASE_FOURCC('p','o','o','l')
+
+/** @hidden */
+struct upump_pthread_pool;
+
+/** @This allocates a pool of worker threads. The threads are joined in the
+ * event loop of the calling thread once the pool and all its lanes have been
+ * released.
+ *
+ * @param nb_threads number of worker threads
+ * @param uprobe_pthread_upump_mgr pointer to a uprobe_pthread_upump_mgr probe,
+ * providing the upump manager of the calling thread, and that will be set
+ * with the lane whose callbacks are running in the worker threads
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool of
+ * each worker
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool of each worker
+ * @return pointer to pool, or NULL in case of error
+ */
+struct upump_pthread_pool *upump_pthread_pool_alloc(unsigned int nb_threads,
+        struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth);
+
+/** @This increments the reference count of a pool.
+ *
+ * @param pool pointer to pool
+ * @return same pointer to pool
+ */
+struct upump_pthread_pool *upump_pthread_pool_use(
+        struct upump_pthread_pool *pool);
+
+/** @This decrements the reference count of a pool, and stops the worker
+ * threads once it is no longer used by any lane.
+ *
+ * @param pool pointer to pool
+ */
+void upump_pthread_pool_release(struct upump_pthread_pool *pool);
+
+/** @This allocates a lane, which is a upump manager whose callbacks are run by
+ * the worker threads of the pool. The lane is assigned to the worker with the
+ * fewest lanes. It keeps a reference to the pool.
+ *
+ * @param pool pointer to pool
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL in case of error
+ */
+struct upump_mgr *upump_pthread_pool_mgr_alloc(struct upump_pthread_pool *pool,
+        uint16_t upump_pool_depth, uint16_t upump_blocker_pool_depth);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
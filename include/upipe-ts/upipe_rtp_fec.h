@@ -22,6 +22,23 @@ extern "C" {
 #define UPIPE_RTP_FEC_SIGNATURE UBASE_FOURCC('r','f','c',' ')
 #define UPIPE_RTP_FEC_INPUT_SIGNATURE UBASE_FOURCC('r','f','c','i')
 
+/** @This holds the cumulative statistics of a rtp fec pipe. */
+struct upipe_rtp_fec_stats {
+    /** number of packets recovered by column FEC packets */
+    uint64_t col_recovered;
+    /** number of packets recovered by row FEC packets */
+    uint64_t row_recovered;
+    /** number of packets recovered by held FEC packets, after another packet
+     * was recovered */
+    uint64_t iterative_recovered;
+    /** number of FEC packets dropped with more than one packet missing */
+    uint64_t unrecoverable;
+    /** number of duplicate packets dropped */
+    uint64_t duplicates;
+    /** number of packets missing at the output */
+    uint64_t lost;
+};
+
 /** @This extends upipe_command with specific commands for avcodec decode. */
 enum rtp_fec_command {
     UPIPE_RTP_FEC_SENTINEL = UPIPE_CONTROL_LOCAL,
@@ -46,6 +63,8 @@ enum rtp_fec_command {
     UPIPE_RTP_FEC_SET_MAX_LATENCY,
     /** returns the current latency (uint64_t *) */
     UPIPE_RTP_FEC_GET_LATENCY,
+    /** returns the cumulative statistics (struct upipe_rtp_fec_stats *) */
+    UPIPE_RTP_FEC_GET_STATS,
 };
 
 static inline int upipe_rtp_fec_get_rows(struct upipe *upipe,
@@ -156,6 +175,21 @@ static inline int upipe_rtp_fec_get_latency(struct upipe *upipe,
                          UPIPE_RTP_FEC_SIGNATURE, latency);
 }
 
+/** @This returns the cumulative statistics. Contrary to
+ * @ref upipe_rtp_fec_get_packets_lost and
+ * @ref upipe_rtp_fec_get_packets_recovered, the counters are not reset.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled with the statistics
+ * @return an error code
+ */
+static inline int upipe_rtp_fec_get_stats(struct upipe *upipe,
+                                          struct upipe_rtp_fec_stats *stats)
+{
+    return upipe_control(upipe, UPIPE_RTP_FEC_GET_STATS,
+                         UPIPE_RTP_FEC_SIGNATURE, stats);
+}
+
 /** @This returns the management structure for rtp_fec pipes.
  *
  * @return pointer to manager
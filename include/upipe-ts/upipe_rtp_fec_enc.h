@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe SMPTE 2022-1 FEC generator module
+ *
+ * This pipe takes a RTP stream, forwards it to its output, and generates
+ * column and row FEC packets on two output subpipes.
+ */
+
+#ifndef _UPIPE_TS_UPIPE_RTP_FEC_ENC_H_
+/** @hidden */
+#define _UPIPE_TS_UPIPE_RTP_FEC_ENC_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/upipe.h"
+
+#define UPIPE_RTP_FEC_ENC_SIGNATURE UBASE_FOURCC('r','f','c','e')
+#define UPIPE_RTP_FEC_ENC_OUTPUT_SIGNATURE UBASE_FOURCC('r','f','e','o')
+
+/** @This extends upipe_command with specific commands for rtp fec enc. */
+enum upipe_rtp_fec_enc_command {
+    UPIPE_RTP_FEC_ENC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the column FEC subpipe (struct upipe **) */
+    UPIPE_RTP_FEC_ENC_GET_COL_SUB,
+    /** returns the row FEC subpipe (struct upipe **) */
+    UPIPE_RTP_FEC_ENC_GET_ROW_SUB,
+    /** sets the number of columns and rows (unsigned, unsigned) */
+    UPIPE_RTP_FEC_ENC_SET_MATRIX,
+    /** returns the number of columns and rows (unsigned *, unsigned *) */
+    UPIPE_RTP_FEC_ENC_GET_MATRIX,
+};
+
+/** @This returns the column FEC subpipe. The refcount is not incremented so
+ * you have to use it if you want to keep the pointer.
+ *
+ * @param upipe description structure of the super pipe
+ * @param upipe_p filled in with a pointer to the column FEC subpipe
+ * @return an error code
+ */
+static inline int upipe_rtp_fec_enc_get_col_sub(struct upipe *upipe,
+                                                struct upipe **upipe_p)
+{
+    return upipe_control(upipe, UPIPE_RTP_FEC_ENC_GET_COL_SUB,
+                         UPIPE_RTP_FEC_ENC_SIGNATURE, upipe_p);
+}
+
+/** @This returns the row FEC subpipe. The refcount is not incremented so
+ * you have to use it if you want to keep the pointer.
+ *
+ * @param upipe description structure of the super pipe
+ * @param upipe_p filled in with a pointer to the row FEC subpipe
+ * @return an error code
+ */
+static inline int upipe_rtp_fec_enc_get_row_sub(struct upipe *upipe,
+                                                struct upipe **upipe_p)
+{
+    return upipe_control(upipe, UPIPE_RTP_FEC_ENC_GET_ROW_SUB,
+                         UPIPE_RTP_FEC_ENC_SIGNATURE, upipe_p);
+}
+
+/** @This sets the size of the FEC matrix. The current matrix is discarded.
+ *
+ * @param upipe description structure of the pipe
+ * @param cols number of columns (L), between 1 and 255
+ * @param rows number of rows (D), between 1 and 255
+ * @return an error code
+ */
+static inline int upipe_rtp_fec_enc_set_matrix(struct upipe *upipe,
+                                               unsigned cols, unsigned rows)
+{
+    return upipe_control(upipe, UPIPE_RTP_FEC_ENC_SET_MATRIX,
+                         UPIPE_RTP_FEC_ENC_SIGNATURE, cols, rows);
+}
+
+/** @This returns the size of the FEC matrix.
+ *
+ * @param upipe description structure of the pipe
+ * @param cols_p filled in with the number of columns (L)
+ * @param rows_p filled in with the number of rows (D)
+ * @return an error code
+ */
+static inline int upipe_rtp_fec_enc_get_matrix(struct upipe *upipe,
+                                               unsigned *cols_p,
+                                               unsigned *rows_p)
+{
+    return upipe_control(upipe, UPIPE_RTP_FEC_ENC_GET_MATRIX,
+                         UPIPE_RTP_FEC_ENC_SIGNATURE, cols_p, rows_p);
+}
+
+/** @This returns the management structure for rtp fec enc pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_rtp_fec_enc_mgr_alloc(void);
+
+/** @This allocates and initializes a rtp fec enc pipe.
+ *
+ * @param mgr management structure for rtp fec enc type
+ * @param uprobe structure used to raise events for the super pipe
+ * @param uprobe_col structure used to raise events for the column subpipe
+ * @param uprobe_row structure used to raise events for the row subpipe
+ * @return pointer to allocated pipe, or NULL in case of failure
+ */
+static inline struct upipe *upipe_rtp_fec_enc_alloc(struct upipe_mgr *mgr,
+                                                    struct uprobe *uprobe,
+                                                    struct uprobe *uprobe_col,
+                                                    struct uprobe *uprobe_row)
+{
+    return upipe_alloc(mgr, uprobe, UPIPE_RTP_FEC_ENC_SIGNATURE,
+                       uprobe_col, uprobe_row);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
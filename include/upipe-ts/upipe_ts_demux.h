@@ -50,6 +50,8 @@ enum upipe_ts_demux_command {
     UPIPE_TS_DEMUX_SET_MAX_PCR_INTERVAL,
     /** gets the configured maximum interval between PCRs (uint64_t *) */
     UPIPE_TS_DEMUX_GET_MAX_PCR_INTERVAL,
+    /** sets the maximum number of TS packets per uref (unsigned int) */
+    UPIPE_TS_DEMUX_SET_VECTOR,
 };
 
 /** @This returns the currently detected conformance mode. It cannot return
@@ -147,6 +149,23 @@ static inline int upipe_ts_demux_get_max_pcr_interval(struct upipe *upipe,
                          UPIPE_TS_DEMUX_SIGNATURE, max);
 }
 
+/** @This sets the maximum number of TS packets per uref output by the inner
+ * ts_sync pipe (default 1). With a value greater than 1, runs of packets of
+ * the same PID go through ts_split and ts_decaps without being split into
+ * one uref per packet. It has no effect if the input is not synchronized
+ * by ts_sync.
+ *
+ * @param upipe description structure of the pipe
+ * @param vector maximum number of packets
+ * @return an error code
+ */
+static inline int upipe_ts_demux_set_vector(struct upipe *upipe,
+                                            unsigned int vector)
+{
+    return upipe_control(upipe, UPIPE_TS_DEMUX_SET_VECTOR,
+                         UPIPE_TS_DEMUX_SIGNATURE, vector);
+}
+
 /** @This returns the management structure for all ts_demux pipes.
  *
  * @return pointer to manager
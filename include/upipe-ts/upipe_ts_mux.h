@@ -163,6 +163,8 @@ enum upipe_ts_mux_command {
     UPIPE_TS_MUX_GET_PES_MIN_DURATION,
     /** forces PES alignment (int) */
     UPIPE_TS_MUX_FORCE_PES_ALIGNMENT,
+    /** selects the linear scheduler (int) */
+    UPIPE_TS_MUX_SET_LINEAR_SCHEDULER,
 
     /** ts_encaps commands begin here */
     UPIPE_TS_MUX_ENCAPS = UPIPE_CONTROL_LOCAL + 0x1000,
@@ -784,6 +786,22 @@ static inline int upipe_ts_mux_force_pes_alignment(struct upipe *upipe,
                          UPIPE_TS_MUX_SIGNATURE, force ? 1 : 0);
 }
 
+/** @This selects the scheduler of the inputs. The default scheduler keeps
+ * the inputs in heaps, while the linear scheduler walks all the inputs for
+ * every packet. Both produce the same output; the linear scheduler is only
+ * kept as a reference for regression tests.
+ *
+ * @param upipe description structure of the pipe
+ * @param linear true to select the linear scheduler
+ * @return an error code
+ */
+static inline int upipe_ts_mux_set_linear_scheduler(struct upipe *upipe,
+                                                    bool linear)
+{
+    return upipe_control(upipe, UPIPE_TS_MUX_SET_LINEAR_SCHEDULER,
+                         UPIPE_TS_MUX_SIGNATURE, linear ? 1 : 0);
+}
+
 /** @This stops updating a PSI table upon sub removal.
  *
  * @param upipe description structure of the pipe
@@ -37,7 +37,11 @@ enum upipe_ts_sync_command {
     /** returns the configured number of packets to synchronize with (int *) */
     UPIPE_TS_SYNC_GET_SYNC,
     /** sets the configured number of packets to synchronize with (int) */
-    UPIPE_TS_SYNC_SET_SYNC
+    UPIPE_TS_SYNC_SET_SYNC,
+    /** returns the maximum number of packets per uref (unsigned int *) */
+    UPIPE_TS_SYNC_GET_VECTOR,
+    /** sets the maximum number of packets per uref (unsigned int) */
+    UPIPE_TS_SYNC_SET_VECTOR
 };
 
 /** @This returns the management structure for all ts_sync pipes.
@@ -72,6 +76,37 @@ static inline int upipe_ts_sync_set_sync(struct upipe *upipe, int sync)
                          sync);
 }
 
+/** @This returns the maximum number of TS packets per output uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param vector_p filled in with the number of packets
+ * @return an error code
+ */
+static inline int upipe_ts_sync_get_vector(struct upipe *upipe,
+                                           unsigned int *vector_p)
+{
+    return upipe_control(upipe, UPIPE_TS_SYNC_GET_VECTOR,
+                         UPIPE_TS_SYNC_SIGNATURE, vector_p);
+}
+
+/** @This sets the maximum number of TS packets per output uref (default 1).
+ * With a value greater than 1, consecutive packets of the same input uref
+ * are output together in a single uref, which ts_split and ts_decaps
+ * process without splitting them into one uref per packet first. Other
+ * pipes expecting exactly one TS packet per uref must not be connected to
+ * the output in that mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param vector maximum number of packets
+ * @return an error code
+ */
+static inline int upipe_ts_sync_set_vector(struct upipe *upipe,
+                                           unsigned int vector)
+{
+    return upipe_control(upipe, UPIPE_TS_SYNC_SET_VECTOR,
+                         UPIPE_TS_SYNC_SIGNATURE, vector);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats with AF_XDP UMEM storage
+ *
+ * The manager owns a UMEM area, divided in frames of a fixed power-of-two
+ * size, which is registered to AF_XDP sockets by the XDP source and sink
+ * pipes. A frame is either free, owned by a socket ring, or held by ubufs.
+ * Frames received from a socket are wrapped in ubufs without copy, and
+ * blocks allocated with @ref ubuf_block_alloc are allocated in free frames,
+ * so that they may be transmitted without copy.
+ */
+
+#ifndef _UPIPE_XDP_UBUF_BLOCK_XDP_H_
+/** @hidden */
+#define _UPIPE_XDP_UBUF_BLOCK_XDP_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/ubase.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @This is the signature to use to allocate from a received frame. */
+#define UBUF_BLOCK_XDP_ALLOC_FRAME UBASE_FOURCC('x','d','p','f')
+/** @This is the signature of local control commands. */
+#define UBUF_BLOCK_XDP_SIGNATURE UBASE_FOURCC('x','d','p','b')
+
+/** @This extends @ref ubuf_command with specific commands. */
+enum ubuf_block_xdp_command {
+    UBUF_BLOCK_XDP_SENTINEL = UBUF_CONTROL_LOCAL,
+
+    /** returns the UMEM address of the block (uint64_t *) */
+    UBUF_BLOCK_XDP_GET_ADDR,
+};
+
+/** @This extends @ref ubuf_mgr_command with specific commands. */
+enum ubuf_block_xdp_mgr_command {
+    UBUF_BLOCK_XDP_MGR_SENTINEL = UBUF_MGR_CONTROL_LOCAL,
+
+    /** returns the UMEM area (uint8_t **, size_t *, unsigned int *) */
+    UBUF_BLOCK_XDP_MGR_GET_UMEM,
+    /** takes a free frame (uint64_t *) */
+    UBUF_BLOCK_XDP_MGR_GET_FRAME,
+    /** gives back a frame (uint64_t) */
+    UBUF_BLOCK_XDP_MGR_PUT_FRAME,
+};
+
+/** @This returns a new ubuf pointing to a received frame. The frame
+ * belongs to the ubuf, and is given back to the free frames when the last
+ * ubuf pointing to it is released.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param addr UMEM address of the block, as given by the receive ring
+ * @param size size of the block
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_block_xdp_alloc_frame(struct ubuf_mgr *mgr,
+                                                      uint64_t addr, int size)
+{
+    return ubuf_alloc(mgr, UBUF_BLOCK_XDP_ALLOC_FRAME, addr, size);
+}
+
+/** @This returns the UMEM address of the first segment of a block. This
+ * fails if the ubuf was not allocated by a XDP ubuf manager or if the block
+ * has more than one segment.
+ *
+ * @param ubuf pointer to ubuf
+ * @param addr_p filled in with the UMEM address
+ * @return an error code
+ */
+static inline int ubuf_block_xdp_get_addr(struct ubuf *ubuf,
+                                          uint64_t *addr_p)
+{
+    return ubuf_control(ubuf, UBUF_BLOCK_XDP_GET_ADDR,
+                        UBUF_BLOCK_XDP_SIGNATURE, addr_p);
+}
+
+/** @This returns the UMEM area of the manager.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param area_p filled in with a pointer to the UMEM area
+ * @param size_p filled in with the size of the UMEM area
+ * @param frame_size_p filled in with the size of a frame
+ * @return an error code
+ */
+static inline int ubuf_block_xdp_mgr_get_umem(struct ubuf_mgr *mgr,
+                                              uint8_t **area_p,
+                                              size_t *size_p,
+                                              unsigned int *frame_size_p)
+{
+    return ubuf_mgr_control(mgr, UBUF_BLOCK_XDP_MGR_GET_UMEM,
+                            UBUF_BLOCK_XDP_SIGNATURE, area_p, size_p,
+                            frame_size_p);
+}
+
+/** @This takes a free frame, typically to give it to the fill or transmit
+ * ring of a socket.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param addr_p filled in with the UMEM address of the frame
+ * @return an error code, UBASE_ERR_BUSY if no frame is free
+ */
+static inline int ubuf_block_xdp_mgr_get_frame(struct ubuf_mgr *mgr,
+                                               uint64_t *addr_p)
+{
+    return ubuf_mgr_control(mgr, UBUF_BLOCK_XDP_MGR_GET_FRAME,
+                            UBUF_BLOCK_XDP_SIGNATURE, addr_p);
+}
+
+/** @This gives back a frame previously taken with @ref
+ * ubuf_block_xdp_mgr_get_frame.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param addr any UMEM address inside the frame
+ * @return an error code
+ */
+static inline int ubuf_block_xdp_mgr_put_frame(struct ubuf_mgr *mgr,
+                                               uint64_t addr)
+{
+    return ubuf_mgr_control(mgr, UBUF_BLOCK_XDP_MGR_PUT_FRAME,
+                            UBUF_BLOCK_XDP_SIGNATURE, addr);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * using AF_XDP UMEM frames.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param nb_frames number of frames of the UMEM area
+ * @param frame_size size of a frame, a power of two between 2048 and the
+ * page size
+ * @param headroom space reserved before the blocks allocated with @ref
+ * ubuf_block_alloc, to prepend headers
+ * @return pointer to manager or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_xdp_mgr_alloc(uint16_t ubuf_pool_depth,
+                                          uint16_t nb_frames,
+                                          unsigned int frame_size,
+                                          unsigned int headroom);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe sink module for AF_XDP sockets
+ *
+ * The sink binds an AF_XDP socket to a queue of the interface given by
+ * @ref upipe_set_uri, for instance "eth0" or "eth0/2" for the queue 2. By
+ * default the input buffers are complete ethernet frames; when @ref
+ * upipe_xdp_sink_set_udp is called, they are UDP payloads and the
+ * ethernet, IPv4 and UDP headers are added by the sink.
+ *
+ * The sink answers the ubuf manager requests of its input with the manager
+ * of its UMEM area, so that buffers allocated upstream are sent without
+ * copy. Other buffers are copied into free UMEM frames. Frames are given
+ * back when the completion ring is reaped, once per batch of packets.
+ */
+
+#ifndef _UPIPE_XDP_UPIPE_XDP_SINK_H_
+/** @hidden */
+#define _UPIPE_XDP_UPIPE_XDP_SINK_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/upipe.h"
+
+#include <stdint.h>
+
+#define UPIPE_XDP_SINK_SIGNATURE UBASE_FOURCC('x','d','p','k')
+
+/** @This extends @ref upipe_command with specific XDP sink commands. */
+enum upipe_xdp_sink_command {
+    UPIPE_XDP_SINK_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the UDP addresses of the output packets (const char *,
+     * const char *, const uint8_t *, const uint8_t *) */
+    UPIPE_XDP_SINK_SET_UDP,
+};
+
+/** @This converts XDP sink specific command to a string.
+ *
+ * @param cmd @ref upipe_xdp_sink_command to convert
+ * @return the corresponding string or NULL if not a valid
+ * @ref upipe_xdp_sink_command
+ */
+static inline const char *upipe_xdp_sink_command_str(int cmd)
+{
+    switch ((enum upipe_xdp_sink_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_XDP_SINK_SET_UDP);
+    case UPIPE_XDP_SINK_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This sets the addresses of the output UDP packets. The destination MAC
+ * address defaults to the multicast address derived from the destination
+ * IP address, or to the broadcast address for unicast destinations, and
+ * the source MAC address defaults to zero.
+ *
+ * @param upipe description structure of the pipe
+ * @param src source address and port (ip:port)
+ * @param dst destination address and port (ip:port), or NULL to send the
+ * input buffers as complete ethernet frames
+ * @param src_mac source MAC address (6 octets), or NULL
+ * @param dst_mac destination MAC address (6 octets), or NULL
+ * @return an error code
+ */
+static inline int upipe_xdp_sink_set_udp(struct upipe *upipe,
+                                         const char *src, const char *dst,
+                                         const uint8_t *src_mac,
+                                         const uint8_t *dst_mac)
+{
+    return upipe_control(upipe, UPIPE_XDP_SINK_SET_UDP,
+                         UPIPE_XDP_SINK_SIGNATURE, src, dst,
+                         src_mac, dst_mac);
+}
+
+/** @This returns the management structure for XDP sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xdp_sink_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
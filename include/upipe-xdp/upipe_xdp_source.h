@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe source module for AF_XDP sockets
+ *
+ * The source binds an AF_XDP socket to a queue of the interface given by
+ * @ref upipe_set_uri, for instance "eth0" or "eth0/2" for the queue 2, and
+ * attaches a XDP program redirecting the IPv4 UDP packets of the queue to
+ * the socket, while other packets go to the kernel stack. The UDP payloads
+ * are output in place, in the frames of a UMEM area managed by a ubuf
+ * manager (see @ref ubuf_block_xdp_mgr_alloc).
+ */
+
+#ifndef _UPIPE_XDP_UPIPE_XDP_SOURCE_H_
+/** @hidden */
+#define _UPIPE_XDP_UPIPE_XDP_SOURCE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/upipe.h"
+
+#define UPIPE_XDP_SOURCE_SIGNATURE UBASE_FOURCC('x','d','p','s')
+
+/** @This returns the management structure for XDP source pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xdp_source_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -253,6 +253,19 @@ static inline uint32_t uatomic_fetch_sub(uatomic_uint32_t *obj,
 #define uatomic_ptr_compare_exchange_ptr(obj, expected, desired)            \
     uatomic_ptr_compare_exchange(obj, (void **)expected, desired)
 
+/** @This tells the processor that the calling thread is busy-waiting on an
+ * atomic variable, so that it may save power or give its resources to
+ * another hardware thread.
+ */
+static inline void uatomic_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
 #ifdef __cplusplus
 }
 #endif
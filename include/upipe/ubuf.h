@@ -29,6 +29,8 @@ extern "C" {
 /** @hidden */
 struct ubuf_mgr;
 /** @hidden */
+struct upool_stats;
+/** @hidden */
 struct uref;
 
 /** @This is allocated by a manager and eventually points to a buffer
@@ -123,6 +125,8 @@ enum ubuf_mgr_command {
     UBUF_MGR_CHECK,
     /** release all buffers kept in pools (void) */
     UBUF_MGR_VACUUM,
+    /** add the statistics of the pools (struct upool_stats *) */
+    UBUF_MGR_GET_STATS,
 
     /** non-standard commands implemented by a ubuf manager can start from
      * there */
@@ -310,6 +314,20 @@ static inline int ubuf_mgr_vacuum(struct ubuf_mgr *mgr)
     return ubuf_mgr_control(mgr, UBUF_MGR_VACUUM);
 }
 
+/** @This adds the statistics of the pools of an existing ubuf manager to the
+ * given structure, which must be initialized by the caller. The underlying
+ * umem manager is not included.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static inline int ubuf_mgr_get_stats(struct ubuf_mgr *mgr,
+                                     struct upool_stats *stats)
+{
+    return ubuf_mgr_control(mgr, UBUF_MGR_GET_STATS, stats);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -1021,6 +1021,32 @@ static inline int ubuf_block_match(struct ubuf *ubuf, const uint8_t *filter,
     return UBASE_ERR_NONE;
 }
 
+/** @This finds the first MPEG-style 3-octet start code (00 00 01) in a
+ * linear buffer, using SIMD instructions if available.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @return pointer to the first octet of the start code, or end
+ */
+const uint8_t *ubuf_block_scan_startcode(const uint8_t *p, const uint8_t *end);
+
+/** @This finds the first position in a linear buffer where a sync word
+ * repeats the given number of times at a fixed interval, such as the
+ * 0x47 sync bytes of consecutive TS packets, using SIMD instructions if
+ * available.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param word sync word
+ * @param stride distance between sync words, in octets
+ * @param count number of sync words (at least 1)
+ * @return pointer to the first sync word, or end if there is no position
+ * whose sync words all lie in the buffer
+ */
+const uint8_t *ubuf_block_scan_sync(const uint8_t *p, const uint8_t *end,
+                                    uint8_t word, size_t stride,
+                                    unsigned int count);
+
 /** @This scans for an octet word in a block ubuf.
  *
  * @param ubuf pointer to ubuf
@@ -1049,6 +1075,57 @@ static inline int ubuf_block_scan(struct ubuf *ubuf, size_t *offset_p,
     return UBASE_ERR_INVALID;
 }
 
+/** @This finds an MPEG-style 3-octet start code (00 00 01) in a block ubuf.
+ * Each segment is scanned with @ref ubuf_block_scan_startcode, and only the
+ * candidates at the end of a segment are checked octet by octet.
+ *
+ * @param ubuf pointer to ubuf
+ * @param offset_p start offset (in octets), written with the offset of the
+ * first start code, or first candidate if there aren't enough octets in the
+ * ubuf, or the total size of the ubuf if none was found
+ * @return UBASE_ERR_NONE if the start code was found
+ */
+static inline int ubuf_block_find_startcode(struct ubuf *ubuf,
+                                            size_t *offset_p)
+{
+    for ( ; ; ) {
+        const uint8_t *buffer;
+        int size = -1;
+        UBASE_RETURN(ubuf_block_read(ubuf, *offset_p, &size, &buffer))
+        const uint8_t *end = buffer + size;
+        const uint8_t *match = ubuf_block_scan_startcode(buffer, end);
+        ubuf_block_unmap(ubuf, *offset_p);
+        if (match != end) {
+            *offset_p += match - buffer;
+            return UBASE_ERR_NONE;
+        }
+
+        /* start codes may straddle the end of the segment */
+        int tail = size < 2 ? size : 2;
+        *offset_p += size - tail;
+        for ( ; tail > 0; tail--) {
+            uint8_t rbuffer[3];
+            const uint8_t *word = ubuf_block_peek(ubuf, *offset_p, 1,
+                                                  rbuffer);
+            if (word == NULL)
+                return UBASE_ERR_INVALID;
+            bool candidate = word[0] == 0;
+            ubuf_block_peek_unmap(ubuf, *offset_p, rbuffer, word);
+            if (candidate) {
+                word = ubuf_block_peek(ubuf, *offset_p, 3, rbuffer);
+                if (word == NULL)
+                    return UBASE_ERR_INVALID;
+                bool found = word[1] == 0 && word[2] == 1;
+                ubuf_block_peek_unmap(ubuf, *offset_p, rbuffer, word);
+                if (found)
+                    return UBASE_ERR_NONE;
+            }
+            (*offset_p)++;
+        }
+    }
+    return UBASE_ERR_INVALID;
+}
+
 /** @This finds a multi-octet word in a block ubuf.
  *
  * @param ubuf pointer to ubuf
@@ -1066,6 +1143,15 @@ static inline int ubuf_block_find_va(struct ubuf *ubuf, size_t *offset_p,
     unsigned int sync = va_arg(args, unsigned int);
     if (nb_octets == 1)
         return ubuf_block_scan(ubuf, offset_p, sync);
+    if (nb_octets == 3 && sync == 0) {
+        va_list args_copy;
+        va_copy(args_copy, args);
+        unsigned int word1 = va_arg(args_copy, unsigned int);
+        unsigned int word2 = va_arg(args_copy, unsigned int);
+        va_end(args_copy);
+        if (word1 == 0 && word2 == 1)
+            return ubuf_block_find_startcode(ubuf, offset_p);
+    }
 
     for ( ; ; ) {
         UBASE_RETURN(ubuf_block_scan(ubuf, offset_p, sync))
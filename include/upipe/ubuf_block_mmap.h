@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats pointing to mapped files
+ * The blocks allocated by this manager directly reference the pages of a
+ * file mapped in memory, so that reading the file doesn't involve any copy.
+ * The file is mapped by windows, which are unmapped when the last block
+ * referencing them is released. A single block kept downstream therefore
+ * keeps its whole window mapped, so the window size should be lowered for
+ * pipelines retaining packets for a long time.
+ *
+ * Other block allocations (@ref ubuf_block_alloc) are served by an internal
+ * memory block manager, so that the manager may be used by pipes
+ * allocating new blocks from the manager of their input.
+ *
+ * Warning: if the mapped file is truncated while blocks point into it,
+ * reading the pages beyond the new end of file raises SIGBUS. Only map
+ * files which are not truncated, or handle SIGBUS.
+ */
+
+#ifndef _UPIPE_UBUF_BLOCK_MMAP_H_
+/** @hidden */
+#define _UPIPE_UBUF_BLOCK_MMAP_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/ubase.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+
+#include <stdint.h>
+
+/** @This is the signature to use to allocate from the mapped file. */
+#define UBUF_BLOCK_MMAP_ALLOC_FILE UBASE_FOURCC('m','m','a','f')
+/** @This is the signature of local control commands. */
+#define UBUF_BLOCK_MMAP_SIGNATURE UBASE_FOURCC('m','m','a','p')
+
+/** default size of the mapped windows */
+#define UBUF_BLOCK_MMAP_DEF_WINDOW (16 * 1024 * 1024)
+
+/** @This extends @ref ubuf_mgr_command with specific commands. */
+enum ubuf_block_mmap_mgr_command {
+    UBUF_BLOCK_MMAP_MGR_SENTINEL = UBUF_MGR_CONTROL_LOCAL,
+
+    /** sets the file to map, or -1 (int) */
+    UBUF_BLOCK_MMAP_MGR_SET_FD,
+    /** returns the current size of the file (uint64_t *) */
+    UBUF_BLOCK_MMAP_MGR_GET_SIZE,
+    /** returns the size of the mapped windows (uint64_t *) */
+    UBUF_BLOCK_MMAP_MGR_GET_WINDOW,
+    /** sets the size of the mapped windows (uint64_t) */
+    UBUF_BLOCK_MMAP_MGR_SET_WINDOW,
+};
+
+/** @This returns a new ubuf pointing to a part of the mapped file. The size
+ * is truncated at the end of the file.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param offset offset of the block in the file
+ * @param size size of the block
+ * @return pointer to ubuf or NULL in case of failure, or if offset is
+ * beyond the end of the file
+ */
+static inline struct ubuf *ubuf_block_mmap_alloc(struct ubuf_mgr *mgr,
+                                                 uint64_t offset, int size)
+{
+    return ubuf_alloc(mgr, UBUF_BLOCK_MMAP_ALLOC_FILE, offset, size);
+}
+
+/** @This sets the file to map. The file descriptor is duplicated, so the
+ * caller may close it afterwards. The ubufs already allocated keep
+ * pointing to the previous file.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param fd file descriptor, or -1 to release the current file
+ * @return an error code
+ */
+static inline int ubuf_block_mmap_mgr_set_fd(struct ubuf_mgr *mgr, int fd)
+{
+    return ubuf_mgr_control(mgr, UBUF_BLOCK_MMAP_MGR_SET_FD,
+                            UBUF_BLOCK_MMAP_SIGNATURE, fd);
+}
+
+/** @This returns the current size of the mapped file, which may have grown
+ * since it was set.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param size_p filled in with the size of the file
+ * @return an error code
+ */
+static inline int ubuf_block_mmap_mgr_get_size(struct ubuf_mgr *mgr,
+                                               uint64_t *size_p)
+{
+    return ubuf_mgr_control(mgr, UBUF_BLOCK_MMAP_MGR_GET_SIZE,
+                            UBUF_BLOCK_MMAP_SIGNATURE, size_p);
+}
+
+/** @This returns the size of the mapped windows.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param window_size_p filled in with the size of the windows
+ * @return an error code
+ */
+static inline int ubuf_block_mmap_mgr_get_window(struct ubuf_mgr *mgr,
+                                                 uint64_t *window_size_p)
+{
+    return ubuf_mgr_control(mgr, UBUF_BLOCK_MMAP_MGR_GET_WINDOW,
+                            UBUF_BLOCK_MMAP_SIGNATURE, window_size_p);
+}
+
+/** @This sets the size of the windows mapped afterwards. The size is
+ * rounded up to a multiple of the page size. The windows already mapped are
+ * kept until the blocks pointing into them are released.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param window_size size of the windows (if set to 0, a default sensible
+ * value is used)
+ * @return an error code
+ */
+static inline int ubuf_block_mmap_mgr_set_window(struct ubuf_mgr *mgr,
+                                                 uint64_t window_size)
+{
+    return ubuf_mgr_control(mgr, UBUF_BLOCK_MMAP_MGR_SET_WINDOW,
+                            UBUF_BLOCK_MMAP_SIGNATURE, window_size);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * pointing to mapped files.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param window_size size of the mapped windows (if set to 0, a default
+ * sensible value is used)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_mmap_mgr_alloc(uint16_t ubuf_pool_depth,
+                                           uint64_t window_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
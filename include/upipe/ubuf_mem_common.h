@@ -99,7 +99,7 @@ void *ubuf_mem_shared_alloc_inner(struct upool *upool);
  */
 void ubuf_mem_shared_free_inner(struct upool *upool, void *_shared);
 
-/** @This declares eight functions dealing with the structure pools of
+/** @This declares nine functions dealing with the structure pools of
  * ubuf managers using umem storage.
  *
  * You must add two members to your private ubuf_mgr structure, for instance:
@@ -142,6 +142,12 @@ void ubuf_mem_shared_free_inner(struct upool *upool, void *_shared);
  * Releases all structures kept in pools.
  *
  * @item @code
+ *  void ubuf_foo_mgr_get_stats_pool(struct ubuf_mgr *,
+ *                                   struct upool_stats *)
+ * @end code
+ * Adds the statistics of the pools.
+ *
+ * @item @code
  *  void ubuf_foo_mgr_clean_pool(struct ubuf_mgr *)
  * @end code
  * Called before deallocation of the manager.
@@ -236,6 +242,18 @@ static void STRUCTURE##_mgr_vacuum_pool(struct ubuf_mgr *mgr)               \
     upool_vacuum(&mem_mgr->UBUF_POOL);                                      \
     upool_vacuum(&mem_mgr->SHARED_POOL);                                    \
 }                                                                           \
+/** @internal @This adds the statistics of the pools.                       \
+ *                                                                          \
+ * @param mgr pointer to a ubuf manager                                     \
+ * @param stats filled in with the statistics                               \
+ */                                                                         \
+static void STRUCTURE##_mgr_get_stats_pool(struct ubuf_mgr *mgr,            \
+                                           struct upool_stats *stats)       \
+{                                                                           \
+    struct STRUCTURE##_mgr *mem_mgr = STRUCTURE##_mgr_from_ubuf_mgr(mgr);   \
+    upool_add_stats(&mem_mgr->UBUF_POOL, stats);                            \
+    upool_add_stats(&mem_mgr->SHARED_POOL, stats);                          \
+}                                                                           \
 /** @internal @This is called on deallocation of the manager.               \
  *                                                                          \
  * @param mgr pointer to a ubuf manager                                     \
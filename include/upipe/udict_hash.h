@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2012 OpenHeadend S.A.R.L.
+ * Copyright (C) 2026 EasyTools
+ *
+ * Authors: Christophe Massiot
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe hash-indexed manager of dictionary of attributes
+ * This manager interns the names of attributes into global integer IDs, the
+ * first time they are set, and indexes the attributes of each udict with a
+ * small open-addressed hash table, so that looking up an attribute does not
+ * depend on the number of attributes in the udict. Entries, index and values
+ * are stored in a single umem block.
+ */
+
+#ifndef _UPIPE_UDICT_HASH_H_
+/** @hidden */
+#define _UPIPE_UDICT_HASH_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/udict.h"
+
+struct umem_mgr;
+
+/** @This allocates a new instance of the hash udict manager.
+ *
+ * @param udict_pool_depth maximum number of udict structures in the pool
+ * @param umem_mgr memory allocator to use for buffers
+ * @param min_size minimum allocated space for the values of the udict (if
+ * set to -1, a default sensible value is used)
+ * @param extra_size extra space added when the udict needs to be resized
+ * (if set to -1, a default sensible value is used)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct udict_mgr *udict_hash_mgr_alloc(uint16_t udict_pool_depth,
+                                       struct umem_mgr *umem_mgr,
+                                       int min_size, int extra_size);
+
+/** @This registers a new shorthand attribute type, in addition to the
+ * built-in ones, for use with the hash udict manager. Registering an
+ * existing name returns the type already allocated. This is not thread-safe
+ * and is intended to be called at initialization, before the type is used.
+ *
+ * @param name name of the attribute
+ * @param base_type base type of the attribute
+ * @param type_p filled in with the shorthand type
+ * @return an error code
+ */
+int udict_hash_register_shorthand(const char *name, enum udict_type base_type,
+                                  enum udict_type *type_p);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
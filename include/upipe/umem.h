@@ -26,6 +26,8 @@ extern "C" {
 
 /** @hidden */
 struct umem_mgr;
+/** @hidden */
+struct upool_stats;
 
 /** @This is not treated the same way as other structures in Upipe:
  * it is not allocated by the manager, but by the caller. The manager only
@@ -78,6 +80,8 @@ struct umem_mgr {
 
     /** function to release all buffers kept in pools */
     void (*umem_mgr_vacuum)(struct umem_mgr *);
+    /** function to add the statistics of the pools */
+    void (*umem_mgr_get_stats)(struct umem_mgr *, struct upool_stats *);
 };
 
 /** @This allocates a new umem buffer space.
@@ -134,6 +138,23 @@ static inline void umem_mgr_vacuum(struct umem_mgr *mgr)
         mgr->umem_mgr_vacuum(mgr);
 }
 
+/** @This adds the statistics of the pools of an existing umem manager to
+ * the given structure, which must be initialized by the caller.
+ *
+ * @param mgr pointer to umem manager
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static inline int umem_mgr_get_stats(struct umem_mgr *mgr,
+                                     struct upool_stats *stats)
+{
+    assert(mgr != NULL);
+    if (unlikely(mgr->umem_mgr_get_stats == NULL))
+        return UBASE_ERR_UNHANDLED;
+    mgr->umem_mgr_get_stats(mgr, stats);
+    return UBASE_ERR_NONE;
+}
+
 /** @This increments the reference count of a umem manager.
  *
  * @param mgr pointer to umem manager
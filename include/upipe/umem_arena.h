@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe arena-based memory allocator
+ * This memory allocator reserves a single memory region at allocation time,
+ * preferably backed by huge pages, and carves buffers from it, organized by
+ * size classes of four steps per power of 2. Released buffers are kept for
+ * later use and never given back to the system, so that allocations do not
+ * involve any system call. When the free space of the region is exhausted,
+ * and on @ref umem_mgr_vacuum, released buffers are merged back into the
+ * region so that they may be carved for other sizes. The size of the region
+ * is a hard limit on the memory used.
+ *
+ * It can be passed to @ref uprobe_ubuf_mem_pool_alloc instead of
+ * @ref umem_pool_mgr_alloc_simple.
+ */
+
+#ifndef _UPIPE_UMEM_ARENA_H_
+/** @hidden */
+#define _UPIPE_UMEM_ARENA_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "upipe/umem.h"
+
+/** @This defines the flags of the umem arena manager. */
+enum umem_arena_flags {
+    /** back the region with explicit huge pages (MAP_HUGETLB), falling back
+     * to transparent huge pages if none are available */
+    UMEM_ARENA_HUGETLB = 0x1,
+    /** lock the region in memory */
+    UMEM_ARENA_MLOCK = 0x2,
+};
+
+/** @This allocates a new instance of the umem arena manager.
+ *
+ * @param arena_size size (in octets) of the region to reserve
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param nb_pools number of power of 2 buffer sizes, with intermediate sizes
+ * in quarter steps between them; larger buffers cannot be allocated
+ * @param flags bitmask of @ref umem_arena_flags
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_arena_mgr_alloc(size_t arena_size, size_t pool0_size,
+                                      unsigned int nb_pools,
+                                      unsigned int flags);
+
+/** @This allocates a new instance of the umem arena manager, with its region
+ * placed preferably on the memory of the given NUMA node. The pages are bound
+ * with mbind() before they are first touched, so the placement does not depend
+ * on the thread that happens to write into a buffer first.
+ *
+ * @param arena_size size (in octets) of the region to reserve
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param nb_pools number of power of 2 buffer sizes, with intermediate sizes
+ * in quarter steps between them; larger buffers cannot be allocated
+ * @param flags bitmask of @ref umem_arena_flags
+ * @param numa_node NUMA node of the region, or -1 to follow the memory policy
+ * of the thread touching the pages first
+ * @return pointer to manager, or NULL in case of error (including when the
+ * system does not support NUMA placement)
+ */
+struct umem_mgr *umem_arena_mgr_alloc_node(size_t arena_size,
+                                           size_t pool0_size,
+                                           unsigned int nb_pools,
+                                           unsigned int flags, int numa_node);
+
+/** @This allocates a new instance of the umem arena manager, with buffer
+ * sizes from 32 octets to 32 MiB, enough for 4K pictures.
+ *
+ * @param arena_size size (in octets) of the region to reserve
+ * @param flags bitmask of @ref umem_arena_flags
+ * @return pointer to manager, or NULL in case of error
+ */
+static inline struct umem_mgr *umem_arena_mgr_alloc_simple(size_t arena_size,
+                                                           unsigned int flags)
+{
+    return umem_arena_mgr_alloc(arena_size, 32, 21, flags);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -206,6 +206,11 @@ struct upipe_mgr {
     /** control function for standard or local manager commands - all parameters
      * belong to the caller */
     int (*upipe_mgr_control)(struct upipe_mgr *, int, va_list);
+
+    /** function to send a list of urefs to an input at once (optional) - the
+     * urefs then belong to the callee, which must leave the list empty */
+    void (*upipe_input_chain)(struct upipe *, struct uchain *,
+                              struct upump **);
 };
 
 /** @This initializes a upipe manager structure with default values.
@@ -224,6 +229,7 @@ static inline void upipe_mgr_init(struct upipe_mgr *mgr)
         mgr->upipe_input = NULL;
         mgr->upipe_control = NULL;
         mgr->upipe_mgr_control = NULL;
+        mgr->upipe_input_chain = NULL;
     }
 }
 
@@ -1065,6 +1071,37 @@ static inline void upipe_input(struct upipe *upipe, struct uref *uref,
     upipe_release(upipe);
 }
 
+/** @This sends a list of input buffers into a pipe, chained by their
+ * @tt uchain member. It allows pipes processing packets in batches to amortize
+ * the cost of a call per buffer. If the pipe doesn't implement
+ * @ref upipe_mgr.upipe_input_chain, the buffers are sent one by one to
+ * @ref upipe_input. Note that the urefs are then owned by the callee, and
+ * the list is empty upon return.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures to send
+ * @param upump_p reference to the pump that generated the buffers
+ */
+static inline void upipe_input_chain(struct upipe *upipe, struct uchain *urefs,
+                                     struct upump **upump_p)
+{
+    assert(upipe != NULL);
+    if (unlikely(ulist_empty(urefs)))
+        return;
+    upipe_use(upipe);
+    if (upipe->mgr->upipe_input_chain != NULL) {
+        utrace_upipe_input_enter(upipe, uref_from_uchain(ulist_peek(urefs)));
+        upipe->mgr->upipe_input_chain(upipe, urefs, upump_p);
+        utrace_upipe_input_leave();
+        assert(ulist_empty(urefs));
+    } else {
+        struct uchain *uchain;
+        while ((uchain = ulist_pop(urefs)) != NULL)
+            upipe_input(upipe, uref_from_uchain(uchain), upump_p);
+    }
+    upipe_release(upipe);
+}
+
 /** @internal @This sends a control command to the pipe. Note that all control
  * commands must be executed from the same thread - no reentrancy or locking
  * is required from the pipe. Also note that all arguments are owned by the
@@ -133,6 +133,27 @@ static UBASE_UNUSED void STRUCTURE##_bin_input(struct upipe *upipe,         \
     }                                                                       \
     upipe_input(s->FIRST_INNER, uref, upump_p);                             \
 }                                                                           \
+/** @internal @This sends a list of urefs to the input. Note that urefs   \
+ * are then owned by the callee and the list is empty upon return.          \
+ *                                                                          \
+ * @param upipe description structure of the pipe                           \
+ * @param urefs list of uref structures to send                             \
+ * @param upump_p reference to pump that generated the buffers              \
+ */                                                                         \
+static UBASE_UNUSED void STRUCTURE##_bin_input_chain(struct upipe *upipe,   \
+                                                     struct uchain *urefs,  \
+                                                     struct upump **upump_p)\
+{                                                                           \
+    struct STRUCTURE *s = STRUCTURE##_from_upipe(upipe);                    \
+    if (s->FIRST_INNER == NULL) {                                           \
+        upipe_warn(upipe, "invalid first inner, dropping urefs");           \
+        struct uchain *uchain;                                              \
+        while ((uchain = ulist_pop(urefs)) != NULL)                         \
+            uref_free(uref_from_uchain(uchain));                            \
+        return;                                                             \
+    }                                                                       \
+    upipe_input_chain(s->FIRST_INNER, urefs, upump_p);                      \
+}                                                                           \
 /** @internal @This stores the first inner pipe, while releasing the        \
  * previous one, and registers requests.                                    \
  *                                                                          \
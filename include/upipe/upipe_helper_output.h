@@ -66,6 +66,14 @@ enum upipe_helper_output_state {
  * of sending the flow definition if necessary.
  *
  * @item @code
+ *  void upipe_foo_output_chain(struct upipe *upipe, struct uchain *urefs,
+ *                              struct upump **upump_p)
+ * @end code
+ * Called to send a list of packets to your output at once, for instance
+ * all the packets produced while processing a single input. The list is
+ * empty upon return.
+ *
+ * @item @code
  *  int upipe_foo_register_output_request(struct upipe *upipe,
  *                                        struct urequest *urequest)
  * @end code
@@ -179,36 +187,29 @@ static void STRUCTURE##_init_output(struct upipe *upipe)                    \
     s->OUTPUT_STATE = UPIPE_HELPER_OUTPUT_NONE;                             \
     ulist_init(&s->REQUEST_LIST);                                           \
 }                                                                           \
-/** @internal @This sends a uref to the output. Note that uref is then      \
- * owned by the callee and shouldn't be used any longer.                    \
+/** @internal @This makes sure the flow definition was accepted by the     \
+ * output, before sending urefs to it.                                      \
  *                                                                          \
  * @param upipe description structure of the pipe                           \
- * @param uref uref structure to send (may be NULL)                         \
- * @param upump_p reference to pump that generated the buffer               \
+ * @return false if urefs must be dropped                                   \
  */                                                                         \
-static UBASE_UNUSED void STRUCTURE##_output(struct upipe *upipe,            \
-                                            struct uref *uref,              \
-                                            struct upump **upump_p)         \
+static UBASE_UNUSED bool STRUCTURE##_check_output(struct upipe *upipe)      \
 {                                                                           \
     struct STRUCTURE *s = STRUCTURE##_from_upipe(upipe);                    \
     if (unlikely(s->FLOW_DEF == NULL)) {                                    \
         upipe_warn(upipe, "no flow def, dropping uref");                    \
-        uref_free(uref);                                                    \
-        return;                                                             \
+        return false;                                                       \
     }                                                                       \
     if (unlikely(s->OUTPUT == NULL))                                        \
         upipe_throw_need_output(upipe, s->FLOW_DEF);                        \
-    if (unlikely(s->OUTPUT == NULL)) {                                      \
-        uref_free(uref);                                                    \
-        return;                                                             \
-    }                                                                       \
+    if (unlikely(s->OUTPUT == NULL))                                        \
+        return false;                                                       \
                                                                             \
     bool already_retried = false;                                           \
     for ( ; ; ) {                                                           \
         if (unlikely(s->FLOW_DEF == NULL)) {                                \
             upipe_warn(upipe, "no flow def, dropping uref");                \
-            uref_free(uref);                                                \
-            return;                                                         \
+            return false;                                                   \
         }                                                                   \
         switch (s->OUTPUT_STATE) {                                          \
             case UPIPE_HELPER_OUTPUT_NONE: {                                \
@@ -231,17 +232,56 @@ static UBASE_UNUSED void STRUCTURE##_output(struct upipe *upipe,            \
             }                                                               \
                                                                             \
             case UPIPE_HELPER_OUTPUT_VALID:                                 \
-                if (uref != NULL)                                           \
-                    upipe_input(s->OUTPUT, uref, upump_p);                  \
-                return;                                                     \
+                return true;                                                \
                                                                             \
             case UPIPE_HELPER_OUTPUT_INVALID:                               \
                 upipe_warn(upipe, "invalid output, dropping uref");         \
-                uref_free(uref);                                            \
-                return;                                                     \
+                return false;                                               \
         }                                                                   \
     }                                                                       \
 }                                                                           \
+/** @internal @This sends a uref to the output. Note that uref is then      \
+ * owned by the callee and shouldn't be used any longer.                    \
+ *                                                                          \
+ * @param upipe description structure of the pipe                           \
+ * @param uref uref structure to send (may be NULL)                         \
+ * @param upump_p reference to pump that generated the buffer               \
+ */                                                                         \
+static UBASE_UNUSED void STRUCTURE##_output(struct upipe *upipe,            \
+                                            struct uref *uref,              \
+                                            struct upump **upump_p)         \
+{                                                                           \
+    struct STRUCTURE *s = STRUCTURE##_from_upipe(upipe);                    \
+    if (unlikely(!STRUCTURE##_check_output(upipe))) {                       \
+        uref_free(uref);                                                    \
+        return;                                                             \
+    }                                                                       \
+    if (uref != NULL)                                                       \
+        upipe_input(s->OUTPUT, uref, upump_p);                              \
+}                                                                           \
+/** @internal @This sends a list of urefs, chained by their uchain member,  \
+ * to the output in a single call. The urefs are then owned by the callee   \
+ * and the list is empty upon return.                                       \
+ *                                                                          \
+ * @param upipe description structure of the pipe                           \
+ * @param urefs list of urefs to send                                       \
+ * @param upump_p reference to pump that generated the buffers              \
+ */                                                                         \
+static UBASE_UNUSED void STRUCTURE##_output_chain(struct upipe *upipe,      \
+                                                  struct uchain *urefs,     \
+                                                  struct upump **upump_p)   \
+{                                                                           \
+    struct STRUCTURE *s = STRUCTURE##_from_upipe(upipe);                    \
+    if (ulist_empty(urefs))                                                 \
+        return;                                                             \
+    if (unlikely(!STRUCTURE##_check_output(upipe))) {                       \
+        struct uchain *uchain;                                              \
+        while ((uchain = ulist_pop(urefs)) != NULL)                         \
+            uref_free(uref_from_uchain(uchain));                            \
+        return;                                                             \
+    }                                                                       \
+    upipe_input_chain(s->OUTPUT, urefs, upump_p);                           \
+}                                                                           \
 /** @internal @This registers a request to be forwarded downstream. The     \
  * request will be replayed if the output changes. If there is no output,   \
  * the request will be sent via a probe.                                    \
@@ -7,7 +7,7 @@
  */
 
 /** @file
- * @short Upipe pool of buffers, based on @ref ulifo
+ * @short Upipe pool of buffers, based on @ref ulifo and per-thread caches
  */
 
 #ifndef _UPIPE_UPOOL_H_
@@ -20,6 +20,10 @@ extern "C" {
 #include "upipe/ubase.h"
 #include "upipe/urefcount.h"
 #include "upipe/ulifo.h"
+#include "upipe/uatomic.h"
+
+#include <stdint.h>
+#include <string.h>
 
 /** @hidden */
 struct upool;
@@ -29,6 +33,60 @@ typedef void *(*upool_alloc_cb)(struct upool *);
 /** @This is a call-back to release unused elements */
 typedef void (*upool_free_cb)(struct upool *, void *);
 
+/** number of per-thread caches in front of the shared LIFO */
+#define UPOOL_CACHES 8
+/** maximum number of elements in a per-thread cache */
+#define UPOOL_CACHE_SIZE 16
+
+/** @This is the address of a thread-local variable, used to identify the
+ * calling thread. */
+extern __thread uint8_t upool_thread;
+
+/** @This registers the calling thread so that the caches it claims are
+ * released when it exits.
+ */
+void upool_thread_claim(void);
+
+/** @This registers a upool with per-thread caches, so that exiting threads
+ * can release their caches.
+ *
+ * @param upool pointer to a upool structure
+ */
+void upool_register(struct upool *upool);
+
+/** @This unregisters a upool with per-thread caches.
+ *
+ * @param upool pointer to a upool structure
+ */
+void upool_unregister(struct upool *upool);
+
+/** @This stores statistics of a upool. */
+struct upool_stats {
+    /** number of allocations served from the pool */
+    uint64_t hits;
+    /** number of allocations which had to call the allocation call-back */
+    uint64_t misses;
+    /** number of elements released by a thread that did not allocate them */
+    uint64_t cross_frees;
+};
+
+/** @This is a per-thread cache of elements. It is only accessed by the
+ * thread owning it, except when the pool is cleaned. */
+struct upool_cache {
+    /** thread owning the cache, or NULL */
+    uatomic_ptr_t owner;
+    /** number of elements in the cache */
+    unsigned int count;
+    /** vacuum generation of the pool last seen by the owner */
+    uint32_t vacuum;
+    /** number of allocations minus number of releases by the owner */
+    int64_t balance;
+    /** statistics of the owner */
+    struct upool_stats stats;
+    /** cached elements, the most recent last */
+    void *elems[UPOOL_CACHE_SIZE];
+};
+
 /** @This is the implementation of a pool of buffers. */
 struct upool {
     /** pointer to refcount management structure */
@@ -39,16 +97,62 @@ struct upool {
     upool_alloc_cb alloc_cb;
     /** call-back to release unused elements */
     upool_free_cb free_cb;
+
+    /** per-thread caches, or NULL */
+    struct upool_cache *caches;
+    /** maximum number of elements in a per-thread cache */
+    unsigned int cache_size;
+    /** incremented by @ref upool_vacuum to have the owners empty their
+     * caches */
+    uatomic_uint32_t vacuum;
+    /** structure for the list of pools with caches */
+    struct uchain uchain;
+    /** number of hits of the threads without a cache, low 32 bits */
+    uatomic_uint32_t hits;
+    /** number of hits of the threads without a cache, high 32 bits */
+    uatomic_uint32_t hits_high;
+    /** number of misses of the threads without a cache, low 32 bits */
+    uatomic_uint32_t misses;
+    /** number of misses of the threads without a cache, high 32 bits */
+    uatomic_uint32_t misses_high;
 };
 
+UBASE_FROM_TO(upool, uchain, uchain, uchain)
+
+/** @This returns the number of elements in a per-thread cache of a upool.
+ * The caches may hold at most half of the elements of the pool, so small
+ * pools have no cache.
+ *
+ * @param length maximum number of elements in the pool
+ * @return maximum number of elements in a per-thread cache
+ */
+#define upool_cache_size(length)                                            \
+    ((length) / (2 * UPOOL_CACHES) < UPOOL_CACHE_SIZE ?                     \
+     (length) / (2 * UPOOL_CACHES) : UPOOL_CACHE_SIZE)
+
+/** @This returns the number of elements in the shared LIFO of a upool,
+ * which is the depth of the pool minus the capacity of the caches.
+ *
+ * @param length maximum number of elements in the pool
+ * @return maximum number of elements in the LIFO
+ */
+#define upool_lifo_length(length)                                           \
+    ((length) - UPOOL_CACHES * upool_cache_size(length))
+
 /** @This returns the required size of extra data space for upool.
  *
- * @param length maximum number of elements in the LIFO
+ * @param length maximum number of elements in the pool
  * @return size in octets to allocate
  */
-#define upool_sizeof(length) ulifo_sizeof(length)
+#define upool_sizeof(length)                                                \
+    (ulifo_sizeof(upool_lifo_length(length)) +                              \
+     (upool_cache_size(length) ? UPOOL_CACHES * sizeof(struct upool_cache)  \
+                               : 0))
 
-/** @This initializes a upool.
+/** @This initializes a upool. Each thread also keeps up to
+ * @ref upool_cache_size elements in a private cache, which is refilled from
+ * and drained to the shared LIFO in batches. The caches and the LIFO
+ * together hold at most length elements.
  *
  * @param upool pointer to a upool structure
  * @param refcount pointer to refcount management structure
@@ -61,9 +165,33 @@ static inline void upool_init(struct upool *upool, struct urefcount *refcount,
                               upool_alloc_cb alloc_cb, upool_free_cb free_cb)
 {
     upool->refcount = refcount;
-    ulifo_init(&upool->lifo, length, extra);
     upool->alloc_cb = alloc_cb;
     upool->free_cb = free_cb;
+    upool->caches = NULL;
+    upool->cache_size = upool_cache_size(length);
+    uatomic_init(&upool->vacuum, 0);
+    uchain_init(&upool->uchain);
+    uatomic_init(&upool->hits, 0);
+    uatomic_init(&upool->hits_high, 0);
+    uatomic_init(&upool->misses, 0);
+    uatomic_init(&upool->misses_high, 0);
+
+    if (upool->cache_size) {
+        upool->caches = (struct upool_cache *)extra;
+        for (unsigned int i = 0; i < UPOOL_CACHES; i++) {
+            struct upool_cache *cache = &upool->caches[i];
+            uatomic_ptr_init(&cache->owner, NULL);
+            cache->count = 0;
+            cache->vacuum = 0;
+            cache->balance = 0;
+            cache->stats.hits = 0;
+            cache->stats.misses = 0;
+            cache->stats.cross_frees = 0;
+        }
+        extra = (uint8_t *)extra + UPOOL_CACHES * sizeof(struct upool_cache);
+        upool_register(upool);
+    }
+    ulifo_init(&upool->lifo, upool_lifo_length(length), extra);
 }
 
 /** @This increments the reference count of a upool.
@@ -89,6 +217,99 @@ static inline void upool_release(struct upool *upool)
         urefcount_release(upool->refcount);
 }
 
+/** @internal @This moves the oldest elements of a cache to the shared LIFO,
+ * or releases them if it is full.
+ *
+ * @param upool pointer to a upool structure
+ * @param cache pointer to the cache
+ * @param nb number of elements to move
+ */
+static inline void upool_cache_drain(struct upool *upool,
+                                     struct upool_cache *cache,
+                                     unsigned int nb)
+{
+    if (nb > cache->count)
+        nb = cache->count;
+    for (unsigned int i = 0; i < nb; i++)
+        if (unlikely(!ulifo_push(&upool->lifo, cache->elems[i])))
+            upool->free_cb(upool, cache->elems[i]);
+    cache->count -= nb;
+    memmove(cache->elems, cache->elems + nb, cache->count * sizeof(void *));
+}
+
+/** @internal @This releases all the elements of a cache.
+ *
+ * @param upool pointer to a upool structure
+ * @param cache pointer to the cache
+ */
+static inline void upool_cache_vacuum(struct upool *upool,
+                                      struct upool_cache *cache)
+{
+    while (cache->count)
+        upool->free_cb(upool, cache->elems[--cache->count]);
+}
+
+/** @internal @This returns the cache of the calling thread, claiming a free
+ * one if needed. The cache is released when the thread exits.
+ *
+ * @param upool pointer to a upool structure
+ * @return pointer to the cache, or NULL if all caches are taken
+ */
+static inline struct upool_cache *upool_cache_get(struct upool *upool)
+{
+    if (upool->caches == NULL)
+        return NULL;
+
+    void *self = &upool_thread;
+    unsigned int hash = (uint64_t)(uintptr_t)self *
+                        UINT64_C(0x9e3779b97f4a7c15) >> 56;
+    for (unsigned int i = 0; i < UPOOL_CACHES; i++) {
+        struct upool_cache *cache =
+            &upool->caches[(hash + i) % UPOOL_CACHES];
+        void *owner = uatomic_ptr_load(&cache->owner);
+        if (likely(owner == self)) {
+            uint32_t vacuum = uatomic_load(&upool->vacuum);
+            if (unlikely(cache->vacuum != vacuum)) {
+                upool_cache_vacuum(upool, cache);
+                cache->vacuum = vacuum;
+            }
+            return cache;
+        }
+        if (owner == NULL &&
+            uatomic_ptr_compare_exchange(&cache->owner, &owner, self)) {
+            upool_thread_claim();
+            cache->vacuum = uatomic_load(&upool->vacuum);
+            return cache;
+        }
+    }
+    return NULL;
+}
+
+/** @internal @This increments a 64-bit counter made of two uatomic
+ * variables.
+ *
+ * @param low pointer to the low 32 bits
+ * @param high pointer to the high 32 bits
+ */
+static inline void upool_count(uatomic_uint32_t *low, uatomic_uint32_t *high)
+{
+    if (unlikely(uatomic_fetch_add(low, 1) == UINT32_MAX))
+        uatomic_fetch_add(high, 1);
+}
+
+/** @internal @This returns the value of a 64-bit counter made of two uatomic
+ * variables.
+ *
+ * @param low pointer to the low 32 bits
+ * @param high pointer to the high 32 bits
+ * @return approximate value of the counter
+ */
+static inline uint64_t upool_count_load(uatomic_uint32_t *low,
+                                        uatomic_uint32_t *high)
+{
+    return ((uint64_t)uatomic_load(high) << 32) + uatomic_load(low);
+}
+
 /** @internal @This allocates an elements from the upool.
  *
  * @param upool pointer to a upool structure
@@ -96,9 +317,36 @@ static inline void upool_release(struct upool *upool)
  */
 static inline void *upool_alloc_internal(struct upool *upool)
 {
-    void *obj = ulifo_pop(&upool->lifo, void *);
-    if (unlikely(obj == NULL))
-        obj = upool->alloc_cb(upool);
+    struct upool_cache *cache = upool_cache_get(upool);
+    void *obj;
+
+    if (likely(cache != NULL)) {
+        if (unlikely(!cache->count)) {
+            /* refill half of the cache */
+            unsigned int nb = (upool->cache_size + 1) / 2;
+            while (cache->count < nb &&
+                   (obj = ulifo_pop(&upool->lifo, void *)) != NULL)
+                cache->elems[cache->count++] = obj;
+        }
+        if (likely(cache->count)) {
+            obj = cache->elems[--cache->count];
+            cache->stats.hits++;
+        } else {
+            obj = upool->alloc_cb(upool);
+            cache->stats.misses++;
+        }
+        if (obj != NULL)
+            cache->balance++;
+    } else {
+        obj = ulifo_pop(&upool->lifo, void *);
+        if (obj != NULL)
+            upool_count(&upool->hits, &upool->hits_high);
+        else {
+            obj = upool->alloc_cb(upool);
+            upool_count(&upool->misses, &upool->misses_high);
+        }
+    }
+
     if (obj != NULL)
         upool_use(upool);
     return obj;
@@ -119,30 +367,97 @@ static inline void *upool_alloc_internal(struct upool *upool)
  */
 static inline void upool_free(struct upool *upool, void *obj)
 {
-    if (unlikely(!ulifo_push(&upool->lifo, obj)))
+    struct upool_cache *cache = upool_cache_get(upool);
+
+    if (likely(cache != NULL)) {
+        /* more releases than allocations: it comes from another thread */
+        if (cache->balance <= 0)
+            cache->stats.cross_frees++;
+        cache->balance--;
+        if (unlikely(cache->count >= upool->cache_size))
+            upool_cache_drain(upool, cache, (upool->cache_size + 1) / 2);
+        cache->elems[cache->count++] = obj;
+    } else if (unlikely(!ulifo_push(&upool->lifo, obj)))
         upool->free_cb(upool, obj);
     upool_release(upool);
 }
 
-/** @This empties a upool.
+/** @This empties a upool. The shared LIFO, the unclaimed caches and the
+ * cache of the calling thread are emptied immediately; the caches of other
+ * threads are emptied by their owners on their next access to the pool.
  *
  * @param upool pointer to a upool structure
  */
 static inline void upool_vacuum(struct upool *upool)
 {
+    if (upool->caches != NULL) {
+        void *self = &upool_thread;
+        uatomic_fetch_add(&upool->vacuum, 1);
+        for (unsigned int i = 0; i < UPOOL_CACHES; i++) {
+            struct upool_cache *cache = &upool->caches[i];
+            void *owner = NULL;
+            /* lock unclaimed caches with the address of the pool */
+            if (uatomic_ptr_compare_exchange(&cache->owner, &owner, upool)) {
+                upool_cache_vacuum(upool, cache);
+                uatomic_ptr_store(&cache->owner, NULL);
+            } else if (owner == self) {
+                upool_cache_vacuum(upool, cache);
+                cache->vacuum = uatomic_load(&upool->vacuum);
+            }
+        }
+    }
+
     void *obj;
     while ((obj = ulifo_pop(&upool->lifo, void *)) != NULL)
         upool->free_cb(upool, obj);
 }
 
+/** @This adds the statistics of a upool to the given structure, which must
+ * be initialized by the caller. The counters of other threads are read
+ * without synchronization, so the result is approximate.
+ *
+ * @param upool pointer to a upool structure
+ * @param stats filled in with the statistics
+ */
+static inline void upool_add_stats(struct upool *upool,
+                                   struct upool_stats *stats)
+{
+    stats->hits += upool_count_load(&upool->hits, &upool->hits_high);
+    stats->misses += upool_count_load(&upool->misses, &upool->misses_high);
+    if (upool->caches == NULL)
+        return;
+    for (unsigned int i = 0; i < UPOOL_CACHES; i++) {
+        struct upool_cache *cache = &upool->caches[i];
+        stats->hits += cache->stats.hits;
+        stats->misses += cache->stats.misses;
+        stats->cross_frees += cache->stats.cross_frees;
+    }
+}
+
 /** @This empties and cleans up a upool.
  *
  * @param upool pointer to a upool structure
  */
 static inline void upool_clean(struct upool *upool)
 {
-    upool_vacuum(upool);
+    if (upool->caches != NULL) {
+        upool_unregister(upool);
+        for (unsigned int i = 0; i < UPOOL_CACHES; i++) {
+            struct upool_cache *cache = &upool->caches[i];
+            upool_cache_vacuum(upool, cache);
+            uatomic_ptr_clean(&cache->owner);
+        }
+    }
+
+    void *obj;
+    while ((obj = ulifo_pop(&upool->lifo, void *)) != NULL)
+        upool->free_cb(upool, obj);
     ulifo_clean(&upool->lifo);
+    uatomic_clean(&upool->vacuum);
+    uatomic_clean(&upool->hits);
+    uatomic_clean(&upool->hits_high);
+    uatomic_clean(&upool->misses);
+    uatomic_clean(&upool->misses_high);
 }
 
 #ifdef __cplusplus
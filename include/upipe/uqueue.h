@@ -8,6 +8,14 @@
 
 /** @file
  * @short Upipe thread-safe queue of elements
+ *
+ * A queue may also be initialized in single-producer single-consumer mode
+ * with @ref uqueue_init_spsc, for links where only one thread pushes and
+ * only one thread pops. In that mode the elements are stored in a
+ * cache-line-padded ring of up to 2^31 elements, and the consumer busy-polls
+ * for a configurable number of iterations before going to sleep on the
+ * event, so that a busy link does not cost a system call and a wake-up per
+ * burst.
  */
 
 #ifndef _UPIPE_UQUEUE_H_
@@ -27,6 +35,45 @@ extern "C" {
 #include <stdint.h>
 #include <assert.h>
 
+/** size of the cache line the fields of the SPSC ring are padded to */
+#define UQUEUE_CACHE_LINE 64
+
+/** @This is the implementation of the single-producer single-consumer ring
+ * of a queue. Indices run freely and are masked to address elements. */
+struct uqueue_spsc {
+    /** index of the next element to push, written by the producer */
+    uint32_t head;
+    /** index of the consumer, as last read by the producer */
+    uint32_t tail_cache;
+    /** padding */
+    uint8_t pad_producer[UQUEUE_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+    /** index of the next element to pop, written by the consumer */
+    uint32_t tail;
+    /** index of the producer, as last read by the consumer */
+    uint32_t head_cache;
+    /** padding */
+    uint8_t pad_consumer[UQUEUE_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+    /** set when the consumer sleeps on the pop event */
+    uint32_t pop_waiting;
+    /** set when the producer sleeps on the push event */
+    uint32_t push_waiting;
+    /** padding */
+    uint8_t pad_waiting[UQUEUE_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+    /** mask applied to indices */
+    uint32_t mask;
+    /** number of busy-polling iterations before sleeping */
+    unsigned int spin;
+    /** padding */
+    uint8_t pad_ro[UQUEUE_CACHE_LINE - sizeof(uint32_t) -
+                   sizeof(unsigned int)];
+
+    /** elements */
+    void *elements[];
+};
+
 /** @This is the implementation of a queue. */
 struct uqueue {
     /** FIFO */
@@ -39,6 +86,8 @@ struct uqueue {
     struct ueventfd event_push;
     /** ueventfd triggered when data can be popped */
     struct ueventfd event_pop;
+    /** single-producer single-consumer ring, or NULL */
+    struct uqueue_spsc *spsc;
 };
 
 /** @This returns the required size of extra data space for uqueue.
@@ -69,6 +118,71 @@ static inline bool uqueue_init(struct uqueue *uqueue, uint8_t length,
     ufifo_init(&uqueue->fifo, length, extra);
     uatomic_init(&uqueue->counter, 0);
     uqueue->length = length;
+    uqueue->spsc = NULL;
+    return true;
+}
+
+/** @internal @This returns the number of elements of the SPSC ring.
+ *
+ * @param length maximum number of elements in the queue
+ * @return number of elements of the ring (power of 2)
+ */
+static inline uint32_t uqueue_spsc_elements(uint32_t length)
+{
+    uint32_t elements = 1;
+    while (elements < length)
+        elements <<= 1;
+    return elements;
+}
+
+/** @This returns the required size of extra data space for a uqueue in
+ * single-producer single-consumer mode.
+ *
+ * @param length maximum number of elements in the queue
+ * @return size in octets to allocate
+ */
+static inline size_t uqueue_spsc_sizeof(uint32_t length)
+{
+    return sizeof(struct uqueue_spsc) + UQUEUE_CACHE_LINE - 1 +
+           uqueue_spsc_elements(length) * sizeof(void *);
+}
+
+/** @This initializes a uqueue in single-producer single-consumer mode. Only
+ * one thread at a time may push elements, and only one thread at a time may
+ * pop them.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param length maximum number of elements in the queue (max 2^31)
+ * @param spin number of busy-polling iterations of the consumer before it
+ * goes to sleep, when the queue is empty
+ * @param extra mandatory extra space allocated by the caller, with the size
+ * returned by @ref #uqueue_spsc_sizeof
+ * @return false in case of failure
+ */
+static inline bool uqueue_init_spsc(struct uqueue *uqueue, uint32_t length,
+                                    unsigned int spin, void *extra)
+{
+    if (unlikely(!length || length > UINT32_C(1) << 31))
+        return false;
+    if (unlikely(!ueventfd_init(&uqueue->event_push, true)))
+        return false;
+    if (unlikely(!ueventfd_init(&uqueue->event_pop, false))) {
+        ueventfd_clean(&uqueue->event_push);
+        return false;
+    }
+
+    struct uqueue_spsc *spsc = (struct uqueue_spsc *)
+        (((uintptr_t)extra + UQUEUE_CACHE_LINE - 1) &
+         ~(uintptr_t)(UQUEUE_CACHE_LINE - 1));
+    spsc->head = spsc->tail_cache = 0;
+    spsc->tail = spsc->head_cache = 0;
+    /* the pop event is not triggered until something is pushed */
+    spsc->pop_waiting = 1;
+    spsc->push_waiting = 0;
+    spsc->mask = uqueue_spsc_elements(length) - 1;
+    spsc->spin = spin;
+    uqueue->length = length;
+    uqueue->spsc = spsc;
     return true;
 }
 
@@ -110,6 +224,155 @@ static inline struct upump *uqueue_upump_alloc_pop(struct uqueue *uqueue,
                                 refcount);
 }
 
+/** @internal @This pushes an element into the SPSC ring.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param element pointer to element to push
+ * @return false if the ring is full
+ */
+static inline bool uqueue_spsc_push(struct uqueue *uqueue, void *element)
+{
+    struct uqueue_spsc *spsc = uqueue->spsc;
+    uint32_t head = __atomic_load_n(&spsc->head, __ATOMIC_RELAXED);
+    if (unlikely(head - spsc->tail_cache >= uqueue->length)) {
+        spsc->tail_cache = __atomic_load_n(&spsc->tail, __ATOMIC_ACQUIRE);
+        if (head - spsc->tail_cache >= uqueue->length)
+            return false;
+    }
+    spsc->elements[head & spsc->mask] = element;
+    __atomic_store_n(&spsc->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/** @internal @This pushes elements into the SPSC ring, publishing them at
+ * once.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements elements to push
+ * @param nb number of elements to push
+ * @return number of pushed elements, less than nb if the ring is full
+ */
+static inline unsigned int uqueue_spsc_push_batch(struct uqueue *uqueue,
+                                                  void **elements,
+                                                  unsigned int nb)
+{
+    struct uqueue_spsc *spsc = uqueue->spsc;
+    uint32_t head = __atomic_load_n(&spsc->head, __ATOMIC_RELAXED);
+    uint32_t room = uqueue->length - (head - spsc->tail_cache);
+    if (unlikely(room < nb)) {
+        spsc->tail_cache = __atomic_load_n(&spsc->tail, __ATOMIC_ACQUIRE);
+        room = uqueue->length - (head - spsc->tail_cache);
+        if (room < nb)
+            nb = room;
+    }
+    for (uint32_t i = 0; i < nb; i++)
+        spsc->elements[(head + i) & spsc->mask] = elements[i];
+    __atomic_store_n(&spsc->head, head + nb, __ATOMIC_RELEASE);
+    return nb;
+}
+
+/** @internal @This pops elements from the SPSC ring.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements filled in with the popped elements
+ * @param max maximum number of elements to pop
+ * @return number of popped elements
+ */
+static inline unsigned int uqueue_spsc_pop(struct uqueue *uqueue,
+                                           void **elements, unsigned int max)
+{
+    struct uqueue_spsc *spsc = uqueue->spsc;
+    uint32_t tail = __atomic_load_n(&spsc->tail, __ATOMIC_RELAXED);
+    uint32_t nb = spsc->head_cache - tail;
+    if (nb == 0) {
+        spsc->head_cache = __atomic_load_n(&spsc->head, __ATOMIC_ACQUIRE);
+        nb = spsc->head_cache - tail;
+        if (nb == 0)
+            return 0;
+    }
+    if (nb > max)
+        nb = max;
+    for (uint32_t i = 0; i < nb; i++)
+        elements[i] = spsc->elements[(tail + i) & spsc->mask];
+    __atomic_store_n(&spsc->tail, tail + nb, __ATOMIC_RELEASE);
+
+    /* wake up the producer if it waits for room */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (unlikely(__atomic_load_n(&spsc->push_waiting, __ATOMIC_RELAXED)) &&
+        __atomic_exchange_n(&spsc->push_waiting, 0, __ATOMIC_SEQ_CST))
+        ueventfd_write(&uqueue->event_push);
+    return nb;
+}
+
+/** @internal @This pushes an element into a queue in single-producer
+ * single-consumer mode.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param element pointer to element to push
+ * @return false if the queue is full and the element couldn't be queued
+ */
+static inline bool uqueue_push_spsc(struct uqueue *uqueue, void *element)
+{
+    struct uqueue_spsc *spsc = uqueue->spsc;
+    if (unlikely(!uqueue_spsc_push(uqueue, element))) {
+        /* signal that we are full */
+        ueventfd_read(&uqueue->event_push);
+        __atomic_store_n(&spsc->push_waiting, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        /* double-check */
+        if (likely(!uqueue_spsc_push(uqueue, element)))
+            return false;
+
+        /* signal that we're alright again, unless the consumer did */
+        if (__atomic_exchange_n(&spsc->push_waiting, 0, __ATOMIC_SEQ_CST))
+            ueventfd_write(&uqueue->event_push);
+    }
+
+    /* wake up the consumer if it sleeps */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (unlikely(__atomic_load_n(&spsc->pop_waiting, __ATOMIC_RELAXED)) &&
+        __atomic_exchange_n(&spsc->pop_waiting, 0, __ATOMIC_SEQ_CST))
+        ueventfd_write(&uqueue->event_pop);
+    return true;
+}
+
+/** @internal @This pops elements from a queue in single-producer
+ * single-consumer mode, busy-polling for a while if it is empty.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements filled in with the popped elements
+ * @param max maximum number of elements to pop
+ * @return number of popped elements
+ */
+static inline unsigned int uqueue_pop_spsc(struct uqueue *uqueue,
+                                           void **elements, unsigned int max)
+{
+    struct uqueue_spsc *spsc = uqueue->spsc;
+    unsigned int nb = uqueue_spsc_pop(uqueue, elements, max);
+    for (unsigned int i = 0; !nb && i < spsc->spin; i++) {
+        uatomic_relax();
+        nb = uqueue_spsc_pop(uqueue, elements, max);
+    }
+    if (likely(nb))
+        return nb;
+
+    /* signal that we starve */
+    ueventfd_read(&uqueue->event_pop);
+    __atomic_store_n(&spsc->pop_waiting, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    /* double-check */
+    nb = uqueue_spsc_pop(uqueue, elements, max);
+    if (likely(!nb))
+        return 0;
+
+    /* signal that we're alright again, unless the producer did */
+    if (__atomic_exchange_n(&spsc->pop_waiting, 0, __ATOMIC_SEQ_CST))
+        ueventfd_write(&uqueue->event_pop);
+    return nb;
+}
+
 /** @This pushes an element into the queue.
  *
  * @param uqueue pointer to a uqueue structure
@@ -118,6 +381,9 @@ static inline struct upump *uqueue_upump_alloc_pop(struct uqueue *uqueue,
  */
 static inline bool uqueue_push(struct uqueue *uqueue, void *element)
 {
+    if (uqueue->spsc != NULL)
+        return uqueue_push_spsc(uqueue, element);
+
     if (unlikely(!ufifo_push(&uqueue->fifo, element))) {
         /* signal that we are full */
         ueventfd_read(&uqueue->event_push);
@@ -135,6 +401,40 @@ static inline bool uqueue_push(struct uqueue *uqueue, void *element)
     return true;
 }
 
+/** @This pushes elements into the queue, and wakes up the consumer at most
+ * once. When the queue is full, the elements that could not be pushed are
+ * left to the caller, which may then wait with @ref uqueue_push.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements elements to push
+ * @param nb number of elements to push
+ * @return number of pushed elements
+ */
+static inline unsigned int uqueue_push_batch(struct uqueue *uqueue,
+                                             void **elements, unsigned int nb)
+{
+    if (uqueue->spsc != NULL) {
+        struct uqueue_spsc *spsc = uqueue->spsc;
+        nb = uqueue_spsc_push_batch(uqueue, elements, nb);
+        if (unlikely(!nb))
+            return 0;
+
+        /* wake up the consumer if it sleeps */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (unlikely(__atomic_load_n(&spsc->pop_waiting, __ATOMIC_RELAXED)) &&
+            __atomic_exchange_n(&spsc->pop_waiting, 0, __ATOMIC_SEQ_CST))
+            ueventfd_write(&uqueue->event_pop);
+        return nb;
+    }
+
+    unsigned int pushed = 0;
+    while (pushed < nb && ufifo_push(&uqueue->fifo, elements[pushed]))
+        pushed++;
+    if (pushed && unlikely(uatomic_fetch_add(&uqueue->counter, pushed) == 0))
+        ueventfd_write(&uqueue->event_pop);
+    return pushed;
+}
+
 /** @internal @This pops an element from the queue.
  *
  * @param uqueue pointer to a uqueue structure
@@ -142,7 +442,11 @@ static inline bool uqueue_push(struct uqueue *uqueue, void *element)
  */
 static inline void *uqueue_pop_internal(struct uqueue *uqueue)
 {
-    void *element = ufifo_pop(&uqueue->fifo, void *);
+    void *element;
+    if (uqueue->spsc != NULL)
+        return uqueue_pop_spsc(uqueue, &element, 1) ? element : NULL;
+
+    element = ufifo_pop(&uqueue->fifo, void *);
     if (unlikely(element == NULL)) {
         /* signal that we starve */
         ueventfd_read(&uqueue->event_pop);
@@ -169,12 +473,37 @@ static inline void *uqueue_pop_internal(struct uqueue *uqueue)
  */
 #define uqueue_pop(uqueue, type) (type)uqueue_pop_internal(uqueue)
 
+/** @This pops up to a number of elements from the queue. In
+ * single-producer single-consumer mode, they are popped at once.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements filled in with the popped elements
+ * @param max maximum number of elements to pop
+ * @return number of popped elements
+ */
+static inline unsigned int uqueue_pop_batch(struct uqueue *uqueue,
+                                            void **elements, unsigned int max)
+{
+    if (uqueue->spsc != NULL)
+        return uqueue_pop_spsc(uqueue, elements, max);
+
+    unsigned int nb = 0;
+    while (nb < max &&
+           (elements[nb] = uqueue_pop_internal(uqueue)) != NULL)
+        nb++;
+    return nb;
+}
+
 /** @This returns the number of elements in the queue.
  *
  * @param uqueue pointer to a uqueue structure
  */
 static inline unsigned int uqueue_length(struct uqueue *uqueue)
 {
+    if (uqueue->spsc != NULL) {
+        uint32_t tail = __atomic_load_n(&uqueue->spsc->tail, __ATOMIC_ACQUIRE);
+        return __atomic_load_n(&uqueue->spsc->head, __ATOMIC_ACQUIRE) - tail;
+    }
     return uatomic_load(&uqueue->counter);
 }
 
@@ -185,8 +514,10 @@ static inline unsigned int uqueue_length(struct uqueue *uqueue)
  */
 static inline void uqueue_clean(struct uqueue *uqueue)
 {
-    uatomic_clean(&uqueue->counter);
-    ufifo_clean(&uqueue->fifo);
+    if (uqueue->spsc == NULL) {
+        uatomic_clean(&uqueue->counter);
+        ufifo_clean(&uqueue->fifo);
+    }
     ueventfd_clean(&uqueue->event_push);
     ueventfd_clean(&uqueue->event_pop);
 }
@@ -28,6 +28,8 @@ extern "C" {
 
 /** @hidden */
 struct uref_mgr;
+/** @hidden */
+struct upool_stats;
 
 /** @This defines the type of the date. */
 enum uref_date_type {
@@ -120,6 +122,8 @@ UBASE_FROM_TO(uref, uchain, uchain, uchain)
 enum uref_mgr_command {
     /** release all buffers kept in pools (void) */
     UREF_MGR_VACUUM,
+    /** add the statistics of the pools (struct upool_stats *) */
+    UREF_MGR_GET_STATS,
 
     /** non-standard manager commands implemented by a module type can start
      * from there (first arg = signature) */
@@ -404,6 +408,19 @@ static inline int uref_mgr_vacuum(struct uref_mgr *mgr)
     return uref_mgr_control(mgr, UREF_MGR_VACUUM);
 }
 
+/** @This adds the statistics of the pools of an existing uref manager to the
+ * given structure, which must be initialized by the caller.
+ *
+ * @param mgr pointer to uref manager
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static inline int uref_mgr_get_stats(struct uref_mgr *mgr,
+                                     struct upool_stats *stats)
+{
+    return uref_mgr_control(mgr, UREF_MGR_GET_STATS, stats);
+}
+
 #ifdef __cplusplus
 }
 #endif
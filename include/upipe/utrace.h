@@ -84,6 +84,9 @@ void utrace_ulog_add_prefix(struct ulog *ulog, struct ulog_pfx *prefix);
 
 void utrace_dump_graph(const char *name);
 
+/* write the per-thread rings to the file given by UTRACE_RING */
+void utrace_ring_dump(void);
+
 #else
 
 # define utrace_va_copy(Args)
@@ -121,6 +124,8 @@ void utrace_dump_graph(const char *name);
 
 # define utrace_dump_graph(Name)
 
+# define utrace_ring_dump()
+
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short declarations for a Upipe event loop using io_uring
+ *
+ * Besides the standard pump types, this event loop provides pumps which
+ * submit a read, recv or recvmsg operation directly to the kernel, and
+ * trigger when the data has been copied into the buffer provided by the
+ * caller. No readiness notification or extra system call is then needed
+ * to get the data, and all operations are submitted with a single
+ * io_uring_enter() call per loop iteration.
+ *
+ * The buffer is consumed by a completed operation: the callback retrieves
+ * the result with @ref upump_uring_get_result and provides the next buffer
+ * with @ref upump_uring_set_buffer (or @ref upump_uring_set_msghdr). The
+ * kernel no longer accesses the buffer once the pump is stopped or freed.
+ *
+ * Other event loops do not implement these pump types, so the allocation
+ * functions return NULL and the caller may fall back to a standard
+ * @ref UPUMP_TYPE_FD_READ pump.
+ */
+
+#ifndef _UPUMP_URING_UPUMP_URING_H_
+/** @hidden */
+#define _UPUMP_URING_UPUMP_URING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "upipe/upump.h"
+
+#define UPUMP_URING_SIGNATURE UBASE_FOURCC('u','r','n','g')
+
+/** @hidden */
+struct msghdr;
+
+/** @This extends upump_type with specific types for upump_uring. */
+enum upump_uring_type {
+    UPUMP_URING_TYPE_SENTINEL = UPUMP_TYPE_LOCAL,
+
+    /** event triggers when a read into the provided buffer completes
+     * (int) */
+    UPUMP_URING_TYPE_READ,
+    /** event triggers when a recv into the provided buffer completes
+     * (int) */
+    UPUMP_URING_TYPE_RECV,
+    /** event triggers when a recvmsg with the provided message header
+     * completes (int) */
+    UPUMP_URING_TYPE_RECVMSG,
+};
+
+/** @This extends upump_command with specific commands for upump_uring. */
+enum upump_uring_command {
+    UPUMP_URING_SENTINEL = UPUMP_CONTROL_LOCAL,
+
+    /** sets the buffer of the next read or recv (uint8_t *, size_t,
+     * uint64_t) */
+    UPUMP_URING_SET_BUFFER,
+    /** sets the message header of the next recvmsg (struct msghdr *) */
+    UPUMP_URING_SET_MSGHDR,
+    /** gets the result of the completed operation (ssize_t *) */
+    UPUMP_URING_GET_RESULT,
+};
+
+/** @This allocates and initializes a upump_mgr structure.
+ *
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL if io_uring
+ * is not available
+ */
+struct upump_mgr *upump_uring_mgr_alloc(uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth);
+
+/** @This allocates and initializes a pump reading from a file descriptor.
+ *
+ * @param mgr management structure for this event loop
+ * @param cb function to call when the pump triggers
+ * @param opaque pointer to the module's internal structure
+ * @param refcount pointer to urefcount structure to increment during callback,
+ * or NULL
+ * @param fd file descriptor to read from
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static inline struct upump *upump_uring_alloc_read(struct upump_mgr *mgr,
+                                                   upump_cb cb, void *opaque,
+                                                   struct urefcount *refcount,
+                                                   int fd)
+{
+    return upump_alloc(mgr, cb, opaque, refcount, UPUMP_URING_TYPE_READ,
+                       UPUMP_URING_SIGNATURE, fd);
+}
+
+/** @This allocates and initializes a pump receiving from a socket.
+ *
+ * @param mgr management structure for this event loop
+ * @param cb function to call when the pump triggers
+ * @param opaque pointer to the module's internal structure
+ * @param refcount pointer to urefcount structure to increment during callback,
+ * or NULL
+ * @param fd socket to receive from
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static inline struct upump *upump_uring_alloc_recv(struct upump_mgr *mgr,
+                                                   upump_cb cb, void *opaque,
+                                                   struct urefcount *refcount,
+                                                   int fd)
+{
+    return upump_alloc(mgr, cb, opaque, refcount, UPUMP_URING_TYPE_RECV,
+                       UPUMP_URING_SIGNATURE, fd);
+}
+
+/** @This allocates and initializes a pump receiving messages from a
+ * socket.
+ *
+ * @param mgr management structure for this event loop
+ * @param cb function to call when the pump triggers
+ * @param opaque pointer to the module's internal structure
+ * @param refcount pointer to urefcount structure to increment during callback,
+ * or NULL
+ * @param fd socket to receive from
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static inline struct upump *upump_uring_alloc_recvmsg(struct upump_mgr *mgr,
+        upump_cb cb, void *opaque, struct urefcount *refcount, int fd)
+{
+    return upump_alloc(mgr, cb, opaque, refcount, UPUMP_URING_TYPE_RECVMSG,
+                       UPUMP_URING_SIGNATURE, fd);
+}
+
+/** @This sets the buffer of the next read or recv operation. The operation
+ * is submitted when the pump is started. The buffer must remain valid
+ * until the pump triggers, or is stopped or freed.
+ *
+ * @param upump description structure of the pump
+ * @param buffer buffer to fill in
+ * @param size size of the buffer
+ * @param offset offset to read from, or (uint64_t)-1 to read from the
+ * current position of the file (ignored for recv)
+ * @return an error code
+ */
+static inline int upump_uring_set_buffer(struct upump *upump,
+                                         uint8_t *buffer, size_t size,
+                                         uint64_t offset)
+{
+    return upump_control(upump, UPUMP_URING_SET_BUFFER,
+                         UPUMP_URING_SIGNATURE, buffer, size, offset);
+}
+
+/** @This sets the message header of the next recvmsg operation. The
+ * operation is submitted when the pump is started. The message header and
+ * the buffers it points to must remain valid until the pump triggers, or
+ * is stopped or freed.
+ *
+ * @param upump description structure of the pump
+ * @param msghdr message header to fill in
+ * @return an error code
+ */
+static inline int upump_uring_set_msghdr(struct upump *upump,
+                                         struct msghdr *msghdr)
+{
+    return upump_control(upump, UPUMP_URING_SET_MSGHDR,
+                         UPUMP_URING_SIGNATURE, msghdr);
+}
+
+/** @This gets the result of the completed operation, from the callback of
+ * the pump.
+ *
+ * @param upump description structure of the pump
+ * @param ret_p filled in with the value returned by the operation, as for
+ * the corresponding system call (-1 with errno set in case of error)
+ * @return an error code
+ */
+static inline int upump_uring_get_result(struct upump *upump, ssize_t *ret_p)
+{
+    return upump_control(upump, UPUMP_URING_GET_RESULT,
+                         UPUMP_URING_SIGNATURE, ret_p);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -28,7 +28,9 @@ subdirs = \
     upipe-v210 \
     upipe-x264 \
     upipe-x265 \
+    upipe-xdp \
     upipe-zvbi \
     upump-ecore \
     upump-ev \
-    upump-srt
+    upump-srt \
+    upump-uring
@@ -681,6 +681,7 @@ static void upipe_avfsink_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_avfsink *upipe_avfsink = upipe_avfsink_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_avfsink->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_avfsink_to_urefcount(upipe_avfsink);
     sub_mgr->signature = UPIPE_AVFSINK_INPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_avfsink_sub_alloc;
@@ -437,6 +437,7 @@ static void upipe_avfsrc_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_avfsrc->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_avfsrc_to_urefcount_real(upipe_avfsrc);
     sub_mgr->signature = UPIPE_AVFSRC_OUTPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_avfsrc_sub_alloc;
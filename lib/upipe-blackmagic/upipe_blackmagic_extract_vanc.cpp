@@ -608,7 +608,9 @@ static struct upipe_mgr upipe_bmd_vanc_mgr = {
     /* .upipe_input = */ upipe_bmd_vanc_input,
     /* .upipe_control = */ upipe_bmd_vanc_control,
 
-    /* .upipe_mgr_control = */ NULL
+    /* .upipe_mgr_control = */ NULL,
+
+    /* .upipe_input_chain = */ NULL
 };
 }
 
@@ -1520,6 +1520,7 @@ static void upipe_bmd_sink_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_bmd_sink *upipe_bmd_sink = upipe_bmd_sink_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_bmd_sink->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_bmd_sink_to_urefcount(upipe_bmd_sink);
     sub_mgr->signature = UPIPE_BMD_SINK_INPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_bmd_sink_sub_alloc;
@@ -2143,7 +2144,9 @@ static struct upipe_mgr upipe_bmd_sink_mgr = {
     /* .upipe_input = */ NULL,
     /* .upipe_control = */ upipe_bmd_sink_control,
 
-    /* .upipe_mgr_control = */ NULL
+    /* .upipe_mgr_control = */ NULL,
+
+    /* .upipe_input_chain = */ NULL
 };
 
 UBASE_PRAGMA_GCC(visibility pop)
@@ -8,6 +8,10 @@
 
 /** @file
  * @short Upipe module receiving rfc4585 feedback
+ *
+ * Packets are buffered for retransmission in a ring indexed by their RTP
+ * sequence number, so that answering a NACK does not depend on the number of
+ * buffered packets.
  */
 
 #include "upipe/ubase.h"
@@ -48,6 +52,10 @@
 #include <bitstream/ietf/rtcp_sdes.h>
 
 #define EXPECTED_FLOW_DEF "block."
+/** size of the retransmission ring, indexed by RTP sequence number */
+#define RING_SIZE (UINT16_MAX + 1)
+/** maximum span of sequence numbers in the ring */
+#define RING_SPAN 0x8000
 
 /** upipe_rtcpfb structure */
 struct upipe_rtcpfb {
@@ -72,9 +80,17 @@ struct upipe_rtcpfb {
     struct upump *upump_timer;
     struct uclock *uclock;
     struct urequest uclock_request;
-    struct uchain queue;
     unsigned last_seq;
 
+    /** buffered packets, indexed by sequence number */
+    struct uref *ring[RING_SIZE];
+    /** oldest sequence number in the ring */
+    uint16_t first_seq;
+    /** number of buffered packets */
+    size_t buffered;
+    /** number of buffered octets */
+    size_t buffered_bytes;
+
     /** list of input subpipes */
     struct uchain inputs;
 
@@ -82,6 +98,8 @@ struct upipe_rtcpfb {
     int expected_seqnum;
     /** retransmit counter */
     uint64_t retrans;
+    /** retransmitted octets counter */
+    uint64_t retrans_bytes;
 
     /** output pipe */
     struct upipe *output;
@@ -250,84 +268,96 @@ static int ctz(unsigned int x)
 #endif
 }
 
-/** @internal @This retransmits a number of packets */
+/** @internal @This removes a packet from the ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param seq sequence number of the packet
+ */
+static void upipe_rtcpfb_remove(struct upipe *upipe, uint16_t seq)
+{
+    struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe);
+    struct uref *uref = upipe_rtcpfb->ring[seq];
+    if (uref == NULL)
+        return;
+
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    upipe_rtcpfb->ring[seq] = NULL;
+    upipe_rtcpfb->buffered--;
+    upipe_rtcpfb->buffered_bytes -= size;
+    uref_free(uref);
+}
+
+/** @internal @This removes all packets from the ring.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtcpfb_flush(struct upipe *upipe)
+{
+    struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe);
+    while (upipe_rtcpfb->buffered)
+        upipe_rtcpfb_remove(upipe, upipe_rtcpfb->first_seq++);
+}
+
+/** @internal @This retransmits a packet if it is still buffered.
+ *
+ * @param upipe description structure of the pipe
+ * @param seq sequence number of the packet
+ * @return false if the packet is not buffered
+ */
+static bool upipe_rtcpfb_retransmit(struct upipe *upipe, uint16_t seq)
+{
+    struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe);
+    struct uref *uref = upipe_rtcpfb->ring[seq];
+    if (uref == NULL)
+        return false;
+
+    upipe_verbose_va(upipe, "Retransmit %hu", seq);
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    upipe_rtcpfb->retrans++;
+    upipe_rtcpfb->retrans_bytes += size;
+
+    uint8_t *buf;
+    int s = 0;
+    if (ubase_check(uref_block_write(uref, 0, &s, &buf))) {
+        uint8_t ssrc[4];
+        rtp_get_ssrc(buf, ssrc);
+        ssrc[3] |= 1; /* RIST retransmitted packet */
+        rtp_set_ssrc(buf, ssrc);
+        uref_block_unmap(uref, 0);
+    }
+
+    upipe_rtcpfb_output(upipe, uref_dup(uref), NULL);
+    return true;
+}
+
+/** @internal @This retransmits a range of packets. */
 static void upipe_rtcpfb_lost_sub_n(struct upipe *upipe, uint16_t seq, uint16_t pkts)
 {
     struct upipe *upipe_super = NULL;
     upipe_rtcpfb_input_get_super(upipe, &upipe_super);
-    struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe_super);
-
-    struct uchain *uchain;
-    ulist_foreach(&upipe_rtcpfb->queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t uref_seqnum = 0;
-        uref_attr_get_priv(uref, &uref_seqnum);
-
-        uint16_t diff = uref_seqnum - seq;
-        if (diff >= pkts) {
-            /* packet not in range */
-            if (diff < 0x8000) {
-                /* packet after range */
-                return;
-            }
-            continue;
-        }
-
-        upipe_verbose_va(upipe, "Retransmit %" PRIu64, uref_seqnum);
-        upipe_rtcpfb->retrans++;
-
-        uint8_t *buf;
-        int s = 0;
-        if (ubase_check(uref_block_write(uref, 0, &s, &buf))) {
-            uint8_t ssrc[4];
-            rtp_get_ssrc(buf, ssrc);
-            ssrc[3] |= 1; /* RIST retransmitted packet */
-            rtp_set_ssrc(buf, ssrc);
-            uref_block_unmap(uref, 0);
-        }
 
-        upipe_rtcpfb_output(upipe_super, uref_dup(uref), NULL);
-        diff++;
-        seq += diff;
-        pkts -= diff;
+    /* the ring never spans more than RING_SPAN sequence numbers */
+    if (pkts > RING_SPAN)
+        pkts = RING_SPAN;
 
-        if (pkts == 0)
-            return;
-    }
+    for (uint16_t i = 0; i < pkts; i++)
+        if (!upipe_rtcpfb_retransmit(upipe_super, seq + i))
+            upipe_verbose_va(upipe, "Couldn't find seq %hu",
+                             (uint16_t)(seq + i));
 }
 
 /** @internal @This retransmits a list of packets described by a single FCI.
- * TODO: handle a list of FCIs.
  */
 static void upipe_rtcpfb_lost_sub(struct upipe *upipe, uint16_t seq, uint16_t mask)
 {
     struct upipe *upipe_super = NULL;
     upipe_rtcpfb_input_get_super(upipe, &upipe_super);
-    struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe_super);
-
-    struct uchain *uchain;
-    ulist_foreach(&upipe_rtcpfb->queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t uref_seqnum = 0;
-        uref_attr_get_priv(uref, &uref_seqnum);
-
-        if (seq != uref_seqnum)
-            continue;
-
-        upipe_verbose_va(upipe, "Retransmit %hu", seq);
-        upipe_rtcpfb->retrans++;
-
-        uint8_t *buf;
-        int s = 0;
-        if (ubase_check(uref_block_write(uref, 0, &s, &buf))) {
-            uint8_t ssrc[4];
-            rtp_get_ssrc(buf, ssrc);
-            ssrc[3] |= 1; /* RIST retransmitted packet */
-            rtp_set_ssrc(buf, ssrc);
-            uref_block_unmap(uref, 0);
-        }
 
-        upipe_rtcpfb_output(upipe_super, uref_dup(uref), NULL);
+    for ( ; ; ) {
+        if (!upipe_rtcpfb_retransmit(upipe_super, seq))
+            upipe_warn_va(upipe, "Couldn't find seq %hu", seq);
 
         if (!mask)
             return;
@@ -336,8 +366,6 @@ static void upipe_rtcpfb_lost_sub(struct upipe *upipe, uint16_t seq, uint16_t ma
         mask >>= zeros + 1;
         seq += zeros + 1;
     }
-
-    upipe_warn_va(upipe, "Couldn't find seq %hu", seq);
 }
 
 /** @This is called when there is no external reference to the pipe anymore.
@@ -397,12 +425,13 @@ static void upipe_rtcpfb_timer(struct upump *upump)
 
     uint64_t now = uclock_now(upipe_rtcpfb->uclock);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtcpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(uref, &seqnum);
+    while (upipe_rtcpfb->buffered) {
+        uint16_t seqnum = upipe_rtcpfb->first_seq;
+        struct uref *uref = upipe_rtcpfb->ring[seqnum];
+        if (uref == NULL) {
+            upipe_rtcpfb->first_seq++;
+            continue;
+        }
 
         uint64_t cr_sys = 0;
         if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &cr_sys))))
@@ -411,11 +440,11 @@ static void upipe_rtcpfb_timer(struct upump *upump)
         if (now - cr_sys < upipe_rtcpfb->latency)
             return;
 
-        upipe_verbose_va(upipe, "Delete seq %" PRIu64 " after %"PRIu64" clocks",
+        upipe_verbose_va(upipe, "Delete seq %hu after %"PRIu64" clocks",
                 seqnum, now - cr_sys);
 
-        ulist_delete(uchain);
-        uref_free(uref);
+        upipe_rtcpfb_remove(upipe, seqnum);
+        upipe_rtcpfb->first_seq++;
     }
 }
 
@@ -506,6 +535,7 @@ static void upipe_rtcpfb_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_rtcpfb->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_rtcpfb_to_urefcount_real(upipe_rtcpfb);
     sub_mgr->signature = UPIPE_RTCPFB_INPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_rtcpfb_input_alloc;
@@ -540,9 +570,13 @@ static struct upipe *upipe_rtcpfb_alloc(struct upipe_mgr *mgr,
     upipe_rtcpfb_init_sub_mgr(upipe);
     upipe_rtcpfb_init_ubuf_mgr(upipe);
     upipe_rtcpfb_init_uref_mgr(upipe);
-    ulist_init(&upipe_rtcpfb->queue);
+    memset(upipe_rtcpfb->ring, 0, sizeof(upipe_rtcpfb->ring));
+    upipe_rtcpfb->first_seq = 0;
+    upipe_rtcpfb->buffered = 0;
+    upipe_rtcpfb->buffered_bytes = 0;
     upipe_rtcpfb->expected_seqnum = -1;
     upipe_rtcpfb->retrans = 0;
+    upipe_rtcpfb->retrans_bytes = 0;
     upipe_rtcpfb->last_seq = UINT_MAX;
     upipe_rtcpfb->latency = UCLOCK_FREQ; /* 1 sec */
 
@@ -576,15 +610,34 @@ static inline void upipe_rtcpfb_input(struct upipe *upipe, struct uref *uref,
 #endif
     uref_block_peek_unmap(uref, 0, rtp_buffer, rtp_header);
 
-    uref_attr_set_priv(uref, seqnum);
-
     /* Output packet immediately */
     upipe_rtcpfb_output(upipe, uref_dup(uref), upump_p);
 
     upipe_verbose_va(upipe, "Output & buffer %hu", seqnum);
 
+    if (upipe_rtcpfb->buffered) {
+        uint16_t diff = seqnum - upipe_rtcpfb->last_seq;
+        if (unlikely(diff >= 0x8000)) {
+            upipe_warn_va(upipe, "sequence went back from %u to %hu, flushing",
+                          upipe_rtcpfb->last_seq, seqnum);
+            upipe_rtcpfb_flush(upipe);
+        } else {
+            /* make room in the ring, dropping the oldest packets */
+            while (upipe_rtcpfb->buffered &&
+                   (uint16_t)(seqnum - upipe_rtcpfb->first_seq) >= RING_SPAN)
+                upipe_rtcpfb_remove(upipe, upipe_rtcpfb->first_seq++);
+            upipe_rtcpfb_remove(upipe, seqnum);
+        }
+    }
+    if (!upipe_rtcpfb->buffered)
+        upipe_rtcpfb->first_seq = seqnum;
+
     /* Buffer packet in case retransmission is needed */
-    ulist_add(&upipe_rtcpfb->queue, uref_to_uchain(uref));
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    upipe_rtcpfb->ring[seqnum] = uref;
+    upipe_rtcpfb->buffered++;
+    upipe_rtcpfb->buffered_bytes += size;
 
     upipe_rtcpfb->last_seq = seqnum;
 }
@@ -650,6 +703,18 @@ static int _upipe_rtcpfb_control(struct upipe *upipe, int command, va_list args)
             upipe_rtcpfb->retrans = 0;
             return UBASE_ERR_NONE;
         }
+        case UPIPE_RTCPFB_GET_BUFFER_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTCPFB_SIGNATURE)
+            size_t *buffered = va_arg(args, size_t *);
+            size_t *buffered_bytes = va_arg(args, size_t *);
+            uint64_t *retrans_bytes = va_arg(args, uint64_t *);
+            struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe);
+            *buffered = upipe_rtcpfb->buffered;
+            *buffered_bytes = upipe_rtcpfb->buffered_bytes;
+            *retrans_bytes = upipe_rtcpfb->retrans_bytes;
+            upipe_rtcpfb->retrans_bytes = 0;
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -667,8 +732,6 @@ static int upipe_rtcpfb_control(struct upipe *upipe, int command, va_list args)
  */
 static void upipe_rtcpfb_free(struct upipe *upipe)
 {
-    struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe);
-
     upipe_dbg_va(upipe, "releasing pipe %p", upipe);
     upipe_throw_dead(upipe);
 
@@ -681,13 +744,7 @@ static void upipe_rtcpfb_free(struct upipe *upipe)
     upipe_rtcpfb_clean_upump_timer(upipe);
     upipe_rtcpfb_clean_upump_mgr(upipe);
     upipe_rtcpfb_clean_uclock(upipe);
-
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtcpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
+    upipe_rtcpfb_flush(upipe);
 
     upipe_rtcpfb_free_void(upipe);
 }
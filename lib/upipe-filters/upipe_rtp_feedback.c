@@ -8,6 +8,10 @@
 
 /** @file
  * @short Upipe module sending retransmit requests for lost RTP packets
+ *
+ * Packets are reordered in a ring indexed by their RTP sequence number, and
+ * missing sequence numbers are tracked in a bitmap, so that neither inserting
+ * a late packet nor building NACKs depends on the number of buffered packets.
  */
 
 #include "upipe/ubase.h"
@@ -52,6 +56,12 @@
 #include <bitstream/ietf/rtcp3611.h>
 
 #define EXPECTED_FLOW_DEF "block."
+/** size of the reorder ring, indexed by RTP sequence number */
+#define RING_SIZE (UINT16_MAX + 1)
+/** maximum span of sequence numbers in the ring */
+#define RING_SPAN 0x8000
+/** maximum number of FCIs in a NACK packet */
+#define MAX_FCI 64
 
 /** upipe_rtpfb structure */
 struct upipe_rtpfb {
@@ -69,10 +79,21 @@ struct upipe_rtpfb {
     struct upump *upump_timer_lost;
     struct uclock *uclock;
     struct urequest uclock_request;
-    struct uchain queue;
     struct uprobe *uprobe;
 
-    /** expected sequence number */
+    /** buffered packets, indexed by sequence number */
+    struct uref *ring[RING_SIZE];
+    /** output date of each sequence number in the ring, including missing
+     * ones */
+    uint64_t ring_cr_sys[RING_SIZE];
+    /** bitmap of the missing sequence numbers in the ring */
+    uint64_t lost[RING_SIZE / 64];
+    /** number of missing sequence numbers in the ring */
+    size_t nb_lost;
+    /** oldest sequence number in the ring */
+    uint16_t first_seqnum;
+
+    /** expected sequence number, or UINT_MAX if the ring is empty */
     unsigned expected_seqnum;
 
     /** last seq output */
@@ -80,8 +101,10 @@ struct upipe_rtpfb {
 
     /* stats */
     size_t buffered;
+    size_t buffered_bytes;
     size_t nacks;
     size_t repaired;
+    uint64_t repaired_bytes;
     size_t loss;
     size_t dups;
 
@@ -279,20 +302,21 @@ static void upipe_rtpfb_output_free(struct upipe *upipe)
     upipe_rtpfb_output_free_void(upipe);
 }
 
-/** @internal @This sends a retransmission request for a number of seqnums.
+/** @internal @This sends a retransmission request for lists of seqnums.
  *
  * @param upipe description structure of the pipe
- * @param lost_seqnum First sequence number missing
- * @param seqnum First sequence number NOT missing
+ * @param fcis FCIs, with the first sequence number missing in the upper 16
+ * bits and the bitmask of the following missing ones in the lower 16 bits
+ * @param nb_fcis number of FCIs
  * @param ssrc TODO
  */
-static void upipe_rtpfb_output_lost(struct upipe *upipe, uint16_t lost_seqnum, uint16_t seqnum, uint8_t *ssrc)
+static void upipe_rtpfb_output_lost(struct upipe *upipe, const uint32_t *fcis,
+                                    unsigned nb_fcis, uint8_t *ssrc)
 {
     struct upipe_rtpfb_output *upipe_rtpfb_output = upipe_rtpfb_output_from_upipe(upipe);
-    struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_sub_mgr(upipe->mgr);
 
-    /* Send a single NACK packet, with a single FCI */
-    int s = RTCP_FB_HEADER_SIZE + 1 * RTCP_FB_FCI_GENERIC_NACK_SIZE;
+    /* Send a single NACK packet, with all FCIs */
+    int s = RTCP_FB_HEADER_SIZE + nb_fcis * RTCP_FB_FCI_GENERIC_NACK_SIZE;
 
     /* Allocate NACK packet */
     struct uref *pkt = uref_block_alloc(upipe_rtpfb_output->uref_mgr,
@@ -316,25 +340,18 @@ static void upipe_rtpfb_output_lost(struct upipe *upipe, uint16_t lost_seqnum, u
     rtcp_fb_set_ssrc_pkt_sender(buf, ssrc_sender);
     rtcp_fb_set_ssrc_media_src(buf, ssrc);
 
-    uint8_t *fci = &buf[RTCP_FB_HEADER_SIZE];
-    rtcp_fb_nack_set_packet_id(fci, lost_seqnum);
-
-    uint16_t pkts = seqnum - 1 - lost_seqnum;
-    // TODO : add several FCI if more than 17 packets are missing
-    if (pkts > 16)
-        pkts = 16;
-
-    uint16_t bits = 0;
-    for (size_t i = 0; i < pkts; i++)
-        bits |= 1 << i;
-
-    rtcp_fb_nack_set_bitmask_lost(fci, bits);
-    upipe_rtpfb->nacks += pkts + 1;
+    for (unsigned i = 0; i < nb_fcis; i++) {
+        uint8_t *fci = &buf[RTCP_FB_HEADER_SIZE +
+                            i * RTCP_FB_FCI_GENERIC_NACK_SIZE];
+        rtcp_fb_nack_set_packet_id(fci, fcis[i] >> 16);
+        rtcp_fb_nack_set_bitmask_lost(fci, fcis[i] & UINT16_MAX);
+        upipe_verbose_va(upipe, "NACKing %hu (+0x%hx)",
+                         (uint16_t)(fcis[i] >> 16),
+                         (uint16_t)(fcis[i] & UINT16_MAX));
+    }
 
     rtcp_set_length(buf, s / 4 - 1);
 
-    upipe_verbose_va(upipe, "NACKing %hu (+0x%hx)", lost_seqnum, bits);
-
     uref_block_unmap(pkt, 0);
 
     // XXX : date NACK packet?
@@ -357,6 +374,58 @@ static uint64_t _upipe_rtpfb_get_rtt(struct upipe *upipe)
     return rtt;
 }
 
+/** @internal @This returns the number of trailing zero bits of a non-zero
+ * integer. */
+static int ctzll(uint64_t x)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    int tz = 0;
+    for (; !(x & 1); x >>= 1)
+        tz++;
+    return tz;
+#endif
+}
+
+/** @internal @This returns true if a sequence number is missing.
+ *
+ * @param upipe_rtpfb private structure of the pipe
+ * @param seqnum sequence number
+ * @return true if the sequence number is missing
+ */
+static inline bool upipe_rtpfb_is_lost(struct upipe_rtpfb *upipe_rtpfb,
+                                       uint16_t seqnum)
+{
+    return upipe_rtpfb->lost[seqnum / 64] & (UINT64_C(1) << (seqnum % 64));
+}
+
+/** @internal @This marks a sequence number as missing.
+ *
+ * @param upipe_rtpfb private structure of the pipe
+ * @param seqnum sequence number
+ */
+static inline void upipe_rtpfb_set_lost(struct upipe_rtpfb *upipe_rtpfb,
+                                        uint16_t seqnum)
+{
+    upipe_rtpfb->lost[seqnum / 64] |= UINT64_C(1) << (seqnum % 64);
+    upipe_rtpfb->nb_lost++;
+}
+
+/** @internal @This marks a sequence number as not missing.
+ *
+ * @param upipe_rtpfb private structure of the pipe
+ * @param seqnum sequence number
+ */
+static inline void upipe_rtpfb_clear_lost(struct upipe_rtpfb *upipe_rtpfb,
+                                          uint16_t seqnum)
+{
+    if (upipe_rtpfb_is_lost(upipe_rtpfb, seqnum)) {
+        upipe_rtpfb->lost[seqnum / 64] &= ~(UINT64_C(1) << (seqnum % 64));
+        upipe_rtpfb->nb_lost--;
+    }
+}
+
 /** @internal @This periodic timer checks for missing seqnums.
  */
 static void upipe_rtpfb_timer_lost(struct upump *upump)
@@ -364,7 +433,8 @@ static void upipe_rtpfb_timer_lost(struct upump *upump)
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
 
-    uint64_t expected_seq = UINT64_MAX;
+    if (!upipe_rtpfb->nb_lost)
+        return;
 
     uint64_t rtt = _upipe_rtpfb_get_rtt(upipe);
 
@@ -378,55 +448,62 @@ static void upipe_rtpfb_timer_lost(struct upump *upump)
      * XXX: use cr_sys, because pkts/s also accounts for
      * the retransmitted packets */
 
-    struct uchain *uchain;
+    uint32_t fcis[MAX_FCI];
+    unsigned nb_fcis = 0;
     int holes = 0;
-    ulist_foreach(&upipe_rtpfb->queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(uref, &seqnum);
-
-        if (likely(expected_seq != UINT64_MAX) && seqnum != expected_seq) {
-            /* hole found */
-            upipe_dbg_va(upipe, "Found hole from %"PRIu64" (incl) to %"PRIu64" (excl)",
-                expected_seq, seqnum);
-
-            for (uint16_t seq = expected_seq; seq != seqnum; seq++) {
-                /* if packet was lost, we should have detected it already */
-                if (upipe_rtpfb->last_nack[seq] == 0) {
-                    upipe_err_va(upipe, "packet %hu missing but was not marked as lost!", seq);
-                    continue;
-                }
-
-                /* if we sent a NACK not too long ago, do not repeat it */
-                /* since NACKs are sent in a batch, break loop if the first packet is too early */
-                if (upipe_rtpfb->last_nack[seq] > next_nack) {
-                    if (0) upipe_err_va(upipe, "Cancelling NACK due to RTT (seq %hu diff %"PRId64"",
-                        seq, next_nack - upipe_rtpfb->last_nack[seq]
-                    );
-                    goto next;
-                }
-            }
+    uint16_t span = upipe_rtpfb->expected_seqnum - upipe_rtpfb->first_seqnum;
+    unsigned offset = 0;
+    while (offset < span) {
+        uint16_t seq = upipe_rtpfb->first_seqnum + offset;
+
+        /* skip to the next missing seqnum */
+        uint64_t lost = upipe_rtpfb->lost[seq / 64] >> (seq % 64);
+        if (!lost) {
+            offset += 64 - seq % 64;
+            continue;
+        }
+        int zeros = ctzll(lost);
+        offset += zeros;
+        seq += zeros;
+        if (offset >= span)
+            break;
 
-            /* update NACK request time */
-            for (uint16_t seq = expected_seq; seq != seqnum; seq++) {
-                upipe_rtpfb->last_nack[seq] = now;
+        /* if we sent a NACK not too long ago, do not repeat it */
+        if (upipe_rtpfb->last_nack[seq] > next_nack) {
+            offset++;
+            continue;
+        }
+
+        /* add the following missing seqnums to the bitmask */
+        uint16_t mask = 0;
+        for (unsigned i = 1; i <= 16 && offset + i < span; i++) {
+            uint16_t next = seq + i;
+            if (upipe_rtpfb_is_lost(upipe_rtpfb, next) &&
+                upipe_rtpfb->last_nack[next] <= next_nack) {
+                mask |= 1 << (i - 1);
+                upipe_rtpfb->last_nack[next] = now;
+                upipe_rtpfb->nacks++;
             }
+        }
+        upipe_rtpfb->last_nack[seq] = now;
+        upipe_rtpfb->nacks++;
+        holes++;
 
-            /* TODO:
-                - check the following packets to fill in bitmask
-                - send request in a single batch (multiple FCI)
-             */
+        fcis[nb_fcis++] = ((uint32_t)seq << 16) | mask;
+        if (nb_fcis == MAX_FCI) {
             if (upipe_rtpfb->rtpfb_output)
-                upipe_rtpfb_output_lost(upipe_rtpfb->rtpfb_output, expected_seq, seqnum, upipe_rtpfb->last_ssrc);
-            holes++;
+                upipe_rtpfb_output_lost(upipe_rtpfb->rtpfb_output, fcis,
+                                        nb_fcis, upipe_rtpfb->last_ssrc);
+            nb_fcis = 0;
         }
-
-next:
-        expected_seq = (seqnum + 1) & UINT16_MAX;
+        offset += 17;
     }
 
+    if (nb_fcis && upipe_rtpfb->rtpfb_output)
+        upipe_rtpfb_output_lost(upipe_rtpfb->rtpfb_output, fcis, nb_fcis,
+                                upipe_rtpfb->last_ssrc);
+
     if (holes) { /* debug stats */
-        uint64_t now = uclock_now(upipe_rtpfb->uclock);
         static uint64_t old;
         if (likely(old != 0))
             upipe_dbg_va(upipe, "%d holes after %"PRIu64" ms",
@@ -435,6 +512,40 @@ next:
     }
 }
 
+/** @internal @This outputs the oldest packet of the ring, or accounts for
+ * it as lost if it was not repaired.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rtpfb_pop(struct upipe *upipe, struct upump **upump_p)
+{
+    struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
+    uint16_t seqnum = upipe_rtpfb->first_seqnum++;
+    struct uref *uref = upipe_rtpfb->ring[seqnum];
+    upipe_rtpfb->ring[seqnum] = NULL;
+    upipe_rtpfb->last_nack[seqnum] = 0;
+
+    if (upipe_rtpfb->first_seqnum == upipe_rtpfb->expected_seqnum) {
+        upipe_warn_va(upipe, "Exhausted buffer");
+        upipe_rtpfb->expected_seqnum = UINT_MAX;
+    }
+
+    if (uref == NULL) {
+        upipe_rtpfb_clear_lost(upipe_rtpfb, seqnum);
+        upipe_rtpfb->loss++;
+        upipe_dbg_va(upipe, "PKT LOSS: %hu", seqnum);
+        return;
+    }
+
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    upipe_rtpfb->buffered--;
+    upipe_rtpfb->buffered_bytes -= size;
+    upipe_rtpfb->last_output_seqnum = seqnum;
+    upipe_rtpfb_output(upipe, uref, upump_p);
+}
+
 /** @internal @This periodic timer remove seqnums from the buffer.
  */
 static void upipe_rtpfb_timer(struct upump *upump)
@@ -444,39 +555,14 @@ static void upipe_rtpfb_timer(struct upump *upump)
 
     uint64_t now = uclock_now(upipe_rtpfb->uclock);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        if (!ubase_check(uref_attr_get_priv(uref, &seqnum))) {
-            upipe_err_va(upipe, "Could not read seqnum from uref");
-        }
-
-        uint64_t cr_sys = 0;
-        if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &cr_sys))))
-            upipe_warn_va(upipe, "Couldn't read cr_sys in %s()", __func__);
-
+    while (upipe_rtpfb->expected_seqnum != UINT_MAX) {
+        uint64_t cr_sys = upipe_rtpfb->ring_cr_sys[upipe_rtpfb->first_seqnum];
         if (now - cr_sys <= upipe_rtpfb->latency)
             break;
 
-        upipe_verbose_va(upipe, "Output seq %"PRIu64" after %"PRIu64" clocks", seqnum, now - cr_sys);
-        if (likely(upipe_rtpfb->last_output_seqnum != UINT_MAX)) {
-            uint16_t diff = seqnum - upipe_rtpfb->last_output_seqnum - 1;
-            if (diff) {
-                upipe_rtpfb->loss += diff;
-                upipe_dbg_va(upipe, "PKT LOSS: %u -> %"PRIu64" DIFF %hu",
-                        upipe_rtpfb->last_output_seqnum, seqnum, diff);
-            }
-        }
-
-        upipe_rtpfb->last_output_seqnum = seqnum;
-
-        ulist_delete(uchain);
-        upipe_rtpfb_output(upipe, uref, NULL); // XXX: use timer upump ?
-        if (--upipe_rtpfb->buffered == 0) {
-            upipe_warn_va(upipe, "Exhausted buffer");
-            upipe_rtpfb->expected_seqnum = UINT_MAX;
-        }
+        upipe_verbose_va(upipe, "Output seq %hu after %"PRIu64" clocks",
+                         upipe_rtpfb->first_seqnum, now - cr_sys);
+        upipe_rtpfb_pop(upipe, NULL); // XXX: use timer upump ?
     }
 }
 
@@ -615,6 +701,7 @@ static void upipe_rtpfb_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_rtpfb->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_rtpfb_to_urefcount_real(upipe_rtpfb);
     sub_mgr->signature = UPIPE_RTPFB_OUTPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_rtpfb_output_alloc;
@@ -737,7 +824,10 @@ static struct upipe *upipe_rtpfb_alloc(struct upipe_mgr *mgr,
     upipe_rtpfb_init_upump_timer(upipe);
     upipe_rtpfb_init_upump_timer_lost(upipe);
     upipe_rtpfb_init_uclock(upipe);
-    ulist_init(&upipe_rtpfb->queue);
+    memset(upipe_rtpfb->ring, 0, sizeof(upipe_rtpfb->ring));
+    memset(upipe_rtpfb->lost, 0, sizeof(upipe_rtpfb->lost));
+    upipe_rtpfb->nb_lost = 0;
+    upipe_rtpfb->first_seqnum = 0;
     memset(upipe_rtpfb->last_nack, 0, sizeof(upipe_rtpfb->last_nack));
     upipe_rtpfb->rtt = 0;
     upipe_rtpfb_require_uclock(upipe);
@@ -745,8 +835,10 @@ static struct upipe *upipe_rtpfb_alloc(struct upipe_mgr *mgr,
     upipe_rtpfb->uprobe = uprobe_use(uprobe);
     upipe_rtpfb->last_output_seqnum = UINT_MAX;
     upipe_rtpfb->buffered = 0;
+    upipe_rtpfb->buffered_bytes = 0;
     upipe_rtpfb->nacks = 0;
     upipe_rtpfb->repaired = 0;
+    upipe_rtpfb->repaired_bytes = 0;
     upipe_rtpfb->loss = 0;
     upipe_rtpfb->dups = 0;
     memset(upipe_rtpfb->last_ssrc, 0, sizeof(upipe_rtpfb->last_ssrc));
@@ -757,76 +849,6 @@ static struct upipe *upipe_rtpfb_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-/* returns true if uref was inserted in the queue */
-static bool upipe_rtpfb_insert_inner(struct upipe *upipe, struct uref *uref,
-        const uint16_t seqnum, struct uref *next)
-{
-    struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
-    uint64_t next_seqnum = 0;
-    uref_attr_get_priv(next, &next_seqnum);
-
-    uint16_t diff = seqnum - next_seqnum;
-    if (!diff) {
-        upipe_verbose_va(upipe, "dropping duplicate %hu", seqnum);
-        upipe_rtpfb->dups++;
-        uref_free(uref);
-        return true;
-    }
-
-    /* browse the list until we find a seqnum bigger than ours */
-    if (diff < 0x8000) // seqnum > next_seqnum
-        return false;
-
-    /* if there's no previous packet we're too late */
-    struct uchain *uchain = uref_to_uchain(next);
-    if (unlikely(ulist_is_first(&upipe_rtpfb->queue, uchain))) {
-        upipe_dbg_va(upipe,
-                "LATE packet drop: Expected %u, got %hu, didn't insert after %"PRIu64,
-                upipe_rtpfb->expected_seqnum, seqnum, next_seqnum);
-        uref_free(uref);
-        return true;
-    }
-
-    /* Read previous packet seq & cr_sys */
-    uint64_t prev_seqnum = 0, cr_sys = 0;
-
-    struct uref *prev = uref_from_uchain(uchain->prev);
-    uref_attr_get_priv(prev, &prev_seqnum);
-
-    /* overwrite this uref' cr_sys with previous one's
-     * so it get scheduled at the right time */
-    if (ubase_check(uref_clock_get_cr_sys(prev, &cr_sys)))
-        uref_clock_set_cr_sys(uref, cr_sys);
-    else
-        upipe_err_va(upipe, "Couldn't read cr_sys in %s() - %zu buffered",
-                __func__, upipe_rtpfb->buffered);
-
-    upipe_rtpfb->buffered++;
-    ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
-    upipe_rtpfb->repaired++;
-    upipe_rtpfb->last_nack[seqnum] = 0;
-
-    upipe_dbg_va(upipe, "Repaired %"PRIu64" > %hu > %"PRIu64" -diff %d",
-            prev_seqnum, seqnum, next_seqnum, -diff);
-
-    return true;
-}
-
-static bool upipe_rtpfb_insert(struct upipe *upipe, struct uref *uref, const uint16_t seqnum)
-{
-    struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
-
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *next = uref_from_uchain(uchain);
-        if (upipe_rtpfb_insert_inner(upipe, uref, seqnum, next))
-            return true;
-    }
-
-    /* Could not insert packet */
-    return false;
-}
-
 /** @internal @This handles RTCP data.
  *
  * @param upipe description structure of the pipe
@@ -973,45 +995,86 @@ static void upipe_rtpfb_input(struct upipe *upipe, struct uref *uref,
         return;
     }
 
-    /* store seqnum in uref */
-    uref_attr_set_priv(uref, seqnum);
+    uint64_t cr_sys = 0;
+    if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &cr_sys))))
+        upipe_warn_va(upipe, "Couldn't read cr_sys in %s()", __func__);
+    size_t size = 0;
+    uref_block_size(uref, &size);
 
     /* first packet */
-    if (unlikely(upipe_rtpfb->expected_seqnum == UINT_MAX))
+    if (unlikely(upipe_rtpfb->expected_seqnum == UINT_MAX)) {
         upipe_rtpfb->expected_seqnum = seqnum;
+        upipe_rtpfb->first_seqnum = seqnum;
+    }
 
     uint16_t diff = seqnum - upipe_rtpfb->expected_seqnum;
 
     if (diff < 0x8000) { // seqnum > last seq, insert at the end
-        /* packet is from the future */
-        upipe_rtpfb->buffered++;
-        ulist_add(&upipe_rtpfb->queue, uref_to_uchain(uref));
-        upipe_rtpfb->last_nack[seqnum] = 0;
+        /* packet is from the future, make room in the ring */
+        while (upipe_rtpfb->expected_seqnum != UINT_MAX &&
+               (uint16_t)(seqnum - upipe_rtpfb->first_seqnum) >= RING_SPAN)
+            upipe_rtpfb_pop(upipe, upump_p);
+        if (unlikely(upipe_rtpfb->expected_seqnum == UINT_MAX)) {
+            upipe_rtpfb->expected_seqnum = seqnum;
+            upipe_rtpfb->first_seqnum = seqnum;
+            diff = 0;
+        }
 
         if (diff != 0) {
             uint64_t rtt = _upipe_rtpfb_get_rtt(upipe);
             /* wait a bit to send a NACK, in case of reordering */
             uint64_t fake_last_nack = uclock_now(upipe_rtpfb->uclock) - rtt;
-            for (uint16_t seq = upipe_rtpfb->expected_seqnum; seq != seqnum; seq++)
+            /* missing packets are output at the date of the previous one */
+            uint64_t prev_cr_sys =
+                upipe_rtpfb->ring_cr_sys[(uint16_t)(upipe_rtpfb->expected_seqnum - 1)];
+            for (uint16_t seq = upipe_rtpfb->expected_seqnum; seq != seqnum; seq++) {
+                upipe_rtpfb_set_lost(upipe_rtpfb, seq);
+                upipe_rtpfb->ring_cr_sys[seq] = prev_cr_sys;
                 if (upipe_rtpfb->last_nack[seq] == 0)
                     upipe_rtpfb->last_nack[seq] = fake_last_nack;
+            }
         }
 
-        upipe_rtpfb->expected_seqnum = seqnum + 1;
+        upipe_rtpfb->ring[seqnum] = uref;
+        upipe_rtpfb->ring_cr_sys[seqnum] = cr_sys;
+        upipe_rtpfb->last_nack[seqnum] = 0;
+        upipe_rtpfb->buffered++;
+        upipe_rtpfb->buffered_bytes += size;
+        upipe_rtpfb->expected_seqnum = (uint16_t)(seqnum + 1);
         return;
     }
 
     /* packet is from the past, reordered or retransmitted */
-    if (upipe_rtpfb_insert(upipe, uref, seqnum))
+    uint16_t span = upipe_rtpfb->expected_seqnum - upipe_rtpfb->first_seqnum;
+    if ((uint16_t)(seqnum - upipe_rtpfb->first_seqnum) >= span) {
+        // XXX : when much too late, it could mean RTP source restart
+        upipe_err_va(upipe, "LATE packet %hu, dropped (buffered %hu -> %hu)",
+                seqnum, upipe_rtpfb->first_seqnum,
+                (uint16_t)(upipe_rtpfb->expected_seqnum - 1));
+        uref_free(uref);
         return;
+    }
 
-    uint64_t first_seq = 0, last_seq = 0;
-    uref_attr_get_priv(uref_from_uchain(upipe_rtpfb->queue.next), &first_seq);
-    uref_attr_get_priv(uref_from_uchain(upipe_rtpfb->queue.prev), &last_seq);
-    // XXX : when much too late, it could mean RTP source restart
-    upipe_err_va(upipe, "LATE packet %hu, dropped (buffered %"PRIu64" -> %"PRIu64")",
-            seqnum, first_seq, last_seq);
-    uref_free(uref);
+    if (upipe_rtpfb->ring[seqnum] != NULL) {
+        upipe_verbose_va(upipe, "dropping duplicate %hu", seqnum);
+        upipe_rtpfb->dups++;
+        uref_free(uref);
+        return;
+    }
+
+    /* overwrite this uref' cr_sys with previous one's
+     * so it get scheduled at the right time */
+    uref_clock_set_cr_sys(uref, upipe_rtpfb->ring_cr_sys[seqnum]);
+
+    upipe_rtpfb->ring[seqnum] = uref;
+    upipe_rtpfb_clear_lost(upipe_rtpfb, seqnum);
+    upipe_rtpfb->last_nack[seqnum] = 0;
+    upipe_rtpfb->buffered++;
+    upipe_rtpfb->buffered_bytes += size;
+    upipe_rtpfb->repaired++;
+    upipe_rtpfb->repaired_bytes += size;
+
+    upipe_dbg_va(upipe, "Repaired %hu", seqnum);
 }
 
 /** @internal @This sets the input flow definition.
@@ -1124,6 +1187,16 @@ static int _upipe_rtpfb_control(struct upipe *upipe, int command, va_list args)
             *rtt = upipe_rtpfb->rtt;
             return UBASE_ERR_NONE;
         }
+        case UPIPE_RTPFB_GET_BUFFER_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTPFB_SIGNATURE)
+            size_t *buffered_bytes = va_arg(args, size_t *);
+            uint64_t *repaired_bytes = va_arg(args, uint64_t *);
+            struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
+            *buffered_bytes = upipe_rtpfb->buffered_bytes;
+            *repaired_bytes = upipe_rtpfb->repaired_bytes;
+            upipe_rtpfb->repaired_bytes = 0;
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -1157,11 +1230,12 @@ static void upipe_rtpfb_free(struct upipe *upipe)
     upipe_rtpfb_clean_sub_outputs(upipe);
     uprobe_release(upipe_rtpfb->uprobe);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
+    for (uint16_t seq = upipe_rtpfb->first_seqnum;
+         upipe_rtpfb->buffered; seq++) {
+        if (upipe_rtpfb->ring[seq] != NULL) {
+            uref_free(upipe_rtpfb->ring[seq]);
+            upipe_rtpfb->buffered--;
+        }
     }
 
     upipe_rtpfb_free_void(upipe);
@@ -438,6 +438,7 @@ struct upipe_mgr *upipe_autof_mgr_alloc(void)
 
     urefcount_init(upipe_autof_mgr_to_urefcount(autof_mgr),
                    upipe_autof_mgr_free);
+    upipe_mgr_init(&autof_mgr->mgr);
     autof_mgr->mgr.refcount = upipe_autof_mgr_to_urefcount(autof_mgr);
     autof_mgr->mgr.signature = UPIPE_AUTOF_SIGNATURE;
     autof_mgr->mgr.upipe_alloc = upipe_autof_alloc;
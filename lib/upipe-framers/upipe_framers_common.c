@@ -14,6 +14,7 @@
 
 #include <stdint.h>
 
+#include "upipe/ubuf_block.h"
 #include "upipe-framers/upipe_framers_common.h"
 
 /** @This scans for an MPEG-style 3-octet start code in a linear buffer.
@@ -23,7 +24,7 @@
  * @param state state of the algorithm
  * @return pointer to start code, or end if not found
  */
-/* Code from libav/libavcodec/mpegvideo.c, published under LGPL 2.1+ */
+/* Code adapted from libav/libavcodec/mpegvideo.c, published under LGPL 2.1+ */
 const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
                                        const uint8_t *end,
                                        uint32_t *restrict state)
@@ -36,18 +37,13 @@ const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
             return p;
     }
 
-    while (p < end) {
-        if      (p[-1] > 1      ) p += 3;
-        else if (p[-2]          ) p += 2;
-        else if (p[-3]|(p[-1]-1)) p++;
-        else {
-            p++;
-            break;
-        }
-    }
-
-    if (p > end)
+    /* return a pointer past the octet following the start code, like the
+     * prologue above */
+    const uint8_t *start = ubuf_block_scan_startcode(p - 3, end);
+    if (start == end || end - start < 4)
         p = end;
+    else
+        p = start + 4;
     *state = ((uint32_t)p[-4] << 24) | (p[-3] << 16) | (p[-2] << 8) | p[-1];
 
     return p;
@@ -9,6 +9,7 @@ libupipe_hls-includes = \
     upipe_hls_buffer.h \
     upipe_hls_master.h \
     upipe_hls_playlist.h \
+    upipe_hls_sink.h \
     upipe_hls_variant.h \
     upipe_hls_video.h \
     upipe_hls_void.h \
@@ -20,6 +21,7 @@ libupipe_hls-src = \
     upipe_hls_buffer.c \
     upipe_hls_master.c \
     upipe_hls_playlist.c \
+    upipe_hls_sink.c \
     upipe_hls_variant.c \
     upipe_hls_video.c \
     upipe_hls_void.c
@@ -0,0 +1,1012 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe sink module packaging a transport stream to HLS
+ */
+
+#define _GNU_SOURCE
+
+#include "upipe/ubase.h"
+#include "upipe/ulist.h"
+#include "upipe/uclock.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_clock.h"
+#include "upipe/uref_flow.h"
+#include "upipe/uref_m3u_master.h"
+#include "upipe/uref_m3u_playlist_flow.h"
+#include "upipe/upipe.h"
+#include "upipe/upipe_helper_upipe.h"
+#include "upipe/upipe_helper_urefcount.h"
+#include "upipe/upipe_helper_void.h"
+#include "upipe-hls/upipe_hls_sink.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include <bitstream/mpeg/ts.h>
+
+#ifndef O_CLOEXEC
+#   define O_CLOEXEC 0
+#endif
+
+/** we only accept transport streams */
+#define EXPECTED_FLOW_DEF "block.mpegts."
+/** default target duration of segments */
+#define DEFAULT_TARGET_DURATION (6 * UCLOCK_FREQ)
+/** default master playlist file name */
+#define DEFAULT_MASTER "master.m3u8"
+/** partial segments are listed for this many target durations */
+#define PART_WINDOW 3
+/** segments exceeding the advertised target duration by this much are cut
+ * without waiting for a random access point, so that their rounded duration
+ * stays within the target */
+#define MAX_OVERRUN (UCLOCK_FREQ / 4)
+
+/** @internal @This describes a partial segment. */
+struct upipe_hls_sink_part {
+    /** attach to the segment */
+    struct uchain uchain;
+    /** duration of the part */
+    uint64_t duration;
+    /** offset of the part in the segment file */
+    uint64_t offset;
+    /** size of the part */
+    uint64_t size;
+    /** true if the part starts with a random access point */
+    bool independent;
+};
+
+UBASE_FROM_TO(upipe_hls_sink_part, uchain, uchain, uchain);
+
+/** @internal @This describes a segment. */
+struct upipe_hls_sink_segment {
+    /** attach to the segment list */
+    struct uchain uchain;
+    /** media sequence number */
+    uint64_t seq;
+    /** duration of the segment */
+    uint64_t duration;
+    /** size of the segment */
+    uint64_t size;
+    /** true if the segment follows a discontinuity */
+    bool discontinuity;
+    /** list of partial segments */
+    struct uchain parts;
+};
+
+UBASE_FROM_TO(upipe_hls_sink_segment, uchain, uchain, uchain);
+
+/** @internal @This is the private context of a hls sink pipe. */
+struct upipe_hls_sink {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** input flow definition */
+    struct uref *flow_def;
+    /** output directory */
+    char *dir;
+    /** base name of the media playlist and the segments */
+    char *name;
+    /** file name of the master playlist */
+    char *master;
+    /** true if the master playlist was written for the current flow */
+    bool master_written;
+
+    /** target duration of the segments */
+    uint64_t target_duration;
+    /** target duration of the partial segments, or 0 */
+    uint64_t part_duration;
+    /** number of segments in the playlist, or 0 */
+    unsigned int window;
+    /** target duration advertised in the playlist in seconds, fixed when
+     * the first segment is opened, or 0 */
+    uint64_t max_target;
+    /** highest measured bitrate */
+    uint64_t max_bitrate;
+
+    /** completed segments, including one not listed any more */
+    struct uchain segments;
+    /** number of completed segments */
+    unsigned int nb_segments;
+    /** media sequence number of the next segment */
+    uint64_t next_seq;
+    /** discontinuity sequence number of the first segment */
+    uint64_t discontinuity_seq;
+    /** next segment follows a discontinuity */
+    bool discontinuity;
+
+    /** segment being written, or NULL */
+    struct upipe_hls_sink_segment *current;
+    /** segment file descriptor */
+    int fd;
+    /** clock of the first packet of the segment */
+    uint64_t segment_start;
+    /** clock of the first packet of the part */
+    uint64_t part_start;
+    /** offset of the part in the segment */
+    uint64_t part_offset;
+    /** true if the part starts with a random access point */
+    bool part_independent;
+    /** clock of the last packet */
+    uint64_t last_cr;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_hls_sink, upipe, UPIPE_HLS_SINK_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_hls_sink, urefcount, upipe_hls_sink_free)
+UPIPE_HELPER_VOID(upipe_hls_sink)
+
+/** @internal @This allocates a hls sink pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_hls_sink_alloc(struct upipe_mgr *mgr,
+                                          struct uprobe *uprobe,
+                                          uint32_t signature, va_list args)
+{
+    struct upipe *upipe =
+        upipe_hls_sink_alloc_void(mgr, uprobe, signature, args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    upipe_hls_sink_init_urefcount(upipe);
+    upipe_hls_sink->flow_def = NULL;
+    upipe_hls_sink->dir = NULL;
+    upipe_hls_sink->name = NULL;
+    upipe_hls_sink->master = strdup(DEFAULT_MASTER);
+    upipe_hls_sink->master_written = false;
+    upipe_hls_sink->target_duration = DEFAULT_TARGET_DURATION;
+    upipe_hls_sink->part_duration = 0;
+    upipe_hls_sink->window = 0;
+    upipe_hls_sink->max_target = 0;
+    upipe_hls_sink->max_bitrate = 0;
+    ulist_init(&upipe_hls_sink->segments);
+    upipe_hls_sink->nb_segments = 0;
+    upipe_hls_sink->next_seq = 0;
+    upipe_hls_sink->discontinuity_seq = 0;
+    upipe_hls_sink->discontinuity = false;
+    upipe_hls_sink->current = NULL;
+    upipe_hls_sink->fd = -1;
+    upipe_hls_sink->segment_start = UINT64_MAX;
+    upipe_hls_sink->part_start = UINT64_MAX;
+    upipe_hls_sink->part_offset = 0;
+    upipe_hls_sink->part_independent = false;
+    upipe_hls_sink->last_cr = UINT64_MAX;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This frees a segment and its parts.
+ *
+ * @param segment segment to free
+ */
+static void upipe_hls_sink_segment_free(struct upipe_hls_sink_segment *segment)
+{
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&segment->parts)) != NULL)
+        free(upipe_hls_sink_part_from_uchain(uchain));
+    free(segment);
+}
+
+/** @internal @This forgets the completed segments, so that a new playlist
+ * starts from scratch.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hls_sink_reset(struct upipe *upipe)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&upipe_hls_sink->segments)) != NULL)
+        upipe_hls_sink_segment_free(
+            upipe_hls_sink_segment_from_uchain(uchain));
+    upipe_hls_sink->nb_segments = 0;
+    upipe_hls_sink->next_seq = 0;
+    upipe_hls_sink->discontinuity_seq = 0;
+    upipe_hls_sink->discontinuity = false;
+    upipe_hls_sink->max_target = 0;
+    upipe_hls_sink->max_bitrate = 0;
+
+    uint64_t value;
+    if (upipe_hls_sink->flow_def != NULL &&
+        ubase_check(uref_m3u_playlist_flow_get_media_sequence(
+                upipe_hls_sink->flow_def, &value)))
+        upipe_hls_sink->next_seq = value;
+}
+
+/** @internal @This builds the path of a file in the output directory.
+ *
+ * @param upipe description structure of the pipe
+ * @param fmt printf-style format of the file name
+ * @return an allocated path or NULL
+ */
+static UBASE_FMT_PRINTF(2, 3)
+char *upipe_hls_sink_path(struct upipe *upipe, const char *fmt, ...)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    char *file;
+    va_list args;
+    va_start(args, fmt);
+    int ret = vasprintf(&file, fmt, args);
+    va_end(args);
+    if (unlikely(ret < 0))
+        return NULL;
+
+    char *path;
+    ret = asprintf(&path, "%s/%s", upipe_hls_sink->dir, file);
+    free(file);
+    return ret < 0 ? NULL : path;
+}
+
+/** @internal @This opens a temporary file to write a playlist.
+ *
+ * @param upipe description structure of the pipe
+ * @param path final path of the playlist
+ * @param tmp_p filled in with the allocated temporary path
+ * @return a stream or NULL
+ */
+static FILE *upipe_hls_sink_playlist_open(struct upipe *upipe,
+                                          const char *path, char **tmp_p)
+{
+    if (unlikely(asprintf(tmp_p, "%s.tmp", path) < 0)) {
+        *tmp_p = NULL;
+        return NULL;
+    }
+    FILE *file = fopen(*tmp_p, "w");
+    if (unlikely(file == NULL)) {
+        upipe_err_va(upipe, "can't open %s (%m)", *tmp_p);
+        free(*tmp_p);
+        *tmp_p = NULL;
+    }
+    return file;
+}
+
+/** @internal @This closes a temporary playlist and atomically replaces the
+ * previous one.
+ *
+ * @param upipe description structure of the pipe
+ * @param file stream returned by @ref upipe_hls_sink_playlist_open
+ * @param path final path of the playlist
+ * @param tmp temporary path, freed by this function
+ * @return an error code
+ */
+static int upipe_hls_sink_playlist_commit(struct upipe *upipe, FILE *file,
+                                          const char *path, char *tmp)
+{
+    bool error = ferror(file);
+    if (fclose(file))
+        error = true;
+    if (unlikely(error)) {
+        upipe_err_va(upipe, "can't write %s (%m)", tmp);
+        unlink(tmp);
+        free(tmp);
+        return UBASE_ERR_EXTERNAL;
+    }
+    if (unlikely(rename(tmp, path) < 0)) {
+        upipe_err_va(upipe, "can't rename %s (%m)", tmp);
+        unlink(tmp);
+        free(tmp);
+        return UBASE_ERR_EXTERNAL;
+    }
+    free(tmp);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This prints a duration in seconds with millisecond
+ * precision, without depending on the locale.
+ *
+ * @param file stream to print to
+ * @param duration duration in units of UCLOCK_FREQ
+ */
+static void upipe_hls_sink_print_duration(FILE *file, uint64_t duration)
+{
+    uint64_t ms = (duration + UCLOCK_FREQ / 2000) / (UCLOCK_FREQ / 1000);
+    fprintf(file, "%"PRIu64".%03"PRIu64, ms / 1000, ms % 1000);
+}
+
+/** @internal @This prints the partial segments of a segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param file stream to print to
+ * @param segment segment
+ */
+static void upipe_hls_sink_print_parts(struct upipe *upipe, FILE *file,
+                                       struct upipe_hls_sink_segment *segment)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    struct uchain *uchain;
+    ulist_foreach (&segment->parts, uchain) {
+        struct upipe_hls_sink_part *part =
+            upipe_hls_sink_part_from_uchain(uchain);
+        fprintf(file, "#EXT-X-PART:DURATION=");
+        upipe_hls_sink_print_duration(file, part->duration);
+        fprintf(file, ",URI=\"%s-%"PRIu64".ts\",BYTERANGE=%"PRIu64"@%"PRIu64
+                "%s\n", upipe_hls_sink->name, segment->seq,
+                part->size, part->offset,
+                part->independent ? ",INDEPENDENT=YES" : "");
+    }
+}
+
+/** @internal @This writes the media playlist.
+ *
+ * @param upipe description structure of the pipe
+ * @param endlist true if the stream is finished
+ * @return an error code
+ */
+static int upipe_hls_sink_write_playlist(struct upipe *upipe, bool endlist)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    char *path = upipe_hls_sink_path(upipe, "%s.m3u8", upipe_hls_sink->name);
+    UBASE_ALLOC_RETURN(path);
+    char *tmp;
+    FILE *file = upipe_hls_sink_playlist_open(upipe, path, &tmp);
+    if (unlikely(file == NULL)) {
+        free(path);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    fprintf(file, "#EXTM3U\n");
+    fprintf(file, "#EXT-X-VERSION:%u\n",
+            upipe_hls_sink->part_duration ? 6 : 3);
+    fprintf(file, "#EXT-X-TARGETDURATION:%"PRIu64"\n",
+            upipe_hls_sink->max_target);
+
+    const char *type = NULL;
+    if (upipe_hls_sink->flow_def != NULL)
+        uref_m3u_playlist_flow_get_type(upipe_hls_sink->flow_def, &type);
+    if (type == NULL && !upipe_hls_sink->window)
+        type = "EVENT";
+    if (type != NULL)
+        fprintf(file, "#EXT-X-PLAYLIST-TYPE:%s\n", type);
+
+    if (upipe_hls_sink->part_duration) {
+        fprintf(file, "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=");
+        upipe_hls_sink_print_duration(file,
+                                      3 * upipe_hls_sink->part_duration);
+        fprintf(file, "\n#EXT-X-PART-INF:PART-TARGET=");
+        upipe_hls_sink_print_duration(file, upipe_hls_sink->part_duration);
+        fprintf(file, "\n");
+    }
+
+    /* the oldest segment is kept on disk but not listed any more */
+    unsigned int hidden = 0;
+    if (upipe_hls_sink->window &&
+        upipe_hls_sink->nb_segments > upipe_hls_sink->window)
+        hidden = upipe_hls_sink->nb_segments - upipe_hls_sink->window;
+
+    uint64_t media_seq = upipe_hls_sink->current != NULL ?
+        upipe_hls_sink->current->seq : upipe_hls_sink->next_seq;
+    uint64_t discontinuity_seq = upipe_hls_sink->discontinuity_seq;
+    unsigned int i = 0;
+    struct uchain *uchain;
+    ulist_foreach (&upipe_hls_sink->segments, uchain) {
+        struct upipe_hls_sink_segment *segment =
+            upipe_hls_sink_segment_from_uchain(uchain);
+        if (i++ < hidden) {
+            if (segment->discontinuity)
+                discontinuity_seq++;
+            continue;
+        }
+        if (segment->seq < media_seq)
+            media_seq = segment->seq;
+    }
+    fprintf(file, "#EXT-X-MEDIA-SEQUENCE:%"PRIu64"\n", media_seq);
+    if (discontinuity_seq)
+        fprintf(file, "#EXT-X-DISCONTINUITY-SEQUENCE:%"PRIu64"\n",
+                discontinuity_seq);
+
+    i = 0;
+    ulist_foreach (&upipe_hls_sink->segments, uchain) {
+        struct upipe_hls_sink_segment *segment =
+            upipe_hls_sink_segment_from_uchain(uchain);
+        if (i++ < hidden)
+            continue;
+        if (segment->discontinuity)
+            fprintf(file, "#EXT-X-DISCONTINUITY\n");
+        upipe_hls_sink_print_parts(upipe, file, segment);
+        fprintf(file, "#EXTINF:");
+        upipe_hls_sink_print_duration(file, segment->duration);
+        fprintf(file, ",\n%s-%"PRIu64".ts\n", upipe_hls_sink->name,
+                segment->seq);
+    }
+
+    struct upipe_hls_sink_segment *current = upipe_hls_sink->current;
+    if (current != NULL && upipe_hls_sink->part_duration) {
+        if (current->discontinuity)
+            fprintf(file, "#EXT-X-DISCONTINUITY\n");
+        upipe_hls_sink_print_parts(upipe, file, current);
+        fprintf(file, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s-%"PRIu64".ts\","
+                "BYTERANGE-START=%"PRIu64"\n", upipe_hls_sink->name,
+                current->seq, upipe_hls_sink->part_offset);
+    }
+
+    if (endlist)
+        fprintf(file, "#EXT-X-ENDLIST\n");
+
+    int err = upipe_hls_sink_playlist_commit(upipe, file, path, tmp);
+    free(path);
+    return err;
+}
+
+/** @internal @This writes the master playlist, once the bandwidth is
+ * known.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_hls_sink_write_master(struct upipe *upipe)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    if (upipe_hls_sink->master == NULL || upipe_hls_sink->master_written)
+        return UBASE_ERR_NONE;
+
+    struct uref *flow_def = upipe_hls_sink->flow_def;
+    uint64_t bandwidth = 0;
+    uint64_t octetrate;
+    if (flow_def != NULL &&
+        !ubase_check(uref_m3u_master_get_bandwidth(flow_def, &bandwidth)) &&
+        ubase_check(uref_block_flow_get_octetrate(flow_def, &octetrate)))
+        bandwidth = octetrate * 8;
+    if (!bandwidth)
+        bandwidth = upipe_hls_sink->max_bitrate;
+    if (!bandwidth)
+        /* wait for the first segment */
+        return UBASE_ERR_NONE;
+
+    char *path = upipe_hls_sink_path(upipe, "%s", upipe_hls_sink->master);
+    UBASE_ALLOC_RETURN(path);
+    char *tmp;
+    FILE *file = upipe_hls_sink_playlist_open(upipe, path, &tmp);
+    if (unlikely(file == NULL)) {
+        free(path);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    fprintf(file, "#EXTM3U\n");
+    if (upipe_hls_sink->part_duration)
+        fprintf(file, "#EXT-X-VERSION:6\n");
+    fprintf(file, "#EXT-X-STREAM-INF:BANDWIDTH=%"PRIu64, bandwidth);
+    const char *codecs, *resolution;
+    if (flow_def != NULL &&
+        ubase_check(uref_m3u_master_get_codecs(flow_def, &codecs)))
+        fprintf(file, ",CODECS=\"%s\"", codecs);
+    if (flow_def != NULL &&
+        ubase_check(uref_m3u_master_get_resolution(flow_def, &resolution)))
+        fprintf(file, ",RESOLUTION=%s", resolution);
+    fprintf(file, "\n%s.m3u8\n", upipe_hls_sink->name);
+
+    int err = upipe_hls_sink_playlist_commit(upipe, file, path, tmp);
+    free(path);
+    if (ubase_check(err))
+        upipe_hls_sink->master_written = true;
+    return err;
+}
+
+/** @internal @This deletes the oldest segments out of the window, and
+ * partial segments older than a few target durations.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hls_sink_expire(struct upipe *upipe)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    struct uchain *uchain, *uchain_tmp;
+
+    /* keep one segment more than listed for clients still loading it */
+    while (upipe_hls_sink->window &&
+           upipe_hls_sink->nb_segments > upipe_hls_sink->window + 1) {
+        uchain = ulist_pop(&upipe_hls_sink->segments);
+        struct upipe_hls_sink_segment *segment =
+            upipe_hls_sink_segment_from_uchain(uchain);
+        upipe_hls_sink->nb_segments--;
+        if (segment->discontinuity)
+            upipe_hls_sink->discontinuity_seq++;
+
+        char *path = upipe_hls_sink_path(upipe, "%s-%"PRIu64".ts",
+                                         upipe_hls_sink->name, segment->seq);
+        if (path != NULL && unlink(path) < 0)
+            upipe_warn_va(upipe, "can't delete %s (%m)", path);
+        free(path);
+        upipe_hls_sink_segment_free(segment);
+    }
+
+    uint64_t total = 0;
+    ulist_foreach (&upipe_hls_sink->segments, uchain)
+        total += upipe_hls_sink_segment_from_uchain(uchain)->duration;
+
+    uint64_t keep = PART_WINDOW * upipe_hls_sink->target_duration;
+    ulist_delete_foreach (&upipe_hls_sink->segments, uchain, uchain_tmp) {
+        if (total <= keep)
+            break;
+        struct upipe_hls_sink_segment *segment =
+            upipe_hls_sink_segment_from_uchain(uchain);
+        total -= segment->duration;
+        struct uchain *part;
+        while ((part = ulist_pop(&segment->parts)) != NULL)
+            free(upipe_hls_sink_part_from_uchain(part));
+    }
+}
+
+/** @internal @This closes the current partial segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param cr clock of the first packet of the next part
+ * @param independent true if the next part starts with a random access point
+ */
+static void upipe_hls_sink_close_part(struct upipe *upipe, uint64_t cr,
+                                      bool independent)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    struct upipe_hls_sink_segment *current = upipe_hls_sink->current;
+    if (current->size > upipe_hls_sink->part_offset) {
+        struct upipe_hls_sink_part *part = malloc(sizeof(*part));
+        if (unlikely(part == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        uchain_init(&part->uchain);
+        part->duration = cr > upipe_hls_sink->part_start ?
+                         cr - upipe_hls_sink->part_start : 0;
+        part->offset = upipe_hls_sink->part_offset;
+        part->size = current->size - upipe_hls_sink->part_offset;
+        part->independent = upipe_hls_sink->part_independent;
+        ulist_add(&current->parts, &part->uchain);
+    }
+    upipe_hls_sink->part_start = cr;
+    upipe_hls_sink->part_offset = current->size;
+    upipe_hls_sink->part_independent = independent;
+}
+
+/** @internal @This closes the current segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param cr clock of the first packet of the next segment
+ */
+static void upipe_hls_sink_close_segment(struct upipe *upipe, uint64_t cr)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    struct upipe_hls_sink_segment *current = upipe_hls_sink->current;
+    if (current == NULL)
+        return;
+
+    if (cr == UINT64_MAX || cr < upipe_hls_sink->segment_start)
+        cr = upipe_hls_sink->segment_start;
+    if (upipe_hls_sink->part_duration)
+        upipe_hls_sink_close_part(upipe, cr, false);
+    current->duration = cr - upipe_hls_sink->segment_start;
+    if (current->duration) {
+        uint64_t bitrate = current->size * 8 * UCLOCK_FREQ / current->duration;
+        if (bitrate > upipe_hls_sink->max_bitrate)
+            upipe_hls_sink->max_bitrate = bitrate;
+    }
+
+    close(upipe_hls_sink->fd);
+    upipe_hls_sink->fd = -1;
+    upipe_hls_sink->current = NULL;
+    ulist_add(&upipe_hls_sink->segments, &current->uchain);
+    upipe_hls_sink->nb_segments++;
+    upipe_dbg_va(upipe, "closed segment %"PRIu64" (%"PRIu64" octets)",
+                 current->seq, current->size);
+    upipe_hls_sink_expire(upipe);
+}
+
+/** @internal @This opens a new segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param cr clock of the first packet of the segment
+ * @param independent true if the segment starts with a random access point
+ * @return an error code
+ */
+static int upipe_hls_sink_open_segment(struct upipe *upipe, uint64_t cr,
+                                       bool independent)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    struct upipe_hls_sink_segment *segment = malloc(sizeof(*segment));
+    UBASE_ALLOC_RETURN(segment);
+    uchain_init(&segment->uchain);
+    ulist_init(&segment->parts);
+    segment->seq = upipe_hls_sink->next_seq;
+    segment->duration = 0;
+    segment->size = 0;
+    segment->discontinuity = upipe_hls_sink->discontinuity;
+
+    char *path = upipe_hls_sink_path(upipe, "%s-%"PRIu64".ts",
+                                     upipe_hls_sink->name, segment->seq);
+    if (unlikely(path == NULL)) {
+        free(segment);
+        return UBASE_ERR_ALLOC;
+    }
+    upipe_hls_sink->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                              S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (unlikely(upipe_hls_sink->fd < 0)) {
+        upipe_err_va(upipe, "can't open %s (%m)", path);
+        free(path);
+        free(segment);
+        return UBASE_ERR_EXTERNAL;
+    }
+    free(path);
+
+    upipe_hls_sink->next_seq++;
+    upipe_hls_sink->discontinuity = false;
+    upipe_hls_sink->current = segment;
+    upipe_hls_sink->segment_start = cr;
+    upipe_hls_sink->part_start = cr;
+    upipe_hls_sink->part_offset = 0;
+    upipe_hls_sink->part_independent = independent;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This checks whether a buffer contains a random access point,
+ * either flagged by the upstream pipe or signalled in the adaptation field
+ * of a TS packet.
+ *
+ * @param uref uref structure
+ * @return true if the buffer contains a random access point
+ */
+static bool upipe_hls_sink_is_random(struct uref *uref)
+{
+    if (ubase_check(uref_flow_get_random(uref)))
+        return true;
+
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size))))
+        return false;
+    for (size_t offset = 0; offset + TS_HEADER_SIZE_AF <= size;
+         offset += TS_SIZE) {
+        uint8_t buffer[TS_HEADER_SIZE_AF];
+        const uint8_t *ts_header = uref_block_peek(uref, offset,
+                                                   TS_HEADER_SIZE_AF, buffer);
+        if (unlikely(ts_header == NULL))
+            return false;
+        bool random = ts_has_adaptation(ts_header) &&
+                      ts_get_adaptation(ts_header) &&
+                      tsaf_has_randomaccess(ts_header);
+        uref_block_peek_unmap(uref, offset, buffer, ts_header);
+        if (random)
+            return true;
+    }
+    return false;
+}
+
+/** @internal @This writes a buffer to the current segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @return an error code
+ */
+static int upipe_hls_sink_write(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    size_t size;
+    UBASE_RETURN(uref_block_size(uref, &size));
+    size_t offset = 0;
+
+    while (offset < size) {
+        int iovec_count = uref_block_iovec_count(uref, offset, -1);
+        if (unlikely(iovec_count <= 0))
+            return UBASE_ERR_INVALID;
+
+        struct iovec iovecs[iovec_count];
+        UBASE_RETURN(uref_block_iovec_read(uref, offset, -1, iovecs));
+        ssize_t ret = writev(upipe_hls_sink->fd, iovecs, iovec_count);
+        uref_block_iovec_unmap(uref, offset, -1, iovecs);
+
+        if (unlikely(ret < 0)) {
+            if (errno == EINTR)
+                continue;
+            upipe_err_va(upipe, "write error to segment %"PRIu64" (%m)",
+                         upipe_hls_sink->current->seq);
+            return UBASE_ERR_EXTERNAL;
+        }
+        offset += ret;
+    }
+    upipe_hls_sink->current->size += size;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This receives data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_hls_sink_input(struct upipe *upipe, struct uref *uref,
+                                 struct upump **upump_p)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    if (unlikely(upipe_hls_sink->dir == NULL)) {
+        upipe_warn(upipe, "received a buffer before opening a directory");
+        uref_free(uref);
+        return;
+    }
+
+    uint64_t cr = UINT64_MAX;
+    uref_clock_get_cr_sys(uref, &cr);
+    bool random = upipe_hls_sink_is_random(uref);
+    bool update = false;
+
+    if (ubase_check(uref_flow_get_discontinuity(uref))) {
+        if (upipe_hls_sink->current != NULL) {
+            upipe_hls_sink_close_segment(upipe, upipe_hls_sink->last_cr);
+            update = true;
+        }
+        upipe_hls_sink->discontinuity = true;
+    }
+
+    if (upipe_hls_sink->current != NULL && cr != UINT64_MAX) {
+        if (upipe_hls_sink->segment_start == UINT64_MAX) {
+            upipe_hls_sink->segment_start = cr;
+            upipe_hls_sink->part_start = cr;
+        } else if (random && cr >= upipe_hls_sink->segment_start +
+                                   upipe_hls_sink->target_duration) {
+            upipe_hls_sink_close_segment(upipe, cr);
+            update = true;
+        } else if (cr >= upipe_hls_sink->segment_start +
+                         upipe_hls_sink->max_target * UCLOCK_FREQ +
+                         MAX_OVERRUN) {
+            upipe_warn_va(upipe, "segment %"PRIu64" exceeds the target "
+                          "duration, cutting it without a random access "
+                          "point", upipe_hls_sink->current->seq);
+            upipe_hls_sink_close_segment(upipe, cr);
+            update = true;
+        } else if (upipe_hls_sink->part_duration &&
+                   cr >= upipe_hls_sink->part_start +
+                         upipe_hls_sink->part_duration) {
+            upipe_hls_sink_close_part(upipe, cr, random);
+            update = true;
+        }
+    }
+
+    if (upipe_hls_sink->current == NULL) {
+        if (!upipe_hls_sink->max_target) {
+            /* the first segment must start with a random access point */
+            if (!random) {
+                upipe_verbose(upipe, "waiting for a random access point");
+                uref_free(uref);
+                return;
+            }
+            /* the target duration must not change during the stream */
+            upipe_hls_sink->max_target =
+                (upipe_hls_sink->target_duration + UCLOCK_FREQ - 1) /
+                UCLOCK_FREQ;
+        }
+        if (unlikely(!ubase_check(upipe_hls_sink_open_segment(upipe, cr,
+                                                              random)))) {
+            uref_free(uref);
+            return;
+        }
+        update = true;
+    }
+
+    if (update) {
+        upipe_hls_sink_write_master(upipe);
+        upipe_hls_sink_write_playlist(upipe, false);
+    }
+
+    if (cr != UINT64_MAX)
+        upipe_hls_sink->last_cr = cr;
+    if (unlikely(!ubase_check(upipe_hls_sink_write(upipe, uref))))
+        upipe_throw_fatal(upipe, UBASE_ERR_EXTERNAL);
+    uref_free(uref);
+}
+
+/** @internal @This finishes the current stream and writes the final
+ * playlist.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hls_sink_flush(struct upipe *upipe)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    if (upipe_hls_sink->current == NULL)
+        return;
+
+    /* the duration of the last buffer is unknown */
+    upipe_hls_sink_close_segment(upipe, upipe_hls_sink->last_cr);
+    upipe_hls_sink_write_master(upipe);
+    upipe_hls_sink_write_playlist(upipe, true);
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_hls_sink_set_flow_def(struct upipe *upipe,
+                                       struct uref *flow_def)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    UBASE_RETURN(uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF));
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def_dup);
+
+    uint64_t value;
+    if (ubase_check(uref_m3u_playlist_flow_get_target_duration(flow_def,
+                                                               &value)) &&
+        value)
+        upipe_hls_sink->target_duration = value;
+    if (upipe_hls_sink->current == NULL &&
+        ubase_check(uref_m3u_playlist_flow_get_media_sequence(flow_def,
+                                                              &value)) &&
+        value > upipe_hls_sink->next_seq)
+        upipe_hls_sink->next_seq = value;
+
+    uref_free(upipe_hls_sink->flow_def);
+    upipe_hls_sink->flow_def = flow_def_dup;
+    upipe_hls_sink->master_written = false;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the output directory and playlist name.
+ *
+ * @param upipe description structure of the pipe
+ * @param dir output directory
+ * @param name base name of the media playlist and segments
+ * @return an error code
+ */
+static int _upipe_hls_sink_set_path(struct upipe *upipe,
+                                    const char *dir, const char *name)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    if (unlikely(dir == NULL || name == NULL))
+        return UBASE_ERR_INVALID;
+
+    upipe_hls_sink_flush(upipe);
+    char *dir_dup = strdup(dir);
+    char *name_dup = strdup(name);
+    if (unlikely(dir_dup == NULL || name_dup == NULL)) {
+        free(dir_dup);
+        free(name_dup);
+        return UBASE_ERR_ALLOC;
+    }
+    free(upipe_hls_sink->dir);
+    free(upipe_hls_sink->name);
+    upipe_hls_sink->dir = dir_dup;
+    upipe_hls_sink->name = name_dup;
+    upipe_hls_sink->master_written = false;
+    /* the segments of the previous playlist are not expired any more */
+    upipe_hls_sink_reset(upipe);
+    upipe_notice_va(upipe, "writing playlist %s/%s.m3u8", dir, name);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the master playlist file name.
+ *
+ * @param upipe description structure of the pipe
+ * @param master file name or NULL
+ * @return an error code
+ */
+static int _upipe_hls_sink_set_master(struct upipe *upipe, const char *master)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    char *master_dup = NULL;
+    if (master != NULL) {
+        master_dup = strdup(master);
+        UBASE_ALLOC_RETURN(master_dup);
+    }
+    free(upipe_hls_sink->master);
+    upipe_hls_sink->master = master_dup;
+    upipe_hls_sink->master_written = false;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a hls sink pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_hls_sink_control(struct upipe *upipe, int command,
+                                  va_list args)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_hls_sink_set_flow_def(upipe, flow_def);
+        }
+
+        case UPIPE_HLS_SINK_SET_PATH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_SINK_SIGNATURE)
+            const char *dir = va_arg(args, const char *);
+            const char *name = va_arg(args, const char *);
+            return _upipe_hls_sink_set_path(upipe, dir, name);
+        }
+        case UPIPE_HLS_SINK_SET_MASTER: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_SINK_SIGNATURE)
+            const char *master = va_arg(args, const char *);
+            return _upipe_hls_sink_set_master(upipe, master);
+        }
+        case UPIPE_HLS_SINK_SET_TARGET_DURATION: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_SINK_SIGNATURE)
+            uint64_t duration = va_arg(args, uint64_t);
+            if (unlikely(!duration))
+                return UBASE_ERR_INVALID;
+            upipe_hls_sink->target_duration = duration;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_HLS_SINK_SET_PART_DURATION: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_SINK_SIGNATURE)
+            uint64_t duration = va_arg(args, uint64_t);
+            if (unlikely(duration > upipe_hls_sink->target_duration))
+                return UBASE_ERR_INVALID;
+            upipe_hls_sink->part_duration = duration;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_HLS_SINK_SET_WINDOW: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_SINK_SIGNATURE)
+            upipe_hls_sink->window = va_arg(args, unsigned int);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This frees a hls sink pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hls_sink_free(struct upipe *upipe)
+{
+    struct upipe_hls_sink *upipe_hls_sink = upipe_hls_sink_from_upipe(upipe);
+    upipe_hls_sink_flush(upipe);
+    upipe_throw_dead(upipe);
+
+    upipe_hls_sink_reset(upipe);
+    uref_free(upipe_hls_sink->flow_def);
+    free(upipe_hls_sink->dir);
+    free(upipe_hls_sink->name);
+    free(upipe_hls_sink->master);
+    upipe_hls_sink_clean_urefcount(upipe);
+    upipe_hls_sink_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_hls_sink_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_HLS_SINK_SIGNATURE,
+
+    .upipe_alloc = upipe_hls_sink_alloc,
+    .upipe_input = upipe_hls_sink_input,
+    .upipe_control = upipe_hls_sink_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for hls sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_hls_sink_mgr_alloc(void)
+{
+    return &upipe_hls_sink_mgr;
+}
@@ -290,6 +290,7 @@ static void upipe_hls_variant_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_hls_variant *upipe_hls_variant =
         upipe_hls_variant_from_upipe(upipe);
+    upipe_mgr_init(&upipe_hls_variant->sub_mgr);
     upipe_hls_variant->sub_mgr.signature = UPIPE_HLS_VARIANT_SUB_SIGNATURE;
     upipe_hls_variant->sub_mgr.refcount = upipe->refcount;
     upipe_hls_variant->sub_mgr.upipe_alloc = upipe_hls_variant_sub_alloc;
@@ -489,6 +489,7 @@ static int probe_src(struct uprobe *uprobe, struct upipe *inner,
 static void upipe_hls_void_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_hls_void *upipe_hls_void = upipe_hls_void_from_upipe(upipe);
+    upipe_mgr_init(&upipe_hls_void->sub_mgr);
     upipe_hls_void->sub_mgr.refcount = &upipe_hls_void->urefcount_real;
     upipe_hls_void->sub_mgr.signature = UPIPE_HLS_VOID_SUB_SIGNATURE;
     upipe_hls_void->sub_mgr.upipe_alloc = upipe_hls_void_sub_alloc;
@@ -1,3 +1,13 @@
+configs += recvmmsg
+recvmmsg-cppflags = -D_GNU_SOURCE
+recvmmsg-includes = sys/socket.h
+recvmmsg-functions = recvmmsg
+
+configs += sendmmsg
+sendmmsg-cppflags = -D_GNU_SOURCE
+sendmmsg-includes = sys/socket.h
+sendmmsg-functions = sendmmsg
+
 lib-targets = libupipe_modules
 
 libupipe_modules-desc = base modules
@@ -5,6 +15,7 @@ libupipe_modules-so-version = 1.0.0
 
 libupipe_modules-includes = \
     upipe_aes_decrypt.h \
+    upipe_aes_encrypt.h \
     upipe_aggregate.h \
     upipe_audio_blank.h \
     upipe_audio_copy.h \
@@ -87,7 +98,12 @@ libupipe_modules-includes = \
     uref_http_flow.h
 
 libupipe_modules-src = \
+    aes.c \
+    aes.h \
+    aes_aarch64.c \
+    aes_x86.c \
     upipe_aes_decrypt.c \
+    upipe_aes_encrypt.c \
     upipe_aggregate.c \
     upipe_audio_blank.c \
     upipe_audio_copy.c \
@@ -0,0 +1,41 @@
+/*
+ * AES-128 CBC kernels
+ *
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _AES_H_
+/** @hidden */
+#define _AES_H_
+
+#include <stdint.h>
+
+/** size of the expanded AES-128 key (11 round keys) */
+#define UPIPE_AES128_ROUND_KEYS_SIZE 176
+
+/* expand a 16-octet key into 11 round keys, in FIPS-197 octet order */
+void upipe_aes128_expand_key(const uint8_t *key, uint8_t *round_keys);
+
+/* decrypt blocks of 16 octets in place; iv is updated with the last
+ * ciphertext block so that calls can be chained */
+void upipe_aes128_cbc_decrypt_c    (uint8_t *buf, uintptr_t blocks, const uint8_t *round_keys, uint8_t *iv);
+void upipe_aes128_cbc_decrypt_aesni(uint8_t *buf, uintptr_t blocks, const uint8_t *round_keys, uint8_t *iv);
+void upipe_aes128_cbc_decrypt_vaes (uint8_t *buf, uintptr_t blocks, const uint8_t *round_keys, uint8_t *iv);
+void upipe_aes128_cbc_decrypt_armv8(uint8_t *buf, uintptr_t blocks, const uint8_t *round_keys, uint8_t *iv);
+
+/* encrypt blocks of 16 octets in place; iv is updated with the last
+ * ciphertext block so that calls can be chained */
+void upipe_aes128_cbc_encrypt_c    (uint8_t *buf, uintptr_t blocks, const uint8_t *round_keys, uint8_t *iv);
+void upipe_aes128_cbc_encrypt_aesni(uint8_t *buf, uintptr_t blocks, const uint8_t *round_keys, uint8_t *iv);
+void upipe_aes128_cbc_encrypt_armv8(uint8_t *buf, uintptr_t blocks, const uint8_t *round_keys, uint8_t *iv);
+
+typedef void (*upipe_aes128_cbc_func)(uint8_t *buf, uintptr_t blocks,
+                                      const uint8_t *round_keys, uint8_t *iv);
+
+/* return the fastest kernels supported by the CPU */
+upipe_aes128_cbc_func upipe_aes128_cbc_decrypt_select(void);
+upipe_aes128_cbc_func upipe_aes128_cbc_encrypt_select(void);
+
+#endif
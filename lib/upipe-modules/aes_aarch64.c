@@ -0,0 +1,87 @@
+/*
+ * AES-128 CBC kernels for ARMv8 (cryptography extension)
+ *
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short AES-128 CBC kernels using the ARMv8 AES instructions
+ * CBC decryption has no dependency between blocks, so several blocks are
+ * kept in flight to hide the latency of the AES instructions. CBC encryption
+ * is serial by nature.
+ */
+
+#include "aes.h"
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#include <arm_neon.h>
+
+/** number of blocks decrypted in parallel */
+#define ARMV8_LANES 4
+
+__attribute__((target("arch=armv8-a+crypto")))
+void upipe_aes128_cbc_decrypt_armv8(uint8_t *buf, uintptr_t blocks,
+                                    const uint8_t *round_keys, uint8_t *iv)
+{
+    /* AESD xors the round key before the inverse substitution, so rounds
+     * 9 to 1 need the keys of the equivalent inverse cipher */
+    uint8x16_t k[11];
+    k[0] = vld1q_u8(round_keys);
+    for (unsigned i = 1; i < 10; i++)
+        k[i] = vaesimcq_u8(vld1q_u8(round_keys + 16 * i));
+    k[10] = vld1q_u8(round_keys + 160);
+    uint8x16_t prev = vld1q_u8(iv);
+
+    for ( ; blocks >= ARMV8_LANES; blocks -= ARMV8_LANES,
+                                   buf += 16 * ARMV8_LANES) {
+        uint8x16_t c[ARMV8_LANES], x[ARMV8_LANES];
+        for (unsigned j = 0; j < ARMV8_LANES; j++) {
+            c[j] = vld1q_u8(buf + 16 * j);
+            x[j] = vaesdq_u8(c[j], k[10]);
+        }
+        for (unsigned r = 9; r > 0; r--)
+            for (unsigned j = 0; j < ARMV8_LANES; j++)
+                x[j] = vaesdq_u8(vaesimcq_u8(x[j]), k[r]);
+        for (unsigned j = 0; j < ARMV8_LANES; j++) {
+            x[j] = veorq_u8(x[j], k[0]);
+            vst1q_u8(buf + 16 * j, veorq_u8(x[j], j ? c[j - 1] : prev));
+        }
+        prev = c[ARMV8_LANES - 1];
+    }
+
+    for ( ; blocks; blocks--, buf += 16) {
+        uint8x16_t c = vld1q_u8(buf);
+        uint8x16_t x = vaesdq_u8(c, k[10]);
+        for (unsigned r = 9; r > 0; r--)
+            x = vaesdq_u8(vaesimcq_u8(x), k[r]);
+        x = veorq_u8(x, k[0]);
+        vst1q_u8(buf, veorq_u8(x, prev));
+        prev = c;
+    }
+
+    vst1q_u8(iv, prev);
+}
+
+__attribute__((target("arch=armv8-a+crypto")))
+void upipe_aes128_cbc_encrypt_armv8(uint8_t *buf, uintptr_t blocks,
+                                    const uint8_t *round_keys, uint8_t *iv)
+{
+    uint8x16_t k[11];
+    for (unsigned i = 0; i < 11; i++)
+        k[i] = vld1q_u8(round_keys + 16 * i);
+    uint8x16_t x = vld1q_u8(iv);
+
+    for ( ; blocks; blocks--, buf += 16) {
+        x = veorq_u8(x, vld1q_u8(buf));
+        for (unsigned r = 0; r < 9; r++)
+            x = vaesmcq_u8(vaeseq_u8(x, k[r]));
+        x = veorq_u8(vaeseq_u8(x, k[9]), k[10]);
+        vst1q_u8(buf, x);
+    }
+
+    vst1q_u8(iv, x);
+}
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ * AES-128 CBC kernels for x86 (AES-NI and VAES)
+ *
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short AES-128 CBC kernels using the x86 AES instructions
+ * CBC decryption has no dependency between blocks, so several blocks are
+ * kept in flight to hide the latency of the AES instructions. CBC encryption
+ * is serial by nature.
+ */
+
+#include "aes.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+/** number of blocks decrypted in parallel */
+#define AESNI_LANES 8
+
+/** @internal @This loads the round keys for the equivalent inverse cipher.
+ *
+ * @param round_keys the generated round keys
+ * @param k filled in with the decryption round keys
+ */
+__attribute__((target("aes,sse2")))
+static inline void aesni_dec_keys(const uint8_t *round_keys, __m128i k[11])
+{
+    k[0] = _mm_loadu_si128((const __m128i *)round_keys);
+    for (unsigned i = 1; i < 10; i++)
+        k[i] = _mm_aesimc_si128(
+                _mm_loadu_si128((const __m128i *)(round_keys + 16 * i)));
+    k[10] = _mm_loadu_si128((const __m128i *)(round_keys + 160));
+}
+
+__attribute__((target("aes,sse2")))
+void upipe_aes128_cbc_decrypt_aesni(uint8_t *buf, uintptr_t blocks,
+                                    const uint8_t *round_keys, uint8_t *iv)
+{
+    __m128i k[11];
+    aesni_dec_keys(round_keys, k);
+    __m128i prev = _mm_loadu_si128((const __m128i *)iv);
+
+    for ( ; blocks >= AESNI_LANES; blocks -= AESNI_LANES,
+                                   buf += 16 * AESNI_LANES) {
+        __m128i c[AESNI_LANES], x[AESNI_LANES];
+        for (unsigned j = 0; j < AESNI_LANES; j++) {
+            c[j] = _mm_loadu_si128((const __m128i *)(buf + 16 * j));
+            x[j] = _mm_xor_si128(c[j], k[10]);
+        }
+        for (unsigned r = 9; r > 0; r--)
+            for (unsigned j = 0; j < AESNI_LANES; j++)
+                x[j] = _mm_aesdec_si128(x[j], k[r]);
+        for (unsigned j = 0; j < AESNI_LANES; j++) {
+            x[j] = _mm_aesdeclast_si128(x[j], k[0]);
+            x[j] = _mm_xor_si128(x[j], j ? c[j - 1] : prev);
+            _mm_storeu_si128((__m128i *)(buf + 16 * j), x[j]);
+        }
+        prev = c[AESNI_LANES - 1];
+    }
+
+    for ( ; blocks; blocks--, buf += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)buf);
+        __m128i x = _mm_xor_si128(c, k[10]);
+        for (unsigned r = 9; r > 0; r--)
+            x = _mm_aesdec_si128(x, k[r]);
+        x = _mm_aesdeclast_si128(x, k[0]);
+        _mm_storeu_si128((__m128i *)buf, _mm_xor_si128(x, prev));
+        prev = c;
+    }
+
+    _mm_storeu_si128((__m128i *)iv, prev);
+}
+
+__attribute__((target("aes,sse2")))
+void upipe_aes128_cbc_encrypt_aesni(uint8_t *buf, uintptr_t blocks,
+                                    const uint8_t *round_keys, uint8_t *iv)
+{
+    __m128i k[11];
+    for (unsigned i = 0; i < 11; i++)
+        k[i] = _mm_loadu_si128((const __m128i *)(round_keys + 16 * i));
+    __m128i x = _mm_loadu_si128((const __m128i *)iv);
+
+    for ( ; blocks; blocks--, buf += 16) {
+        x = _mm_xor_si128(x, _mm_loadu_si128((const __m128i *)buf));
+        x = _mm_xor_si128(x, k[0]);
+        for (unsigned r = 1; r < 10; r++)
+            x = _mm_aesenc_si128(x, k[r]);
+        x = _mm_aesenclast_si128(x, k[10]);
+        _mm_storeu_si128((__m128i *)buf, x);
+    }
+
+    _mm_storeu_si128((__m128i *)iv, x);
+}
+
+/** number of 256-bit registers, each holding 2 blocks, decrypted in
+ * parallel */
+#define VAES_LANES 4
+
+__attribute__((target("aes,vaes,avx2")))
+void upipe_aes128_cbc_decrypt_vaes(uint8_t *buf, uintptr_t blocks,
+                                   const uint8_t *round_keys, uint8_t *iv)
+{
+    __m128i k128[11];
+    aesni_dec_keys(round_keys, k128);
+    __m256i k[11];
+    for (unsigned i = 0; i < 11; i++)
+        k[i] = _mm256_broadcastsi128_si256(k128[i]);
+    __m128i prev = _mm_loadu_si128((const __m128i *)iv);
+
+    for ( ; blocks >= 2 * VAES_LANES; blocks -= 2 * VAES_LANES,
+                                      buf += 32 * VAES_LANES) {
+        __m256i c[VAES_LANES], p[VAES_LANES], x[VAES_LANES];
+        /* previous ciphertext blocks, read before decrypting in place */
+        p[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(prev),
+                _mm_loadu_si128((const __m128i *)buf), 1);
+        for (unsigned j = 0; j < VAES_LANES; j++) {
+            c[j] = _mm256_loadu_si256((const __m256i *)(buf + 32 * j));
+            if (j)
+                p[j] = _mm256_loadu_si256(
+                        (const __m256i *)(buf + 32 * j - 16));
+            x[j] = _mm256_xor_si256(c[j], k[10]);
+        }
+        for (unsigned r = 9; r > 0; r--)
+            for (unsigned j = 0; j < VAES_LANES; j++)
+                x[j] = _mm256_aesdec_epi128(x[j], k[r]);
+        for (unsigned j = 0; j < VAES_LANES; j++) {
+            x[j] = _mm256_aesdeclast_epi128(x[j], k[0]);
+            x[j] = _mm256_xor_si256(x[j], p[j]);
+            _mm256_storeu_si256((__m256i *)(buf + 32 * j), x[j]);
+        }
+        prev = _mm256_extracti128_si256(c[VAES_LANES - 1], 1);
+    }
+
+    _mm_storeu_si128((__m128i *)iv, prev);
+    if (blocks)
+        upipe_aes128_cbc_decrypt_aesni(buf, blocks, round_keys, iv);
+}
+
+#endif
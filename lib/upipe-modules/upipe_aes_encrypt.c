@@ -0,0 +1,436 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe module encrypting block flows with AES-128 in CBC mode
+ */
+
+#include "upipe-modules/upipe_aes_encrypt.h"
+#include "upipe/upipe_helper_uref_stream.h"
+#include "upipe/upipe_helper_output.h"
+#include "upipe/upipe_helper_void.h"
+#include "upipe/upipe_helper_urefcount.h"
+#include "upipe/upipe_helper_upipe.h"
+#include "upipe/upipe.h"
+#include "upipe-modules/uref_aes_flow.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_flow.h"
+#include "upipe/urefcount.h"
+
+#include "aes.h"
+
+#include <string.h>
+
+#define EXPECTED_FLOW_DEF       "block."
+
+/** @internal @This is the private context of an aes encrypt pipe. */
+struct upipe_aes_encrypt {
+    /** pipe public structure */
+    struct upipe upipe;
+    /** refcounting structure */
+    struct urefcount urefcount;
+    /** reference to the output pipe */
+    struct upipe *output;
+    /** reference to the output flow format */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain requests;
+    /** next uref */
+    struct uref *next_uref;
+    /** next uref size */
+    size_t next_uref_size;
+    /** list of uref */
+    struct uchain urefs;
+    /** padding? */
+    enum upipe_aes_encrypt_padding padding;
+    /** bypass encryption */
+    bool encrypt;
+    /** store round keys */
+    uint8_t round_keys[UPIPE_AES128_ROUND_KEYS_SIZE];
+    /** store initialization vector */
+    uint8_t iv[16];
+    /** CBC encryption kernel */
+    upipe_aes128_cbc_func cbc_encrypt;
+};
+
+UPIPE_HELPER_UPIPE(upipe_aes_encrypt, upipe, UPIPE_AES_ENCRYPT_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_aes_encrypt, urefcount, upipe_aes_encrypt_no_ref);
+UPIPE_HELPER_VOID(upipe_aes_encrypt);
+UPIPE_HELPER_OUTPUT(upipe_aes_encrypt, output, flow_def, output_state,
+                    requests);
+UPIPE_HELPER_UREF_STREAM(upipe_aes_encrypt, next_uref, next_uref_size, urefs,
+                         NULL);
+
+/** @internal @This allocates an aes encryption pipe.
+ *
+ * @param mgr reference to the aes encryption pipe manager.
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args arguments
+ * @return pointer to allocated pipe, or NULL in case of failure
+ */
+static struct upipe *upipe_aes_encrypt_alloc(struct upipe_mgr *mgr,
+                                             struct uprobe *uprobe,
+                                             uint32_t signature,
+                                             va_list args)
+{
+    struct upipe *upipe =
+        upipe_aes_encrypt_alloc_void(mgr, uprobe, signature, args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_aes_encrypt *upipe_aes_encrypt =
+        upipe_aes_encrypt_from_upipe(upipe);
+
+    upipe_aes_encrypt_init_urefcount(upipe);
+    upipe_aes_encrypt_init_output(upipe);
+    upipe_aes_encrypt_init_uref_stream(upipe);
+    upipe_aes_encrypt->encrypt = false;
+    upipe_aes_encrypt->padding = UPIPE_AES_ENCRYPT_PADDING_NONE;
+    upipe_aes_encrypt->cbc_encrypt = upipe_aes128_cbc_encrypt_select();
+
+    upipe_throw_ready(upipe);
+
+    return upipe;
+}
+
+/** @internal @This frees an aes encryption pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_aes_encrypt_no_ref(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_aes_encrypt_clean_uref_stream(upipe);
+    upipe_aes_encrypt_clean_output(upipe);
+    upipe_aes_encrypt_clean_urefcount(upipe);
+    upipe_aes_encrypt_free_void(upipe);
+}
+
+/** @internal @This restarts encryption algorithm.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def new input flow definition
+ */
+static void upipe_aes_encrypt_set_flow_def_real(struct upipe *upipe,
+                                                struct uref *flow_def)
+{
+    struct upipe_aes_encrypt *upipe_aes_encrypt =
+        upipe_aes_encrypt_from_upipe(upipe);
+
+    const uint8_t *key;
+    size_t key_size;
+    if (ubase_check(uref_aes_get_key(flow_def, &key, &key_size))) {
+        assert(key_size == 16);
+
+        const uint8_t *iv;
+        size_t iv_size;
+        ubase_assert(uref_aes_get_iv(flow_def, &iv, &iv_size));
+        assert(iv_size == 16);
+
+        memcpy(upipe_aes_encrypt->iv, iv, 16);
+        upipe_aes128_expand_key(key, upipe_aes_encrypt->round_keys);
+        upipe_aes_encrypt->encrypt = true;
+
+        const char *def;
+        ubase_assert(uref_flow_get_def(flow_def, &def));
+        if (!ubase_check(uref_flow_set_def_va(flow_def, "block.aes.%s",
+                            def + strlen(EXPECTED_FLOW_DEF))) ||
+            !ubase_check(uref_aes_set_method(flow_def, "AES-128")))
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+    }
+    else {
+        upipe_aes_encrypt->encrypt = false;
+    }
+
+    upipe_aes_encrypt_store_flow_def(upipe, flow_def);
+}
+
+/** @internal @This appends PKCS-7 padding to a uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref to pad
+ * @param size current size of the uref
+ * @return an error code
+ */
+static int upipe_aes_encrypt_pad(struct upipe *upipe, struct uref *uref,
+                                 size_t size)
+{
+    uint8_t padding = 16 - size % 16;
+    struct ubuf *ubuf = ubuf_block_alloc(uref->ubuf->mgr, padding);
+    UBASE_ALLOC_RETURN(ubuf);
+
+    int wsize = -1;
+    uint8_t *wbuf;
+    int err = ubuf_block_write(ubuf, 0, &wsize, &wbuf);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_free(ubuf);
+        return err;
+    }
+    memset(wbuf, padding, wsize);
+    ubuf_block_unmap(ubuf, 0);
+
+    err = uref_block_append(uref, ubuf);
+    if (unlikely(!ubase_check(err)))
+        ubuf_free(ubuf);
+    return err;
+}
+
+/** @internal @This outputs the encrypted blocks.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to the pump that generated the buffer
+ * @param eos true if this is the end of the flow
+ */
+static void upipe_aes_encrypt_worker(struct upipe *upipe,
+                                     struct upump **upump_p,
+                                     bool eos)
+{
+    struct upipe_aes_encrypt *upipe_aes_encrypt =
+        upipe_aes_encrypt_from_upipe(upipe);
+
+    size_t size = 0;
+    if (upipe_aes_encrypt->next_uref)
+        uref_block_size(upipe_aes_encrypt->next_uref, &size);
+    if (!size)
+        return;
+
+    bool pad = eos &&
+        upipe_aes_encrypt->padding != UPIPE_AES_ENCRYPT_PADDING_NONE;
+    size_t blocks = size / 16;
+    if (!eos &&
+        upipe_aes_encrypt->padding != UPIPE_AES_ENCRYPT_PADDING_NONE &&
+        !(size % 16))
+        /* keep last block in case it's the last one and we need to add
+         * padding */
+        blocks--;
+
+    if (eos && !pad && size % 16) {
+        upipe_warn_va(upipe, "dropping %zu trailing octets", size % 16);
+        if (!blocks) {
+            upipe_aes_encrypt_consume_uref_stream(upipe, size);
+            return;
+        }
+    }
+
+    if (!blocks && !pad)
+        return;
+
+    struct uref *uref =
+        upipe_aes_encrypt_extract_uref_stream(upipe,
+                                              pad ? size : blocks * 16);
+    if (unlikely(!uref)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
+        return;
+    }
+    if (eos && !pad && size % 16)
+        upipe_aes_encrypt_consume_uref_stream(upipe, size % 16);
+
+    if (pad) {
+        if (unlikely(!ubase_check(upipe_aes_encrypt_pad(upipe, uref,
+                                                        size)))) {
+            upipe_err(upipe, "fail to add padding");
+            uref_free(uref);
+            return;
+        }
+        blocks = size / 16 + 1;
+    }
+
+    size_t linear_size = 0;
+    uref_block_size_linear(uref, 0, &linear_size);
+
+    if (linear_size < blocks * 16 &&
+        !ubase_check(uref_block_merge(uref, uref->ubuf->mgr, 0, -1))) {
+        upipe_err(upipe, "fail to merge block");
+        uref_free(uref);
+        return;
+    }
+
+    int wsize = blocks * 16;
+    uint8_t *wbuf;
+    int ret = uref_block_write(uref, 0, &wsize, &wbuf);
+    if (!ubase_check(ret)) {
+        ret = uref_block_merge(uref, uref->ubuf->mgr, 0, -1);
+        if (ubase_check(ret))
+            ret = uref_block_write(uref, 0, &wsize, &wbuf);
+    }
+    if (unlikely(!ubase_check(ret))) {
+        upipe_err(upipe, "write failed");
+        uref_free(uref);
+        return;
+    }
+
+    if (wsize != blocks * 16) {
+        upipe_err_va(upipe, "invalid write size %i, expected %zu",
+                  wsize, blocks * 16);
+        uref_block_unmap(uref, 0);
+        uref_free(uref);
+        return;
+    }
+
+    upipe_aes_encrypt->cbc_encrypt(wbuf, blocks,
+                                   upipe_aes_encrypt->round_keys,
+                                   upipe_aes_encrypt->iv);
+
+    uref_block_unmap(uref, 0);
+
+    /* the extracted uref carries the attributes of the first buffer */
+    if (eos)
+        uref_block_set_end(uref);
+    else
+        uref_block_delete_end(uref);
+    upipe_aes_encrypt_output(upipe, uref, upump_p);
+}
+
+/** @internal @This is called when there is new data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref carrying the data
+ * @param upump_p reference to the pump that generated the buffer
+ */
+static void upipe_aes_encrypt_input(struct upipe *upipe,
+                                    struct uref *uref,
+                                    struct upump **upump_p)
+{
+    struct upipe_aes_encrypt *upipe_aes_encrypt =
+        upipe_aes_encrypt_from_upipe(upipe);
+
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        upipe_aes_encrypt_worker(upipe, upump_p, true);
+        upipe_aes_encrypt_set_flow_def_real(upipe, uref);
+        return;
+    }
+
+    if (!upipe_aes_encrypt->encrypt)
+        upipe_aes_encrypt_output(upipe, uref, upump_p);
+    else {
+        bool eos = ubase_check(uref_block_get_end(uref));
+        upipe_aes_encrypt_append_uref_stream(upipe, uref);
+        upipe_aes_encrypt_worker(upipe, upump_p, eos);
+    }
+}
+
+/** @internal @This sets the input flow format.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def the flow format to set
+ * @return an error code
+ */
+static int upipe_aes_encrypt_set_flow_def(struct upipe *upipe,
+                                          struct uref *flow_def)
+{
+    UBASE_RETURN(uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF));
+
+    const uint8_t *key;
+    size_t key_size;
+    if (ubase_check(uref_aes_get_key(flow_def, &key, &key_size))) {
+        const char *method;
+        if (ubase_check(uref_aes_get_method(flow_def, &method)))
+            UBASE_RETURN(uref_aes_match_method(flow_def, "AES-128"));
+        if (key_size != 16) {
+            upipe_warn(upipe, "invalid key");
+            return UBASE_ERR_INVALID;
+        }
+        const uint8_t *iv;
+        size_t iv_size;
+        UBASE_RETURN(uref_aes_get_iv(flow_def, &iv, &iv_size));
+        if (iv_size != 16) {
+            upipe_warn(upipe, "invalid IV");
+            return UBASE_ERR_INVALID;
+        }
+    }
+
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def_dup);
+    upipe_input(upipe, flow_def_dup, NULL);
+    return UBASE_ERR_NONE;
+}
+
+/** @This sets PKCS-7 padding support.
+ *
+ * @param upipe description structure of the pipe
+ * @param type padding type to use
+ * @return an error code
+ */
+static int _upipe_aes_encrypt_set_padding(struct upipe *upipe,
+                                          enum upipe_aes_encrypt_padding type)
+{
+    struct upipe_aes_encrypt *upipe_aes_encrypt =
+        upipe_aes_encrypt_from_upipe(upipe);
+    upipe_aes_encrypt->padding = type;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This dispatches commands.
+ *
+ * @param upipe description structure of the pipe
+ * @param command command to dispatch
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_aes_encrypt_control(struct upipe *upipe,
+                                     int command,
+                                     va_list args)
+{
+    switch (command) {
+    case UPIPE_REGISTER_REQUEST: {
+        struct urequest *urequest = va_arg(args, struct urequest *);
+        if (urequest->type == UREQUEST_UBUF_MGR ||
+            urequest->type == UREQUEST_FLOW_FORMAT)
+            return upipe_throw_provide_request(upipe, urequest);
+        return upipe_aes_encrypt_alloc_output_proxy(upipe, urequest);
+    }
+    case UPIPE_UNREGISTER_REQUEST: {
+        struct urequest *urequest = va_arg(args, struct urequest *);
+        if (urequest->type == UREQUEST_UBUF_MGR ||
+            urequest->type == UREQUEST_FLOW_FORMAT)
+            return UBASE_ERR_NONE;
+        return upipe_aes_encrypt_free_output_proxy(upipe, urequest);
+    }
+    case UPIPE_GET_OUTPUT:
+    case UPIPE_SET_OUTPUT:
+    case UPIPE_GET_FLOW_DEF:
+        return upipe_aes_encrypt_control_output(upipe, command, args);
+    case UPIPE_SET_FLOW_DEF: {
+        struct uref *flow_def = va_arg(args, struct uref *);
+        return upipe_aes_encrypt_set_flow_def(upipe, flow_def);
+    }
+    }
+
+    if (command < UPIPE_CONTROL_LOCAL ||
+        ubase_get_signature(args) != UPIPE_AES_ENCRYPT_SIGNATURE)
+        return UBASE_ERR_UNHANDLED;
+
+    switch (command) {
+        case UPIPE_AES_ENCRYPT_SET_PADDING:
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AES_ENCRYPT_SIGNATURE);
+            enum upipe_aes_encrypt_padding type =
+                va_arg(args, enum upipe_aes_encrypt_padding);
+            return _upipe_aes_encrypt_set_padding(upipe, type);
+    }
+    return UBASE_ERR_UNHANDLED;
+}
+
+/** @internal @This is the static aes encryption pipe manager. */
+static struct upipe_mgr upipe_aes_encrypt_mgr = {
+    .signature = UPIPE_AES_ENCRYPT_SIGNATURE,
+    .refcount = NULL,
+    .upipe_alloc = upipe_aes_encrypt_alloc,
+    .upipe_input = upipe_aes_encrypt_input,
+    .upipe_control = upipe_aes_encrypt_control,
+};
+
+/** @This returns the static aes encryption pipe manager.
+ *
+ * @return a reference to the static aes encryption pipe manager
+ */
+struct upipe_mgr *upipe_aes_encrypt_mgr_alloc(void)
+{
+    return &upipe_aes_encrypt_mgr;
+}
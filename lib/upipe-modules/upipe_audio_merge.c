@@ -493,6 +493,7 @@ static void upipe_audio_merge_init_sub_mgr(struct upipe *upipe)
     struct upipe_audio_merge *upipe_audio_merge =
                               upipe_audio_merge_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_audio_merge->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_audio_merge_to_urefcount_real(upipe_audio_merge);
     sub_mgr->signature = UPIPE_AUDIO_MERGE_INPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_audio_merge_sub_alloc;
@@ -359,6 +359,7 @@ static void upipe_audio_split_init_sub_mgr(struct upipe *upipe)
     struct upipe_audio_split *upipe_audio_split =
                               upipe_audio_split_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_audio_split->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_audio_split_to_urefcount_real(upipe_audio_split);
     sub_mgr->signature = UPIPE_AUDIO_SPLIT_OUTPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_audio_split_sub_alloc;
@@ -541,6 +541,7 @@ static void upipe_audiocont_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_audiocont *upipe_audiocont = upipe_audiocont_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_audiocont->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_audiocont_to_urefcount(upipe_audiocont);
     sub_mgr->signature = UPIPE_AUDIOCONT_SUB_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_audiocont_sub_alloc;
@@ -363,6 +363,7 @@ struct upipe_mgr *upipe_autoin_mgr_alloc(void)
 
     upipe_autoin_mgr_init_urefcount(upipe_autoin_mgr);
     ulist_init(&upipe_autoin_mgr->inner_mgrs);
+    upipe_mgr_init(mgr);
     mgr->refcount = upipe_autoin_mgr_to_urefcount(upipe_autoin_mgr);
     mgr->signature = UPIPE_AUTOIN_SIGNATURE;
     mgr->upipe_err_str = NULL;
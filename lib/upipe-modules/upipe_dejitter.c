@@ -191,6 +191,7 @@ static void upipe_dejitter_init_sub_mgr(struct upipe *upipe)
     struct upipe_dejitter *upipe_dejitter =
         upipe_dejitter_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_dejitter->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_dejitter_to_urefcount(upipe_dejitter);
     sub_mgr->signature = UPIPE_DEJITTER_SUB_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_dejitter_sub_alloc;
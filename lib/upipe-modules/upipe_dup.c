@@ -168,6 +168,7 @@ static void upipe_dup_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_dup *upipe_dup = upipe_dup_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_dup->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_dup_to_urefcount_real(upipe_dup);
     sub_mgr->signature = UPIPE_DUP_OUTPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_dup_output_alloc;
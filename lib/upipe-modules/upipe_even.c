@@ -355,6 +355,7 @@ static void upipe_even_init_sub_mgr(struct upipe *upipe)
     struct upipe_even *upipe_even =
         upipe_even_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_even->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_even_to_urefcount(upipe_even);
     sub_mgr->signature = UPIPE_EVEN_SUB_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_even_sub_alloc;
@@ -19,6 +19,7 @@
 #include "upipe/uref_block.h"
 #include "upipe/uref_block_flow.h"
 #include "upipe/uref_clock.h"
+#include "upipe/ubuf_block_mmap.h"
 #include "upipe/upump.h"
 #include "upipe/upipe.h"
 #include "upipe/upipe_helper_upipe.h"
@@ -32,6 +33,7 @@
 #include "upipe/upipe_helper_uclock.h"
 #include "upipe/upipe_helper_output_size.h"
 #include "upipe-modules/upipe_file_source.h"
+#include "upump-uring/upump_uring.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -49,6 +51,8 @@
 
 /** default size of buffers when unspecified */
 #define UBUF_DEFAULT_SIZE       32768
+/** depth of the pool of the mmap ubuf manager */
+#define UBUF_POOL_DEPTH         32
 
 /** @hidden */
 static int upipe_fsrc_check(struct upipe *upipe, struct uref *flow_format);
@@ -101,6 +105,20 @@ struct upipe_fsrc {
     /** length to read */
     uint64_t length;
 
+    /** true if the pump is an io_uring read pump */
+    bool uring;
+    /** uref being filled in by the io_uring read pump */
+    struct uref *uring_uref;
+    /** reading position of the io_uring read pump, for regular files */
+    uint64_t position;
+
+    /** size of the mapped windows, or 0 */
+    uint64_t mmap_window;
+    /** true if the file is mapped instead of being read */
+    bool mmap;
+    /** ubuf manager pointing to the mapped file */
+    struct ubuf_mgr *mmap_mgr;
+
     /** public upipe structure */
     struct upipe upipe;
     /** guard for upump */
@@ -155,6 +173,12 @@ static struct upipe *upipe_fsrc_alloc(struct upipe_mgr *mgr,
     upipe_fsrc->uri = NULL;
     upipe_fsrc->fd = -1;
     upipe_fsrc->length = (uint64_t)-1;
+    upipe_fsrc->uring = false;
+    upipe_fsrc->uring_uref = NULL;
+    upipe_fsrc->position = 0;
+    upipe_fsrc->mmap_window = 0;
+    upipe_fsrc->mmap = false;
+    upipe_fsrc->mmap_mgr = NULL;
     upipe_fsrc->safe = false;
     upipe_throw_ready(upipe);
     return upipe;
@@ -166,6 +190,20 @@ static void upipe_fsrc_set_upump_safe(struct upipe *upipe,
     struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
     upipe_fsrc->safe = false;
     upipe_fsrc_set_upump(upipe, upump);
+
+    /* the kernel no longer accesses the buffer once the pump is freed */
+    if (upipe_fsrc->uring_uref != NULL) {
+        uref_block_unmap(upipe_fsrc->uring_uref, 0);
+        uref_free(upipe_fsrc->uring_uref);
+        upipe_fsrc->uring_uref = NULL;
+    }
+    if ((upipe_fsrc->uring || upipe_fsrc->mmap) && upipe_fsrc->regular_file &&
+        upipe_fsrc->fd != -1)
+        lseek(upipe_fsrc->fd, upipe_fsrc->position, SEEK_SET);
+    if (upipe_fsrc->mmap)
+        ubuf_block_mmap_mgr_set_fd(upipe_fsrc->mmap_mgr, -1);
+    upipe_fsrc->uring = false;
+    upipe_fsrc->mmap = false;
 }
 
 /** @internal @This returns the path of the currently opened file.
@@ -280,6 +318,189 @@ static void upipe_fsrc_worker(struct upump *upump)
     }
 }
 
+/** @internal @This allocates the buffer of the next read, and hands it
+ * over to the io_uring read pump.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_fsrc_uring_prepare(struct upipe *upipe)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    uint64_t size = upipe_fsrc->output_size;
+    if (upipe_fsrc->length < size)
+        size = upipe_fsrc->length;
+
+    struct uref *uref = uref_block_alloc(upipe_fsrc->uref_mgr,
+                                         upipe_fsrc->ubuf_mgr, size);
+    if (unlikely(uref == NULL))
+        return UBASE_ERR_ALLOC;
+
+    uint8_t *buffer;
+    int output_size = -1;
+    if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
+                                               &buffer)))) {
+        uref_free(uref);
+        return UBASE_ERR_ALLOC;
+    }
+
+    int err = upump_uring_set_buffer(upipe_fsrc->upump, buffer, output_size,
+                                     upipe_fsrc->regular_file ?
+                                     upipe_fsrc->position : (uint64_t)-1);
+    if (unlikely(!ubase_check(err))) {
+        uref_block_unmap(uref, 0);
+        uref_free(uref);
+        return err;
+    }
+    upipe_fsrc->uring_uref = uref;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs data read by the io_uring read pump, and hands
+ * the next buffer over to the pump before outputting.
+ *
+ * @param upump description structure of the read pump
+ */
+static void upipe_fsrc_uring_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    uint64_t systime = 0; /* to keep gcc quiet */
+    if (upipe_fsrc->uclock != NULL)
+        systime = uclock_now(upipe_fsrc->uclock);
+
+    struct uref *uref = upipe_fsrc->uring_uref;
+    upipe_fsrc->uring_uref = NULL;
+    ssize_t ret = -1;
+    upump_uring_get_result(upump, &ret);
+    uref_block_unmap(uref, 0);
+
+    if (unlikely(ret == -1)) {
+        uref_free(uref);
+        if (errno == EINTR) {
+            if (unlikely(!ubase_check(upipe_fsrc_uring_prepare(upipe))))
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        const char *path = "(none)";
+        upipe_fsrc_get_uri(upipe, &path);
+        upipe_err_va(upipe, "read error from %s (%m)", path);
+        upipe_fsrc_set_upump_safe(upipe, NULL);
+        ubase_clean_fd(&upipe_fsrc->fd);
+        upipe_throw_source_end(upipe);
+        return;
+    }
+    upipe_fsrc->position += ret;
+    if (upipe_fsrc->length != (uint64_t)-1)
+        upipe_fsrc->length -= ret;
+    if (upipe_fsrc->uclock != NULL)
+        uref_clock_set_cr_sys(uref, systime);
+    uref_block_resize(uref, 0, ret);
+    if (unlikely(ret == 0))
+        uref_block_set_end(uref);
+
+    /* read the next buffer while this one is processed */
+    if (likely(ret != 0 && upipe_fsrc->length) &&
+        unlikely(!ubase_check(upipe_fsrc_uring_prepare(upipe)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    upipe_fsrc->safe = true;
+    upipe_fsrc_output(upipe, uref, &upipe_fsrc->upump);
+    if (unlikely(!upipe_fsrc->safe))
+        return;
+
+    const char *path = "(none)";
+    if (unlikely(!upipe_fsrc->length)) {
+        upipe_fsrc_get_uri(upipe, &path);
+        upipe_notice_va(upipe, "end of range %s", path);
+    } else if (unlikely(ret == 0)) {
+        upipe_fsrc_get_uri(upipe, &path);
+        upipe_notice_va(upipe, "end of file %s", path);
+    } else
+        return;
+    upipe_fsrc_set_upump_safe(upipe, NULL);
+    ubase_clean_fd(&upipe_fsrc->fd);
+    upipe_throw_source_end(upipe);
+}
+
+/** @internal @This outputs blocks pointing to the mapped file.
+ * It is called when the idler triggers.
+ *
+ * @param upump description structure of the idler
+ */
+static void upipe_fsrc_mmap_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    uint64_t systime = 0; /* to keep gcc quiet */
+    if (upipe_fsrc->uclock != NULL)
+        systime = uclock_now(upipe_fsrc->uclock);
+
+    const char *path = "(none)";
+    if (!upipe_fsrc->length) {
+        upipe_fsrc_get_uri(upipe, &path);
+        upipe_notice_va(upipe, "end of range %s", path);
+        upipe_fsrc_set_upump_safe(upipe, NULL);
+        ubase_clean_fd(&upipe_fsrc->fd);
+        upipe_throw_source_end(upipe);
+        return;
+    }
+
+    uint64_t size = upipe_fsrc->output_size;
+    if (upipe_fsrc->length < size)
+        size = upipe_fsrc->length;
+
+    struct uref *uref;
+    struct ubuf *ubuf = ubuf_block_mmap_alloc(upipe_fsrc->mmap_mgr,
+                                              upipe_fsrc->position, size);
+    size_t ret = 0;
+    if (likely(ubuf != NULL)) {
+        ubuf_block_size(ubuf, &ret);
+        uref = uref_alloc(upipe_fsrc->uref_mgr);
+        if (likely(uref != NULL))
+            uref_attach_ubuf(uref, ubuf);
+        else
+            ubuf_free(ubuf);
+    } else {
+        uint64_t file_size;
+        if (unlikely(!ubase_check(ubuf_block_mmap_mgr_get_size(
+                            upipe_fsrc->mmap_mgr, &file_size)) ||
+                     upipe_fsrc->position < file_size)) {
+            upipe_fsrc_get_uri(upipe, &path);
+            upipe_err_va(upipe, "mmap error from %s (%m)", path);
+            upipe_fsrc_set_upump_safe(upipe, NULL);
+            ubase_clean_fd(&upipe_fsrc->fd);
+            upipe_throw_source_end(upipe);
+            return;
+        }
+        uref = uref_block_alloc(upipe_fsrc->uref_mgr, upipe_fsrc->ubuf_mgr, 0);
+        if (likely(uref != NULL))
+            uref_block_set_end(uref);
+    }
+    if (unlikely(uref == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    upipe_fsrc->position += ret;
+    if (upipe_fsrc->length != (uint64_t)-1)
+        upipe_fsrc->length -= ret;
+    if (upipe_fsrc->uclock != NULL)
+        uref_clock_set_cr_sys(uref, systime);
+    upipe_fsrc->safe = true;
+    upipe_fsrc_output(upipe, uref, &upipe_fsrc->upump);
+    if (likely(upipe_fsrc->safe) && unlikely(ret == 0)) {
+        upipe_fsrc_get_uri(upipe, &path);
+        upipe_notice_va(upipe, "end of file %s", path);
+        upipe_fsrc_set_upump_safe(upipe, NULL);
+        ubase_clean_fd(&upipe_fsrc->fd);
+        upipe_throw_source_end(upipe);
+    }
+}
+
 /** @internal @This builds the flow definition.
  *
  * @param upipe description structure of the pipe
@@ -339,7 +560,45 @@ static int upipe_fsrc_check(struct upipe *upipe, struct uref *flow_format)
         return UBASE_ERR_NONE;
 
     if (upipe_fsrc->fd != -1 && upipe_fsrc->upump == NULL) {
-        struct upump *upump;
+        struct upump *upump = NULL;
+        if (upipe_fsrc->mmap_window && upipe_fsrc->regular_file) {
+            if (upipe_fsrc->mmap_mgr == NULL)
+                upipe_fsrc->mmap_mgr =
+                    ubuf_block_mmap_mgr_alloc(UBUF_POOL_DEPTH,
+                                              upipe_fsrc->mmap_window);
+            if (upipe_fsrc->mmap_mgr != NULL &&
+                ubase_check(ubuf_block_mmap_mgr_set_fd(upipe_fsrc->mmap_mgr,
+                                                       upipe_fsrc->fd)))
+                upump = upump_alloc_idler(upipe_fsrc->upump_mgr,
+                                          upipe_fsrc_mmap_worker, upipe,
+                                          upipe->refcount);
+            if (upump != NULL) {
+                upipe_fsrc_set_upump_safe(upipe, upump);
+                upipe_fsrc->mmap = true;
+                upipe_fsrc->position = lseek(upipe_fsrc->fd, 0, SEEK_CUR);
+                upump_start(upump);
+                return UBASE_ERR_NONE;
+            }
+            upipe_warn(upipe, "unable to map file, reading it");
+        }
+
+        if (upipe_fsrc->length)
+            upump = upump_uring_alloc_read(upipe_fsrc->upump_mgr,
+                                           upipe_fsrc_uring_worker, upipe,
+                                           upipe->refcount, upipe_fsrc->fd);
+        if (upump != NULL) {
+            upipe_fsrc_set_upump_safe(upipe, upump);
+            upipe_fsrc->uring = true;
+            if (upipe_fsrc->regular_file)
+                upipe_fsrc->position = lseek(upipe_fsrc->fd, 0, SEEK_CUR);
+            if (unlikely(!ubase_check(upipe_fsrc_uring_prepare(upipe)))) {
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return UBASE_ERR_ALLOC;
+            }
+            upump_start(upump);
+            return UBASE_ERR_NONE;
+        }
+
         if (upipe_fsrc->regular_file)
             upump = upump_alloc_idler(upipe_fsrc->upump_mgr,
                                       upipe_fsrc_worker, upipe,
@@ -492,6 +751,10 @@ static int _upipe_fsrc_get_position(struct upipe *upipe,
     assert(position_p != NULL);
     if (unlikely(upipe_fsrc->fd == -1))
         return UBASE_ERR_UNHANDLED;
+    if ((upipe_fsrc->uring || upipe_fsrc->mmap) && upipe_fsrc->regular_file) {
+        *position_p = upipe_fsrc->position;
+        return UBASE_ERR_NONE;
+    }
     off_t position = lseek(upipe_fsrc->fd, 0, SEEK_CUR);
     if (unlikely(position == (off_t)-1))
         return UBASE_ERR_EXTERNAL;
@@ -510,6 +773,9 @@ static int _upipe_fsrc_set_position(struct upipe *upipe, uint64_t position)
     struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
     if (unlikely(upipe_fsrc->fd == -1))
         return UBASE_ERR_UNHANDLED;
+    /* drop the pending read, the pump is reallocated afterwards */
+    if (upipe_fsrc->uring || upipe_fsrc->mmap)
+        upipe_fsrc_set_upump_safe(upipe, NULL);
     return lseek(upipe_fsrc->fd, position, SEEK_SET) != (off_t)-1 ?
         UBASE_ERR_NONE : UBASE_ERR_EXTERNAL;
 }
@@ -566,6 +832,35 @@ static int _upipe_fsrc_get_range(struct upipe *upipe,
     return _upipe_fsrc_get_length(upipe, length_p);
 }
 
+/** @internal @This sets the size of the windows used to map regular
+ * files.
+ *
+ * @param upipe description structure of the pipe
+ * @param window_size size of the windows, or 0 to disable
+ * @return an error code
+ */
+static int _upipe_fsrc_set_mmap(struct upipe *upipe, uint64_t window_size)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    if (window_size == upipe_fsrc->mmap_window)
+        return UBASE_ERR_NONE;
+
+    if (window_size && upipe_fsrc->mmap_mgr != NULL) {
+        /* the windows mapped afterwards use the new size */
+        UBASE_RETURN(ubuf_block_mmap_mgr_set_window(upipe_fsrc->mmap_mgr,
+                                                    window_size))
+        upipe_fsrc->mmap_window = window_size;
+        return UBASE_ERR_NONE;
+    }
+
+    /* the pump is reallocated afterwards */
+    upipe_fsrc_set_upump_safe(upipe, NULL);
+    ubuf_mgr_release(upipe_fsrc->mmap_mgr);
+    upipe_fsrc->mmap_mgr = NULL;
+    upipe_fsrc->mmap_window = window_size;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a file source pipe.
  *
  * @param upipe description structure of the pipe
@@ -629,6 +924,18 @@ static int _upipe_fsrc_control(struct upipe *upipe, int command, va_list args)
             return _upipe_fsrc_get_range(upipe, offset_p, length_p);
         }
 
+        case UPIPE_FSRC_GET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSRC_SIGNATURE)
+            uint64_t *window_size_p = va_arg(args, uint64_t *);
+            *window_size_p = upipe_fsrc_from_upipe(upipe)->mmap_window;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FSRC_SET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSRC_SIGNATURE)
+            uint64_t window_size = va_arg(args, uint64_t);
+            return _upipe_fsrc_set_mmap(upipe, window_size);
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -659,6 +966,8 @@ static void upipe_fsrc_free(struct upipe *upipe)
 
     upipe_throw_dead(upipe);
 
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    ubuf_mgr_release(upipe_fsrc->mmap_mgr);
     upipe_fsrc_clean_output_size(upipe);
     upipe_fsrc_clean_uclock(upipe);
     upipe_fsrc_clean_upump(upipe);
@@ -316,6 +316,7 @@ static void upipe_graph_init_mgr(struct upipe *upipe)
 {
     struct upipe_graph *upipe_graph = upipe_graph_from_upipe(upipe);
     struct upipe_mgr *mgr = upipe_graph_to_mgr(upipe_graph);
+    upipe_mgr_init(mgr);
     mgr->refcount = upipe_graph_to_urefcount_real(upipe_graph);
     mgr->signature = UPIPE_GRAPH_SUB_SIGNATURE;
     mgr->upipe_alloc = upipe_graph_input_alloc;
@@ -1503,6 +1503,7 @@ static void upipe_grid_init_in_mgr(struct upipe *upipe)
 {
     struct upipe_grid *upipe_grid = upipe_grid_from_upipe(upipe);
     struct upipe_mgr *mgr = &upipe_grid->in_mgr;
+    upipe_mgr_init(mgr);
     mgr->refcount = upipe_grid_to_urefcount_real(upipe_grid);
     mgr->signature = UPIPE_GRID_IN_SIGNATURE;
     mgr->upipe_alloc = upipe_grid_in_alloc;
@@ -1518,6 +1519,7 @@ static void upipe_grid_init_out_mgr(struct upipe *upipe)
 {
     struct upipe_grid *upipe_grid = upipe_grid_from_upipe(upipe);
     struct upipe_mgr *mgr = &upipe_grid->out_mgr;
+    upipe_mgr_init(mgr);
     mgr->refcount = upipe_grid_to_urefcount_real(upipe_grid);
     mgr->signature = UPIPE_GRID_OUT_SIGNATURE;
     mgr->upipe_alloc = upipe_grid_out_alloc;
@@ -15,6 +15,7 @@
 #include "upipe/uref_clock.h"
 #include "upipe/uref.h"
 #include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mmap.h"
 #include "upipe/uref_block.h"
 #include "upipe/uref_block_flow.h"
 #include "upipe/uref_flow.h"
@@ -50,6 +51,8 @@
 #define UBUF_DEFAULT_SIZE       1316
 /** mux number of missing segments */
 #define MISSING_SEGMENTS        5
+/** depth of the pool of the mmap ubuf manager */
+#define UBUF_POOL_DEPTH         32
 
 /** @internal @This is the private context of a multicat source pipe. */
 struct upipe_msrc {
@@ -98,6 +101,21 @@ struct upipe_msrc {
     /** number of missing segments */
     unsigned long missing;
 
+    /** size of the mapped windows, or 0 */
+    uint64_t mmap_window;
+    /** ubuf manager pointing to the mapped data file */
+    struct ubuf_mgr *mmap_mgr;
+    /** reading position in the mapped data file */
+    uint64_t data_pos;
+    /** aux file descriptor, in mmap mode */
+    int aux_fd;
+    /** mapped aux file */
+    uint8_t *aux_map;
+    /** size of the mapped aux file */
+    size_t aux_map_size;
+    /** index of the next timestamp in the mapped aux file */
+    uint64_t aux_idx;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -171,10 +189,73 @@ static struct upipe *upipe_msrc_alloc(struct upipe_mgr *mgr,
     upipe_msrc->fileidx = -1;
     upipe_msrc->pos = UINT64_MAX;
     upipe_msrc->missing = 0;
+    upipe_msrc->mmap_window = 0;
+    upipe_msrc->mmap_mgr = NULL;
+    upipe_msrc->data_pos = 0;
+    upipe_msrc->aux_fd = -1;
+    upipe_msrc->aux_map = NULL;
+    upipe_msrc->aux_map_size = 0;
+    upipe_msrc->aux_idx = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This closes the files of the current segment.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_msrc_close_segment(struct upipe *upipe)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    if (upipe_msrc->fd != -1)
+        ubase_clean_fd(&upipe_msrc->fd);
+    if (upipe_msrc->aux_file != NULL) {
+        fclose(upipe_msrc->aux_file);
+        upipe_msrc->aux_file = NULL;
+    }
+
+    if (upipe_msrc->mmap_mgr != NULL)
+        ubuf_block_mmap_mgr_set_fd(upipe_msrc->mmap_mgr, -1);
+    if (upipe_msrc->aux_map != NULL) {
+        munmap(upipe_msrc->aux_map, upipe_msrc->aux_map_size);
+        upipe_msrc->aux_map = NULL;
+        upipe_msrc->aux_map_size = 0;
+    }
+    if (upipe_msrc->aux_fd != -1)
+        ubase_clean_fd(&upipe_msrc->aux_fd);
+}
+
+/** @internal @This maps the aux file of the current segment, or maps it
+ * again if it has grown.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_msrc_map_aux(struct upipe *upipe)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    struct stat aux_stat;
+    if (unlikely(fstat(upipe_msrc->aux_fd, &aux_stat) == -1))
+        return UBASE_ERR_EXTERNAL;
+
+    size_t size = aux_stat.st_size - aux_stat.st_size % sizeof(uint64_t);
+    if (size <= upipe_msrc->aux_map_size)
+        return UBASE_ERR_NONE;
+
+    if (upipe_msrc->aux_map != NULL)
+        munmap(upipe_msrc->aux_map, upipe_msrc->aux_map_size);
+    upipe_msrc->aux_map = mmap(NULL, size, PROT_READ, MAP_SHARED,
+                               upipe_msrc->aux_fd, 0);
+    if (unlikely(upipe_msrc->aux_map == MAP_FAILED)) {
+        upipe_msrc->aux_map = NULL;
+        upipe_msrc->aux_map_size = 0;
+        return UBASE_ERR_EXTERNAL;
+    }
+    madvise(upipe_msrc->aux_map, size, MADV_SEQUENTIAL);
+    upipe_msrc->aux_map_size = size;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This skips the current segment in case of error.
  *
  * @param upipe description structure of the pipe
@@ -202,12 +283,7 @@ static int upipe_msrc_setup(struct upipe *upipe)
     UBASE_RETURN(uref_msrc_flow_get_data(upipe_msrc->flow_def_input, &data))
     UBASE_RETURN(uref_msrc_flow_get_aux(upipe_msrc->flow_def_input, &aux))
 
-    if (upipe_msrc->fd != -1)
-        ubase_clean_fd(&upipe_msrc->fd);
-    if (upipe_msrc->aux_file != NULL) {
-        fclose(upipe_msrc->aux_file);
-        upipe_msrc->aux_file = NULL;
-    }
+    upipe_msrc_close_segment(upipe);
 
     char data_file[strlen(path) + strlen(data) +
                    sizeof("18446744073709551615")];
@@ -227,6 +303,27 @@ static int upipe_msrc_setup(struct upipe *upipe)
                   sizeof("18446744073709551615")];
     sprintf(aux_file, "%s%"PRIu64"%s", path, upipe_msrc->fileidx, aux);
 
+    if (upipe_msrc->mmap_mgr != NULL) {
+        upipe_msrc->aux_fd = open(aux_file, O_RDONLY | O_CLOEXEC);
+        if (unlikely(upipe_msrc->aux_fd == -1)) {
+            upipe_warn_va(upipe, "segment %"PRIu64" not found (aux)",
+                          upipe_msrc->fileidx);
+            /* try next file anyway */
+            return upipe_msrc_skip(upipe);
+        }
+        if (unlikely(!ubase_check(upipe_msrc_map_aux(upipe)) ||
+                     !ubase_check(ubuf_block_mmap_mgr_set_fd(
+                             upipe_msrc->mmap_mgr, upipe_msrc->fd)))) {
+            upipe_warn_va(upipe, "unable to map segment %"PRIu64,
+                          upipe_msrc->fileidx);
+            /* try next file anyway */
+            return upipe_msrc_skip(upipe);
+        }
+        upipe_msrc->data_pos = 0;
+        upipe_msrc->aux_idx = 0;
+        return UBASE_ERR_NONE;
+    }
+
     upipe_msrc->aux_file = fopen(aux_file, "rb");
     if (unlikely(upipe_msrc->aux_file == NULL)) {
         upipe_warn_va(upipe, "segment %"PRIu64" not found (aux)",
@@ -304,6 +401,11 @@ static int upipe_msrc_start(struct upipe *upipe)
     close(fd);
 
     UBASE_RETURN(upipe_msrc_setup(upipe))
+    if (upipe_msrc->mmap_mgr != NULL) {
+        upipe_msrc->data_pos = (uint64_t)upipe_msrc->output_size * offset1;
+        upipe_msrc->aux_idx = offset1;
+        return UBASE_ERR_NONE;
+    }
     if (unlikely(lseek(upipe_msrc->fd, (off_t)upipe_msrc->output_size * offset1,
                        SEEK_SET) == -1 ||
                  fseeko(upipe_msrc->aux_file, 8 * offset1, SEEK_SET) == -1)) {
@@ -315,6 +417,49 @@ static int upipe_msrc_start(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This outputs a block pointing to the mapped data file,
+ * with the timestamp read from the mapped aux file.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_msrc_handle_mmap(struct upipe *upipe)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    uint64_t aux_offset = upipe_msrc->aux_idx * sizeof(uint64_t);
+    if (aux_offset >= upipe_msrc->aux_map_size &&
+        (!ubase_check(upipe_msrc_map_aux(upipe)) ||
+         aux_offset >= upipe_msrc->aux_map_size))
+        return upipe_msrc_skip(upipe);
+    uint64_t cr_sys = upipe_msrc_ntoh64(upipe_msrc->aux_map + aux_offset);
+
+    struct ubuf *ubuf = ubuf_block_mmap_alloc(upipe_msrc->mmap_mgr,
+                                              upipe_msrc->data_pos,
+                                              upipe_msrc->output_size);
+    if (unlikely(ubuf == NULL)) {
+        upipe_warn_va(upipe, "premature end of segment %"PRIu64,
+                      upipe_msrc->fileidx);
+        return upipe_msrc_skip(upipe);
+    }
+
+    struct uref *uref = uref_alloc(upipe_msrc->uref_mgr);
+    if (unlikely(uref == NULL)) {
+        ubuf_free(ubuf);
+        return UBASE_ERR_ALLOC;
+    }
+    uref_attach_ubuf(uref, ubuf);
+
+    size_t size = 0;
+    ubuf_block_size(ubuf, &size);
+    upipe_msrc->data_pos += size;
+    upipe_msrc->aux_idx++;
+    uref_clock_set_cr_sys(uref, cr_sys);
+
+    upipe_msrc->missing = 0;
+    upipe_msrc_output(upipe, uref, &upipe_msrc->upump);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This reads data from the source and outputs it.
  *
  * @param upipe description structure of the pipe
@@ -323,6 +468,9 @@ static int upipe_msrc_start(struct upipe *upipe)
 static int upipe_msrc_handle(struct upipe *upipe)
 {
     struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    if (upipe_msrc->mmap_mgr != NULL)
+        return upipe_msrc_handle_mmap(upipe);
+
     uint8_t aux[8];
     if (fread(aux, 8, 1, upipe_msrc->aux_file) != 1)
         return upipe_msrc_skip(upipe);
@@ -402,6 +550,13 @@ static void upipe_msrc_worker(struct upump *upump)
 static void upipe_msrc_open(struct upipe *upipe)
 {
     struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    if (upipe_msrc->mmap_window && upipe_msrc->mmap_mgr == NULL) {
+        upipe_msrc->mmap_mgr = ubuf_block_mmap_mgr_alloc(UBUF_POOL_DEPTH,
+                upipe_msrc->mmap_window);
+        if (unlikely(upipe_msrc->mmap_mgr == NULL))
+            upipe_warn(upipe, "unable to map segments, reading them");
+    }
+
     int err = upipe_msrc_start(upipe);
     if (!ubase_check(err)) {
         upipe_throw_error(upipe, err);
@@ -429,15 +584,7 @@ static void upipe_msrc_open(struct upipe *upipe)
  */
 static void upipe_msrc_close(struct upipe *upipe)
 {
-    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
-
-    if (upipe_msrc->fd != -1)
-        ubase_clean_fd(&upipe_msrc->fd);
-    if (upipe_msrc->aux_file != NULL) {
-        fclose(upipe_msrc->aux_file);
-        upipe_msrc->aux_file = NULL;
-    }
-
+    upipe_msrc_close_segment(upipe);
     upipe_msrc_set_upump(upipe, NULL);
 }
 
@@ -574,6 +721,34 @@ static int upipe_msrc_set_position(struct upipe *upipe, uint64_t pos)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the size of the windows used to map the segments.
+ *
+ * @param upipe description structure of the pipe
+ * @param window_size size of the windows, or 0 to disable
+ * @return an error code
+ */
+static int _upipe_msrc_set_mmap(struct upipe *upipe, uint64_t window_size)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    if (window_size == upipe_msrc->mmap_window)
+        return UBASE_ERR_NONE;
+
+    if (window_size && upipe_msrc->mmap_mgr != NULL) {
+        /* the windows mapped afterwards use the new size */
+        UBASE_RETURN(ubuf_block_mmap_mgr_set_window(upipe_msrc->mmap_mgr,
+                                                    window_size))
+        upipe_msrc->mmap_window = window_size;
+        return UBASE_ERR_NONE;
+    }
+
+    /* the segment is opened again afterwards */
+    upipe_msrc_close(upipe);
+    ubuf_mgr_release(upipe_msrc->mmap_mgr);
+    upipe_msrc->mmap_mgr = NULL;
+    upipe_msrc->mmap_window = window_size;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a multicat source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -611,6 +786,18 @@ static int _upipe_msrc_control(struct upipe *upipe, int command, va_list args)
             return upipe_msrc_get_position(upipe, p);
         }
 
+        case UPIPE_MSRC_GET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MSRC_SIGNATURE)
+            uint64_t *window_size_p = va_arg(args, uint64_t *);
+            *window_size_p = upipe_msrc_from_upipe(upipe)->mmap_window;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_MSRC_SET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MSRC_SIGNATURE)
+            uint64_t window_size = va_arg(args, uint64_t);
+            return _upipe_msrc_set_mmap(upipe, window_size);
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -643,6 +830,7 @@ static void upipe_msrc_free(struct upipe *upipe)
 
     struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
     uref_free(upipe_msrc->flow_def_input);
+    ubuf_mgr_release(upipe_msrc->mmap_mgr);
     upipe_msrc_clean_output_size(upipe);
     upipe_msrc_clean_upump(upipe);
     upipe_msrc_clean_upump_mgr(upipe);
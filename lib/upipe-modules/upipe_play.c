@@ -233,6 +233,7 @@ static void upipe_play_init_sub_mgr(struct upipe *upipe)
     struct upipe_play *upipe_play =
         upipe_play_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_play->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_play_to_urefcount(upipe_play);
     sub_mgr->signature = UPIPE_PLAY_SUB_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_play_sub_alloc;
@@ -25,6 +25,8 @@
 struct upipe_queue {
     /** max length of the queue */
     unsigned int max_length;
+    /** number of sinks pushing to a single-producer queue */
+    unsigned int producers;
     /** uref queue */
     struct uqueue uqueue;
     /** out of band downstream queue */
@@ -31,6 +31,9 @@
 #include <stdarg.h>
 #include <assert.h>
 
+/** maximum number of urefs of a chain pushed to the queue at once */
+#define UPIPE_QSINK_CHAIN_BATCH 64
+
 /** @hidden */
 static void upipe_qsink_watcher(struct upump *upump);
 /** @hidden */
@@ -100,9 +103,21 @@ static struct upipe *_upipe_qsink_alloc(struct upipe_mgr *mgr,
     if (qsrc == NULL)
         goto upipe_qsink_alloc_err;
 
+    /* single-producer queues only accept one sink at a time */
+    struct upipe_queue *queue = upipe_queue(qsrc);
+    bool spsc = queue->uqueue.spsc != NULL;
+    if (spsc && __atomic_fetch_add(&queue->producers, 1, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_sub(&queue->producers, 1, __ATOMIC_RELEASE);
+        uprobe_err(uprobe, NULL, "queue source already has a sink");
+        goto upipe_qsink_alloc_err;
+    }
+
     struct upipe_qsink *upipe_qsink = malloc(sizeof(struct upipe_qsink));
-    if (unlikely(upipe_qsink == NULL))
+    if (unlikely(upipe_qsink == NULL)) {
+        if (spsc)
+            __atomic_fetch_sub(&queue->producers, 1, __ATOMIC_RELEASE);
         goto upipe_qsink_alloc_err;
+    }
 
     struct upipe *upipe = upipe_qsink_to_upipe(upipe_qsink);
     upipe_init(upipe, mgr, uprobe);
@@ -227,6 +242,46 @@ static void upipe_qsink_input(struct upipe *upipe, struct uref *uref,
     }
 }
 
+/** @internal @This receives a list of urefs, and pushes them to the queue
+ * in batches, so that the queue source is woken up once per batch instead
+ * of once per uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_qsink_input_chain(struct upipe *upipe, struct uchain *urefs,
+                                    struct upump **upump_p)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    struct uqueue *uqueue = &upipe_queue(upipe_qsink->qsrc)->uqueue;
+    struct uchain *uchain;
+
+    /* the flow definition and the held urefs go first */
+    if ((!upipe_qsink->flow_def_sent && upipe_qsink->flow_def != NULL) ||
+        !upipe_qsink_check_input(upipe)) {
+        uchain = ulist_pop(urefs);
+        upipe_qsink_input(upipe, uref_from_uchain(uchain), upump_p);
+    }
+
+    while (!ulist_empty(urefs) && upipe_qsink_check_input(upipe)) {
+        /* urefs are unlinked before being visible to the queue source */
+        void *elements[UPIPE_QSINK_CHAIN_BATCH];
+        unsigned int nb = 0;
+        while (nb < UPIPE_QSINK_CHAIN_BATCH &&
+               (uchain = ulist_pop(urefs)) != NULL)
+            elements[nb++] = uchain;
+
+        unsigned int pushed = uqueue_push_batch(uqueue, elements, nb);
+        /* the queue is full, wait for room */
+        for (unsigned int i = pushed; i < nb; i++)
+            upipe_qsink_input(upipe, uref_from_uchain(elements[i]), upump_p);
+    }
+
+    while ((uchain = ulist_pop(urefs)) != NULL)
+        upipe_qsink_input(upipe, uref_from_uchain(uchain), upump_p);
+}
+
 /** @internal @This returns a pointer to the current pseudo-output.
  *
  * @param upipe description structure of the pipe
@@ -535,6 +590,9 @@ static void upipe_qsink_free(struct upipe *upipe)
     /* play source end */
     upipe_dbg_va(upipe, "ending queue source %p", upipe_qsink->qsrc);
     upipe_qsink_push_downstream(upipe, UPIPE_QUEUE_DOWNSTREAM_SOURCE_END, NULL);
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+    if (queue->uqueue.spsc != NULL)
+        __atomic_fetch_sub(&queue->producers, 1, __ATOMIC_RELEASE);
     upipe_release(upipe_qsink->qsrc);
 
     upipe_throw_dead(upipe);
@@ -556,6 +614,7 @@ static struct upipe_mgr upipe_qsink_mgr = {
 
     .upipe_alloc = _upipe_qsink_alloc,
     .upipe_input = upipe_qsink_input,
+    .upipe_input_chain = upipe_qsink_input_chain,
     .upipe_control = upipe_qsink_control,
 
     .upipe_mgr_control = NULL
@@ -14,11 +14,16 @@
  * @item queue_length @item maximum length of the queue (<= 255)
  * @end table
  *
+ * A queue source allocated with @ref upipe_qsrc_alloc_spsc instead uses a
+ * single-producer single-consumer queue, and the allocator takes the maximum
+ * length of the queue and the number of busy-polling iterations.
+ *
  * Also note that this module is exceptional in that upipe_release() may be
  * called from another thread. The release function is thread-safe.
  */
 
 #include "upipe/ubase.h"
+#include "upipe/ulist.h"
 #include "upipe/uprobe.h"
 #include "upipe/uref.h"
 #include "upipe/upump.h"
@@ -33,12 +38,15 @@
 #include "upipe_queue.h"
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdarg.h>
 #include <assert.h>
 
 /** maximum length of out of band queues */
 #define OOB_QUEUES 255
+/** maximum number of urefs popped at once */
+#define QSRC_BATCH 64
 
 /** @internal @This is the private context of a queue source pipe. */
 struct upipe_qsrc {
@@ -92,28 +100,38 @@ static struct upipe *_upipe_qsrc_alloc(struct upipe_mgr *mgr,
                                        struct uprobe *uprobe,
                                        uint32_t signature, va_list args)
 {
-    if (signature != UPIPE_QSRC_SIGNATURE)
+    bool spsc = signature == UPIPE_QSRC_SPSC_SIGNATURE;
+    if (signature != UPIPE_QSRC_SIGNATURE && !spsc)
         goto upipe_qsrc_alloc_err;
     unsigned int length = va_arg(args, unsigned int);
-    if (!length || length > UINT8_MAX)
+    unsigned int spin = spsc ? va_arg(args, unsigned int) : 0;
+    if (!length || length > (spsc ? UINT32_C(1) << 31 : UINT8_MAX))
         goto upipe_qsrc_alloc_err;
 
+    size_t queue_size = spsc ? uqueue_spsc_sizeof(length) :
+                               uqueue_sizeof(length);
     struct upipe_qsrc *upipe_qsrc = malloc(sizeof(struct upipe_qsrc) +
-                                           uqueue_sizeof(length) +
-                                           2 * uqueue_sizeof(OOB_QUEUES));
+                                           2 * uqueue_sizeof(OOB_QUEUES) +
+                                           queue_size);
     if (unlikely(upipe_qsrc == NULL))
         goto upipe_qsrc_alloc_err;
 
     struct upipe *upipe = upipe_qsrc_to_upipe(upipe_qsrc);
     upipe_init(upipe, mgr, uprobe);
-    if (unlikely(!uqueue_init(&upipe_queue(upipe)->uqueue, length,
+    uint8_t *extra = upipe_qsrc->uqueue_extra + 2 * uqueue_sizeof(OOB_QUEUES);
+    if (unlikely(!(spsc ?
+                   uqueue_init_spsc(&upipe_queue(upipe)->uqueue, length, spin,
+                                    extra) :
+                   uqueue_init(&upipe_queue(upipe)->uqueue, length, extra)))) {
+        free(upipe_qsrc);
+        goto upipe_qsrc_alloc_err;
+    }
+    if (unlikely(!uqueue_init(&upipe_queue(upipe)->downstream_oob, OOB_QUEUES,
                               upipe_qsrc->uqueue_extra) ||
-                 !uqueue_init(&upipe_queue(upipe)->downstream_oob, OOB_QUEUES,
-                              upipe_qsrc->uqueue_extra +
-                              uqueue_sizeof(length)) ||
                  !uqueue_init(&upipe_queue(upipe)->upstream_oob, OOB_QUEUES,
-                              upipe_qsrc->uqueue_extra + uqueue_sizeof(length) +
+                              upipe_qsrc->uqueue_extra +
                               uqueue_sizeof(OOB_QUEUES)))) {
+        uqueue_clean(&upipe_queue(upipe)->uqueue);
         free(upipe_qsrc);
         goto upipe_qsrc_alloc_err;
     }
@@ -125,6 +143,7 @@ static struct upipe *_upipe_qsrc_alloc(struct upipe_mgr *mgr,
     upipe_qsrc_init_upump(upipe);
     upipe_qsrc_init_upump_oob(upipe);
     upipe_qsrc->upipe_queue.max_length = length;
+    upipe_qsrc->upipe_queue.producers = 0;
     upipe_throw_ready(upipe);
 
     return upipe;
@@ -152,6 +171,34 @@ static void upipe_qsrc_input(struct upipe *upipe, struct uref *uref,
     upipe_qsrc_output(upipe, uref, upump_p);
 }
 
+/** @internal @This reads a batch of data from a single-producer
+ * single-consumer queue and outputs it as a list of urefs.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_qsrc_work_batch(struct upipe *upipe)
+{
+    struct upipe_qsrc *upipe_qsrc = upipe_qsrc_from_upipe(upipe);
+    void *elements[QSRC_BATCH];
+    unsigned int nb = uqueue_pop_batch(&upipe_queue(upipe)->uqueue, elements,
+                                       QSRC_BATCH);
+
+    struct uchain urefs;
+    ulist_init(&urefs);
+    for (unsigned int i = 0; i < nb; i++) {
+        struct uref *uref = elements[i];
+        const char *def;
+        if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+            if (!ulist_empty(&urefs))
+                upipe_qsrc_output_chain(upipe, &urefs, &upipe_qsrc->upump);
+            upipe_qsrc_store_flow_def(upipe, uref);
+        } else
+            ulist_add(&urefs, uref_to_uchain(uref));
+    }
+    if (!ulist_empty(&urefs))
+        upipe_qsrc_output_chain(upipe, &urefs, &upipe_qsrc->upump);
+}
+
 /** @internal @This reads data from the queue and outputs it.
  *
  * @param upump description structure of the read watcher
@@ -160,6 +207,11 @@ static void upipe_qsrc_worker(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_qsrc *upipe_qsrc = upipe_qsrc_from_upipe(upipe);
+    if (upipe_queue(upipe)->uqueue.spsc != NULL) {
+        upipe_qsrc_work_batch(upipe);
+        return;
+    }
+
     struct uref *uref = uqueue_pop(&upipe_queue(upipe)->uqueue, struct uref *);
     if (likely(uref != NULL))
         upipe_qsrc_input(upipe, uref, &upipe_qsrc->upump);
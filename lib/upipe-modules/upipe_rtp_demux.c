@@ -402,6 +402,7 @@ static void upipe_rtp_demux_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_rtp_demux *demux = upipe_rtp_demux_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &demux->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe->refcount;
     sub_mgr->signature = UPIPE_RTP_DEMUX_SUB_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_rtp_demux_sub_alloc;
@@ -440,6 +440,7 @@ static void upipe_rtpr_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_rtpr->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_rtpr_to_urefcount_real(upipe_rtpr);
     sub_mgr->signature = UPIPE_RTPR_INPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_rtpr_sub_alloc;
@@ -205,6 +205,7 @@ static void upipe_subpic_schedule_init_sub_mgr(struct upipe *upipe)
     struct upipe_subpic_schedule *upipe_subpic_schedule =
         upipe_subpic_schedule_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_subpic_schedule->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_subpic_schedule_to_urefcount_real(upipe_subpic_schedule);
     sub_mgr->signature = UPIPE_SUBPIC_SCHEDULE_SUB_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_subpic_schedule_sub_alloc;
@@ -27,6 +27,7 @@
 #include "upipe-modules/upipe_transfer.h"
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdarg.h>
 #include <string.h>
@@ -47,8 +48,13 @@ struct upipe_xfer_mgr {
     /** remote upump_mgr */
     struct upump_mgr *upump_mgr;
     /** queue length */
-    uint8_t queue_length;
-    /** queue of messages */
+    uint32_t queue_length;
+    /** true if the event queues of the pipes are single-producer
+     * single-consumer */
+    bool spsc;
+    /** number of busy-polling iterations of single-producer queues */
+    unsigned int spin;
+    /** queue of messages, shared by all threads controlling the pipes */
     struct uqueue uqueue;
     /** pool of @ref upipe_xfer_msg */
     struct ulifo msg_pool;
@@ -118,6 +124,35 @@ struct upipe_xfer_msg {
 
 UBASE_FROM_TO(upipe_xfer_msg, uchain, uchain, uchain)
 
+/** @internal @This returns the size of the extra data space of a queue of
+ * the manager.
+ *
+ * @param xfer_mgr xfer_mgr structure
+ * @return size in octets to allocate
+ */
+static size_t upipe_xfer_mgr_queue_sizeof(struct upipe_xfer_mgr *xfer_mgr)
+{
+    return xfer_mgr->spsc ? uqueue_spsc_sizeof(xfer_mgr->queue_length) :
+                            uqueue_sizeof(xfer_mgr->queue_length);
+}
+
+/** @internal @This initializes a queue of the manager.
+ *
+ * @param xfer_mgr xfer_mgr structure
+ * @param uqueue pointer to a uqueue structure
+ * @param extra extra space with the size returned by
+ * @ref upipe_xfer_mgr_queue_sizeof
+ * @return false in case of failure
+ */
+static bool upipe_xfer_mgr_queue_init(struct upipe_xfer_mgr *xfer_mgr,
+                                      struct uqueue *uqueue, void *extra)
+{
+    if (xfer_mgr->spsc)
+        return uqueue_init_spsc(uqueue, xfer_mgr->queue_length,
+                                xfer_mgr->spin, extra);
+    return uqueue_init(uqueue, xfer_mgr->queue_length, extra);
+}
+
 /** @This allocates and initializes a message structure.
  *
  * @param mgr xfer_mgr structure
@@ -302,12 +337,12 @@ static struct upipe *_upipe_xfer_alloc(struct upipe_mgr *mgr,
 
     struct upipe_xfer *upipe_xfer =
         malloc(sizeof(struct upipe_xfer) +
-               uqueue_sizeof(xfer_mgr->queue_length));
+               upipe_xfer_mgr_queue_sizeof(xfer_mgr));
     if (unlikely(upipe_xfer == NULL))
         goto upipe_xfer_alloc_err2;
 
-    if (unlikely(!uqueue_init(&upipe_xfer->uqueue, xfer_mgr->queue_length,
-                              upipe_xfer->extra))) {
+    if (unlikely(!upipe_xfer_mgr_queue_init(xfer_mgr, &upipe_xfer->uqueue,
+                                            upipe_xfer->extra))) {
         free(upipe_xfer);
         goto upipe_xfer_alloc_err2;
     }
@@ -494,8 +529,10 @@ static void upipe_xfer_mgr_vacuum(struct upipe_mgr *mgr)
 static void upipe_xfer_mgr_free(struct upipe_mgr *mgr)
 {
     struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
-    upump_stop(xfer_mgr->upump);
-    upump_free(xfer_mgr->upump);
+    if (xfer_mgr->upump != NULL) {
+        upump_stop(xfer_mgr->upump);
+        upump_free(xfer_mgr->upump);
+    }
     upump_mgr_release(xfer_mgr->upump_mgr);
     uqueue_clean(&xfer_mgr->uqueue);
     umutex_release(xfer_mgr->mutex);
@@ -579,8 +616,12 @@ static void upipe_xfer_mgr_detach(struct urefcount *urefcount)
 {
     struct upipe_xfer_mgr *xfer_mgr =
         upipe_xfer_mgr_from_urefcount(urefcount);
-    assert(xfer_mgr->upump_mgr != NULL);
     urefcount_clean(urefcount);
+    if (unlikely(xfer_mgr->upump_mgr == NULL)) {
+        /* no remote event loop to run the detach */
+        upipe_xfer_mgr_free(upipe_xfer_mgr_to_upipe_mgr(xfer_mgr));
+        return;
+    }
 
     union upipe_xfer_arg arg = { .pipe = NULL };
     upipe_xfer_mgr_send(upipe_xfer_mgr_to_upipe_mgr(xfer_mgr),
@@ -593,8 +634,9 @@ static void upipe_xfer_mgr_detach(struct urefcount *urefcount)
  * the same thread that runs the event loop (upump managers aren't generally
  * thread-safe).
  *
- * Please note that an xfer_mgr must be attached to a upump manager before it
- * can be released.
+ * Please note that an xfer_mgr must be attached to a upump manager before
+ * any xfer pipe is allocated. A manager that was never attached is freed
+ * straight away when it is released.
  *
  * @param mgr xfer_mgr structure
  * @param upump_mgr event loop to attach
@@ -679,43 +721,50 @@ static int upipe_xfer_mgr_control(struct upipe_mgr *mgr,
     }
 }
 
-/** @This returns a management structure for xfer pipes. You would need one
- * management structure per target event loop (upump manager). The management
- * structure can be allocated in any thread, but must be attached in the
- * same thread as the one running the upump manager.
+/** @internal @This allocates a management structure for xfer pipes.
  *
  * @param queue_length maximum length of the internal queues
  * @param msg_pool_depth maximum number of messages in the pool
  * @param mutex mutual exclusion primitives to access the event loop, or NULL
+ * @param spsc true to use single-producer single-consumer event queues
+ * @param spin number of busy-polling iterations of single-producer queues
  * @return pointer to manager
  */
-struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
-                                       uint16_t msg_pool_depth,
-                                       struct umutex *mutex)
+static struct upipe_mgr *_upipe_xfer_mgr_alloc(uint32_t queue_length,
+                                               uint16_t msg_pool_depth,
+                                               struct umutex *mutex,
+                                               bool spsc, unsigned int spin)
 {
     assert(queue_length);
+    /* the manager queue is fed by all the threads controlling xfer pipes,
+     * so it is always multiple-producer */
+    uint8_t mgr_queue_length = queue_length > UINT8_MAX ? UINT8_MAX :
+                               queue_length;
     struct upipe_xfer_mgr *xfer_mgr = malloc(sizeof(struct upipe_xfer_mgr) +
-                                             uqueue_sizeof(queue_length) +
-                                             ulifo_sizeof(msg_pool_depth));
+                                             ulifo_sizeof(msg_pool_depth) +
+                                             uqueue_sizeof(mgr_queue_length));
     if (unlikely(xfer_mgr == NULL))
         return NULL;
 
     memset(xfer_mgr, 0, sizeof(*xfer_mgr));
-    if (unlikely(!uqueue_init(&xfer_mgr->uqueue, queue_length,
-                              xfer_mgr->extra))) {
+    xfer_mgr->queue_length = queue_length;
+    xfer_mgr->spsc = spsc;
+    xfer_mgr->spin = spin;
+    if (unlikely(!uqueue_init(&xfer_mgr->uqueue, mgr_queue_length,
+                              xfer_mgr->extra +
+                              ulifo_sizeof(msg_pool_depth)))) {
         free(xfer_mgr);
         return NULL;
     }
     xfer_mgr->mutex = umutex_use(mutex);
     xfer_mgr->upump = NULL;
     xfer_mgr->upump_mgr = NULL;
-    xfer_mgr->queue_length = queue_length;
-    ulifo_init(&xfer_mgr->msg_pool, msg_pool_depth,
-               xfer_mgr->extra + uqueue_sizeof(queue_length));
+    ulifo_init(&xfer_mgr->msg_pool, msg_pool_depth, xfer_mgr->extra);
 
     struct upipe_mgr *mgr = upipe_xfer_mgr_to_upipe_mgr(xfer_mgr);
     urefcount_init(upipe_xfer_mgr_to_urefcount(xfer_mgr),
                    upipe_xfer_mgr_detach);
+    upipe_mgr_init(mgr);
     mgr->refcount = upipe_xfer_mgr_to_urefcount(xfer_mgr);
     mgr->signature = UPIPE_XFER_SIGNATURE;
     mgr->upipe_alloc = _upipe_xfer_alloc;
@@ -724,3 +773,43 @@ struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
     mgr->upipe_mgr_control = upipe_xfer_mgr_control;
     return mgr;
 }
+
+/** @This returns a management structure for xfer pipes. You would need one
+ * management structure per target event loop (upump manager). The management
+ * structure can be allocated in any thread, but must be attached in the
+ * same thread as the one running the upump manager.
+ *
+ * @param queue_length maximum length of the internal queues
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param mutex mutual exclusion primitives to access the event loop, or NULL
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
+                                       uint16_t msg_pool_depth,
+                                       struct umutex *mutex)
+{
+    return _upipe_xfer_mgr_alloc(queue_length, msg_pool_depth, mutex,
+                                 false, 0);
+}
+
+/** @This returns a management structure for xfer pipes whose event queues,
+ * fed by the remote event loop only, are single-producer single-consumer.
+ * The queue of commands to the remote event loop stays multiple-producer,
+ * so the xfer pipes may still be controlled from several threads.
+ *
+ * @param queue_length maximum length of the event queues (max 2^31); the
+ * queue of commands is limited to 255 elements
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param mutex mutual exclusion primitives to access the event loop, or NULL
+ * @param spin number of busy-polling iterations before waiting for the
+ * queues to be filled again
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xfer_mgr_alloc_spsc(uint32_t queue_length,
+                                            uint16_t msg_pool_depth,
+                                            struct umutex *mutex,
+                                            unsigned int spin)
+{
+    return _upipe_xfer_mgr_alloc(queue_length, msg_pool_depth, mutex,
+                                 true, spin);
+}
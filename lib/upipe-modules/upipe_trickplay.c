@@ -300,6 +300,7 @@ static void upipe_trickp_init_sub_mgr(struct upipe *upipe)
     struct upipe_trickp *upipe_trickp =
         upipe_trickp_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_trickp->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_trickp_to_urefcount(upipe_trickp);
     sub_mgr->signature = UPIPE_TRICKP_SUB_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_trickp_sub_alloc;
@@ -13,6 +13,7 @@
 
 #include "config.h"
 #include "upipe/upipe.h"
+#include "upipe/uclock.h"
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -24,10 +25,15 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <errno.h>
+#include <string.h>
+#include <time.h>
 
 #ifdef HAVE_NET_IF_H
 #include <net/if.h>
 #endif
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
 #include "upipe_udp.h"
 
 /** union sockaddru: wrapper to avoid strict-aliasing issues */
@@ -736,3 +742,105 @@ int upipe_udp_open_socket(struct upipe *upipe, const char *_uri, int ttl,
 
     return fd;
 }
+
+/** @internal @This enables reception timestamps on a socket.
+ *
+ * @param upipe description structure of the pipe
+ * @param fd socket descriptor
+ * @param hardware true to request hardware timestamps, with a software
+ * fallback
+ * @return false in case of error
+ */
+bool upipe_udp_set_rx_timestamps(struct upipe *upipe, int fd, bool hardware)
+{
+#ifdef SO_TIMESTAMPING
+    if (hardware) {
+        int flags = SOF_TIMESTAMPING_RX_HARDWARE |
+                    SOF_TIMESTAMPING_RAW_HARDWARE |
+                    SOF_TIMESTAMPING_RX_SOFTWARE |
+                    SOF_TIMESTAMPING_SOFTWARE;
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING,
+                       &flags, sizeof(flags)) < 0) {
+            upipe_err_va(upipe, "couldn't set SO_TIMESTAMPING (%m)");
+            return false;
+        }
+        return true;
+    }
+#endif
+#ifdef SO_TIMESTAMPNS
+    if (!hardware) {
+        int enable = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS,
+                       &enable, sizeof(enable)) < 0) {
+            upipe_err_va(upipe, "couldn't set SO_TIMESTAMPNS (%m)");
+            return false;
+        }
+        return true;
+    }
+#endif
+    upipe_err(upipe, "reception timestamps are not supported");
+    return false;
+}
+
+/** @internal @This converts a timespec to 27 MHz ticks.
+ *
+ * @param ts timespec to convert
+ * @return number of ticks
+ */
+static inline uint64_t upipe_udp_ts_to_ticks(const struct timespec *ts)
+{
+    return ts->tv_sec * UCLOCK_FREQ +
+           ts->tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+}
+
+/** @internal @This returns the current real time.
+ *
+ * @return number of 27 MHz ticks since the Epoch
+ */
+uint64_t upipe_udp_real_now(void)
+{
+    struct timespec ts;
+    if (unlikely(clock_gettime(CLOCK_REALTIME, &ts) == -1))
+        return UINT64_MAX;
+    return upipe_udp_ts_to_ticks(&ts);
+}
+
+/** @internal @This reads the reception timestamps from the control messages
+ * of a received datagram.
+ *
+ * @param msg received message header
+ * @param sw_p filled in with the software timestamp (real time) in 27 MHz
+ * ticks, or UINT64_MAX
+ * @param hw_p filled in with the raw hardware timestamp (PHC domain) in
+ * 27 MHz ticks, or UINT64_MAX
+ * @return false if no timestamp was found
+ */
+bool upipe_udp_get_rx_timestamp(struct msghdr *msg, uint64_t *sw_p,
+                                uint64_t *hw_p)
+{
+    struct cmsghdr *cmsg;
+    *sw_p = *hw_p = UINT64_MAX;
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET)
+            continue;
+#ifdef SO_TIMESTAMPING
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            struct timespec ts[3];
+            memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+            if (ts[2].tv_sec || ts[2].tv_nsec)
+                *hw_p = upipe_udp_ts_to_ticks(&ts[2]);
+            if (ts[0].tv_sec || ts[0].tv_nsec)
+                *sw_p = upipe_udp_ts_to_ticks(&ts[0]);
+        }
+#endif
+#ifdef SO_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            *sw_p = upipe_udp_ts_to_ticks(&ts);
+        }
+#endif
+    }
+    return *sw_p != UINT64_MAX || *hw_p != UINT64_MAX;
+}
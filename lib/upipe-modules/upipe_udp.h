@@ -16,6 +16,9 @@
 #define _UPIPE_UDP_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <time.h>
 
 #define IP_HEADER_MINSIZE 20
 #define UDP_HEADER_SIZE 8
@@ -152,4 +155,38 @@ int upipe_udp_open_socket(struct upipe *upipe, const char *_uri, int ttl,
 
 void udp_raw_set_len(uint8_t *raw_header, uint16_t len);
 
+/** @internal @This is the size of the control buffer needed to receive
+ * timestamps */
+#define UPIPE_UDP_RX_TIMESTAMP_CONTROL_SIZE \
+    CMSG_SPACE(3 * sizeof(struct timespec))
+
+/** @internal @This enables reception timestamps on a socket.
+ *
+ * @param upipe description structure of the pipe
+ * @param fd socket descriptor
+ * @param hardware true to request hardware timestamps, with a software
+ * fallback
+ * @return false in case of error
+ */
+bool upipe_udp_set_rx_timestamps(struct upipe *upipe, int fd, bool hardware);
+
+/** @internal @This returns the current real time.
+ *
+ * @return number of 27 MHz ticks since the Epoch
+ */
+uint64_t upipe_udp_real_now(void);
+
+/** @internal @This reads the reception timestamps from the control messages
+ * of a received datagram.
+ *
+ * @param msg received message header
+ * @param sw_p filled in with the software timestamp (real time) in 27 MHz
+ * ticks, or UINT64_MAX
+ * @param hw_p filled in with the raw hardware timestamp (PHC domain) in
+ * 27 MHz ticks, or UINT64_MAX
+ * @return false if no timestamp was found
+ */
+bool upipe_udp_get_rx_timestamp(struct msghdr *msg, uint64_t *sw_p,
+                                uint64_t *hw_p);
+
 #endif
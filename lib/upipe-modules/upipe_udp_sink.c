@@ -11,6 +11,9 @@
  * @short Upipe sink module for udp
  */
 
+#define _GNU_SOURCE
+
+#include "config.h"
 #include "upipe/ubase.h"
 #include "upipe/uclock.h"
 #include "upipe/uref.h"
@@ -35,8 +38,16 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <errno.h>
 #include <assert.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#endif
 
 /** tolerance for late packets */
 #define SYSTIME_TOLERANCE UCLOCK_FREQ
@@ -48,12 +59,40 @@
 #define UDP_DEFAULT_TTL 0
 #define UDP_DEFAULT_PORT 1234
 
+/** maximum number of datagrams sent at once in batch mode */
+#define UDPSINK_MAX_BATCH 1024
+/** maximum delay before sending an incomplete batch, in file mode */
+#define UDPSINK_BATCH_DELAY (UCLOCK_FREQ / 1000)
+/** maximum number of segments of a GSO datagram */
+#define UDPSINK_GSO_MAX_SEGMENTS 64
+/** maximum payload size of a GSO datagram */
+#define UDPSINK_GSO_MAX_SIZE 65000
+/** packets due within this delay are handed to the kernel with SO_TXTIME */
+#define UDPSINK_TXTIME_HORIZON (UCLOCK_FREQ / 10)
+/** period of the checks of the socket error queue with SO_TXTIME */
+#define UDPSINK_TXTIME_CHECK_PERIOD (UCLOCK_FREQ / 10)
+
 /** @hidden */
 static void upipe_udpsink_watcher(struct upump *upump);
 /** @hidden */
+static void upipe_udpsink_batch_timer(struct upump *upump);
+/** @hidden */
 static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
                                  struct upump **upump_p);
 
+/** @internal @This is the state of a datagram sent in batch mode. */
+struct upipe_udpsink_dgram {
+    /** number of iovecs of the payload */
+    int iovec_count;
+    /** RAW header */
+    uint8_t raw_header[RAW_HEADER_SIZE];
+    /** SO_TXTIME control message */
+    union {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(sizeof(uint64_t))];
+    } txtime_control;
+};
+
 /** @internal @This is the private context of a udp sink pipe. */
 struct upipe_udpsink {
     /** refcount management structure */
@@ -63,6 +102,8 @@ struct upipe_udpsink {
     struct upump_mgr *upump_mgr;
     /** write watcher */
     struct upump *upump;
+    /** timer sending incomplete batches */
+    struct upump *upump_batch;
 
     /** uclock structure, if not NULL we are in live mode */
     struct uclock *uclock;
@@ -94,6 +135,30 @@ struct upipe_udpsink {
     /** destination for not-connected socket (size) */
     socklen_t addrlen;
 
+    /** maximum number of datagrams sent at once */
+    unsigned int batch;
+    /** datagrams due for sending */
+    struct uref **batch_urefs;
+    /** number of datagrams due for sending */
+    unsigned int batch_count;
+    /** message headers of the datagrams due for sending */
+    struct mmsghdr *batch_msgs;
+    /** state of the datagrams due for sending */
+    struct upipe_udpsink_dgram *batch_dgrams;
+    /** iovecs of the datagrams due for sending */
+    struct iovec *batch_iovecs;
+    /** number of allocated iovecs */
+    unsigned int batch_nb_iovecs;
+    /** use UDP generic segmentation offload for equal-sized datagrams */
+    bool gso;
+
+    /** clock used for SO_TXTIME, or -1 if disabled */
+    int txtime_clockid;
+    /** number of packets dropped by the kernel for missing their deadline */
+    uint64_t txtime_dropped;
+    /** last time the socket error queue was checked */
+    uint64_t txtime_last_check;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -103,6 +168,7 @@ UPIPE_HELPER_UREFCOUNT(upipe_udpsink, urefcount, upipe_udpsink_free)
 UPIPE_HELPER_VOID(upipe_udpsink)
 UPIPE_HELPER_UPUMP_MGR(upipe_udpsink, upump_mgr)
 UPIPE_HELPER_UPUMP(upipe_udpsink, upump, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_udpsink, upump_batch, upump_mgr)
 UPIPE_HELPER_INPUT(upipe_udpsink, urefs, nb_urefs, max_urefs, blockers, upipe_udpsink_output)
 UPIPE_HELPER_UCLOCK(upipe_udpsink, uclock, uclock_request, NULL, upipe_throw_provide_request, NULL)
 
@@ -127,6 +193,7 @@ static struct upipe *upipe_udpsink_alloc(struct upipe_mgr *mgr,
     upipe_udpsink_init_urefcount(upipe);
     upipe_udpsink_init_upump_mgr(upipe);
     upipe_udpsink_init_upump(upipe);
+    upipe_udpsink_init_upump_batch(upipe);
     upipe_udpsink_init_input(upipe);
     upipe_udpsink_init_uclock(upipe);
     upipe_udpsink->latency = 0;
@@ -134,6 +201,17 @@ static struct upipe *upipe_udpsink_alloc(struct upipe_mgr *mgr,
     upipe_udpsink->uri = NULL;
     upipe_udpsink->raw = false;
     upipe_udpsink->addrlen = 0;
+    upipe_udpsink->batch = 1;
+    upipe_udpsink->batch_urefs = NULL;
+    upipe_udpsink->batch_count = 0;
+    upipe_udpsink->batch_msgs = NULL;
+    upipe_udpsink->batch_dgrams = NULL;
+    upipe_udpsink->batch_iovecs = NULL;
+    upipe_udpsink->batch_nb_iovecs = 0;
+    upipe_udpsink->gso = false;
+    upipe_udpsink->txtime_clockid = -1;
+    upipe_udpsink->txtime_dropped = 0;
+    upipe_udpsink->txtime_last_check = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -161,6 +239,513 @@ static void upipe_udpsink_poll(struct upipe *upipe)
     }
 }
 
+/** @internal @This is the correspondence between the uclock and the clock
+ * of SO_TXTIME at a given instant. */
+struct upipe_udpsink_txtime_ref {
+    /** time in the uclock domain */
+    uint64_t systime;
+    /** time in the SO_TXTIME clock, in nanoseconds */
+    uint64_t clock_ns;
+};
+
+/** @internal @This checks if the kernel paces the packets with SO_TXTIME.
+ *
+ * @param upipe description structure of the pipe
+ * @return true if SO_TXTIME is in use
+ */
+static inline bool upipe_udpsink_use_txtime(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    return upipe_udpsink->txtime_clockid != -1 &&
+           upipe_udpsink->uclock != NULL;
+}
+
+/** @internal @This enables SO_TXTIME on the socket.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_udpsink_set_txtime_sockopt(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    if (upipe_udpsink->fd == -1 || upipe_udpsink->txtime_clockid == -1)
+        return UBASE_ERR_NONE;
+#ifdef SO_TXTIME
+    struct sock_txtime sock_txtime = {
+        .clockid = upipe_udpsink->txtime_clockid,
+        .flags = SOF_TXTIME_REPORT_ERRORS,
+    };
+    if (setsockopt(upipe_udpsink->fd, SOL_SOCKET, SO_TXTIME,
+                   &sock_txtime, sizeof(sock_txtime)) == 0)
+        return UBASE_ERR_NONE;
+    upipe_warn_va(upipe, "couldn't set SO_TXTIME (%m)");
+#else
+    upipe_warn(upipe, "SO_TXTIME is not supported");
+#endif
+    upipe_warn(upipe, "falling back to timer-based pacing");
+    upipe_udpsink->txtime_clockid = -1;
+    return UBASE_ERR_EXTERNAL;
+}
+
+/** @internal @This disables SO_TXTIME on the socket. The kernel cannot clear
+ * the option once set, so the deadline mode and the error reports are
+ * disabled, and the packets are sent without SCM_TXTIME deadline.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_udpsink_clear_txtime_sockopt(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    upipe_udpsink->txtime_clockid = -1;
+    if (upipe_udpsink->fd == -1)
+        return UBASE_ERR_NONE;
+#ifdef SO_TXTIME
+    /* CLOCK_MONOTONIC doesn't require CAP_NET_ADMIN */
+    struct sock_txtime sock_txtime = {
+        .clockid = CLOCK_MONOTONIC,
+        .flags = 0,
+    };
+    if (unlikely(setsockopt(upipe_udpsink->fd, SOL_SOCKET, SO_TXTIME,
+                            &sock_txtime, sizeof(sock_txtime)) == -1)) {
+        upipe_warn_va(upipe, "couldn't clear SO_TXTIME (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+#endif
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This reads the current time in the uclock and the SO_TXTIME
+ * clock.
+ *
+ * @param upipe description structure of the pipe
+ * @param ref filled in with the reference times
+ */
+static void upipe_udpsink_txtime_ref(struct upipe *upipe,
+                                     struct upipe_udpsink_txtime_ref *ref)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    struct timespec ts;
+    ref->systime = uclock_now(upipe_udpsink->uclock);
+    if (unlikely(clock_gettime(upipe_udpsink->txtime_clockid, &ts) == -1))
+        ref->clock_ns = 0;
+    else
+        ref->clock_ns = ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/** @internal @This returns the transmission deadline of a packet in the
+ * SO_TXTIME clock, derived from its cr_sys and the latency.
+ *
+ * @param upipe description structure of the pipe
+ * @param ref reference times
+ * @param uref packet
+ * @return deadline in nanoseconds, or 0 to send the packet immediately
+ */
+static uint64_t upipe_udpsink_txtime(struct upipe *upipe,
+                                     const struct upipe_udpsink_txtime_ref *ref,
+                                     struct uref *uref)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    uint64_t systime;
+    if (unlikely(!ref->clock_ns ||
+                 !ubase_check(uref_clock_get_cr_sys(uref, &systime))))
+        return 0;
+    systime += upipe_udpsink->latency;
+    if (systime <= ref->systime)
+        return ref->clock_ns;
+    return ref->clock_ns + (systime - ref->systime) * 1000 / 27;
+}
+
+/** @internal @This fills in a SCM_TXTIME control message.
+ *
+ * @param msghdr message header
+ * @param control control buffer of CMSG_SPACE(sizeof(uint64_t)) octets
+ * @param txtime transmission deadline in nanoseconds, or 0
+ */
+static void upipe_udpsink_set_txtime_cmsg(struct msghdr *msghdr,
+                                          void *control, uint64_t txtime)
+{
+#ifdef SO_TXTIME
+    if (!txtime)
+        return;
+    msghdr->msg_control = control;
+    msghdr->msg_controllen = CMSG_SPACE(sizeof(uint64_t));
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(msghdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TXTIME;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+    memcpy(CMSG_DATA(cmsg), &txtime, sizeof(uint64_t));
+#endif
+}
+
+/** @internal @This reads the socket error queue and counts the packets
+ * dropped by the kernel because they missed their deadline.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsink_check_txtime_errors(struct upipe *upipe)
+{
+#ifdef SO_TXTIME
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    uint64_t now = uclock_now(upipe_udpsink->uclock);
+    if (now < upipe_udpsink->txtime_last_check + UDPSINK_TXTIME_CHECK_PERIOD)
+        return;
+    upipe_udpsink->txtime_last_check = now;
+
+    uint64_t dropped = 0;
+    for ( ; ; ) {
+        union {
+            struct cmsghdr align;
+            uint8_t buf[CMSG_SPACE(sizeof(struct sock_extended_err) +
+                                   sizeof(struct sockaddr_storage))];
+        } control;
+        struct msghdr msghdr = {
+            .msg_control = control.buf,
+            .msg_controllen = sizeof(control.buf),
+        };
+        if (recvmsg(upipe_udpsink->fd, &msghdr,
+                    MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+            break;
+
+        struct cmsghdr *cmsg;
+        for (cmsg = CMSG_FIRSTHDR(&msghdr); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&msghdr, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP &&
+                   cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 &&
+                   cmsg->cmsg_type == IPV6_RECVERR)))
+                continue;
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_TXTIME)
+                continue;
+            if (err.ee_code == SO_EE_CODE_TXTIME_INVALID_PARAM)
+                upipe_warn(upipe, "invalid SO_TXTIME parameters");
+            dropped++;
+        }
+    }
+
+    if (dropped) {
+        upipe_udpsink->txtime_dropped += dropped;
+        upipe_warn_va(upipe, "kernel dropped %"PRIu64" packets that missed "
+                      "their deadline (total %"PRIu64")", dropped,
+                      upipe_udpsink->txtime_dropped);
+    }
+#endif
+}
+
+/** @internal @This frees the datagrams due for sending.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsink_flush_batch(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    for (unsigned int i = 0; i < upipe_udpsink->batch_count; i++)
+        uref_free(upipe_udpsink->batch_urefs[i]);
+    upipe_udpsink->batch_count = 0;
+}
+
+/** @internal @This removes the first datagrams due for sending.
+ *
+ * @param upipe description structure of the pipe
+ * @param count number of datagrams to remove
+ */
+static void upipe_udpsink_consume_batch(struct upipe *upipe,
+                                        unsigned int count)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    for (unsigned int i = 0; i < count; i++)
+        uref_free(upipe_udpsink->batch_urefs[i]);
+    upipe_udpsink->batch_count -= count;
+    memmove(upipe_udpsink->batch_urefs, upipe_udpsink->batch_urefs + count,
+            upipe_udpsink->batch_count * sizeof(struct uref *));
+}
+
+/** @internal @This sends datagrams with a single sendmmsg() call.
+ *
+ * @param fd socket descriptor
+ * @param msgs array of message headers
+ * @param vlen number of message headers
+ * @return the number of sent datagrams, or -1 in case of error
+ */
+static int upipe_udpsink_sendmmsg(int fd, struct mmsghdr *msgs,
+                                  unsigned int vlen)
+{
+#ifdef HAVE_SENDMMSG
+    return sendmmsg(fd, msgs, vlen, 0);
+#else
+    unsigned int i;
+    for (i = 0; i < vlen; i++) {
+        ssize_t ret = sendmsg(fd, &msgs[i].msg_hdr, 0);
+        if (ret == -1)
+            return i ? i : -1;
+        msgs[i].msg_len = ret;
+    }
+    return i;
+#endif
+}
+
+#ifdef UDP_SEGMENT
+/** @internal @This checks whether the datagrams due for sending may be sent
+ * as a single GSO datagram.
+ *
+ * @param upipe description structure of the pipe
+ * @param segment_p filled in with the segment size
+ * @return true if GSO may be used
+ */
+static bool upipe_udpsink_check_gso(struct upipe *upipe, size_t *segment_p)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    unsigned int count = upipe_udpsink->batch_count;
+    if (!upipe_udpsink->gso || upipe_udpsink->raw || count < 2 ||
+        count > UDPSINK_GSO_MAX_SEGMENTS || upipe_udpsink_use_txtime(upipe))
+        return false;
+
+    size_t segment = 0, total = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        size_t size;
+        if (unlikely(!ubase_check(uref_block_size(upipe_udpsink->batch_urefs[i],
+                                                  &size)) || !size))
+            return false;
+        if (i == 0)
+            segment = size;
+        else if (size > segment || (size < segment && i != count - 1))
+            /* only the last segment may be shorter */
+            return false;
+        total += size;
+    }
+    if (total > UDPSINK_GSO_MAX_SIZE)
+        return false;
+    *segment_p = segment;
+    return true;
+}
+#endif
+
+/** @internal @This sends the datagrams due for sending, either with a
+ * single sendmmsg() call or as a single GSO datagram.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the socket is not writable
+ */
+static bool upipe_udpsink_send_batch(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+
+    while (upipe_udpsink->batch_count) {
+        unsigned int count = upipe_udpsink->batch_count;
+        struct upipe_udpsink_dgram *dgrams = upipe_udpsink->batch_dgrams;
+        unsigned int total_iovecs = 0;
+
+        for (unsigned int i = 0; i < count; i++) {
+            struct uref *uref = upipe_udpsink->batch_urefs[i];
+            dgrams[i].iovec_count = uref_block_iovec_count(uref, 0, -1);
+            if (unlikely(dgrams[i].iovec_count <= 0)) {
+                if (dgrams[i].iovec_count == -1)
+                    upipe_warn(upipe, "cannot read ubuf buffer");
+                /* drop empty or unreadable datagram */
+                uref_free(uref);
+                upipe_udpsink->batch_count--;
+                memmove(upipe_udpsink->batch_urefs + i,
+                        upipe_udpsink->batch_urefs + i + 1,
+                        (upipe_udpsink->batch_count - i) *
+                        sizeof(struct uref *));
+                break;
+            }
+            total_iovecs += dgrams[i].iovec_count;
+        }
+        if (count != upipe_udpsink->batch_count)
+            continue;
+
+        if (upipe_udpsink->raw)
+            total_iovecs += count;
+
+        if (unlikely(total_iovecs > upipe_udpsink->batch_nb_iovecs)) {
+            /* segmented datagrams, grow the iovec array */
+            struct iovec *iovecs = realloc(upipe_udpsink->batch_iovecs,
+                    total_iovecs * sizeof(struct iovec));
+            if (unlikely(iovecs == NULL)) {
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                upipe_udpsink_flush_batch(upipe);
+                return true;
+            }
+            upipe_udpsink->batch_iovecs = iovecs;
+            upipe_udpsink->batch_nb_iovecs = total_iovecs;
+        }
+
+        struct iovec *iovecs = upipe_udpsink->batch_iovecs;
+        struct mmsghdr *msgs = upipe_udpsink->batch_msgs;
+        bool txtime = upipe_udpsink_use_txtime(upipe);
+        struct upipe_udpsink_txtime_ref txtime_ref;
+        struct iovec *iovec = iovecs;
+        unsigned int mapped;
+
+        if (txtime)
+            upipe_udpsink_txtime_ref(upipe, &txtime_ref);
+
+        for (mapped = 0; mapped < count; mapped++) {
+            struct uref *uref = upipe_udpsink->batch_urefs[mapped];
+            struct mmsghdr *msg = &msgs[mapped];
+            memset(msg, 0, sizeof(*msg));
+            msg->msg_hdr.msg_name =
+                upipe_udpsink->addrlen ? &upipe_udpsink->addr : NULL;
+            msg->msg_hdr.msg_namelen = upipe_udpsink->addrlen;
+            msg->msg_hdr.msg_iov = iovec;
+            msg->msg_hdr.msg_iovlen = dgrams[mapped].iovec_count;
+            if (txtime)
+                upipe_udpsink_set_txtime_cmsg(&msg->msg_hdr,
+                    dgrams[mapped].txtime_control.buf,
+                    upipe_udpsink_txtime(upipe, &txtime_ref, uref));
+
+            if (upipe_udpsink->raw) {
+                size_t payload_len = 0;
+                uref_block_size(uref, &payload_len);
+                memcpy(dgrams[mapped].raw_header, upipe_udpsink->raw_header,
+                       RAW_HEADER_SIZE);
+                udp_raw_set_len(dgrams[mapped].raw_header, payload_len);
+                iovec[0].iov_base = dgrams[mapped].raw_header;
+                iovec[0].iov_len = RAW_HEADER_SIZE;
+                iovec++;
+                msg->msg_hdr.msg_iovlen++;
+            }
+
+            if (unlikely(!ubase_check(uref_block_iovec_read(uref, 0, -1,
+                                                            iovec))))
+                break;
+            iovec += dgrams[mapped].iovec_count;
+        }
+
+        if (unlikely(mapped != count)) {
+            upipe_warn(upipe, "cannot read ubuf buffer");
+            iovec = iovecs;
+            for (unsigned int i = 0; i < mapped; i++) {
+                if (upipe_udpsink->raw)
+                    iovec++;
+                uref_block_iovec_unmap(upipe_udpsink->batch_urefs[i],
+                                       0, -1, iovec);
+                iovec += dgrams[i].iovec_count;
+            }
+            /* drop the unreadable datagram */
+            uref_free(upipe_udpsink->batch_urefs[mapped]);
+            upipe_udpsink->batch_count--;
+            memmove(upipe_udpsink->batch_urefs + mapped,
+                    upipe_udpsink->batch_urefs + mapped + 1,
+                    (upipe_udpsink->batch_count - mapped) *
+                    sizeof(struct uref *));
+            continue;
+        }
+
+        int ret;
+#ifdef UDP_SEGMENT
+        size_t segment;
+        if (upipe_udpsink_check_gso(upipe, &segment)) {
+            uint8_t control[CMSG_SPACE(sizeof(uint16_t))];
+            memset(control, 0, sizeof(control));
+            struct msghdr msghdr = {
+                .msg_name = msgs[0].msg_hdr.msg_name,
+                .msg_namelen = msgs[0].msg_hdr.msg_namelen,
+                .msg_iov = iovecs,
+                .msg_iovlen = total_iovecs,
+                .msg_control = control,
+                .msg_controllen = sizeof(control),
+                .msg_flags = 0,
+            };
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gso_size = segment;
+            memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+
+            ret = sendmsg(upipe_udpsink->fd, &msghdr, 0) == -1 ? -1 : count;
+            if (unlikely(ret == -1 && errno != EINTR && errno != EAGAIN &&
+                         errno != EWOULDBLOCK)) {
+                upipe_warn_va(upipe, "disabling UDP GSO (%m)");
+                upipe_udpsink->gso = false;
+                ret = upipe_udpsink_sendmmsg(upipe_udpsink->fd, msgs, count);
+            }
+        } else
+#endif
+            ret = upipe_udpsink_sendmmsg(upipe_udpsink->fd, msgs, count);
+        int err = errno;
+
+        iovec = iovecs;
+        for (unsigned int i = 0; i < count; i++) {
+            if (upipe_udpsink->raw)
+                iovec++;
+            uref_block_iovec_unmap(upipe_udpsink->batch_urefs[i],
+                                   0, -1, iovec);
+            iovec += dgrams[i].iovec_count;
+        }
+
+        if (likely(ret > 0)) {
+            upipe_udpsink_consume_batch(upipe, ret);
+            continue;
+        }
+
+        switch (err) {
+            case EINTR:
+                continue;
+            case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+            case EWOULDBLOCK:
+#endif
+                return false;
+            default:
+                break;
+        }
+        /* Errors at this point come from ICMP messages such as
+         * "port unreachable", and we do not want to kill the application
+         * with transient errors. */
+        upipe_udpsink_consume_batch(upipe, 1);
+    }
+    return true;
+}
+
+/** @internal @This sends the datagrams due for sending, and holds them if
+ * the socket is not writable. It must only be called when no uref is held.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the datagrams were held
+ */
+static bool upipe_udpsink_output_batch(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    if (likely(upipe_udpsink_send_batch(upipe)))
+        return true;
+
+    for (unsigned int i = 0; i < upipe_udpsink->batch_count; i++)
+        upipe_udpsink_hold_input(upipe, upipe_udpsink->batch_urefs[i]);
+    upipe_udpsink->batch_count = 0;
+    upipe_udpsink_poll(upipe);
+    return false;
+}
+
+/** @internal @This sends the datagrams due for sending if the batch is
+ * full, and otherwise makes sure that they are sent by the batch timer. It
+ * must only be called when no uref is held.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the datagrams were held
+ */
+static bool upipe_udpsink_schedule_batch(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    if (upipe_udpsink->batch_count >= upipe_udpsink->batch)
+        return upipe_udpsink_output_batch(upipe);
+    if (!upipe_udpsink->batch_count || upipe_udpsink->upump_batch != NULL)
+        return true;
+
+    upipe_udpsink_check_upump_mgr(upipe);
+    if (unlikely(upipe_udpsink->upump_mgr == NULL))
+        return upipe_udpsink_output_batch(upipe);
+    /* in live mode the datagrams are already due */
+    upipe_udpsink_wait_upump_batch(upipe,
+            upipe_udpsink->uclock != NULL ? 0 : UDPSINK_BATCH_DELAY,
+            upipe_udpsink_batch_timer);
+    return true;
+}
+
 /** @internal @This outputs data to the udp sink.
  *
  * @param upipe description structure of the pipe
@@ -188,6 +773,13 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
+    if (upipe_udpsink->batch > 1 &&
+        upipe_udpsink->batch_count >= upipe_udpsink->batch &&
+        !upipe_udpsink_send_batch(upipe)) {
+        upipe_udpsink_poll(upipe);
+        return false;
+    }
+
     if (likely(upipe_udpsink->uclock == NULL))
         goto write_buffer;
 
@@ -199,15 +791,24 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
 
     uint64_t now = uclock_now(upipe_udpsink->uclock);
     systime += upipe_udpsink->latency;
-    if (unlikely(now < systime)) {
+    /* with SO_TXTIME, the kernel holds the packet until its deadline */
+    uint64_t horizon = upipe_udpsink_use_txtime(upipe) ?
+                       UDPSINK_TXTIME_HORIZON : 0;
+    if (unlikely(now + horizon < systime)) {
+        if (upipe_udpsink->batch_count && !upipe_udpsink_send_batch(upipe)) {
+            upipe_udpsink_poll(upipe);
+            return false;
+        }
         upipe_udpsink_check_upump_mgr(upipe);
         if (likely(upipe_udpsink->upump_mgr != NULL)) {
             upipe_verbose_va(upipe, "sleeping %"PRIu64" (%"PRIu64")",
-                             systime - now, systime);
-            upipe_udpsink_wait_upump(upipe, systime - now,
+                             systime - horizon - now, systime);
+            upipe_udpsink_wait_upump(upipe, systime - horizon - now,
                                      upipe_udpsink_watcher);
             return false;
         }
+    } else if (now < systime) {
+        /* handed to the kernel ahead of time */
     } else if (now > systime + SYSTIME_TOLERANCE) {
         upipe_warn_va(upipe,
                       "dropping late packet %"PRIu64" ms, latency %"PRIu64" ms",
@@ -222,6 +823,14 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
                       upipe_udpsink->latency / (UCLOCK_FREQ / 1000));
 
 write_buffer:
+    if (upipe_udpsink_use_txtime(upipe))
+        upipe_udpsink_check_txtime_errors(upipe);
+
+    if (upipe_udpsink->batch > 1) {
+        upipe_udpsink->batch_urefs[upipe_udpsink->batch_count++] = uref;
+        return true;
+    }
+
     for ( ; ; ) {
         size_t payload_len = 0;
         if (unlikely(!ubase_check(uref_block_size(uref, &payload_len)))) {
@@ -272,6 +881,17 @@ write_buffer:
             .msg_flags = 0,
         };
 
+        union {
+            struct cmsghdr align;
+            uint8_t buf[CMSG_SPACE(sizeof(uint64_t))];
+        } txtime_control;
+        if (upipe_udpsink_use_txtime(upipe)) {
+            struct upipe_udpsink_txtime_ref txtime_ref;
+            upipe_udpsink_txtime_ref(upipe, &txtime_ref);
+            upipe_udpsink_set_txtime_cmsg(&msghdr, txtime_control.buf,
+                upipe_udpsink_txtime(upipe, &txtime_ref, uref));
+        }
+
         ssize_t ret = sendmsg(upipe_udpsink->fd, &msghdr, 0);
         uref_block_iovec_unmap(uref, 0, -1, iovecs);
 
@@ -314,7 +934,8 @@ static void upipe_udpsink_watcher(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     upipe_udpsink_set_upump(upipe, NULL);
-    upipe_udpsink_output_input(upipe);
+    if (upipe_udpsink_output_input(upipe))
+        upipe_udpsink_output_batch(upipe);
     upipe_udpsink_unblock_input(upipe);
     if (upipe_udpsink_check_input(upipe)) {
         /* All packets have been output, release again the pipe that has been
@@ -341,9 +962,64 @@ static void upipe_udpsink_input(struct upipe *upipe, struct uref *uref,
         /* Increment upipe refcount to avoid disappearing before all packets
          * have been sent. */
         upipe_use(upipe);
+    } else if (!upipe_udpsink_schedule_batch(upipe)) {
+        upipe_udpsink_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
     }
 }
 
+/** @internal @This is called when an incomplete batch is due for sending.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_udpsink_batch_timer(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    upipe_udpsink_set_upump_batch(upipe, NULL);
+    if (upipe_udpsink_check_input(upipe) &&
+        !upipe_udpsink_output_batch(upipe))
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+}
+
+/** @internal @This receives a list of urefs. In batch mode, the datagrams
+ * are sent with a single system call at the end of the list, or whenever
+ * the batch is full.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_udpsink_input_chain(struct upipe *upipe,
+                                      struct uchain *urefs,
+                                      struct upump **upump_p)
+{
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(urefs)) != NULL) {
+        struct uref *uref = uref_from_uchain(uchain);
+        if (!upipe_udpsink_check_input(upipe))
+            upipe_udpsink_hold_input(upipe, uref);
+        else if (!upipe_udpsink_output(upipe, uref, upump_p)) {
+            upipe_udpsink_hold_input(upipe, uref);
+            /* Increment upipe refcount to avoid disappearing before all
+             * packets have been sent. */
+            upipe_use(upipe);
+        }
+    }
+
+    if (upipe_udpsink_check_input(upipe)) {
+        if (upipe_udpsink_output_batch(upipe))
+            return;
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+    upipe_udpsink_block_input(upipe, upump_p);
+}
+
 /** @internal @This sets the input flow definition.
  *
  * @param upipe description structure of the pipe
@@ -413,6 +1089,8 @@ static int _upipe_udpsink_set_uri(struct upipe *upipe, const char *uri)
         return UBASE_ERR_EXTERNAL;
     }
 
+    upipe_udpsink_set_txtime_sockopt(upipe);
+
     upipe_udpsink->uri = strdup(uri);
     if (unlikely(upipe_udpsink->uri == NULL)) {
         ubase_clean_fd(&upipe_udpsink->fd);
@@ -434,6 +1112,8 @@ static int _upipe_udpsink_set_uri(struct upipe *upipe, const char *uri)
  */
 static int upipe_udpsink_flush(struct upipe *upipe)
 {
+    upipe_udpsink_set_upump_batch(upipe, NULL);
+    upipe_udpsink_flush_batch(upipe);
     if (upipe_udpsink_flush_input(upipe)) {
         upipe_udpsink_set_upump(upipe, NULL);
         /* All packets have been output, release again the pipe that has been
@@ -443,6 +1123,59 @@ static int upipe_udpsink_flush(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the maximum number of datagrams sent at once.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch maximum number of datagrams (1 disables batch mode)
+ * @return an error code
+ */
+static int _upipe_udpsink_set_batch(struct upipe *upipe, unsigned int batch)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    if (unlikely(batch == 0 || batch > UDPSINK_MAX_BATCH))
+        return UBASE_ERR_INVALID;
+    if (batch == upipe_udpsink->batch)
+        return UBASE_ERR_NONE;
+
+    if (upipe_udpsink->batch_count && !upipe_udpsink_send_batch(upipe)) {
+        upipe_warn(upipe, "socket is not writable, retry later");
+        return UBASE_ERR_BUSY;
+    }
+
+    struct uref **batch_urefs = NULL;
+    struct mmsghdr *batch_msgs = NULL;
+    struct upipe_udpsink_dgram *batch_dgrams = NULL;
+    struct iovec *batch_iovecs = NULL;
+    /* room for a RAW header and an unsegmented payload per datagram */
+    unsigned int batch_nb_iovecs = batch > 1 ? 2 * batch : 0;
+    if (batch > 1) {
+        batch_urefs = malloc(batch * sizeof(struct uref *));
+        batch_msgs = malloc(batch * sizeof(struct mmsghdr));
+        batch_dgrams = malloc(batch * sizeof(struct upipe_udpsink_dgram));
+        batch_iovecs = malloc(batch_nb_iovecs * sizeof(struct iovec));
+        if (unlikely(batch_urefs == NULL || batch_msgs == NULL ||
+                     batch_dgrams == NULL || batch_iovecs == NULL)) {
+            free(batch_urefs);
+            free(batch_msgs);
+            free(batch_dgrams);
+            free(batch_iovecs);
+            return UBASE_ERR_ALLOC;
+        }
+    }
+    free(upipe_udpsink->batch_urefs);
+    free(upipe_udpsink->batch_msgs);
+    free(upipe_udpsink->batch_dgrams);
+    free(upipe_udpsink->batch_iovecs);
+    upipe_udpsink->batch_urefs = batch_urefs;
+    upipe_udpsink->batch_msgs = batch_msgs;
+    upipe_udpsink->batch_dgrams = batch_dgrams;
+    upipe_udpsink->batch_iovecs = batch_iovecs;
+    upipe_udpsink->batch_nb_iovecs = batch_nb_iovecs;
+    upipe_udpsink->batch = batch;
+    upipe_dbg_va(upipe, "sending up to %u datagrams at once", batch);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a udp sink pipe.
  *
  * @param upipe description structure of the pipe
@@ -462,6 +1195,7 @@ static int _upipe_udpsink_control(struct upipe *upipe,
 
         case UPIPE_ATTACH_UPUMP_MGR:
             upipe_udpsink_set_upump(upipe, NULL);
+            upipe_udpsink_set_upump_batch(upipe, NULL);
             return upipe_udpsink_attach_upump_mgr(upipe);
         case UPIPE_ATTACH_UCLOCK:
             upipe_udpsink_set_upump(upipe, NULL);
@@ -502,6 +1236,7 @@ static int _upipe_udpsink_control(struct upipe *upipe,
             if (likely(upipe_udpsink->fd != -1))
                 close(upipe_udpsink->fd);
             upipe_udpsink->fd = va_arg(args, int );
+            upipe_udpsink_set_txtime_sockopt(upipe);
             return UBASE_ERR_NONE;
         }
         case UPIPE_UDPSINK_SET_PEER: {
@@ -511,6 +1246,52 @@ static int _upipe_udpsink_control(struct upipe *upipe,
             memcpy(&upipe_udpsink->addr, s, upipe_udpsink->addrlen);
             return UBASE_ERR_NONE;
         }
+        case UPIPE_UDPSINK_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            *batch_p = upipe_udpsink->batch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSINK_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            return _upipe_udpsink_set_batch(upipe, batch);
+        }
+        case UPIPE_UDPSINK_SET_GSO: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            int gso = va_arg(args, int);
+#ifdef UDP_SEGMENT
+            upipe_udpsink->gso = !!gso;
+            return UBASE_ERR_NONE;
+#else
+            return gso ? UBASE_ERR_UNHANDLED : UBASE_ERR_NONE;
+#endif
+        }
+        case UPIPE_UDPSINK_SET_TXTIME: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            int clockid = va_arg(args, int);
+#ifdef SO_TXTIME
+            if (clockid == -1) {
+                if (upipe_udpsink->txtime_clockid == -1)
+                    return UBASE_ERR_NONE;
+                return upipe_udpsink_clear_txtime_sockopt(upipe);
+            }
+            upipe_udpsink->txtime_clockid = clockid;
+            return upipe_udpsink_set_txtime_sockopt(upipe);
+#else
+            return clockid == -1 ? UBASE_ERR_NONE : UBASE_ERR_UNHANDLED;
+#endif
+        }
+        case UPIPE_UDPSINK_GET_TXTIME_DROPPED: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            uint64_t *dropped_p = va_arg(args, uint64_t *);
+            if (upipe_udpsink_use_txtime(upipe)) {
+                upipe_udpsink->txtime_last_check = 0;
+                upipe_udpsink_check_txtime_errors(upipe);
+            }
+            *dropped_p = upipe_udpsink->txtime_dropped;
+            return UBASE_ERR_NONE;
+        }
         case UPIPE_FLUSH:
             return upipe_udpsink_flush(upipe);
         default:
@@ -548,6 +1329,8 @@ static void upipe_udpsink_free(struct upipe *upipe)
         upump_stop(upipe_udpsink->upump);
 
     if (likely(upipe_udpsink->fd != -1)) {
+        /* last attempt to send the incomplete batch */
+        upipe_udpsink_send_batch(upipe);
         if (likely(upipe_udpsink->uri != NULL))
             upipe_notice_va(upipe, "closing socket %s", upipe_udpsink->uri);
         close(upipe_udpsink->fd);
@@ -555,8 +1338,14 @@ static void upipe_udpsink_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     free(upipe_udpsink->uri);
+    upipe_udpsink_flush_batch(upipe);
+    free(upipe_udpsink->batch_urefs);
+    free(upipe_udpsink->batch_msgs);
+    free(upipe_udpsink->batch_dgrams);
+    free(upipe_udpsink->batch_iovecs);
     upipe_udpsink_clean_uclock(upipe);
     upipe_udpsink_clean_upump(upipe);
+    upipe_udpsink_clean_upump_batch(upipe);
     upipe_udpsink_clean_upump_mgr(upipe);
     upipe_udpsink_clean_input(upipe);
     upipe_udpsink_clean_urefcount(upipe);
@@ -570,6 +1359,7 @@ static struct upipe_mgr upipe_udpsink_mgr = {
 
     .upipe_alloc = upipe_udpsink_alloc,
     .upipe_input = upipe_udpsink_input,
+    .upipe_input_chain = upipe_udpsink_input_chain,
     .upipe_control = upipe_udpsink_control,
 
     .upipe_mgr_control = NULL
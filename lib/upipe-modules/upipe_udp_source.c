@@ -11,6 +11,9 @@
  * @short Upipe source module for udp sockets
  */
 
+#define _GNU_SOURCE
+
+#include "config.h"
 #include "upipe/ubase.h"
 #include "upipe/uclock.h"
 #include "upipe/uref.h"
@@ -30,6 +33,7 @@
 #include "upipe/upipe_helper_uclock.h"
 #include "upipe/upipe_helper_output_size.h"
 #include "upipe-modules/upipe_udp_source.h"
+#include "upump-uring/upump_uring.h"
 #include "upipe_udp.h"
 
 #include <stdlib.h>
@@ -41,9 +45,15 @@
 #include <errno.h>
 #include <assert.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 /** default size of buffers when unspecified */
 #define UBUF_DEFAULT_SIZE       4096
+/** maximum number of datagrams read per wakeup in batch mode */
+#define UDPSRC_MAX_BATCH        1024
+/** maximum distance between a hardware timestamp and the wakeup time for
+ * the PHC to be considered in the clock domain of the uclock */
+#define UDPSRC_HW_TIMESTAMP_WINDOW UCLOCK_SECOND
 
 #define UDP_DEFAULT_TTL 0
 #define UDP_DEFAULT_PORT 1234
@@ -51,6 +61,27 @@
 /** @hidden */
 static int upipe_udpsrc_check(struct upipe *upipe, struct uref *flow_format);
 
+/** @internal @This describes a recvmsg operation submitted to io_uring. */
+struct upipe_udpsrc_recv {
+    /** pipe the operation belongs to */
+    struct upipe *upipe;
+    /** io_uring recvmsg pump */
+    struct upump *upump;
+    /** uref being filled in */
+    struct uref *uref;
+    /** message header */
+    struct msghdr msghdr;
+    /** io vector */
+    struct iovec iovec;
+    /** peer address */
+    struct sockaddr_storage addr;
+    /** control buffer */
+    union {
+        struct cmsghdr align;
+        uint8_t buf[UPIPE_UDP_RX_TIMESTAMP_CONTROL_SIZE];
+    } control;
+};
+
 /** @internal @This is the private context of a udp socket source pipe. */
 struct upipe_udpsrc {
     /** refcount management structure */
@@ -99,6 +130,30 @@ struct upipe_udpsrc {
     /** source address (size) */
     socklen_t addrlen;
 
+    /** maximum number of datagrams read per wakeup */
+    unsigned int batch;
+    /** pre-allocated urefs for batch mode */
+    struct uref **batch_urefs;
+    /** message headers for batch mode */
+    struct mmsghdr *batch_msgs;
+    /** io vectors for batch mode */
+    struct iovec *batch_iovecs;
+    /** peer addresses for batch mode */
+    struct sockaddr_storage *batch_addrs;
+    /** control buffers for batch mode */
+    uint8_t *batch_controls;
+
+    /** type of reception timestamps */
+    enum upipe_udpsrc_timestamp timestamp;
+    /** true if hardware timestamps were found not to match the uclock */
+    bool hw_timestamp_mismatch;
+
+    /** io_uring recvmsg operations kept in flight, one per datagram of a
+     * batch, or NULL */
+    struct upipe_udpsrc_recv *recvs;
+    /** incremented each time the recvmsg operations are released */
+    unsigned int recvs_epoch;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -149,10 +204,392 @@ static struct upipe *upipe_udpsrc_alloc(struct upipe_mgr *mgr,
     upipe_udpsrc->fd = -1;
     upipe_udpsrc->uri = NULL;
     upipe_udpsrc->addrlen = 0;
+    upipe_udpsrc->batch = 1;
+    upipe_udpsrc->batch_urefs = NULL;
+    upipe_udpsrc->batch_msgs = NULL;
+    upipe_udpsrc->batch_iovecs = NULL;
+    upipe_udpsrc->batch_addrs = NULL;
+    upipe_udpsrc->batch_controls = NULL;
+    upipe_udpsrc->timestamp = UPIPE_UDPSRC_TIMESTAMP_NONE;
+    upipe_udpsrc->hw_timestamp_mismatch = false;
+    upipe_udpsrc->recvs = NULL;
+    upipe_udpsrc->recvs_epoch = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This stops reading from the socket, and releases the io_uring
+ * recvmsg operations and their buffers.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_stop(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    struct upipe_udpsrc_recv *recvs = upipe_udpsrc->recvs;
+    upipe_udpsrc->recvs = NULL;
+    upipe_udpsrc_set_upump(upipe, NULL);
+    if (recvs == NULL)
+        return;
+    upipe_udpsrc->recvs_epoch++;
+
+    /* the first pump was the read watcher, freed above */
+    for (unsigned int i = 0; i < upipe_udpsrc->batch; i++) {
+        if (i && recvs[i].upump != NULL)
+            upump_free(recvs[i].upump);
+        if (recvs[i].uref != NULL) {
+            uref_block_unmap(recvs[i].uref, 0);
+            uref_free(recvs[i].uref);
+        }
+    }
+    free(recvs);
+}
+
+/** @internal @This frees the pre-allocated urefs of the batch mode.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_flush_batch(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (upipe_udpsrc->batch_urefs == NULL)
+        return;
+    for (unsigned int i = 0; i < upipe_udpsrc->batch; i++) {
+        if (upipe_udpsrc->batch_urefs[i] != NULL) {
+            uref_free(upipe_udpsrc->batch_urefs[i]);
+            upipe_udpsrc->batch_urefs[i] = NULL;
+        }
+    }
+}
+
+/** @internal @This releases the pre-allocated buffers of the batch mode.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_clean_batch(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    upipe_udpsrc_flush_batch(upipe);
+    free(upipe_udpsrc->batch_urefs);
+    free(upipe_udpsrc->batch_msgs);
+    free(upipe_udpsrc->batch_iovecs);
+    free(upipe_udpsrc->batch_addrs);
+    free(upipe_udpsrc->batch_controls);
+    upipe_udpsrc->batch_urefs = NULL;
+    upipe_udpsrc->batch_msgs = NULL;
+    upipe_udpsrc->batch_iovecs = NULL;
+    upipe_udpsrc->batch_addrs = NULL;
+    upipe_udpsrc->batch_controls = NULL;
+}
+
+/** @internal @This handles a read error on the socket.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_read_error(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    switch (errno) {
+        case EINTR:
+        case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+        case EWOULDBLOCK:
+#endif
+            /* not an issue, try again later */
+            return;
+        case EBADF:
+        case EINVAL:
+        case EIO:
+        default:
+            break;
+    }
+    upipe_err_va(upipe, "read error from %s (%m)", upipe_udpsrc->uri);
+    upipe_udpsrc_stop(upipe);
+    upipe_throw_source_end(upipe);
+}
+
+/** @internal @This returns the type of reception timestamps read from the
+ * socket. Batch mode uses at least software timestamps, so that each
+ * datagram of a batch gets its own reception time.
+ *
+ * @param upipe description structure of the pipe
+ * @return type of timestamps
+ */
+static enum upipe_udpsrc_timestamp
+    upipe_udpsrc_rx_timestamp(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (upipe_udpsrc->timestamp == UPIPE_UDPSRC_TIMESTAMP_NONE &&
+        upipe_udpsrc->batch > 1)
+        return UPIPE_UDPSRC_TIMESTAMP_SOFTWARE;
+    return upipe_udpsrc->timestamp;
+}
+
+/** @internal @This enables reception timestamps on the socket, if needed.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_set_rx_timestamps(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    enum upipe_udpsrc_timestamp timestamp = upipe_udpsrc_rx_timestamp(upipe);
+    if (upipe_udpsrc->fd != -1 &&
+        timestamp != UPIPE_UDPSRC_TIMESTAMP_NONE &&
+        !upipe_udp_set_rx_timestamps(upipe, upipe_udpsrc->fd,
+            timestamp == UPIPE_UDPSRC_TIMESTAMP_HARDWARE))
+        upipe_warn(upipe, "reception timestamps are disabled");
+}
+
+/** @internal @This returns the reception time of a datagram. Kernel
+ * timestamps are converted to the uclock domain by subtracting the age of
+ * the datagram, measured in real time, from the wakeup time. Raw hardware
+ * timestamps are used as is, but only if they are close to the wakeup time,
+ * which means that the uclock is a uclock_ptp reading the PHC of the
+ * receiving interface; otherwise the software timestamp is used.
+ *
+ * @param upipe description structure of the pipe
+ * @param msg received message header
+ * @param systime wakeup time in the uclock domain
+ * @param realtime wakeup time in real time
+ * @return reception time in the uclock domain
+ */
+static uint64_t upipe_udpsrc_get_cr_sys(struct upipe *upipe,
+                                        struct msghdr *msg,
+                                        uint64_t systime, uint64_t realtime)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    uint64_t sw, hw;
+
+    if (likely(upipe_udpsrc_rx_timestamp(upipe) ==
+               UPIPE_UDPSRC_TIMESTAMP_NONE) ||
+        unlikely(!upipe_udp_get_rx_timestamp(msg, &sw, &hw)))
+        return systime;
+    if (hw != UINT64_MAX &&
+        upipe_udpsrc->timestamp == UPIPE_UDPSRC_TIMESTAMP_HARDWARE) {
+        if (likely(hw <= systime &&
+                   systime - hw <= UDPSRC_HW_TIMESTAMP_WINDOW))
+            return hw;
+        if (!upipe_udpsrc->hw_timestamp_mismatch) {
+            upipe_warn(upipe, "hardware timestamps are not in the uclock "
+                       "domain, using software timestamps");
+            upipe_udpsrc->hw_timestamp_mismatch = true;
+        }
+    }
+    if (unlikely(sw == UINT64_MAX || realtime == UINT64_MAX ||
+                 sw > realtime || realtime - sw > systime))
+        return systime;
+    return systime - (realtime - sw);
+}
+
+/** @internal @This handles an empty datagram, which ends the source unless
+ * it is live.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the source is over
+ */
+static bool upipe_udpsrc_empty_dgram(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (likely(upipe_udpsrc->uclock == NULL)) {
+        upipe_notice_va(upipe, "end of udp socket %s", upipe_udpsrc->uri);
+        upipe_udpsrc_stop(upipe);
+        upipe_throw_source_end(upipe);
+        return false;
+    }
+    return true;
+}
+
+/** @internal @This prepares a received datagram for output.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref containing the datagram
+ * @param size size of the datagram
+ * @param msg received message header
+ * @param systime wakeup time in the uclock domain
+ * @param realtime wakeup time in real time
+ * @return the datagram to output, or NULL if it is empty
+ */
+static struct uref *upipe_udpsrc_dgram(struct upipe *upipe,
+                                       struct uref *uref, size_t size,
+                                       struct msghdr *msg,
+                                       uint64_t systime, uint64_t realtime)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    const struct sockaddr_storage *addr = msg->msg_name;
+    socklen_t addrlen = msg->msg_namelen;
+
+    if (addrlen != upipe_udpsrc->addrlen ||
+        memcmp(addr, &upipe_udpsrc->addr, addrlen)) {
+        upipe_throw(upipe, UPROBE_UDPSRC_NEW_PEER, UPIPE_UDPSRC_SIGNATURE,
+                addr, &addrlen);
+        upipe_udpsrc->addrlen = addrlen;
+        memcpy(&upipe_udpsrc->addr, addr, addrlen);
+    }
+
+    if (unlikely(size == 0)) {
+        uref_free(uref);
+        return NULL;
+    }
+    if (unlikely(upipe_udpsrc->uclock != NULL))
+        uref_clock_set_cr_sys(uref, upipe_udpsrc_get_cr_sys(upipe, msg,
+                                                            systime, realtime));
+    if (unlikely(size != upipe_udpsrc->output_size))
+        uref_block_resize(uref, 0, size);
+    return uref;
+}
+
+/** @internal @This outputs a received datagram.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref containing the datagram
+ * @param size size of the datagram
+ * @param msg received message header
+ * @param systime wakeup time in the uclock domain
+ * @param realtime wakeup time in real time
+ * @return false if the source is over
+ */
+static bool upipe_udpsrc_output_dgram(struct upipe *upipe, struct uref *uref,
+                                      size_t size, struct msghdr *msg,
+                                      uint64_t systime, uint64_t realtime)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    uref = upipe_udpsrc_dgram(upipe, uref, size, msg, systime, realtime);
+    if (unlikely(uref == NULL))
+        return upipe_udpsrc_empty_dgram(upipe);
+    upipe_udpsrc_output(upipe, uref, &upipe_udpsrc->upump);
+    return true;
+}
+
+/** @internal @This receives several datagrams at once.
+ *
+ * @param fd socket descriptor
+ * @param msgs array of message headers
+ * @param vlen number of message headers
+ * @return the number of received datagrams, or -1 in case of error
+ */
+static int upipe_udpsrc_recvmmsg(int fd, struct mmsghdr *msgs,
+                                 unsigned int vlen)
+{
+#ifdef HAVE_RECVMMSG
+    return recvmmsg(fd, msgs, vlen, MSG_DONTWAIT, NULL);
+#else
+    unsigned int i;
+    for (i = 0; i < vlen; i++) {
+        ssize_t ret = recvmsg(fd, &msgs[i].msg_hdr, MSG_DONTWAIT);
+        if (ret == -1)
+            return i ? i : -1;
+        msgs[i].msg_len = ret;
+    }
+    return i;
+#endif
+}
+
+/** @internal @This reads a batch of datagrams from the socket and outputs
+ * them as a single chain, in arrival order.
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_udpsrc_worker_batch(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    unsigned int batch = upipe_udpsrc->batch;
+    uint64_t systime = 0; /* to keep gcc quiet */
+    uint64_t realtime = UINT64_MAX;
+    if (unlikely(upipe_udpsrc->uclock != NULL)) {
+        systime = uclock_now(upipe_udpsrc->uclock);
+        if (upipe_udpsrc_rx_timestamp(upipe) !=
+            UPIPE_UDPSRC_TIMESTAMP_NONE)
+            realtime = upipe_udp_real_now();
+    }
+
+    for (unsigned int i = 0; i < batch; i++) {
+        struct uref *uref = upipe_udpsrc->batch_urefs[i];
+        if (uref == NULL) {
+            uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
+                                    upipe_udpsrc->ubuf_mgr,
+                                    upipe_udpsrc->output_size);
+            if (unlikely(uref == NULL)) {
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+            upipe_udpsrc->batch_urefs[i] = uref;
+        }
+
+        uint8_t *buffer;
+        int output_size = -1;
+        if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
+                                                   &buffer)))) {
+            for (unsigned int j = 0; j < i; j++)
+                uref_block_unmap(upipe_udpsrc->batch_urefs[j], 0);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        assert(output_size == upipe_udpsrc->output_size);
+
+        struct mmsghdr *msg = &upipe_udpsrc->batch_msgs[i];
+        upipe_udpsrc->batch_iovecs[i].iov_base = buffer;
+        upipe_udpsrc->batch_iovecs[i].iov_len = output_size;
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_hdr.msg_name = &upipe_udpsrc->batch_addrs[i];
+        msg->msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        msg->msg_hdr.msg_iov = &upipe_udpsrc->batch_iovecs[i];
+        msg->msg_hdr.msg_iovlen = 1;
+        if (upipe_udpsrc_rx_timestamp(upipe) !=
+            UPIPE_UDPSRC_TIMESTAMP_NONE) {
+            msg->msg_hdr.msg_control = upipe_udpsrc->batch_controls +
+                i * UPIPE_UDP_RX_TIMESTAMP_CONTROL_SIZE;
+            msg->msg_hdr.msg_controllen = UPIPE_UDP_RX_TIMESTAMP_CONTROL_SIZE;
+        }
+    }
+
+    int ret = upipe_udpsrc_recvmmsg(upipe_udpsrc->fd,
+                                    upipe_udpsrc->batch_msgs, batch);
+    for (unsigned int i = 0; i < batch; i++)
+        uref_block_unmap(upipe_udpsrc->batch_urefs[i], 0);
+
+    if (unlikely(ret == -1)) {
+        upipe_udpsrc_read_error(upipe);
+        return;
+    }
+
+    struct uchain urefs;
+    ulist_init(&urefs);
+    bool end = false;
+    for (int i = 0; i < ret; i++) {
+        struct uref *uref = upipe_udpsrc->batch_urefs[i];
+        struct mmsghdr *msg = &upipe_udpsrc->batch_msgs[i];
+        upipe_udpsrc->batch_urefs[i] = NULL;
+        if (unlikely(end)) {
+            uref_free(uref);
+            continue;
+        }
+        uref = upipe_udpsrc_dgram(upipe, uref, msg->msg_len, &msg->msg_hdr,
+                                  systime, realtime);
+        if (likely(uref != NULL))
+            ulist_add(&urefs, uref_to_uchain(uref));
+        else
+            end = upipe_udpsrc->uclock == NULL;
+    }
+
+    /* move the remaining pre-allocated urefs to the beginning */
+    unsigned int j = 0;
+    for (unsigned int k = 0; k < batch; k++) {
+        struct uref *uref = upipe_udpsrc->batch_urefs[k];
+        upipe_udpsrc->batch_urefs[k] = NULL;
+        upipe_udpsrc->batch_urefs[j] = uref;
+        if (uref != NULL)
+            j++;
+    }
+
+    /* the pipe may be released or its socket closed by the output */
+    upipe_use(upipe);
+    upipe_udpsrc_output_chain(upipe, &urefs, &upipe_udpsrc->upump);
+    if (unlikely(end) && upipe_udpsrc->upump == upump)
+        upipe_udpsrc_empty_dgram(upipe);
+    upipe_release(upipe);
+}
+
 /** @internal @This reads data from the source and outputs it.
  * It is called either when the idler triggers (permanent storage mode) or
  * when data is available on the udp socket descriptor (live stream mode).
@@ -164,8 +601,13 @@ static void upipe_udpsrc_worker(struct upump *upump)
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
     uint64_t systime = 0; /* to keep gcc quiet */
-    if (unlikely(upipe_udpsrc->uclock != NULL))
+    uint64_t realtime = UINT64_MAX;
+    if (unlikely(upipe_udpsrc->uclock != NULL)) {
         systime = uclock_now(upipe_udpsrc->uclock);
+        if (upipe_udpsrc_rx_timestamp(upipe) !=
+            UPIPE_UDPSRC_TIMESTAMP_NONE)
+            realtime = upipe_udp_real_now();
+    }
 
     struct uref *uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
                                          upipe_udpsrc->ubuf_mgr,
@@ -186,54 +628,171 @@ static void upipe_udpsrc_worker(struct upump *upump)
     assert(output_size == upipe_udpsrc->output_size);
 
     struct sockaddr_storage addr;
-    socklen_t addrlen = sizeof(addr);
+    struct iovec iovec = {
+        .iov_base = buffer,
+        .iov_len = upipe_udpsrc->output_size,
+    };
+    union {
+        struct cmsghdr align;
+        uint8_t buf[UPIPE_UDP_RX_TIMESTAMP_CONTROL_SIZE];
+    } control;
+    struct msghdr msghdr = {
+        .msg_name = &addr,
+        .msg_namelen = sizeof(addr),
+        .msg_iov = &iovec,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen =
+            upipe_udpsrc->timestamp != UPIPE_UDPSRC_TIMESTAMP_NONE ?
+            sizeof(control.buf) : 0,
+        .msg_flags = 0,
+    };
 
-    ssize_t ret = recvfrom(upipe_udpsrc->fd, buffer, upipe_udpsrc->output_size,
-                        0, (struct sockaddr*)&addr, &addrlen);
+    ssize_t ret = recvmsg(upipe_udpsrc->fd, &msghdr, 0);
     uref_block_unmap(uref, 0);
 
     if (unlikely(ret == -1)) {
         uref_free(uref);
-        switch (errno) {
-            case EINTR:
-            case EAGAIN:
-#if EAGAIN != EWOULDBLOCK
-            case EWOULDBLOCK:
-#endif
-                /* not an issue, try again later */
-                return;
-            case EBADF:
-            case EINVAL:
-            case EIO:
-            default:
-                break;
-        }
-        upipe_err_va(upipe, "read error from %s (%m)", upipe_udpsrc->uri);
-        upipe_udpsrc_set_upump(upipe, NULL);
-        upipe_throw_source_end(upipe);
+        upipe_udpsrc_read_error(upipe);
         return;
-    } else if (addrlen != upipe_udpsrc->addrlen ||
-        memcmp(&addr, &upipe_udpsrc->addr, addrlen)) {
-        upipe_throw(upipe, UPROBE_UDPSRC_NEW_PEER, UPIPE_UDPSRC_SIGNATURE,
-                &addr, &addrlen);
-        upipe_udpsrc->addrlen = addrlen;
-        memcpy(&upipe_udpsrc->addr, &addr, addrlen);
     }
 
-    if (unlikely(ret == 0)) {
+    upipe_udpsrc_output_dgram(upipe, uref, ret, &msghdr, systime, realtime);
+}
+
+/** @internal @This allocates the buffer of the next datagram, and hands it
+ * over to an io_uring recvmsg pump.
+ *
+ * @param upipe description structure of the pipe
+ * @param recv recvmsg operation
+ * @return an error code
+ */
+static int upipe_udpsrc_uring_prepare(struct upipe *upipe,
+                                      struct upipe_udpsrc_recv *recv)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    struct uref *uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
+                                         upipe_udpsrc->ubuf_mgr,
+                                         upipe_udpsrc->output_size);
+    if (unlikely(uref == NULL))
+        return UBASE_ERR_ALLOC;
+
+    uint8_t *buffer;
+    int output_size = -1;
+    if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
+                                               &buffer)))) {
         uref_free(uref);
-        if (likely(upipe_udpsrc->uclock == NULL)) {
-            upipe_notice_va(upipe, "end of udp socket %s", upipe_udpsrc->uri);
-            upipe_udpsrc_set_upump(upipe, NULL);
-            upipe_throw_source_end(upipe);
-        }
+        return UBASE_ERR_ALLOC;
+    }
+    assert(output_size == upipe_udpsrc->output_size);
+
+    recv->iovec.iov_base = buffer;
+    recv->iovec.iov_len = output_size;
+    struct msghdr *msghdr = &recv->msghdr;
+    memset(msghdr, 0, sizeof(*msghdr));
+    msghdr->msg_name = &recv->addr;
+    msghdr->msg_namelen = sizeof(recv->addr);
+    msghdr->msg_iov = &recv->iovec;
+    msghdr->msg_iovlen = 1;
+    if (upipe_udpsrc_rx_timestamp(upipe) != UPIPE_UDPSRC_TIMESTAMP_NONE) {
+        msghdr->msg_control = recv->control.buf;
+        msghdr->msg_controllen = sizeof(recv->control.buf);
+    }
+
+    int err = upump_uring_set_msghdr(recv->upump, msghdr);
+    if (unlikely(!ubase_check(err))) {
+        uref_block_unmap(uref, 0);
+        uref_free(uref);
+        return err;
+    }
+    recv->uref = uref;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs a datagram received by an io_uring recvmsg
+ * pump, and hands the next buffer over to the pump.
+ *
+ * @param upump description structure of the recvmsg pump
+ */
+static void upipe_udpsrc_uring_worker(struct upump *upump)
+{
+    struct upipe_udpsrc_recv *recv =
+        upump_get_opaque(upump, struct upipe_udpsrc_recv *);
+    struct upipe *upipe = recv->upipe;
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    unsigned int epoch = upipe_udpsrc->recvs_epoch;
+    uint64_t systime = 0; /* to keep gcc quiet */
+    uint64_t realtime = UINT64_MAX;
+    if (unlikely(upipe_udpsrc->uclock != NULL)) {
+        systime = uclock_now(upipe_udpsrc->uclock);
+        if (upipe_udpsrc_rx_timestamp(upipe) !=
+            UPIPE_UDPSRC_TIMESTAMP_NONE)
+            realtime = upipe_udp_real_now();
+    }
+
+    struct uref *uref = recv->uref;
+    recv->uref = NULL;
+    ssize_t ret = -1;
+    upump_uring_get_result(upump, &ret);
+    uref_block_unmap(uref, 0);
+
+    if (unlikely(ret == -1)) {
+        uref_free(uref);
+        upipe_udpsrc_read_error(upipe);
+    } else if (!upipe_udpsrc_output_dgram(upipe, uref, ret, &recv->msghdr,
+                                          systime, realtime))
         return;
+
+    /* the socket may have been closed or reopened by the output, releasing
+     * the operation */
+    if (upipe_udpsrc->recvs_epoch == epoch && recv->uref == NULL &&
+        unlikely(!ubase_check(upipe_udpsrc_uring_prepare(upipe, recv))))
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+}
+
+/** @internal @This allocates and starts as many io_uring recvmsg pumps as
+ * datagrams in a batch, so that the kernel may fill in several datagrams
+ * between two io_uring_enter() calls. The first pump is the read watcher.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code, UBASE_ERR_UPUMP if the event loop does not support
+ * io_uring pumps
+ */
+static int upipe_udpsrc_uring_start(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    unsigned int batch = upipe_udpsrc->batch;
+    struct upipe_udpsrc_recv *recvs =
+        calloc(batch, sizeof(struct upipe_udpsrc_recv));
+    if (unlikely(recvs == NULL))
+        return UBASE_ERR_ALLOC;
+
+    for (unsigned int i = 0; i < batch; i++) {
+        recvs[i].upipe = upipe;
+        recvs[i].upump = upump_uring_alloc_recvmsg(upipe_udpsrc->upump_mgr,
+                                                   upipe_udpsrc_uring_worker,
+                                                   &recvs[i], upipe->refcount,
+                                                   upipe_udpsrc->fd);
+        if (recvs[i].upump == NULL) {
+            for (unsigned int j = 0; j < i; j++)
+                upump_free(recvs[j].upump);
+            free(recvs);
+            return UBASE_ERR_UPUMP;
+        }
     }
-    if (unlikely(upipe_udpsrc->uclock != NULL))
-        uref_clock_set_cr_sys(uref, systime);
-    if (unlikely(ret != upipe_udpsrc->output_size))
-        uref_block_resize(uref, 0, ret);
-    upipe_udpsrc_output(upipe, uref, &upipe_udpsrc->upump);
+    upipe_udpsrc->recvs = recvs;
+    upipe_udpsrc_set_upump(upipe, recvs[0].upump);
+
+    for (unsigned int i = 0; i < batch; i++) {
+        if (unlikely(!ubase_check(upipe_udpsrc_uring_prepare(upipe,
+                                                             &recvs[i])))) {
+            upipe_udpsrc_stop(upipe);
+            return UBASE_ERR_ALLOC;
+        }
+    }
+    for (unsigned int i = 0; i < batch; i++)
+        upump_start(recvs[i].upump);
+    return UBASE_ERR_NONE;
 }
 
 /** @internal @This checks if the pump may be allocated.
@@ -275,10 +834,20 @@ static int upipe_udpsrc_check(struct upipe *upipe, struct uref *flow_format)
         return UBASE_ERR_NONE;
 
     if (upipe_udpsrc->fd != -1 && upipe_udpsrc->upump == NULL) {
-        struct upump *upump;
-        upump = upump_alloc_fd_read(upipe_udpsrc->upump_mgr,
-                                    upipe_udpsrc_worker, upipe, upipe->refcount,
-                                    upipe_udpsrc->fd);
+        int err = upipe_udpsrc_uring_start(upipe);
+        if (ubase_check(err))
+            return UBASE_ERR_NONE;
+        if (unlikely(err != UBASE_ERR_UPUMP)) {
+            upipe_throw_fatal(upipe, err);
+            return err;
+        }
+
+        struct upump *upump =
+            upump_alloc_fd_read(upipe_udpsrc->upump_mgr,
+                                upipe_udpsrc->batch > 1 ?
+                                upipe_udpsrc_worker_batch :
+                                upipe_udpsrc_worker,
+                                upipe, upipe->refcount, upipe_udpsrc->fd);
         if (unlikely(upump == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
             return UBASE_ERR_UPUMP;
@@ -321,7 +890,7 @@ static int upipe_udpsrc_set_uri(struct upipe *upipe, const char *uri)
         ubase_clean_fd(&upipe_udpsrc->fd);
     }
     ubase_clean_str(&upipe_udpsrc->uri);
-    upipe_udpsrc_set_upump(upipe, NULL);
+    upipe_udpsrc_stop(upipe);
 
     if (unlikely(uri == NULL))
         return UBASE_ERR_NONE;
@@ -333,6 +902,8 @@ static int upipe_udpsrc_set_uri(struct upipe *upipe, const char *uri)
         return UBASE_ERR_EXTERNAL;
     }
 
+    upipe_udpsrc_set_rx_timestamps(upipe);
+
     upipe_udpsrc->uri = strdup(uri);
     if (unlikely(upipe_udpsrc->uri == NULL)) {
         ubase_clean_fd(&upipe_udpsrc->fd);
@@ -343,6 +914,75 @@ static int upipe_udpsrc_set_uri(struct upipe *upipe, const char *uri)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the maximum number of datagrams read per wakeup.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch maximum number of datagrams (1 disables batch mode)
+ * @return an error code
+ */
+static int _upipe_udpsrc_set_batch(struct upipe *upipe, unsigned int batch)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (unlikely(batch == 0 || batch > UDPSRC_MAX_BATCH))
+        return UBASE_ERR_INVALID;
+    if (batch == upipe_udpsrc->batch)
+        return UBASE_ERR_NONE;
+
+    upipe_udpsrc_stop(upipe);
+    upipe_udpsrc_clean_batch(upipe);
+    upipe_udpsrc->batch = 1;
+    if (batch == 1)
+        return UBASE_ERR_NONE;
+
+    upipe_udpsrc->batch_urefs = calloc(batch, sizeof(struct uref *));
+    upipe_udpsrc->batch_msgs = calloc(batch, sizeof(struct mmsghdr));
+    upipe_udpsrc->batch_iovecs = calloc(batch, sizeof(struct iovec));
+    upipe_udpsrc->batch_addrs = calloc(batch, sizeof(struct sockaddr_storage));
+    upipe_udpsrc->batch_controls =
+        calloc(batch, UPIPE_UDP_RX_TIMESTAMP_CONTROL_SIZE);
+    if (unlikely(upipe_udpsrc->batch_urefs == NULL ||
+                 upipe_udpsrc->batch_msgs == NULL ||
+                 upipe_udpsrc->batch_iovecs == NULL ||
+                 upipe_udpsrc->batch_addrs == NULL ||
+                 upipe_udpsrc->batch_controls == NULL)) {
+        upipe_udpsrc_clean_batch(upipe);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    upipe_udpsrc->batch = batch;
+    upipe_udpsrc_set_rx_timestamps(upipe);
+    upipe_dbg_va(upipe, "reading up to %u datagrams per wakeup", batch);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the type of reception timestamps used for cr_sys.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp type of timestamps
+ * @return an error code
+ */
+static int _upipe_udpsrc_set_timestamp(struct upipe *upipe,
+                                       enum upipe_udpsrc_timestamp timestamp)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    switch (timestamp) {
+        case UPIPE_UDPSRC_TIMESTAMP_NONE:
+        case UPIPE_UDPSRC_TIMESTAMP_SOFTWARE:
+        case UPIPE_UDPSRC_TIMESTAMP_HARDWARE:
+            break;
+        default:
+            return UBASE_ERR_INVALID;
+    }
+
+    if (timestamp != UPIPE_UDPSRC_TIMESTAMP_NONE && upipe_udpsrc->fd != -1 &&
+        !upipe_udp_set_rx_timestamps(upipe, upipe_udpsrc->fd,
+            timestamp == UPIPE_UDPSRC_TIMESTAMP_HARDWARE))
+        return UBASE_ERR_EXTERNAL;
+    upipe_udpsrc->timestamp = timestamp;
+    upipe_udpsrc->hw_timestamp_mismatch = false;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a udp socket source pipe.
  *
  * @param upipe description structure of the pipe
@@ -357,10 +997,10 @@ static int _upipe_udpsrc_control(struct upipe *upipe,
 
     switch (command) {
         case UPIPE_ATTACH_UPUMP_MGR:
-            upipe_udpsrc_set_upump(upipe, NULL);
+            upipe_udpsrc_stop(upipe);
             return upipe_udpsrc_attach_upump_mgr(upipe);
         case UPIPE_ATTACH_UCLOCK:
-            upipe_udpsrc_set_upump(upipe, NULL);
+            upipe_udpsrc_stop(upipe);
             upipe_udpsrc_require_uclock(upipe);
             return UBASE_ERR_NONE;
 
@@ -369,8 +1009,10 @@ static int _upipe_udpsrc_control(struct upipe *upipe,
         case UPIPE_SET_OUTPUT:
             return upipe_udpsrc_control_output(upipe, command, args);
 
-        case UPIPE_GET_OUTPUT_SIZE:
         case UPIPE_SET_OUTPUT_SIZE:
+            upipe_udpsrc_flush_batch(upipe);
+            /* fallthrough */
+        case UPIPE_GET_OUTPUT_SIZE:
             return upipe_udpsrc_control_output_size(upipe, command, args);
 
         case UPIPE_GET_URI: {
@@ -389,12 +1031,37 @@ static int _upipe_udpsrc_control(struct upipe *upipe,
         }
         case UPIPE_UDPSRC_SET_FD: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
-            upipe_udpsrc_set_upump(upipe, NULL);
+            upipe_udpsrc_stop(upipe);
             if (likely(upipe_udpsrc->fd != -1))
                 close(upipe_udpsrc->fd);
             upipe_udpsrc->fd = va_arg(args, int );
+            upipe_udpsrc_set_rx_timestamps(upipe);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSRC_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            *batch_p = upipe_udpsrc->batch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSRC_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            return _upipe_udpsrc_set_batch(upipe, batch);
+        }
+        case UPIPE_UDPSRC_GET_TIMESTAMP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            enum upipe_udpsrc_timestamp *timestamp_p =
+                va_arg(args, enum upipe_udpsrc_timestamp *);
+            *timestamp_p = upipe_udpsrc->timestamp;
             return UBASE_ERR_NONE;
         }
+        case UPIPE_UDPSRC_SET_TIMESTAMP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            enum upipe_udpsrc_timestamp timestamp =
+                va_arg(args, enum upipe_udpsrc_timestamp);
+            return _upipe_udpsrc_set_timestamp(upipe, timestamp);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -435,6 +1102,8 @@ static void upipe_udpsrc_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     free(upipe_udpsrc->uri);
+    upipe_udpsrc_stop(upipe);
+    upipe_udpsrc_clean_batch(upipe);
     upipe_udpsrc_clean_output_size(upipe);
     upipe_udpsrc_clean_uclock(upipe);
     upipe_udpsrc_clean_upump(upipe);
@@ -345,6 +345,7 @@ static void upipe_videocont_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_videocont *upipe_videocont = upipe_videocont_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_videocont->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_videocont_to_urefcount(upipe_videocont);
     sub_mgr->signature = UPIPE_VIDEOCONT_SUB_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_videocont_sub_alloc;
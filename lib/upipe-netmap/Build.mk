@@ -5,7 +5,13 @@ lib-targets = libupipe_netmap
 
 libupipe_netmap-desc = netmap interface module
 libupipe_netmap-so-version = 1.0.0
-libupipe_netmap-includes = upipe_netmap_source.h
-libupipe_netmap-src = upipe_netmap_source.c
+libupipe_netmap-includes = \
+    ubuf_block_netmap.h \
+    upipe_netmap_sink.h \
+    upipe_netmap_source.h
+libupipe_netmap-src = \
+    ubuf_block_netmap.c \
+    upipe_netmap_sink.c \
+    upipe_netmap_source.c
 libupipe_netmap-deps = netmap
 libupipe_netmap-libs = libupipe bitstream
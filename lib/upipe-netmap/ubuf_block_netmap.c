@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats with netmap storage
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/urefcount.h"
+#include "upipe/uatomic.h"
+#include "upipe/ulifo.h"
+#include "upipe/upool.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+#include "upipe/ubuf_block_common.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe-netmap/ubuf_block_netmap.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#include <net/if.h>
+
+#define NETMAP_WITH_LIBS
+#include <net/netmap.h>
+#include <net/netmap_user.h>
+
+/** @This is a netmap buffer, either spare or held by ubufs. */
+struct ubuf_block_netmap_buf {
+    /** number of ubufs pointing to the buffer */
+    uatomic_uint32_t refcount;
+    /** netmap index of the buffer */
+    uint32_t buf_idx;
+};
+
+/** @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure with private fields pointing to the netmap buffer. */
+struct ubuf_block_netmap {
+    /** pointer to netmap buffer */
+    struct ubuf_block_netmap_buf *buf;
+
+    /** block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(ubuf_block_netmap, ubuf, ubuf, ubuf_block.ubuf)
+
+/** @This is a super-set of the ubuf_mgr structure with additional local
+ * members. */
+struct ubuf_block_netmap_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** netmap descriptor */
+    struct nm_desc *d;
+    /** any ring of the descriptor, to compute buffer addresses */
+    struct netmap_ring *ring;
+    /** number of extra buffers */
+    unsigned int nb_bufs;
+    /** array of extra buffers */
+    struct ubuf_block_netmap_buf *bufs;
+    /** spare buffers */
+    struct ulifo spare;
+    /** extra space for the spare buffers LIFO */
+    void *spare_extra;
+
+    /** block manager for the blocks not pointing to a netmap buffer */
+    struct ubuf_mgr *block_mgr;
+
+    /** ubuf pool */
+    struct upool ubuf_pool;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(ubuf_block_netmap_mgr, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(ubuf_block_netmap_mgr, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(ubuf_block_netmap_mgr, upool, ubuf_pool, ubuf_pool)
+
+/** @internal @This allocates a ubuf structure from the pool.
+ *
+ * @param mgr common management structure
+ * @param buf netmap buffer to point to
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_block_netmap_alloc_ubuf(struct ubuf_mgr *mgr,
+        struct ubuf_block_netmap_buf *buf)
+{
+    struct ubuf_block_netmap_mgr *netmap_mgr =
+        ubuf_block_netmap_mgr_from_ubuf_mgr(mgr);
+    struct ubuf_block_netmap *block_netmap =
+        upool_alloc(&netmap_mgr->ubuf_pool, struct ubuf_block_netmap *);
+    if (unlikely(block_netmap == NULL))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_block_netmap_to_ubuf(block_netmap);
+    ubuf->mgr = mgr;
+    ubuf_block_common_init(ubuf, false);
+    block_netmap->buf = buf;
+    uatomic_fetch_add(&buf->refcount, 1);
+    return ubuf;
+}
+
+/** @This allocates a ubuf from a netmap slot. Other allocations, such as
+ * UBUF_ALLOC_BLOCK, are forwarded to the internal block manager.
+ *
+ * @param mgr common management structure
+ * @param signature type of allocation
+ * @param args optional arguments
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_block_netmap_alloc(struct ubuf_mgr *mgr,
+                                            uint32_t signature, va_list args)
+{
+    struct ubuf_block_netmap_mgr *netmap_mgr =
+        ubuf_block_netmap_mgr_from_ubuf_mgr(mgr);
+    if (signature != UBUF_BLOCK_NETMAP_ALLOC_SLOT)
+        return netmap_mgr->block_mgr->ubuf_alloc(netmap_mgr->block_mgr,
+                                                 signature, args);
+
+    struct netmap_ring *ring = va_arg(args, struct netmap_ring *);
+    struct netmap_slot *slot = va_arg(args, struct netmap_slot *);
+    int offset = va_arg(args, int);
+    int size = va_arg(args, int);
+    if (unlikely(offset < 0 || size < 0 ||
+                 (uint32_t)offset + size > ring->nr_buf_size))
+        return NULL;
+
+    struct ubuf_block_netmap_buf *buf =
+        ulifo_pop(&netmap_mgr->spare, struct ubuf_block_netmap_buf *);
+    if (unlikely(buf == NULL))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_block_netmap_alloc_ubuf(mgr, buf);
+    if (unlikely(ubuf == NULL)) {
+        ulifo_push(&netmap_mgr->spare, buf);
+        return NULL;
+    }
+
+    /* give the spare buffer to the ring and keep the received one */
+    uint32_t buf_idx = slot->buf_idx;
+    slot->buf_idx = buf->buf_idx;
+    slot->flags |= NS_BUF_CHANGED;
+    buf->buf_idx = buf_idx;
+
+    ubuf_block_common_set(ubuf, offset, size);
+    ubuf_block_common_set_buffer(ubuf,
+            (uint8_t *)NETMAP_BUF(netmap_mgr->ring, buf_idx));
+    return ubuf;
+}
+
+/** @This asks for the creation of a new reference to the same buffer space.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @return an error code
+ */
+static int ubuf_block_netmap_dup(struct ubuf *ubuf, struct ubuf **new_ubuf_p)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_netmap *block_netmap = ubuf_block_netmap_from_ubuf(ubuf);
+    struct ubuf *new_ubuf = ubuf_block_netmap_alloc_ubuf(ubuf->mgr,
+                                                         block_netmap->buf);
+    if (unlikely(new_ubuf == NULL))
+        return UBASE_ERR_ALLOC;
+
+    if (unlikely(!ubase_check(ubuf_block_common_dup(ubuf, new_ubuf)))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This checks whether there is only one reference to the netmap buffer.
+ *
+ * @param ubuf pointer to ubuf
+ * @return an error code
+ */
+static int ubuf_block_netmap_single(struct ubuf *ubuf)
+{
+    struct ubuf_block_netmap *block_netmap = ubuf_block_netmap_from_ubuf(ubuf);
+    return uatomic_load(&block_netmap->buf->refcount) == 1 ?
+           UBASE_ERR_NONE : UBASE_ERR_BUSY;
+}
+
+/** @This asks for the creation of a new reference to the same buffer space.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param offset offset in the buffer
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int ubuf_block_netmap_splice(struct ubuf *ubuf,
+                                    struct ubuf **new_ubuf_p,
+                                    int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_netmap *block_netmap = ubuf_block_netmap_from_ubuf(ubuf);
+    struct ubuf *new_ubuf = ubuf_block_netmap_alloc_ubuf(ubuf->mgr,
+                                                         block_netmap->buf);
+    if (unlikely(new_ubuf == NULL))
+        return UBASE_ERR_ALLOC;
+
+    if (unlikely(!ubase_check(ubuf_block_common_splice(ubuf, new_ubuf,
+                                                       offset, size)))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_netmap_control(struct ubuf *ubuf,
+                                     int command, va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return ubuf_block_netmap_dup(ubuf, new_ubuf_p);
+        }
+        case UBUF_SINGLE:
+            return ubuf_block_netmap_single(ubuf);
+
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return ubuf_block_netmap_splice(ubuf, new_ubuf_p, offset, size);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This recycles or frees a ubuf. The netmap buffer goes back to the spare
+ * buffers when it is no longer used.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void ubuf_block_netmap_free(struct ubuf *ubuf)
+{
+    struct ubuf_block_netmap_mgr *netmap_mgr =
+        ubuf_block_netmap_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_netmap *block_netmap = ubuf_block_netmap_from_ubuf(ubuf);
+
+    ubuf_block_common_clean(ubuf);
+
+    struct ubuf_block_netmap_buf *buf = block_netmap->buf;
+    if (uatomic_fetch_sub(&buf->refcount, 1) == 1) {
+        bool ret = ulifo_push(&netmap_mgr->spare, buf);
+        assert(ret);
+        (void)ret;
+    }
+    upool_free(&netmap_mgr->ubuf_pool, block_netmap);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to ubuf_block_netmap or NULL in case of allocation error
+ */
+static void *ubuf_block_netmap_alloc_inner(struct upool *upool)
+{
+    return malloc(sizeof(struct ubuf_block_netmap));
+}
+
+/** @internal @This frees a ubuf_block_netmap.
+ *
+ * @param upool pointer to upool
+ * @param _block_netmap pointer to a ubuf_block_netmap structure to free
+ */
+static void ubuf_block_netmap_free_inner(struct upool *upool,
+                                         void *_block_netmap)
+{
+    free(_block_netmap);
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_netmap_mgr_control(struct ubuf_mgr *mgr,
+                                         int command, va_list args)
+{
+    struct ubuf_block_netmap_mgr *netmap_mgr =
+        ubuf_block_netmap_mgr_from_ubuf_mgr(mgr);
+
+    switch (command) {
+        case UBUF_MGR_VACUUM:
+            upool_vacuum(&netmap_mgr->ubuf_pool);
+            return ubuf_mgr_vacuum(netmap_mgr->block_mgr);
+        case UBUF_MGR_GET_STATS: {
+            struct upool_stats *stats = va_arg(args, struct upool_stats *);
+            upool_add_stats(&netmap_mgr->ubuf_pool, stats);
+            return ubuf_mgr_get_stats(netmap_mgr->block_mgr, stats);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf manager. The extra buffers are given back to netmap
+ * before the descriptor is closed.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void ubuf_block_netmap_mgr_free(struct urefcount *urefcount)
+{
+    struct ubuf_block_netmap_mgr *netmap_mgr =
+        ubuf_block_netmap_mgr_from_urefcount(urefcount);
+    upool_clean(&netmap_mgr->ubuf_pool);
+
+    uint32_t head = netmap_mgr->d->nifp->ni_bufs_head;
+    for (unsigned int i = 0; i < netmap_mgr->nb_bufs; i++) {
+        struct ubuf_block_netmap_buf *buf = &netmap_mgr->bufs[i];
+        *(uint32_t *)NETMAP_BUF(netmap_mgr->ring, buf->buf_idx) = head;
+        head = buf->buf_idx;
+        uatomic_clean(&buf->refcount);
+    }
+    netmap_mgr->d->nifp->ni_bufs_head = head;
+    nm_close(netmap_mgr->d);
+    ubuf_mgr_release(netmap_mgr->block_mgr);
+
+    ulifo_clean(&netmap_mgr->spare);
+    free(netmap_mgr->spare_extra);
+    free(netmap_mgr->bufs);
+    urefcount_clean(urefcount);
+    free(netmap_mgr);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * using netmap buffers. The manager takes ownership of the netmap
+ * descriptor, and closes it when the last ubuf is freed. On error, the
+ * descriptor is left untouched.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param d netmap descriptor, opened with extra buffers (nr_arg3)
+ * @return pointer to manager, or NULL in case of error, or if the
+ * descriptor has no extra buffer
+ */
+struct ubuf_mgr *ubuf_block_netmap_mgr_alloc(uint16_t ubuf_pool_depth,
+                                             struct nm_desc *d)
+{
+    assert(d != NULL);
+    struct netmap_ring *ring = NETMAP_RXRING(d->nifp, 0);
+
+    /* count the extra buffers, the LIFO holds at most UINT16_MAX */
+    unsigned int nb_bufs = 0;
+    uint32_t buf_idx = d->nifp->ni_bufs_head;
+    while (buf_idx && nb_bufs < UINT16_MAX) {
+        nb_bufs++;
+        buf_idx = *(uint32_t *)NETMAP_BUF(ring, buf_idx);
+    }
+    if (unlikely(!nb_bufs))
+        return NULL;
+
+    struct ubuf_block_netmap_mgr *netmap_mgr =
+        malloc(sizeof(struct ubuf_block_netmap_mgr) +
+               upool_sizeof(ubuf_pool_depth));
+    if (unlikely(netmap_mgr == NULL))
+        return NULL;
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    if (unlikely(umem_mgr == NULL)) {
+        free(netmap_mgr);
+        return NULL;
+    }
+    netmap_mgr->block_mgr = ubuf_block_mem_mgr_alloc(ubuf_pool_depth,
+                                                     ubuf_pool_depth, umem_mgr,
+                                                     -1, 0, -1, 0);
+    umem_mgr_release(umem_mgr);
+    if (unlikely(netmap_mgr->block_mgr == NULL)) {
+        free(netmap_mgr);
+        return NULL;
+    }
+
+    netmap_mgr->d = d;
+    netmap_mgr->ring = ring;
+    netmap_mgr->nb_bufs = nb_bufs;
+    netmap_mgr->bufs = malloc(nb_bufs * sizeof(struct ubuf_block_netmap_buf));
+    netmap_mgr->spare_extra = malloc(ulifo_sizeof(nb_bufs));
+    if (unlikely(netmap_mgr->bufs == NULL ||
+                 netmap_mgr->spare_extra == NULL)) {
+        free(netmap_mgr->bufs);
+        free(netmap_mgr->spare_extra);
+        ubuf_mgr_release(netmap_mgr->block_mgr);
+        free(netmap_mgr);
+        return NULL;
+    }
+    ulifo_init(&netmap_mgr->spare, nb_bufs, netmap_mgr->spare_extra);
+
+    buf_idx = d->nifp->ni_bufs_head;
+    for (unsigned int i = 0; i < nb_bufs; i++) {
+        struct ubuf_block_netmap_buf *buf = &netmap_mgr->bufs[i];
+        uatomic_init(&buf->refcount, 0);
+        buf->buf_idx = buf_idx;
+        buf_idx = *(uint32_t *)NETMAP_BUF(ring, buf_idx);
+        ulifo_push(&netmap_mgr->spare, buf);
+    }
+    d->nifp->ni_bufs_head = buf_idx;
+
+    urefcount_init(ubuf_block_netmap_mgr_to_urefcount(netmap_mgr),
+                   ubuf_block_netmap_mgr_free);
+    netmap_mgr->mgr.refcount = ubuf_block_netmap_mgr_to_urefcount(netmap_mgr);
+    netmap_mgr->mgr.signature = UBUF_ALLOC_BLOCK;
+    netmap_mgr->mgr.ubuf_alloc = ubuf_block_netmap_alloc;
+    netmap_mgr->mgr.ubuf_control = ubuf_block_netmap_control;
+    netmap_mgr->mgr.ubuf_free = ubuf_block_netmap_free;
+    netmap_mgr->mgr.ubuf_mgr_control = ubuf_block_netmap_mgr_control;
+
+    upool_init(&netmap_mgr->ubuf_pool, netmap_mgr->mgr.refcount,
+               ubuf_pool_depth, netmap_mgr->upool_extra,
+               ubuf_block_netmap_alloc_inner, ubuf_block_netmap_free_inner);
+
+    return ubuf_block_netmap_mgr_to_ubuf_mgr(netmap_mgr);
+}
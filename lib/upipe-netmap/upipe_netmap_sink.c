@@ -0,0 +1,643 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe sink module for netmap sockets
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/uprobe.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_flow.h"
+#include "upipe/upump.h"
+#include "upipe/upipe.h"
+#include "upipe/upipe_helper_upipe.h"
+#include "upipe/upipe_helper_urefcount.h"
+#include "upipe/upipe_helper_void.h"
+#include "upipe/upipe_helper_upump_mgr.h"
+#include "upipe/upipe_helper_upump.h"
+#include "upipe/upipe_helper_input.h"
+#include "upipe-netmap/upipe_netmap_sink.h"
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+
+#define NETMAP_WITH_LIBS
+#include <net/netmap.h>
+#include <net/netmap_user.h>
+
+#include <bitstream/ietf/ip.h>
+#include <bitstream/ietf/udp.h>
+#include <bitstream/ieee/ethernet.h>
+
+/** expected flow definition on all flows */
+#define EXPECTED_FLOW_DEF "block."
+/** size of the headers added to UDP payloads */
+#define UDP_HEADERS_SIZE \
+    (ETHERNET_HEADER_LEN + IP_HEADER_MINSIZE + UDP_HEADER_SIZE)
+/** time-to-live of the output packets */
+#define NETMAP_SINK_TTL 64
+
+/** @hidden */
+static void upipe_netmap_sink_watcher(struct upump *upump);
+/** @hidden */
+static bool upipe_netmap_sink_output(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p);
+
+/** @internal @This is the private context of a netmap sink pipe. */
+struct upipe_netmap_sink {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** write watcher */
+    struct upump *upump;
+
+    /** netmap descriptor */
+    struct nm_desc *d;
+    /** netmap uri */
+    char *uri;
+
+    /** true if UDP headers are added */
+    bool udp;
+    /** template of the ethernet, IP and UDP headers */
+    uint8_t header[UDP_HEADERS_SIZE];
+
+    /** temporary uref storage */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers */
+    struct uchain blockers;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_netmap_sink, upipe, UPIPE_NETMAP_SINK_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_netmap_sink, urefcount, upipe_netmap_sink_free)
+UPIPE_HELPER_VOID(upipe_netmap_sink)
+UPIPE_HELPER_UPUMP_MGR(upipe_netmap_sink, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_netmap_sink, upump, upump_mgr)
+UPIPE_HELPER_INPUT(upipe_netmap_sink, urefs, nb_urefs, max_urefs, blockers,
+                   upipe_netmap_sink_output)
+
+/** @internal @This allocates a netmap sink pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_netmap_sink_alloc(struct upipe_mgr *mgr,
+                                             struct uprobe *uprobe,
+                                             uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_netmap_sink_alloc_void(mgr, uprobe, signature,
+                                                       args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    upipe_netmap_sink_init_urefcount(upipe);
+    upipe_netmap_sink_init_upump_mgr(upipe);
+    upipe_netmap_sink_init_upump(upipe);
+    upipe_netmap_sink_init_input(upipe);
+    upipe_netmap_sink->d = NULL;
+    upipe_netmap_sink->uri = NULL;
+    upipe_netmap_sink->udp = false;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This starts the watcher waiting for free transmit slots.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_netmap_sink_poll(struct upipe *upipe)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    if (unlikely(!ubase_check(upipe_netmap_sink_check_upump_mgr(upipe)))) {
+        upipe_err_va(upipe, "can't get upump_mgr");
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return;
+    }
+    struct upump *watcher = upump_alloc_fd_write(upipe_netmap_sink->upump_mgr,
+            upipe_netmap_sink_watcher, upipe, upipe->refcount,
+            NETMAP_FD(upipe_netmap_sink->d));
+    if (unlikely(watcher == NULL)) {
+        upipe_err_va(upipe, "can't create watcher");
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+    } else {
+        upipe_netmap_sink_set_upump(upipe, watcher);
+        upump_start(watcher);
+    }
+}
+
+/** @internal @This hands the filled slots over to the kernel.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_netmap_sink_sync(struct upipe *upipe)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    if (likely(upipe_netmap_sink->d != NULL))
+        ioctl(NETMAP_FD(upipe_netmap_sink->d), NIOCTXSYNC, NULL);
+}
+
+/** @internal @This computes the checksum of an IPv4 header.
+ *
+ * @param ip pointer to the IPv4 header, with a zero checksum
+ * @return checksum
+ */
+static uint16_t upipe_netmap_sink_ip_cksum(const uint8_t *ip)
+{
+    uint32_t sum = 0;
+    for (unsigned int i = 0; i < IP_HEADER_MINSIZE; i += 2)
+        sum += (ip[i] << 8) | ip[i + 1];
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum;
+}
+
+/** @internal @This copies a buffer into a transmit slot.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return true if the uref was processed
+ */
+static bool upipe_netmap_sink_output(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        uref_free(uref);
+        return true;
+    }
+
+    if (unlikely(upipe_netmap_sink->d == NULL)) {
+        uref_free(uref);
+        upipe_warn(upipe, "received a buffer before opening a netmap port");
+        return true;
+    }
+
+    struct nm_desc *d = upipe_netmap_sink->d;
+    struct netmap_ring *txring = NETMAP_TXRING(d->nifp, d->first_tx_ring);
+    if (unlikely(nm_ring_empty(txring))) {
+        ioctl(NETMAP_FD(d), NIOCTXSYNC, NULL);
+        if (nm_ring_empty(txring)) {
+            upipe_netmap_sink_poll(upipe);
+            return false;
+        }
+    }
+
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
+        upipe_warn(upipe, "unable to read buffer");
+        uref_free(uref);
+        return true;
+    }
+
+    size_t header_size = upipe_netmap_sink->udp ? UDP_HEADERS_SIZE : 0;
+    if (unlikely(header_size + size > txring->nr_buf_size)) {
+        upipe_warn_va(upipe, "dropping packet too large for netmap (%zu)",
+                      size);
+        uref_free(uref);
+        return true;
+    }
+
+    struct netmap_slot *slot = &txring->slot[txring->cur];
+    uint8_t *buffer = (uint8_t *)NETMAP_BUF(txring, slot->buf_idx);
+    if (upipe_netmap_sink->udp) {
+        memcpy(buffer, upipe_netmap_sink->header, UDP_HEADERS_SIZE);
+        uint8_t *ip = buffer + ETHERNET_HEADER_LEN;
+        ip_set_len(ip, IP_HEADER_MINSIZE + UDP_HEADER_SIZE + size);
+        ip_set_cksum(ip, upipe_netmap_sink_ip_cksum(ip));
+        udp_set_len(ip_payload(ip), UDP_HEADER_SIZE + size);
+    }
+    uref_block_extract(uref, 0, size, buffer + header_size);
+    uref_free(uref);
+
+    slot->len = header_size + size;
+    txring->head = txring->cur = nm_ring_next(txring, txring->cur);
+    return true;
+}
+
+/** @internal @This is called when the transmit ring has free slots again.
+ *
+ * @param upump description structure of the watcher
+ */
+static void upipe_netmap_sink_watcher(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    upipe_netmap_sink_set_upump(upipe, NULL);
+    upipe_netmap_sink_output_input(upipe);
+    upipe_netmap_sink_sync(upipe);
+    upipe_netmap_sink_unblock_input(upipe);
+    if (upipe_netmap_sink_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_netmap_sink_input. */
+        upipe_release(upipe);
+    }
+}
+
+/** @internal @This receives data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_netmap_sink_input(struct upipe *upipe, struct uref *uref,
+                                    struct upump **upump_p)
+{
+    if (!upipe_netmap_sink_check_input(upipe)) {
+        upipe_netmap_sink_hold_input(upipe, uref);
+        upipe_netmap_sink_block_input(upipe, upump_p);
+    } else if (!upipe_netmap_sink_output(upipe, uref, upump_p)) {
+        upipe_netmap_sink_hold_input(upipe, uref);
+        upipe_netmap_sink_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+    upipe_netmap_sink_sync(upipe);
+}
+
+/** @internal @This receives a list of urefs, and hands them over to the
+ * kernel at once.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_netmap_sink_input_chain(struct upipe *upipe,
+                                          struct uchain *urefs,
+                                          struct upump **upump_p)
+{
+    bool blocked = !upipe_netmap_sink_check_input(upipe);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(urefs)) != NULL) {
+        struct uref *uref = uref_from_uchain(uchain);
+        if (!upipe_netmap_sink_check_input(upipe))
+            upipe_netmap_sink_hold_input(upipe, uref);
+        else if (!upipe_netmap_sink_output(upipe, uref, upump_p)) {
+            upipe_netmap_sink_hold_input(upipe, uref);
+            /* Increment upipe refcount to avoid disappearing before all
+             * packets have been sent. */
+            upipe_use(upipe);
+        }
+    }
+    upipe_netmap_sink_sync(upipe);
+
+    if (blocked || !upipe_netmap_sink_check_input(upipe))
+        upipe_netmap_sink_block_input(upipe, upump_p);
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_netmap_sink_set_flow_def(struct upipe *upipe,
+                                          struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF))
+    flow_def = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def)
+    upipe_input(upipe, flow_def, NULL);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the uri of the currently opened netmap port.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri_p filled in with the uri of the netmap port
+ * @return an error code
+ */
+static int upipe_netmap_sink_get_uri(struct upipe *upipe, const char **uri_p)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    assert(uri_p != NULL);
+    *uri_p = upipe_netmap_sink->uri;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This asks to open the given netmap port.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri netmap port name
+ * @return an error code
+ */
+static int upipe_netmap_sink_set_uri(struct upipe *upipe, const char *uri)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+
+    upipe_netmap_sink_set_upump(upipe, NULL);
+    if (upipe_netmap_sink->d != NULL) {
+        upipe_notice_va(upipe, "closing netmap port %s",
+                        upipe_netmap_sink->uri);
+        nm_close(upipe_netmap_sink->d);
+        upipe_netmap_sink->d = NULL;
+    }
+    ubase_clean_str(&upipe_netmap_sink->uri);
+    if (!upipe_netmap_sink_check_input(upipe))
+        /* Release the pipe used in @ref upipe_netmap_sink_input. */
+        upipe_release(upipe);
+
+    if (unlikely(uri == NULL))
+        return UBASE_ERR_NONE;
+
+    upipe_netmap_sink->d = nm_open(uri, NULL, 0, NULL);
+    if (unlikely(upipe_netmap_sink->d == NULL)) {
+        upipe_err_va(upipe, "can't open netmap port %s", uri);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    upipe_netmap_sink->uri = strdup(uri);
+    if (unlikely(upipe_netmap_sink->uri == NULL)) {
+        nm_close(upipe_netmap_sink->d);
+        upipe_netmap_sink->d = NULL;
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    if (!upipe_netmap_sink_check_input(upipe))
+        /* Use again the pipe that we previously released. */
+        upipe_use(upipe);
+    upipe_notice_va(upipe, "opening netmap port %s ring %u", uri,
+                    upipe_netmap_sink->d->first_tx_ring);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This parses an address of the form ip:port.
+ *
+ * @param upipe description structure of the pipe
+ * @param string address to parse
+ * @param addr_p filled in with the IPv4 address, in host order
+ * @param port_p filled in with the port
+ * @return an error code
+ */
+static int upipe_netmap_sink_parse_addr(struct upipe *upipe,
+                                        const char *string,
+                                        uint32_t *addr_p, uint16_t *port_p)
+{
+    char host[INET_ADDRSTRLEN];
+    const char *colon = strchr(string, ':');
+    char *end;
+    unsigned long port;
+    if (colon == NULL || colon - string >= (ptrdiff_t)sizeof(host) ||
+        (port = strtoul(colon + 1, &end, 10)) > UINT16_MAX || *end)
+        goto invalid;
+
+    memcpy(host, string, colon - string);
+    host[colon - string] = '\0';
+    struct in_addr in;
+    if (inet_pton(AF_INET, host, &in) != 1)
+        goto invalid;
+
+    *addr_p = ntohl(in.s_addr);
+    *port_p = port;
+    return UBASE_ERR_NONE;
+
+invalid:
+    upipe_err_va(upipe, "invalid address %s", string);
+    return UBASE_ERR_INVALID;
+}
+
+/** @internal @This sets the addresses of the output UDP packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param src source address and port (ip:port)
+ * @param dst destination address and port (ip:port), or NULL
+ * @param src_mac source MAC address, or NULL
+ * @param dst_mac destination MAC address, or NULL
+ * @return an error code
+ */
+static int _upipe_netmap_sink_set_udp(struct upipe *upipe,
+                                      const char *src, const char *dst,
+                                      const uint8_t *src_mac,
+                                      const uint8_t *dst_mac)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    if (dst == NULL) {
+        upipe_netmap_sink->udp = false;
+        return UBASE_ERR_NONE;
+    }
+
+    uint32_t src_addr = 0, dst_addr;
+    uint16_t src_port = 0, dst_port;
+    if (src != NULL)
+        UBASE_RETURN(upipe_netmap_sink_parse_addr(upipe, src,
+                                                  &src_addr, &src_port))
+    UBASE_RETURN(upipe_netmap_sink_parse_addr(upipe, dst,
+                                              &dst_addr, &dst_port))
+
+    uint8_t *header = upipe_netmap_sink->header;
+    memset(header, 0, UDP_HEADERS_SIZE);
+    if (dst_mac != NULL)
+        memcpy(header, dst_mac, ETHERNET_ADDR_LEN);
+    else if ((dst_addr >> 28) == 0xe) {
+        /* IPv4 multicast MAC address */
+        header[0] = 0x01;
+        header[1] = 0x00;
+        header[2] = 0x5e;
+        header[3] = (dst_addr >> 16) & 0x7f;
+        header[4] = (dst_addr >> 8) & 0xff;
+        header[5] = dst_addr & 0xff;
+    } else
+        memset(header, 0xff, ETHERNET_ADDR_LEN);
+    if (src_mac != NULL)
+        memcpy(header + ETHERNET_ADDR_LEN, src_mac, ETHERNET_ADDR_LEN);
+    ethernet_set_lentype(header, ETHERNET_TYPE_IP);
+
+    uint8_t *ip = header + ETHERNET_HEADER_LEN;
+    ip_set_version(ip, 4);
+    ip_set_ihl(ip, 5);
+    ip_set_tos(ip, 0);
+    ip_set_id(ip, 0);
+    ip_set_flag_reserved(ip, 0);
+    ip_set_flag_df(ip, 1);
+    ip_set_flag_mf(ip, 0);
+    ip_set_frag_offset(ip, 0);
+    ip_set_ttl(ip, NETMAP_SINK_TTL);
+    ip_set_proto(ip, IP_PROTO_UDP);
+    ip_set_cksum(ip, 0);
+    ip_set_srcaddr(ip, src_addr);
+    ip_set_dstaddr(ip, dst_addr);
+
+    uint8_t *udp = ip_payload(ip);
+    udp_set_srcport(udp, src_port);
+    udp_set_dstport(udp, dst_port);
+    udp_set_cksum(udp, 0);
+
+    upipe_netmap_sink->udp = true;
+    upipe_notice_va(upipe, "sending UDP packets to %s", dst);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This flushes all currently held buffers, and unblocks the
+ * sources.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_netmap_sink_flush(struct upipe *upipe)
+{
+    if (upipe_netmap_sink_flush_input(upipe)) {
+        upipe_netmap_sink_set_upump(upipe, NULL);
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_netmap_sink_input. */
+        upipe_release(upipe);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a netmap sink pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_netmap_sink_control(struct upipe *upipe,
+                                      int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST:
+        case UPIPE_UNREGISTER_REQUEST:
+            return upipe_control_provide_request(upipe, command, args);
+
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_netmap_sink_set_upump(upipe, NULL);
+            return upipe_netmap_sink_attach_upump_mgr(upipe);
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_netmap_sink_set_flow_def(upipe, flow_def);
+        }
+
+        case UPIPE_GET_MAX_LENGTH: {
+            unsigned int *p = va_arg(args, unsigned int *);
+            return upipe_netmap_sink_get_max_length(upipe, p);
+        }
+        case UPIPE_SET_MAX_LENGTH: {
+            unsigned int max_length = va_arg(args, unsigned int);
+            return upipe_netmap_sink_set_max_length(upipe, max_length);
+        }
+
+        case UPIPE_GET_URI: {
+            const char **uri_p = va_arg(args, const char **);
+            return upipe_netmap_sink_get_uri(upipe, uri_p);
+        }
+        case UPIPE_SET_URI: {
+            const char *uri = va_arg(args, const char *);
+            return upipe_netmap_sink_set_uri(upipe, uri);
+        }
+
+        case UPIPE_NETMAP_SINK_SET_UDP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_NETMAP_SINK_SIGNATURE)
+            const char *src = va_arg(args, const char *);
+            const char *dst = va_arg(args, const char *);
+            const uint8_t *src_mac = va_arg(args, const uint8_t *);
+            const uint8_t *dst_mac = va_arg(args, const uint8_t *);
+            return _upipe_netmap_sink_set_udp(upipe, src, dst,
+                                              src_mac, dst_mac);
+        }
+        case UPIPE_FLUSH:
+            return upipe_netmap_sink_flush(upipe);
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a netmap sink pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_netmap_sink_control(struct upipe *upipe,
+                                     int command, va_list args)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    UBASE_RETURN(_upipe_netmap_sink_control(upipe, command, args));
+
+    if (unlikely(!upipe_netmap_sink_check_input(upipe) &&
+                 upipe_netmap_sink->d != NULL &&
+                 upipe_netmap_sink->upump == NULL))
+        upipe_netmap_sink_poll(upipe);
+
+    return UBASE_ERR_NONE;
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_netmap_sink_free(struct upipe *upipe)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+
+    upipe_netmap_sink_set_upump(upipe, NULL);
+    if (upipe_netmap_sink->d != NULL) {
+        upipe_notice_va(upipe, "closing netmap port %s",
+                        upipe_netmap_sink->uri);
+        nm_close(upipe_netmap_sink->d);
+    }
+    upipe_throw_dead(upipe);
+
+    free(upipe_netmap_sink->uri);
+    upipe_netmap_sink_clean_upump(upipe);
+    upipe_netmap_sink_clean_upump_mgr(upipe);
+    upipe_netmap_sink_clean_input(upipe);
+    upipe_netmap_sink_clean_urefcount(upipe);
+    upipe_netmap_sink_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_netmap_sink_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_NETMAP_SINK_SIGNATURE,
+
+    .upipe_alloc = upipe_netmap_sink_alloc,
+    .upipe_input = upipe_netmap_sink_input,
+    .upipe_input_chain = upipe_netmap_sink_input_chain,
+    .upipe_control = upipe_netmap_sink_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all netmap sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_netmap_sink_mgr_alloc(void)
+{
+    return &upipe_netmap_sink_mgr;
+}
@@ -9,6 +9,12 @@
 
 /** @file
  * @short Upipe source module for netmap sockets
+ *
+ * The source opens the netmap port with extra buffers, and outputs the
+ * UDP payloads in place, swapping the buffer of each receive slot with a
+ * spare one (see @ref ubuf_block_netmap_mgr_alloc). Packets are only copied
+ * when no spare buffer is left, because downstream pipes hold too many of
+ * them.
  */
 
 
@@ -21,6 +27,7 @@
 #include "upipe/uref_clock.h"
 #include "upipe/upump.h"
 #include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
 #include "upipe/upipe.h"
 #include "upipe/upipe_helper_upipe.h"
 #include "upipe/upipe_helper_urefcount.h"
@@ -32,6 +39,7 @@
 #include "upipe/upipe_helper_upump.h"
 #include "upipe/upipe_helper_uclock.h"
 #include "upipe-netmap/upipe_netmap_source.h"
+#include "upipe-netmap/ubuf_block_netmap.h"
 
 #include <net/if.h>
 
@@ -40,11 +48,17 @@
 #include <net/netmap_user.h>
 
 #include <poll.h>
+#include <string.h>
 
 #include <bitstream/ietf/ip.h>
 #include <bitstream/ietf/udp.h>
 #include <bitstream/ieee/ethernet.h>
 
+/** number of extra netmap buffers to request for zero-copy reception */
+#define NETMAP_EXTRA_BUFS 4096
+/** depth of the pool of netmap ubufs */
+#define UBUF_POOL_DEPTH 256
+
 /** @hidden */
 static int upipe_netmap_source_check(struct upipe *upipe, struct uref *flow_format);
 
@@ -86,6 +100,9 @@ struct upipe_netmap_source {
 
     /** netmap descriptor **/
     struct nm_desc *d;
+    /** ubuf manager wrapping netmap buffers, owning the descriptor if not
+     * NULL **/
+    struct ubuf_mgr *netmap_mgr;
 
     /** netmape uri **/
     char *uri;
@@ -140,6 +157,7 @@ static struct upipe *upipe_netmap_source_alloc(struct upipe_mgr *mgr,
     upipe_netmap_source_init_uclock(upipe);
     upipe_netmap_source->uri = NULL;
     upipe_netmap_source->d = NULL;
+    upipe_netmap_source->netmap_mgr = NULL;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -172,26 +190,44 @@ static void upipe_netmap_source_worker(struct upump *upump)
         const uint8_t *rtp = udp_payload(udp);
         uint16_t payload_len = udp_get_len(udp) - UDP_HEADER_SIZE;
 
-        struct uref *uref = uref_block_alloc(upipe_netmap_source->uref_mgr,
-                                             upipe_netmap_source->ubuf_mgr,
-                                             payload_len);
-        if (unlikely(uref == NULL)) {
-            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-            return;
-        }
-
-        uint8_t *buffer;
-        int output_size = -1;
-        if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
-                                                   &buffer)))) {
-            uref_free(uref);
-            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-            return;
+        struct uref *uref = NULL;
+        struct ubuf *ubuf = NULL;
+        if (likely(upipe_netmap_source->netmap_mgr != NULL))
+            ubuf = ubuf_block_netmap_alloc_slot(
+                    upipe_netmap_source->netmap_mgr, rxring,
+                    &rxring->slot[cur], rtp - src, payload_len);
+
+        if (likely(ubuf != NULL)) {
+            uref = uref_alloc(upipe_netmap_source->uref_mgr);
+            if (unlikely(uref == NULL)) {
+                ubuf_free(ubuf);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+            uref_attach_ubuf(uref, ubuf);
+        } else {
+            /* no spare buffer left, copy the payload */
+            uref = uref_block_alloc(upipe_netmap_source->uref_mgr,
+                                    upipe_netmap_source->ubuf_mgr,
+                                    payload_len);
+            if (unlikely(uref == NULL)) {
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+
+            uint8_t *buffer;
+            int output_size = -1;
+            if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
+                                                       &buffer)))) {
+                uref_free(uref);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+
+            memcpy(buffer, rtp, payload_len);
+            uref_block_unmap(uref, 0);
         }
 
-        memcpy(buffer, rtp, payload_len);
-        uref_block_unmap(uref, 0);
-
         uref_clock_set_cr_sys(uref, systime);
 
         upipe_netmap_source_output(upipe, uref, &upipe_netmap_source->upump);
@@ -270,6 +306,23 @@ static int upipe_netmap_source_get_uri(struct upipe *upipe, const char **uri_p)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This closes the netmap descriptor. If it is owned by the
+ * netmap ubuf manager, it is only closed when all buffers are released.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_netmap_source_close(struct upipe *upipe)
+{
+    struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
+
+    if (upipe_netmap_source->netmap_mgr != NULL)
+        ubuf_mgr_release(upipe_netmap_source->netmap_mgr);
+    else if (upipe_netmap_source->d != NULL)
+        nm_close(upipe_netmap_source->d);
+    upipe_netmap_source->netmap_mgr = NULL;
+    upipe_netmap_source->d = NULL;
+}
+
 /** @internal @This asks to open the given netmap source.
  *
  * @param upipe description structure of the pipe
@@ -280,9 +333,9 @@ static int upipe_netmap_source_set_uri(struct upipe *upipe, const char *uri)
 {
     struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
 
-    nm_close(upipe_netmap_source->d);
-    ubase_clean_str(&upipe_netmap_source->uri);
     upipe_netmap_source_set_upump(upipe, NULL);
+    upipe_netmap_source_close(upipe);
+    ubase_clean_str(&upipe_netmap_source->uri);
 
     if (unlikely(uri == NULL))
         return UBASE_ERR_NONE;
@@ -292,22 +345,31 @@ static int upipe_netmap_source_set_uri(struct upipe *upipe, const char *uri)
         return UBASE_ERR_EXTERNAL;
     }
 
-    upipe_netmap_source->d = nm_open(uri, NULL, 0, 0);
+    struct nmreq req;
+    memset(&req, 0, sizeof(req));
+    req.nr_arg3 = NETMAP_EXTRA_BUFS;
+    upipe_netmap_source->d = nm_open(uri, &req, 0, NULL);
     if (unlikely(!upipe_netmap_source->d)) {
         upipe_err_va(upipe, "can't open netmap socket %s", uri);
         return UBASE_ERR_EXTERNAL;
     }
 
+    upipe_netmap_source->netmap_mgr =
+        ubuf_block_netmap_mgr_alloc(UBUF_POOL_DEPTH, upipe_netmap_source->d);
+    if (unlikely(upipe_netmap_source->netmap_mgr == NULL))
+        upipe_warn_va(upipe, "no extra netmap buffers on %s, packets will be "
+                      "copied", uri);
+
     upipe_netmap_source->uri = strdup(uri);
     if (unlikely(upipe_netmap_source->uri == NULL)) {
-        nm_close(upipe_netmap_source->d);
-        upipe_netmap_source->d = NULL;
+        upipe_netmap_source_close(upipe);
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return UBASE_ERR_ALLOC;
     }
 
-    upipe_notice_va(upipe, "opening netmap socket %s ring %u",
-            upipe_netmap_source->uri, upipe_netmap_source->ring_idx);
+    upipe_notice_va(upipe, "opening netmap socket %s ring %u (%u extra buffers)",
+            upipe_netmap_source->uri, upipe_netmap_source->ring_idx,
+            upipe_netmap_source->d->req.nr_arg3);
     return UBASE_ERR_NONE;
 }
 
@@ -371,7 +433,8 @@ static void upipe_netmap_source_free(struct upipe *upipe)
 {
     struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
 
-    nm_close(upipe_netmap_source->d);
+    upipe_netmap_source_set_upump(upipe, NULL);
+    upipe_netmap_source_close(upipe);
 
     upipe_throw_dead(upipe);
 
@@ -1,3 +1,9 @@
+configs += pthread_setaffinity_np
+pthread_setaffinity_np-cppflags = -D_GNU_SOURCE -pthread
+pthread_setaffinity_np-ldflags = -pthread
+pthread_setaffinity_np-includes = pthread.h
+pthread_setaffinity_np-functions = pthread_setaffinity_np
+
 lib-targets = libupipe_pthread
 
 libupipe_pthread-desc = pthread modules
@@ -7,12 +13,14 @@ libupipe_pthread-includes = \
     umutex_pthread.h \
     upipe_pthread_transfer.h \
     uprobe_pthread_assert.h \
-    uprobe_pthread_upump_mgr.h
+    uprobe_pthread_upump_mgr.h \
+    upump_pthread_pool.h
 
 libupipe_pthread-src = \
     umutex_pthread.c \
     upipe_pthread_transfer.c \
     uprobe_pthread_assert.c \
-    uprobe_pthread_upump_mgr.c
+    uprobe_pthread_upump_mgr.c \
+    upump_pthread_pool.c
 
 libupipe_pthread-libs = libupipe libupipe_modules pthread
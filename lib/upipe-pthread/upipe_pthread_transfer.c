@@ -9,10 +9,17 @@
 /** @file
  * @short Upipe module allowing to transfer other pipes to a new POSIX thread
  * This is particularly helpful for multithreaded applications.
+ *
+ * The thread may be placed on a set of CPUs and on a NUMA node. In the latter
+ * case the preferred memory policy of the thread is set to the node, so that
+ * the buffers first touched by the pipes of the thread, including those of the
+ * umem managers, are allocated from node-local memory.
  */
 
 #define _GNU_SOURCE
 
+#include "config.h"
+
 #include "upipe/ubase.h"
 #include "upipe/ueventfd.h"
 #include "upipe/umutex.h"
@@ -23,13 +30,23 @@
 #include "upipe-pthread/uprobe_pthread_upump_mgr.h"
 
 #include <sys/resource.h>
+#ifdef HAVE_MEMPOLICY
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
 
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <signal.h>
 #include <limits.h>
+#include <sched.h>
+
+/** maximum number of NUMA nodes */
+#define UPIPE_PTHREAD_MAX_NODES 1024
 
 /** @internal @This is the private context for pthread. */
 struct upipe_pthread_ctx {
@@ -53,8 +70,173 @@ struct upipe_pthread_ctx {
     char *name;
     /** thread priority value */
     int priority;
+    /** list of CPUs the thread runs on, or NULL */
+    char *cpus;
+    /** NUMA node of the thread, or -1 */
+    int numa_node;
+    /** SCHED_FIFO priority of the thread, or 0 */
+    int fifo_priority;
 };
 
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+/** @internal @This parses a list of CPUs in the format used by Linux, for
+ * instance "0-3,8".
+ *
+ * @param cpus list of CPUs, optionally terminated by a newline
+ * @param cpuset filled in with the CPUs
+ * @return false if the list is invalid or empty
+ */
+static bool upipe_pthread_parse_cpus(const char *cpus, cpu_set_t *cpuset)
+{
+    CPU_ZERO(cpuset);
+    while (*cpus != '\0' && *cpus != '\n') {
+        char *end;
+        unsigned long first = strtoul(cpus, &end, 10);
+        if (end == cpus)
+            return false;
+        unsigned long last = first;
+        if (*end == '-') {
+            cpus = end + 1;
+            last = strtoul(cpus, &end, 10);
+            if (end == cpus || last < first)
+                return false;
+        }
+        if (last >= CPU_SETSIZE)
+            return false;
+        for (unsigned long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, cpuset);
+
+        cpus = end;
+        if (*cpus == ',')
+            cpus++;
+        else if (*cpus != '\0' && *cpus != '\n')
+            return false;
+    }
+    return CPU_COUNT(cpuset) > 0;
+}
+
+/** @internal @This prints a set of CPUs in the format used by Linux.
+ *
+ * @param cpuset set of CPUs
+ * @param buffer filled in with the list
+ * @param size size of the buffer
+ */
+static void upipe_pthread_print_cpus(const cpu_set_t *cpuset,
+                                     char *buffer, size_t size)
+{
+    size_t len = 0;
+    buffer[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && len < size; cpu++) {
+        if (!CPU_ISSET(cpu, cpuset))
+            continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpuset))
+            last++;
+        int ret = last == cpu ?
+            snprintf(buffer + len, size - len, "%s%d", len ? "," : "", cpu) :
+            snprintf(buffer + len, size - len, "%s%d-%d", len ? "," : "",
+                     cpu, last);
+        if (ret < 0)
+            break;
+        len += ret;
+        cpu = last;
+    }
+}
+#endif
+
+/** @internal @This places the current thread on its CPUs and NUMA node, sets
+ * its scheduling policy, and reports the placement.
+ *
+ * @param pthread_ctx pointer to the private context
+ */
+static void upipe_pthread_place(struct upipe_pthread_ctx *pthread_ctx)
+{
+    struct uprobe *uprobe = pthread_ctx->uprobe_pthread_upump_mgr;
+    char cpus[256] = "any";
+
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    cpu_set_t cpuset;
+    bool pin = false;
+    if (pthread_ctx->cpus != NULL) {
+        pin = upipe_pthread_parse_cpus(pthread_ctx->cpus, &cpuset);
+        if (unlikely(!pin))
+            uprobe_warn_va(uprobe, NULL, "invalid list of CPUs %s",
+                           pthread_ctx->cpus);
+    } else if (pthread_ctx->numa_node >= 0) {
+        /* run on the CPUs of the node */
+        char path[64], list[1024];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+                 pthread_ctx->numa_node);
+        FILE *file = fopen(path, "r");
+        if (file != NULL) {
+            pin = fgets(list, sizeof(list), file) != NULL &&
+                  upipe_pthread_parse_cpus(list, &cpuset);
+            fclose(file);
+        }
+        if (unlikely(!pin))
+            uprobe_warn_va(uprobe, NULL, "unable to read the CPUs of node %d",
+                           pthread_ctx->numa_node);
+    }
+
+    if (pin) {
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset),
+                                         &cpuset);
+        if (unlikely(err))
+            uprobe_warn_va(uprobe, NULL, "unable to set CPU affinity (%s)",
+                           strerror(err));
+    }
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
+        upipe_pthread_print_cpus(&cpuset, cpus, sizeof(cpus));
+#else
+    if (pthread_ctx->cpus != NULL || pthread_ctx->numa_node >= 0)
+        uprobe_warn(uprobe, NULL, "CPU affinity is not supported");
+#endif
+
+    if (pthread_ctx->numa_node >= 0) {
+#ifdef HAVE_MEMPOLICY
+        unsigned long nodemask[UPIPE_PTHREAD_MAX_NODES /
+                               (8 * sizeof(unsigned long))];
+        memset(nodemask, 0, sizeof(nodemask));
+        if (unlikely(pthread_ctx->numa_node >= UPIPE_PTHREAD_MAX_NODES))
+            uprobe_warn_va(uprobe, NULL, "invalid NUMA node %d",
+                           pthread_ctx->numa_node);
+        else {
+            nodemask[pthread_ctx->numa_node / (8 * sizeof(unsigned long))] |=
+                1UL << (pthread_ctx->numa_node % (8 * sizeof(unsigned long)));
+            if (unlikely(syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodemask,
+                                 UPIPE_PTHREAD_MAX_NODES + 1) < 0))
+                uprobe_warn_va(uprobe, NULL,
+                               "unable to set the memory policy (%m)");
+        }
+#else
+        uprobe_warn(uprobe, NULL, "NUMA placement is not supported");
+#endif
+    }
+
+    if (pthread_ctx->fifo_priority > 0) {
+        struct sched_param param;
+        param.sched_priority = pthread_ctx->fifo_priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (unlikely(err))
+            uprobe_warn_va(uprobe, NULL,
+                           "unable to set SCHED_FIFO priority %d (%s)",
+                           pthread_ctx->fifo_priority, strerror(err));
+    }
+
+    int policy;
+    struct sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+        policy = SCHED_OTHER;
+    char node[16] = "any";
+    if (pthread_ctx->numa_node >= 0)
+        snprintf(node, sizeof(node), "%d", pthread_ctx->numa_node);
+    uprobe_notice_va(uprobe, NULL,
+                     "thread %s placed on CPUs %s, memory node %s, %s",
+                     pthread_ctx->name != NULL ? pthread_ctx->name : "xfer",
+                     cpus, node,
+                     policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_OTHER");
+}
+
 /** @internal @This is the main function of the new thread.
  *
  * @param mgr pointer to a upipe pthread manager
@@ -86,6 +268,10 @@ static void *upipe_pthread_start(void *_pthread_ctx)
     if (pthread_ctx->priority != INT_MAX)
         setpriority(PRIO_PROCESS, 0, pthread_ctx->priority);
 
+    if (pthread_ctx->cpus != NULL || pthread_ctx->numa_node >= 0 ||
+        pthread_ctx->fifo_priority > 0)
+        upipe_pthread_place(pthread_ctx);
+
     /* spawn the upump manager */
     struct upump_mgr *upump_mgr =
         pthread_ctx->upump_mgr_alloc(pthread_ctx->upump_pool_depth,
@@ -144,6 +330,7 @@ static void upipe_pthread_stop(struct upump *upump)
     ueventfd_clean(&pthread_ctx->event);
     umutex_release(pthread_ctx->mutex);
     free(pthread_ctx->name);
+    free(pthread_ctx->cpus);
     free(pthread_ctx);
 }
 
@@ -161,17 +348,22 @@ static void upipe_pthread_stop(struct upump *upump)
  * @param mutex mutual exclusion pimitives to access the event loop, or NULL
  * @param pthread_id_p reference to created thread ID (may be NULL)
  * @param attr pthread attributes
- * @param name custom name or NULL
  * @param priority priority of the thread or INT_MAX to leave it unchanged
+ * @param name custom name or NULL
+ * @param cpus list of CPUs the thread runs on, such as "0-3,8", or NULL
+ * @param numa_node NUMA node of the thread, or -1
+ * @param fifo_priority SCHED_FIFO priority of the thread, or 0 to leave the
+ * scheduling policy unchanged
  * @return pointer to xfer manager
  */
-struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_prio_named(
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_placed(
     uint8_t queue_length, uint16_t msg_pool_depth,
     struct uprobe *uprobe_pthread_upump_mgr,
     upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
     uint16_t upump_blocker_pool_depth, struct umutex *mutex,
     pthread_t *pthread_id_p, const pthread_attr_t *restrict attr,
-    int priority, const char *name)
+    int priority, const char *name, const char *cpus, int numa_node,
+    int fifo_priority)
 {
     struct upipe_pthread_ctx *pthread_ctx =
         malloc(sizeof(struct upipe_pthread_ctx));
@@ -207,6 +399,9 @@ struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_prio_named(
     pthread_ctx->mutex = umutex_use(mutex);
     pthread_ctx->name = name ? strdup(name) : NULL;
     pthread_ctx->priority = priority;
+    pthread_ctx->cpus = cpus ? strdup(cpus) : NULL;
+    pthread_ctx->numa_node = numa_node;
+    pthread_ctx->fifo_priority = fifo_priority;
 
     if (unlikely(pthread_create(&pthread_ctx->pthread_id, attr,
                                 upipe_pthread_start, pthread_ctx) != 0))
@@ -218,6 +413,8 @@ struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_prio_named(
     return xfer_mgr;
 
 upipe_pthread_xfer_mgr_alloc_err5:
+    free(pthread_ctx->name);
+    free(pthread_ctx->cpus);
     umutex_release(mutex);
     upipe_mgr_release(pthread_ctx->xfer_mgr);
     upipe_mgr_release(xfer_mgr);
@@ -232,6 +429,28 @@ upipe_pthread_xfer_mgr_alloc_err1:
     return NULL;
 }
 
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_prio_named(
+    uint8_t queue_length, uint16_t msg_pool_depth,
+    struct uprobe *uprobe_pthread_upump_mgr,
+    upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+    uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+    pthread_t *pthread_id_p, const pthread_attr_t *restrict attr,
+    int priority, const char *name)
+{
+    return upipe_pthread_xfer_mgr_alloc_placed(queue_length,
+                                               msg_pool_depth,
+                                               uprobe_pthread_upump_mgr,
+                                               upump_mgr_alloc,
+                                               upump_pool_depth,
+                                               upump_blocker_pool_depth,
+                                               mutex,
+                                               pthread_id_p,
+                                               attr,
+                                               priority,
+                                               name,
+                                               NULL, -1, 0);
+}
+
 struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named(uint8_t queue_length,
         uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
         upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
@@ -290,3 +509,24 @@ struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_prio(
                                                    priority,
                                                    NULL);
 }
+
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_pool(uint8_t queue_length,
+        uint16_t msg_pool_depth, struct upump_pthread_pool *pool,
+        uint16_t upump_pool_depth, uint16_t upump_blocker_pool_depth)
+{
+    struct upump_mgr *upump_mgr =
+        upump_pthread_pool_mgr_alloc(pool, upump_pool_depth,
+                                     upump_blocker_pool_depth);
+    if (unlikely(upump_mgr == NULL))
+        return NULL;
+
+    struct upipe_mgr *xfer_mgr = upipe_xfer_mgr_alloc(queue_length,
+                                                      msg_pool_depth, NULL);
+    if (likely(xfer_mgr != NULL) &&
+        unlikely(!ubase_check(upipe_xfer_mgr_attach(xfer_mgr, upump_mgr)))) {
+        upipe_mgr_release(xfer_mgr);
+        xfer_mgr = NULL;
+    }
+    upump_mgr_release(upump_mgr);
+    return xfer_mgr;
+}
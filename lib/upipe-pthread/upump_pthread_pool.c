@@ -0,0 +1,1097 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short pool of POSIX threads running many independent pipelines
+ *
+ * Each pump of a lane is a proxy of a pump of the event loop of the worker
+ * owning the lane (its home). The real pump is only ever touched by the home
+ * thread: the other threads record the requested state of the proxy and mark
+ * it dirty, and the home thread applies it. When the real pump triggers, it
+ * is stopped until the callback has run, so that level-triggered events do
+ * not fire again in the meantime, and the lane is queued on its home. Lanes
+ * are run in batches from the eventfd of the workers, and idle workers are
+ * woken up to steal them when a worker has a backlog.
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/ulist.h"
+#include "upipe/urefcount.h"
+#include "upipe/ueventfd.h"
+#include "upipe/uprobe.h"
+#include "upipe/upump.h"
+#include "upipe/upump_common.h"
+#include "upipe-pthread/upump_pthread_pool.h"
+#include "upipe-pthread/uprobe_pthread_upump_mgr.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <signal.h>
+#include <pthread.h>
+
+/** maximum number of lanes run by a worker before polling again */
+#define UPUMP_PTHREAD_POOL_BATCH 16
+
+/** @hidden */
+struct upump_pthread_pool;
+
+/** @This is a worker thread of the pool. */
+struct upump_pthread_worker {
+    /** pointer to the pool */
+    struct upump_pthread_pool *pool;
+    /** index of the worker in the pool */
+    unsigned int index;
+    /** thread ID */
+    pthread_t pthread_id;
+    /** mutex protecting the queues, and the lanes and proxies of the worker */
+    pthread_mutex_t mutex;
+
+    /** upump manager of the event loop of the worker */
+    struct upump_mgr *upump_mgr;
+    /** eventfd waking up the worker */
+    struct ueventfd event;
+    /** pump watching the eventfd */
+    struct upump *upump;
+
+    /** queue of lanes to run */
+    struct uchain runq;
+    /** number of lanes in the queue */
+    unsigned int runq_length;
+    /** list of proxies whose real pump must be updated */
+    struct uchain dirty;
+    /** number of lanes of the worker */
+    unsigned int nb_lanes;
+    /** true if the worker has nothing to run (atomic) */
+    bool idle;
+};
+
+/** @This is the private structure of a pool. */
+struct upump_pthread_pool {
+    /** refcount management structure */
+    struct urefcount urefcount;
+    /** pointer to uprobe_pthread_upump_mgr probe */
+    struct uprobe *uprobe;
+    /** function allocating the event loops */
+    upump_mgr_alloc upump_mgr_alloc;
+    /** true if the workers must exit (atomic) */
+    bool quit;
+    /** number of workers which exited (atomic) */
+    unsigned int exited;
+    /** eventfd signaling the exit of workers */
+    struct ueventfd event;
+    /** pump watching the eventfd in the allocating thread */
+    struct upump *upump;
+
+    /** number of workers */
+    unsigned int nb_workers;
+    /** workers */
+    struct upump_pthread_worker workers[];
+};
+
+UBASE_FROM_TO(upump_pthread_pool, urefcount, urefcount, urefcount)
+
+/** @This represents the scheduling state of a lane. */
+enum upump_pthread_lane_state {
+    /** no pending event */
+    UPUMP_PTHREAD_LANE_IDLE,
+    /** queued on its home worker */
+    UPUMP_PTHREAD_LANE_QUEUED,
+    /** callbacks running on a worker */
+    UPUMP_PTHREAD_LANE_RUNNING
+};
+
+/** @This is the private structure of a lane. */
+struct upump_pthread_lane {
+    /** refcount management structure */
+    struct urefcount urefcount;
+    /** pointer to the pool */
+    struct upump_pthread_pool *pool;
+    /** worker watching the events of the lane */
+    struct upump_pthread_worker *home;
+
+    /** structure for the queue of the home worker */
+    struct uchain uchain;
+    /** scheduling state, protected by the mutex of the home worker */
+    enum upump_pthread_lane_state state;
+    /** list of triggered proxies, protected by the mutex of the home
+     * worker */
+    struct uchain pending;
+    /** number of triggered proxies */
+    unsigned int nb_pending;
+    /** proxy whose callback is running */
+    struct upump_pthread_proxy *current;
+
+    /** common structure */
+    struct upump_common_mgr common_mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(upump_pthread_lane, upump_mgr, upump_mgr, common_mgr.mgr)
+UBASE_FROM_TO(upump_pthread_lane, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(upump_pthread_lane, uchain, uchain, uchain)
+
+/** @This is the private structure of a pump of a lane. */
+struct upump_pthread_proxy {
+    /** type of event to watch */
+    int event;
+    /** parameters of the event */
+    union {
+        /** timer */
+        struct {
+            /** delay before the first event */
+            uint64_t after;
+            /** interval between events */
+            uint64_t repeat;
+        } timer;
+        /** file descriptor */
+        int fd;
+        /** signal */
+        int signal;
+    };
+
+    /** requested state, protected by the mutex of the home worker: */
+    /** true if the pump is started and not blocked */
+    bool armed;
+    /** blocking status */
+    bool status;
+    /** true if the real pump must be started */
+    bool start;
+    /** true if the real pump must be restarted */
+    bool restart;
+    /** true if the real pump may be started again after an event */
+    bool rearm;
+    /** true if the pump was freed */
+    bool dead;
+    /** true if the proxy is in the dirty list of the home worker */
+    bool dirty;
+    /** true if the proxy is in the pending list of the lane */
+    bool pending;
+    /** structure for the dirty list of the home worker */
+    struct uchain uchain_dirty;
+    /** structure for the pending list of the lane */
+    struct uchain uchain_pending;
+
+    /** state of the home worker: */
+    /** real pump, or NULL */
+    struct upump *upump;
+    /** true if the real pump is started */
+    bool started;
+    /** blocking status of the real pump */
+    bool real_status;
+    /** true if the real pump was stopped by an event */
+    bool parked;
+
+    /** common structure */
+    struct upump_common common;
+};
+
+UBASE_FROM_TO(upump_pthread_proxy, upump, upump, common.upump)
+UBASE_FROM_TO(upump_pthread_proxy, uchain, uchain_dirty, uchain_dirty)
+UBASE_FROM_TO(upump_pthread_proxy, uchain, uchain_pending, uchain_pending)
+
+/** worker running in the current thread, or NULL */
+static __thread struct upump_pthread_worker *upump_pthread_pool_self = NULL;
+
+/** @internal @This returns the lane of a proxy.
+ *
+ * @param proxy pointer to proxy
+ * @return pointer to lane
+ */
+static inline struct upump_pthread_lane *
+    upump_pthread_proxy_lane(struct upump_pthread_proxy *proxy)
+{
+    return upump_pthread_lane_from_upump_mgr(
+            upump_pthread_proxy_to_upump(proxy)->mgr);
+}
+
+/** @internal @This wakes up a worker.
+ *
+ * @param worker pointer to worker
+ */
+static inline void upump_pthread_worker_wake(
+        struct upump_pthread_worker *worker)
+{
+    ueventfd_write(&worker->event);
+}
+
+/** @internal @This wakes up an idle worker, so that it steals queued lanes.
+ *
+ * @param worker pointer to the busy worker
+ */
+static void upump_pthread_worker_wake_idle(struct upump_pthread_worker *worker)
+{
+    struct upump_pthread_pool *pool = worker->pool;
+    for (unsigned int i = 1; i < pool->nb_workers; i++) {
+        struct upump_pthread_worker *thief =
+            &pool->workers[(worker->index + i) % pool->nb_workers];
+        bool idle = true;
+        if (__atomic_compare_exchange_n(&thief->idle, &idle, false, false,
+                                        __ATOMIC_ACQ_REL,
+                                        __ATOMIC_RELAXED)) {
+            upump_pthread_worker_wake(thief);
+            return;
+        }
+    }
+}
+
+/** @internal @This is called when a real pump triggers, in the home thread.
+ *
+ * @param upump description structure of the real pump
+ */
+static void upump_pthread_proxy_trigger(struct upump *upump)
+{
+    struct upump_pthread_proxy *proxy =
+        upump_get_opaque(upump, struct upump_pthread_proxy *);
+    struct upump_pthread_lane *lane = upump_pthread_proxy_lane(proxy);
+    struct upump_pthread_worker *home = lane->home;
+
+    pthread_mutex_lock(&home->mutex);
+    if (unlikely(proxy->dead)) {
+        pthread_mutex_unlock(&home->mutex);
+        return;
+    }
+
+    if (proxy->event != UPUMP_TYPE_TIMER || !proxy->timer.repeat) {
+        /* stop level-triggered events until the callback has run */
+        upump_stop(upump);
+        proxy->started = false;
+        proxy->parked = proxy->event != UPUMP_TYPE_TIMER;
+    }
+
+    if (!proxy->pending) {
+        proxy->pending = true;
+        ulist_add(&lane->pending,
+                  upump_pthread_proxy_to_uchain_pending(proxy));
+        lane->nb_pending++;
+    }
+
+    bool wake = false, backlog = false;
+    if (lane->state == UPUMP_PTHREAD_LANE_IDLE) {
+        lane->state = UPUMP_PTHREAD_LANE_QUEUED;
+        upump_mgr_use(upump_pthread_lane_to_upump_mgr(lane));
+        ulist_add(&home->runq, upump_pthread_lane_to_uchain(lane));
+        wake = !home->runq_length++;
+        backlog = home->runq_length > 1;
+    }
+    pthread_mutex_unlock(&home->mutex);
+
+    if (wake)
+        upump_pthread_worker_wake(home);
+    if (backlog)
+        upump_pthread_worker_wake_idle(home);
+}
+
+/** @internal @This applies the requested state of a proxy to its real pump,
+ * in the home thread. It is called with the mutex of the home worker held.
+ *
+ * @param proxy pointer to proxy
+ * @return true if the proxy must now be released
+ */
+static bool upump_pthread_proxy_apply(struct upump_pthread_proxy *proxy)
+{
+    struct upump_pthread_lane *lane = upump_pthread_proxy_lane(proxy);
+    struct upump_pthread_worker *home = lane->home;
+
+    if (proxy->dead) {
+        if (proxy->upump != NULL) {
+            upump_stop(proxy->upump);
+            upump_free(proxy->upump);
+            proxy->upump = NULL;
+        }
+        return true;
+    }
+
+    bool start = proxy->start, restart = proxy->restart;
+    bool rearm = proxy->rearm && proxy->parked;
+    proxy->start = proxy->restart = proxy->rearm = false;
+
+    if (!proxy->armed) {
+        if (proxy->started)
+            upump_stop(proxy->upump);
+        proxy->started = false;
+        proxy->parked = false;
+        return false;
+    }
+
+    if (proxy->upump == NULL) {
+        if (!start && !restart)
+            return false;
+        switch (proxy->event) {
+            case UPUMP_TYPE_IDLER:
+                proxy->upump = upump_alloc_idler(home->upump_mgr,
+                        upump_pthread_proxy_trigger, proxy, NULL);
+                break;
+            case UPUMP_TYPE_TIMER:
+                proxy->upump = upump_alloc_timer(home->upump_mgr,
+                        upump_pthread_proxy_trigger, proxy, NULL,
+                        proxy->timer.after, proxy->timer.repeat);
+                break;
+            case UPUMP_TYPE_FD_READ:
+                proxy->upump = upump_alloc_fd_read(home->upump_mgr,
+                        upump_pthread_proxy_trigger, proxy, NULL, proxy->fd);
+                break;
+            case UPUMP_TYPE_FD_WRITE:
+                proxy->upump = upump_alloc_fd_write(home->upump_mgr,
+                        upump_pthread_proxy_trigger, proxy, NULL, proxy->fd);
+                break;
+            case UPUMP_TYPE_SIGNAL:
+                proxy->upump = upump_alloc_signal(home->upump_mgr,
+                        upump_pthread_proxy_trigger, proxy, NULL,
+                        proxy->signal);
+                break;
+            default:
+                break;
+        }
+        if (unlikely(proxy->upump == NULL)) {
+            uprobe_err(home->pool->uprobe, NULL, "unable to allocate pump");
+            return false;
+        }
+        proxy->real_status = true;
+    }
+
+    if (proxy->real_status != proxy->status) {
+        upump_set_status(proxy->upump, proxy->status);
+        proxy->real_status = proxy->status;
+    }
+
+    if (restart && proxy->event == UPUMP_TYPE_TIMER) {
+        upump_restart(proxy->upump);
+        proxy->started = true;
+    } else if (restart)
+        start = true;
+    if ((start && !proxy->started) || rearm) {
+        upump_start(proxy->upump);
+        proxy->started = true;
+        proxy->parked = false;
+    }
+    return false;
+}
+
+/** @internal @This releases a proxy after its real pump was freed, and the
+ * reference it holds on its lane.
+ *
+ * @param proxy pointer to proxy
+ */
+static void upump_pthread_proxy_release(struct upump_pthread_proxy *proxy)
+{
+    struct upump_pthread_lane *lane = upump_pthread_proxy_lane(proxy);
+    struct upump_mgr *mgr = upump_pthread_lane_to_upump_mgr(lane);
+    upool_free(&lane->common_mgr.upump_pool, proxy);
+    upump_mgr_release(mgr);
+}
+
+/** @internal @This commits the requested state of a proxy. It is called with
+ * the mutex of the home worker held, and releases it.
+ *
+ * @param proxy pointer to proxy
+ */
+static void upump_pthread_proxy_commit(struct upump_pthread_proxy *proxy)
+{
+    struct upump_pthread_worker *home = upump_pthread_proxy_lane(proxy)->home;
+    bool release = false, wake = false;
+
+    if (upump_pthread_pool_self == home)
+        release = upump_pthread_proxy_apply(proxy);
+    else if (!proxy->dirty) {
+        proxy->dirty = true;
+        wake = ulist_empty(&home->dirty);
+        ulist_add(&home->dirty, upump_pthread_proxy_to_uchain_dirty(proxy));
+    }
+    pthread_mutex_unlock(&home->mutex);
+
+    if (wake)
+        upump_pthread_worker_wake(home);
+    if (release)
+        upump_pthread_proxy_release(proxy);
+}
+
+/** @internal @This applies the requested state of the dirty proxies of a
+ * worker, in its thread.
+ *
+ * @param worker pointer to worker
+ */
+static void upump_pthread_worker_apply(struct upump_pthread_worker *worker)
+{
+    struct uchain release;
+    ulist_init(&release);
+
+    pthread_mutex_lock(&worker->mutex);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&worker->dirty)) != NULL) {
+        struct upump_pthread_proxy *proxy =
+            upump_pthread_proxy_from_uchain_dirty(uchain);
+        proxy->dirty = false;
+        if (upump_pthread_proxy_apply(proxy))
+            ulist_add(&release, uchain);
+    }
+    pthread_mutex_unlock(&worker->mutex);
+
+    while ((uchain = ulist_pop(&release)) != NULL)
+        upump_pthread_proxy_release(
+                upump_pthread_proxy_from_uchain_dirty(uchain));
+}
+
+/** @internal @This runs the triggered callbacks of a lane.
+ *
+ * @param worker pointer to the current worker
+ * @param lane pointer to lane, in running state
+ */
+static void upump_pthread_lane_run(struct upump_pthread_worker *worker,
+                                   struct upump_pthread_lane *lane)
+{
+    struct upump_pthread_worker *home = lane->home;
+    struct upump_mgr *mgr = upump_pthread_lane_to_upump_mgr(lane);
+
+    if (home == worker)
+        upump_pthread_worker_apply(worker);
+    if (worker->pool->uprobe != NULL)
+        uprobe_pthread_upump_mgr_set(worker->pool->uprobe, mgr);
+
+    pthread_mutex_lock(&home->mutex);
+    unsigned int count = lane->nb_pending;
+    pthread_mutex_unlock(&home->mutex);
+
+    while (count--) {
+        pthread_mutex_lock(&home->mutex);
+        struct uchain *uchain = ulist_pop(&lane->pending);
+        struct upump_pthread_proxy *proxy = NULL;
+        if (uchain != NULL) {
+            proxy = upump_pthread_proxy_from_uchain_pending(uchain);
+            proxy->pending = false;
+            lane->nb_pending--;
+        }
+        pthread_mutex_unlock(&home->mutex);
+        if (proxy == NULL)
+            break;
+
+        /* the pump may have been stopped or blocked in the meantime */
+        if (!proxy->common.started || !ulist_empty(&proxy->common.blockers))
+            continue;
+
+        lane->current = proxy;
+        upump_common_dispatch(upump_pthread_proxy_to_upump(proxy));
+        if (lane->current == proxy && proxy->event != UPUMP_TYPE_TIMER) {
+            pthread_mutex_lock(&home->mutex);
+            proxy->rearm = true;
+            upump_pthread_proxy_commit(proxy);
+        }
+        lane->current = NULL;
+    }
+
+    if (worker->pool->uprobe != NULL)
+        uprobe_pthread_upump_mgr_set(worker->pool->uprobe, NULL);
+
+    pthread_mutex_lock(&home->mutex);
+    bool wake = false;
+    if (lane->nb_pending) {
+        lane->state = UPUMP_PTHREAD_LANE_QUEUED;
+        upump_mgr_use(mgr);
+        ulist_add(&home->runq, upump_pthread_lane_to_uchain(lane));
+        wake = !home->runq_length++;
+    } else
+        lane->state = UPUMP_PTHREAD_LANE_IDLE;
+    pthread_mutex_unlock(&home->mutex);
+
+    if (wake)
+        upump_pthread_worker_wake(home);
+    upump_mgr_release(mgr);
+}
+
+/** @internal @This takes the first queued lane of a worker.
+ *
+ * @param worker pointer to worker
+ * @return pointer to lane, in running state, or NULL
+ */
+static struct upump_pthread_lane *
+    upump_pthread_worker_pop(struct upump_pthread_worker *worker)
+{
+    pthread_mutex_lock(&worker->mutex);
+    struct uchain *uchain = ulist_pop(&worker->runq);
+    struct upump_pthread_lane *lane = NULL;
+    if (uchain != NULL) {
+        lane = upump_pthread_lane_from_uchain(uchain);
+        lane->state = UPUMP_PTHREAD_LANE_RUNNING;
+        worker->runq_length--;
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return lane;
+}
+
+/** @internal @This steals a queued lane from another worker.
+ *
+ * @param worker pointer to the current worker
+ * @return pointer to lane, in running state, or NULL
+ */
+static struct upump_pthread_lane *
+    upump_pthread_worker_steal(struct upump_pthread_worker *worker)
+{
+    struct upump_pthread_pool *pool = worker->pool;
+    for (unsigned int i = 1; i < pool->nb_workers; i++) {
+        struct upump_pthread_worker *victim =
+            &pool->workers[(worker->index + i) % pool->nb_workers];
+        struct upump_pthread_lane *lane = upump_pthread_worker_pop(victim);
+        if (lane != NULL)
+            return lane;
+    }
+    return NULL;
+}
+
+/** @internal @This is called when a worker is woken up.
+ *
+ * @param upump description structure of the pump watching the eventfd
+ */
+static void upump_pthread_worker_work(struct upump *upump)
+{
+    struct upump_pthread_worker *worker =
+        upump_get_opaque(upump, struct upump_pthread_worker *);
+    ueventfd_read(&worker->event);
+
+    /* pending stops must be applied for the event loop to return */
+    upump_pthread_worker_apply(worker);
+    if (unlikely(__atomic_load_n(&worker->pool->quit, __ATOMIC_ACQUIRE))) {
+        upump_stop(upump);
+        return;
+    }
+
+    __atomic_store_n(&worker->idle, false, __ATOMIC_RELAXED);
+
+    unsigned int i;
+    for (i = 0; i < UPUMP_PTHREAD_POOL_BATCH; i++) {
+        struct upump_pthread_lane *lane = upump_pthread_worker_pop(worker);
+        if (lane == NULL)
+            lane = upump_pthread_worker_steal(worker);
+        if (lane == NULL)
+            break;
+        upump_pthread_lane_run(worker, lane);
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+    bool more = worker->runq_length > 0;
+    pthread_mutex_unlock(&worker->mutex);
+    if (more)
+        /* poll the event loop before running the remaining lanes */
+        upump_pthread_worker_wake(worker);
+    else if (i < UPUMP_PTHREAD_POOL_BATCH)
+        __atomic_store_n(&worker->idle, true, __ATOMIC_RELEASE);
+}
+
+/** @internal @This is the main function of a worker thread.
+ *
+ * @param _worker pointer to worker
+ */
+static void *upump_pthread_worker_start(void *_worker)
+{
+    struct upump_pthread_worker *worker = _worker;
+    struct upump_pthread_pool *pool = worker->pool;
+
+    /* disable signals */
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGTERM);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+    upump_pthread_pool_self = worker;
+    int err = upump_mgr_run(worker->upump_mgr, NULL);
+    if (!ubase_check(err) && err != UBASE_ERR_BUSY)
+        uprobe_err_va(pool->uprobe, NULL,
+                      "upump manager couldn't run (%s)", ubase_err_str(err));
+    upump_pthread_pool_self = NULL;
+
+    upump_free(worker->upump);
+    upump_mgr_release(worker->upump_mgr);
+
+    __atomic_add_fetch(&pool->exited, 1, __ATOMIC_RELEASE);
+    ueventfd_write(&pool->event);
+    return NULL;
+}
+
+/** @internal @This is called in the allocating thread when workers exit.
+ *
+ * @param upump description structure of the pump watching the eventfd
+ */
+static void upump_pthread_pool_exit(struct upump *upump)
+{
+    struct upump_pthread_pool *pool =
+        upump_get_opaque(upump, struct upump_pthread_pool *);
+    ueventfd_read(&pool->event);
+    if (__atomic_load_n(&pool->exited, __ATOMIC_ACQUIRE) < pool->nb_workers)
+        return;
+
+    upump_stop(upump);
+    upump_free(upump);
+    for (unsigned int i = 0; i < pool->nb_workers; i++) {
+        struct upump_pthread_worker *worker = &pool->workers[i];
+        pthread_join(worker->pthread_id, NULL);
+        pthread_mutex_destroy(&worker->mutex);
+        ueventfd_clean(&worker->event);
+    }
+    ueventfd_clean(&pool->event);
+    uprobe_release(pool->uprobe);
+    free(pool);
+}
+
+/** @internal @This stops the workers when the pool is no longer used.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upump_pthread_pool_quit(struct urefcount *urefcount)
+{
+    struct upump_pthread_pool *pool =
+        upump_pthread_pool_from_urefcount(urefcount);
+    __atomic_store_n(&pool->quit, true, __ATOMIC_RELEASE);
+    for (unsigned int i = 0; i < pool->nb_workers; i++)
+        upump_pthread_worker_wake(&pool->workers[i]);
+}
+
+/** @This allocates a pool of worker threads. The threads are joined in the
+ * event loop of the calling thread once the pool and all its lanes have been
+ * released.
+ *
+ * @param nb_threads number of worker threads
+ * @param uprobe_pthread_upump_mgr pointer to a uprobe_pthread_upump_mgr probe,
+ * providing the upump manager of the calling thread, and that will be set
+ * with the lane whose callbacks are running in the worker threads
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool of
+ * each worker
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool of each worker
+ * @return pointer to pool, or NULL in case of error
+ */
+struct upump_pthread_pool *upump_pthread_pool_alloc(unsigned int nb_threads,
+        struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth)
+{
+    if (unlikely(!nb_threads))
+        goto upump_pthread_pool_alloc_err0;
+
+    struct upump_pthread_pool *pool =
+        malloc(sizeof(struct upump_pthread_pool) +
+               nb_threads * sizeof(struct upump_pthread_worker));
+    if (unlikely(pool == NULL))
+        goto upump_pthread_pool_alloc_err0;
+
+    pool->uprobe = uprobe_pthread_upump_mgr;
+    pool->upump_mgr_alloc = upump_mgr_alloc;
+    pool->quit = false;
+    pool->exited = 0;
+    pool->nb_workers = 0;
+    if (unlikely(!ueventfd_init(&pool->event, false)))
+        goto upump_pthread_pool_alloc_err1;
+
+    struct upump_mgr *upump_mgr = NULL;
+    uprobe_throw(uprobe_pthread_upump_mgr, NULL, UPROBE_NEED_UPUMP_MGR,
+                 &upump_mgr);
+    if (unlikely(upump_mgr == NULL))
+        goto upump_pthread_pool_alloc_err2;
+    pool->upump = ueventfd_upump_alloc(&pool->event, upump_mgr,
+                                       upump_pthread_pool_exit, pool, NULL);
+    upump_mgr_release(upump_mgr);
+    if (unlikely(pool->upump == NULL))
+        goto upump_pthread_pool_alloc_err2;
+
+    for ( ; pool->nb_workers < nb_threads; pool->nb_workers++) {
+        struct upump_pthread_worker *worker =
+            &pool->workers[pool->nb_workers];
+        worker->pool = pool;
+        worker->index = pool->nb_workers;
+        ulist_init(&worker->runq);
+        worker->runq_length = 0;
+        ulist_init(&worker->dirty);
+        worker->nb_lanes = 0;
+        worker->idle = true;
+
+        if (unlikely(!ueventfd_init(&worker->event, false)))
+            goto upump_pthread_pool_alloc_err3;
+        worker->upump_mgr = upump_mgr_alloc(upump_pool_depth,
+                                            upump_blocker_pool_depth);
+        if (unlikely(worker->upump_mgr == NULL)) {
+            ueventfd_clean(&worker->event);
+            goto upump_pthread_pool_alloc_err3;
+        }
+        worker->upump = ueventfd_upump_alloc(&worker->event,
+                                             worker->upump_mgr,
+                                             upump_pthread_worker_work,
+                                             worker, NULL);
+        if (unlikely(worker->upump == NULL)) {
+            upump_mgr_release(worker->upump_mgr);
+            ueventfd_clean(&worker->event);
+            goto upump_pthread_pool_alloc_err3;
+        }
+        upump_start(worker->upump);
+        pthread_mutex_init(&worker->mutex, NULL);
+
+        if (unlikely(pthread_create(&worker->pthread_id, NULL,
+                                    upump_pthread_worker_start,
+                                    worker) != 0)) {
+            pthread_mutex_destroy(&worker->mutex);
+            upump_free(worker->upump);
+            upump_mgr_release(worker->upump_mgr);
+            ueventfd_clean(&worker->event);
+            goto upump_pthread_pool_alloc_err3;
+        }
+    }
+
+    urefcount_init(upump_pthread_pool_to_urefcount(pool),
+                   upump_pthread_pool_quit);
+    upump_start(pool->upump);
+    return pool;
+
+upump_pthread_pool_alloc_err3:
+    uprobe_err(uprobe_pthread_upump_mgr, NULL, "unable to start workers");
+    /* the threads already started exit straight away */
+    __atomic_store_n(&pool->quit, true, __ATOMIC_RELEASE);
+    for (unsigned int i = 0; i < pool->nb_workers; i++) {
+        struct upump_pthread_worker *worker = &pool->workers[i];
+        upump_pthread_worker_wake(worker);
+        pthread_join(worker->pthread_id, NULL);
+        pthread_mutex_destroy(&worker->mutex);
+        ueventfd_clean(&worker->event);
+    }
+    upump_free(pool->upump);
+upump_pthread_pool_alloc_err2:
+    ueventfd_clean(&pool->event);
+upump_pthread_pool_alloc_err1:
+    free(pool);
+upump_pthread_pool_alloc_err0:
+    uprobe_release(uprobe_pthread_upump_mgr);
+    return NULL;
+}
+
+/** @This increments the reference count of a pool.
+ *
+ * @param pool pointer to pool
+ * @return same pointer to pool
+ */
+struct upump_pthread_pool *upump_pthread_pool_use(
+        struct upump_pthread_pool *pool)
+{
+    if (pool != NULL)
+        urefcount_use(upump_pthread_pool_to_urefcount(pool));
+    return pool;
+}
+
+/** @This decrements the reference count of a pool, and stops the worker
+ * threads once it is no longer used by any lane.
+ *
+ * @param pool pointer to pool
+ */
+void upump_pthread_pool_release(struct upump_pthread_pool *pool)
+{
+    if (pool != NULL)
+        urefcount_release(upump_pthread_pool_to_urefcount(pool));
+}
+
+/** @internal @This allocates a new proxy.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_pthread_lane structure
+ * @param event type of event to watch for
+ * @param args optional parameters depending on event type
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static struct upump *upump_pthread_proxy_alloc(struct upump_mgr *mgr,
+                                               int event, va_list args)
+{
+    struct upump_pthread_lane *lane = upump_pthread_lane_from_upump_mgr(mgr);
+
+    switch (event) {
+        case UPUMP_TYPE_IDLER:
+        case UPUMP_TYPE_TIMER:
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_FD_WRITE:
+        case UPUMP_TYPE_SIGNAL:
+            break;
+        default:
+            return NULL;
+    }
+
+    struct upump_pthread_proxy *proxy =
+        upool_alloc(&lane->common_mgr.upump_pool,
+                    struct upump_pthread_proxy *);
+    if (unlikely(proxy == NULL))
+        return NULL;
+    struct upump *upump = upump_pthread_proxy_to_upump(proxy);
+
+    proxy->event = event;
+    switch (event) {
+        case UPUMP_TYPE_TIMER:
+            proxy->timer.after = va_arg(args, uint64_t);
+            proxy->timer.repeat = va_arg(args, uint64_t);
+            break;
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_FD_WRITE:
+            proxy->fd = va_arg(args, int);
+            break;
+        case UPUMP_TYPE_SIGNAL:
+            proxy->signal = va_arg(args, int);
+            break;
+        default:
+            break;
+    }
+
+    proxy->armed = false;
+    proxy->status = true;
+    proxy->start = proxy->restart = proxy->rearm = false;
+    proxy->dead = proxy->dirty = proxy->pending = false;
+    uchain_init(&proxy->uchain_dirty);
+    uchain_init(&proxy->uchain_pending);
+    proxy->upump = NULL;
+    proxy->started = false;
+    proxy->real_status = true;
+    proxy->parked = false;
+
+    /* the lane must outlive the proxy until the home worker releases it */
+    upump_mgr_use(mgr);
+    upump_common_init(upump);
+    return upump;
+}
+
+/** @internal @This starts a proxy.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_pthread_proxy_real_start(struct upump *upump, bool status)
+{
+    struct upump_pthread_proxy *proxy = upump_pthread_proxy_from_upump(upump);
+    pthread_mutex_lock(&upump_pthread_proxy_lane(proxy)->home->mutex);
+    proxy->armed = true;
+    proxy->status = status;
+    proxy->start = true;
+    upump_pthread_proxy_commit(proxy);
+}
+
+/** @internal @This restarts a proxy.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_pthread_proxy_real_restart(struct upump *upump, bool status)
+{
+    struct upump_pthread_proxy *proxy = upump_pthread_proxy_from_upump(upump);
+    pthread_mutex_lock(&upump_pthread_proxy_lane(proxy)->home->mutex);
+    proxy->armed = true;
+    proxy->status = status;
+    proxy->restart = true;
+    upump_pthread_proxy_commit(proxy);
+}
+
+/** @internal @This stops a proxy.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_pthread_proxy_real_stop(struct upump *upump, bool status)
+{
+    struct upump_pthread_proxy *proxy = upump_pthread_proxy_from_upump(upump);
+    pthread_mutex_lock(&upump_pthread_proxy_lane(proxy)->home->mutex);
+    proxy->armed = false;
+    proxy->start = proxy->restart = false;
+    upump_pthread_proxy_commit(proxy);
+}
+
+/** @internal @This releases a proxy. Its real pump is freed by the home
+ * thread.
+ *
+ * @param upump description structure of the pump
+ */
+static void upump_pthread_proxy_free(struct upump *upump)
+{
+    struct upump_pthread_proxy *proxy = upump_pthread_proxy_from_upump(upump);
+    struct upump_pthread_lane *lane = upump_pthread_proxy_lane(proxy);
+    upump_stop(upump);
+    upump_common_clean(upump);
+    if (lane->current == proxy)
+        lane->current = NULL;
+
+    pthread_mutex_lock(&lane->home->mutex);
+    if (proxy->pending) {
+        ulist_delete(upump_pthread_proxy_to_uchain_pending(proxy));
+        proxy->pending = false;
+        lane->nb_pending--;
+    }
+    proxy->dead = true;
+    upump_pthread_proxy_commit(proxy);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upump_pthread_proxy or NULL in case of allocation error
+ */
+static void *upump_pthread_proxy_alloc_inner(struct upool *upool)
+{
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_pool(upool);
+    struct upump_pthread_proxy *proxy =
+        malloc(sizeof(struct upump_pthread_proxy));
+    if (unlikely(proxy == NULL))
+        return NULL;
+    struct upump *upump = upump_pthread_proxy_to_upump(proxy);
+    upump->mgr = upump_common_mgr_to_upump_mgr(common_mgr);
+    return proxy;
+}
+
+/** @internal @This frees a upump_pthread_proxy.
+ *
+ * @param upool pointer to upool
+ * @param proxy pointer to a upump_pthread_proxy structure to free
+ */
+static void upump_pthread_proxy_free_inner(struct upool *upool, void *proxy)
+{
+    free(proxy);
+}
+
+/** @internal @This processes control commands on a proxy.
+ *
+ * @param upump description structure of the pump
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_pthread_proxy_control(struct upump *upump,
+                                       int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_START:
+            upump_common_start(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_RESTART:
+            upump_common_restart(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_STOP:
+            upump_common_stop(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_FREE:
+            upump_pthread_proxy_free(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_GET_STATUS: {
+            int *status_p = va_arg(args, int *);
+            upump_common_get_status(upump, status_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_SET_STATUS: {
+            int status = va_arg(args, int);
+            upump_common_set_status(upump, status);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_ALLOC_BLOCKER: {
+            struct upump_blocker **p = va_arg(args, struct upump_blocker **);
+            *p = upump_common_blocker_alloc(upump);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_FREE_BLOCKER: {
+            struct upump_blocker *blocker =
+                va_arg(args, struct upump_blocker *);
+            upump_common_blocker_free(blocker);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a lane.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_pthread_lane_control(struct upump_mgr *mgr,
+                                      int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_MGR_VACUUM:
+            upump_common_mgr_vacuum(mgr);
+            return UBASE_ERR_NONE;
+        default:
+            /* lanes are run by the workers */
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This frees a lane.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upump_pthread_lane_free(struct urefcount *urefcount)
+{
+    struct upump_pthread_lane *lane =
+        upump_pthread_lane_from_urefcount(urefcount);
+    struct upump_pthread_pool *pool = lane->pool;
+
+    pthread_mutex_lock(&lane->home->mutex);
+    lane->home->nb_lanes--;
+    pthread_mutex_unlock(&lane->home->mutex);
+
+    upump_common_mgr_clean(upump_pthread_lane_to_upump_mgr(lane));
+    urefcount_clean(urefcount);
+    free(lane);
+    upump_pthread_pool_release(pool);
+}
+
+/** @This allocates a lane, which is a upump manager whose callbacks are run by
+ * the worker threads of the pool. The lane is assigned to the worker with the
+ * fewest lanes. It keeps a reference to the pool.
+ *
+ * @param pool pointer to pool
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL in case of error
+ */
+struct upump_mgr *upump_pthread_pool_mgr_alloc(struct upump_pthread_pool *pool,
+        uint16_t upump_pool_depth, uint16_t upump_blocker_pool_depth)
+{
+    struct upump_pthread_lane *lane =
+        malloc(sizeof(struct upump_pthread_lane) +
+               upump_common_mgr_sizeof(upump_pool_depth,
+                                       upump_blocker_pool_depth));
+    if (unlikely(lane == NULL))
+        return NULL;
+
+    struct upump_pthread_worker *home = &pool->workers[0];
+    for (unsigned int i = 1; i < pool->nb_workers; i++)
+        if (__atomic_load_n(&pool->workers[i].nb_lanes, __ATOMIC_RELAXED) <
+            __atomic_load_n(&home->nb_lanes, __ATOMIC_RELAXED))
+            home = &pool->workers[i];
+    pthread_mutex_lock(&home->mutex);
+    home->nb_lanes++;
+    pthread_mutex_unlock(&home->mutex);
+
+    lane->pool = upump_pthread_pool_use(pool);
+    lane->home = home;
+    uchain_init(&lane->uchain);
+    lane->state = UPUMP_PTHREAD_LANE_IDLE;
+    ulist_init(&lane->pending);
+    lane->nb_pending = 0;
+    lane->current = NULL;
+
+    struct upump_mgr *mgr = upump_pthread_lane_to_upump_mgr(lane);
+    mgr->signature = UPUMP_PTHREAD_POOL_SIGNATURE;
+    urefcount_init(upump_pthread_lane_to_urefcount(lane),
+                   upump_pthread_lane_free);
+    lane->common_mgr.mgr.refcount = upump_pthread_lane_to_urefcount(lane);
+    lane->common_mgr.mgr.upump_alloc = upump_pthread_proxy_alloc;
+    lane->common_mgr.mgr.upump_control = upump_pthread_proxy_control;
+    lane->common_mgr.mgr.upump_mgr_control = upump_pthread_lane_control;
+    upump_common_mgr_init(mgr, upump_pool_depth, upump_blocker_pool_depth,
+                          lane->upool_extra,
+                          upump_pthread_proxy_real_start,
+                          upump_pthread_proxy_real_stop,
+                          upump_pthread_proxy_real_restart,
+                          upump_pthread_proxy_alloc_inner,
+                          upump_pthread_proxy_free_inner);
+    return mgr;
+}
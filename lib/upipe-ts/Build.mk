@@ -5,6 +5,7 @@ libupipe_ts-so-version = 1.0.0
 
 libupipe_ts-includes = \
     upipe_rtp_fec.h \
+    upipe_rtp_fec_enc.h \
     upipe_ts.h \
     upipe_ts_ait_decoder.h \
     upipe_ts_ait_generator.h \
@@ -49,11 +50,17 @@ libupipe_ts-includes = \
 
 libupipe_ts-src = \
     upipe_rtp_fec.c \
+    upipe_rtp_fec_enc.c \
+    upipe_rtp_fec_xor.h \
     upipe_ts_ait_decoder.c \
     upipe_ts_ait_generator.c \
     upipe_ts_align.c \
     upipe_ts_cat_decoder.c \
     upipe_ts_check.c \
+    upipe_ts_crc.c \
+    upipe_ts_crc.h \
+    upipe_ts_crc_aarch64.c \
+    upipe_ts_crc_x86.c \
     upipe_ts_decaps.c \
     upipe_ts_demux.c \
     upipe_ts_eit_decoder.c \
@@ -9,7 +9,15 @@
 /** @file
  * @short Upipe RTP FEC module
 
-    The code does not handle one special case:
+    Media and FEC packets are stored in rings indexed by their (base)
+    sequence number, so that looking up the packets protected by a FEC packet
+    does not depend on the depth of the buffers. The rings are sized from the
+    FEC matrix, and grow if the packets they hold span more sequence numbers.
+
+    FEC packets which cannot be applied yet because more than one of their
+    packets are lost are held back. Every time a packet is recovered, the held
+    FEC packets of the other direction protecting it are tried again, until
+    no more packets can be recovered, e.g.:
     X - lost
     O - received
 
@@ -19,14 +27,14 @@
         OOOR
         CXC
 
-    This would require two passes of row FEC, adding significant complexity for an unlikely case.
+    The first column FEC recovers the first packet, which in turn allows the
+    first row FEC to recover the second packet.
  */
 
 #include "upipe/ubase.h"
 #include "upipe/uprobe.h"
 #include "upipe/uref_block.h"
 #include "upipe/upipe.h"
-#include "upipe/ulist.h"
 #include "upipe/uref_flow.h"
 #include "upipe/uref.h"
 #include "upipe/uref_clock.h"
@@ -34,12 +42,18 @@
 #include "upipe/upipe_helper_uclock.h"
 #include "upipe/upipe_helper_upipe.h"
 #include "upipe/upipe_helper_urefcount.h"
+#include "upipe/upipe_helper_urefcount_real.h"
 #include "upipe/upipe_helper_output.h"
 #include "upipe/upipe_helper_upump_mgr.h"
 #include "upipe/upipe_helper_upump.h"
 
 #include "upipe-ts/upipe_rtp_fec.h"
 
+#include "upipe_rtp_fec_xor.h"
+
+#include <stdlib.h>
+#include <string.h>
+
 #include <bitstream/ietf/rtp.h>
 #include <bitstream/mpeg/ts.h>
 #include <bitstream/smpte/2022_1_fec.h>
@@ -47,10 +61,35 @@
 #define UPIPE_FEC_JITTER UCLOCK_FREQ/25
 #define FEC_MAX 255
 #define DEFAULT_LATENCY_MAX (UCLOCK_FREQ*2)
+/** minimum size of the packet rings */
+#define FEC_RING_MIN_SIZE 64
+/** maximum size of the packet rings, covering the whole sequence number
+ * space */
+#define FEC_RING_MAX_SIZE (UINT16_MAX + 1)
+
+/** @internal @This is a ring of packets indexed by sequence number. All the
+ * packets of the ring are between head and tail, which are less than the
+ * size of the ring apart. */
+struct upipe_rtp_fec_ring {
+    /** packets, indexed by sequence number modulo the size */
+    struct uref **urefs;
+    /** size of the ring minus one, the size being a power of two */
+    uint32_t mask;
+    /** oldest sequence number in the ring, or UINT32_MAX if empty; the slot
+     * may have been emptied, see @ref upipe_rtp_fec_ring_head */
+    uint32_t head;
+    /** newest sequence number stored since the ring was last empty, or
+     * UINT32_MAX if empty */
+    uint32_t tail;
+    /** number of packets in the ring */
+    unsigned int count;
+};
 
 /** upipe_rtp_fec structure with rtp-fec parameters */
 struct upipe_rtp_fec {
-    /** refcount management structure */
+    /** real refcount management structure */
+    struct urefcount urefcount_real;
+    /** refcount management structure exported to the public structure */
     struct urefcount urefcount;
 
     /** uclock structure, if not NULL we are in live mode */
@@ -101,9 +140,16 @@ struct upipe_rtp_fec {
     /** row subpipe */
     struct upipe row_subpipe;
 
-    struct uchain main_queue;
-    struct uchain col_queue;
-    struct uchain row_queue;
+    /** media packets, indexed by sequence number */
+    struct upipe_rtp_fec_ring main_ring;
+    /** column FEC packets waiting to be applied, indexed by SNBase */
+    struct upipe_rtp_fec_ring col_ring;
+    /** row FEC packets waiting to be applied, indexed by SNBase */
+    struct upipe_rtp_fec_ring row_ring;
+    /** column FEC packets with too many losses, indexed by SNBase */
+    struct upipe_rtp_fec_ring col_held;
+    /** row FEC packets with too many losses, indexed by SNBase */
+    struct upipe_rtp_fec_ring row_held;
 
     /* number of packets not recovered */
     uint64_t lost;
@@ -111,6 +157,9 @@ struct upipe_rtp_fec {
     /* number of packets recovered */
     uint64_t recovered;
 
+    /** cumulative statistics */
+    struct upipe_rtp_fec_stats stats;
+
     /** output pipe */
     struct upipe *output;
     /** flow_definition packet */
@@ -128,7 +177,8 @@ struct upipe_rtp_fec {
 };
 
 UPIPE_HELPER_UPIPE(upipe_rtp_fec, upipe, UPIPE_RTP_FEC_SIGNATURE);
-UPIPE_HELPER_UREFCOUNT(upipe_rtp_fec, urefcount, upipe_rtp_fec_free);
+UPIPE_HELPER_UREFCOUNT(upipe_rtp_fec, urefcount, upipe_rtp_fec_no_input);
+UPIPE_HELPER_UREFCOUNT_REAL(upipe_rtp_fec, urefcount_real, upipe_rtp_fec_free);
 
 UPIPE_HELPER_OUTPUT(upipe_rtp_fec, output, flow_def, output_state, request_list)
 
@@ -184,111 +234,274 @@ static void upipe_rtp_fec_extract_parameters(struct uref *fec_uref,
     uref_block_peek_unmap(fec_uref, RTP_HEADER_SIZE, fec_header, peek);
 }
 
-/* Delete main packets older than the reference point */
-static void clear_main_list(struct uchain *main_list, uint16_t snbase)
+/** @internal @This returns the size of the rings for a FEC matrix, large
+ * enough for two matrices and as many packets of reordering and latency.
+ *
+ * @param cols number of columns of the matrix
+ * @param rows number of rows of the matrix
+ * @return size of the rings
+ */
+static uint32_t upipe_rtp_fec_ring_size(int cols, int rows)
 {
-    struct uchain *uchain, *uchain_tmp;
+    uint32_t needed = 4 * cols * rows;
+    uint32_t size = FEC_RING_MIN_SIZE;
+    while (size < needed && size < FEC_RING_MAX_SIZE)
+        size <<= 1;
+    return size;
+}
 
-    ulist_delete_foreach (main_list, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        if (!seq_num_lt(uref->priv, snbase))
-            break;
+/** @internal @This initializes a packet ring.
+ *
+ * @param ring pointer to the ring
+ * @return an error code
+ */
+static int upipe_rtp_fec_ring_init(struct upipe_rtp_fec_ring *ring)
+{
+    ring->head = UINT32_MAX;
+    ring->tail = UINT32_MAX;
+    ring->count = 0;
+    ring->mask = FEC_RING_MIN_SIZE - 1;
+    ring->urefs = calloc(FEC_RING_MIN_SIZE, sizeof(*ring->urefs));
+    return ring->urefs != NULL ? UBASE_ERR_NONE : UBASE_ERR_ALLOC;
+}
 
-        ulist_delete(uchain);
-        uref_free(uref);
+/** @internal @This changes the size of a ring. The packets of the ring must
+ * fit in the new size.
+ *
+ * @param ring pointer to the ring
+ * @param size new size, power of two
+ * @return an error code
+ */
+static int upipe_rtp_fec_ring_resize(struct upipe_rtp_fec_ring *ring,
+                                     uint32_t size)
+{
+    struct uref **urefs = calloc(size, sizeof(*urefs));
+    if (unlikely(urefs == NULL))
+        return UBASE_ERR_ALLOC;
+
+    uint16_t seqnum = ring->head;
+    for (unsigned int i = 0; i < ring->count; seqnum++) {
+        struct uref *uref = ring->urefs[seqnum & ring->mask];
+        if (uref == NULL)
+            continue;
+        urefs[seqnum & (size - 1)] = uref;
+        i++;
     }
+
+    free(ring->urefs);
+    ring->urefs = urefs;
+    ring->mask = size - 1;
+    return UBASE_ERR_NONE;
 }
 
-// TODO : merge with above, cache seqnum
-/* Delete FEC packets older than the reference point */
-static void clear_fec_list(struct uchain *fec_list, uint16_t last_fec_snbase)
+/** @internal @This returns the oldest sequence number of a ring, skipping
+ * the slots emptied by @ref upipe_rtp_fec_ring_remove.
+ *
+ * @param ring pointer to the ring
+ * @return oldest sequence number, or UINT32_MAX if the ring is empty
+ */
+static inline uint32_t upipe_rtp_fec_ring_head(struct upipe_rtp_fec_ring *ring)
 {
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach (fec_list, uchain, uchain_tmp) {
-        struct uref *fec_uref = uref_from_uchain(uchain);
-        uint16_t snbase_low = fec_uref->priv >> 32;
+    if (ring->head != UINT32_MAX)
+        while (ring->urefs[ring->head & ring->mask] == NULL)
+            ring->head = (uint16_t)(ring->head + 1);
+    return ring->head;
+}
 
-        if (!seq_num_lt(snbase_low, last_fec_snbase))
-            break;
+/** @internal @This returns the packet stored for a sequence number.
+ *
+ * @param ring pointer to the ring
+ * @param seqnum sequence number
+ * @return pointer to the packet, or NULL
+ */
+static inline struct uref *
+    upipe_rtp_fec_ring_get(struct upipe_rtp_fec_ring *ring, uint16_t seqnum)
+{
+    /* sequence numbers outside of the ring would alias other packets */
+    if (ring->head == UINT32_MAX ||
+        (uint16_t)(seqnum - ring->head) > (uint16_t)(ring->tail - ring->head))
+        return NULL;
+    return ring->urefs[seqnum & ring->mask];
+}
 
-        ulist_delete(uchain);
-        uref_free(fec_uref);
-    }
+/** @internal @This returns the oldest packet of a ring.
+ *
+ * @param ring pointer to the ring
+ * @return pointer to the packet, or NULL if the ring is empty
+ */
+static inline struct uref *
+    upipe_rtp_fec_ring_first(struct upipe_rtp_fec_ring *ring)
+{
+    uint32_t head = upipe_rtp_fec_ring_head(ring);
+    if (head == UINT32_MAX)
+        return NULL;
+    return ring->urefs[head & ring->mask];
 }
 
-static void insert_ordered_uref(struct uchain *queue, struct uref *uref)
+/** @internal @This stores a packet in a ring, growing it if needed.
+ *
+ * @param ring pointer to the ring
+ * @param seqnum sequence number of the packet
+ * @param uref packet to store
+ * @return UBASE_ERR_BUSY if a packet with the same sequence number is
+ * already stored, or an error code
+ */
+static int upipe_rtp_fec_ring_insert(struct upipe_rtp_fec_ring *ring,
+                                     uint16_t seqnum, struct uref *uref)
 {
-    uint16_t new_seqnum = uref->priv;
+    if (upipe_rtp_fec_ring_head(ring) == UINT32_MAX) {
+        ring->head = seqnum;
+        ring->tail = seqnum;
+    } else {
+        uint16_t head = seq_num_lt(seqnum, ring->head) ? seqnum : ring->head;
+        uint16_t tail = seq_num_lt(ring->tail, seqnum) ? seqnum : ring->tail;
+        uint32_t span = (uint16_t)(tail - head) + 1;
+        if (unlikely(span > ring->mask + 1)) {
+            uint32_t size = ring->mask + 1;
+            while (size < span)
+                size <<= 1;
+            UBASE_RETURN(upipe_rtp_fec_ring_resize(ring, size));
+        }
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach_reverse(queue, uchain, uchain_tmp) {
-        struct uref *cur_uref = uref_from_uchain(uchain);
-        uint16_t seqnum = cur_uref->priv;
+        struct uref **slot = &ring->urefs[seqnum & ring->mask];
+        if (*slot != NULL)
+            return UBASE_ERR_BUSY;
+        ring->head = head;
+        ring->tail = tail;
+    }
 
-        /* Duplicate packet */
-        if (new_seqnum == seqnum) {
-            uref_free(uref);
-            return;
-        }
+    ring->urefs[seqnum & ring->mask] = uref;
+    ring->count++;
+    return UBASE_ERR_NONE;
+}
 
-        if (!seq_num_lt(new_seqnum, seqnum))
-            break;
+/** @internal @This removes a packet from a ring. The head of the ring is
+ * only moved forward lazily by @ref upipe_rtp_fec_ring_head.
+ *
+ * @param ring pointer to the ring
+ * @param seqnum sequence number of the packet
+ * @return pointer to the removed packet, or NULL
+ */
+static struct uref *upipe_rtp_fec_ring_remove(struct upipe_rtp_fec_ring *ring,
+                                              uint16_t seqnum)
+{
+    struct uref *uref = upipe_rtp_fec_ring_get(ring, seqnum);
+    if (uref == NULL)
+        return NULL;
 
-        /* Check previous packet if any */
-        struct uref *prev_uref = uref_from_uchain(uchain->prev);
-        if (prev_uref) {
-            uint16_t prev_seqnum = prev_uref->priv;
-            if (prev_seqnum == new_seqnum)
-                continue;
+    ring->urefs[seqnum & ring->mask] = NULL;
+    if (!--ring->count) {
+        ring->head = UINT32_MAX;
+        ring->tail = UINT32_MAX;
+    }
+    return uref;
+}
 
-            if (seq_num_lt(new_seqnum, prev_uref->priv))
-                continue;
-        }
+/** @internal @This frees all the packets stored in a ring.
+ *
+ * @param ring pointer to the ring
+ */
+static void upipe_rtp_fec_ring_flush(struct upipe_rtp_fec_ring *ring)
+{
+    while (ring->count)
+        uref_free(upipe_rtp_fec_ring_remove(ring,
+                                            upipe_rtp_fec_ring_head(ring)));
+}
 
-        uref_clock_delete_date_sys(uref);
-        ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
+/** @internal @This frees all the packets and the storage of a ring.
+ *
+ * @param ring pointer to the ring
+ */
+static void upipe_rtp_fec_ring_clean(struct upipe_rtp_fec_ring *ring)
+{
+    if (ring->urefs == NULL)
         return;
+    upipe_rtp_fec_ring_flush(ring);
+    free(ring->urefs);
+    ring->urefs = NULL;
+}
+
+/** @internal @This inserts a media packet in the ring, dropping duplicates.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref media packet
+ */
+static void upipe_rtp_fec_insert_main(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct upipe_rtp_fec_ring *ring = &upipe_rtp_fec->main_ring;
+    uint16_t seqnum = uref->priv;
+
+    /* Reordered packets would delay the output of the following ones */
+    if (ring->tail != UINT32_MAX && seq_num_lt(seqnum, ring->tail))
+        uref_clock_delete_date_sys(uref);
+
+    int err = upipe_rtp_fec_ring_insert(ring, seqnum, uref);
+    if (unlikely(!ubase_check(err))) {
+        if (err == UBASE_ERR_BUSY)
+            upipe_rtp_fec->stats.duplicates++;
+        else
+            upipe_throw_fatal(upipe, err);
+        uref_free(uref);
     }
+}
 
-    /* Add to end of queue */
-    ulist_add(queue, uref_to_uchain(uref));
+/* Delete main packets older than the reference point */
+static void upipe_rtp_fec_clear_main(struct upipe *upipe, uint16_t snbase)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct upipe_rtp_fec_ring *ring = &upipe_rtp_fec->main_ring;
+
+    uint32_t head;
+    while ((head = upipe_rtp_fec_ring_head(ring)) != UINT32_MAX &&
+           seq_num_lt(head, snbase))
+        uref_free(upipe_rtp_fec_ring_remove(ring, head));
 }
 
-/* apply the correction from that fec packet */
-static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
-        struct uref *fec_uref, uint16_t *seqnum_list, int items)
+/** @internal @This applies a FEC packet to the media packets it protects.
+ *
+ * If no packet is missing, or if the only missing packet was recovered, the
+ * FEC packet is consumed. Otherwise it is left to the caller.
+ *
+ * @param upipe description structure of the pipe
+ * @param fec_uref FEC packet
+ * @param col true for a column FEC packet, false for a row FEC packet
+ * @param recovered_p filled in with the sequence number of the recovered
+ * packet, or UINT32_MAX
+ * @return the number of missing packets
+ */
+static int upipe_rtp_fec_recover(struct upipe *upipe, struct uref *fec_uref,
+                                 bool col, uint32_t *recovered_p)
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct upipe_rtp_fec_ring *ring = &upipe_rtp_fec->main_ring;
+    uint16_t snbase = fec_uref->priv >> 32;
+    int items = col ? upipe_rtp_fec->rows : upipe_rtp_fec->cols;
+    uint16_t step = col ? upipe_rtp_fec->cols : 1;
 
-    bool found_seqnum[FEC_MAX] = {0};
+    *recovered_p = UINT32_MAX;
 
     /* Search to see if any packets are lost */
-    int processed = 0;
-    struct uchain *uchain;
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint16_t seqnum = uref->priv;
-
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == seqnum) {
-                processed++;
-                found_seqnum[i] = true;
-                break;
-            }
+    int missing = 0;
+    uint16_t missing_seqnum = 0;
+    uint16_t seqnum = snbase;
+    for (int i = 0; i < items; i++, seqnum += step) {
+        if (upipe_rtp_fec_ring_get(ring, seqnum) == NULL) {
+            missing++;
+            missing_seqnum = seqnum;
         }
+    }
 
-        if (processed == items) {
-            upipe_verbose_va(upipe, "no packets lost");
-            uref_free(fec_uref);
-            return;
-        }
+    if (!missing) {
+        upipe_verbose_va(upipe, "no packets lost");
+        uref_free(fec_uref);
+        return 0;
     }
 
-    if (processed != items - 1) {
+    if (missing > 1) {
         upipe_dbg_va(upipe, "Too much packet loss: found only %d out of %d",
-                processed, items);
-        uref_free(fec_uref);
-        return;
+                items - missing, items);
+        return missing;
     }
 
     /* Extract parameters from FEC packet */
@@ -296,88 +509,65 @@ static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
     uint32_t ts_rec;
     upipe_rtp_fec_extract_parameters(fec_uref, &ts_rec, &length_rec);
 
-    /* Recoverable packet */
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-
-        // TODO: only if in list?
+    /* Recover length and timestamp of missing packet */
+    struct uref *first_uref = NULL;
+    seqnum = snbase;
+    for (int i = 0; i < items; i++, seqnum += step) {
+        struct uref *uref = upipe_rtp_fec_ring_get(ring, seqnum);
+        if (uref == NULL)
+            continue;
 
-        uint8_t rtp_buffer[RTP_HEADER_SIZE];
-        const uint8_t *rtp_header = uref_block_peek(uref, 0, RTP_HEADER_SIZE,
-                rtp_buffer);
-        if (unlikely(rtp_header == NULL)) {
+        uint8_t rtp_header[RTP_HEADER_SIZE];
+        size_t uref_len = 0;
+        if (unlikely(!ubase_check(uref_block_extract(uref, 0, RTP_HEADER_SIZE,
+                                                     rtp_header)) ||
+                     !ubase_check(uref_block_size(uref, &uref_len)))) {
             upipe_warn(upipe, "invalid buffer");
             continue;
         }
 
-        uint32_t timestamp = rtp_get_timestamp(rtp_header);
-        uref_block_peek_unmap(uref, 0, rtp_buffer, rtp_header);
-
-        /* Recover length and timestamp of missing packet */
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == uref->priv) {
-                size_t uref_len = 0;
-                uref_block_size(uref, &uref_len);
-                uref_len -= RTP_HEADER_SIZE;
-
-                length_rec ^= uref_len;
-                ts_rec ^= timestamp;
-            }
-        }
+        length_rec ^= uref_len - RTP_HEADER_SIZE;
+        ts_rec ^= rtp_get_timestamp(rtp_header);
+        if (first_uref == NULL)
+            first_uref = uref;
     }
 
     if (length_rec != 7 * TS_SIZE)
-        upipe_warn_va(upipe_rtp_fec_to_upipe(upipe_rtp_fec),
-                "DUBIOUS REC LEN %i timestamp %u", length_rec, ts_rec);
+        upipe_warn_va(upipe, "DUBIOUS REC LEN %i timestamp %u",
+                      length_rec, ts_rec);
 
+    /* The recovered packet overwrites the end of the FEC header */
     uref_block_resize(fec_uref, SMPTE_2022_FEC_HEADER_SIZE, -1);
     uint8_t *dst;
     int size = length_rec + RTP_HEADER_SIZE;
-    uref_block_write(fec_uref, 0, &size, &dst);
-
-    bool copy_header = true;
-
-    processed = 0;
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == uref->priv) {
-                size_t size = 0;
-                uref_block_size(uref, &size);
-                uint8_t payload_buf[TS_SIZE * 7 + RTP_HEADER_SIZE];
-
-                if(size < sizeof(payload_buf))
-                    continue;
-
-                // TODO: uref_block_read in a loop
-                const uint8_t *peek = uref_block_peek(uref, 0, size,
-                        payload_buf);
-                if (copy_header) {
-                    memcpy(dst, peek, RTP_HEADER_SIZE);
-                    copy_header = false;
-                }
-                for (int i = 0; i < size - RTP_HEADER_SIZE; i++)
-                    dst[RTP_HEADER_SIZE + i] ^= peek[RTP_HEADER_SIZE + i];
-                uref_block_peek_unmap(uref, RTP_HEADER_SIZE, payload_buf, peek);
-                processed++;
-                break;
-            }
-        }
-
-        if (processed == items-1)
-            break;
+    if (unlikely(first_uref == NULL ||
+                 !ubase_check(uref_block_write(fec_uref, 0, &size, &dst)))) {
+        upipe_warn(upipe, "unable to recover packet");
+        uref_free(fec_uref);
+        return missing;
+    }
+    if (unlikely(size != length_rec + RTP_HEADER_SIZE)) {
+        upipe_warn(upipe, "unable to recover packet");
+        uref_block_unmap(fec_uref, 0);
+        uref_free(fec_uref);
+        return missing;
     }
 
-    /* Maybe possible to merge with above */
-    uint16_t missing_seqnum = 0;
-    for (int i = 0; i < items; i++)
-        if (!found_seqnum[i]) {
-            missing_seqnum = seqnum_list[i];
-            break;
-        }
+    uref_block_extract(first_uref, 0, RTP_HEADER_SIZE, dst);
+    seqnum = snbase;
+    for (int i = 0; i < items; i++, seqnum += step) {
+        struct uref *uref = upipe_rtp_fec_ring_get(ring, seqnum);
+        if (uref != NULL)
+            upipe_rtp_fec_xor_uref(uref, dst + RTP_HEADER_SIZE, length_rec);
+    }
 
-    upipe_dbg_va(&upipe_rtp_fec->upipe, "Corrected packet. Sequence number: %u", missing_seqnum);
+    upipe_dbg_va(upipe, "Corrected packet. Sequence number: %u",
+                 missing_seqnum);
     upipe_rtp_fec->recovered++;
+    if (col)
+        upipe_rtp_fec->stats.col_recovered++;
+    else
+        upipe_rtp_fec->stats.row_recovered++;
     fec_uref->priv = missing_seqnum;
     rtp_set_seqnum(dst, missing_seqnum);
     rtp_set_timestamp(dst, ts_rec);
@@ -386,31 +576,111 @@ static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
 
     /* Don't insert an FEC corrected packet from the past */
     if (upipe_rtp_fec->last_send_seqnum != UINT32_MAX &&
-       (seq_num_lt(missing_seqnum, upipe_rtp_fec->last_send_seqnum) || upipe_rtp_fec->last_send_seqnum == missing_seqnum))
+       (seq_num_lt(missing_seqnum, upipe_rtp_fec->last_send_seqnum) ||
+        upipe_rtp_fec->last_send_seqnum == missing_seqnum)) {
         uref_free(fec_uref);
-    else
-        insert_ordered_uref(&upipe_rtp_fec->main_queue, fec_uref);
+        return missing;
+    }
+
+    upipe_rtp_fec_insert_main(upipe, fec_uref);
+    *recovered_p = missing_seqnum;
+    return missing;
+}
+
+/** @internal @This holds a FEC packet which cannot be applied yet.
+ *
+ * @param upipe description structure of the pipe
+ * @param fec_uref FEC packet
+ * @param col true for a column FEC packet, false for a row FEC packet
+ */
+static void upipe_rtp_fec_hold(struct upipe *upipe, struct uref *fec_uref,
+                               bool col)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct upipe_rtp_fec_ring *ring = col ? &upipe_rtp_fec->col_held :
+        &upipe_rtp_fec->row_held;
+    uint16_t snbase = fec_uref->priv >> 32;
+
+    if (unlikely(!ubase_check(upipe_rtp_fec_ring_insert(ring, snbase,
+                                                         fec_uref)))) {
+        uref_free(fec_uref);
+        return;
+    }
+
+    /* Only keep the last two matrices */
+    unsigned int max_urefs =
+        2 * (col ? upipe_rtp_fec->cols : upipe_rtp_fec->rows);
+    while (ring->count > max_urefs) {
+        uref_free(upipe_rtp_fec_ring_remove(ring,
+                                            upipe_rtp_fec_ring_head(ring)));
+        upipe_rtp_fec->stats.unrecoverable++;
+    }
+}
+
+/** @internal @This applies a FEC packet, then iteratively retries the held
+ * FEC packets protecting the recovered packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param fec_uref FEC packet
+ * @param col true for a column FEC packet, false for a row FEC packet
+ */
+static void upipe_rtp_fec_decode(struct upipe *upipe, struct uref *fec_uref,
+                                 bool col)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    /* every recovery consumes a held FEC packet */
+    uint16_t stack[4 * FEC_MAX + 1];
+    unsigned int depth = 0;
+    uint32_t recovered;
+
+    if (upipe_rtp_fec_recover(upipe, fec_uref, col, &recovered) > 1)
+        upipe_rtp_fec_hold(upipe, fec_uref, col);
+    if (recovered != UINT32_MAX)
+        stack[depth++] = recovered;
+
+    while (depth) {
+        uint16_t seqnum = stack[--depth];
+
+        /* column FEC packets first, then row FEC packets */
+        for (int i = 0; i < upipe_rtp_fec->rows + upipe_rtp_fec->cols; i++) {
+            bool held_col = i < upipe_rtp_fec->rows;
+            uint16_t snbase = held_col ? seqnum - i * upipe_rtp_fec->cols :
+                seqnum - (i - upipe_rtp_fec->rows);
+            struct uref *held = upipe_rtp_fec_ring_remove(
+                    held_col ? &upipe_rtp_fec->col_held :
+                    &upipe_rtp_fec->row_held, snbase);
+            if (held == NULL)
+                continue;
+
+            if (upipe_rtp_fec_recover(upipe, held, held_col, &recovered) > 1)
+                upipe_rtp_fec_hold(upipe, held, held_col);
+            if (recovered != UINT32_MAX) {
+                upipe_rtp_fec->stats.iterative_recovered++;
+                if (depth < UBASE_ARRAY_SIZE(stack))
+                    stack[depth++] = recovered;
+            }
+        }
+    }
 }
 
 static void upipe_rtp_fec_apply_col_fec(struct upipe *upipe)
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
-    uint16_t seqnum_list[FEC_MAX];
+    struct upipe_rtp_fec_ring *ring = &upipe_rtp_fec->col_ring;
 
     for (;;) {
-        struct uchain *fec_uchain = ulist_peek(&upipe_rtp_fec->col_queue);
-        if (!fec_uchain)
+        struct uref *fec_uref = upipe_rtp_fec_ring_first(ring);
+        if (!fec_uref)
             break;
 
-        struct uref *fec_uref = uref_from_uchain(fec_uchain);
-        uint16_t snbase_low = fec_uref->priv >> 32;
+        uint16_t snbase_low = upipe_rtp_fec_ring_head(ring);
         uint16_t col_delta = upipe_rtp_fec->last_seqnum - snbase_low - 1;
 
         /* Account for late column FEC packets by making sure at least one extra row exists */
         if (col_delta <= (upipe_rtp_fec->cols + 1) * upipe_rtp_fec->rows)
             break;
 
-        ulist_pop(&upipe_rtp_fec->col_queue);
+        upipe_rtp_fec_ring_remove(ring, snbase_low);
 
         /* If no current matrix is being processed and we have enough packets
          * set existing matrix to the snbase value */
@@ -419,13 +689,7 @@ static void upipe_rtp_fec_apply_col_fec(struct upipe *upipe)
             upipe_rtp_fec->cur_matrix_snbase = snbase_low;
         }
 
-        /* Build a list of the expected sequence numbers in matrix column */
-        seqnum_list[0] = snbase_low;
-        for (int i = 1; i < upipe_rtp_fec->rows; i++)
-            seqnum_list[i] = seqnum_list[i-1] + upipe_rtp_fec->cols;
-
-        upipe_rtp_fec_correct_packets(upipe, fec_uref, seqnum_list,
-                upipe_rtp_fec->rows);
+        upipe_rtp_fec_decode(upipe, fec_uref, true);
     }
 }
 
@@ -433,45 +697,33 @@ static void upipe_rtp_fec_apply_row_fec(struct upipe *upipe,
                                        uint16_t cur_row_fec_snbase)
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
-
-    uint16_t seqnum_list[FEC_MAX];
+    struct upipe_rtp_fec_ring *ring = &upipe_rtp_fec->row_ring;
 
     /* get rid of old row FEC packets */
-    clear_fec_list(&upipe_rtp_fec->row_queue, cur_row_fec_snbase);
+    uint32_t head;
+    while ((head = upipe_rtp_fec_ring_head(ring)) != UINT32_MAX &&
+           seq_num_lt(head, cur_row_fec_snbase))
+        uref_free(upipe_rtp_fec_ring_remove(ring, head));
 
     /* Row FEC packets are optional so may not actually exist */
-    struct uchain *fec_uchain = ulist_pop(&upipe_rtp_fec->row_queue);
-    if (!fec_uchain)
+    struct uref *fec_uref = upipe_rtp_fec_ring_first(ring);
+    if (!fec_uref)
         return;
 
-    struct uref *fec_uref = uref_from_uchain(fec_uchain);
-    uint16_t snbase_low = fec_uref->priv >> 32;
-
+    uint16_t snbase_low = upipe_rtp_fec_ring_head(ring);
+    upipe_rtp_fec_ring_remove(ring, snbase_low);
     upipe_rtp_fec->cur_row_fec_snbase = snbase_low;
 
-    /* Build a list of the expected sequence numbers */
-    for (int i = 0; i < upipe_rtp_fec->cols; i++)
-        seqnum_list[i] = snbase_low++;
-
-    upipe_rtp_fec_correct_packets(upipe, fec_uref, seqnum_list,
-            upipe_rtp_fec->cols);
-}
-
-static void upipe_rtp_fec_clear_queue(struct uchain *queue)
-{
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach (queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
+    upipe_rtp_fec_decode(upipe, fec_uref, false);
 }
 
 static void upipe_rtp_fec_clear(struct upipe_rtp_fec *upipe_rtp_fec)
 {
-    upipe_rtp_fec_clear_queue(&upipe_rtp_fec->main_queue);
-    upipe_rtp_fec_clear_queue(&upipe_rtp_fec->col_queue);
-    upipe_rtp_fec_clear_queue(&upipe_rtp_fec->row_queue);
+    upipe_rtp_fec_ring_flush(&upipe_rtp_fec->main_ring);
+    upipe_rtp_fec_ring_flush(&upipe_rtp_fec->col_ring);
+    upipe_rtp_fec_ring_flush(&upipe_rtp_fec->row_ring);
+    upipe_rtp_fec_ring_flush(&upipe_rtp_fec->col_held);
+    upipe_rtp_fec_ring_flush(&upipe_rtp_fec->row_held);
 }
 
 // TODO: wait_upump?
@@ -479,11 +731,14 @@ static void upipe_rtp_fec_timer(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct upipe_rtp_fec_ring *ring = &upipe_rtp_fec->main_ring;
     uint64_t now = uclock_now(upipe_rtp_fec->uclock);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach (&upipe_rtp_fec->main_queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
+    for (;;) {
+        struct uref *uref = upipe_rtp_fec_ring_first(ring);
+        if (uref == NULL)
+            break;
+
         uint64_t date_sys = UINT64_MAX;
         int type;
         uref_clock_get_date_sys(uref, &date_sys, &type);
@@ -499,7 +754,7 @@ static void upipe_rtp_fec_timer(struct upump *upump)
             uref_clock_set_date_sys(uref, date_sys, type);
         }
 
-        ulist_delete(uchain);
+        upipe_rtp_fec_ring_remove(ring, seqnum);
         upipe_rtp_fec_output(upipe, uref, NULL);
 
         if (upipe_rtp_fec->last_send_seqnum != UINT32_MAX) {
@@ -507,9 +762,10 @@ static void upipe_rtp_fec_timer(struct upump *upump)
             if (expected != seqnum) {
                 upipe_dbg_va(upipe, "FEC output LOST, expected seqnum %hu got %" PRIu64,
                         expected, seqnum);
-                upipe_rtp_fec->lost +=
+                uint64_t lost =
                     (seqnum + UINT16_MAX + 1 - expected) & UINT16_MAX;
-
+                upipe_rtp_fec->lost += lost;
+                upipe_rtp_fec->stats.lost += lost;
             }
         }
 
@@ -542,6 +798,19 @@ static void clear_fec(struct upipe *upipe)
 
     upipe_rtp_fec_clear(upipe_rtp_fec);
 
+    /* Size the now empty rings for the new matrix */
+    uint32_t size = upipe_rtp_fec_ring_size(upipe_rtp_fec->cols,
+                                            upipe_rtp_fec->rows);
+    struct upipe_rtp_fec_ring *rings[] = {
+        &upipe_rtp_fec->main_ring, &upipe_rtp_fec->col_ring,
+        &upipe_rtp_fec->row_ring, &upipe_rtp_fec->col_held,
+        &upipe_rtp_fec->row_held
+    };
+    for (unsigned int i = 0; i < UBASE_ARRAY_SIZE(rings); i++)
+        if (rings[i]->mask + 1 != size &&
+            !ubase_check(upipe_rtp_fec_ring_resize(rings[i], size)))
+            upipe_warn(upipe, "couldn't resize FEC rings");
+
     upipe_rtp_fec->prev_sys = UINT64_MAX;
 
     upipe_rtp_fec->first_seqnum = UINT32_MAX;
@@ -556,15 +825,17 @@ static void upipe_rtp_fec_start_timer(struct upipe *upipe, uint16_t seqnum)
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_sub_mgr(upipe->mgr);
 
+    struct upipe_rtp_fec_ring *ring = &upipe_rtp_fec->main_ring;
+
     /* Clear any old non-FEC packets */
-    clear_main_list(&upipe_rtp_fec->main_queue, upipe_rtp_fec->cur_matrix_snbase);
+    upipe_rtp_fec_clear_main(upipe_rtp_fec_to_upipe(upipe_rtp_fec),
+                             upipe_rtp_fec->cur_matrix_snbase);
 
-    struct uchain *first_uchain = ulist_peek(&upipe_rtp_fec->main_queue);
-    if (!first_uchain)
+    struct uref *first_uref = upipe_rtp_fec_ring_first(ring);
+    if (!first_uref)
         return;
 
-    struct uref *first_uref = uref_from_uchain(first_uchain);
-    upipe_rtp_fec->first_seqnum = first_uref->priv;
+    upipe_rtp_fec->first_seqnum = upipe_rtp_fec_ring_head(ring);
 
     /* Make sure we have at least two matrices of data as per the spec */
     uint16_t seq_delta = seqnum - upipe_rtp_fec->first_seqnum - 1;
@@ -580,13 +851,10 @@ static void upipe_rtp_fec_start_timer(struct upipe *upipe, uint16_t seqnum)
 
     if (date_sys == UINT64_MAX) {
         /* First packet having an unusable date_sys is not useful */
-        ulist_delete(first_uchain);
-        uref_free(first_uref);
-        first_uchain = ulist_peek(&upipe_rtp_fec->main_queue);
-        if (first_uchain) {
-            struct uref *uref = uref_from_uchain(first_uchain);
-            upipe_rtp_fec->first_seqnum = uref->priv;
-        }
+        uref_free(upipe_rtp_fec_ring_remove(ring,
+                                            upipe_rtp_fec->first_seqnum));
+        if (upipe_rtp_fec_ring_head(ring) != UINT32_MAX)
+            upipe_rtp_fec->first_seqnum = ring->head;
         return;
     }
 
@@ -676,7 +944,7 @@ static void upipe_rtp_fec_main_input(struct upipe *upipe, struct uref *uref)
         uint64_t date_sys = 0;
         uref_clock_get_date_sys(uref, &date_sys, &type);
 
-        insert_ordered_uref(&upipe_rtp_fec->main_queue, uref);
+        upipe_rtp_fec_insert_main(super_pipe, uref);
 
         /* Owing to clock drift the latency of 2x the FEC matrix may increase
          * Build a continually updating duration and correct the latency if necessary.
@@ -750,8 +1018,8 @@ static void upipe_rtp_fec_colrow_input(struct upipe *upipe, struct uref *uref)
     uref_block_peek_unmap(uref, RTP_HEADER_SIZE, fec_buffer, fec_header);
 
     bool col = (upipe == upipe_rtp_fec_to_col_subpipe(upipe_rtp_fec));
-    struct uchain *queue = col ? &upipe_rtp_fec->col_queue :
-        &upipe_rtp_fec->row_queue;
+    struct upipe_rtp_fec_ring *ring = col ? &upipe_rtp_fec->col_ring :
+        &upipe_rtp_fec->row_ring;
 
     if (col) {
         if (d) {
@@ -781,13 +1049,19 @@ static void upipe_rtp_fec_colrow_input(struct upipe *upipe, struct uref *uref)
         }
     }
 
-    insert_ordered_uref(queue, uref);
-    int max_urefs = 2 * (col ? upipe_rtp_fec->cols : upipe_rtp_fec->rows);
-    if (ulist_depth(queue) >  max_urefs) {
-        struct uchain *uchain = ulist_pop(queue);
-        struct uref *uref = uref_from_uchain(uchain);
+    int err = upipe_rtp_fec_ring_insert(ring, snbase_low, uref);
+    if (unlikely(!ubase_check(err))) {
+        if (err == UBASE_ERR_BUSY)
+            upipe_rtp_fec->stats.duplicates++;
+        else
+            upipe_throw_fatal(upipe, err);
         uref_free(uref);
     }
+    unsigned int max_urefs =
+        2 * (col ? upipe_rtp_fec->cols : upipe_rtp_fec->rows);
+    while (ring->count > max_urefs)
+        uref_free(upipe_rtp_fec_ring_remove(ring,
+                                            upipe_rtp_fec_ring_head(ring)));
     upipe_rtp_fec->pkts_since_last_fec = 0;
     return;
 
@@ -903,7 +1177,7 @@ static void upipe_rtp_fec_init_sub_mgr(struct upipe *upipe)
     struct upipe_mgr *sub_mgr = &upipe_rtp_fec->sub_mgr;
 
     upipe_mgr_init(sub_mgr);
-    sub_mgr->refcount = upipe_rtp_fec_to_urefcount(upipe_rtp_fec);
+    sub_mgr->refcount = upipe_rtp_fec_to_urefcount_real(upipe_rtp_fec);
     sub_mgr->signature = UPIPE_RTP_FEC_INPUT_SIGNATURE;
     sub_mgr->upipe_input = upipe_rtp_fec_sub_input;
     sub_mgr->upipe_control = upipe_rtp_fec_sub_control;
@@ -936,6 +1210,24 @@ static struct upipe *_upipe_rtp_fec_alloc(struct upipe_mgr *mgr,
         return NULL;
     }
 
+    if (unlikely(
+            !ubase_check(upipe_rtp_fec_ring_init(&upipe_rtp_fec->main_ring)) ||
+            !ubase_check(upipe_rtp_fec_ring_init(&upipe_rtp_fec->col_ring)) ||
+            !ubase_check(upipe_rtp_fec_ring_init(&upipe_rtp_fec->row_ring)) ||
+            !ubase_check(upipe_rtp_fec_ring_init(&upipe_rtp_fec->col_held)) ||
+            !ubase_check(upipe_rtp_fec_ring_init(&upipe_rtp_fec->row_held)))) {
+        upipe_rtp_fec_ring_clean(&upipe_rtp_fec->main_ring);
+        upipe_rtp_fec_ring_clean(&upipe_rtp_fec->col_ring);
+        upipe_rtp_fec_ring_clean(&upipe_rtp_fec->row_ring);
+        upipe_rtp_fec_ring_clean(&upipe_rtp_fec->col_held);
+        upipe_rtp_fec_ring_clean(&upipe_rtp_fec->row_held);
+        free(upipe_rtp_fec);
+        uprobe_release(uprobe_main);
+        uprobe_release(uprobe_col);
+        uprobe_release(uprobe_row);
+        return NULL;
+    }
+
     upipe_rtp_fec->first_seqnum = UINT32_MAX;
     upipe_rtp_fec->last_seqnum = UINT32_MAX;
     upipe_rtp_fec->last_send_seqnum = UINT32_MAX;
@@ -956,6 +1248,7 @@ static struct upipe *_upipe_rtp_fec_alloc(struct upipe_mgr *mgr,
     upipe_rtp_fec_init_upump(upipe);
     upipe_rtp_fec_init_uclock(upipe);
     upipe_rtp_fec_init_urefcount(upipe);
+    upipe_rtp_fec_init_urefcount_real(upipe);
     upipe_rtp_fec_init_sub_mgr(upipe);
     upipe_rtp_fec_init_output(upipe);
 
@@ -967,10 +1260,6 @@ static struct upipe *_upipe_rtp_fec_alloc(struct upipe_mgr *mgr,
     upipe_rtp_fec_sub_init(upipe_rtp_fec_to_row_subpipe(upipe_rtp_fec),
                             &upipe_rtp_fec->sub_mgr, uprobe_row);
 
-    ulist_init(&upipe_rtp_fec->main_queue);
-    ulist_init(&upipe_rtp_fec->col_queue);
-    ulist_init(&upipe_rtp_fec->row_queue);
-
     upipe_rtp_fec_check_upump_mgr(upipe);
 
     upipe_throw_ready(upipe);
@@ -1070,11 +1359,34 @@ static int upipe_rtp_fec_control(struct upipe *upipe, int command, va_list args)
         *latency = upipe_rtp_fec->latency;
         return UBASE_ERR_NONE;
     }
+    case UPIPE_RTP_FEC_GET_STATS: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_RTP_FEC_SIGNATURE)
+        struct upipe_rtp_fec_stats *stats =
+            va_arg(args, struct upipe_rtp_fec_stats *);
+        *stats = upipe_rtp_fec->stats;
+        return UBASE_ERR_NONE;
+    }
     default:
         return UBASE_ERR_UNHANDLED;
     }
 }
 
+/** @This is called when there is no external reference to the pipe anymore.
+ * The subpipes hold a reference to the real refcount through their manager.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtp_fec_no_input(struct upipe *upipe)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+
+    upipe_rtp_fec_set_upump(upipe, NULL);
+    upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_main_subpipe(upipe_rtp_fec));
+    upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_col_subpipe(upipe_rtp_fec));
+    upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_row_subpipe(upipe_rtp_fec));
+    upipe_rtp_fec_release_urefcount_real(upipe);
+}
+
 /** @This frees a upipe.
  *
  * @param upipe description structure of the pipe
@@ -1085,15 +1397,16 @@ static void upipe_rtp_fec_free(struct upipe *upipe)
 
     upipe_throw_dead(upipe);
 
-    upipe_rtp_fec_clear(upipe_rtp_fec);
-
-    upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_main_subpipe(upipe_rtp_fec));
-    upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_col_subpipe(upipe_rtp_fec));
-    upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_row_subpipe(upipe_rtp_fec));
+    upipe_rtp_fec_ring_clean(&upipe_rtp_fec->main_ring);
+    upipe_rtp_fec_ring_clean(&upipe_rtp_fec->col_ring);
+    upipe_rtp_fec_ring_clean(&upipe_rtp_fec->row_ring);
+    upipe_rtp_fec_ring_clean(&upipe_rtp_fec->col_held);
+    upipe_rtp_fec_ring_clean(&upipe_rtp_fec->row_held);
 
     upipe_rtp_fec_clean_uclock(upipe);
     upipe_rtp_fec_clean_upump(upipe);
     upipe_rtp_fec_clean_upump_mgr(upipe);
+    upipe_rtp_fec_clean_urefcount_real(upipe);
     upipe_rtp_fec_clean_urefcount(upipe);
 
     upipe_rtp_fec_clean_output(upipe);
@@ -0,0 +1,703 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe SMPTE 2022-1 FEC generator module
+
+    The parity of the current row and of every column of the current matrix
+    is accumulated as the packets flow through, so media packets are
+    forwarded immediately and never retained.
+
+    A row FEC packet is output after the last packet of each row. The column
+    FEC packets of a matrix are output during the next matrix, one every D
+    packets, as recommended by SMPTE 2022-1.
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/uprobe.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_flow.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+#include "upipe/upipe.h"
+#include "upipe/upipe_helper_upipe.h"
+#include "upipe/upipe_helper_urefcount.h"
+#include "upipe/upipe_helper_urefcount_real.h"
+#include "upipe/upipe_helper_output.h"
+
+#include "upipe-ts/upipe_rtp_fec_enc.h"
+
+#include "upipe_rtp_fec_xor.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <bitstream/ietf/rtp.h>
+#include <bitstream/smpte/2022_1_fec.h>
+
+/** we only accept RTP packets */
+#define EXPECTED_FLOW_DEF "block.rtp."
+/** flow definition of the FEC outputs */
+#define FEC_FLOW_DEF "block.rtp.fec."
+/** maximum number of rows or columns */
+#define FEC_MAX 255
+/** default number of columns */
+#define DEFAULT_COLS 10
+/** default number of rows */
+#define DEFAULT_ROWS 10
+/** RTP payload type of the FEC packets */
+#define FEC_PT 96
+/** maximum size of a protected payload */
+#define MAX_PAYLOAD 1500
+
+/** @internal @This is the parity of a row or a column. */
+struct upipe_rtp_fec_enc_parity {
+    /** XOR of the payloads, padded with zeros */
+    uint8_t payload[MAX_PAYLOAD];
+    /** size of the largest payload */
+    size_t size;
+    /** XOR of the payload sizes */
+    uint16_t length_rec;
+    /** XOR of the payload types */
+    uint8_t pt_rec;
+    /** XOR of the timestamps */
+    uint32_t ts_rec;
+};
+
+/** @internal @This is the private context of a FEC output subpipe. */
+struct upipe_rtp_fec_enc_output {
+    /** pipe acting as output */
+    struct upipe *output;
+    /** output flow definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** sequence number of the next FEC packet */
+    uint16_t seqnum;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_rtp_fec_enc_output, upipe,
+                   UPIPE_RTP_FEC_ENC_OUTPUT_SIGNATURE)
+UPIPE_HELPER_OUTPUT(upipe_rtp_fec_enc_output, output, flow_def, output_state,
+                    request_list)
+
+/** @internal @This is the private context of a rtp fec enc pipe. */
+struct upipe_rtp_fec_enc {
+    /** real refcount management structure */
+    struct urefcount urefcount_real;
+    /** refcount management structure exported to the public structure */
+    struct urefcount urefcount;
+
+    /** pipe acting as output */
+    struct upipe *output;
+    /** output flow definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** manager of the output subpipes */
+    struct upipe_mgr sub_mgr;
+    /** column FEC subpipe */
+    struct upipe_rtp_fec_enc_output col_output;
+    /** row FEC subpipe */
+    struct upipe_rtp_fec_enc_output row_output;
+
+    /** number of columns (L) */
+    unsigned int cols;
+    /** number of rows (D) */
+    unsigned int rows;
+
+    /** sequence number of the first packet of the matrix, or UINT32_MAX */
+    uint32_t snbase;
+    /** position of the next packet in the matrix */
+    unsigned int pos;
+    /** sequence number of the last packet */
+    uint16_t last_seqnum;
+
+    /** parity of the current row */
+    struct upipe_rtp_fec_enc_parity row_parity;
+    /** parity of the columns of the current matrix */
+    struct upipe_rtp_fec_enc_parity *col_parity;
+    /** column FEC packets of the previous matrix */
+    struct uref **col_fec;
+    /** number of column FEC packets of the previous matrix */
+    unsigned int col_fec_count;
+    /** next column FEC packet to output */
+    unsigned int col_fec_next;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_rtp_fec_enc, upipe, UPIPE_RTP_FEC_ENC_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_rtp_fec_enc, urefcount,
+                       upipe_rtp_fec_enc_no_input)
+UPIPE_HELPER_UREFCOUNT_REAL(upipe_rtp_fec_enc, urefcount_real,
+                            upipe_rtp_fec_enc_free)
+UPIPE_HELPER_OUTPUT(upipe_rtp_fec_enc, output, flow_def, output_state,
+                    request_list)
+
+UBASE_FROM_TO(upipe_rtp_fec_enc, upipe_mgr, sub_mgr, sub_mgr)
+UBASE_FROM_TO(upipe_rtp_fec_enc, upipe_rtp_fec_enc_output, col_output,
+              col_output)
+UBASE_FROM_TO(upipe_rtp_fec_enc, upipe_rtp_fec_enc_output, row_output,
+              row_output)
+
+/** @internal @This resets a parity accumulator.
+ *
+ * @param parity parity accumulator
+ */
+static inline void
+    upipe_rtp_fec_enc_parity_reset(struct upipe_rtp_fec_enc_parity *parity)
+{
+    parity->size = 0;
+    parity->length_rec = 0;
+    parity->pt_rec = 0;
+    parity->ts_rec = 0;
+}
+
+/** @internal @This adds a packet to a parity accumulator.
+ *
+ * @param parity parity accumulator
+ * @param uref RTP packet
+ * @param rtp_header RTP header of the packet
+ * @param size size of the payload of the packet
+ */
+static void upipe_rtp_fec_enc_parity_add(
+        struct upipe_rtp_fec_enc_parity *parity, struct uref *uref,
+        const uint8_t *rtp_header, size_t size)
+{
+    if (parity->size < size) {
+        memset(parity->payload + parity->size, 0, size - parity->size);
+        parity->size = size;
+    }
+    upipe_rtp_fec_xor_uref(uref, parity->payload, size);
+    parity->length_rec ^= size;
+    parity->pt_rec ^= rtp_get_type(rtp_header);
+    parity->ts_rec ^= rtp_get_timestamp(rtp_header);
+}
+
+/** @internal @This builds a FEC packet from a parity accumulator.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref last protected packet, used as a template
+ * @param parity parity accumulator
+ * @param snbase sequence number of the first protected packet
+ * @param col true for a column FEC packet, false for a row FEC packet
+ * @return pointer to the FEC packet, or NULL in case of error
+ */
+static struct uref *upipe_rtp_fec_enc_build(struct upipe *upipe,
+        struct uref *uref, const struct upipe_rtp_fec_enc_parity *parity,
+        uint16_t snbase, bool col)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+    struct upipe_rtp_fec_enc_output *output = col ?
+        &upipe_rtp_fec_enc->col_output : &upipe_rtp_fec_enc->row_output;
+    uint8_t rtp_header[RTP_HEADER_SIZE];
+    int size = RTP_HEADER_SIZE + SMPTE_2022_FEC_HEADER_SIZE + parity->size;
+
+    if (unlikely(!ubase_check(uref_block_extract(uref, 0, RTP_HEADER_SIZE,
+                                                 rtp_header))))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_block_alloc(uref->ubuf->mgr, size);
+    if (unlikely(ubuf == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return NULL;
+    }
+
+    uint8_t *buffer;
+    if (unlikely(!ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer)))) {
+        ubuf_free(ubuf);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return NULL;
+    }
+
+    memset(buffer, 0, RTP_HEADER_SIZE + SMPTE_2022_FEC_HEADER_SIZE);
+    rtp_set_hdr(buffer);
+    rtp_set_type(buffer, FEC_PT);
+    rtp_set_seqnum(buffer, output->seqnum++);
+    rtp_set_timestamp(buffer, rtp_get_timestamp(rtp_header));
+
+    uint8_t *fec = buffer + RTP_HEADER_SIZE;
+    smpte_fec_set_snbase_low(fec, snbase);
+    smpte_fec_set_length_rec(fec, parity->length_rec);
+    smpte_fec_set_e(fec);
+    smpte_fec_set_pt_recovery(fec, parity->pt_rec);
+    smpte_fec_set_ts_recovery(fec, parity->ts_rec);
+    if (col) {
+        smpte_fec_set_offset(fec, upipe_rtp_fec_enc->cols);
+        smpte_fec_set_na(fec, upipe_rtp_fec_enc->rows);
+    } else {
+        smpte_fec_set_d(fec);
+        smpte_fec_set_offset(fec, 1);
+        smpte_fec_set_na(fec, upipe_rtp_fec_enc->cols);
+    }
+    smpte_fec_set_snbase_ext(fec, 0);
+    memcpy(fec + SMPTE_2022_FEC_HEADER_SIZE, parity->payload, parity->size);
+    ubuf_block_unmap(ubuf, 0);
+
+    struct uref *fec_uref = uref_fork(uref, ubuf);
+    if (unlikely(fec_uref == NULL)) {
+        ubuf_free(ubuf);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+    }
+    return fec_uref;
+}
+
+/** @internal @This outputs the column FEC packets of the previous matrix
+ * which were not output yet.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rtp_fec_enc_flush_col(struct upipe *upipe,
+                                        struct upump **upump_p)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+    struct upipe *col = upipe_rtp_fec_enc_output_to_upipe(
+            &upipe_rtp_fec_enc->col_output);
+
+    while (upipe_rtp_fec_enc->col_fec_next <
+           upipe_rtp_fec_enc->col_fec_count) {
+        struct uref *uref =
+            upipe_rtp_fec_enc->col_fec[upipe_rtp_fec_enc->col_fec_next++];
+        if (uref != NULL)
+            upipe_rtp_fec_enc_output_output(col, uref, upump_p);
+    }
+    upipe_rtp_fec_enc->col_fec_count = 0;
+    upipe_rtp_fec_enc->col_fec_next = 0;
+}
+
+/** @internal @This starts a new matrix.
+ *
+ * @param upipe description structure of the pipe
+ * @param snbase sequence number of the first packet of the matrix
+ */
+static void upipe_rtp_fec_enc_start(struct upipe *upipe, uint16_t snbase)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+
+    upipe_rtp_fec_enc->snbase = snbase;
+    upipe_rtp_fec_enc->pos = 0;
+    upipe_rtp_fec_enc_parity_reset(&upipe_rtp_fec_enc->row_parity);
+    for (unsigned int i = 0; i < upipe_rtp_fec_enc->cols; i++)
+        upipe_rtp_fec_enc_parity_reset(&upipe_rtp_fec_enc->col_parity[i]);
+}
+
+/** @internal @This receives RTP packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rtp_fec_enc_input(struct upipe *upipe, struct uref *uref,
+                                    struct upump **upump_p)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+    uint8_t rtp_header[RTP_HEADER_SIZE];
+    size_t size;
+
+    if (unlikely(!ubase_check(uref_block_extract(uref, 0, RTP_HEADER_SIZE,
+                                                 rtp_header)) ||
+                 !ubase_check(uref_block_size(uref, &size)))) {
+        upipe_warn(upipe, "invalid buffer received");
+        uref_free(uref);
+        return;
+    }
+    size -= RTP_HEADER_SIZE;
+
+    uint16_t seqnum = rtp_get_seqnum(rtp_header);
+    if (upipe_rtp_fec_enc->snbase != UINT32_MAX &&
+        seqnum != (uint16_t)(upipe_rtp_fec_enc->last_seqnum + 1)) {
+        upipe_warn_va(upipe, "discontinuity (%"PRIu16" -> %"PRIu16
+                      "), restarting matrix",
+                      upipe_rtp_fec_enc->last_seqnum, seqnum);
+        upipe_rtp_fec_enc->snbase = UINT32_MAX;
+    }
+    upipe_rtp_fec_enc->last_seqnum = seqnum;
+
+    if (unlikely(size > MAX_PAYLOAD)) {
+        upipe_warn_va(upipe, "payload too large (%zu), restarting matrix",
+                      size);
+        upipe_rtp_fec_enc->snbase = UINT32_MAX;
+        upipe_rtp_fec_enc_flush_col(upipe, upump_p);
+        upipe_rtp_fec_enc_output(upipe, uref, upump_p);
+        return;
+    }
+
+    if (upipe_rtp_fec_enc->snbase == UINT32_MAX) {
+        upipe_rtp_fec_enc_flush_col(upipe, upump_p);
+        upipe_rtp_fec_enc_start(upipe, seqnum);
+    }
+
+    unsigned int cols = upipe_rtp_fec_enc->cols;
+    unsigned int rows = upipe_rtp_fec_enc->rows;
+    unsigned int pos = upipe_rtp_fec_enc->pos;
+    unsigned int col = pos % cols;
+
+    upipe_rtp_fec_enc_parity_add(&upipe_rtp_fec_enc->row_parity, uref,
+                                 rtp_header, size);
+    upipe_rtp_fec_enc_parity_add(&upipe_rtp_fec_enc->col_parity[col], uref,
+                                 rtp_header, size);
+
+    /* spread the column FEC packets of the previous matrix */
+    struct uref *col_fec = NULL;
+    if (!(pos % rows) &&
+        upipe_rtp_fec_enc->col_fec_next < upipe_rtp_fec_enc->col_fec_count)
+        col_fec =
+            upipe_rtp_fec_enc->col_fec[upipe_rtp_fec_enc->col_fec_next++];
+
+    struct uref *row_fec = NULL;
+    if (col == cols - 1) {
+        row_fec = upipe_rtp_fec_enc_build(upipe, uref,
+                &upipe_rtp_fec_enc->row_parity, seqnum - col, false);
+        upipe_rtp_fec_enc_parity_reset(&upipe_rtp_fec_enc->row_parity);
+    }
+
+    if (++upipe_rtp_fec_enc->pos == cols * rows) {
+        upipe_rtp_fec_enc_flush_col(upipe, upump_p);
+        for (unsigned int i = 0; i < cols; i++) {
+            upipe_rtp_fec_enc->col_fec[i] = upipe_rtp_fec_enc_build(upipe,
+                    uref, &upipe_rtp_fec_enc->col_parity[i],
+                    upipe_rtp_fec_enc->snbase + i, true);
+        }
+        upipe_rtp_fec_enc->col_fec_count = cols;
+        upipe_rtp_fec_enc_start(upipe,
+                upipe_rtp_fec_enc->snbase + cols * rows);
+    }
+
+    upipe_rtp_fec_enc_output(upipe, uref, upump_p);
+    if (row_fec != NULL)
+        upipe_rtp_fec_enc_output_output(upipe_rtp_fec_enc_output_to_upipe(
+                    &upipe_rtp_fec_enc->row_output), row_fec, upump_p);
+    if (col_fec != NULL)
+        upipe_rtp_fec_enc_output_output(upipe_rtp_fec_enc_output_to_upipe(
+                    &upipe_rtp_fec_enc->col_output), col_fec, upump_p);
+}
+
+/** @internal @This sets the size of the FEC matrix.
+ *
+ * @param upipe description structure of the pipe
+ * @param cols number of columns
+ * @param rows number of rows
+ * @return an error code
+ */
+static int _upipe_rtp_fec_enc_set_matrix(struct upipe *upipe,
+                                         unsigned int cols, unsigned int rows)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+
+    if (!cols || cols > FEC_MAX || !rows || rows > FEC_MAX)
+        return UBASE_ERR_INVALID;
+
+    struct upipe_rtp_fec_enc_parity *col_parity =
+        malloc(cols * sizeof(*col_parity));
+    struct uref **col_fec = calloc(cols, sizeof(*col_fec));
+    if (unlikely(col_parity == NULL || col_fec == NULL)) {
+        free(col_parity);
+        free(col_fec);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_rtp_fec_enc_flush_col(upipe, NULL);
+    free(upipe_rtp_fec_enc->col_parity);
+    free(upipe_rtp_fec_enc->col_fec);
+    upipe_rtp_fec_enc->col_parity = col_parity;
+    upipe_rtp_fec_enc->col_fec = col_fec;
+    upipe_rtp_fec_enc->cols = cols;
+    upipe_rtp_fec_enc->rows = rows;
+    upipe_rtp_fec_enc->snbase = UINT32_MAX;
+
+    upipe_notice_va(upipe, "using %ux%u matrix", cols, rows);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_rtp_fec_enc_set_flow_def(struct upipe *upipe,
+                                          struct uref *flow_def)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF))
+
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    struct uref *col_flow_def = uref_dup(flow_def);
+    struct uref *row_flow_def = uref_dup(flow_def);
+    if (unlikely(flow_def_dup == NULL || col_flow_def == NULL ||
+                 row_flow_def == NULL ||
+                 !ubase_check(uref_flow_set_def(col_flow_def, FEC_FLOW_DEF)) ||
+                 !ubase_check(uref_flow_set_def(row_flow_def, FEC_FLOW_DEF)))) {
+        uref_free(flow_def_dup);
+        uref_free(col_flow_def);
+        uref_free(row_flow_def);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_rtp_fec_enc_store_flow_def(upipe, flow_def_dup);
+    upipe_rtp_fec_enc_output_store_flow_def(
+            upipe_rtp_fec_enc_output_to_upipe(&upipe_rtp_fec_enc->col_output),
+            col_flow_def);
+    upipe_rtp_fec_enc_output_store_flow_def(
+            upipe_rtp_fec_enc_output_to_upipe(&upipe_rtp_fec_enc->row_output),
+            row_flow_def);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a rtp fec enc pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_rtp_fec_enc_control(struct upipe *upipe,
+                                     int command, va_list args)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+
+    UBASE_HANDLED_RETURN(
+        upipe_rtp_fec_enc_control_output(upipe, command, args));
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_rtp_fec_enc_set_flow_def(upipe, flow_def);
+        }
+
+        case UPIPE_RTP_FEC_ENC_GET_COL_SUB: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTP_FEC_ENC_SIGNATURE)
+            struct upipe **upipe_p = va_arg(args, struct upipe **);
+            *upipe_p = upipe_rtp_fec_enc_output_to_upipe(
+                    &upipe_rtp_fec_enc->col_output);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_RTP_FEC_ENC_GET_ROW_SUB: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTP_FEC_ENC_SIGNATURE)
+            struct upipe **upipe_p = va_arg(args, struct upipe **);
+            *upipe_p = upipe_rtp_fec_enc_output_to_upipe(
+                    &upipe_rtp_fec_enc->row_output);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_RTP_FEC_ENC_SET_MATRIX: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTP_FEC_ENC_SIGNATURE)
+            unsigned int cols = va_arg(args, unsigned int);
+            unsigned int rows = va_arg(args, unsigned int);
+            return _upipe_rtp_fec_enc_set_matrix(upipe, cols, rows);
+        }
+        case UPIPE_RTP_FEC_ENC_GET_MATRIX: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTP_FEC_ENC_SIGNATURE)
+            unsigned int *cols_p = va_arg(args, unsigned int *);
+            unsigned int *rows_p = va_arg(args, unsigned int *);
+            if (cols_p != NULL)
+                *cols_p = upipe_rtp_fec_enc->cols;
+            if (rows_p != NULL)
+                *rows_p = upipe_rtp_fec_enc->rows;
+            return UBASE_ERR_NONE;
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a FEC output subpipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_rtp_fec_enc_output_control(struct upipe *upipe,
+                                            int command, va_list args)
+{
+    UBASE_HANDLED_RETURN(
+        upipe_rtp_fec_enc_output_control_output(upipe, command, args));
+    switch (command) {
+        case UPIPE_SUB_GET_SUPER: {
+            struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+                upipe_rtp_fec_enc_from_sub_mgr(upipe->mgr);
+            struct upipe **p = va_arg(args, struct upipe **);
+            *p = upipe_rtp_fec_enc_to_upipe(upipe_rtp_fec_enc);
+            return UBASE_ERR_NONE;
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This initializes a FEC output subpipe.
+ *
+ * @param upipe description structure of the super pipe
+ * @param output FEC output subpipe
+ * @param uprobe structure used to raise events by the subpipe
+ */
+static void upipe_rtp_fec_enc_output_init(struct upipe *upipe,
+        struct upipe_rtp_fec_enc_output *output, struct uprobe *uprobe)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+    struct upipe *sub = upipe_rtp_fec_enc_output_to_upipe(output);
+
+    upipe_init(sub, &upipe_rtp_fec_enc->sub_mgr, uprobe);
+    sub->refcount = &upipe_rtp_fec_enc->urefcount;
+    upipe_rtp_fec_enc_output_init_output(sub);
+    output->seqnum = 0;
+    upipe_throw_ready(sub);
+}
+
+/** @internal @This cleans up a FEC output subpipe.
+ *
+ * @param output FEC output subpipe
+ */
+static void upipe_rtp_fec_enc_output_clean(
+        struct upipe_rtp_fec_enc_output *output)
+{
+    struct upipe *sub = upipe_rtp_fec_enc_output_to_upipe(output);
+
+    upipe_throw_dead(sub);
+    upipe_rtp_fec_enc_output_clean_output(sub);
+    upipe_clean(sub);
+}
+
+/** @internal @This allocates a rtp fec enc pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *_upipe_rtp_fec_enc_alloc(struct upipe_mgr *mgr,
+                                              struct uprobe *uprobe,
+                                              uint32_t signature, va_list args)
+{
+    if (signature != UPIPE_RTP_FEC_ENC_SIGNATURE)
+        return NULL;
+    struct uprobe *uprobe_col = va_arg(args, struct uprobe *);
+    struct uprobe *uprobe_row = va_arg(args, struct uprobe *);
+
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        calloc(1, sizeof(struct upipe_rtp_fec_enc));
+    if (unlikely(upipe_rtp_fec_enc == NULL)) {
+        uprobe_release(uprobe);
+        uprobe_release(uprobe_col);
+        uprobe_release(uprobe_row);
+        return NULL;
+    }
+
+    struct upipe *upipe = upipe_rtp_fec_enc_to_upipe(upipe_rtp_fec_enc);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_rtp_fec_enc_init_urefcount(upipe);
+    upipe_rtp_fec_enc_init_urefcount_real(upipe);
+    upipe_rtp_fec_enc_init_output(upipe);
+
+    struct upipe_mgr *sub_mgr = &upipe_rtp_fec_enc->sub_mgr;
+    upipe_mgr_init(sub_mgr);
+    sub_mgr->refcount = upipe_rtp_fec_enc_to_urefcount_real(upipe_rtp_fec_enc);
+    sub_mgr->signature = UPIPE_RTP_FEC_ENC_OUTPUT_SIGNATURE;
+    sub_mgr->upipe_control = upipe_rtp_fec_enc_output_control;
+
+    upipe_rtp_fec_enc_output_init(upipe, &upipe_rtp_fec_enc->col_output,
+                                  uprobe_col);
+    upipe_rtp_fec_enc_output_init(upipe, &upipe_rtp_fec_enc->row_output,
+                                  uprobe_row);
+
+    upipe_rtp_fec_enc->snbase = UINT32_MAX;
+    upipe_rtp_fec_enc->col_parity = NULL;
+    upipe_rtp_fec_enc->col_fec = NULL;
+    upipe_rtp_fec_enc->col_fec_count = 0;
+    upipe_rtp_fec_enc->col_fec_next = 0;
+
+    upipe_throw_ready(upipe);
+
+    if (unlikely(!ubase_check(_upipe_rtp_fec_enc_set_matrix(upipe,
+                        DEFAULT_COLS, DEFAULT_ROWS)))) {
+        upipe_release(upipe);
+        return NULL;
+    }
+    return upipe;
+}
+
+/** @This is called when there is no external reference to the pipe anymore.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtp_fec_enc_no_input(struct upipe *upipe)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+
+    upipe_rtp_fec_enc_flush_col(upipe, NULL);
+    upipe_rtp_fec_enc_output_clean(&upipe_rtp_fec_enc->col_output);
+    upipe_rtp_fec_enc_output_clean(&upipe_rtp_fec_enc->row_output);
+    upipe_rtp_fec_enc_release_urefcount_real(upipe);
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtp_fec_enc_free(struct upipe *upipe)
+{
+    struct upipe_rtp_fec_enc *upipe_rtp_fec_enc =
+        upipe_rtp_fec_enc_from_upipe(upipe);
+
+    upipe_throw_dead(upipe);
+
+    free(upipe_rtp_fec_enc->col_parity);
+    free(upipe_rtp_fec_enc->col_fec);
+
+    upipe_rtp_fec_enc_clean_output(upipe);
+    upipe_rtp_fec_enc_clean_urefcount_real(upipe);
+    upipe_rtp_fec_enc_clean_urefcount(upipe);
+    upipe_clean(upipe);
+    free(upipe_rtp_fec_enc);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_rtp_fec_enc_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_RTP_FEC_ENC_SIGNATURE,
+
+    .upipe_alloc = _upipe_rtp_fec_enc_alloc,
+    .upipe_input = upipe_rtp_fec_enc_input,
+    .upipe_control = upipe_rtp_fec_enc_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for rtp fec enc pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_rtp_fec_enc_mgr_alloc(void)
+{
+    return &upipe_rtp_fec_enc_mgr;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe XOR functions shared by the SMPTE 2022-1 FEC pipes
+ */
+
+#ifndef _UPIPE_TS_UPIPE_RTP_FEC_XOR_H_
+/** @hidden */
+#define _UPIPE_TS_UPIPE_RTP_FEC_XOR_H_
+
+#include "upipe/ubase.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+#include <bitstream/ietf/rtp.h>
+
+/** @internal @This XORs a buffer into another.
+ *
+ * @param dst destination buffer
+ * @param src source buffer
+ * @param size number of octets
+ */
+static inline void upipe_rtp_fec_xor(uint8_t *restrict dst,
+                                     const uint8_t *restrict src, size_t size)
+{
+    size_t i = 0;
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    for (; i + 64 <= size; i += 64) {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(dst + i + 16));
+        __m128i a2 = _mm_loadu_si128((const __m128i *)(dst + i + 32));
+        __m128i a3 = _mm_loadu_si128((const __m128i *)(dst + i + 48));
+        a0 = _mm_xor_si128(a0, _mm_loadu_si128((const __m128i *)(src + i)));
+        a1 = _mm_xor_si128(a1,
+                _mm_loadu_si128((const __m128i *)(src + i + 16)));
+        a2 = _mm_xor_si128(a2,
+                _mm_loadu_si128((const __m128i *)(src + i + 32)));
+        a3 = _mm_xor_si128(a3,
+                _mm_loadu_si128((const __m128i *)(src + i + 48)));
+        _mm_storeu_si128((__m128i *)(dst + i), a0);
+        _mm_storeu_si128((__m128i *)(dst + i + 16), a1);
+        _mm_storeu_si128((__m128i *)(dst + i + 32), a2);
+        _mm_storeu_si128((__m128i *)(dst + i + 48), a3);
+    }
+    for (; i + 16 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i *)(src + i)));
+        _mm_storeu_si128((__m128i *)(dst + i), a);
+    }
+#endif
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, sizeof(a));
+        memcpy(&b, src + i, sizeof(b));
+        a ^= b;
+        memcpy(dst + i, &a, sizeof(a));
+    }
+    for (; i < size; i++)
+        dst[i] ^= src[i];
+}
+
+/** @internal @This XORs the payload of a media packet into a buffer.
+ *
+ * @param uref media packet
+ * @param dst parity buffer
+ * @param size size of the parity buffer
+ */
+static inline void upipe_rtp_fec_xor_uref(struct uref *uref, uint8_t *dst,
+                                          size_t size)
+{
+    size_t uref_size = 0;
+    uref_block_size(uref, &uref_size);
+    if (uref_size < RTP_HEADER_SIZE)
+        return;
+    uref_size -= RTP_HEADER_SIZE;
+    if (uref_size > size)
+        uref_size = size;
+
+    /* shorter packets are implicitly padded with zeros */
+    int offset = 0;
+    while (offset < uref_size) {
+        const uint8_t *buffer;
+        int read_size = uref_size - offset;
+        if (!ubase_check(uref_block_read(uref, RTP_HEADER_SIZE + offset,
+                                         &read_size, &buffer)))
+            break;
+        upipe_rtp_fec_xor(dst + offset, buffer, read_size);
+        uref_block_unmap(uref, RTP_HEADER_SIZE + offset);
+        offset += read_size;
+    }
+}
+
+#endif
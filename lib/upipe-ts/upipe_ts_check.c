@@ -96,14 +96,16 @@ static struct upipe *upipe_ts_check_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-/** @internal @This checks the presence of the sync word.
+/** @internal @This checks the presence of the sync word, and appends the
+ * packet to the list of urefs to output.
  *
  * @param upipe description structure of the pipe
  * @param uref uref structure
- * @param upump_p reference to pump that generated the buffer
+ * @param urefs list of urefs to output
+ * @return false if the packet was dropped
  */
 static bool upipe_ts_check_check(struct upipe *upipe, struct uref *uref,
-                                 struct upump **upump_p)
+                                 struct uchain *urefs)
 {
     const uint8_t *buffer;
     int size = 1;
@@ -122,11 +124,13 @@ static bool upipe_ts_check_check(struct upipe *upipe, struct uref *uref,
         return false;
     }
 
-    upipe_ts_check_output(upipe, uref, upump_p);
+    ulist_add(urefs, uref_to_uchain(uref));
     return true;
 }
 
 /** @internal @This tries to find TS packets in the buffered input urefs.
+ * The packets found in an input buffer are sent to the output as a single
+ * chain.
  *
  * @param upipe description structure of the pipe
  * @param uref uref structure
@@ -143,15 +147,19 @@ static void upipe_ts_check_input(struct upipe *upipe, struct uref *uref,
         return;
     }
 
+    struct uchain urefs;
+    ulist_init(&urefs);
     while (size > upipe_ts_check->output_size) {
         struct uref *next = uref_block_split(uref, upipe_ts_check->output_size);
         if (unlikely(next == NULL)) {
             uref_free(uref);
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            upipe_ts_check_output_chain(upipe, &urefs, upump_p);
             return;
         }
-        if (!upipe_ts_check_check(upipe, uref, upump_p)) {
+        if (!upipe_ts_check_check(upipe, uref, &urefs)) {
             uref_free(next);
+            upipe_ts_check_output_chain(upipe, &urefs, upump_p);
             return;
         }
 
@@ -159,7 +167,10 @@ static void upipe_ts_check_input(struct upipe *upipe, struct uref *uref,
         uref = next;
     }
     if (size == upipe_ts_check->output_size)
-        upipe_ts_check_check(upipe, uref, upump_p);
+        upipe_ts_check_check(upipe, uref, &urefs);
+    else
+        uref_free(uref);
+    upipe_ts_check_output_chain(upipe, &urefs, upump_p);
 }
 
 /** @internal @This sets the input flow definition.
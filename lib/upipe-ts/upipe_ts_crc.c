@@ -0,0 +1,166 @@
+/*
+ * CRC-32/MPEG-2 kernels
+ *
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short CRC-32/MPEG-2 used by PSI and SI sections, with the kernel selected
+ * at runtime
+ * The portable version processes 8 octets per iteration with 8 lookup tables
+ * (slice-by-8), instead of one octet per iteration in bitstream.
+ */
+
+#include "upipe/ubase.h"
+#include "upipe_ts_crc.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include <bitstream/mpeg/psi.h>
+
+/** CRC-32/MPEG-2 polynomial */
+#define CRC32_POLY 0x04c11db7
+
+/** slice-by-8 tables; crc_tables[0] is the classic octet table */
+static uint32_t crc_tables[8][256];
+/** state of crc_tables */
+enum crc_tables_state {
+    /** not filled in yet */
+    CRC_TABLES_EMPTY = 0,
+    /** being filled in by a thread */
+    CRC_TABLES_FILLING,
+    /** filled in */
+    CRC_TABLES_READY
+};
+/** state of crc_tables, accessed atomically */
+static int crc_tables_state = CRC_TABLES_EMPTY;
+
+/** @internal @This fills in the slice-by-8 tables. It may be called by
+ * several pipe threads at once; only the first one computes the tables,
+ * the others wait for them to be published.
+ */
+static void upipe_ts_crc32_init_tables(void)
+{
+    int state = CRC_TABLES_EMPTY;
+    if (!__atomic_compare_exchange_n(&crc_tables_state, &state,
+                                     CRC_TABLES_FILLING, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        while (state != CRC_TABLES_READY)
+            state = __atomic_load_n(&crc_tables_state, __ATOMIC_ACQUIRE);
+        return;
+    }
+
+    for (unsigned i = 0; i < 256; i++) {
+        uint32_t crc = i << 24;
+        for (unsigned j = 0; j < 8; j++)
+            crc = (crc << 1) ^ (crc & 0x80000000 ? CRC32_POLY : 0);
+        crc_tables[0][i] = crc;
+    }
+    for (unsigned i = 0; i < 256; i++)
+        for (unsigned k = 1; k < 8; k++)
+            crc_tables[k][i] = (crc_tables[k - 1][i] << 8) ^
+                crc_tables[0][crc_tables[k - 1][i] >> 24];
+    __atomic_store_n(&crc_tables_state, CRC_TABLES_READY, __ATOMIC_RELEASE);
+}
+
+/** @This is the portable implementation of the CRC.
+ *
+ * @param crc current CRC
+ * @param p buffer
+ * @param size number of octets
+ * @return updated CRC
+ */
+uint32_t upipe_ts_crc32_c(uint32_t crc, const uint8_t *p, uintptr_t size)
+{
+    if (unlikely(__atomic_load_n(&crc_tables_state, __ATOMIC_ACQUIRE) !=
+                 CRC_TABLES_READY))
+        upipe_ts_crc32_init_tables();
+
+    for ( ; size >= 8; size -= 8, p += 8) {
+        uint32_t a = crc ^ (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                            ((uint32_t)p[2] << 8) | p[3]);
+        crc = crc_tables[7][a >> 24] ^ crc_tables[6][(a >> 16) & 0xff] ^
+              crc_tables[5][(a >> 8) & 0xff] ^ crc_tables[4][a & 0xff] ^
+              crc_tables[3][p[4]] ^ crc_tables[2][p[5]] ^
+              crc_tables[1][p[6]] ^ crc_tables[0][p[7]];
+    }
+    for ( ; size; size--, p++)
+        crc = (crc << 8) ^ crc_tables[0][(crc >> 24) ^ *p];
+    return crc;
+}
+
+/** kernel in use, accessed atomically */
+static upipe_ts_crc32_func crc32_func = NULL;
+
+/** @This returns the fastest CRC kernel supported by the CPU.
+ *
+ * @return pointer to kernel
+ */
+upipe_ts_crc32_func upipe_ts_crc32_select(void)
+{
+    upipe_ts_crc32_func func = upipe_ts_crc32_c;
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"))
+        func = upipe_ts_crc32_clmul;
+#endif
+#if defined(__aarch64__) && defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_PMULL)
+        func = upipe_ts_crc32_pmull;
+#endif
+
+    return func;
+}
+
+/** @This computes the CRC-32/MPEG-2 of a buffer.
+ *
+ * @param p buffer
+ * @param size number of octets
+ * @return CRC
+ */
+uint32_t upipe_ts_crc32(const uint8_t *p, uintptr_t size)
+{
+    upipe_ts_crc32_func func = __atomic_load_n(&crc32_func, __ATOMIC_ACQUIRE);
+    if (unlikely(func == NULL)) {
+        func = upipe_ts_crc32_select();
+        __atomic_store_n(&crc32_func, func, __ATOMIC_RELEASE);
+    }
+    return func(0xffffffff, p, size);
+}
+
+/** @This checks the CRC of a PSI section, like psi_check_crc().
+ *
+ * @param section PSI section
+ * @return false if the CRC is invalid
+ */
+bool upipe_ts_psi_check_crc(const uint8_t *section)
+{
+    uint16_t end = psi_get_length(section) + PSI_HEADER_SIZE - PSI_CRC_SIZE;
+    uint32_t crc = upipe_ts_crc32(section, end);
+    return section[end] == (crc >> 24) &&
+           section[end + 1] == ((crc >> 16) & 0xff) &&
+           section[end + 2] == ((crc >> 8) & 0xff) &&
+           section[end + 3] == (crc & 0xff);
+}
+
+/** @This sets the CRC of a PSI section, like psi_set_crc().
+ *
+ * @param section PSI section
+ */
+void upipe_ts_psi_set_crc(uint8_t *section)
+{
+    uint16_t end = psi_get_length(section) + PSI_HEADER_SIZE - PSI_CRC_SIZE;
+    uint32_t crc = upipe_ts_crc32(section, end);
+    section[end] = crc >> 24;
+    section[end + 1] = (crc >> 16) & 0xff;
+    section[end + 2] = (crc >> 8) & 0xff;
+    section[end + 3] = crc & 0xff;
+}
@@ -0,0 +1,35 @@
+/*
+ * CRC-32/MPEG-2 kernels
+ *
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _UPIPE_TS_CRC_H_
+/** @hidden */
+#define _UPIPE_TS_CRC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* update a CRC-32/MPEG-2 (polynomial 0x04c11db7, not reflected) with size
+ * octets; the CRC of a PSI section starts from 0xffffffff */
+uint32_t upipe_ts_crc32_c    (uint32_t crc, const uint8_t *p, uintptr_t size);
+uint32_t upipe_ts_crc32_clmul(uint32_t crc, const uint8_t *p, uintptr_t size);
+uint32_t upipe_ts_crc32_pmull(uint32_t crc, const uint8_t *p, uintptr_t size);
+
+typedef uint32_t (*upipe_ts_crc32_func)(uint32_t crc, const uint8_t *p,
+                                        uintptr_t size);
+
+/* return the fastest kernel supported by the CPU */
+upipe_ts_crc32_func upipe_ts_crc32_select(void);
+
+/* return the CRC-32/MPEG-2 of size octets, with the fastest kernel */
+uint32_t upipe_ts_crc32(const uint8_t *p, uintptr_t size);
+
+/* equivalents of psi_check_crc() and psi_set_crc() from bitstream */
+bool upipe_ts_psi_check_crc(const uint8_t *section);
+void upipe_ts_psi_set_crc(uint8_t *section);
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * CRC-32/MPEG-2 kernel for ARMv8 (PMULL)
+ *
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short CRC-32/MPEG-2 kernel using polynomial multiplications
+ * This is the same folding as the x86 kernel, with the ARMv8 64-bit
+ * polynomial multiply instructions.
+ */
+
+#include "upipe_ts_crc.h"
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#include <arm_neon.h>
+
+/** x^128 mod P */
+#define CRC32_X128 0xe8a45605
+/** x^192 mod P */
+#define CRC32_X192 0xc5b9cd4c
+/** x^512 mod P */
+#define CRC32_X512 0xe6228b11
+/** x^576 mod P */
+#define CRC32_X576 0x8833794c
+
+/** @internal @This reverses the order of 16 octets.
+ *
+ * @param v vector
+ * @return reversed vector
+ */
+__attribute__((target("arch=armv8-a+crypto")))
+static inline uint8x16_t crc32_swap(uint8x16_t v)
+{
+    v = vrev64q_u8(v);
+    return vextq_u8(v, v, 8);
+}
+
+/** @internal @This loads 16 octets as a polynomial, first octet highest.
+ *
+ * @param p buffer
+ * @return polynomial
+ */
+__attribute__((target("arch=armv8-a+crypto")))
+static inline uint64x2_t crc32_load(const uint8_t *p)
+{
+    return vreinterpretq_u64_u8(crc32_swap(vld1q_u8(p)));
+}
+
+/** @internal @This multiplies a polynomial by x^n, modulo P (but without
+ * reducing it to 32 bits).
+ *
+ * @param a polynomial
+ * @param k x^(n + 64) mod P in the high lane, x^n mod P in the low lane
+ * @return polynomial congruent to a * x^n
+ */
+__attribute__((target("arch=armv8-a+crypto")))
+static inline uint64x2_t crc32_fold(uint64x2_t a, poly64x2_t k)
+{
+    poly64x2_t pa = vreinterpretq_p64_u64(a);
+    poly128_t hi = vmull_high_p64(pa, k);
+    poly128_t lo = vmull_p64(vgetq_lane_p64(pa, 0), vgetq_lane_p64(k, 0));
+    return veorq_u64(vreinterpretq_u64_p128(hi), vreinterpretq_u64_p128(lo));
+}
+
+__attribute__((target("arch=armv8-a+crypto")))
+uint32_t upipe_ts_crc32_pmull(uint32_t crc, const uint8_t *p, uintptr_t size)
+{
+    if (size < 32)
+        return upipe_ts_crc32_c(crc, p, size);
+
+    static const uint64_t k1_array[2] = { CRC32_X128, CRC32_X192 };
+    const poly64x2_t k1 = vreinterpretq_p64_u64(vld1q_u64(k1_array));
+    /* the CRC register is xored with the first 4 octets */
+    const uint64_t init_array[2] = { 0, (uint64_t)crc << 32 };
+    const uint64x2_t init = vld1q_u64(init_array);
+    uint64x2_t a;
+
+    if (size >= 128) {
+        static const uint64_t k4_array[2] = { CRC32_X512, CRC32_X576 };
+        const poly64x2_t k4 = vreinterpretq_p64_u64(vld1q_u64(k4_array));
+        uint64x2_t a0 = veorq_u64(crc32_load(p), init);
+        uint64x2_t a1 = crc32_load(p + 16);
+        uint64x2_t a2 = crc32_load(p + 32);
+        uint64x2_t a3 = crc32_load(p + 48);
+        for (p += 64, size -= 64; size >= 64; p += 64, size -= 64) {
+            a0 = veorq_u64(crc32_fold(a0, k4), crc32_load(p));
+            a1 = veorq_u64(crc32_fold(a1, k4), crc32_load(p + 16));
+            a2 = veorq_u64(crc32_fold(a2, k4), crc32_load(p + 32));
+            a3 = veorq_u64(crc32_fold(a3, k4), crc32_load(p + 48));
+        }
+        a = veorq_u64(crc32_fold(a0, k1), a1);
+        a = veorq_u64(crc32_fold(a, k1), a2);
+        a = veorq_u64(crc32_fold(a, k1), a3);
+    } else {
+        a = veorq_u64(crc32_load(p), init);
+        p += 16;
+        size -= 16;
+    }
+
+    for ( ; size >= 16; p += 16, size -= 16)
+        a = veorq_u64(crc32_fold(a, k1), crc32_load(p));
+
+    uint8_t remainder[16];
+    vst1q_u8(remainder, crc32_swap(vreinterpretq_u8_u64(a)));
+    crc = upipe_ts_crc32_c(0, remainder, sizeof(remainder));
+    return upipe_ts_crc32_c(crc, p, size);
+}
+
+#endif
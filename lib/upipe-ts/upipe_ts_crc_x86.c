@@ -0,0 +1,101 @@
+/*
+ * CRC-32/MPEG-2 kernel for x86 (PCLMULQDQ)
+ *
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short CRC-32/MPEG-2 kernel using carry-less multiplications
+ * The buffer is folded 64 then 16 octets at a time with carry-less
+ * multiplications by x^n mod P, into a 16-octet remainder that has the same
+ * CRC as the buffer. The remainder and the last octets are then processed
+ * by the portable kernel.
+ */
+
+#include "upipe_ts_crc.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+/** x^128 mod P */
+#define CRC32_X128 0xe8a45605
+/** x^192 mod P */
+#define CRC32_X192 0xc5b9cd4c
+/** x^512 mod P */
+#define CRC32_X512 0xe6228b11
+/** x^576 mod P */
+#define CRC32_X576 0x8833794c
+
+/** @internal @This loads 16 octets as a polynomial, first octet highest.
+ *
+ * @param p buffer
+ * @return polynomial
+ */
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i crc32_load(const uint8_t *p)
+{
+    const __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                      8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p), swap);
+}
+
+/** @internal @This multiplies a polynomial by x^n, modulo P (but without
+ * reducing it to 32 bits).
+ *
+ * @param a polynomial
+ * @param k x^(n + 64) mod P in the high lane, x^n mod P in the low lane
+ * @return polynomial congruent to a * x^n
+ */
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i crc32_fold(__m128i a, __m128i k)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x11),
+                         _mm_clmulepi64_si128(a, k, 0x00));
+}
+
+__attribute__((target("pclmul,ssse3")))
+uint32_t upipe_ts_crc32_clmul(uint32_t crc, const uint8_t *p, uintptr_t size)
+{
+    if (size < 32)
+        return upipe_ts_crc32_c(crc, p, size);
+
+    const __m128i k1 = _mm_set_epi64x(CRC32_X192, CRC32_X128);
+    /* the CRC register is xored with the first 4 octets */
+    const __m128i init = _mm_set_epi32(crc, 0, 0, 0);
+    __m128i a;
+
+    if (size >= 128) {
+        const __m128i k4 = _mm_set_epi64x(CRC32_X576, CRC32_X512);
+        __m128i a0 = _mm_xor_si128(crc32_load(p), init);
+        __m128i a1 = crc32_load(p + 16);
+        __m128i a2 = crc32_load(p + 32);
+        __m128i a3 = crc32_load(p + 48);
+        for (p += 64, size -= 64; size >= 64; p += 64, size -= 64) {
+            a0 = _mm_xor_si128(crc32_fold(a0, k4), crc32_load(p));
+            a1 = _mm_xor_si128(crc32_fold(a1, k4), crc32_load(p + 16));
+            a2 = _mm_xor_si128(crc32_fold(a2, k4), crc32_load(p + 32));
+            a3 = _mm_xor_si128(crc32_fold(a3, k4), crc32_load(p + 48));
+        }
+        a = _mm_xor_si128(crc32_fold(a0, k1), a1);
+        a = _mm_xor_si128(crc32_fold(a, k1), a2);
+        a = _mm_xor_si128(crc32_fold(a, k1), a3);
+    } else {
+        a = _mm_xor_si128(crc32_load(p), init);
+        p += 16;
+        size -= 16;
+    }
+
+    for ( ; size >= 16; p += 16, size -= 16)
+        a = _mm_xor_si128(crc32_fold(a, k1), crc32_load(p));
+
+    const __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                      8, 9, 10, 11, 12, 13, 14, 15);
+    uint8_t remainder[16];
+    _mm_storeu_si128((__m128i *)remainder, _mm_shuffle_epi8(a, swap));
+    crc = upipe_ts_crc32_c(0, remainder, sizeof(remainder));
+    return upipe_ts_crc32_c(crc, p, size);
+}
+
+#endif
@@ -91,14 +91,19 @@ static struct upipe *upipe_ts_decaps_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-/** @internal @This parses and removes the TS header of a packet.
+/** @internal @This parses and removes the TS header of a packet, and
+ * appends its payload to the list of urefs to output. The list is flushed
+ * before a clock reference is thrown, so that the packets preceding the
+ * PCR are processed downstream with the previous reference.
  *
  * @param upipe description structure of the pipe
  * @param uref uref structure
+ * @param urefs list of urefs to output
  * @param upump_p reference to pump that generated the buffer
  */
-static void upipe_ts_decaps_input(struct upipe *upipe, struct uref *uref,
-                                  struct upump **upump_p)
+static void upipe_ts_decaps_work(struct upipe *upipe, struct uref *uref,
+                                 struct uchain *urefs,
+                                 struct upump **upump_p)
 {
     struct upipe_ts_decaps *upipe_ts_decaps = upipe_ts_decaps_from_upipe(upipe);
     uint8_t buffer[TS_HEADER_SIZE_PCR];
@@ -162,6 +167,7 @@ static void upipe_ts_decaps_input(struct upipe *upipe, struct uref *uref,
                 pcrval *= UCLOCK_FREQ / 27000000;
                 UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 2, af_pcr, pcr))
 
+                upipe_ts_decaps_output_chain(upipe, urefs, upump_p);
                 uref_clock_set_ref(uref);
                 upipe_throw_clock_ref(upipe, uref, pcrval,
                                       discontinuity ? 1 : 0);
@@ -214,7 +220,224 @@ static void upipe_ts_decaps_input(struct upipe *upipe, struct uref *uref,
 
     uref_free(upipe_ts_decaps->last_uref);
     upipe_ts_decaps->last_uref = uref_dup(uref);
-    upipe_ts_decaps_output(upipe, uref, upump_p);
+    ulist_add(urefs, uref_to_uchain(uref));
+}
+
+/** @internal @This sets the payload of the last TS packet, used to detect
+ * duplicates, from a packet of a run walked in place.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure of the run
+ * @param payload offset of the payload of the packet in the run
+ */
+static void upipe_ts_decaps_set_last(struct upipe *upipe, struct uref *uref,
+                                     size_t payload)
+{
+    struct upipe_ts_decaps *upipe_ts_decaps = upipe_ts_decaps_from_upipe(upipe);
+    uref_free(upipe_ts_decaps->last_uref);
+    upipe_ts_decaps->last_uref = uref_block_splice(uref, payload,
+                                                   TS_SIZE - payload % TS_SIZE);
+}
+
+/** @internal @This walks a run of TS packets of the same PID, as output by
+ * ts_split in vector mode, in place. The payloads of consecutive packets are
+ * merged into a single uref, unless a packet starts a unit, is a random
+ * access point or is discontinuous. The rare packets carrying a PCR or a
+ * transport error, or which may be duplicates, are cut from the run and
+ * handed to @ref upipe_ts_decaps_work.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param size size of the run
+ * @param urefs list of urefs to output
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_decaps_work_vector(struct upipe *upipe, struct uref *uref,
+                                        size_t size, struct uchain *urefs,
+                                        struct upump **upump_p)
+{
+    struct upipe_ts_decaps *upipe_ts_decaps = upipe_ts_decaps_from_upipe(upipe);
+    if (unlikely(size % TS_SIZE)) {
+        upipe_warn_va(upipe, "dropping %zu trailing octets", size % TS_SIZE);
+        size -= size % TS_SIZE;
+    }
+
+    /* payloads of the packets merged so far */
+    struct uref *output = NULL;
+    /* payload of the last packet walked in place, or 0 */
+    size_t last_payload = 0;
+    for (size_t offset = 0; offset < size; offset += TS_SIZE) {
+        uint8_t buffer[TS_HEADER_SIZE_AF];
+        const uint8_t *ts_header = uref_block_peek(uref, offset,
+                                                   TS_HEADER_SIZE, buffer);
+        if (unlikely(ts_header == NULL))
+            goto upipe_ts_decaps_work_vector_err;
+        bool transporterror = ts_get_transporterror(ts_header);
+        bool unitstart = ts_get_unitstart(ts_header);
+        uint8_t cc = ts_get_cc(ts_header);
+        bool has_payload = ts_has_payload(ts_header);
+        bool has_adaptation = ts_has_adaptation(ts_header);
+        UBASE_FATAL(upipe, uref_block_peek_unmap(uref, offset, buffer,
+                                                 ts_header))
+
+        uint8_t af_length = 0;
+        if (unlikely(has_adaptation)) {
+            /* adaptation field length and flags */
+            uint8_t *af = buffer + TS_HEADER_SIZE;
+            if (unlikely(!ubase_check(uref_block_extract(uref,
+                                offset + TS_HEADER_SIZE, 2, af))))
+                goto upipe_ts_decaps_work_vector_err;
+            af_length = af[0];
+        }
+
+        if (unlikely(transporterror ||
+                     (af_length && tsaf_has_pcr(buffer)) ||
+                     ts_check_duplicate(cc, upipe_ts_decaps->last_cc))) {
+            if (output != NULL) {
+                ulist_add(urefs, uref_to_uchain(output));
+                output = NULL;
+            }
+            if (last_payload) {
+                upipe_ts_decaps_set_last(upipe, uref, last_payload);
+                last_payload = 0;
+            }
+            struct uref *packet = uref_block_splice(uref, offset, TS_SIZE);
+            if (unlikely(packet == NULL))
+                goto upipe_ts_decaps_work_vector_err;
+            upipe_ts_decaps_work(upipe, packet, urefs, upump_p);
+            continue;
+        }
+
+        bool discontinuity = upipe_ts_decaps->last_cc == -1;
+        bool random = false;
+        size_t payload = offset + TS_HEADER_SIZE;
+        if (unlikely(has_adaptation)) {
+            if (unlikely((!has_payload && af_length != 183) ||
+                         af_length > 183)) {
+                upipe_warn(upipe, "invalid adaptation field received");
+                continue;
+            }
+            if (af_length) {
+                if (unlikely(!discontinuity &&
+                             tsaf_has_discontinuity(buffer))) {
+                    upipe_warn(upipe, "discontinuity flagged");
+                    discontinuity = true;
+                }
+                random = tsaf_has_randomaccess(buffer);
+            }
+            payload += af_length + 1;
+        }
+
+        if (unlikely(!discontinuity &&
+                     ts_check_discontinuity(cc, upipe_ts_decaps->last_cc))) {
+            int lost = (0x10 + cc - upipe_ts_decaps->last_cc - 1) & 0xf;
+            upipe_ts_decaps->lost += lost;
+            upipe_warn_va(upipe, "potentially lost %d packets", lost);
+            discontinuity = true;
+        }
+        upipe_ts_decaps->last_cc = cc;
+
+        if (unlikely(!has_payload))
+            continue;
+        last_payload = payload;
+
+        if (output != NULL && likely(!unitstart && !discontinuity && !random)) {
+            struct ubuf *ubuf = ubuf_block_splice(uref->ubuf, payload,
+                                                  offset + TS_SIZE - payload);
+            if (unlikely(ubuf == NULL))
+                goto upipe_ts_decaps_work_vector_err;
+            if (unlikely(!ubase_check(uref_block_append(output, ubuf)))) {
+                ubuf_free(ubuf);
+                goto upipe_ts_decaps_work_vector_err;
+            }
+            continue;
+        }
+
+        if (output != NULL)
+            ulist_add(urefs, uref_to_uchain(output));
+        output = uref_block_splice(uref, payload, offset + TS_SIZE - payload);
+        if (unlikely(output == NULL))
+            goto upipe_ts_decaps_work_vector_err;
+        if (unlikely(discontinuity))
+            uref_flow_set_discontinuity(output);
+        if (unlikely(random))
+            uref_flow_set_random(output);
+        if (unlikely(unitstart))
+            uref_block_set_start(output);
+    }
+
+    if (output != NULL)
+        ulist_add(urefs, uref_to_uchain(output));
+    if (last_payload)
+        upipe_ts_decaps_set_last(upipe, uref, last_payload);
+    uref_free(uref);
+    return;
+
+upipe_ts_decaps_work_vector_err:
+    uref_free(output);
+    uref_free(uref);
+    upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+}
+
+/** @internal @This parses a TS packet, or a run of TS packets of the same
+ * PID as output by ts_split in vector mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param urefs list of urefs to output
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_decaps_parse(struct upipe *upipe, struct uref *uref,
+                                  struct uchain *urefs,
+                                  struct upump **upump_p)
+{
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    if (unlikely(size > TS_SIZE))
+        upipe_ts_decaps_work_vector(upipe, uref, size, urefs, upump_p);
+    else
+        upipe_ts_decaps_work(upipe, uref, urefs, upump_p);
+}
+
+/** @internal @This receives a TS packet, or a run of TS packets of the same
+ * PID. The payloads of a run are output as a single chain.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_decaps_input(struct upipe *upipe, struct uref *uref,
+                                  struct upump **upump_p)
+{
+    struct uchain urefs;
+    ulist_init(&urefs);
+    upipe_ts_decaps_parse(upipe, uref, &urefs, upump_p);
+    upipe_ts_decaps_output_chain(upipe, &urefs, upump_p);
+}
+
+/** @internal @This receives a list of TS packets, and outputs their
+ * payloads as a single chain.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_ts_decaps_input_chain(struct upipe *upipe,
+                                        struct uchain *urefs,
+                                        struct upump **upump_p)
+{
+    struct uchain outputs;
+    ulist_init(&outputs);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(urefs)) != NULL)
+        upipe_ts_decaps_parse(upipe, uref_from_uchain(uchain), &outputs,
+                              upump_p);
+    upipe_ts_decaps_output_chain(upipe, &outputs, upump_p);
 }
 
 /** @internal @This sets the input flow definition.
@@ -296,6 +519,7 @@ static struct upipe_mgr upipe_ts_decaps_mgr = {
 
     .upipe_alloc = upipe_ts_decaps_alloc,
     .upipe_input = upipe_ts_decaps_input,
+    .upipe_input_chain = upipe_ts_decaps_input_chain,
     .upipe_control = upipe_ts_decaps_control,
 
     .upipe_mgr_control = NULL
@@ -285,6 +285,8 @@ struct upipe_ts_demux {
     bool eits_enabled;
     /** maximum allowed interval between PCRs */
     uint64_t max_pcr_interval;
+    /** maximum number of TS packets per uref output by ts_sync */
+    unsigned int vector;
 
     /** probe to get new flow events from inner pipes created by psi_pid
      * objects */
@@ -1324,6 +1326,7 @@ static void upipe_ts_demux_program_init_output_mgr(struct upipe *upipe)
     struct upipe_ts_demux_program *program =
         upipe_ts_demux_program_from_upipe(upipe);
     struct upipe_mgr *output_mgr = &program->output_mgr;
+    upipe_mgr_init(output_mgr);
     output_mgr->refcount = upipe_ts_demux_program_to_urefcount_real(program);
     output_mgr->signature = UPIPE_TS_DEMUX_OUTPUT_SIGNATURE;
     output_mgr->upipe_alloc = upipe_ts_demux_output_alloc;
@@ -2525,6 +2528,7 @@ static void upipe_ts_demux_init_program_mgr(struct upipe *upipe)
 {
     struct upipe_ts_demux *upipe_ts_demux = upipe_ts_demux_from_upipe(upipe);
     struct upipe_mgr *program_mgr = &upipe_ts_demux->program_mgr;
+    upipe_mgr_init(program_mgr);
     program_mgr->refcount = upipe_ts_demux_to_urefcount_real(upipe_ts_demux);
     program_mgr->signature = UPIPE_TS_DEMUX_PROGRAM_SIGNATURE;
     program_mgr->upipe_alloc = upipe_ts_demux_program_alloc;
@@ -3400,6 +3404,7 @@ static void upipe_ts_demux_init_emm_mgr(struct upipe *upipe)
 {
     struct upipe_ts_demux *upipe_ts_demux = upipe_ts_demux_from_upipe(upipe);
     struct upipe_mgr *emm_mgr = &upipe_ts_demux->emm_mgr;
+    upipe_mgr_init(emm_mgr);
     emm_mgr->refcount = upipe_ts_demux_to_urefcount_real(upipe_ts_demux);
     emm_mgr->signature = UPIPE_TS_DEMUX_EMM_SIGNATURE;
     emm_mgr->upipe_alloc = upipe_ts_demux_emm_alloc;
@@ -3696,6 +3701,7 @@ static struct upipe *upipe_ts_demux_alloc(struct upipe_mgr *mgr,
     upipe_ts_demux->eit_enabled = true;
     upipe_ts_demux->eits_enabled = true;
     upipe_ts_demux->max_pcr_interval = MAX_PCR_INTERVAL;
+    upipe_ts_demux->vector = 1;
     upipe_ts_demux->nit_pid = 0;
     upipe_ts_demux->flow_def_input = NULL;
 
@@ -3869,12 +3875,15 @@ static int upipe_ts_demux_set_flow_def(struct upipe *upipe,
                      uprobe_pfx_alloc(
                          uprobe_use(&upipe_ts_demux->proxy_probe),
                          UPROBE_LOG_VERBOSE, "check"));
-        else
+        else {
             /* allocate ts_sync inner pipe */
             input = upipe_void_alloc(ts_demux_mgr->ts_sync_mgr,
                      uprobe_pfx_alloc(
                          uprobe_use(&upipe_ts_demux->proxy_probe),
                          UPROBE_LOG_VERBOSE, "sync"));
+            if (likely(input != NULL) && upipe_ts_demux->vector > 1)
+                upipe_ts_sync_set_vector(input, upipe_ts_demux->vector);
+        }
         if (unlikely(input == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             return UBASE_ERR_ALLOC;
@@ -4026,6 +4035,26 @@ static int _upipe_ts_demux_get_max_pcr_interval(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the maximum number of TS packets per uref output by
+ * the inner ts_sync pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param vector maximum number of packets
+ * @return an error code
+ */
+static int _upipe_ts_demux_set_vector(struct upipe *upipe, unsigned int vector)
+{
+    struct upipe_ts_demux *demux = upipe_ts_demux_from_upipe(upipe);
+    struct upipe_ts_demux_mgr *ts_demux_mgr =
+        upipe_ts_demux_mgr_from_upipe_mgr(upipe->mgr);
+    if (vector < 1)
+        return UBASE_ERR_INVALID;
+    if (demux->input != NULL && demux->input->mgr == ts_demux_mgr->ts_sync_mgr)
+        UBASE_RETURN(upipe_ts_sync_set_vector(demux->input, vector))
+    demux->vector = vector;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a ts_demux pipe.
  *
  * @param upipe description structure of the pipe
@@ -4113,6 +4142,11 @@ static int upipe_ts_demux_control(struct upipe *upipe,
             uint64_t *max = va_arg(args, uint64_t *);
             return _upipe_ts_demux_get_max_pcr_interval(upipe, max);
         }
+        case UPIPE_TS_DEMUX_SET_VECTOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_DEMUX_SIGNATURE);
+            unsigned int vector = va_arg(args, unsigned int);
+            return _upipe_ts_demux_set_vector(upipe, vector);
+        }
 
         default:
             break;
@@ -4388,10 +4422,12 @@ struct upipe_mgr *upipe_ts_demux_mgr_alloc(void)
 
     urefcount_init(upipe_ts_demux_mgr_to_urefcount(ts_demux_mgr),
                    upipe_ts_demux_mgr_free);
+    upipe_mgr_init(&ts_demux_mgr->mgr);
     ts_demux_mgr->mgr.refcount = upipe_ts_demux_mgr_to_urefcount(ts_demux_mgr);
     ts_demux_mgr->mgr.signature = UPIPE_TS_DEMUX_SIGNATURE;
     ts_demux_mgr->mgr.upipe_alloc = upipe_ts_demux_alloc;
     ts_demux_mgr->mgr.upipe_input = upipe_ts_demux_bin_input;
+    ts_demux_mgr->mgr.upipe_input_chain = upipe_ts_demux_bin_input_chain;
     ts_demux_mgr->mgr.upipe_control = upipe_ts_demux_control;
     ts_demux_mgr->mgr.upipe_mgr_control = upipe_ts_demux_mgr_control;
     return upipe_ts_demux_mgr_to_upipe_mgr(ts_demux_mgr);
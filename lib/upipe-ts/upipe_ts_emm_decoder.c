@@ -28,6 +28,7 @@
 #include "upipe-ts/upipe_ts_emm_decoder.h"
 #include "upipe-ts/uref_ts_flow.h"
 #include "upipe_ts_psi_decoder.h"
+#include "upipe_ts_crc.h"
 
 #include <bitstream/ebu/biss.h>
 
@@ -235,7 +236,7 @@ static bool upipe_ts_emmd_table_validate(struct upipe *upipe)
                                                   &section))))
             return false;
 
-        if (!bissca_emm_validate(section) || !psi_check_crc(section)) {
+        if (!bissca_emm_validate(section) || !upipe_ts_psi_check_crc(section)) {
             uref_block_unmap(section_uref, 0);
             return false;
         }
@@ -1050,7 +1051,7 @@ static bool upipe_ts_emmd_ecm_table_validate(struct upipe *upipe)
                                                   &section))))
             return false;
 
-        if (/*!ecm_validate(section) || */!psi_check_crc(section)) {
+        if (/*!ecm_validate(section) || */!upipe_ts_psi_check_crc(section)) {
             uref_block_unmap(section_uref, 0);
             return false;
         }
@@ -1288,6 +1289,7 @@ static void upipe_ts_emmd_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_ts_emmd *upipe_ts_emmd = upipe_ts_emmd_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_ts_emmd->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_ts_emmd_to_urefcount(upipe_ts_emmd);
     sub_mgr->signature = UPIPE_TS_EMMD_ECM_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_ts_emmd_ecm_alloc;
@@ -211,6 +211,21 @@ static int upipe_ts_mux_check(struct upipe *upipe, struct uref *unused);
 
 /** @hidden */
 struct upipe_ts_mux_psi_pid;
+/** @hidden */
+struct upipe_ts_mux_input;
+
+/** @internal @This defines the keys of the heaps used to schedule inputs. */
+enum upipe_ts_mux_heap {
+    /** by cr_sys */
+    UPIPE_TS_MUX_HEAP_CR,
+    /** by dts_sys */
+    UPIPE_TS_MUX_HEAP_DTS,
+    /** by pcr_sys */
+    UPIPE_TS_MUX_HEAP_PCR,
+
+    /** number of heaps */
+    UPIPE_TS_MUX_HEAP_MAX
+};
 
 /** @internal @This is the private context of a ts_mux pipe. */
 struct upipe_ts_mux {
@@ -371,6 +386,22 @@ struct upipe_ts_mux {
 
     /** list of programs */
     struct uchain programs;
+    /** last attributed program rank */
+    uint32_t program_rank;
+
+    /** heaps of inputs, respectively by cr_sys, dts_sys and pcr_sys */
+    struct upipe_ts_mux_input **heaps[UPIPE_TS_MUX_HEAP_MAX];
+    /** number of inputs in the heaps */
+    unsigned int heap_count;
+    /** allocated size of the heaps */
+    unsigned int heap_size;
+    /** candidate inputs for splice, by increasing rank */
+    struct upipe_ts_mux_input **candidates;
+    /** list of inputs that are not ready, by increasing rank */
+    struct uchain not_ready;
+    /** true if the inputs are scheduled by walking the lists of programs
+     * and inputs instead of the heaps */
+    bool linear_scheduler;
 
     /** manager to create programs */
     struct upipe_mgr program_mgr;
@@ -468,6 +499,10 @@ struct upipe_ts_mux_program {
     struct uref *flow_def_input;
     /** list of inputs */
     struct uchain inputs;
+    /** rank of the program in the list of programs */
+    uint32_t rank;
+    /** last attributed input rank */
+    uint32_t input_rank;
 
     /** manager to create inputs */
     struct upipe_mgr input_mgr;
@@ -526,6 +561,12 @@ struct upipe_ts_mux_input {
     struct uchain uchain;
     /** structure for double-linked lists for PSI inputs */
     struct uchain uchain_psi;
+    /** structure for double-linked lists for inputs that are not ready */
+    struct uchain uchain_not_ready;
+    /** rank of the input in the lists of programs and inputs */
+    uint64_t rank;
+    /** position of the input in the heaps */
+    unsigned int heap_index[UPIPE_TS_MUX_HEAP_MAX];
 
     /** input flow def */
     struct uref *input_flow_def;
@@ -601,6 +642,7 @@ UPIPE_HELPER_BIN_INPUT(upipe_ts_mux_input, input, input_request_list)
 
 UBASE_FROM_TO(upipe_ts_mux_input, urefcount, urefcount_real, urefcount_real)
 UBASE_FROM_TO(upipe_ts_mux_input, uchain, uchain_psi, uchain_psi)
+UBASE_FROM_TO(upipe_ts_mux_input, uchain, uchain_not_ready, uchain_not_ready)
 
 UPIPE_HELPER_SUBPIPE(upipe_ts_mux_program, upipe_ts_mux_input, input,
                      input_mgr, inputs, uchain)
@@ -945,6 +987,257 @@ static int upipe_ts_mux_input_probe(struct uprobe *uprobe, struct upipe *inner,
     return upipe_throw_proxy(upipe, inner, event, args);
 }
 
+/** @internal @This returns the key of an input in the given heap.
+ *
+ * @param input pointer to input
+ * @param heap heap type
+ * @return the date used to sort the heap
+ */
+static inline uint64_t upipe_ts_mux_input_heap_key(
+        struct upipe_ts_mux_input *input, enum upipe_ts_mux_heap heap)
+{
+    switch (heap) {
+        case UPIPE_TS_MUX_HEAP_CR:
+            return input->cr_sys;
+        case UPIPE_TS_MUX_HEAP_DTS:
+            return input->dts_sys;
+        default:
+            return input->pcr_sys;
+    }
+}
+
+/** @internal @This compares two inputs in the given heap. Inputs with the
+ * same date are sorted in the order of the lists of programs and inputs,
+ * so that the heaps select the same inputs as a linear walk of the lists.
+ *
+ * @param input1 pointer to first input
+ * @param input2 pointer to second input
+ * @param heap heap type
+ * @return true if input1 must be scheduled before input2
+ */
+static inline bool upipe_ts_mux_input_heap_before(
+        struct upipe_ts_mux_input *input1, struct upipe_ts_mux_input *input2,
+        enum upipe_ts_mux_heap heap)
+{
+    uint64_t key1 = upipe_ts_mux_input_heap_key(input1, heap);
+    uint64_t key2 = upipe_ts_mux_input_heap_key(input2, heap);
+    if (key1 != key2)
+        return key1 < key2;
+    return input1->rank < input2->rank;
+}
+
+/** @internal @This stores an input at the given position of a heap.
+ *
+ * @param mux pointer to ts_mux
+ * @param heap heap type
+ * @param index position in the heap
+ * @param input pointer to input
+ */
+static inline void upipe_ts_mux_heap_set(struct upipe_ts_mux *mux,
+                                         enum upipe_ts_mux_heap heap,
+                                         unsigned int index,
+                                         struct upipe_ts_mux_input *input)
+{
+    mux->heaps[heap][index] = input;
+    input->heap_index[heap] = index;
+}
+
+/** @internal @This moves an input up or down a heap after its key changed.
+ *
+ * @param mux pointer to ts_mux
+ * @param heap heap type
+ * @param index position of the input in the heap
+ */
+static void upipe_ts_mux_heap_sift(struct upipe_ts_mux *mux,
+                                   enum upipe_ts_mux_heap heap,
+                                   unsigned int index)
+{
+    struct upipe_ts_mux_input **heap_array = mux->heaps[heap];
+    struct upipe_ts_mux_input *input = heap_array[index];
+
+    while (index > 0) {
+        unsigned int parent = (index - 1) / 2;
+        if (!upipe_ts_mux_input_heap_before(input, heap_array[parent], heap))
+            break;
+        upipe_ts_mux_heap_set(mux, heap, index, heap_array[parent]);
+        index = parent;
+    }
+
+    for ( ; ; ) {
+        unsigned int child = 2 * index + 1;
+        if (child >= mux->heap_count)
+            break;
+        if (child + 1 < mux->heap_count &&
+            upipe_ts_mux_input_heap_before(heap_array[child + 1],
+                                           heap_array[child], heap))
+            child++;
+        if (!upipe_ts_mux_input_heap_before(heap_array[child], input, heap))
+            break;
+        upipe_ts_mux_heap_set(mux, heap, index, heap_array[child]);
+        index = child;
+    }
+
+    upipe_ts_mux_heap_set(mux, heap, index, input);
+}
+
+/** @internal @This inserts an input into the heaps.
+ *
+ * @param mux pointer to ts_mux
+ * @param input pointer to input
+ * @return an error code
+ */
+static int upipe_ts_mux_heap_insert(struct upipe_ts_mux *mux,
+                                    struct upipe_ts_mux_input *input)
+{
+    if (mux->heap_count >= mux->heap_size) {
+        unsigned int heap_size = mux->heap_size ? mux->heap_size * 2 : 16;
+        for (int heap = 0; heap < UPIPE_TS_MUX_HEAP_MAX; heap++) {
+            struct upipe_ts_mux_input **heap_array =
+                realloc(mux->heaps[heap], heap_size * sizeof(*heap_array));
+            UBASE_ALLOC_RETURN(heap_array);
+            mux->heaps[heap] = heap_array;
+        }
+        struct upipe_ts_mux_input **candidates =
+            realloc(mux->candidates, heap_size * sizeof(*candidates));
+        UBASE_ALLOC_RETURN(candidates);
+        mux->candidates = candidates;
+        mux->heap_size = heap_size;
+    }
+
+    unsigned int index = mux->heap_count++;
+    for (int heap = 0; heap < UPIPE_TS_MUX_HEAP_MAX; heap++) {
+        upipe_ts_mux_heap_set(mux, heap, index, input);
+        upipe_ts_mux_heap_sift(mux, heap, index);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This removes an input from the heaps.
+ *
+ * @param mux pointer to ts_mux
+ * @param input pointer to input
+ */
+static void upipe_ts_mux_heap_remove(struct upipe_ts_mux *mux,
+                                     struct upipe_ts_mux_input *input)
+{
+    if (input->heap_index[UPIPE_TS_MUX_HEAP_CR] == UINT_MAX)
+        return;
+
+    unsigned int last = --mux->heap_count;
+    for (int heap = 0; heap < UPIPE_TS_MUX_HEAP_MAX; heap++) {
+        unsigned int index = input->heap_index[heap];
+        input->heap_index[heap] = UINT_MAX;
+        if (index == last)
+            continue;
+        upipe_ts_mux_heap_set(mux, heap, index, mux->heaps[heap][last]);
+        upipe_ts_mux_heap_sift(mux, heap, index);
+    }
+}
+
+/** @internal @This restores the heaps after the dates of an input changed.
+ *
+ * @param mux pointer to ts_mux
+ * @param input pointer to input
+ */
+static void upipe_ts_mux_heap_update(struct upipe_ts_mux *mux,
+                                     struct upipe_ts_mux_input *input)
+{
+    if (input->heap_index[UPIPE_TS_MUX_HEAP_CR] == UINT_MAX)
+        return;
+
+    for (int heap = 0; heap < UPIPE_TS_MUX_HEAP_MAX; heap++)
+        upipe_ts_mux_heap_sift(mux, heap, input->heap_index[heap]);
+}
+
+/** @internal @This adds an input to the candidates for splice, keeping them
+ * sorted by rank and ignoring duplicates.
+ *
+ * @param mux pointer to ts_mux
+ * @param input pointer to input
+ * @param nb_p number of candidates, incremented if the input is added
+ */
+static void upipe_ts_mux_add_candidate(struct upipe_ts_mux *mux,
+                                       struct upipe_ts_mux_input *input,
+                                       unsigned int *nb_p)
+{
+    unsigned int index = *nb_p;
+    while (index > 0 && mux->candidates[index - 1]->rank >= input->rank) {
+        if (mux->candidates[index - 1] == input)
+            return;
+        index--;
+    }
+    memmove(&mux->candidates[index + 1], &mux->candidates[index],
+            (*nb_p - index) * sizeof(*mux->candidates));
+    mux->candidates[index] = input;
+    (*nb_p)++;
+}
+
+/** @internal @This collects the candidates for splice whose key in the
+ * given heap is lower than or equal to a date.
+ *
+ * @param mux pointer to ts_mux
+ * @param heap heap type
+ * @param index position in the heap to start from
+ * @param date maximum date
+ * @param nb_p number of candidates
+ */
+static void upipe_ts_mux_heap_collect(struct upipe_ts_mux *mux,
+                                      enum upipe_ts_mux_heap heap,
+                                      unsigned int index, uint64_t date,
+                                      unsigned int *nb_p)
+{
+    if (index >= mux->heap_count)
+        return;
+    struct upipe_ts_mux_input *input = mux->heaps[heap][index];
+    if (upipe_ts_mux_input_heap_key(input, heap) > date)
+        return;
+
+    upipe_ts_mux_add_candidate(mux, input, nb_p);
+    upipe_ts_mux_heap_collect(mux, heap, 2 * index + 1, date, nb_p);
+    upipe_ts_mux_heap_collect(mux, heap, 2 * index + 2, date, nb_p);
+}
+
+/** @internal @This sorts the inputs that are not ready by rank.
+ *
+ * @param uchain1 pointer to first input
+ * @param uchain2 pointer to second input
+ * @return an integer less than, equal to, or greater than zero if the first
+ * argument is considered to be respectively less than, equal to, or greater
+ * than the second.
+ */
+static int upipe_ts_mux_input_compare_rank(struct uchain *uchain1,
+                                           struct uchain *uchain2)
+{
+    struct upipe_ts_mux_input *input1 =
+        upipe_ts_mux_input_from_uchain_not_ready(uchain1);
+    struct upipe_ts_mux_input *input2 =
+        upipe_ts_mux_input_from_uchain_not_ready(uchain2);
+    if (input1->rank < input2->rank)
+        return -1;
+    return input1->rank > input2->rank ? 1 : 0;
+}
+
+/** @internal @This sets the ready flag of an input, and maintains the list of
+ * inputs that are not ready.
+ *
+ * @param mux pointer to ts_mux
+ * @param input pointer to input
+ * @param ready true if the input is ready to output packets
+ */
+static void upipe_ts_mux_input_set_ready(struct upipe_ts_mux *mux,
+                                         struct upipe_ts_mux_input *input,
+                                         bool ready)
+{
+    struct uchain *uchain = upipe_ts_mux_input_to_uchain_not_ready(input);
+    input->ready = ready;
+    if (ready) {
+        if (ulist_is_in(uchain))
+            ulist_delete(uchain);
+    } else if (!ulist_is_in(uchain))
+        ulist_bubble_reverse(&mux->not_ready, uchain,
+                             upipe_ts_mux_input_compare_rank);
+}
+
 /** @internal @This catches the events from encaps inner pipes.
  *
  * @param uprobe pointer to the probe in upipe_ts_mux_input
@@ -968,10 +1261,16 @@ static int upipe_ts_mux_input_encaps_probe(struct uprobe *uprobe,
 
     UBASE_SIGNATURE_CHECK(args, UPIPE_TS_ENCAPS_SIGNATURE)
 
+    struct upipe_ts_mux_program *program =
+        upipe_ts_mux_program_from_input_mgr(upipe->mgr);
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_program_mgr(
+                upipe_ts_mux_program_to_upipe(program)->mgr);
     upipe_ts_mux_input->cr_sys = va_arg(args, uint64_t);
     upipe_ts_mux_input->dts_sys = va_arg(args, uint64_t);
     upipe_ts_mux_input->pcr_sys = va_arg(args, uint64_t);
-    upipe_ts_mux_input->ready = !!va_arg(args, int);
+    upipe_ts_mux_heap_update(mux, upipe_ts_mux_input);
+    upipe_ts_mux_input_set_ready(mux, upipe_ts_mux_input,
+                                 !!va_arg(args, int));
     return UBASE_ERR_NONE;
 }
 
@@ -1006,6 +1305,11 @@ static struct upipe *upipe_ts_mux_input_alloc(struct upipe_mgr *mgr,
     upipe_ts_mux_input_init_flow_def(upipe);
     upipe_ts_mux_input_init_bin_input(upipe);
     uchain_init(upipe_ts_mux_input_to_uchain_psi(upipe_ts_mux_input));
+    uchain_init(upipe_ts_mux_input_to_uchain_not_ready(upipe_ts_mux_input));
+    upipe_ts_mux_input->rank = ((uint64_t)program->rank << 32) |
+                               ++program->input_rank;
+    for (int heap = 0; heap < UPIPE_TS_MUX_HEAP_MAX; heap++)
+        upipe_ts_mux_input->heap_index[heap] = UINT_MAX;
     upipe_ts_mux_input->pcr = false;
     upipe_ts_mux_input->deleted = false;
     upipe_ts_mux_input->input_type = UPIPE_TS_MUX_INPUT_UNKNOWN;
@@ -1039,6 +1343,17 @@ static struct upipe *upipe_ts_mux_input_alloc(struct upipe_mgr *mgr,
         upipe_ts_mux_input_to_urefcount_real(upipe_ts_mux_input);
     upipe_throw_ready(upipe);
 
+    upipe_ts_mux_input_set_ready(upipe_ts_mux, upipe_ts_mux_input, false);
+    if (unlikely(!ubase_check(upipe_ts_mux_heap_insert(upipe_ts_mux,
+                                                       upipe_ts_mux_input)))) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        /* no inner pipe was allocated yet */
+        upipe_ts_mux_input_clean_bin_input(upipe);
+        urefcount_release(
+                upipe_ts_mux_input_to_urefcount_real(upipe_ts_mux_input));
+        return NULL;
+    }
+
     struct upipe_ts_mux_mgr *ts_mux_mgr =
         upipe_ts_mux_mgr_from_upipe_mgr(upipe_ts_mux_to_upipe(upipe_ts_mux)->mgr);
     if (unlikely((upipe_ts_mux_input->tstd =
@@ -1089,6 +1404,28 @@ static void upipe_ts_mux_input_input(struct upipe *upipe, struct uref *uref,
     upipe_ts_mux_work(upipe_ts_mux_to_upipe(upipe_ts_mux), upump_p);
 }
 
+/** @internal @This receives a list of urefs, and runs the muxing work once
+ * for the whole list.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_ts_mux_input_input_chain(struct upipe *upipe,
+                                           struct uchain *urefs,
+                                           struct upump **upump_p)
+{
+    struct upipe_ts_mux_program *program =
+        upipe_ts_mux_program_from_input_mgr(upipe->mgr);
+    struct upipe_ts_mux *upipe_ts_mux = upipe_ts_mux_from_program_mgr(
+                upipe_ts_mux_program_to_upipe(program)->mgr);
+
+    upipe_ts_mux_input_bin_input_chain(upipe, urefs,
+            upipe_ts_mux->live ? NULL : upump_p);
+
+    upipe_ts_mux_work(upipe_ts_mux_to_upipe(upipe_ts_mux), upump_p);
+}
+
 /** @internal @This sets the input flow definition.
  *
  * @param upipe description structure of the pipe
@@ -1382,7 +1719,8 @@ static int upipe_ts_mux_input_set_flow_def(struct upipe *upipe,
         input->cr_sys = UINT64_MAX;
         input->dts_sys = UINT64_MAX;
         input->pcr_sys = UINT64_MAX;
-        input->ready = false;
+        upipe_ts_mux_heap_update(upipe_ts_mux, input);
+        upipe_ts_mux_input_set_ready(upipe_ts_mux, input, false);
         if (!ulist_is_in(upipe_ts_mux_input_to_uchain_psi(input)))
             ulist_add(&upipe_ts_mux->psi_inputs,
                       upipe_ts_mux_input_to_uchain_psi(input));
@@ -1828,7 +2166,14 @@ static void upipe_ts_mux_input_free(struct urefcount *urefcount_real)
     struct upipe *upipe = upipe_ts_mux_input_to_upipe(upipe_ts_mux_input);
     struct upipe_ts_mux_program *program =
         upipe_ts_mux_program_from_input_mgr(upipe->mgr);
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_program_mgr(
+                upipe_ts_mux_program_to_upipe(program)->mgr);
 
+    struct uchain *uchain_not_ready =
+        upipe_ts_mux_input_to_uchain_not_ready(upipe_ts_mux_input);
+    if (ulist_is_in(uchain_not_ready))
+        ulist_delete(uchain_not_ready);
+    upipe_ts_mux_heap_remove(mux, upipe_ts_mux_input);
     upipe_ts_mux_input_clean_sub(upipe);
     if (!upipe_single(upipe_ts_mux_program_to_upipe(program)))
         upipe_ts_mux_program_change(upipe_ts_mux_program_to_upipe(program));
@@ -1892,10 +2237,12 @@ static void upipe_ts_mux_program_init_input_mgr(struct upipe *upipe)
     struct upipe_ts_mux_program *program =
         upipe_ts_mux_program_from_upipe(upipe);
     struct upipe_mgr *input_mgr = &program->input_mgr;
+    upipe_mgr_init(input_mgr);
     input_mgr->refcount = upipe_ts_mux_program_to_urefcount(program);
     input_mgr->signature = UPIPE_TS_MUX_INPUT_SIGNATURE;
     input_mgr->upipe_alloc = upipe_ts_mux_input_alloc;
     input_mgr->upipe_input = upipe_ts_mux_input_input;
+    input_mgr->upipe_input_chain = upipe_ts_mux_input_input_chain;
     input_mgr->upipe_control = upipe_ts_mux_input_control;
 }
 
@@ -2030,6 +2377,8 @@ static struct upipe *upipe_ts_mux_program_alloc(struct upipe_mgr *mgr,
     upipe_ts_mux_program->pes_min_duration = upipe_ts_mux->pes_min_duration;
     upipe_ts_mux_program->max_delay = upipe_ts_mux->max_delay;
     upipe_ts_mux_program->required_octetrate = 0;
+    upipe_ts_mux_program->rank = ++upipe_ts_mux->program_rank;
+    upipe_ts_mux_program->input_rank = 0;
     upipe_ts_mux_program_init_sub(upipe);
 
     uprobe_init(&upipe_ts_mux_program->probe, upipe_ts_mux_program_probe, NULL);
@@ -2722,6 +3071,7 @@ static void upipe_ts_mux_init_program_mgr(struct upipe *upipe)
 {
     struct upipe_ts_mux *upipe_ts_mux = upipe_ts_mux_from_upipe(upipe);
     struct upipe_mgr *program_mgr = &upipe_ts_mux->program_mgr;
+    upipe_mgr_init(program_mgr);
     program_mgr->refcount = upipe_ts_mux_to_urefcount(upipe_ts_mux);
     program_mgr->signature = UPIPE_TS_MUX_PROGRAM_SIGNATURE;
     program_mgr->upipe_alloc = upipe_ts_mux_program_alloc;
@@ -2765,6 +3115,7 @@ static void upipe_ts_mux_init_inner_sink(struct upipe *upipe)
 {
     struct upipe_ts_mux *upipe_ts_mux = upipe_ts_mux_from_upipe(upipe);
     struct upipe_mgr *inner_sink_mgr = &upipe_ts_mux->inner_sink_mgr;
+    upipe_mgr_init(inner_sink_mgr);
     inner_sink_mgr->refcount = NULL;
     inner_sink_mgr->signature = UPIPE_TS_MUX_INNER_SINK_SIGNATURE;
     inner_sink_mgr->upipe_alloc = NULL;
@@ -2920,6 +3271,14 @@ static struct upipe *upipe_ts_mux_alloc(struct upipe_mgr *mgr,
     ulist_init(&upipe_ts_mux->psi_pids);
     ulist_init(&upipe_ts_mux->psi_pids_splice);
     ulist_init(&upipe_ts_mux->psi_inputs);
+    upipe_ts_mux->program_rank = 0;
+    for (int heap = 0; heap < UPIPE_TS_MUX_HEAP_MAX; heap++)
+        upipe_ts_mux->heaps[heap] = NULL;
+    upipe_ts_mux->heap_count = 0;
+    upipe_ts_mux->heap_size = 0;
+    upipe_ts_mux->candidates = NULL;
+    ulist_init(&upipe_ts_mux->not_ready);
+    upipe_ts_mux->linear_scheduler = false;
     upipe_ts_mux->mode = UPIPE_TS_MUX_MODE_CBR;
     upipe_ts_mux->tb_size = T_STD_TS_BUFFER;
     upipe_ts_mux->mtu = TS_SIZE;
@@ -3047,53 +3406,72 @@ static uint64_t upipe_ts_mux_show_increment(struct upipe *upipe)
         mux->total_octetrate;
 }
 
-/** @internal @This splices a ubuf to output.
+/** @internal @This selects the input to splice with the heaps. Urgent
+ * inputs are selected in the order of the lists of programs and inputs,
+ * otherwise the input with the lowest cr_sys.
  *
  * @param upipe description structure of the pipe
- * @param ubuf_p filled in with the ubuf to output, or NULL if none is available
- * @param dts_sys_p filled with the dts_sys of the fragment
+ * @param original_cr_sys current cr_sys minus the latency
+ * @return selected input, or NULL if none is available
  */
-static void upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
-                                uint64_t *dts_sys_p)
+static struct upipe_ts_mux_input *upipe_ts_mux_select(struct upipe *upipe,
+        uint64_t original_cr_sys)
 {
     struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
-    uint64_t original_cr_sys = mux->cr_sys - mux->latency;
-    struct uchain *uchain;
-    int err;
-    *ubuf_p = NULL;
+    uint64_t urgent_cr_sys = original_cr_sys + mux->interval;
+    unsigned int nb_candidates = 0;
+    upipe_ts_mux_heap_collect(mux, UPIPE_TS_MUX_HEAP_DTS, 0, urgent_cr_sys,
+                              &nb_candidates);
+    upipe_ts_mux_heap_collect(mux, UPIPE_TS_MUX_HEAP_PCR, 0, original_cr_sys,
+                              &nb_candidates);
+
+    for (unsigned int i = 0; i < nb_candidates; i++) {
+        struct upipe_ts_mux_input *input = mux->candidates[i];
+        struct upipe_ts_mux_program *program =
+            upipe_ts_mux_program_from_input_mgr(
+                    upipe_ts_mux_input_to_upipe(input)->mgr);
+        upipe_use(upipe_ts_mux_program_to_upipe(program));
 
-    /* Order of priority: 1. PSI */
-    while (!ulist_empty(&mux->psi_pids_splice)) {
-        uchain = ulist_peek(&mux->psi_pids_splice);
-        struct upipe_ts_mux_psi_pid *psi_pid =
-            upipe_ts_mux_psi_pid_from_uchain_splice(uchain);
+        if (input->dts_sys < original_cr_sys) { /* flush */
+            upipe_ts_encaps_splice(input->encaps, original_cr_sys,
+                                   original_cr_sys + mux->interval,
+                                   NULL, NULL);
 
-        if (psi_pid->dts_sys < original_cr_sys) {
-            /* Too late: flush */
-            upipe_ts_encaps_splice(psi_pid->encaps, original_cr_sys,
-                                   original_cr_sys + mux->interval, NULL, NULL);
-            /* No need to pop uchain as the probe does it for us. */
-            continue;
+            if (input->deleted && !input->ready) {
+                /* This triggers the immediate deletion of the input. */
+                upipe_release(input->encaps);
+                upipe_release(upipe_ts_mux_program_to_upipe(program));
+                continue;
+            }
         }
 
-        if (psi_pid->cr_sys > original_cr_sys)
-            break; /* Too soon */
-
-        err = upipe_ts_encaps_splice(psi_pid->encaps, original_cr_sys,
-                                     original_cr_sys + mux->interval,
-                                     ubuf_p, dts_sys_p);
-        if (!ubase_check(err)) {
-            upipe_warn(upipe, "internal error in splice");
-            upipe_throw_fatal(upipe, err);
-        }
-        /* No need to pop uchain as the probe does it for us. */
-        return;
+        upipe_release(upipe_ts_mux_program_to_upipe(program));
+        if (input->dts_sys <= urgent_cr_sys ||
+            input->pcr_sys <= original_cr_sys)
+            return input;
     }
 
-    /* 2. Inputs */
+    if (!mux->heap_count)
+        return NULL;
+    struct upipe_ts_mux_input *input = mux->heaps[UPIPE_TS_MUX_HEAP_CR][0];
+    return input->cr_sys <= original_cr_sys ? input : NULL;
+}
+
+/** @internal @This selects the input to splice by walking the lists of
+ * programs and inputs. This is O(inputs), and is only kept as a reference
+ * for @ref upipe_ts_mux_select.
+ *
+ * @param upipe description structure of the pipe
+ * @param original_cr_sys current cr_sys minus the latency
+ * @return selected input, or NULL if none is available
+ */
+static struct upipe_ts_mux_input *
+    upipe_ts_mux_select_linear(struct upipe *upipe, uint64_t original_cr_sys)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
     uint64_t cr_sys = UINT64_MAX;
     struct upipe_ts_mux_input *selected_input = NULL;
-    struct uchain *uchain_tmp;
+    struct uchain *uchain, *uchain_tmp;
     ulist_delete_foreach (&mux->programs, uchain, uchain_tmp) {
         struct upipe_ts_mux_program *program =
             upipe_ts_mux_program_from_uchain(uchain);
@@ -3117,9 +3495,8 @@ static void upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
 
             if (input->dts_sys <= original_cr_sys + mux->interval ||
                 input->pcr_sys <= original_cr_sys) {
-                selected_input = input;
                 upipe_release(upipe_ts_mux_program_to_upipe(program));
-                goto upipe_ts_mux_splice_done;
+                return input;
             }
             if (input->cr_sys < cr_sys) {
                 selected_input = input;
@@ -3130,11 +3507,61 @@ static void upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
         upipe_release(upipe_ts_mux_program_to_upipe(program));
     }
 
-    if (selected_input == NULL ||
-        selected_input->cr_sys > original_cr_sys)
+    if (selected_input == NULL || selected_input->cr_sys > original_cr_sys)
+        return NULL;
+    return selected_input;
+}
+
+/** @internal @This splices a ubuf to output.
+ *
+ * @param upipe description structure of the pipe
+ * @param ubuf_p filled in with the ubuf to output, or NULL if none is available
+ * @param dts_sys_p filled with the dts_sys of the fragment
+ */
+static void upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
+                                uint64_t *dts_sys_p)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    uint64_t original_cr_sys = mux->cr_sys - mux->latency;
+    struct uchain *uchain;
+    int err;
+    *ubuf_p = NULL;
+
+    /* Order of priority: 1. PSI */
+    while (!ulist_empty(&mux->psi_pids_splice)) {
+        uchain = ulist_peek(&mux->psi_pids_splice);
+        struct upipe_ts_mux_psi_pid *psi_pid =
+            upipe_ts_mux_psi_pid_from_uchain_splice(uchain);
+
+        if (psi_pid->dts_sys < original_cr_sys) {
+            /* Too late: flush */
+            upipe_ts_encaps_splice(psi_pid->encaps, original_cr_sys,
+                                   original_cr_sys + mux->interval, NULL, NULL);
+            /* No need to pop uchain as the probe does it for us. */
+            continue;
+        }
+
+        if (psi_pid->cr_sys > original_cr_sys)
+            break; /* Too soon */
+
+        err = upipe_ts_encaps_splice(psi_pid->encaps, original_cr_sys,
+                                     original_cr_sys + mux->interval,
+                                     ubuf_p, dts_sys_p);
+        if (!ubase_check(err)) {
+            upipe_warn(upipe, "internal error in splice");
+            upipe_throw_fatal(upipe, err);
+        }
+        /* No need to pop uchain as the probe does it for us. */
+        return;
+    }
+
+    /* 2. Inputs */
+    struct upipe_ts_mux_input *selected_input = mux->linear_scheduler ?
+        upipe_ts_mux_select_linear(upipe, original_cr_sys) :
+        upipe_ts_mux_select(upipe, original_cr_sys);
+    if (selected_input == NULL)
         return;
 
-upipe_ts_mux_splice_done:
     err = upipe_ts_encaps_splice(selected_input->encaps, original_cr_sys,
                                  original_cr_sys + mux->interval,
                                  ubuf_p, dts_sys_p);
@@ -3254,13 +3681,14 @@ static void upipe_ts_mux_watcher(struct upump *upump)
     _upipe_ts_mux_watcher(upipe);
 }
 
-/** @internal @This checks whether a packet is available on all inputs
- * (used in a file mode only).
+/** @internal @This checks whether a packet is available on all inputs by
+ * walking the lists of programs and inputs. This is only kept as a
+ * reference for @ref upipe_ts_mux_check_available.
  *
  * @param upipe description structure of the pipe
  * @return the lowest available date, or UINT64_MAX
  */
-static uint64_t upipe_ts_mux_check_available(struct upipe *upipe)
+static uint64_t upipe_ts_mux_check_available_linear(struct upipe *upipe)
 {
     struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
     uint64_t min_cr_sys = UINT64_MAX;
@@ -3298,6 +3726,38 @@ static uint64_t upipe_ts_mux_check_available(struct upipe *upipe)
     return min_cr_sys;
 }
 
+/** @internal @This checks whether a packet is available on all inputs
+ * (used in a file mode only).
+ *
+ * @param upipe description structure of the pipe
+ * @return the lowest available date, or UINT64_MAX
+ */
+static uint64_t upipe_ts_mux_check_available(struct upipe *upipe)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    if (mux->linear_scheduler)
+        return upipe_ts_mux_check_available_linear(upipe);
+
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach (&mux->not_ready, uchain, uchain_tmp) {
+        struct upipe_ts_mux_input *input =
+            upipe_ts_mux_input_from_uchain_not_ready(uchain);
+        if (input->deleted) {
+            upipe_release(input->encaps);
+            continue;
+        } else if (input->input_type != UPIPE_TS_MUX_INPUT_OTHER &&
+                   input->input_type != UPIPE_TS_MUX_INPUT_SCTE35 &&
+                   input->input_type != UPIPE_TS_MUX_INPUT_METADATA &&
+                   (input->input_type != UPIPE_TS_MUX_INPUT_UNKNOWN ||
+                    mux->preroll))
+            return UINT64_MAX;
+    }
+
+    if (!mux->heap_count)
+        return UINT64_MAX;
+    return mux->heaps[UPIPE_TS_MUX_HEAP_CR][0]->cr_sys;
+}
+
 /** @internal @This sets the initial cr_prog of all programs.
  *
  * @param upipe description structure of the pipe
@@ -4978,6 +5438,12 @@ static int _upipe_ts_mux_control(struct upipe *upipe, int command, va_list args)
             int force = va_arg(args, int);
             return _upipe_ts_mux_force_pes_alignment(upipe, !!force);
         }
+        case UPIPE_TS_MUX_SET_LINEAR_SCHEDULER: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_MUX_SIGNATURE)
+            struct upipe_ts_mux *upipe_ts_mux = upipe_ts_mux_from_upipe(upipe);
+            upipe_ts_mux->linear_scheduler = !!va_arg(args, int);
+            return UBASE_ERR_NONE;
+        }
 
         case UPIPE_TS_MUX_GET_VERSION:
         case UPIPE_TS_MUX_SET_VERSION:
@@ -5043,6 +5509,9 @@ static void upipe_ts_mux_free(struct urefcount *urefcount_real)
 
     ubuf_free(mux->padding);
     uref_free(mux->flow_def_input);
+    for (int heap = 0; heap < UPIPE_TS_MUX_HEAP_MAX; heap++)
+        free(mux->heaps[heap]);
+    free(mux->candidates);
     uprobe_clean(&mux->probe);
     urefcount_clean(urefcount_real);
     upipe_ts_mux_clean_inner_sink(upipe);
@@ -5194,6 +5663,7 @@ const char *upipe_ts_mux_command_str(int cmd)
         UBASE_CASE_TO_STR(UPIPE_TS_MUX_SET_ENCODING);
         UBASE_CASE_TO_STR(UPIPE_TS_MUX_FREEZE_PSI);
         UBASE_CASE_TO_STR(UPIPE_TS_MUX_PREPARE);
+        UBASE_CASE_TO_STR(UPIPE_TS_MUX_SET_LINEAR_SCHEDULER);
         default: break;
     }
     return NULL;
@@ -5235,6 +5705,7 @@ struct upipe_mgr *upipe_ts_mux_mgr_alloc(void)
 
     urefcount_init(upipe_ts_mux_mgr_to_urefcount(ts_mux_mgr),
                    upipe_ts_mux_mgr_free);
+    upipe_mgr_init(&ts_mux_mgr->mgr);
     ts_mux_mgr->mgr.refcount = upipe_ts_mux_mgr_to_urefcount(ts_mux_mgr);
     ts_mux_mgr->mgr.signature = UPIPE_TS_MUX_SIGNATURE;
     ts_mux_mgr->mgr.upipe_command_str = upipe_ts_mux_command_str;
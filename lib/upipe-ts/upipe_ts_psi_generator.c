@@ -37,6 +37,7 @@
 #include "upipe-ts/upipe_ts_mux.h"
 #include "upipe-ts/uref_ts_flow.h"
 #include "upipe-framers/uref_mpga_flow.h"
+#include "upipe_ts_crc.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -1069,6 +1070,7 @@ static void upipe_ts_psig_program_init_flow_mgr(struct upipe *upipe)
     struct upipe_ts_psig_program *upipe_ts_psig_program =
         upipe_ts_psig_program_from_upipe(upipe);
     struct upipe_mgr *flow_mgr = &upipe_ts_psig_program->flow_mgr;
+    upipe_mgr_init(flow_mgr);
     flow_mgr->refcount =
         upipe_ts_psig_program_to_urefcount(upipe_ts_psig_program);
     flow_mgr->signature = UPIPE_TS_PSIG_FLOW_SIGNATURE;
@@ -1267,7 +1269,7 @@ static void upipe_ts_psig_program_build(struct upipe *upipe)
     uint8_t *es = pmt_get_es(buffer, j);
     pmt_set_length(buffer, es - buffer - PMT_HEADER_SIZE);
     uint16_t pmt_size = psi_get_length(buffer) + PSI_HEADER_SIZE;
-    psi_set_crc(buffer);
+    upipe_ts_psi_set_crc(buffer);
     ubuf_block_unmap(ubuf, 0);
     ubuf_block_resize(ubuf, 0, pmt_size);
 
@@ -1615,6 +1617,7 @@ static void upipe_ts_psig_init_program_mgr(struct upipe *upipe)
 {
     struct upipe_ts_psig *upipe_ts_psig = upipe_ts_psig_from_upipe(upipe);
     struct upipe_mgr *program_mgr = &upipe_ts_psig->program_mgr;
+    upipe_mgr_init(program_mgr);
     program_mgr->refcount = upipe_ts_psig_to_urefcount(upipe_ts_psig);
     program_mgr->signature = UPIPE_TS_PSIG_PROGRAM_SIGNATURE;
     program_mgr->upipe_alloc = upipe_ts_psig_program_alloc;
@@ -1807,7 +1810,7 @@ static void upipe_ts_psig_build(struct upipe *upipe)
         }
 
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
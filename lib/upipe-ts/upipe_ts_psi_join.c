@@ -220,6 +220,7 @@ static void upipe_ts_psi_join_init_sub_mgr(struct upipe *upipe)
     struct upipe_ts_psi_join *upipe_ts_psi_join =
         upipe_ts_psi_join_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_ts_psi_join->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_ts_psi_join_to_urefcount(upipe_ts_psi_join);
     sub_mgr->signature = UPIPE_TS_PSI_JOIN_INPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_ts_psi_join_sub_alloc;
@@ -164,6 +164,7 @@ static void upipe_ts_psi_split_init_sub_mgr(struct upipe *upipe)
     struct upipe_ts_psi_split *upipe_ts_psi_split =
         upipe_ts_psi_split_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_ts_psi_split->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount =
         upipe_ts_psi_split_to_urefcount_real(upipe_ts_psi_split);
     sub_mgr->signature = UPIPE_TS_PSI_SPLIT_OUTPUT_SIGNATURE;
@@ -276,6 +276,7 @@ static void upipe_ts_scte104d_init_sub_mgr(struct upipe *upipe)
     struct upipe_ts_scte104d *upipe_ts_scte104d =
         upipe_ts_scte104d_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_ts_scte104d->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount =
         upipe_ts_scte104d_to_urefcount_real(upipe_ts_scte104d);
     sub_mgr->signature = UPIPE_TS_SCTE104D_OUTPUT_SIGNATURE;
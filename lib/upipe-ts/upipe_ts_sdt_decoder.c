@@ -29,6 +29,7 @@
 #include "upipe-ts/upipe_ts_sdt_decoder.h"
 #include "upipe-ts/uref_ts_flow.h"
 #include "upipe_ts_psi_decoder.h"
+#include "upipe_ts_crc.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -205,7 +206,7 @@ static bool upipe_ts_sdtd_table_validate(struct upipe *upipe)
                                                   &section))))
             return false;
 
-        if (!sdt_validate(section) || !psi_check_crc(section)) {
+        if (!sdt_validate(section) || !upipe_ts_psi_check_crc(section)) {
             uref_block_unmap(section_uref, 0);
             return false;
         }
@@ -40,6 +40,7 @@
 #include "upipe-ts/upipe_ts_mux.h"
 #include "upipe-ts/uref_ts_flow.h"
 #include "upipe-ts/uref_ts_event.h"
+#include "upipe_ts_crc.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -542,7 +543,7 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
 
         eit_set_segment_last_sec_number(buffer, nb_sections - 1);
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
@@ -655,7 +656,7 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
             psi_set_lastsection(buffer, nb_sections - 1);
         }
         eit_set_last_table_id(buffer, table_id);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
@@ -868,6 +869,7 @@ static void upipe_ts_sig_init_service_mgr(struct upipe *upipe)
 {
     struct upipe_ts_sig *upipe_ts_sig = upipe_ts_sig_from_upipe(upipe);
     struct upipe_mgr *service_mgr = &upipe_ts_sig->service_mgr;
+    upipe_mgr_init(service_mgr);
     service_mgr->refcount = upipe_ts_sig_to_urefcount(upipe_ts_sig);
     service_mgr->signature = UPIPE_TS_SIG_SERVICE_SIGNATURE;
     service_mgr->upipe_alloc = upipe_ts_sig_service_alloc;
@@ -945,6 +947,7 @@ static void upipe_ts_sig_init_output_mgr(struct upipe *upipe)
 {
     struct upipe_ts_sig *upipe_ts_sig = upipe_ts_sig_from_upipe(upipe);
     struct upipe_mgr *output_mgr = &upipe_ts_sig->output_mgr;
+    upipe_mgr_init(output_mgr);
     output_mgr->refcount = NULL;
     output_mgr->signature = UPIPE_TS_SIG_OUTPUT_SIGNATURE;
     output_mgr->upipe_alloc = NULL;
@@ -1293,7 +1296,7 @@ static void upipe_ts_sig_build_nit(struct upipe *upipe)
         }
 
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
@@ -1554,7 +1557,7 @@ static void upipe_ts_sig_build_sdt(struct upipe *upipe)
         }
 
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
@@ -1983,7 +1986,7 @@ static void upipe_ts_sig_send_tdttot(struct upipe *upipe, uint64_t cr_sys,
         }
 
         tot_set_utc(buffer, dvb_time_encode_UTC(now / UCLOCK_FREQ));
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
         ubuf_block_unmap(ubuf, 0);
         uref_block_append(uref, ubuf);
     }
@@ -31,7 +31,7 @@
 
 #include <bitstream/mpeg/ts.h>
 
-/** we only accept blocks containing exactly one TS packet */
+/** we only accept blocks containing TS packets */
 #define EXPECTED_FLOW_DEF "block.mpegts."
 /** maximum number of PIDs */
 #define MAX_PIDS 8192
@@ -209,6 +209,7 @@ static void upipe_ts_split_init_sub_mgr(struct upipe *upipe)
 {
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_ts_split->sub_mgr;
+    upipe_mgr_init(sub_mgr);
     sub_mgr->refcount = upipe_ts_split_to_urefcount_real(upipe_ts_split);
     sub_mgr->signature = UPIPE_TS_SPLIT_OUTPUT_SIGNATURE;
     sub_mgr->upipe_alloc = upipe_ts_split_sub_alloc;
@@ -311,27 +312,18 @@ static void upipe_ts_split_pid_unset(struct upipe *upipe, uint16_t pid,
     upipe_ts_split_pid_check(upipe, pid);
 }
 
-/** @internal @This demuxes a TS packet to the appropriate output(s).
+/** @internal @This sends a TS packet, or a run of TS packets of the same
+ * PID, to the appropriate output(s).
  *
  * @param upipe description structure of the pipe
  * @param uref uref structure
+ * @param pid PID of the packets
  * @param upump_p reference to pump that generated the buffer
  */
-static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
-                                 struct upump **upump_p)
+static void upipe_ts_split_output_pid(struct upipe *upipe, struct uref *uref,
+                                      uint16_t pid, struct upump **upump_p)
 {
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
-    uint8_t buffer[TS_HEADER_SIZE];
-    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE,
-                                               buffer);
-    if (unlikely(ts_header == NULL)) {
-        uref_free(uref);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
-    }
-    uint16_t pid = ts_get_pid(ts_header);
-    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 0, buffer, ts_header))
-
     struct uchain *uchain, *uchain_tmp;
     ulist_delete_foreach(&upipe_ts_split->pids[pid].subs, uchain, uchain_tmp) {
         struct upipe_ts_split_sub *output =
@@ -357,6 +349,215 @@ static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
         uref_free(uref);
 }
 
+/** @internal @This demuxes a vector of TS packets, as output by ts_sync in
+ * vector mode. Runs of consecutive packets of the same PID are sent as a
+ * single sub-block of the input buffer, without copying.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param size size of the uref
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_split_input_vector(struct upipe *upipe, struct uref *uref,
+                                        size_t size, struct upump **upump_p)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    if (unlikely(size % TS_SIZE)) {
+        upipe_warn_va(upipe, "dropping %zu trailing octets", size % TS_SIZE);
+        size -= size % TS_SIZE;
+    }
+
+    size_t run = 0;
+    int run_pid = -1;
+    for (size_t offset = 0; offset <= size; offset += TS_SIZE) {
+        int pid = -1;
+        if (offset < size) {
+            uint8_t buffer[TS_HEADER_SIZE];
+            const uint8_t *ts_header = uref_block_peek(uref, offset,
+                                                       TS_HEADER_SIZE, buffer);
+            if (unlikely(ts_header == NULL)) {
+                uref_free(uref);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+            pid = ts_get_pid(ts_header);
+            uref_block_peek_unmap(uref, offset, buffer, ts_header);
+            if (pid == run_pid)
+                continue;
+        }
+
+        /* flush the previous run */
+        if (run_pid != -1 &&
+            !ulist_empty(&upipe_ts_split->pids[run_pid].subs)) {
+            struct uref *output;
+            if (offset == size) {
+                output = uref;
+                uref = NULL;
+                if (run && unlikely(!ubase_check(
+                            uref_block_resize(output, run, -1)))) {
+                    uref_free(output);
+                    upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                    return;
+                }
+            } else
+                output = uref_block_splice(uref, run, offset - run);
+            if (unlikely(output == NULL)) {
+                uref_free(uref);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+            upipe_ts_split_output_pid(upipe, output, run_pid, upump_p);
+        }
+        run = offset;
+        run_pid = pid;
+    }
+    if (uref != NULL)
+        uref_free(uref);
+}
+
+/** @internal @This demuxes a TS packet to the appropriate output(s).
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
+                                 struct upump **upump_p)
+{
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    if (unlikely(size > TS_SIZE)) {
+        upipe_ts_split_input_vector(upipe, uref, size, upump_p);
+        return;
+    }
+
+    uint8_t buffer[TS_HEADER_SIZE];
+    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE,
+                                               buffer);
+    if (unlikely(ts_header == NULL)) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uint16_t pid = ts_get_pid(ts_header);
+    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 0, buffer, ts_header))
+
+    upipe_ts_split_output_pid(upipe, uref, pid, upump_p);
+}
+
+/** @internal @This frees a list of urefs.
+ *
+ * @param urefs list of uref structures
+ */
+static void upipe_ts_split_free_urefs(struct uchain *urefs)
+{
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(urefs)) != NULL)
+        uref_free(uref_from_uchain(uchain));
+}
+
+/** @internal @This sends a list of TS packets of the same PID to the
+ * appropriate output(s), as a single chain.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures, empty upon return
+ * @param pid PID of the packets
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_ts_split_output_pid_chain(struct upipe *upipe,
+                                            struct uchain *urefs,
+                                            uint16_t pid,
+                                            struct upump **upump_p)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    struct uchain *subs = &upipe_ts_split->pids[pid].subs;
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(subs, uchain, uchain_tmp) {
+        struct upipe *output = upipe_ts_split_sub_to_upipe(
+                upipe_ts_split_sub_from_uchain_pid(uchain));
+        if (ulist_is_last(subs, uchain)) {
+            upipe_ts_split_sub_output_chain(output, urefs, upump_p);
+            break;
+        }
+
+        struct uchain dups;
+        ulist_init(&dups);
+        struct uchain *uchain_uref;
+        ulist_foreach(urefs, uchain_uref) {
+            struct uref *dup = uref_dup(uref_from_uchain(uchain_uref));
+            if (unlikely(dup == NULL)) {
+                upipe_ts_split_free_urefs(&dups);
+                upipe_ts_split_free_urefs(urefs);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+            ulist_add(&dups, uref_to_uchain(dup));
+        }
+        upipe_ts_split_sub_output_chain(output, &dups, upump_p);
+    }
+    upipe_ts_split_free_urefs(urefs);
+}
+
+/** @internal @This demuxes a list of TS packets to the appropriate
+ * output(s). Consecutive packets of the same PID are forwarded to the
+ * outputs as a single chain.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_ts_split_input_chain(struct upipe *upipe,
+                                       struct uchain *urefs,
+                                       struct upump **upump_p)
+{
+    struct uchain run;
+    ulist_init(&run);
+    int run_pid = -1;
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(urefs)) != NULL) {
+        struct uref *uref = uref_from_uchain(uchain);
+        size_t size;
+        if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
+            uref_free(uref);
+            upipe_ts_split_free_urefs(&run);
+            upipe_ts_split_free_urefs(urefs);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+
+        int pid = -1;
+        if (likely(size <= TS_SIZE)) {
+            uint8_t buffer[TS_HEADER_SIZE];
+            const uint8_t *ts_header = uref_block_peek(uref, 0,
+                                                       TS_HEADER_SIZE, buffer);
+            if (unlikely(ts_header == NULL)) {
+                uref_free(uref);
+                upipe_ts_split_free_urefs(&run);
+                upipe_ts_split_free_urefs(urefs);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+            pid = ts_get_pid(ts_header);
+            uref_block_peek_unmap(uref, 0, buffer, ts_header);
+        }
+
+        if (pid != run_pid && run_pid != -1)
+            upipe_ts_split_output_pid_chain(upipe, &run, run_pid, upump_p);
+        run_pid = pid;
+        if (unlikely(pid == -1))
+            /* vector of packets */
+            upipe_ts_split_input_vector(upipe, uref, size, upump_p);
+        else
+            ulist_add(&run, uref_to_uchain(uref));
+    }
+    if (run_pid != -1)
+        upipe_ts_split_output_pid_chain(upipe, &run, run_pid, upump_p);
+}
+
 /** @internal @This sets the input flow definition.
  *
  * @param upipe description structure of the pipe
@@ -437,6 +638,7 @@ static struct upipe_mgr upipe_ts_split_mgr = {
 
     .upipe_alloc = upipe_ts_split_alloc,
     .upipe_input = upipe_ts_split_input,
+    .upipe_input_chain = upipe_ts_split_input_chain,
     .upipe_control = upipe_ts_split_control,
 
     .upipe_mgr_control = NULL
@@ -50,6 +50,8 @@
 #define SUFFIX_OUTPUT_FLOW_DEF "block.mpegtssuffix."
 /** TS synchronization word */
 #define TS_SYNC 0x47
+/** maximum number of packets per output uref in vector mode */
+#define MAX_TS_VECTOR 1024
 
 /** @internal @This is the private context of a ts_sync pipe. */
 struct upipe_ts_sync {
@@ -69,6 +71,8 @@ struct upipe_ts_sync {
     size_t output_size;
     /** number of packets to sync with */
     unsigned int ts_sync;
+    /** maximum number of packets per output uref */
+    unsigned int vector;
     /** next uref to be processed */
     struct uref *next_uref;
     /** original size of the next uref */
@@ -114,6 +118,7 @@ static struct upipe *upipe_ts_sync_alloc(struct upipe_mgr *mgr,
     upipe_ts_sync_init_output(upipe);
     upipe_ts_sync_init_output_size(upipe, TS_SIZE);
     upipe_ts_sync->ts_sync = DEFAULT_TS_SYNC;
+    upipe_ts_sync->vector = 1;
     upipe_ts_sync->next_uref = NULL;
     ulist_init(&upipe_ts_sync->urefs);
     upipe_throw_ready(upipe);
@@ -131,7 +136,26 @@ static struct upipe *upipe_ts_sync_alloc(struct upipe_mgr *mgr,
 static bool upipe_ts_sync_check(struct upipe *upipe, size_t *offset_p)
 {
     struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    size_t span = (upipe_ts_sync->ts_sync - 1) * upipe_ts_sync->output_size;
     for ( ; ; ) {
+        /* first check the candidates whose sync words are all in the
+         * current segment */
+        const uint8_t *buffer;
+        int size = -1;
+        if (likely(ubase_check(uref_block_read(upipe_ts_sync->next_uref,
+                                               *offset_p, &size, &buffer)))) {
+            const uint8_t *end = buffer + size;
+            const uint8_t *match = ubuf_block_scan_sync(buffer, end, TS_SYNC,
+                    upipe_ts_sync->output_size, upipe_ts_sync->ts_sync);
+            uref_block_unmap(upipe_ts_sync->next_uref, *offset_p);
+            if (match != end) {
+                *offset_p += match - buffer;
+                return true;
+            }
+            if (size > span)
+                *offset_p += size - span;
+        }
+
         if (unlikely(!ubase_check(uref_block_scan(upipe_ts_sync->next_uref,
                                                   offset_p, TS_SYNC))))
             return false;
@@ -162,6 +186,38 @@ static bool upipe_ts_sync_check(struct upipe *upipe, size_t *offset_p)
     return true;
 }
 
+/** @internal @This returns the number of consecutive TS packets that can be
+ * output in a single uref, after @ref upipe_ts_sync_check found a packet at
+ * the start of the working buffer. Packets are only gathered within the
+ * same input uref, so that they keep their own attributes, and only if they
+ * are followed by the required number of sync words.
+ *
+ * @param upipe description structure of the pipe
+ * @return number of packets
+ */
+static unsigned int upipe_ts_sync_vector_size(struct upipe *upipe)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    unsigned int max = upipe_ts_sync->next_uref_size /
+                       upipe_ts_sync->output_size;
+    if (max > upipe_ts_sync->vector)
+        max = upipe_ts_sync->vector;
+
+    unsigned int packets = 1;
+    while (packets < max) {
+        /* sync words of the previous packets were already checked */
+        size_t offset = (packets + upipe_ts_sync->ts_sync - 1) *
+                        upipe_ts_sync->output_size;
+        uint8_t word;
+        if (!ubase_check(uref_block_extract(upipe_ts_sync->next_uref,
+                                            offset, 1, &word)) ||
+            word != TS_SYNC)
+            break;
+        packets++;
+    }
+    return packets;
+}
+
 /** @internal @This flushes all input buffers.
  *
  * @param upipe description structure of the pipe
@@ -220,8 +276,11 @@ static void upipe_ts_sync_input(struct upipe *upipe, struct uref *uref,
 
         /* upipe_ts_sync_check said there is at least one TS packet there. */
         upipe_ts_sync_sync_acquired(upipe);
+        unsigned int packets = 1;
+        if (upipe_ts_sync->vector > 1)
+            packets = upipe_ts_sync_vector_size(upipe);
         struct uref *output = upipe_ts_sync_extract_uref_stream(upipe,
-                                                    upipe_ts_sync->output_size);
+                                    packets * upipe_ts_sync->output_size);
         if (unlikely(output == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             continue;
@@ -287,6 +346,38 @@ static int _upipe_ts_sync_set_sync(struct upipe *upipe, int sync)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This returns the maximum number of TS packets per output uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param vector_p filled in with the number of packets
+ * @return an error code
+ */
+static int _upipe_ts_sync_get_vector(struct upipe *upipe,
+                                     unsigned int *vector_p)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    assert(vector_p != NULL);
+    *vector_p = upipe_ts_sync->vector;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the maximum number of TS packets per output uref.
+ * Vectors are only supported with standard 188-octet packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param vector number of packets
+ * @return an error code
+ */
+static int _upipe_ts_sync_set_vector(struct upipe *upipe, unsigned int vector)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    if (vector < 1 || vector > MAX_TS_VECTOR ||
+        (vector > 1 && upipe_ts_sync->output_size != TS_SIZE))
+        return UBASE_ERR_INVALID;
+    upipe_ts_sync->vector = vector;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a ts sync pipe.
  *
  * @param upipe description structure of the pipe
@@ -298,9 +389,17 @@ static int upipe_ts_sync_control(struct upipe *upipe,
                                  int command, va_list args)
 {
     UBASE_HANDLED_RETURN(upipe_ts_sync_control_output(upipe, command, args));
-    UBASE_HANDLED_RETURN(
-        upipe_ts_sync_control_output_size(upipe, command, args));
     switch (command) {
+        case UPIPE_SET_OUTPUT_SIZE: {
+            struct upipe_ts_sync *upipe_ts_sync =
+                upipe_ts_sync_from_upipe(upipe);
+            if (upipe_ts_sync->vector > 1)
+                return UBASE_ERR_BUSY;
+            return upipe_ts_sync_control_output_size(upipe, command, args);
+        }
+        case UPIPE_GET_OUTPUT_SIZE:
+            return upipe_ts_sync_control_output_size(upipe, command, args);
+
         case UPIPE_SET_FLOW_DEF: {
             struct uref *flow_def = va_arg(args, struct uref *);
             return upipe_ts_sync_set_flow_def(upipe, flow_def);
@@ -316,6 +415,16 @@ static int upipe_ts_sync_control(struct upipe *upipe,
             int sync = va_arg(args, int);
             return _upipe_ts_sync_set_sync(upipe, sync);
         }
+        case UPIPE_TS_SYNC_GET_VECTOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SYNC_SIGNATURE)
+            unsigned int *vector_p = va_arg(args, unsigned int *);
+            return _upipe_ts_sync_get_vector(upipe, vector_p);
+        }
+        case UPIPE_TS_SYNC_SET_VECTOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SYNC_SIGNATURE)
+            unsigned int vector = va_arg(args, unsigned int);
+            return _upipe_ts_sync_set_vector(upipe, vector);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
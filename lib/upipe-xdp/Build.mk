@@ -0,0 +1,20 @@
+configs += xdp
+xdp-includes = linux/if_xdp.h linux/bpf.h
+
+lib-targets = libupipe_xdp
+
+libupipe_xdp-desc = AF_XDP socket module
+libupipe_xdp-so-version = 1.0.0
+libupipe_xdp-includes = \
+    ubuf_block_xdp.h \
+    upipe_xdp_sink.h \
+    upipe_xdp_source.h
+libupipe_xdp-src = \
+    ubuf_block_xdp.c \
+    upipe_xdp_sink.c \
+    upipe_xdp_source.c
+libupipe_xdp-src-private = \
+    upipe_xdp.c \
+    upipe_xdp.h
+libupipe_xdp-deps = xdp
+libupipe_xdp-libs = libupipe
@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats with AF_XDP UMEM storage
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/urefcount.h"
+#include "upipe/uatomic.h"
+#include "upipe/ulifo.h"
+#include "upipe/upool.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+#include "upipe/ubuf_block_common.h"
+#include "upipe-xdp/ubuf_block_xdp.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+/** @This is a UMEM frame, either free, owned by a socket, or held by
+ * ubufs. */
+struct ubuf_block_xdp_frame {
+    /** number of ubufs pointing to the frame */
+    uatomic_uint32_t refcount;
+    /** UMEM address of the frame */
+    uint64_t addr;
+};
+
+/** @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure with private fields pointing to the UMEM frame. */
+struct ubuf_block_xdp {
+    /** pointer to UMEM frame */
+    struct ubuf_block_xdp_frame *frame;
+
+    /** block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(ubuf_block_xdp, ubuf, ubuf, ubuf_block.ubuf)
+
+/** @This is a super-set of the ubuf_mgr structure with additional local
+ * members. */
+struct ubuf_block_xdp_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** UMEM area */
+    uint8_t *area;
+    /** size of the UMEM area */
+    size_t area_size;
+    /** size of a frame */
+    unsigned int frame_size;
+    /** headroom of the blocks allocated with ubuf_block_alloc */
+    unsigned int headroom;
+    /** number of frames */
+    unsigned int nb_frames;
+    /** array of frames */
+    struct ubuf_block_xdp_frame *frames;
+    /** free frames */
+    struct ulifo free_frames;
+    /** extra space for the free frames LIFO */
+    void *free_frames_extra;
+
+    /** ubuf pool */
+    struct upool ubuf_pool;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(ubuf_block_xdp_mgr, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(ubuf_block_xdp_mgr, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(ubuf_block_xdp_mgr, upool, ubuf_pool, ubuf_pool)
+
+/** @internal @This returns the frame containing a UMEM address.
+ *
+ * @param xdp_mgr pointer to the XDP ubuf manager
+ * @param addr UMEM address
+ * @return pointer to the frame or NULL if the address is out of the area
+ */
+static inline struct ubuf_block_xdp_frame *
+    ubuf_block_xdp_mgr_frame(struct ubuf_block_xdp_mgr *xdp_mgr, uint64_t addr)
+{
+    uint64_t idx = addr / xdp_mgr->frame_size;
+    if (unlikely(idx >= xdp_mgr->nb_frames))
+        return NULL;
+    return &xdp_mgr->frames[idx];
+}
+
+/** @internal @This allocates a ubuf structure from the pool.
+ *
+ * @param mgr common management structure
+ * @param frame UMEM frame to point to
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_block_xdp_alloc_ubuf(struct ubuf_mgr *mgr,
+        struct ubuf_block_xdp_frame *frame)
+{
+    struct ubuf_block_xdp_mgr *xdp_mgr = ubuf_block_xdp_mgr_from_ubuf_mgr(mgr);
+    struct ubuf_block_xdp *block_xdp =
+        upool_alloc(&xdp_mgr->ubuf_pool, struct ubuf_block_xdp *);
+    if (unlikely(block_xdp == NULL))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_block_xdp_to_ubuf(block_xdp);
+    ubuf->mgr = mgr;
+    ubuf_block_common_init(ubuf, false);
+    ubuf_block_common_set_buffer(ubuf, xdp_mgr->area + frame->addr);
+    block_xdp->frame = frame;
+    uatomic_fetch_add(&frame->refcount, 1);
+    return ubuf;
+}
+
+/** @This allocates a ubuf, either in a free frame or from a received
+ * frame.
+ *
+ * @param mgr common management structure
+ * @param signature type of allocation, UBUF_ALLOC_BLOCK or
+ * UBUF_BLOCK_XDP_ALLOC_FRAME
+ * @param args optional arguments
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_block_xdp_alloc(struct ubuf_mgr *mgr,
+                                         uint32_t signature, va_list args)
+{
+    struct ubuf_block_xdp_mgr *xdp_mgr = ubuf_block_xdp_mgr_from_ubuf_mgr(mgr);
+    struct ubuf_block_xdp_frame *frame;
+    int offset, size;
+
+    switch (signature) {
+        case UBUF_ALLOC_BLOCK:
+            offset = xdp_mgr->headroom;
+            size = va_arg(args, int);
+            if (unlikely(size < 0 ||
+                         (unsigned int)size > xdp_mgr->frame_size - offset))
+                return NULL;
+            frame = ulifo_pop(&xdp_mgr->free_frames,
+                              struct ubuf_block_xdp_frame *);
+            if (unlikely(frame == NULL))
+                return NULL;
+            break;
+
+        case UBUF_BLOCK_XDP_ALLOC_FRAME: {
+            uint64_t addr = va_arg(args, uint64_t);
+            size = va_arg(args, int);
+            frame = ubuf_block_xdp_mgr_frame(xdp_mgr, addr);
+            offset = addr - (frame != NULL ? frame->addr : 0);
+            if (unlikely(frame == NULL || size < 0 ||
+                         (unsigned int)(offset + size) > xdp_mgr->frame_size))
+                return NULL;
+            assert(uatomic_load(&frame->refcount) == 0);
+            break;
+        }
+        default:
+            return NULL;
+    }
+
+    struct ubuf *ubuf = ubuf_block_xdp_alloc_ubuf(mgr, frame);
+    if (unlikely(ubuf == NULL)) {
+        if (signature == UBUF_ALLOC_BLOCK)
+            ulifo_push(&xdp_mgr->free_frames, frame);
+        return NULL;
+    }
+
+    ubuf_block_common_set(ubuf, offset, size);
+    return ubuf;
+}
+
+/** @This asks for the creation of a new reference to the same buffer space.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @return an error code
+ */
+static int ubuf_block_xdp_dup(struct ubuf *ubuf, struct ubuf **new_ubuf_p)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_xdp *block_xdp = ubuf_block_xdp_from_ubuf(ubuf);
+    struct ubuf *new_ubuf = ubuf_block_xdp_alloc_ubuf(ubuf->mgr,
+                                                      block_xdp->frame);
+    if (unlikely(new_ubuf == NULL))
+        return UBASE_ERR_ALLOC;
+
+    if (unlikely(!ubase_check(ubuf_block_common_dup(ubuf, new_ubuf)))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This checks whether there is only one reference to the UMEM frame.
+ *
+ * @param ubuf pointer to ubuf
+ * @return an error code
+ */
+static int ubuf_block_xdp_single(struct ubuf *ubuf)
+{
+    struct ubuf_block_xdp *block_xdp = ubuf_block_xdp_from_ubuf(ubuf);
+    return uatomic_load(&block_xdp->frame->refcount) == 1 ?
+           UBASE_ERR_NONE : UBASE_ERR_BUSY;
+}
+
+/** @This asks for the creation of a new reference to the same buffer space.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param offset offset in the buffer
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int ubuf_block_xdp_splice(struct ubuf *ubuf, struct ubuf **new_ubuf_p,
+                                 int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_xdp *block_xdp = ubuf_block_xdp_from_ubuf(ubuf);
+    struct ubuf *new_ubuf = ubuf_block_xdp_alloc_ubuf(ubuf->mgr,
+                                                      block_xdp->frame);
+    if (unlikely(new_ubuf == NULL))
+        return UBASE_ERR_ALLOC;
+
+    if (unlikely(!ubase_check(ubuf_block_common_splice(ubuf, new_ubuf,
+                                                       offset, size)))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This returns the UMEM address of the first segment of the block.
+ *
+ * @param ubuf pointer to ubuf
+ * @param addr_p filled in with the UMEM address
+ * @return an error code
+ */
+static int ubuf_block_xdp_get_addr_ubuf(struct ubuf *ubuf, uint64_t *addr_p)
+{
+    struct ubuf_block_xdp *block_xdp = ubuf_block_xdp_from_ubuf(ubuf);
+    if (unlikely(block_xdp->ubuf_block.next_ubuf != NULL))
+        return UBASE_ERR_INVALID;
+    *addr_p = block_xdp->frame->addr + block_xdp->ubuf_block.offset;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_xdp_control(struct ubuf *ubuf, int command, va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return ubuf_block_xdp_dup(ubuf, new_ubuf_p);
+        }
+        case UBUF_SINGLE:
+            return ubuf_block_xdp_single(ubuf);
+
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return ubuf_block_xdp_splice(ubuf, new_ubuf_p, offset, size);
+        }
+        case UBUF_BLOCK_XDP_GET_ADDR: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_XDP_SIGNATURE)
+            uint64_t *addr_p = va_arg(args, uint64_t *);
+            return ubuf_block_xdp_get_addr_ubuf(ubuf, addr_p);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This recycles or frees a ubuf. The UMEM frame goes back to the free
+ * frames when it is no longer used.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void ubuf_block_xdp_free(struct ubuf *ubuf)
+{
+    struct ubuf_block_xdp_mgr *xdp_mgr =
+        ubuf_block_xdp_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_xdp *block_xdp = ubuf_block_xdp_from_ubuf(ubuf);
+
+    ubuf_block_common_clean(ubuf);
+
+    struct ubuf_block_xdp_frame *frame = block_xdp->frame;
+    if (uatomic_fetch_sub(&frame->refcount, 1) == 1) {
+        bool ret = ulifo_push(&xdp_mgr->free_frames, frame);
+        assert(ret);
+        (void)ret;
+    }
+    upool_free(&xdp_mgr->ubuf_pool, block_xdp);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to ubuf_block_xdp or NULL in case of allocation error
+ */
+static void *ubuf_block_xdp_alloc_inner(struct upool *upool)
+{
+    return malloc(sizeof(struct ubuf_block_xdp));
+}
+
+/** @internal @This frees a ubuf_block_xdp.
+ *
+ * @param upool pointer to upool
+ * @param _block_xdp pointer to a ubuf_block_xdp structure to free
+ */
+static void ubuf_block_xdp_free_inner(struct upool *upool, void *_block_xdp)
+{
+    free(_block_xdp);
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_xdp_mgr_control(struct ubuf_mgr *mgr,
+                                      int command, va_list args)
+{
+    struct ubuf_block_xdp_mgr *xdp_mgr = ubuf_block_xdp_mgr_from_ubuf_mgr(mgr);
+
+    switch (command) {
+        case UBUF_MGR_VACUUM:
+            upool_vacuum(&xdp_mgr->ubuf_pool);
+            return UBASE_ERR_NONE;
+        case UBUF_MGR_GET_STATS: {
+            struct upool_stats *stats = va_arg(args, struct upool_stats *);
+            upool_add_stats(&xdp_mgr->ubuf_pool, stats);
+            return UBASE_ERR_NONE;
+        }
+
+        case UBUF_BLOCK_XDP_MGR_GET_UMEM: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_XDP_SIGNATURE)
+            uint8_t **area_p = va_arg(args, uint8_t **);
+            size_t *size_p = va_arg(args, size_t *);
+            unsigned int *frame_size_p = va_arg(args, unsigned int *);
+            *area_p = xdp_mgr->area;
+            *size_p = xdp_mgr->area_size;
+            *frame_size_p = xdp_mgr->frame_size;
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_BLOCK_XDP_MGR_GET_FRAME: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_XDP_SIGNATURE)
+            uint64_t *addr_p = va_arg(args, uint64_t *);
+            struct ubuf_block_xdp_frame *frame =
+                ulifo_pop(&xdp_mgr->free_frames,
+                          struct ubuf_block_xdp_frame *);
+            if (frame == NULL)
+                return UBASE_ERR_BUSY;
+            *addr_p = frame->addr;
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_BLOCK_XDP_MGR_PUT_FRAME: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_XDP_SIGNATURE)
+            uint64_t addr = va_arg(args, uint64_t);
+            struct ubuf_block_xdp_frame *frame =
+                ubuf_block_xdp_mgr_frame(xdp_mgr, addr);
+            if (unlikely(frame == NULL))
+                return UBASE_ERR_INVALID;
+            assert(uatomic_load(&frame->refcount) == 0);
+            bool ret = ulifo_push(&xdp_mgr->free_frames, frame);
+            assert(ret);
+            (void)ret;
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void ubuf_block_xdp_mgr_free(struct urefcount *urefcount)
+{
+    struct ubuf_block_xdp_mgr *xdp_mgr =
+        ubuf_block_xdp_mgr_from_urefcount(urefcount);
+    upool_clean(&xdp_mgr->ubuf_pool);
+
+    for (unsigned int i = 0; i < xdp_mgr->nb_frames; i++)
+        uatomic_clean(&xdp_mgr->frames[i].refcount);
+    ulifo_clean(&xdp_mgr->free_frames);
+    munmap(xdp_mgr->area, xdp_mgr->area_size);
+
+    free(xdp_mgr->free_frames_extra);
+    free(xdp_mgr->frames);
+    urefcount_clean(urefcount);
+    free(xdp_mgr);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * using AF_XDP UMEM frames.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param nb_frames number of frames of the UMEM area
+ * @param frame_size size of a frame, a power of two between 2048 and the
+ * page size
+ * @param headroom space reserved before the blocks allocated with @ref
+ * ubuf_block_alloc, to prepend headers
+ * @return pointer to manager or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_xdp_mgr_alloc(uint16_t ubuf_pool_depth,
+                                          uint16_t nb_frames,
+                                          unsigned int frame_size,
+                                          unsigned int headroom)
+{
+    if (unlikely(!nb_frames || frame_size < 2048 ||
+                 frame_size > (unsigned int)sysconf(_SC_PAGESIZE) ||
+                 (frame_size & (frame_size - 1)) || headroom >= frame_size))
+        return NULL;
+
+    struct ubuf_block_xdp_mgr *xdp_mgr =
+        malloc(sizeof(struct ubuf_block_xdp_mgr) +
+               upool_sizeof(ubuf_pool_depth));
+    if (unlikely(xdp_mgr == NULL))
+        return NULL;
+
+    xdp_mgr->area_size = (size_t)nb_frames * frame_size;
+    xdp_mgr->area = mmap(NULL, xdp_mgr->area_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    xdp_mgr->frames = malloc(nb_frames * sizeof(struct ubuf_block_xdp_frame));
+    xdp_mgr->free_frames_extra = malloc(ulifo_sizeof(nb_frames));
+    if (unlikely(xdp_mgr->area == MAP_FAILED || xdp_mgr->frames == NULL ||
+                 xdp_mgr->free_frames_extra == NULL)) {
+        if (xdp_mgr->area != MAP_FAILED)
+            munmap(xdp_mgr->area, xdp_mgr->area_size);
+        free(xdp_mgr->frames);
+        free(xdp_mgr->free_frames_extra);
+        free(xdp_mgr);
+        return NULL;
+    }
+    xdp_mgr->frame_size = frame_size;
+    xdp_mgr->headroom = headroom;
+    xdp_mgr->nb_frames = nb_frames;
+    ulifo_init(&xdp_mgr->free_frames, nb_frames, xdp_mgr->free_frames_extra);
+
+    /* push in reverse order so that the first frames are used first */
+    for (unsigned int i = nb_frames; i > 0; i--) {
+        struct ubuf_block_xdp_frame *frame = &xdp_mgr->frames[i - 1];
+        uatomic_init(&frame->refcount, 0);
+        frame->addr = (uint64_t)(i - 1) * frame_size;
+        ulifo_push(&xdp_mgr->free_frames, frame);
+    }
+
+    urefcount_init(ubuf_block_xdp_mgr_to_urefcount(xdp_mgr),
+                   ubuf_block_xdp_mgr_free);
+    xdp_mgr->mgr.refcount = ubuf_block_xdp_mgr_to_urefcount(xdp_mgr);
+    xdp_mgr->mgr.signature = UBUF_ALLOC_BLOCK;
+    xdp_mgr->mgr.ubuf_alloc = ubuf_block_xdp_alloc;
+    xdp_mgr->mgr.ubuf_control = ubuf_block_xdp_control;
+    xdp_mgr->mgr.ubuf_free = ubuf_block_xdp_free;
+    xdp_mgr->mgr.ubuf_mgr_control = ubuf_block_xdp_mgr_control;
+
+    upool_init(&xdp_mgr->ubuf_pool, xdp_mgr->mgr.refcount,
+               ubuf_pool_depth, xdp_mgr->upool_extra,
+               ubuf_block_xdp_alloc_inner, ubuf_block_xdp_free_inner);
+
+    return ubuf_block_xdp_mgr_to_ubuf_mgr(xdp_mgr);
+}
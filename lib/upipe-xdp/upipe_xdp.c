@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe internal helper functions for AF_XDP modules
+ *
+ * The sockets are set up with raw system calls, and the XDP program
+ * redirecting UDP packets to them is assembled here, so that neither
+ * libbpf nor libxdp is needed.
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/upipe.h"
+#include "upipe_xdp.h"
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_ether.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+/** number of packets sent by the kernel per call in copy mode */
+#define UPIPE_XDP_COPY_BATCH 32
+/** license of the XDP program */
+#define XDP_PROG_LICENSE "Dual BSD/GPL"
+
+/** @internal @This is a wrapper for the bpf system call.
+ *
+ * @param cmd bpf command
+ * @param attr attributes of the command
+ * @return the result of the system call
+ */
+static int upipe_xdp_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+/** @internal @This parses a uri of the form ifname[/queue].
+ *
+ * @param upipe description structure of the pipe, for logging
+ * @param uri uri to parse
+ * @param ifname filled in with the name of the interface
+ * @param queue_p filled in with the queue index, 0 by default
+ * @return an error code
+ */
+int upipe_xdp_parse_uri(struct upipe *upipe, const char *uri,
+                        char ifname[IF_NAMESIZE], unsigned int *queue_p)
+{
+    const char *slash = strchr(uri, '/');
+    size_t len = slash != NULL ? (size_t)(slash - uri) : strlen(uri);
+    unsigned long queue = 0;
+    char *end = NULL;
+    if (slash != NULL)
+        queue = strtoul(slash + 1, &end, 10);
+    if (!len || len >= IF_NAMESIZE ||
+        (slash != NULL && (end == slash + 1 || *end || queue > UINT16_MAX))) {
+        upipe_err_va(upipe, "invalid XDP uri %s", uri);
+        return UBASE_ERR_INVALID;
+    }
+
+    memcpy(ifname, uri, len);
+    ifname[len] = '\0';
+    *queue_p = queue;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This maps a ring of the socket.
+ *
+ * @param upipe description structure of the pipe
+ * @param xsk socket structure
+ * @param ring ring structure to fill in
+ * @param off offsets of the ring
+ * @param pgoff mmap offset of the ring
+ * @param size number of entries
+ * @param entry_size size of an entry
+ * @return an error code
+ */
+static int upipe_xdp_ring_map(struct upipe *upipe,
+                              struct upipe_xdp_socket *xsk,
+                              struct upipe_xdp_ring *ring,
+                              const struct xdp_ring_offset *off,
+                              off_t pgoff, uint32_t size, size_t entry_size)
+{
+    ring->map_size = off->desc + size * entry_size;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, xsk->fd, pgoff);
+    if (unlikely(ring->map == MAP_FAILED)) {
+        ring->map = NULL;
+        upipe_err_va(upipe, "can't map AF_XDP ring (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    uint8_t *map = ring->map;
+    ring->producer = (uint32_t *)(map + off->producer);
+    ring->consumer = (uint32_t *)(map + off->consumer);
+    ring->flags = (uint32_t *)(map + off->flags);
+    ring->entries = map + off->desc;
+    ring->size = size;
+    ring->mask = size - 1;
+    ring->cached_prod = __atomic_load_n(ring->producer, __ATOMIC_ACQUIRE);
+    ring->cached_cons = __atomic_load_n(ring->consumer, __ATOMIC_ACQUIRE);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This loads the XDP program redirecting IPv4 UDP packets to
+ * the XSKMAP entry of the receive queue, and passing all other packets to
+ * the kernel stack.
+ *
+ * @param map_fd XSKMAP descriptor
+ * @return program descriptor, or -1 in case of error
+ */
+static int upipe_xdp_prog_load(int map_fd)
+{
+    struct bpf_insn insns[] = {
+        /* r6 = ctx */
+        { .code = BPF_ALU64 | BPF_MOV | BPF_X, .dst_reg = BPF_REG_6,
+          .src_reg = BPF_REG_1 },
+        /* r2 = data, r3 = data_end */
+        { .code = BPF_LDX | BPF_MEM | BPF_W, .dst_reg = BPF_REG_2,
+          .src_reg = BPF_REG_6, .off = offsetof(struct xdp_md, data) },
+        { .code = BPF_LDX | BPF_MEM | BPF_W, .dst_reg = BPF_REG_3,
+          .src_reg = BPF_REG_6, .off = offsetof(struct xdp_md, data_end) },
+        /* if (data + eth + ip > data_end) goto pass */
+        { .code = BPF_ALU64 | BPF_MOV | BPF_X, .dst_reg = BPF_REG_4,
+          .src_reg = BPF_REG_2 },
+        { .code = BPF_ALU64 | BPF_ADD | BPF_K, .dst_reg = BPF_REG_4,
+          .imm = ETHERNET_HEADER_LEN + IP_HEADER_MINSIZE },
+        { .code = BPF_JMP | BPF_JGT | BPF_X, .dst_reg = BPF_REG_4,
+          .src_reg = BPF_REG_3, .off = 10 },
+        /* if (ethertype != IPv4) goto pass */
+        { .code = BPF_LDX | BPF_MEM | BPF_H, .dst_reg = BPF_REG_5,
+          .src_reg = BPF_REG_2, .off = 12 },
+        { .code = BPF_JMP | BPF_JNE | BPF_K, .dst_reg = BPF_REG_5,
+          .off = 8, .imm = htons(ETH_P_IP) },
+        /* if (protocol != UDP) goto pass */
+        { .code = BPF_LDX | BPF_MEM | BPF_B, .dst_reg = BPF_REG_5,
+          .src_reg = BPF_REG_2, .off = ETHERNET_HEADER_LEN + 9 },
+        { .code = BPF_JMP | BPF_JNE | BPF_K, .dst_reg = BPF_REG_5,
+          .off = 6, .imm = IP_PROTO_UDP },
+        /* return bpf_redirect_map(map, rx_queue_index, XDP_PASS) */
+        { .code = BPF_LDX | BPF_MEM | BPF_W, .dst_reg = BPF_REG_2,
+          .src_reg = BPF_REG_6,
+          .off = offsetof(struct xdp_md, rx_queue_index) },
+        { .code = BPF_LD | BPF_DW | BPF_IMM, .dst_reg = BPF_REG_1,
+          .src_reg = BPF_PSEUDO_MAP_FD, .imm = map_fd },
+        { .code = 0 },
+        { .code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_3,
+          .imm = XDP_PASS },
+        { .code = BPF_JMP | BPF_CALL, .imm = BPF_FUNC_redirect_map },
+        { .code = BPF_JMP | BPF_EXIT },
+        /* pass: return XDP_PASS */
+        { .code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_0,
+          .imm = XDP_PASS },
+        { .code = BPF_JMP | BPF_EXIT },
+    };
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = (uintptr_t)insns;
+    attr.insn_cnt = UBASE_ARRAY_SIZE(insns);
+    attr.license = (uintptr_t)XDP_PROG_LICENSE;
+    return upipe_xdp_bpf(BPF_PROG_LOAD, &attr);
+}
+
+/** @internal @This attaches the XDP program to the interface, and adds the
+ * socket to the XSKMAP.
+ *
+ * @param upipe description structure of the pipe
+ * @param xsk socket structure
+ * @return an error code
+ */
+static int upipe_xdp_socket_redirect(struct upipe *upipe,
+                                     struct upipe_xdp_socket *xsk)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(uint32_t);
+    attr.max_entries = xsk->queue + 1;
+    xsk->map_fd = upipe_xdp_bpf(BPF_MAP_CREATE, &attr);
+    if (unlikely(xsk->map_fd < 0)) {
+        upipe_err_va(upipe, "can't create XSKMAP (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    xsk->prog_fd = upipe_xdp_prog_load(xsk->map_fd);
+    if (unlikely(xsk->prog_fd < 0)) {
+        upipe_err_va(upipe, "can't load XDP program (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    /* try the native mode first, then the generic mode */
+    static const uint32_t modes[] = { 0, XDP_FLAGS_SKB_MODE };
+    for (unsigned int i = 0; i < UBASE_ARRAY_SIZE(modes); i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.link_create.prog_fd = xsk->prog_fd;
+        attr.link_create.target_ifindex = xsk->ifindex;
+        attr.link_create.attach_type = BPF_XDP;
+        attr.link_create.flags = modes[i];
+        xsk->link_fd = upipe_xdp_bpf(BPF_LINK_CREATE, &attr);
+        if (xsk->link_fd >= 0 || errno == EBUSY)
+            break;
+    }
+    if (unlikely(xsk->link_fd < 0)) {
+        upipe_err_va(upipe, "can't attach XDP program (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    uint32_t key = xsk->queue;
+    uint32_t value = xsk->fd;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = xsk->map_fd;
+    attr.key = (uintptr_t)&key;
+    attr.value = (uintptr_t)&value;
+    attr.flags = BPF_ANY;
+    if (unlikely(upipe_xdp_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0)) {
+        upipe_err_va(upipe, "can't update XSKMAP (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This opens an AF_XDP socket, registers the UMEM area and
+ * binds the socket to a queue. If there is a receive ring, a XDP program
+ * redirecting IPv4 UDP packets to the socket is attached to the interface.
+ *
+ * @param upipe description structure of the pipe, for logging
+ * @param xsk socket structure to fill in
+ * @param ifname name of the interface
+ * @param queue queue index
+ * @param umem pointer to the UMEM area
+ * @param umem_size size of the UMEM area
+ * @param frame_size size of a UMEM frame
+ * @param rx_size number of entries of the fill and receive rings, or 0
+ * @param tx_size number of entries of the completion and transmit rings,
+ * or 0
+ * @return an error code
+ */
+int upipe_xdp_socket_open(struct upipe *upipe, struct upipe_xdp_socket *xsk,
+                          const char *ifname, unsigned int queue,
+                          void *umem, size_t umem_size,
+                          unsigned int frame_size,
+                          unsigned int rx_size, unsigned int tx_size)
+{
+    memset(xsk, 0, sizeof(*xsk));
+    xsk->map_fd = xsk->prog_fd = xsk->link_fd = -1;
+    xsk->queue = queue;
+    xsk->ifindex = if_nametoindex(ifname);
+    if (unlikely(!xsk->ifindex)) {
+        upipe_err_va(upipe, "unknown interface %s", ifname);
+        xsk->fd = -1;
+        return UBASE_ERR_INVALID;
+    }
+
+    xsk->fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (unlikely(xsk->fd < 0)) {
+        upipe_err_va(upipe, "can't open AF_XDP socket (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    struct xdp_umem_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.addr = (uintptr_t)umem;
+    reg.len = umem_size;
+    reg.chunk_size = frame_size;
+    reg.headroom = 0;
+    if (unlikely(setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_REG,
+                            &reg, sizeof(reg)) < 0)) {
+        upipe_err_va(upipe, "can't register UMEM (%m)");
+        goto error;
+    }
+
+    /* the fill and completion rings are mandatory */
+    int fill_size = rx_size ? rx_size : tx_size;
+    int comp_size = tx_size ? tx_size : rx_size;
+    int rx = rx_size, tx = tx_size;
+    if (unlikely(setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_FILL_RING,
+                            &fill_size, sizeof(int)) < 0 ||
+                 setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING,
+                            &comp_size, sizeof(int)) < 0 ||
+                 (rx && setsockopt(xsk->fd, SOL_XDP, XDP_RX_RING,
+                                   &rx, sizeof(int)) < 0) ||
+                 (tx && setsockopt(xsk->fd, SOL_XDP, XDP_TX_RING,
+                                   &tx, sizeof(int)) < 0))) {
+        upipe_err_va(upipe, "can't set up AF_XDP rings (%m)");
+        goto error;
+    }
+
+    struct xdp_mmap_offsets off;
+    socklen_t optlen = sizeof(off);
+    if (unlikely(getsockopt(xsk->fd, SOL_XDP, XDP_MMAP_OFFSETS,
+                            &off, &optlen) < 0)) {
+        upipe_err_va(upipe, "can't get AF_XDP ring offsets (%m)");
+        goto error;
+    }
+
+    if (unlikely(!ubase_check(upipe_xdp_ring_map(upipe, xsk, &xsk->fill,
+                    &off.fr, XDP_UMEM_PGOFF_FILL_RING, fill_size,
+                    sizeof(uint64_t))) ||
+                 !ubase_check(upipe_xdp_ring_map(upipe, xsk, &xsk->comp,
+                    &off.cr, XDP_UMEM_PGOFF_COMPLETION_RING, comp_size,
+                    sizeof(uint64_t))) ||
+                 (rx && !ubase_check(upipe_xdp_ring_map(upipe, xsk, &xsk->rx,
+                    &off.rx, XDP_PGOFF_RX_RING, rx,
+                    sizeof(struct xdp_desc)))) ||
+                 (tx && !ubase_check(upipe_xdp_ring_map(upipe, xsk, &xsk->tx,
+                    &off.tx, XDP_PGOFF_TX_RING, tx,
+                    sizeof(struct xdp_desc))))))
+        goto error;
+
+    struct sockaddr_xdp sxdp;
+    memset(&sxdp, 0, sizeof(sxdp));
+    sxdp.sxdp_family = AF_XDP;
+    sxdp.sxdp_ifindex = xsk->ifindex;
+    sxdp.sxdp_queue_id = queue;
+    sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP;
+    if (unlikely(bind(xsk->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0)) {
+        upipe_err_va(upipe, "can't bind AF_XDP socket to %s queue %u (%m)",
+                     ifname, queue);
+        goto error;
+    }
+
+    struct xdp_options opts;
+    optlen = sizeof(opts);
+    if (getsockopt(xsk->fd, SOL_XDP, XDP_OPTIONS, &opts, &optlen) == 0)
+        xsk->zerocopy = !!(opts.flags & XDP_OPTIONS_ZEROCOPY);
+
+    if (rx && unlikely(!ubase_check(upipe_xdp_socket_redirect(upipe, xsk))))
+        goto error;
+    return UBASE_ERR_NONE;
+
+error:
+    upipe_xdp_socket_close(xsk);
+    return UBASE_ERR_EXTERNAL;
+}
+
+/** @internal @This unmaps a ring.
+ *
+ * @param ring ring structure
+ */
+static void upipe_xdp_ring_unmap(struct upipe_xdp_ring *ring)
+{
+    if (ring->map != NULL)
+        munmap(ring->map, ring->map_size);
+    ring->map = NULL;
+}
+
+/** @internal @This detaches the XDP program and closes the socket. The
+ * UMEM area is no longer used by the kernel afterwards.
+ *
+ * @param xsk socket structure
+ */
+void upipe_xdp_socket_close(struct upipe_xdp_socket *xsk)
+{
+    if (xsk->link_fd >= 0)
+        close(xsk->link_fd);
+    if (xsk->prog_fd >= 0)
+        close(xsk->prog_fd);
+    if (xsk->map_fd >= 0)
+        close(xsk->map_fd);
+    xsk->map_fd = xsk->prog_fd = xsk->link_fd = -1;
+
+    upipe_xdp_ring_unmap(&xsk->fill);
+    upipe_xdp_ring_unmap(&xsk->comp);
+    upipe_xdp_ring_unmap(&xsk->rx);
+    upipe_xdp_ring_unmap(&xsk->tx);
+    if (xsk->fd >= 0)
+        close(xsk->fd);
+    xsk->fd = -1;
+}
+
+/** @internal @This wakes up the kernel to process the transmit ring. In
+ * copy mode, the kernel only sends a limited batch of packets per call, so
+ * it is called until the ring is empty.
+ *
+ * @param xsk socket structure
+ */
+void upipe_xdp_socket_kick_tx(struct upipe_xdp_socket *xsk)
+{
+    if (xsk->zerocopy) {
+        if (upipe_xdp_ring_needs_wakeup(&xsk->tx))
+            sendto(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+        return;
+    }
+
+    /* ENOBUFS and EBUSY only mean that the kernel is busy */
+    for (uint32_t i = 0; i <= xsk->tx.size / UPIPE_XDP_COPY_BATCH; i++)
+        if (sendto(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) >= 0 ||
+            errno != EAGAIN)
+            break;
+}
+
+/** @internal @This wakes up the kernel to process the fill ring.
+ *
+ * @param xsk socket structure
+ */
+void upipe_xdp_socket_kick_rx(struct upipe_xdp_socket *xsk)
+{
+    recvfrom(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe internal helper functions for AF_XDP modules
+ */
+
+#ifndef _UPIPE_XDP_H_
+/** @hidden */
+#define _UPIPE_XDP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <net/if.h>
+#include <linux/if_xdp.h>
+
+struct upipe;
+
+#define ETHERNET_ADDR_LEN 6
+#define ETHERNET_HEADER_LEN 14
+#define ETHERNET_TYPE_IP 0x0800
+#define IP_HEADER_MINSIZE 20
+#define IP_PROTO_UDP 17
+#define UDP_HEADER_SIZE 8
+/** size of the headers of a UDP packet without IP options */
+#define UDP_HEADERS_SIZE \
+    (ETHERNET_HEADER_LEN + IP_HEADER_MINSIZE + UDP_HEADER_SIZE)
+
+static inline uint16_t ethernet_get_lentype(const uint8_t *p_ethernet)
+{
+    return (p_ethernet[12] << 8) | p_ethernet[13];
+}
+
+static inline void ethernet_set_lentype(uint8_t *p_ethernet, uint16_t lentype)
+{
+    p_ethernet[12] = lentype >> 8;
+    p_ethernet[13] = lentype & 0xff;
+}
+
+static inline uint8_t ip_get_version(const uint8_t *p_ip)
+{
+    return p_ip[0] >> 4;
+}
+
+static inline uint8_t ip_get_ihl(const uint8_t *p_ip)
+{
+    return p_ip[0] & 0xf;
+}
+
+static inline uint16_t ip_get_len(const uint8_t *p_ip)
+{
+    return (p_ip[2] << 8) | p_ip[3];
+}
+
+static inline uint8_t ip_get_proto(const uint8_t *p_ip)
+{
+    return p_ip[9];
+}
+
+static inline void ip_set_len(uint8_t *p_ip, uint16_t len)
+{
+    p_ip[2] = len >> 8;
+    p_ip[3] = len & 0xff;
+}
+
+static inline void ip_set_cksum(uint8_t *p_ip, uint16_t cksum)
+{
+    p_ip[10] = cksum >> 8;
+    p_ip[11] = cksum & 0xff;
+}
+
+static inline uint16_t udp_get_len(const uint8_t *p_udp)
+{
+    return (p_udp[4] << 8) | p_udp[5];
+}
+
+static inline void udp_set_len(uint8_t *p_udp, uint16_t len)
+{
+    p_udp[4] = len >> 8;
+    p_udp[5] = len & 0xff;
+}
+
+/** @internal @This describes a ring shared with the kernel. The producer
+ * (resp. consumer) index is cached for rings produced (resp. consumed) by
+ * the application, and the index of the kernel is cached in the other
+ * field. */
+struct upipe_xdp_ring {
+    /** pointer to the producer index */
+    uint32_t *producer;
+    /** pointer to the consumer index */
+    uint32_t *consumer;
+    /** pointer to the ring flags */
+    uint32_t *flags;
+    /** ring entries */
+    void *entries;
+    /** number of entries minus one */
+    uint32_t mask;
+    /** number of entries */
+    uint32_t size;
+    /** cached producer index */
+    uint32_t cached_prod;
+    /** cached consumer index */
+    uint32_t cached_cons;
+    /** mapped area */
+    void *map;
+    /** size of the mapped area */
+    size_t map_size;
+};
+
+/** @internal @This returns the number of free entries of a ring produced by
+ * the application, up to nb.
+ *
+ * @param ring pointer to ring
+ * @param nb number of wanted entries
+ * @return number of free entries
+ */
+static inline uint32_t upipe_xdp_ring_prod_reserve(struct upipe_xdp_ring *ring,
+                                                   uint32_t nb)
+{
+    uint32_t free = ring->size - (ring->cached_prod - ring->cached_cons);
+    if (free < nb) {
+        ring->cached_cons = __atomic_load_n(ring->consumer, __ATOMIC_ACQUIRE);
+        free = ring->size - (ring->cached_prod - ring->cached_cons);
+    }
+    return free < nb ? free : nb;
+}
+
+/** @internal @This hands entries of a ring produced by the application over
+ * to the kernel.
+ *
+ * @param ring pointer to ring
+ * @param nb number of filled entries
+ */
+static inline void upipe_xdp_ring_prod_submit(struct upipe_xdp_ring *ring,
+                                              uint32_t nb)
+{
+    ring->cached_prod += nb;
+    __atomic_store_n(ring->producer, ring->cached_prod, __ATOMIC_RELEASE);
+}
+
+/** @internal @This returns the number of available entries of a ring
+ * consumed by the application, up to nb.
+ *
+ * @param ring pointer to ring
+ * @param nb number of wanted entries
+ * @return number of available entries
+ */
+static inline uint32_t upipe_xdp_ring_cons_peek(struct upipe_xdp_ring *ring,
+                                                uint32_t nb)
+{
+    uint32_t avail = ring->cached_prod - ring->cached_cons;
+    if (avail < nb) {
+        ring->cached_prod = __atomic_load_n(ring->producer, __ATOMIC_ACQUIRE);
+        avail = ring->cached_prod - ring->cached_cons;
+    }
+    return avail < nb ? avail : nb;
+}
+
+/** @internal @This gives entries of a ring consumed by the application back
+ * to the kernel.
+ *
+ * @param ring pointer to ring
+ * @param nb number of consumed entries
+ */
+static inline void upipe_xdp_ring_cons_release(struct upipe_xdp_ring *ring,
+                                               uint32_t nb)
+{
+    ring->cached_cons += nb;
+    __atomic_store_n(ring->consumer, ring->cached_cons, __ATOMIC_RELEASE);
+}
+
+/** @internal @This returns an address entry of a fill or completion ring.
+ *
+ * @param ring pointer to ring
+ * @param idx index of the entry
+ * @return pointer to the entry
+ */
+static inline uint64_t *upipe_xdp_ring_addr(struct upipe_xdp_ring *ring,
+                                            uint32_t idx)
+{
+    return &((uint64_t *)ring->entries)[idx & ring->mask];
+}
+
+/** @internal @This returns a descriptor entry of a receive or transmit ring.
+ *
+ * @param ring pointer to ring
+ * @param idx index of the entry
+ * @return pointer to the entry
+ */
+static inline struct xdp_desc *upipe_xdp_ring_desc(struct upipe_xdp_ring *ring,
+                                                   uint32_t idx)
+{
+    return &((struct xdp_desc *)ring->entries)[idx & ring->mask];
+}
+
+/** @internal @This checks whether the kernel must be woken up to process a
+ * ring.
+ *
+ * @param ring pointer to ring
+ * @return true if a wake up is needed
+ */
+static inline bool upipe_xdp_ring_needs_wakeup(struct upipe_xdp_ring *ring)
+{
+    return __atomic_load_n(ring->flags, __ATOMIC_RELAXED) &
+           XDP_RING_NEED_WAKEUP;
+}
+
+/** @internal @This is an AF_XDP socket bound to a queue of an interface. */
+struct upipe_xdp_socket {
+    /** socket descriptor */
+    int fd;
+    /** interface index */
+    unsigned int ifindex;
+    /** queue index */
+    unsigned int queue;
+    /** true if the driver works in zero-copy mode */
+    bool zerocopy;
+
+    /** fill ring */
+    struct upipe_xdp_ring fill;
+    /** completion ring */
+    struct upipe_xdp_ring comp;
+    /** receive ring */
+    struct upipe_xdp_ring rx;
+    /** transmit ring */
+    struct upipe_xdp_ring tx;
+
+    /** XSKMAP descriptor, or -1 */
+    int map_fd;
+    /** XDP program descriptor, or -1 */
+    int prog_fd;
+    /** XDP link descriptor, or -1 */
+    int link_fd;
+};
+
+/** @internal @This parses a uri of the form ifname[/queue].
+ *
+ * @param upipe description structure of the pipe, for logging
+ * @param uri uri to parse
+ * @param ifname filled in with the name of the interface
+ * @param queue_p filled in with the queue index, 0 by default
+ * @return an error code
+ */
+int upipe_xdp_parse_uri(struct upipe *upipe, const char *uri,
+                        char ifname[IF_NAMESIZE], unsigned int *queue_p);
+
+/** @internal @This opens an AF_XDP socket, registers the UMEM area and
+ * binds the socket to a queue. If there is a receive ring, a XDP program
+ * redirecting IPv4 UDP packets to the socket is attached to the interface.
+ *
+ * @param upipe description structure of the pipe, for logging
+ * @param xsk socket structure to fill in
+ * @param ifname name of the interface
+ * @param queue queue index
+ * @param umem pointer to the UMEM area
+ * @param umem_size size of the UMEM area
+ * @param frame_size size of a UMEM frame
+ * @param rx_size number of entries of the fill and receive rings, or 0
+ * @param tx_size number of entries of the completion and transmit rings,
+ * or 0
+ * @return an error code
+ */
+int upipe_xdp_socket_open(struct upipe *upipe, struct upipe_xdp_socket *xsk,
+                          const char *ifname, unsigned int queue,
+                          void *umem, size_t umem_size,
+                          unsigned int frame_size,
+                          unsigned int rx_size, unsigned int tx_size);
+
+/** @internal @This detaches the XDP program and closes the socket. The
+ * UMEM area is no longer used by the kernel afterwards.
+ *
+ * @param xsk socket structure
+ */
+void upipe_xdp_socket_close(struct upipe_xdp_socket *xsk);
+
+/** @internal @This wakes up the kernel to process the transmit ring.
+ *
+ * @param xsk socket structure
+ */
+void upipe_xdp_socket_kick_tx(struct upipe_xdp_socket *xsk);
+
+/** @internal @This wakes up the kernel to process the fill ring.
+ *
+ * @param xsk socket structure
+ */
+void upipe_xdp_socket_kick_rx(struct upipe_xdp_socket *xsk);
+
+#endif
@@ -0,0 +1,825 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe sink module for AF_XDP sockets
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/uprobe.h"
+#include "upipe/uclock.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_flow.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+#include "upipe/upump.h"
+#include "upipe/upipe.h"
+#include "upipe/upipe_helper_upipe.h"
+#include "upipe/upipe_helper_urefcount.h"
+#include "upipe/upipe_helper_void.h"
+#include "upipe/upipe_helper_upump_mgr.h"
+#include "upipe/upipe_helper_upump.h"
+#include "upipe/upipe_helper_input.h"
+#include "upipe-xdp/upipe_xdp_sink.h"
+#include "upipe-xdp/ubuf_block_xdp.h"
+#include "upipe_xdp.h"
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include <arpa/inet.h>
+
+/** expected flow definition on all flows */
+#define EXPECTED_FLOW_DEF "block."
+/** number of UMEM frames */
+#define XDP_SINK_NB_FRAMES 4096
+/** size of a UMEM frame */
+#define XDP_SINK_FRAME_SIZE 2048
+/** space reserved before the blocks allocated upstream, for the headers */
+#define XDP_SINK_HEADROOM 64
+/** number of entries of the completion and transmit rings */
+#define XDP_SINK_RING_SIZE 2048
+/** depth of the pool of XDP ubufs */
+#define UBUF_POOL_DEPTH 256
+/** time-to-live of the output packets */
+#define XDP_SINK_TTL 64
+
+/** @hidden */
+static void upipe_xdp_sink_watcher(struct upump *upump);
+/** @hidden */
+static bool upipe_xdp_sink_output(struct upipe *upipe, struct uref *uref,
+                                  struct upump **upump_p);
+
+/** @internal @This is the private context of a XDP sink pipe. */
+struct upipe_xdp_sink {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** retry timer, when the transmit ring or the UMEM area is full */
+    struct upump *upump;
+
+    /** AF_XDP socket */
+    struct upipe_xdp_socket xsk;
+    /** ubuf manager of the UMEM area, or NULL if the socket is closed */
+    struct ubuf_mgr *xdp_mgr;
+    /** UMEM area */
+    uint8_t *area;
+    /** size of a UMEM frame */
+    unsigned int frame_size;
+    /** ubufs sent without copy, by frame, until their completion */
+    struct ubuf **tx_ubufs;
+    /** number of descriptors written but not handed over to the kernel */
+    uint32_t tx_queued;
+    /** uri */
+    char *uri;
+
+    /** true if UDP headers are added */
+    bool udp;
+    /** template of the ethernet, IP and UDP headers */
+    uint8_t header[UDP_HEADERS_SIZE];
+
+    /** temporary uref storage */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers */
+    struct uchain blockers;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_xdp_sink, upipe, UPIPE_XDP_SINK_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_xdp_sink, urefcount, upipe_xdp_sink_free)
+UPIPE_HELPER_VOID(upipe_xdp_sink)
+UPIPE_HELPER_UPUMP_MGR(upipe_xdp_sink, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_xdp_sink, upump, upump_mgr)
+UPIPE_HELPER_INPUT(upipe_xdp_sink, urefs, nb_urefs, max_urefs, blockers,
+                   upipe_xdp_sink_output)
+
+/** @internal @This allocates a XDP sink pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_xdp_sink_alloc(struct upipe_mgr *mgr,
+                                          struct uprobe *uprobe,
+                                          uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_xdp_sink_alloc_void(mgr, uprobe, signature,
+                                                    args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    upipe_xdp_sink_init_urefcount(upipe);
+    upipe_xdp_sink_init_upump_mgr(upipe);
+    upipe_xdp_sink_init_upump(upipe);
+    upipe_xdp_sink_init_input(upipe);
+    upipe_xdp_sink->xsk.fd = -1;
+    upipe_xdp_sink->xdp_mgr = NULL;
+    upipe_xdp_sink->tx_ubufs = NULL;
+    upipe_xdp_sink->tx_queued = 0;
+    upipe_xdp_sink->uri = NULL;
+    upipe_xdp_sink->udp = false;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This starts the timer retrying to send the held buffers.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_sink_poll(struct upipe *upipe)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    if (unlikely(!ubase_check(upipe_xdp_sink_check_upump_mgr(upipe)))) {
+        upipe_err_va(upipe, "can't get upump_mgr");
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return;
+    }
+    struct upump *watcher = upump_alloc_timer(upipe_xdp_sink->upump_mgr,
+            upipe_xdp_sink_watcher, upipe, upipe->refcount,
+            UCLOCK_FREQ / 1000, 0);
+    if (unlikely(watcher == NULL)) {
+        upipe_err_va(upipe, "can't create watcher");
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+    } else {
+        upipe_xdp_sink_set_upump(upipe, watcher);
+        upump_start(watcher);
+    }
+}
+
+/** @internal @This gives back the frames of the sent packets, in a batch.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_sink_complete(struct upipe *upipe)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    struct upipe_xdp_socket *xsk = &upipe_xdp_sink->xsk;
+    uint32_t nb = upipe_xdp_ring_cons_peek(&xsk->comp, xsk->comp.size);
+    for (uint32_t i = 0; i < nb; i++) {
+        uint64_t addr = *upipe_xdp_ring_addr(&xsk->comp,
+                                             xsk->comp.cached_cons + i);
+        uint64_t frame = addr / upipe_xdp_sink->frame_size;
+        struct ubuf *ubuf = upipe_xdp_sink->tx_ubufs[frame];
+        if (ubuf != NULL) {
+            upipe_xdp_sink->tx_ubufs[frame] = NULL;
+            ubuf_free(ubuf);
+        } else
+            ubuf_block_xdp_mgr_put_frame(upipe_xdp_sink->xdp_mgr, addr);
+    }
+    upipe_xdp_ring_cons_release(&xsk->comp, nb);
+}
+
+/** @internal @This hands the written descriptors over to the kernel.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_sink_sync(struct upipe *upipe)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    if (unlikely(upipe_xdp_sink->xdp_mgr == NULL ||
+                 !upipe_xdp_sink->tx_queued))
+        return;
+
+    upipe_xdp_ring_prod_submit(&upipe_xdp_sink->xsk.tx,
+                               upipe_xdp_sink->tx_queued);
+    upipe_xdp_sink->tx_queued = 0;
+    upipe_xdp_socket_kick_tx(&upipe_xdp_sink->xsk);
+}
+
+/** @internal @This computes the checksum of an IPv4 header.
+ *
+ * @param ip pointer to the IPv4 header, with a zero checksum
+ * @return checksum
+ */
+static uint16_t upipe_xdp_sink_ip_cksum(const uint8_t *ip)
+{
+    uint32_t sum = 0;
+    for (unsigned int i = 0; i < IP_HEADER_MINSIZE; i += 2)
+        sum += (ip[i] << 8) | ip[i + 1];
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum;
+}
+
+/** @internal @This writes the ethernet, IP and UDP headers of a packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param buffer pointer to the headers
+ * @param size size of the UDP payload
+ */
+static void upipe_xdp_sink_write_header(struct upipe *upipe, uint8_t *buffer,
+                                        size_t size)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    memcpy(buffer, upipe_xdp_sink->header, UDP_HEADERS_SIZE);
+    uint8_t *ip = buffer + ETHERNET_HEADER_LEN;
+    ip_set_len(ip, IP_HEADER_MINSIZE + UDP_HEADER_SIZE + size);
+    ip_set_cksum(ip, upipe_xdp_sink_ip_cksum(ip));
+    udp_set_len(ip + IP_HEADER_MINSIZE, UDP_HEADER_SIZE + size);
+}
+
+/** @internal @This sends a buffer allocated in the UMEM area without copy,
+ * if it is not shared and has enough headroom for the headers.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param size size of the buffer
+ * @param desc transmit descriptor to fill in
+ * @return false if the buffer must be copied
+ */
+static bool upipe_xdp_sink_output_zc(struct upipe *upipe, struct uref *uref,
+                                     size_t size, struct xdp_desc *desc)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    struct ubuf *ubuf = uref->ubuf;
+    uint64_t addr;
+    if (ubuf->mgr != upipe_xdp_sink->xdp_mgr ||
+        !ubase_check(ubuf_block_xdp_get_addr(ubuf, &addr)) ||
+        !ubase_check(ubuf_control(ubuf, UBUF_SINGLE)))
+        return false;
+
+    if (upipe_xdp_sink->udp) {
+        if (!ubase_check(ubuf_block_prepend(ubuf, UDP_HEADERS_SIZE)))
+            return false;
+        uint8_t *buffer;
+        int header_size = UDP_HEADERS_SIZE;
+        if (unlikely(!ubase_check(ubuf_block_write(ubuf, 0, &header_size,
+                                                   &buffer)))) {
+            ubuf_block_resize(ubuf, UDP_HEADERS_SIZE, -1);
+            return false;
+        }
+        upipe_xdp_sink_write_header(upipe, buffer, size);
+        ubuf_block_unmap(ubuf, 0);
+        addr -= UDP_HEADERS_SIZE;
+        size += UDP_HEADERS_SIZE;
+    }
+
+    desc->addr = addr;
+    desc->len = size;
+    upipe_xdp_sink->tx_ubufs[addr / upipe_xdp_sink->frame_size] =
+        uref_detach_ubuf(uref);
+    return true;
+}
+
+/** @internal @This writes a buffer to the transmit ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return true if the uref was processed
+ */
+static bool upipe_xdp_sink_output(struct upipe *upipe, struct uref *uref,
+                                  struct upump **upump_p)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        uref_free(uref);
+        return true;
+    }
+
+    if (unlikely(upipe_xdp_sink->xdp_mgr == NULL)) {
+        uref_free(uref);
+        upipe_warn(upipe, "received a buffer before opening a XDP socket");
+        return true;
+    }
+
+    size_t size;
+    if (unlikely(uref->ubuf == NULL ||
+                 !ubase_check(uref_block_size(uref, &size)))) {
+        upipe_warn(upipe, "unable to read buffer");
+        uref_free(uref);
+        return true;
+    }
+
+    size_t header_size = upipe_xdp_sink->udp ? UDP_HEADERS_SIZE : 0;
+    if (unlikely(header_size + size > upipe_xdp_sink->frame_size)) {
+        upipe_warn_va(upipe, "dropping packet too large for XDP (%zu)", size);
+        uref_free(uref);
+        return true;
+    }
+
+    struct upipe_xdp_socket *xsk = &upipe_xdp_sink->xsk;
+    if (unlikely(upipe_xdp_ring_prod_reserve(&xsk->tx,
+                    upipe_xdp_sink->tx_queued + 1) <=
+                 upipe_xdp_sink->tx_queued)) {
+        upipe_xdp_sink_sync(upipe);
+        upipe_xdp_sink_complete(upipe);
+        if (!upipe_xdp_ring_prod_reserve(&xsk->tx, 1)) {
+            upipe_xdp_sink_poll(upipe);
+            return false;
+        }
+    }
+    struct xdp_desc *desc = upipe_xdp_ring_desc(&xsk->tx,
+            xsk->tx.cached_prod + upipe_xdp_sink->tx_queued);
+    desc->options = 0;
+
+    if (!upipe_xdp_sink_output_zc(upipe, uref, size, desc)) {
+        uint64_t addr;
+        struct ubuf_mgr *xdp_mgr = upipe_xdp_sink->xdp_mgr;
+        if (unlikely(!ubase_check(ubuf_block_xdp_mgr_get_frame(xdp_mgr,
+                                                              &addr)))) {
+            /* the frames of the queued packets are still in use */
+            upipe_xdp_sink_complete(upipe);
+            if (!ubase_check(ubuf_block_xdp_mgr_get_frame(xdp_mgr, &addr))) {
+                upipe_xdp_sink_sync(upipe);
+                upipe_xdp_sink_poll(upipe);
+                return false;
+            }
+        }
+
+        uint8_t *buffer = upipe_xdp_sink->area + addr;
+        if (upipe_xdp_sink->udp)
+            upipe_xdp_sink_write_header(upipe, buffer, size);
+        uref_block_extract(uref, 0, size, buffer + header_size);
+        desc->addr = addr;
+        desc->len = header_size + size;
+    }
+    uref_free(uref);
+    upipe_xdp_sink->tx_queued++;
+    return true;
+}
+
+/** @internal @This is called to retry sending the held buffers.
+ *
+ * @param upump description structure of the watcher
+ */
+static void upipe_xdp_sink_watcher(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    upipe_xdp_sink_set_upump(upipe, NULL);
+    upipe_xdp_sink_complete(upipe);
+    upipe_xdp_sink_output_input(upipe);
+    upipe_xdp_sink_sync(upipe);
+    upipe_xdp_sink_unblock_input(upipe);
+    if (upipe_xdp_sink_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_xdp_sink_input. */
+        upipe_release(upipe);
+    }
+}
+
+/** @internal @This receives data, and reaps the completions of the
+ * previous packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_xdp_sink_input(struct upipe *upipe, struct uref *uref,
+                                 struct upump **upump_p)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    if (likely(upipe_xdp_sink->xdp_mgr != NULL))
+        upipe_xdp_sink_complete(upipe);
+
+    if (!upipe_xdp_sink_check_input(upipe)) {
+        upipe_xdp_sink_hold_input(upipe, uref);
+        upipe_xdp_sink_block_input(upipe, upump_p);
+    } else if (!upipe_xdp_sink_output(upipe, uref, upump_p)) {
+        upipe_xdp_sink_hold_input(upipe, uref);
+        upipe_xdp_sink_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+    upipe_xdp_sink_sync(upipe);
+}
+
+/** @internal @This receives a list of urefs, hands them over to the kernel
+ * at once, and reaps the completions of the previous batches.
+ *
+ * @param upipe description structure of the pipe
+ * @param urefs list of uref structures
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_xdp_sink_input_chain(struct upipe *upipe,
+                                       struct uchain *urefs,
+                                       struct upump **upump_p)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    if (likely(upipe_xdp_sink->xdp_mgr != NULL))
+        upipe_xdp_sink_complete(upipe);
+
+    bool blocked = !upipe_xdp_sink_check_input(upipe);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(urefs)) != NULL) {
+        struct uref *uref = uref_from_uchain(uchain);
+        if (!upipe_xdp_sink_check_input(upipe))
+            upipe_xdp_sink_hold_input(upipe, uref);
+        else if (!upipe_xdp_sink_output(upipe, uref, upump_p)) {
+            upipe_xdp_sink_hold_input(upipe, uref);
+            /* Increment upipe refcount to avoid disappearing before all
+             * packets have been sent. */
+            upipe_use(upipe);
+        }
+    }
+    upipe_xdp_sink_sync(upipe);
+
+    if (blocked || !upipe_xdp_sink_check_input(upipe))
+        upipe_xdp_sink_block_input(upipe, upump_p);
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_xdp_sink_set_flow_def(struct upipe *upipe,
+                                       struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF))
+    flow_def = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def)
+    upipe_input(upipe, flow_def, NULL);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This answers the ubuf manager requests of the input with the
+ * manager of the UMEM area, so that buffers are sent without copy.
+ *
+ * @param upipe description structure of the pipe
+ * @param request request to answer
+ * @return an error code
+ */
+static int upipe_xdp_sink_provide_ubuf_mgr(struct upipe *upipe,
+                                           struct urequest *request)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    const char *def;
+    if (request->uref == NULL ||
+        !ubase_check(uref_flow_get_def(request->uref, &def)) ||
+        ubase_ncmp(def, EXPECTED_FLOW_DEF))
+        return upipe_throw_provide_request(upipe, request);
+
+    struct uref *flow_format = uref_dup(request->uref);
+    UBASE_ALLOC_RETURN(flow_format)
+    return urequest_provide_ubuf_mgr(request,
+            ubuf_mgr_use(upipe_xdp_sink->xdp_mgr), flow_format);
+}
+
+/** @internal @This returns the uri of the currently opened socket.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri_p filled in with the uri of the socket
+ * @return an error code
+ */
+static int upipe_xdp_sink_get_uri(struct upipe *upipe, const char **uri_p)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    assert(uri_p != NULL);
+    *uri_p = upipe_xdp_sink->uri;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This closes the socket, and releases the buffers that were
+ * being sent. The UMEM area is only released when all ubufs pointing to its
+ * frames are freed.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_sink_close(struct upipe *upipe)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    if (upipe_xdp_sink->xdp_mgr == NULL)
+        return;
+
+    upipe_notice_va(upipe, "closing XDP socket %s", upipe_xdp_sink->uri);
+    upipe_xdp_socket_close(&upipe_xdp_sink->xsk);
+    for (unsigned int i = 0; i < XDP_SINK_NB_FRAMES; i++)
+        if (upipe_xdp_sink->tx_ubufs[i] != NULL)
+            ubuf_free(upipe_xdp_sink->tx_ubufs[i]);
+    free(upipe_xdp_sink->tx_ubufs);
+    upipe_xdp_sink->tx_ubufs = NULL;
+    upipe_xdp_sink->tx_queued = 0;
+    ubuf_mgr_release(upipe_xdp_sink->xdp_mgr);
+    upipe_xdp_sink->xdp_mgr = NULL;
+}
+
+/** @internal @This asks to open the given interface queue.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri interface name and optional queue (ifname[/queue])
+ * @return an error code
+ */
+static int upipe_xdp_sink_set_uri(struct upipe *upipe, const char *uri)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+
+    upipe_xdp_sink_set_upump(upipe, NULL);
+    upipe_xdp_sink_close(upipe);
+    ubase_clean_str(&upipe_xdp_sink->uri);
+    if (!upipe_xdp_sink_check_input(upipe))
+        /* Release the pipe used in @ref upipe_xdp_sink_input. */
+        upipe_release(upipe);
+
+    if (unlikely(uri == NULL))
+        return UBASE_ERR_NONE;
+
+    char ifname[IF_NAMESIZE];
+    unsigned int queue;
+    UBASE_RETURN(upipe_xdp_parse_uri(upipe, uri, ifname, &queue))
+
+    struct ubuf_mgr *xdp_mgr = ubuf_block_xdp_mgr_alloc(UBUF_POOL_DEPTH,
+            XDP_SINK_NB_FRAMES, XDP_SINK_FRAME_SIZE, XDP_SINK_HEADROOM);
+    struct ubuf **tx_ubufs = calloc(XDP_SINK_NB_FRAMES, sizeof(struct ubuf *));
+    if (unlikely(xdp_mgr == NULL || tx_ubufs == NULL)) {
+        if (xdp_mgr != NULL)
+            ubuf_mgr_release(xdp_mgr);
+        free(tx_ubufs);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+
+    size_t area_size;
+    ubase_assert(ubuf_block_xdp_mgr_get_umem(xdp_mgr, &upipe_xdp_sink->area,
+                                             &area_size,
+                                             &upipe_xdp_sink->frame_size));
+    int err = upipe_xdp_socket_open(upipe, &upipe_xdp_sink->xsk,
+                                    ifname, queue, upipe_xdp_sink->area,
+                                    area_size, upipe_xdp_sink->frame_size,
+                                    0, XDP_SINK_RING_SIZE);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_mgr_release(xdp_mgr);
+        free(tx_ubufs);
+        return err;
+    }
+    upipe_xdp_sink->xdp_mgr = xdp_mgr;
+    upipe_xdp_sink->tx_ubufs = tx_ubufs;
+
+    upipe_xdp_sink->uri = strdup(uri);
+    if (unlikely(upipe_xdp_sink->uri == NULL)) {
+        upipe_xdp_sink_close(upipe);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    if (!upipe_xdp_sink_check_input(upipe))
+        /* Use again the pipe that we previously released. */
+        upipe_use(upipe);
+    upipe_notice_va(upipe, "opening XDP socket %s queue %u%s", ifname, queue,
+                    upipe_xdp_sink->xsk.zerocopy ? " (zero-copy)" : "");
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This parses an address of the form ip:port.
+ *
+ * @param upipe description structure of the pipe
+ * @param string address to parse
+ * @param addr_p filled in with the IPv4 address, in host order
+ * @param port_p filled in with the port
+ * @return an error code
+ */
+static int upipe_xdp_sink_parse_addr(struct upipe *upipe, const char *string,
+                                     uint32_t *addr_p, uint16_t *port_p)
+{
+    char host[INET_ADDRSTRLEN];
+    const char *colon = strchr(string, ':');
+    char *end;
+    unsigned long port;
+    if (colon == NULL || colon - string >= (ptrdiff_t)sizeof(host) ||
+        (port = strtoul(colon + 1, &end, 10)) > UINT16_MAX || *end)
+        goto invalid;
+
+    memcpy(host, string, colon - string);
+    host[colon - string] = '\0';
+    struct in_addr in;
+    if (inet_pton(AF_INET, host, &in) != 1)
+        goto invalid;
+
+    *addr_p = ntohl(in.s_addr);
+    *port_p = port;
+    return UBASE_ERR_NONE;
+
+invalid:
+    upipe_err_va(upipe, "invalid address %s", string);
+    return UBASE_ERR_INVALID;
+}
+
+/** @internal @This sets the addresses of the output UDP packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param src source address and port (ip:port)
+ * @param dst destination address and port (ip:port), or NULL
+ * @param src_mac source MAC address, or NULL
+ * @param dst_mac destination MAC address, or NULL
+ * @return an error code
+ */
+static int _upipe_xdp_sink_set_udp(struct upipe *upipe,
+                                   const char *src, const char *dst,
+                                   const uint8_t *src_mac,
+                                   const uint8_t *dst_mac)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    if (dst == NULL) {
+        upipe_xdp_sink->udp = false;
+        return UBASE_ERR_NONE;
+    }
+
+    uint32_t src_addr = 0, dst_addr;
+    uint16_t src_port = 0, dst_port;
+    if (src != NULL)
+        UBASE_RETURN(upipe_xdp_sink_parse_addr(upipe, src,
+                                               &src_addr, &src_port))
+    UBASE_RETURN(upipe_xdp_sink_parse_addr(upipe, dst, &dst_addr, &dst_port))
+
+    uint8_t *header = upipe_xdp_sink->header;
+    memset(header, 0, UDP_HEADERS_SIZE);
+    if (dst_mac != NULL)
+        memcpy(header, dst_mac, ETHERNET_ADDR_LEN);
+    else if ((dst_addr >> 28) == 0xe) {
+        /* IPv4 multicast MAC address */
+        header[0] = 0x01;
+        header[1] = 0x00;
+        header[2] = 0x5e;
+        header[3] = (dst_addr >> 16) & 0x7f;
+        header[4] = (dst_addr >> 8) & 0xff;
+        header[5] = dst_addr & 0xff;
+    } else
+        memset(header, 0xff, ETHERNET_ADDR_LEN);
+    if (src_mac != NULL)
+        memcpy(header + ETHERNET_ADDR_LEN, src_mac, ETHERNET_ADDR_LEN);
+    ethernet_set_lentype(header, ETHERNET_TYPE_IP);
+
+    uint8_t *ip = header + ETHERNET_HEADER_LEN;
+    ip[0] = 0x45; /* version 4, 5 words */
+    ip[6] = 0x40; /* don't fragment */
+    ip[8] = XDP_SINK_TTL;
+    ip[9] = IP_PROTO_UDP;
+    uint32_t src_be = htonl(src_addr), dst_be = htonl(dst_addr);
+    memcpy(ip + 12, &src_be, sizeof(src_be));
+    memcpy(ip + 16, &dst_be, sizeof(dst_be));
+
+    uint8_t *udp = ip + IP_HEADER_MINSIZE;
+    udp[0] = src_port >> 8;
+    udp[1] = src_port & 0xff;
+    udp[2] = dst_port >> 8;
+    udp[3] = dst_port & 0xff;
+
+    upipe_xdp_sink->udp = true;
+    upipe_notice_va(upipe, "sending UDP packets to %s", dst);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This flushes all currently held buffers, and unblocks the
+ * sources.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_xdp_sink_flush(struct upipe *upipe)
+{
+    if (upipe_xdp_sink_flush_input(upipe)) {
+        upipe_xdp_sink_set_upump(upipe, NULL);
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_xdp_sink_input. */
+        upipe_release(upipe);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a XDP sink pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_xdp_sink_control(struct upipe *upipe,
+                                   int command, va_list args)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR &&
+                upipe_xdp_sink->xdp_mgr != NULL)
+                return upipe_xdp_sink_provide_ubuf_mgr(upipe, request);
+            return upipe_throw_provide_request(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_xdp_sink_set_upump(upipe, NULL);
+            return upipe_xdp_sink_attach_upump_mgr(upipe);
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_xdp_sink_set_flow_def(upipe, flow_def);
+        }
+
+        case UPIPE_GET_MAX_LENGTH: {
+            unsigned int *p = va_arg(args, unsigned int *);
+            return upipe_xdp_sink_get_max_length(upipe, p);
+        }
+        case UPIPE_SET_MAX_LENGTH: {
+            unsigned int max_length = va_arg(args, unsigned int);
+            return upipe_xdp_sink_set_max_length(upipe, max_length);
+        }
+
+        case UPIPE_GET_URI: {
+            const char **uri_p = va_arg(args, const char **);
+            return upipe_xdp_sink_get_uri(upipe, uri_p);
+        }
+        case UPIPE_SET_URI: {
+            const char *uri = va_arg(args, const char *);
+            return upipe_xdp_sink_set_uri(upipe, uri);
+        }
+
+        case UPIPE_XDP_SINK_SET_UDP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_XDP_SINK_SIGNATURE)
+            const char *src = va_arg(args, const char *);
+            const char *dst = va_arg(args, const char *);
+            const uint8_t *src_mac = va_arg(args, const uint8_t *);
+            const uint8_t *dst_mac = va_arg(args, const uint8_t *);
+            return _upipe_xdp_sink_set_udp(upipe, src, dst, src_mac, dst_mac);
+        }
+        case UPIPE_FLUSH:
+            return upipe_xdp_sink_flush(upipe);
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a XDP sink pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_xdp_sink_control(struct upipe *upipe,
+                                  int command, va_list args)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+    UBASE_RETURN(_upipe_xdp_sink_control(upipe, command, args));
+
+    if (unlikely(!upipe_xdp_sink_check_input(upipe) &&
+                 upipe_xdp_sink->xdp_mgr != NULL &&
+                 upipe_xdp_sink->upump == NULL))
+        upipe_xdp_sink_poll(upipe);
+
+    return UBASE_ERR_NONE;
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_sink_free(struct upipe *upipe)
+{
+    struct upipe_xdp_sink *upipe_xdp_sink = upipe_xdp_sink_from_upipe(upipe);
+
+    upipe_xdp_sink_set_upump(upipe, NULL);
+    upipe_xdp_sink_close(upipe);
+    upipe_throw_dead(upipe);
+
+    free(upipe_xdp_sink->uri);
+    upipe_xdp_sink_clean_upump(upipe);
+    upipe_xdp_sink_clean_upump_mgr(upipe);
+    upipe_xdp_sink_clean_input(upipe);
+    upipe_xdp_sink_clean_urefcount(upipe);
+    upipe_xdp_sink_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_xdp_sink_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_XDP_SINK_SIGNATURE,
+
+    .upipe_alloc = upipe_xdp_sink_alloc,
+    .upipe_input = upipe_xdp_sink_input,
+    .upipe_input_chain = upipe_xdp_sink_input_chain,
+    .upipe_control = upipe_xdp_sink_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all XDP sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xdp_sink_mgr_alloc(void)
+{
+    return &upipe_xdp_sink_mgr;
+}
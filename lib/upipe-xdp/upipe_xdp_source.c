@@ -0,0 +1,566 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short Upipe source module for AF_XDP sockets
+ *
+ * Each received frame is replaced in the fill ring by a free frame of the
+ * UMEM area, and the UDP payload is output in place. Packets are only
+ * copied when no frame is free, because downstream pipes hold too many of
+ * them; the received frame then goes straight back to the fill ring.
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/uprobe.h"
+#include "upipe/uclock.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_clock.h"
+#include "upipe/upump.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+#include "upipe/upipe.h"
+#include "upipe/upipe_helper_upipe.h"
+#include "upipe/upipe_helper_urefcount.h"
+#include "upipe/upipe_helper_void.h"
+#include "upipe/upipe_helper_uref_mgr.h"
+#include "upipe/upipe_helper_ubuf_mgr.h"
+#include "upipe/upipe_helper_output.h"
+#include "upipe/upipe_helper_upump_mgr.h"
+#include "upipe/upipe_helper_upump.h"
+#include "upipe/upipe_helper_uclock.h"
+#include "upipe-xdp/upipe_xdp_source.h"
+#include "upipe-xdp/ubuf_block_xdp.h"
+#include "upipe_xdp.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/** number of UMEM frames */
+#define XDP_SOURCE_NB_FRAMES 4096
+/** size of a UMEM frame */
+#define XDP_SOURCE_FRAME_SIZE 2048
+/** number of entries of the fill and receive rings */
+#define XDP_SOURCE_RING_SIZE 2048
+/** maximum number of packets processed per wake-up */
+#define XDP_SOURCE_BATCH 64
+/** depth of the pool of XDP ubufs */
+#define UBUF_POOL_DEPTH 256
+
+/** @hidden */
+static int upipe_xdp_source_check(struct upipe *upipe,
+                                  struct uref *flow_format);
+
+/** @internal @This is the private context of a XDP source pipe. */
+struct upipe_xdp_source {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** uref manager */
+    struct uref_mgr *uref_mgr;
+    /** uref manager request */
+    struct urequest uref_mgr_request;
+
+    /** ubuf manager, for copied packets */
+    struct ubuf_mgr *ubuf_mgr;
+    /** flow format packet */
+    struct uref *flow_format;
+    /** ubuf manager request */
+    struct urequest ubuf_mgr_request;
+
+    /** uclock structure, if not NULL we are in live mode */
+    struct uclock *uclock;
+    /** uclock request */
+    struct urequest uclock_request;
+
+    /** pipe acting as output */
+    struct upipe *output;
+    /** flow definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** read watcher */
+    struct upump *upump;
+
+    /** AF_XDP socket */
+    struct upipe_xdp_socket xsk;
+    /** ubuf manager of the UMEM area, or NULL if the socket is closed */
+    struct ubuf_mgr *xdp_mgr;
+    /** uri */
+    char *uri;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_xdp_source, upipe, UPIPE_XDP_SOURCE_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_xdp_source, urefcount, upipe_xdp_source_free)
+UPIPE_HELPER_VOID(upipe_xdp_source)
+
+UPIPE_HELPER_OUTPUT(upipe_xdp_source, output, flow_def, output_state,
+                    request_list)
+UPIPE_HELPER_UREF_MGR(upipe_xdp_source, uref_mgr, uref_mgr_request,
+                      upipe_xdp_source_check,
+                      upipe_xdp_source_register_output_request,
+                      upipe_xdp_source_unregister_output_request)
+UPIPE_HELPER_UBUF_MGR(upipe_xdp_source, ubuf_mgr, flow_format,
+                      ubuf_mgr_request,
+                      upipe_xdp_source_check,
+                      upipe_xdp_source_register_output_request,
+                      upipe_xdp_source_unregister_output_request)
+UPIPE_HELPER_UCLOCK(upipe_xdp_source, uclock, uclock_request,
+                    upipe_xdp_source_check,
+                    upipe_xdp_source_register_output_request,
+                    upipe_xdp_source_unregister_output_request)
+
+UPIPE_HELPER_UPUMP_MGR(upipe_xdp_source, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_xdp_source, upump, upump_mgr)
+
+/** @internal @This allocates a XDP source pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_xdp_source_alloc(struct upipe_mgr *mgr,
+                                            struct uprobe *uprobe,
+                                            uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_xdp_source_alloc_void(mgr, uprobe, signature,
+                                                      args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    upipe_xdp_source_init_urefcount(upipe);
+    upipe_xdp_source_init_uref_mgr(upipe);
+    upipe_xdp_source_init_ubuf_mgr(upipe);
+    upipe_xdp_source_init_output(upipe);
+    upipe_xdp_source_init_upump_mgr(upipe);
+    upipe_xdp_source_init_upump(upipe);
+    upipe_xdp_source_init_uclock(upipe);
+    upipe_xdp_source->xsk.fd = -1;
+    upipe_xdp_source->xdp_mgr = NULL;
+    upipe_xdp_source->uri = NULL;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This checks the ethernet, IPv4 and UDP headers of a received
+ * frame, and locates the UDP payload.
+ *
+ * @param frame pointer to the received frame
+ * @param len length of the received frame
+ * @param offset_p filled in with the offset of the UDP payload
+ * @param size_p filled in with the size of the UDP payload
+ * @return false if the frame is not a valid IPv4 UDP packet
+ */
+static bool upipe_xdp_source_parse(const uint8_t *frame, uint32_t len,
+                                   uint32_t *offset_p, uint32_t *size_p)
+{
+    if (unlikely(len < UDP_HEADERS_SIZE ||
+                 ethernet_get_lentype(frame) != ETHERNET_TYPE_IP))
+        return false;
+
+    const uint8_t *ip = frame + ETHERNET_HEADER_LEN;
+    uint32_t ip_header_len = ip_get_ihl(ip) * 4;
+    uint32_t ip_len = ip_get_len(ip);
+    if (unlikely(ip_get_version(ip) != 4 ||
+                 ip_header_len < IP_HEADER_MINSIZE ||
+                 ip_get_proto(ip) != IP_PROTO_UDP ||
+                 ip_len < ip_header_len + UDP_HEADER_SIZE ||
+                 ETHERNET_HEADER_LEN + ip_len > len))
+        return false;
+
+    const uint8_t *udp = ip + ip_header_len;
+    uint32_t udp_len = udp_get_len(udp);
+    if (unlikely(udp_len < UDP_HEADER_SIZE ||
+                 udp_len > ip_len - ip_header_len))
+        return false;
+
+    *offset_p = ETHERNET_HEADER_LEN + ip_header_len + UDP_HEADER_SIZE;
+    *size_p = udp_len - UDP_HEADER_SIZE;
+    return true;
+}
+
+/** @internal @This copies a UDP payload into a new uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param payload pointer to the UDP payload
+ * @param size size of the UDP payload
+ * @return pointer to uref or NULL in case of allocation error
+ */
+static struct uref *upipe_xdp_source_copy(struct upipe *upipe,
+                                          const uint8_t *payload,
+                                          uint32_t size)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    struct uref *uref = uref_block_alloc(upipe_xdp_source->uref_mgr,
+                                         upipe_xdp_source->ubuf_mgr, size);
+    if (unlikely(uref == NULL))
+        return NULL;
+
+    uint8_t *buffer;
+    int output_size = -1;
+    if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
+                                               &buffer)))) {
+        uref_free(uref);
+        return NULL;
+    }
+    memcpy(buffer, payload, size);
+    uref_block_unmap(uref, 0);
+    return uref;
+}
+
+/** @internal @This reads a batch of packets from the receive ring, and
+ * outputs them once the rings have been given back to the kernel.
+ *
+ * @param upump description structure of the watcher
+ */
+static void upipe_xdp_source_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    struct upipe_xdp_socket *xsk = &upipe_xdp_source->xsk;
+    struct ubuf_mgr *xdp_mgr = upipe_xdp_source->xdp_mgr;
+
+    uint64_t systime = 0;
+    if (likely(upipe_xdp_source->uclock != NULL))
+        systime = uclock_now(upipe_xdp_source->uclock);
+
+    uint8_t *area;
+    size_t area_size;
+    unsigned int frame_size;
+    ubase_assert(ubuf_block_xdp_mgr_get_umem(xdp_mgr, &area, &area_size,
+                                             &frame_size));
+
+    /* every consumed descriptor gives back one frame to the fill ring */
+    uint32_t nb = upipe_xdp_ring_cons_peek(&xsk->rx, XDP_SOURCE_BATCH);
+    nb = upipe_xdp_ring_prod_reserve(&xsk->fill, nb);
+
+    struct uchain urefs;
+    ulist_init(&urefs);
+    bool error = false;
+    for (uint32_t i = 0; i < nb; i++) {
+        const struct xdp_desc *desc =
+            upipe_xdp_ring_desc(&xsk->rx, xsk->rx.cached_cons + i);
+        uint64_t frame_addr = desc->addr & ~(uint64_t)(frame_size - 1);
+        uint64_t *fill_addr =
+            upipe_xdp_ring_addr(&xsk->fill, xsk->fill.cached_prod + i);
+        *fill_addr = frame_addr;
+
+        uint32_t offset, size;
+        if (unlikely(desc->addr + desc->len > area_size ||
+                     !upipe_xdp_source_parse(area + desc->addr, desc->len,
+                                             &offset, &size)))
+            continue;
+
+        struct ubuf *ubuf = NULL;
+        if (likely(ubase_check(ubuf_block_xdp_mgr_get_frame(xdp_mgr,
+                                                            fill_addr)))) {
+            ubuf = ubuf_block_xdp_alloc_frame(xdp_mgr, desc->addr + offset,
+                                              size);
+            if (unlikely(ubuf == NULL)) {
+                ubuf_block_xdp_mgr_put_frame(xdp_mgr, *fill_addr);
+                *fill_addr = frame_addr;
+            }
+        }
+
+        struct uref *uref;
+        if (likely(ubuf != NULL)) {
+            uref = uref_alloc(upipe_xdp_source->uref_mgr);
+            if (unlikely(uref == NULL))
+                ubuf_free(ubuf);
+            else
+                uref_attach_ubuf(uref, ubuf);
+        } else
+            /* no free frame left, copy the payload */
+            uref = upipe_xdp_source_copy(upipe, area + desc->addr + offset,
+                                         size);
+
+        if (unlikely(uref == NULL)) {
+            error = true;
+            continue;
+        }
+        uref_clock_set_cr_sys(uref, systime);
+        ulist_add(&urefs, uref_to_uchain(uref));
+    }
+
+    upipe_xdp_ring_prod_submit(&xsk->fill, nb);
+    upipe_xdp_ring_cons_release(&xsk->rx, nb);
+    if (upipe_xdp_ring_needs_wakeup(&xsk->fill))
+        upipe_xdp_socket_kick_rx(xsk);
+
+    if (unlikely(error))
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+
+    /* the socket may be closed by downstream pipes from now on */
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&urefs)) != NULL)
+        upipe_xdp_source_output(upipe, uref_from_uchain(uchain),
+                                &upipe_xdp_source->upump);
+}
+
+/** @internal @This checks if the pump may be allocated.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_xdp_source_check(struct upipe *upipe,
+                                  struct uref *flow_format)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    if (flow_format != NULL)
+        upipe_xdp_source_store_flow_def(upipe, flow_format);
+
+    upipe_xdp_source_check_upump_mgr(upipe);
+    if (upipe_xdp_source->upump_mgr == NULL)
+        return UBASE_ERR_NONE;
+
+    if (upipe_xdp_source->uref_mgr == NULL) {
+        upipe_xdp_source_require_uref_mgr(upipe);
+        return UBASE_ERR_NONE;
+    }
+
+    if (upipe_xdp_source->ubuf_mgr == NULL) {
+        struct uref *flow_format =
+            uref_block_flow_alloc_def(upipe_xdp_source->uref_mgr, NULL);
+        if (unlikely(flow_format == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return UBASE_ERR_ALLOC;
+        }
+        upipe_xdp_source_require_ubuf_mgr(upipe, flow_format);
+        return UBASE_ERR_NONE;
+    }
+
+    if (upipe_xdp_source->uclock == NULL &&
+        urequest_get_opaque(&upipe_xdp_source->uclock_request, struct upipe *)
+            != NULL)
+        return UBASE_ERR_NONE;
+
+    if (upipe_xdp_source->xdp_mgr == NULL || upipe_xdp_source->upump != NULL)
+        return UBASE_ERR_NONE;
+
+    struct upump *upump = upump_alloc_fd_read(upipe_xdp_source->upump_mgr,
+            upipe_xdp_source_worker, upipe, upipe->refcount,
+            upipe_xdp_source->xsk.fd);
+    if (unlikely(upump == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return UBASE_ERR_UPUMP;
+    }
+    upipe_xdp_source_set_upump(upipe, upump);
+    upump_start(upump);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the uri of the currently opened socket.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri_p filled in with the uri of the socket
+ * @return an error code
+ */
+static int upipe_xdp_source_get_uri(struct upipe *upipe, const char **uri_p)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    assert(uri_p != NULL);
+    *uri_p = upipe_xdp_source->uri;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This closes the socket. The UMEM area is only released when
+ * all ubufs pointing to its frames are freed.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_source_close(struct upipe *upipe)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    if (upipe_xdp_source->xdp_mgr == NULL)
+        return;
+
+    upipe_notice_va(upipe, "closing XDP socket %s", upipe_xdp_source->uri);
+    upipe_xdp_socket_close(&upipe_xdp_source->xsk);
+    ubuf_mgr_release(upipe_xdp_source->xdp_mgr);
+    upipe_xdp_source->xdp_mgr = NULL;
+}
+
+/** @internal @This asks to open the given interface queue.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri interface name and optional queue (ifname[/queue])
+ * @return an error code
+ */
+static int upipe_xdp_source_set_uri(struct upipe *upipe, const char *uri)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+
+    upipe_xdp_source_set_upump(upipe, NULL);
+    upipe_xdp_source_close(upipe);
+    ubase_clean_str(&upipe_xdp_source->uri);
+
+    if (unlikely(uri == NULL))
+        return UBASE_ERR_NONE;
+
+    char ifname[IF_NAMESIZE];
+    unsigned int queue;
+    UBASE_RETURN(upipe_xdp_parse_uri(upipe, uri, ifname, &queue))
+
+    struct ubuf_mgr *xdp_mgr = ubuf_block_xdp_mgr_alloc(UBUF_POOL_DEPTH,
+            XDP_SOURCE_NB_FRAMES, XDP_SOURCE_FRAME_SIZE, 0);
+    if (unlikely(xdp_mgr == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+
+    uint8_t *area;
+    size_t area_size;
+    unsigned int frame_size;
+    ubase_assert(ubuf_block_xdp_mgr_get_umem(xdp_mgr, &area, &area_size,
+                                             &frame_size));
+    struct upipe_xdp_socket *xsk = &upipe_xdp_source->xsk;
+    int err = upipe_xdp_socket_open(upipe, xsk, ifname, queue,
+                                    area, area_size, frame_size,
+                                    XDP_SOURCE_RING_SIZE, 0);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_mgr_release(xdp_mgr);
+        return err;
+    }
+
+    /* give frames to the kernel */
+    uint32_t nb = upipe_xdp_ring_prod_reserve(&xsk->fill,
+                                              XDP_SOURCE_RING_SIZE);
+    for (uint32_t i = 0; i < nb; i++)
+        ubase_assert(ubuf_block_xdp_mgr_get_frame(xdp_mgr,
+                upipe_xdp_ring_addr(&xsk->fill, xsk->fill.cached_prod + i)));
+    upipe_xdp_ring_prod_submit(&xsk->fill, nb);
+    upipe_xdp_source->xdp_mgr = xdp_mgr;
+
+    upipe_xdp_source->uri = strdup(uri);
+    if (unlikely(upipe_xdp_source->uri == NULL)) {
+        upipe_xdp_source_close(upipe);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_notice_va(upipe, "opening XDP socket %s queue %u", ifname, queue);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a XDP source pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_xdp_source_control(struct upipe *upipe,
+                                     int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_xdp_source_set_upump(upipe, NULL);
+            return upipe_xdp_source_attach_upump_mgr(upipe);
+        case UPIPE_ATTACH_UCLOCK:
+            upipe_xdp_source_set_upump(upipe, NULL);
+            upipe_xdp_source_require_uclock(upipe);
+            return UBASE_ERR_NONE;
+
+        case UPIPE_GET_FLOW_DEF:
+        case UPIPE_GET_OUTPUT:
+        case UPIPE_SET_OUTPUT:
+            return upipe_xdp_source_control_output(upipe, command, args);
+
+        case UPIPE_GET_URI: {
+            const char **uri_p = va_arg(args, const char **);
+            return upipe_xdp_source_get_uri(upipe, uri_p);
+        }
+        case UPIPE_SET_URI: {
+            const char *uri = va_arg(args, const char *);
+            return upipe_xdp_source_set_uri(upipe, uri);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a XDP source pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_xdp_source_control(struct upipe *upipe,
+                                    int command, va_list args)
+{
+    UBASE_RETURN(_upipe_xdp_source_control(upipe, command, args));
+
+    return upipe_xdp_source_check(upipe, NULL);
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_source_free(struct upipe *upipe)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+
+    upipe_xdp_source_set_upump(upipe, NULL);
+    upipe_xdp_source_close(upipe);
+
+    upipe_throw_dead(upipe);
+
+    free(upipe_xdp_source->uri);
+    upipe_xdp_source_clean_uclock(upipe);
+    upipe_xdp_source_clean_upump(upipe);
+    upipe_xdp_source_clean_upump_mgr(upipe);
+    upipe_xdp_source_clean_output(upipe);
+    upipe_xdp_source_clean_ubuf_mgr(upipe);
+    upipe_xdp_source_clean_uref_mgr(upipe);
+    upipe_xdp_source_clean_urefcount(upipe);
+    upipe_xdp_source_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_xdp_source_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_XDP_SOURCE_SIGNATURE,
+
+    .upipe_alloc = upipe_xdp_source_alloc,
+    .upipe_input = NULL,
+    .upipe_control = upipe_xdp_source_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all XDP sources.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xdp_source_mgr_alloc(void)
+{
+    return &upipe_xdp_source_mgr;
+}
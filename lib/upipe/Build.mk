@@ -1,3 +1,11 @@
+configs += mmap
+mmap-includes = sys/mman.h
+mmap-functions = mmap
+
+configs += mempolicy
+mempolicy-includes = unistd.h sys/syscall.h linux/mempolicy.h
+mempolicy-assert = SYS_mbind && SYS_set_mempolicy
+
 lib-targets = libupipe
 
 libupipe-desc = core library
@@ -13,6 +21,7 @@ libupipe-includes = \
     ubuf_block.h \
     ubuf_block_common.h \
     ubuf_block_mem.h \
+    ubuf_block_mmap.h \
     ubuf_block_stream.h \
     ubuf_mem.h \
     ubuf_mem_common.h \
@@ -29,6 +38,7 @@ libupipe-includes = \
     udeal.h \
     udict.h \
     udict_dump.h \
+    udict_hash.h \
     udict_inline.h \
     ueventfd.h \
     ufifo.h \
@@ -38,6 +48,7 @@ libupipe-includes = \
     ulog.h \
     umem.h \
     umem_alloc.h \
+    umem_arena.h \
     umem_pool.h \
     umutex.h \
     upipe.h \
@@ -126,6 +137,10 @@ libupipe-includes = \
 
 libupipe-src = \
     ubuf_block_mem.c \
+    ubuf_block_mmap.c \
+    ubuf_block_scan.c \
+    ubuf_block_scan.h \
+    ubuf_block_scan_aarch64.c \
     ubuf_mem.c \
     ubuf_mem_common.c \
     ubuf_pic.c \
@@ -136,8 +151,11 @@ libupipe-src = \
     uclock_ptp.c \
     uclock_std.c \
     ucookie.c \
+    udict_hash.c \
     udict_inline.c \
+    udict_shorthand.h \
     umem_alloc.c \
+    umem_arena.c \
     umem_pool.c \
     upipe_dump.c \
     uprobe.c \
@@ -155,6 +173,7 @@ libupipe-src = \
     uprobe_uclock.c \
     uprobe_upump_mgr.c \
     uprobe_uref_mgr.c \
+    upool.c \
     upump_common.c \
     uref_pic_flow.c \
     uref_std.c \
@@ -163,6 +182,10 @@ libupipe-src = \
     utrace.c \
     uuri.c
 
+libupipe-src += \
+    $(if $(have_x86asm),x86/ubuf_block_scan.asm)
+
+libupipe-libs = pthread
 libupipe-ldlibs = -lm
 
 include/upipe/config.h: config.h
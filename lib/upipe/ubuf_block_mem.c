@@ -365,6 +365,11 @@ static int ubuf_block_mem_mgr_control(struct ubuf_mgr *mgr,
             ubuf_block_mem_mgr_vacuum_pool(mgr);
             return UBASE_ERR_NONE;
         }
+        case UBUF_MGR_GET_STATS: {
+            struct upool_stats *stats = va_arg(args, struct upool_stats *);
+            ubuf_block_mem_mgr_get_stats_pool(mgr, stats);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
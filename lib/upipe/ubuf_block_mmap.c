@@ -0,0 +1,598 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats pointing to mapped files
+ */
+
+#include "config.h"
+
+#include "upipe/ubase.h"
+#include "upipe/urefcount.h"
+#include "upipe/uatomic.h"
+#include "upipe/upool.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+#include "upipe/ubuf_block_common.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/ubuf_block_mmap.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <assert.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+
+/** @This is a window of the file mapped in memory, shared by all the ubufs
+ * pointing into it. */
+struct ubuf_block_mmap_window {
+    /** number of references to the window */
+    uatomic_uint32_t refcount;
+    /** mapped area */
+    uint8_t *base;
+    /** size of the mapped area */
+    size_t size;
+    /** offset of the mapped area in the file */
+    uint64_t offset;
+};
+
+/** @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure with private fields pointing to the mapped window. */
+struct ubuf_block_mmap {
+    /** pointer to mapped window */
+    struct ubuf_block_mmap_window *window;
+
+    /** block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(ubuf_block_mmap, ubuf, ubuf, ubuf_block.ubuf)
+
+/** @This is a super-set of the ubuf_mgr structure with additional local
+ * members. */
+struct ubuf_block_mmap_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** size of the windows */
+    size_t window_size;
+    /** number of octets to read ahead of the last allocated block */
+    size_t readahead;
+    /** size of a page */
+    size_t page_size;
+
+    /** file descriptor of the mapped file, or -1 */
+    int fd;
+    /** last known size of the file */
+    uint64_t file_size;
+    /** current window, or NULL */
+    struct ubuf_block_mmap_window *window;
+    /** offset in the file up to which the pages were requested */
+    uint64_t advised;
+
+    /** block manager for the blocks not pointing to the file */
+    struct ubuf_mgr *block_mgr;
+
+    /** ubuf pool */
+    struct upool ubuf_pool;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(ubuf_block_mmap_mgr, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(ubuf_block_mmap_mgr, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(ubuf_block_mmap_mgr, upool, ubuf_pool, ubuf_pool)
+
+/** @internal @This releases a reference to a window, and unmaps it when it
+ * is no longer used.
+ *
+ * @param window pointer to window
+ */
+static void
+    ubuf_block_mmap_window_release(struct ubuf_block_mmap_window *window)
+{
+    if (window == NULL || uatomic_fetch_sub(&window->refcount, 1) != 1)
+        return;
+    munmap(window->base, window->size);
+    uatomic_clean(&window->refcount);
+    free(window);
+}
+
+/** @internal @This maps a new window containing the given range, and makes
+ * it the current window.
+ *
+ * @param mmap_mgr pointer to the mmap ubuf manager
+ * @param offset offset of the range in the file
+ * @param size size of the range
+ * @return false in case of error
+ */
+static bool ubuf_block_mmap_mgr_map(struct ubuf_block_mmap_mgr *mmap_mgr,
+                                    uint64_t offset, size_t size)
+{
+    struct ubuf_block_mmap_window *window =
+        malloc(sizeof(struct ubuf_block_mmap_window));
+    if (unlikely(window == NULL))
+        return false;
+
+    window->offset = offset - offset % mmap_mgr->page_size;
+    window->size = offset + size - window->offset;
+    window->size += mmap_mgr->page_size - 1;
+    window->size -= window->size % mmap_mgr->page_size;
+    if (window->size < mmap_mgr->window_size)
+        window->size = mmap_mgr->window_size;
+
+    /* private mapping, so that writes never reach the file */
+    window->base = mmap(NULL, window->size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE, mmap_mgr->fd, window->offset);
+    if (unlikely(window->base == MAP_FAILED)) {
+        free(window);
+        return false;
+    }
+    madvise(window->base, window->size, MADV_SEQUENTIAL);
+    uatomic_init(&window->refcount, 1);
+
+    ubuf_block_mmap_window_release(mmap_mgr->window);
+    mmap_mgr->window = window;
+    mmap_mgr->advised = window->offset;
+    return true;
+}
+
+/** @internal @This asks the kernel to read the pages following the last
+ * allocated block, if it is getting close to the pages already requested.
+ *
+ * @param mmap_mgr pointer to the mmap ubuf manager
+ * @param end offset of the end of the last allocated block
+ */
+static void ubuf_block_mmap_mgr_readahead(struct ubuf_block_mmap_mgr *mmap_mgr,
+                                          uint64_t end)
+{
+    struct ubuf_block_mmap_window *window = mmap_mgr->window;
+    if (likely(end + mmap_mgr->readahead / 2 <= mmap_mgr->advised))
+        return;
+
+    uint64_t advise_end = end + mmap_mgr->readahead;
+    if (advise_end > mmap_mgr->file_size)
+        advise_end = mmap_mgr->file_size;
+    advise_end += mmap_mgr->page_size - 1;
+    advise_end -= advise_end % mmap_mgr->page_size;
+    if (advise_end > window->offset + window->size)
+        advise_end = window->offset + window->size;
+    if (advise_end <= mmap_mgr->advised)
+        return;
+
+    madvise(window->base + (mmap_mgr->advised - window->offset),
+            advise_end - mmap_mgr->advised, MADV_WILLNEED);
+    mmap_mgr->advised = advise_end;
+}
+
+/** @internal @This sets the size of the windows mapped afterwards.
+ *
+ * @param mmap_mgr pointer to the mmap ubuf manager
+ * @param window_size size of the windows (if set to 0, a default sensible
+ * value is used)
+ * @return an error code
+ */
+static int
+    _ubuf_block_mmap_mgr_set_window(struct ubuf_block_mmap_mgr *mmap_mgr,
+                                    uint64_t window_size)
+{
+    if (!window_size)
+        window_size = UBUF_BLOCK_MMAP_DEF_WINDOW;
+    if (unlikely(window_size > SIZE_MAX / 2))
+        return UBASE_ERR_INVALID;
+
+    mmap_mgr->window_size = window_size + mmap_mgr->page_size - 1;
+    mmap_mgr->window_size -= mmap_mgr->window_size % mmap_mgr->page_size;
+    mmap_mgr->readahead = mmap_mgr->window_size / 4;
+    if (mmap_mgr->readahead < mmap_mgr->page_size)
+        mmap_mgr->readahead = mmap_mgr->page_size;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This updates the size of the file.
+ *
+ * @param mmap_mgr pointer to the mmap ubuf manager
+ * @return an error code
+ */
+static int ubuf_block_mmap_mgr_stat(struct ubuf_block_mmap_mgr *mmap_mgr)
+{
+    struct stat st;
+    if (unlikely(mmap_mgr->fd == -1 || fstat(mmap_mgr->fd, &st) == -1))
+        return UBASE_ERR_EXTERNAL;
+    mmap_mgr->file_size = st.st_size;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This allocates a ubuf structure from the pool.
+ *
+ * @param mgr common management structure
+ * @param window window to point to
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_block_mmap_alloc_ubuf(struct ubuf_mgr *mgr,
+        struct ubuf_block_mmap_window *window)
+{
+    struct ubuf_block_mmap_mgr *mmap_mgr =
+        ubuf_block_mmap_mgr_from_ubuf_mgr(mgr);
+    struct ubuf_block_mmap *block_mmap =
+        upool_alloc(&mmap_mgr->ubuf_pool, struct ubuf_block_mmap *);
+    if (unlikely(block_mmap == NULL))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_block_mmap_to_ubuf(block_mmap);
+    ubuf->mgr = mgr;
+    ubuf_block_common_init(ubuf, false);
+    ubuf_block_common_set_buffer(ubuf, window->base);
+    block_mmap->window = window;
+    uatomic_fetch_add(&window->refcount, 1);
+    return ubuf;
+}
+
+/** @This allocates a ubuf pointing to a part of the mapped file. Other
+ * allocations, such as UBUF_ALLOC_BLOCK, are forwarded to the internal
+ * block manager.
+ *
+ * @param mgr common management structure
+ * @param signature type of allocation
+ * @param args optional arguments
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_block_mmap_alloc_file(struct ubuf_mgr *mgr,
+                                               uint32_t signature,
+                                               va_list args)
+{
+    struct ubuf_block_mmap_mgr *mmap_mgr =
+        ubuf_block_mmap_mgr_from_ubuf_mgr(mgr);
+    if (signature != UBUF_BLOCK_MMAP_ALLOC_FILE)
+        return mmap_mgr->block_mgr->ubuf_alloc(mmap_mgr->block_mgr,
+                                               signature, args);
+
+    uint64_t offset = va_arg(args, uint64_t);
+    int size = va_arg(args, int);
+    if (unlikely(mmap_mgr->fd == -1 || size < 0))
+        return NULL;
+
+    if (offset + size > mmap_mgr->file_size)
+        ubuf_block_mmap_mgr_stat(mmap_mgr);
+    if (unlikely(offset >= mmap_mgr->file_size))
+        return NULL;
+    if (offset + size > mmap_mgr->file_size)
+        size = mmap_mgr->file_size - offset;
+
+    struct ubuf_block_mmap_window *window = mmap_mgr->window;
+    if (window == NULL || offset < window->offset ||
+        offset + size > window->offset + window->size) {
+        if (unlikely(!ubuf_block_mmap_mgr_map(mmap_mgr, offset, size)))
+            return NULL;
+        window = mmap_mgr->window;
+    }
+
+    struct ubuf *ubuf = ubuf_block_mmap_alloc_ubuf(mgr, window);
+    if (unlikely(ubuf == NULL))
+        return NULL;
+
+    ubuf_block_common_set(ubuf, offset - window->offset, size);
+    ubuf_block_mmap_mgr_readahead(mmap_mgr, offset + size);
+    return ubuf;
+}
+
+/** @This asks for the creation of a new reference to the same buffer space.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @return an error code
+ */
+static int ubuf_block_mmap_dup(struct ubuf *ubuf, struct ubuf **new_ubuf_p)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_mmap *block_mmap = ubuf_block_mmap_from_ubuf(ubuf);
+    struct ubuf *new_ubuf = ubuf_block_mmap_alloc_ubuf(ubuf->mgr,
+                                                       block_mmap->window);
+    if (unlikely(new_ubuf == NULL))
+        return UBASE_ERR_ALLOC;
+
+    if (unlikely(!ubase_check(ubuf_block_common_dup(ubuf, new_ubuf)))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This checks whether there is only one reference to the mapped window.
+ *
+ * @param ubuf pointer to ubuf
+ * @return an error code
+ */
+static int ubuf_block_mmap_single(struct ubuf *ubuf)
+{
+    struct ubuf_block_mmap *block_mmap = ubuf_block_mmap_from_ubuf(ubuf);
+    return uatomic_load(&block_mmap->window->refcount) == 1 ?
+           UBASE_ERR_NONE : UBASE_ERR_BUSY;
+}
+
+/** @This asks for the creation of a new reference to the same buffer space.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param offset offset in the buffer
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int ubuf_block_mmap_splice(struct ubuf *ubuf, struct ubuf **new_ubuf_p,
+                                  int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_mmap *block_mmap = ubuf_block_mmap_from_ubuf(ubuf);
+    struct ubuf *new_ubuf = ubuf_block_mmap_alloc_ubuf(ubuf->mgr,
+                                                       block_mmap->window);
+    if (unlikely(new_ubuf == NULL))
+        return UBASE_ERR_ALLOC;
+
+    if (unlikely(!ubase_check(ubuf_block_common_splice(ubuf, new_ubuf,
+                                                       offset, size)))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_mmap_control(struct ubuf *ubuf, int command,
+                                   va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return ubuf_block_mmap_dup(ubuf, new_ubuf_p);
+        }
+        case UBUF_SINGLE:
+            return ubuf_block_mmap_single(ubuf);
+
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return ubuf_block_mmap_splice(ubuf, new_ubuf_p, offset, size);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This recycles or frees a ubuf. The window is unmapped when it is no
+ * longer used.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void ubuf_block_mmap_free(struct ubuf *ubuf)
+{
+    struct ubuf_block_mmap_mgr *mmap_mgr =
+        ubuf_block_mmap_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_mmap *block_mmap = ubuf_block_mmap_from_ubuf(ubuf);
+
+    ubuf_block_common_clean(ubuf);
+    ubuf_block_mmap_window_release(block_mmap->window);
+    upool_free(&mmap_mgr->ubuf_pool, block_mmap);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to ubuf_block_mmap or NULL in case of allocation error
+ */
+static void *ubuf_block_mmap_alloc_inner(struct upool *upool)
+{
+    return malloc(sizeof(struct ubuf_block_mmap));
+}
+
+/** @internal @This frees a ubuf_block_mmap.
+ *
+ * @param upool pointer to upool
+ * @param _block_mmap pointer to a ubuf_block_mmap structure to free
+ */
+static void ubuf_block_mmap_free_inner(struct upool *upool, void *_block_mmap)
+{
+    free(_block_mmap);
+}
+
+/** @internal @This sets the file to map.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param fd file descriptor, or -1
+ * @return an error code
+ */
+static int _ubuf_block_mmap_mgr_set_fd(struct ubuf_mgr *mgr, int fd)
+{
+    struct ubuf_block_mmap_mgr *mmap_mgr =
+        ubuf_block_mmap_mgr_from_ubuf_mgr(mgr);
+    ubuf_block_mmap_window_release(mmap_mgr->window);
+    mmap_mgr->window = NULL;
+    mmap_mgr->advised = 0;
+    mmap_mgr->file_size = 0;
+    if (mmap_mgr->fd != -1)
+        ubase_clean_fd(&mmap_mgr->fd);
+    if (fd == -1)
+        return UBASE_ERR_NONE;
+
+    mmap_mgr->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (unlikely(mmap_mgr->fd == -1))
+        return UBASE_ERR_EXTERNAL;
+    int err = ubuf_block_mmap_mgr_stat(mmap_mgr);
+    if (unlikely(!ubase_check(err)))
+        ubase_clean_fd(&mmap_mgr->fd);
+    return err;
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_mmap_mgr_control(struct ubuf_mgr *mgr,
+                                       int command, va_list args)
+{
+    struct ubuf_block_mmap_mgr *mmap_mgr =
+        ubuf_block_mmap_mgr_from_ubuf_mgr(mgr);
+
+    switch (command) {
+        case UBUF_MGR_VACUUM:
+            upool_vacuum(&mmap_mgr->ubuf_pool);
+            return ubuf_mgr_vacuum(mmap_mgr->block_mgr);
+        case UBUF_MGR_GET_STATS: {
+            struct upool_stats *stats = va_arg(args, struct upool_stats *);
+            upool_add_stats(&mmap_mgr->ubuf_pool, stats);
+            return ubuf_mgr_get_stats(mmap_mgr->block_mgr, stats);
+        }
+
+        case UBUF_BLOCK_MMAP_MGR_SET_FD: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_MMAP_SIGNATURE)
+            int fd = va_arg(args, int);
+            return _ubuf_block_mmap_mgr_set_fd(mgr, fd);
+        }
+        case UBUF_BLOCK_MMAP_MGR_GET_SIZE: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_MMAP_SIGNATURE)
+            uint64_t *size_p = va_arg(args, uint64_t *);
+            UBASE_RETURN(ubuf_block_mmap_mgr_stat(mmap_mgr))
+            *size_p = mmap_mgr->file_size;
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_BLOCK_MMAP_MGR_GET_WINDOW: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_MMAP_SIGNATURE)
+            uint64_t *window_size_p = va_arg(args, uint64_t *);
+            *window_size_p = mmap_mgr->window_size;
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_BLOCK_MMAP_MGR_SET_WINDOW: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_MMAP_SIGNATURE)
+            uint64_t window_size = va_arg(args, uint64_t);
+            return _ubuf_block_mmap_mgr_set_window(mmap_mgr, window_size);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void ubuf_block_mmap_mgr_free(struct urefcount *urefcount)
+{
+    struct ubuf_block_mmap_mgr *mmap_mgr =
+        ubuf_block_mmap_mgr_from_urefcount(urefcount);
+    upool_clean(&mmap_mgr->ubuf_pool);
+    ubuf_block_mmap_window_release(mmap_mgr->window);
+    if (mmap_mgr->fd != -1)
+        close(mmap_mgr->fd);
+    ubuf_mgr_release(mmap_mgr->block_mgr);
+
+    urefcount_clean(urefcount);
+    free(mmap_mgr);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * pointing to mapped files.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param window_size size of the mapped windows (if set to 0, a default
+ * sensible value is used)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_mmap_mgr_alloc(uint16_t ubuf_pool_depth,
+                                           uint64_t window_size)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (unlikely(page_size <= 0))
+        return NULL;
+
+    struct ubuf_block_mmap_mgr *mmap_mgr =
+        malloc(sizeof(struct ubuf_block_mmap_mgr) +
+               upool_sizeof(ubuf_pool_depth));
+    if (unlikely(mmap_mgr == NULL))
+        return NULL;
+
+    mmap_mgr->page_size = page_size;
+    if (unlikely(!ubase_check(
+                    _ubuf_block_mmap_mgr_set_window(mmap_mgr, window_size)))) {
+        free(mmap_mgr);
+        return NULL;
+    }
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    if (unlikely(umem_mgr == NULL)) {
+        free(mmap_mgr);
+        return NULL;
+    }
+    mmap_mgr->block_mgr = ubuf_block_mem_mgr_alloc(ubuf_pool_depth,
+                                                   ubuf_pool_depth, umem_mgr,
+                                                   -1, 0, -1, 0);
+    umem_mgr_release(umem_mgr);
+    if (unlikely(mmap_mgr->block_mgr == NULL)) {
+        free(mmap_mgr);
+        return NULL;
+    }
+
+    mmap_mgr->fd = -1;
+    mmap_mgr->file_size = 0;
+    mmap_mgr->window = NULL;
+    mmap_mgr->advised = 0;
+
+    urefcount_init(ubuf_block_mmap_mgr_to_urefcount(mmap_mgr),
+                   ubuf_block_mmap_mgr_free);
+    mmap_mgr->mgr.refcount = ubuf_block_mmap_mgr_to_urefcount(mmap_mgr);
+    mmap_mgr->mgr.signature = UBUF_ALLOC_BLOCK;
+    mmap_mgr->mgr.ubuf_alloc = ubuf_block_mmap_alloc_file;
+    mmap_mgr->mgr.ubuf_control = ubuf_block_mmap_control;
+    mmap_mgr->mgr.ubuf_free = ubuf_block_mmap_free;
+    mmap_mgr->mgr.ubuf_mgr_control = ubuf_block_mmap_mgr_control;
+
+    upool_init(&mmap_mgr->ubuf_pool, mmap_mgr->mgr.refcount,
+               ubuf_pool_depth, mmap_mgr->upool_extra,
+               ubuf_block_mmap_alloc_inner, ubuf_block_mmap_free_inner);
+
+    return ubuf_block_mmap_mgr_to_ubuf_mgr(mmap_mgr);
+}
+
+#else /* HAVE_MMAP */
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * pointing to mapped files, which is not supported on this platform.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param window_size size of the mapped windows
+ * @return NULL
+ */
+struct ubuf_mgr *ubuf_block_mmap_mgr_alloc(uint16_t ubuf_pool_depth,
+                                           uint64_t window_size)
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe scanning functions for start codes and sync words in block
+ * buffers, with SIMD implementations selected at runtime
+ */
+
+#include "config.h"
+#include "upipe/ubase.h"
+#include "upipe/ubuf_block.h"
+#include "ubuf_block_scan.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/** @This is the scalar implementation of the start code scanner.
+ *
+ * @param p linear buffer
+ * @param positions number of candidate positions
+ * @return offset of the first start code, or positions
+ */
+uintptr_t upipe_ubuf_block_scan_startcode_c(const uint8_t *p,
+                                            uintptr_t positions)
+{
+    /* Same skipping logic as upipe_framers_mpeg_scan */
+    uintptr_t i = 0;
+    while (i < positions) {
+        if      (p[i + 2] > 1)    i += 3;
+        else if (p[i + 1])        i += 2;
+        else if (p[i] | (p[i + 2] - 1)) i++;
+        else
+            return i;
+    }
+    return positions;
+}
+
+/** @This is the scalar implementation of the sync word scanner.
+ *
+ * @param p linear buffer
+ * @param positions number of candidate positions
+ * @param stride distance between sync words
+ * @param count number of sync words to check
+ * @param word sync word
+ * @return offset of the first match, or positions
+ */
+uintptr_t upipe_ubuf_block_scan_sync_c(const uint8_t *p, uintptr_t positions,
+                                       uintptr_t stride, uintptr_t count,
+                                       uintptr_t word)
+{
+    uintptr_t i = 0;
+    while (i < positions) {
+        const uint8_t *match = memchr(p + i, word, positions - i);
+        if (match == NULL)
+            break;
+        i = match - p;
+
+        uintptr_t j;
+        for (j = 1; j < count; j++)
+            if (p[i + j * stride] != word)
+                break;
+        if (j == count)
+            return i;
+        i++;
+    }
+    return positions;
+}
+
+/** start code scanner in use, accessed atomically */
+static uintptr_t (*scan_startcode)(const uint8_t *, uintptr_t) = NULL;
+/** sync word scanner in use, accessed atomically */
+static uintptr_t (*scan_sync)(const uint8_t *, uintptr_t, uintptr_t,
+                              uintptr_t, uintptr_t) = NULL;
+
+/** @internal @This selects the scanners according to the CPU features. */
+static void ubuf_block_scan_init(void)
+{
+    uintptr_t (*startcode)(const uint8_t *, uintptr_t) =
+        upipe_ubuf_block_scan_startcode_c;
+    uintptr_t (*sync)(const uint8_t *, uintptr_t, uintptr_t, uintptr_t,
+                      uintptr_t) = upipe_ubuf_block_scan_sync_c;
+
+#ifdef HAVE_X86ASM
+#if defined(__i686__) || defined(__x86_64__)
+    if (__builtin_cpu_supports("sse2")) {
+        startcode = upipe_ubuf_block_scan_startcode_sse2;
+        sync = upipe_ubuf_block_scan_sync_sse2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        startcode = upipe_ubuf_block_scan_startcode_avx2;
+        sync = upipe_ubuf_block_scan_sync_avx2;
+    }
+#endif
+#endif
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_ASIMD) {
+        startcode = upipe_ubuf_block_scan_startcode_neon;
+        sync = upipe_ubuf_block_scan_sync_neon;
+    }
+#endif
+
+    __atomic_store_n(&scan_sync, sync, __ATOMIC_RELEASE);
+    __atomic_store_n(&scan_startcode, startcode, __ATOMIC_RELEASE);
+}
+
+/** @This finds the first MPEG-style 3-octet start code (00 00 01) in a
+ * linear buffer.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @return pointer to the first octet of the start code, or end
+ */
+const uint8_t *ubuf_block_scan_startcode(const uint8_t *p, const uint8_t *end)
+{
+    if (end - p < 3)
+        return end;
+    uintptr_t (*startcode)(const uint8_t *, uintptr_t) =
+        __atomic_load_n(&scan_startcode, __ATOMIC_ACQUIRE);
+    if (unlikely(startcode == NULL)) {
+        ubuf_block_scan_init();
+        startcode = __atomic_load_n(&scan_startcode, __ATOMIC_ACQUIRE);
+    }
+
+    uintptr_t positions = end - p - 2;
+    uintptr_t offset = startcode(p, positions);
+    if (offset < positions)
+        offset += upipe_ubuf_block_scan_startcode_c(p + offset,
+                                                    positions - offset);
+    return offset < positions ? p + offset : end;
+}
+
+/** @This finds the first position in a linear buffer where a sync word
+ * repeats the given number of times at a fixed interval, such as the
+ * 0x47 sync bytes of consecutive TS packets.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param word sync word
+ * @param stride distance between sync words, in octets
+ * @param count number of sync words (at least 1)
+ * @return pointer to the first sync word, or end if there is no position
+ * whose sync words all lie in the buffer
+ */
+const uint8_t *ubuf_block_scan_sync(const uint8_t *p, const uint8_t *end,
+                                    uint8_t word, size_t stride,
+                                    unsigned int count)
+{
+    if (unlikely(count < 1))
+        return end;
+    size_t span = (count - 1) * stride;
+    if (end - p <= span)
+        return end;
+    uintptr_t (*sync)(const uint8_t *, uintptr_t, uintptr_t, uintptr_t,
+                      uintptr_t) =
+        __atomic_load_n(&scan_sync, __ATOMIC_ACQUIRE);
+    if (unlikely(sync == NULL)) {
+        ubuf_block_scan_init();
+        sync = __atomic_load_n(&scan_sync, __ATOMIC_ACQUIRE);
+    }
+
+    uintptr_t positions = end - p - span;
+    uintptr_t offset = sync(p, positions, stride, count, word);
+    if (offset < positions)
+        offset += upipe_ubuf_block_scan_sync_c(p + offset, positions - offset,
+                                               stride, count, word);
+    return offset < positions ? p + offset : end;
+}
@@ -0,0 +1,30 @@
+/*
+ * Start code and sync word scanning
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _UBUF_BLOCK_SCAN_H_
+/** @hidden */
+#define _UBUF_BLOCK_SCAN_H_
+
+#include <stdint.h>
+
+/* return the offset of the first 00 00 01 start code among the first
+ * positions octets, or a number of leading positions without start code;
+ * positions + 2 octets may be read */
+uintptr_t upipe_ubuf_block_scan_startcode_c   (const uint8_t *p, uintptr_t positions);
+uintptr_t upipe_ubuf_block_scan_startcode_sse2(const uint8_t *p, uintptr_t positions);
+uintptr_t upipe_ubuf_block_scan_startcode_avx2(const uint8_t *p, uintptr_t positions);
+uintptr_t upipe_ubuf_block_scan_startcode_neon(const uint8_t *p, uintptr_t positions);
+
+/* return the offset of the first octet among the first positions octets
+ * such that it and the (count - 1) octets every stride octets after it are
+ * equal to word, or a number of leading positions without match;
+ * positions + (count - 1) * stride octets may be read */
+uintptr_t upipe_ubuf_block_scan_sync_c   (const uint8_t *p, uintptr_t positions, uintptr_t stride, uintptr_t count, uintptr_t word);
+uintptr_t upipe_ubuf_block_scan_sync_sse2(const uint8_t *p, uintptr_t positions, uintptr_t stride, uintptr_t count, uintptr_t word);
+uintptr_t upipe_ubuf_block_scan_sync_avx2(const uint8_t *p, uintptr_t positions, uintptr_t stride, uintptr_t count, uintptr_t word);
+uintptr_t upipe_ubuf_block_scan_sync_neon(const uint8_t *p, uintptr_t positions, uintptr_t stride, uintptr_t count, uintptr_t word);
+
+#endif
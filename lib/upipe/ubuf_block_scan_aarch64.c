@@ -0,0 +1,56 @@
+/*
+ * Start code and sync word scanning for ARMv8 (NEON)
+ *
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe scanning functions for start codes and sync words using the
+ * NEON instructions
+ * Like the x86 kernels, they only skip the 16-octet blocks without any
+ * match; the exact position is then found by the scalar implementation.
+ */
+
+#include "ubuf_block_scan.h"
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#include <arm_neon.h>
+
+uintptr_t upipe_ubuf_block_scan_startcode_neon(const uint8_t *p,
+                                               uintptr_t positions)
+{
+    const uint8x16_t one = vdupq_n_u8(1);
+    uintptr_t i;
+    for (i = 0; i + 16 <= positions; i += 16) {
+        uint8x16_t a = vld1q_u8(p + i);
+        uint8x16_t b = vld1q_u8(p + i + 1);
+        uint8x16_t c = vld1q_u8(p + i + 2);
+        /* lanes starting a start code are null */
+        uint8x16_t m = vorrq_u8(vorrq_u8(a, b), veorq_u8(c, one));
+        if (!vminvq_u8(m))
+            break;
+    }
+    return i;
+}
+
+uintptr_t upipe_ubuf_block_scan_sync_neon(const uint8_t *p,
+                                          uintptr_t positions,
+                                          uintptr_t stride, uintptr_t count,
+                                          uintptr_t word)
+{
+    const uint8x16_t w = vdupq_n_u8(word);
+    uintptr_t i;
+    for (i = 0; i + 16 <= positions; i += 16) {
+        /* lanes where all the sync words match are set */
+        uint8x16_t m = vceqq_u8(vld1q_u8(p + i), w);
+        for (uintptr_t k = 1; k < count && vmaxvq_u8(m); k++)
+            m = vandq_u8(m, vceqq_u8(vld1q_u8(p + i + k * stride), w));
+        if (vmaxvq_u8(m))
+            break;
+    }
+    return i;
+}
+
+#endif
@@ -0,0 +1,868 @@
+/*
+ * Copyright (C) 2012-2017 OpenHeadend S.A.R.L.
+ * Copyright (C) 2026 EasyTools
+ *
+ * Authors: Christophe Massiot
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe hash-indexed manager of dictionary of attributes
+ * This manager interns the names of attributes into global integer IDs, the
+ * first time they are set, and indexes the attributes of each udict with a
+ * small open-addressed hash table, so that looking up an attribute does not
+ * depend on the number of attributes in the udict. Entries, index and values
+ * are stored in a single umem block.
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/urefcount.h"
+#include "upipe/upool.h"
+#include "upipe/umem.h"
+#include "upipe/udict.h"
+#include "upipe/udict_hash.h"
+#include "udict_shorthand.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/** default minimal size of the values */
+#define UDICT_MIN_SIZE 128
+/** default extra space added on udict expansion */
+#define UDICT_EXTRA_SIZE 64
+/** minimal number of entries */
+#define UDICT_MIN_ENTRIES 16
+/** maximal number of entries */
+#define UDICT_MAX_ENTRIES 0x7ffe
+/** number of slots of the table of interned names (power of 2) */
+#define UDICT_HASH_NAMES 16384
+/** empty slot of the index */
+#define UDICT_HASH_EMPTY 0
+/** deleted slot of the index */
+#define UDICT_HASH_DELETED UINT16_MAX
+/** number of built-in shorthands */
+#define UDICT_HASH_BUILTINS \
+    (sizeof(udict_shorthands) / sizeof(struct udict_shorthand))
+/** maximal number of registered shorthands (types are stored on 8 bits) */
+#define UDICT_HASH_REGISTERED \
+    (UINT8_MAX - UDICT_TYPE_SHORTHAND - UDICT_HASH_BUILTINS)
+
+/** @internal @This is an interned attribute name. */
+struct udict_hash_name {
+    /** hash of the name */
+    uint32_t hash;
+    /** name */
+    char name[];
+};
+
+/** @This stores the interned names, indexed by ID minus one. Slots are
+ * filled in once and never freed. */
+static struct udict_hash_name *udict_hash_names[UDICT_HASH_NAMES];
+
+/** @This stores the registered shorthands, after the built-in ones. */
+static struct udict_shorthand udict_hash_registered[UDICT_HASH_REGISTERED];
+/** number of registered shorthands */
+static unsigned int udict_hash_nb_registered = 0;
+
+/** @internal @This is an attribute of a udict. */
+struct udict_hash_entry {
+    /** type of the attribute in the lower 8 bits and ID of the interned name
+     * above (0 for shorthands), or 0 if the attribute was deleted */
+    uint32_t key;
+    /** offset of the value in the values space */
+    uint32_t offset;
+    /** size of the value */
+    uint32_t size;
+};
+
+/** super-set of the udict_mgr structure with additional local members */
+struct udict_hash_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** minimum space for values at allocation */
+    size_t min_size;
+    /** extra space added when the umem is expanded */
+    size_t extra_size;
+
+    /** udict pool */
+    struct upool udict_pool;
+    /** umem allocator */
+    struct umem_mgr *umem_mgr;
+
+    /** common management structure */
+    struct udict_mgr mgr;
+};
+
+UBASE_FROM_TO(udict_hash_mgr, udict_mgr, udict_mgr, mgr)
+UBASE_FROM_TO(udict_hash_mgr, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(udict_hash_mgr, upool, udict_pool, udict_pool)
+
+/** super-set of the udict structure with additional local members */
+struct udict_hash {
+    /** umem structure pointing to entries, index and values, in this order */
+    struct umem umem;
+    /** maximal number of entries */
+    uint16_t entries_max;
+    /** number of entries, including deleted ones */
+    uint16_t nb_entries;
+    /** number of slots of the index minus one */
+    uint16_t index_mask;
+    /** space for values */
+    size_t values_max;
+    /** used space for values, including deleted ones */
+    size_t values_size;
+
+    /** common structure */
+    struct udict udict;
+};
+
+UBASE_FROM_TO(udict_hash, udict, udict, udict)
+
+/** @internal @This returns the entries of a udict.
+ *
+ * @param hash pointer to udict_hash
+ * @return pointer to the array of entries
+ */
+static inline struct udict_hash_entry *
+    udict_hash_entries(struct udict_hash *hash)
+{
+    return (struct udict_hash_entry *)umem_buffer(&hash->umem);
+}
+
+/** @internal @This returns the index of a udict.
+ *
+ * @param hash pointer to udict_hash
+ * @return pointer to the index slots, containing entry numbers plus one
+ */
+static inline uint16_t *udict_hash_index(struct udict_hash *hash)
+{
+    return (uint16_t *)(udict_hash_entries(hash) + hash->entries_max);
+}
+
+/** @internal @This returns the values space of a udict.
+ *
+ * @param hash pointer to udict_hash
+ * @return pointer to the values space
+ */
+static inline uint8_t *udict_hash_values(struct udict_hash *hash)
+{
+    return (uint8_t *)(udict_hash_index(hash) + hash->index_mask + 1);
+}
+
+/** @internal @This hashes a name (FNV-1a).
+ *
+ * @param name name of the attribute
+ * @return hash
+ */
+static uint32_t udict_hash_string(const char *name)
+{
+    uint32_t hash = UINT32_C(2166136261);
+    while (*name)
+        hash = (hash ^ (uint8_t)*name++) * UINT32_C(16777619);
+    return hash;
+}
+
+/** @internal @This returns the ID of an interned name. The table of names
+ * is insert-only and lock-free.
+ *
+ * @param name name of the attribute
+ * @param create true if the name must be interned if it is not already
+ * @return ID of the name, or 0 if it is not interned
+ */
+static uint32_t udict_hash_intern(const char *name, bool create)
+{
+    uint32_t hash = udict_hash_string(name);
+    for (uint32_t i = 0; i < UDICT_HASH_NAMES; i++) {
+        uint32_t id = ((hash + i) & (UDICT_HASH_NAMES - 1)) + 1;
+        struct udict_hash_name *interned =
+            __atomic_load_n(&udict_hash_names[id - 1], __ATOMIC_ACQUIRE);
+        if (interned == NULL) {
+            if (!create)
+                return 0;
+
+            size_t len = strlen(name);
+            struct udict_hash_name *new_interned =
+                malloc(sizeof(struct udict_hash_name) + len + 1);
+            if (unlikely(new_interned == NULL))
+                return 0;
+            new_interned->hash = hash;
+            memcpy(new_interned->name, name, len + 1);
+            if (__atomic_compare_exchange_n(&udict_hash_names[id - 1],
+                                            &interned, new_interned, false,
+                                            __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE))
+                return id;
+
+            /* another thread filled in the slot */
+            free(new_interned);
+        }
+        if (interned->hash == hash && !strcmp(interned->name, name))
+            return id;
+    }
+    return 0;
+}
+
+/** @internal @This returns the key of an attribute.
+ *
+ * @param name name of the attribute
+ * @param type type of the attribute (potentially a shorthand)
+ * @param create true if the name must be interned if it is not already
+ * @return key of the attribute, or 0 if the name is not interned
+ */
+static inline uint32_t udict_hash_key(const char *name, enum udict_type type,
+                                      bool create)
+{
+    if (likely(type > UDICT_TYPE_SHORTHAND))
+        return type;
+    uint32_t id = udict_hash_intern(name, create);
+    return id ? (id << 8) | type : 0;
+}
+
+/** @internal @This returns the first slot of the index to probe for a key.
+ *
+ * @param key key of the attribute
+ * @return slot number, before masking
+ */
+static inline uint32_t udict_hash_slot(uint32_t key)
+{
+    return (key * UINT32_C(2654435761)) >> 16;
+}
+
+/** @internal @This looks up a shorthand attribute in the lists of built-in
+ * and registered shorthands.
+ *
+ * @param type shorthand attribute
+ * @return pointer to the found shorthand entry, or NULL
+ */
+static const struct udict_shorthand *
+    udict_hash_shorthand(enum udict_type type)
+{
+    if (unlikely(type <= UDICT_TYPE_SHORTHAND))
+        return NULL;
+    unsigned int i = type - UDICT_TYPE_SHORTHAND - 1;
+    if (likely(i < UDICT_HASH_BUILTINS))
+        return &udict_shorthands[i];
+    i -= UDICT_HASH_BUILTINS;
+    if (i < udict_hash_nb_registered)
+        return &udict_hash_registered[i];
+    return NULL;
+}
+
+/** @internal @This finds an attribute from its key.
+ *
+ * @param hash pointer to udict_hash
+ * @param key key of the attribute
+ * @param slot_p filled in with the index slot of the attribute (can be NULL)
+ * @return pointer to the entry, or NULL
+ */
+static struct udict_hash_entry *udict_hash_find(struct udict_hash *hash,
+                                                uint32_t key,
+                                                uint16_t **slot_p)
+{
+    struct udict_hash_entry *entries = udict_hash_entries(hash);
+    uint16_t *index = udict_hash_index(hash);
+
+    /* the index is at most half full, so this terminates */
+    for (uint32_t i = udict_hash_slot(key); ; i++) {
+        uint16_t *slot = &index[i & hash->index_mask];
+        if (*slot == UDICT_HASH_EMPTY)
+            return NULL;
+        if (*slot != UDICT_HASH_DELETED && entries[*slot - 1].key == key) {
+            if (slot_p != NULL)
+                *slot_p = slot;
+            return &entries[*slot - 1];
+        }
+    }
+}
+
+/** @internal @This adds an entry to the index, its key being absent.
+ *
+ * @param hash pointer to udict_hash
+ * @param key key of the attribute
+ * @param entry entry number
+ */
+static void udict_hash_index_add(struct udict_hash *hash, uint32_t key,
+                                 uint16_t entry)
+{
+    uint16_t *index = udict_hash_index(hash);
+    uint32_t i = udict_hash_slot(key);
+    while (index[i & hash->index_mask] != UDICT_HASH_EMPTY &&
+           index[i & hash->index_mask] != UDICT_HASH_DELETED)
+        i++;
+    index[i & hash->index_mask] = entry + 1;
+}
+
+/** @internal @This allocates the buffer of a udict.
+ *
+ * @param mgr common management structure
+ * @param hash pointer to udict_hash
+ * @param entries_max maximal number of entries
+ * @param values_max space for values
+ * @return false in case of allocation error
+ */
+static bool udict_hash_alloc_buffer(struct udict_mgr *mgr,
+                                    struct udict_hash *hash,
+                                    size_t entries_max, size_t values_max)
+{
+    struct udict_hash_mgr *hash_mgr = udict_hash_mgr_from_udict_mgr(mgr);
+    size_t index_size = 2;
+    while (index_size < 2 * entries_max)
+        index_size <<= 1;
+
+    if (unlikely(!umem_alloc(hash_mgr->umem_mgr, &hash->umem,
+                entries_max * sizeof(struct udict_hash_entry) +
+                index_size * sizeof(uint16_t) + values_max)))
+        return false;
+
+    hash->entries_max = entries_max;
+    hash->nb_entries = 0;
+    hash->index_mask = index_size - 1;
+    hash->values_max = values_max;
+    hash->values_size = 0;
+    memset(udict_hash_index(hash), UDICT_HASH_EMPTY,
+           index_size * sizeof(uint16_t));
+    return true;
+}
+
+/** @internal @This copies the attributes of a udict to an empty udict,
+ * dropping deleted attributes.
+ *
+ * @param to pointer to the destination udict_hash, large enough
+ * @param from pointer to the source udict_hash
+ */
+static void udict_hash_copy_entries(struct udict_hash *to,
+                                    struct udict_hash *from)
+{
+    struct udict_hash_entry *entries = udict_hash_entries(from);
+    for (uint16_t i = 0; i < from->nb_entries; i++) {
+        if (entries[i].key == 0)
+            continue;
+        struct udict_hash_entry *entry =
+            &udict_hash_entries(to)[to->nb_entries];
+        entry->key = entries[i].key;
+        entry->offset = to->values_size;
+        entry->size = entries[i].size;
+        memcpy(udict_hash_values(to) + entry->offset,
+               udict_hash_values(from) + entries[i].offset, entry->size);
+        to->values_size += entry->size;
+        udict_hash_index_add(to, entry->key, to->nb_entries++);
+    }
+}
+
+/** @internal @This counts the attributes of a udict that are not deleted.
+ *
+ * @param hash pointer to udict_hash
+ * @param values_size_p filled in with the size of their values
+ * @return number of attributes
+ */
+static size_t udict_hash_count(struct udict_hash *hash, size_t *values_size_p)
+{
+    struct udict_hash_entry *entries = udict_hash_entries(hash);
+    size_t count = 0;
+    *values_size_p = 0;
+    for (uint16_t i = 0; i < hash->nb_entries; i++)
+        if (entries[i].key != 0) {
+            count++;
+            *values_size_p += entries[i].size;
+        }
+    return count;
+}
+
+/** @internal @This makes room for a new attribute, reallocating the buffer
+ * and dropping deleted attributes.
+ *
+ * @param hash pointer to udict_hash
+ * @param attr_size size of the value of the new attribute
+ * @return an error code
+ */
+static int udict_hash_grow(struct udict_hash *hash, size_t attr_size)
+{
+    struct udict_hash_mgr *hash_mgr =
+        udict_hash_mgr_from_udict_mgr(hash->udict.mgr);
+    size_t values_size;
+    size_t count = udict_hash_count(hash, &values_size);
+    if (unlikely(count + 1 > UDICT_MAX_ENTRIES))
+        return UBASE_ERR_NOSPC;
+
+    size_t entries_max = hash->entries_max;
+    if (count + 1 > entries_max * 3 / 4)
+        entries_max *= 2;
+    if (entries_max > UDICT_MAX_ENTRIES)
+        entries_max = UDICT_MAX_ENTRIES;
+    size_t values_max = hash->values_max;
+    if (values_size + attr_size > values_max)
+        values_max = values_size + attr_size + hash_mgr->extra_size;
+
+    struct udict_hash new_hash;
+    if (unlikely(!udict_hash_alloc_buffer(hash->udict.mgr, &new_hash,
+                                          entries_max, values_max)))
+        return UBASE_ERR_ALLOC;
+    udict_hash_copy_entries(&new_hash, hash);
+
+    umem_free(&hash->umem);
+    hash->umem = new_hash.umem;
+    hash->entries_max = new_hash.entries_max;
+    hash->nb_entries = new_hash.nb_entries;
+    hash->index_mask = new_hash.index_mask;
+    hash->values_max = new_hash.values_max;
+    hash->values_size = new_hash.values_size;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This allocates a udict with the given capacities.
+ *
+ * @param mgr common management structure
+ * @param entries_max maximal number of entries
+ * @param values_max space for values
+ * @return pointer to udict or NULL in case of allocation error
+ */
+static struct udict *_udict_hash_alloc(struct udict_mgr *mgr,
+                                       size_t entries_max, size_t values_max)
+{
+    struct udict_hash_mgr *hash_mgr = udict_hash_mgr_from_udict_mgr(mgr);
+    struct udict_hash *hash = upool_alloc(&hash_mgr->udict_pool,
+                                          struct udict_hash *);
+    if (unlikely(hash == NULL))
+        return NULL;
+
+    if (entries_max < UDICT_MIN_ENTRIES)
+        entries_max = UDICT_MIN_ENTRIES;
+    if (values_max < hash_mgr->min_size)
+        values_max = hash_mgr->min_size;
+    if (unlikely(!udict_hash_alloc_buffer(mgr, hash, entries_max,
+                                          values_max))) {
+        upool_free(&hash_mgr->udict_pool, hash);
+        return NULL;
+    }
+    return udict_hash_to_udict(hash);
+}
+
+/** @This allocates a udict with attributes space.
+ *
+ * @param mgr common management structure
+ * @param size initial size of the values space
+ * @return pointer to udict or NULL in case of allocation error
+ */
+static struct udict *udict_hash_alloc(struct udict_mgr *mgr, size_t size)
+{
+    return _udict_hash_alloc(mgr, UDICT_MIN_ENTRIES, size);
+}
+
+/** @This duplicates a given udict.
+ *
+ * @param udict pointer to udict
+ * @param new_udict_p reference written with a pointer to the newly allocated
+ * udict
+ * @return an error code
+ */
+static int udict_hash_dup(struct udict *udict, struct udict **new_udict_p)
+{
+    assert(new_udict_p != NULL);
+    struct udict_hash *hash = udict_hash_from_udict(udict);
+    size_t values_size;
+    size_t count = udict_hash_count(hash, &values_size);
+    struct udict *new_udict = _udict_hash_alloc(udict->mgr, count,
+                                                values_size);
+    if (unlikely(new_udict == NULL))
+        return UBASE_ERR_ALLOC;
+
+    udict_hash_copy_entries(udict_hash_from_udict(new_udict), hash);
+    *new_udict_p = new_udict;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This finds an attribute of the given name and type and returns
+ * the name and type of the next attribute.
+ *
+ * @param udict pointer to the udict
+ * @param name_p reference to the name of the attribute to find, changed during
+ * execution to the name of the next attribute, or NULL if it is a shorthand
+ * @param type_p reference to the type of the attribute, changed to
+ * UDICT_TYPE_END at the end of the iteration; start with UDICT_TYPE_END as well
+ */
+static void udict_hash_iterate(struct udict *udict, const char **name_p,
+                               enum udict_type *type_p)
+{
+    assert(name_p != NULL);
+    assert(type_p != NULL);
+    struct udict_hash *hash = udict_hash_from_udict(udict);
+    struct udict_hash_entry *entries = udict_hash_entries(hash);
+    uint16_t i = 0;
+
+    if (likely(*type_p != UDICT_TYPE_END)) {
+        uint32_t key = udict_hash_key(*name_p, *type_p, false);
+        struct udict_hash_entry *entry =
+            key ? udict_hash_find(hash, key, NULL) : NULL;
+        if (unlikely(entry == NULL)) {
+            *type_p = UDICT_TYPE_END;
+            return;
+        }
+        i = entry - entries + 1;
+    }
+    while (i < hash->nb_entries && entries[i].key == 0)
+        i++;
+    if (unlikely(i >= hash->nb_entries)) {
+        *type_p = UDICT_TYPE_END;
+        return;
+    }
+
+    uint32_t key = entries[i].key;
+    *type_p = key & 0xff;
+    *name_p = *type_p > UDICT_TYPE_SHORTHAND ? NULL :
+              udict_hash_names[(key >> 8) - 1]->name;
+}
+
+/** @internal @This finds an attribute (shorthand or not) of the given name
+ * and type and returns a pointer to the beginning of its value.
+ *
+ * @param udict pointer to the udict
+ * @param name name of the attribute
+ * @param type type of the attribute (potentially a shorthand)
+ * @param size_p size of the value, written on execution (can be NULL)
+ * @param attr_p pointer to the value of the found attribute, written on
+ * execution
+ * @return an error code
+ */
+static int udict_hash_get(struct udict *udict, const char *name,
+                          enum udict_type type, size_t *size_p,
+                          const uint8_t **attr_p)
+{
+    struct udict_hash *hash = udict_hash_from_udict(udict);
+    uint32_t key = udict_hash_key(name, type, false);
+    struct udict_hash_entry *entry =
+        key ? udict_hash_find(hash, key, NULL) : NULL;
+    if (unlikely(entry == NULL))
+        return UBASE_ERR_INVALID;
+
+    if (size_p != NULL)
+        *size_p = entry->size;
+    if (attr_p != NULL)
+        *attr_p = udict_hash_values(hash) + entry->offset;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This deletes an attribute.
+ *
+ * @param udict pointer to the udict
+ * @param name name of the attribute
+ * @param type type of the attribute
+ * @return an error code
+ */
+static int udict_hash_delete(struct udict *udict, const char *name,
+                             enum udict_type type)
+{
+    assert(type != UDICT_TYPE_END);
+    struct udict_hash *hash = udict_hash_from_udict(udict);
+    uint32_t key = udict_hash_key(name, type, false);
+    uint16_t *slot;
+    struct udict_hash_entry *entry =
+        key ? udict_hash_find(hash, key, &slot) : NULL;
+    if (unlikely(entry == NULL))
+        return UBASE_ERR_INVALID;
+
+    entry->key = 0;
+    *slot = UDICT_HASH_DELETED;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This adds or changes an attribute (excluding the value itself).
+ *
+ * @param udict pointer to the udict
+ * @param name name of the attribute
+ * @param type type of the attribute
+ * @param attr_size size needed to store the value of the attribute
+ * @param attr_p pointer to the value of the attribute
+ * @return an error code
+ */
+static int udict_hash_set(struct udict *udict, const char *name,
+                          enum udict_type type, size_t attr_size,
+                          uint8_t **attr_p)
+{
+    struct udict_hash *hash = udict_hash_from_udict(udict);
+    enum udict_type base_type = type;
+    if (likely(type > UDICT_TYPE_SHORTHAND)) {
+        const struct udict_shorthand *shorthand = udict_hash_shorthand(type);
+        if (unlikely(shorthand == NULL))
+            return UBASE_ERR_INVALID;
+        base_type = shorthand->base_type;
+    }
+
+    uint32_t key = udict_hash_key(name, type, true);
+    if (unlikely(key == 0))
+        return UBASE_ERR_ALLOC;
+
+    /* check if it already exists */
+    uint16_t *slot;
+    struct udict_hash_entry *entry = udict_hash_find(hash, key, &slot);
+    if (unlikely(entry != NULL)) {
+        if ((base_type != UDICT_TYPE_OPAQUE &&
+             base_type != UDICT_TYPE_STRING) ||
+            entry->size == attr_size) {
+            if (attr_p != NULL)
+                *attr_p = udict_hash_values(hash) + entry->offset;
+            return UBASE_ERR_NONE;
+        }
+        entry->key = 0;
+        *slot = UDICT_HASH_DELETED;
+    }
+
+    if (unlikely(hash->nb_entries >= hash->entries_max ||
+                 hash->values_size + attr_size > hash->values_max))
+        UBASE_RETURN(udict_hash_grow(hash, attr_size));
+
+    entry = &udict_hash_entries(hash)[hash->nb_entries];
+    entry->key = key;
+    entry->offset = hash->values_size;
+    entry->size = attr_size;
+    udict_hash_index_add(hash, key, hash->nb_entries++);
+    hash->values_size += attr_size;
+
+    if (attr_p != NULL)
+        *attr_p = udict_hash_values(hash) + entry->offset;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This names a shorthand attribute.
+ *
+ * @param type shorthand type
+ * @param name_p filled in with the name of the shorthand attribute
+ * @param base_type_p filled in with the base type of the shorthand attribute
+ * @return an error code
+ */
+static int udict_hash_name(enum udict_type type, const char **name_p,
+                           enum udict_type *base_type_p)
+{
+    const struct udict_shorthand *shorthand = udict_hash_shorthand(type);
+    if (unlikely(shorthand == NULL))
+        return UBASE_ERR_INVALID;
+
+    *name_p = shorthand->name;
+    *base_type_p = shorthand->base_type;
+    return UBASE_ERR_NONE;
+}
+
+/** @This registers a new shorthand attribute type, in addition to the
+ * built-in ones, for use with the hash udict manager. Registering an
+ * existing name returns the type already allocated. This is not thread-safe
+ * and is intended to be called at initialization, before the type is used.
+ *
+ * @param name name of the attribute
+ * @param base_type base type of the attribute
+ * @param type_p filled in with the shorthand type
+ * @return an error code
+ */
+int udict_hash_register_shorthand(const char *name, enum udict_type base_type,
+                                  enum udict_type *type_p)
+{
+    if (unlikely(name == NULL || base_type == UDICT_TYPE_END ||
+                 base_type > UDICT_TYPE_FLOAT))
+        return UBASE_ERR_INVALID;
+
+    unsigned int nb_shorthands = UDICT_HASH_BUILTINS +
+                                 udict_hash_nb_registered;
+    for (unsigned int i = 0; i < nb_shorthands; i++) {
+        enum udict_type type = UDICT_TYPE_SHORTHAND + 1 + i;
+        const struct udict_shorthand *shorthand = udict_hash_shorthand(type);
+        if (!strcmp(shorthand->name, name)) {
+            if (shorthand->base_type != base_type)
+                return UBASE_ERR_INVALID;
+            if (type_p != NULL)
+                *type_p = type;
+            return UBASE_ERR_NONE;
+        }
+    }
+
+    if (unlikely(udict_hash_nb_registered >= UDICT_HASH_REGISTERED))
+        return UBASE_ERR_NOSPC;
+    char *registered_name = strdup(name);
+    if (unlikely(registered_name == NULL))
+        return UBASE_ERR_ALLOC;
+
+    struct udict_shorthand *shorthand =
+        &udict_hash_registered[udict_hash_nb_registered++];
+    shorthand->name = registered_name;
+    shorthand->base_type = base_type;
+    if (type_p != NULL)
+        *type_p = UDICT_TYPE_SHORTHAND + nb_shorthands + 1;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param udict pointer to udict
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int udict_hash_control(struct udict *udict, int command, va_list args)
+{
+    switch (command) {
+        case UDICT_DUP: {
+            struct udict **udict_p = va_arg(args, struct udict **);
+            return udict_hash_dup(udict, udict_p);
+        }
+        case UDICT_ITERATE: {
+            const char **name_p = va_arg(args, const char **);
+            enum udict_type *type_p = va_arg(args, enum udict_type *);
+            udict_hash_iterate(udict, name_p, type_p);
+            return UBASE_ERR_NONE;
+        }
+        case UDICT_GET: {
+            const char *name = va_arg(args, const char *);
+            enum udict_type type = va_arg(args, enum udict_type);
+            size_t *size_p = va_arg(args, size_t *);
+            const uint8_t **attr_p = va_arg(args, const uint8_t **);
+            return udict_hash_get(udict, name, type, size_p, attr_p);
+        }
+        case UDICT_SET: {
+            const char *name = va_arg(args, const char *);
+            enum udict_type type = va_arg(args, enum udict_type);
+            size_t size = va_arg(args, size_t);
+            uint8_t **attr_p = va_arg(args, uint8_t **);
+            return udict_hash_set(udict, name, type, size, attr_p);
+        }
+        case UDICT_DELETE: {
+            const char *name = va_arg(args, const char *);
+            enum udict_type type = va_arg(args, enum udict_type);
+            return udict_hash_delete(udict, name, type);
+        }
+        case UDICT_NAME: {
+            enum udict_type type = va_arg(args, enum udict_type);
+            const char **name_p = va_arg(args, const char **);
+            enum udict_type *base_type_p = va_arg(args, enum udict_type *);
+            return udict_hash_name(type, name_p, base_type_p);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a udict.
+ *
+ * @param udict pointer to a udict structure to free
+ */
+static void udict_hash_free(struct udict *udict)
+{
+    struct udict_hash_mgr *hash_mgr =
+        udict_hash_mgr_from_udict_mgr(udict->mgr);
+    struct udict_hash *hash = udict_hash_from_udict(udict);
+
+    umem_free(&hash->umem);
+    upool_free(&hash_mgr->udict_pool, hash);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to udict_hash or NULL in case of allocation error
+ */
+static void *udict_hash_alloc_inner(struct upool *upool)
+{
+    struct udict_hash_mgr *hash_mgr = udict_hash_mgr_from_udict_pool(upool);
+    struct udict_hash *hash = malloc(sizeof(struct udict_hash));
+    if (unlikely(hash == NULL))
+        return NULL;
+    struct udict *udict = udict_hash_to_udict(hash);
+    udict->mgr = udict_hash_mgr_to_udict_mgr(hash_mgr);
+    return hash;
+}
+
+/** @internal @This frees a udict_hash.
+ *
+ * @param upool pointer to upool
+ * @param hash pointer to a udict_hash structure to free
+ */
+static void udict_hash_free_inner(struct upool *upool, void *hash)
+{
+    free(hash);
+}
+
+/** @internal @This instructs an existing udict manager to release all
+ * structures currently kept in pools. It is intended as a debug tool only.
+ *
+ * @param mgr pointer to udict manager
+ */
+static void udict_hash_mgr_vacuum(struct udict_mgr *mgr)
+{
+    struct udict_hash_mgr *hash_mgr = udict_hash_mgr_from_udict_mgr(mgr);
+    upool_vacuum(&hash_mgr->udict_pool);
+}
+
+/** @This processes control commands on a udict_hash_mgr.
+ *
+ * @param mgr pointer to a udict_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int udict_hash_mgr_control(struct udict_mgr *mgr,
+                                  int command, va_list args)
+{
+    switch (command) {
+        case UDICT_MGR_VACUUM:
+            udict_hash_mgr_vacuum(mgr);
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a udict manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void udict_hash_mgr_free(struct urefcount *urefcount)
+{
+    struct udict_hash_mgr *hash_mgr =
+        udict_hash_mgr_from_urefcount(urefcount);
+
+    upool_clean(&hash_mgr->udict_pool);
+    umem_mgr_release(hash_mgr->umem_mgr);
+
+    urefcount_clean(urefcount);
+    free(hash_mgr);
+}
+
+/** @This allocates a new instance of the hash udict manager.
+ *
+ * @param udict_pool_depth maximum number of udict structures in the pool
+ * @param umem_mgr memory allocator to use for buffers
+ * @param min_size minimum allocated space for the values of the udict (if
+ * set to -1, a default sensible value is used)
+ * @param extra_size extra space added when the udict needs to be resized
+ * (if set to -1, a default sensible value is used)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct udict_mgr *udict_hash_mgr_alloc(uint16_t udict_pool_depth,
+                                       struct umem_mgr *umem_mgr,
+                                       int min_size, int extra_size)
+{
+    struct udict_hash_mgr *hash_mgr =
+        malloc(sizeof(struct udict_hash_mgr) +
+               upool_sizeof(udict_pool_depth));
+    if (unlikely(hash_mgr == NULL))
+        return NULL;
+
+    urefcount_init(udict_hash_mgr_to_urefcount(hash_mgr),
+                   udict_hash_mgr_free);
+    hash_mgr->mgr.refcount = udict_hash_mgr_to_urefcount(hash_mgr);
+    hash_mgr->mgr.udict_alloc = udict_hash_alloc;
+    hash_mgr->mgr.udict_control = udict_hash_control;
+    hash_mgr->mgr.udict_free = udict_hash_free;
+    hash_mgr->mgr.udict_mgr_control = udict_hash_mgr_control;
+
+    upool_init(&hash_mgr->udict_pool, hash_mgr->mgr.refcount,
+               udict_pool_depth,
+               (void *)hash_mgr + sizeof(struct udict_hash_mgr),
+               udict_hash_alloc_inner, udict_hash_free_inner);
+    hash_mgr->umem_mgr = umem_mgr;
+    umem_mgr_use(umem_mgr);
+
+    hash_mgr->min_size = min_size > 0 ? min_size : UDICT_MIN_SIZE;
+    hash_mgr->extra_size = extra_size > 0 ? extra_size : UDICT_EXTRA_SIZE;
+
+    return udict_hash_mgr_to_udict_mgr(hash_mgr);
+}
@@ -20,6 +20,7 @@
 #include "upipe/umem.h"
 #include "upipe/udict.h"
 #include "upipe/udict_inline.h"
+#include "udict_shorthand.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -31,64 +32,6 @@
 /** default extra space added on udict expansion */
 #define UDICT_EXTRA_SIZE 64
 
-/** @internal @This represents a shorthand attribute type. */
-struct inline_shorthand {
-    /** name of the attribute */
-    const char *name;
-    /** base type of the attribute */
-    enum udict_type base_type;
-};
-
-/** @This stores a list of inline_shorthands attributes.
- *
- * Please note that the code expects the first line to be
- * UDICT_TYPE_SHORTHAND + 1.
- */
-static const struct inline_shorthand inline_shorthands[] = {
-    { "f.random", UDICT_TYPE_VOID },
-    { "f.error", UDICT_TYPE_VOID },
-    { "f.def", UDICT_TYPE_STRING },
-    { "f.id", UDICT_TYPE_UNSIGNED },
-    { "f.rawdef", UDICT_TYPE_STRING },
-    { "f.langs", UDICT_TYPE_SMALL_UNSIGNED },
-
-    { "e.events", UDICT_TYPE_UNSIGNED },
-
-    { "k.duration", UDICT_TYPE_UNSIGNED },
-    { "k.rate", UDICT_TYPE_RATIONAL },
-    { "k.latency", UDICT_TYPE_UNSIGNED },
-    { "k.wrap", UDICT_TYPE_UNSIGNED },
-
-    { "b.end", UDICT_TYPE_VOID },
-
-    { "p.num", UDICT_TYPE_UNSIGNED },
-    { "p.key", UDICT_TYPE_VOID },
-    { "p.hsize", UDICT_TYPE_UNSIGNED },
-    { "p.vsize", UDICT_TYPE_UNSIGNED },
-    { "p.hsizevis", UDICT_TYPE_UNSIGNED },
-    { "p.vsizevis", UDICT_TYPE_UNSIGNED },
-    { "p.format", UDICT_TYPE_STRING },
-    { "p.fullrange", UDICT_TYPE_VOID },
-    { "p.colorprim", UDICT_TYPE_STRING },
-    { "p.transfer", UDICT_TYPE_STRING },
-    { "p.colmatrix", UDICT_TYPE_STRING },
-    { "p.hposition", UDICT_TYPE_UNSIGNED },
-    { "p.vposition", UDICT_TYPE_UNSIGNED },
-    { "p.lpadding", UDICT_TYPE_UNSIGNED },
-    { "p.rpadding", UDICT_TYPE_UNSIGNED },
-    { "p.tpadding", UDICT_TYPE_UNSIGNED },
-    { "p.bpadding", UDICT_TYPE_UNSIGNED },
-    { "p.sar", UDICT_TYPE_RATIONAL },
-    { "p.overscan", UDICT_TYPE_BOOL },
-    { "p.progressive", UDICT_TYPE_BOOL },
-    { "p.tf", UDICT_TYPE_VOID },
-    { "p.bf", UDICT_TYPE_VOID },
-    { "p.tff", UDICT_TYPE_BOOL },
-    { "p.afd", UDICT_TYPE_SMALL_UNSIGNED },
-    { "p.cea_708", UDICT_TYPE_OPAQUE },
-    { "p.bar_data", UDICT_TYPE_OPAQUE },
-};
-
 /** @This stores the size of the value of basic attribute types. */
 static const size_t attr_sizes[] = { 0, 0, 0, 0, 1, 1, 1, 8, 8, 16, 8 };
 
@@ -108,7 +51,7 @@ struct udict_inline_mgr {
     struct umem_mgr *umem_mgr;
 
 #ifdef STATS
-    uint64_t stats[sizeof(inline_shorthands) / sizeof(struct inline_shorthand)];
+    uint64_t stats[sizeof(udict_shorthands) / sizeof(struct udict_shorthand)];
 #endif
 
     /** common management structure */
@@ -187,13 +130,13 @@ static int udict_inline_dup(struct udict *udict, struct udict **new_udict_p)
  * @param type shorthand attribute
  * @return pointer to the found shorthand entry, or NULL
  */
-static const struct inline_shorthand *
+static const struct udict_shorthand *
     udict_inline_shorthand(enum udict_type type)
 {
-    if (unlikely(type > UDICT_TYPE_SHORTHAND + 1 + sizeof(inline_shorthands) /
-                                               sizeof(struct inline_shorthand)))
+    if (unlikely(type > UDICT_TYPE_SHORTHAND + 1 + sizeof(udict_shorthands) /
+                                               sizeof(struct udict_shorthand)))
         return NULL;
-    return &inline_shorthands[type - UDICT_TYPE_SHORTHAND - 1];
+    return &udict_shorthands[type - UDICT_TYPE_SHORTHAND - 1];
 }
 
 /** @internal @This jumps to the next attribute.
@@ -207,7 +150,7 @@ static uint8_t *udict_inline_next(uint8_t *attr)
         return NULL;
 
     if (likely(*attr > UDICT_TYPE_SHORTHAND)) {
-        const struct inline_shorthand *shorthand =
+        const struct udict_shorthand *shorthand =
             udict_inline_shorthand(*attr);
         if (unlikely(shorthand == NULL))
             return NULL;
@@ -225,7 +168,7 @@ static uint8_t *udict_inline_next(uint8_t *attr)
  *
  * @param udict pointer to the udict
  * @param name name of the attribute
- * @param type type of the attribute (excluding inline_shorthands)
+ * @param type type of the attribute (excluding udict_shorthands)
  * @return pointer to the attribute, or NULL
  */
 static uint8_t *udict_inline_find(struct udict *udict, const char *name,
@@ -287,7 +230,7 @@ static void udict_inline_iterate(struct udict *udict, const char **name_p,
  *
  * @param udict pointer to the udict
  * @param name name of the attribute
- * @param type type of the attribute (excluding inline_shorthands)
+ * @param type type of the attribute (excluding udict_shorthands)
  * @param size_p size of the value, written on execution (can be NULL)
  * @return pointer to the value of the found attribute, or NULL
  */
@@ -299,7 +242,7 @@ static uint8_t *_udict_inline_get(struct udict *udict, const char *name,
         return NULL;
 
     if (likely(type > UDICT_TYPE_SHORTHAND)) {
-        const struct inline_shorthand *shorthand =
+        const struct udict_shorthand *shorthand =
             udict_inline_shorthand(*attr);
         if (unlikely(shorthand == NULL))
             return NULL;
@@ -331,7 +274,7 @@ static uint8_t *_udict_inline_get(struct udict *udict, const char *name,
  *
  * @param udict pointer to the udict
  * @param name name of the attribute
- * @param type type of the attribute (excluding inline_shorthands)
+ * @param type type of the attribute (excluding udict_shorthands)
  * @param size_p size of the value, written on execution (can be NULL)
  * @param attr_p pointer to the value of the found attribute, written on
  * execution
@@ -385,7 +328,7 @@ static int udict_inline_set(struct udict *udict, const char *name,
                             uint8_t **attr_p)
 {
     struct udict_inline *inl = udict_inline_from_udict(udict);
-    const struct inline_shorthand *shorthand = NULL;
+    const struct udict_shorthand *shorthand = NULL;
     enum udict_type base_type = type;
     if (likely(type > UDICT_TYPE_SHORTHAND)) {
         shorthand = udict_inline_shorthand(type);
@@ -473,7 +416,7 @@ static int udict_inline_name(enum udict_type type, const char **name_p,
     if (type <= UDICT_TYPE_SHORTHAND)
         return UBASE_ERR_INVALID;
 
-    const struct inline_shorthand *shorthand = udict_inline_shorthand(type);
+    const struct udict_shorthand *shorthand = udict_inline_shorthand(type);
     if (unlikely(shorthand == NULL))
         return UBASE_ERR_INVALID;
 
@@ -613,7 +556,7 @@ static void udict_inline_mgr_free(struct urefcount *urefcount)
         udict_inline_mgr_from_urefcount(urefcount);
 #ifdef STATS
     int i;
-    for (i = 0; i < sizeof(inline_shorthands) / sizeof(struct inline_shorthand);
+    for (i = 0; i < sizeof(udict_shorthands) / sizeof(struct udict_shorthand);
          i++) {
         const char *name;
         enum udict_type base_type;
@@ -669,7 +612,7 @@ struct udict_mgr *udict_inline_mgr_alloc(uint16_t udict_pool_depth,
 
 #ifdef STATS
     int i;
-    for (i = 0; i < sizeof(inline_shorthands) / sizeof(struct inline_shorthand);
+    for (i = 0; i < sizeof(udict_shorthands) / sizeof(struct udict_shorthand);
          i++)
         inline_mgr->stats[i] = 0;
 #endif
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2012-2017 OpenHeadend S.A.R.L.
+ * Copyright (C) 2026 EasyTools
+ *
+ * Authors: Christophe Massiot
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe built-in shorthand attributes, shared by the udict managers
+ */
+
+#ifndef _UPIPE_UDICT_SHORTHAND_H_
+/** @hidden */
+#define _UPIPE_UDICT_SHORTHAND_H_
+
+#include "upipe/udict.h"
+
+/** @internal @This represents a shorthand attribute type. */
+struct udict_shorthand {
+    /** name of the attribute */
+    const char *name;
+    /** base type of the attribute */
+    enum udict_type base_type;
+};
+
+/** @This stores the list of built-in shorthand attributes.
+ *
+ * Please note that the code expects the first line to be
+ * UDICT_TYPE_SHORTHAND + 1.
+ */
+static const struct udict_shorthand udict_shorthands[] = {
+    { "f.random", UDICT_TYPE_VOID },
+    { "f.error", UDICT_TYPE_VOID },
+    { "f.def", UDICT_TYPE_STRING },
+    { "f.id", UDICT_TYPE_UNSIGNED },
+    { "f.rawdef", UDICT_TYPE_STRING },
+    { "f.langs", UDICT_TYPE_SMALL_UNSIGNED },
+
+    { "e.events", UDICT_TYPE_UNSIGNED },
+
+    { "k.duration", UDICT_TYPE_UNSIGNED },
+    { "k.rate", UDICT_TYPE_RATIONAL },
+    { "k.latency", UDICT_TYPE_UNSIGNED },
+    { "k.wrap", UDICT_TYPE_UNSIGNED },
+
+    { "b.end", UDICT_TYPE_VOID },
+
+    { "p.num", UDICT_TYPE_UNSIGNED },
+    { "p.key", UDICT_TYPE_VOID },
+    { "p.hsize", UDICT_TYPE_UNSIGNED },
+    { "p.vsize", UDICT_TYPE_UNSIGNED },
+    { "p.hsizevis", UDICT_TYPE_UNSIGNED },
+    { "p.vsizevis", UDICT_TYPE_UNSIGNED },
+    { "p.format", UDICT_TYPE_STRING },
+    { "p.fullrange", UDICT_TYPE_VOID },
+    { "p.colorprim", UDICT_TYPE_STRING },
+    { "p.transfer", UDICT_TYPE_STRING },
+    { "p.colmatrix", UDICT_TYPE_STRING },
+    { "p.hposition", UDICT_TYPE_UNSIGNED },
+    { "p.vposition", UDICT_TYPE_UNSIGNED },
+    { "p.lpadding", UDICT_TYPE_UNSIGNED },
+    { "p.rpadding", UDICT_TYPE_UNSIGNED },
+    { "p.tpadding", UDICT_TYPE_UNSIGNED },
+    { "p.bpadding", UDICT_TYPE_UNSIGNED },
+    { "p.sar", UDICT_TYPE_RATIONAL },
+    { "p.overscan", UDICT_TYPE_BOOL },
+    { "p.progressive", UDICT_TYPE_BOOL },
+    { "p.tf", UDICT_TYPE_VOID },
+    { "p.bf", UDICT_TYPE_VOID },
+    { "p.tff", UDICT_TYPE_BOOL },
+    { "p.afd", UDICT_TYPE_SMALL_UNSIGNED },
+    { "p.cea_708", UDICT_TYPE_OPAQUE },
+    { "p.bar_data", UDICT_TYPE_OPAQUE },
+};
+
+#endif
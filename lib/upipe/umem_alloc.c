@@ -107,6 +107,7 @@ struct umem_mgr *umem_alloc_mgr_alloc(void)
     alloc_mgr->mgr.umem_realloc = umem_alloc_realloc;
     alloc_mgr->mgr.umem_free = umem_alloc_free;
     alloc_mgr->mgr.umem_mgr_vacuum = NULL;
+    alloc_mgr->mgr.umem_mgr_get_stats = NULL;
 
     return umem_alloc_mgr_to_umem_mgr(alloc_mgr);
 }
@@ -0,0 +1,681 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "config.h"
+
+#include "upipe/ubase.h"
+#include "upipe/urefcount.h"
+#include "upipe/uatomic.h"
+#include "upipe/upool.h"
+#include "upipe/umem.h"
+#include "upipe/umem_arena.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_MEMPOLICY
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+/** depth of the pool in front of each size class */
+#define UMEM_ARENA_POOL_DEPTH 64
+/** size of a huge page */
+#define UMEM_ARENA_HUGE_PAGE (2 * 1024 * 1024)
+/** alignment of small buffers, and granularity of the region */
+#define UMEM_ARENA_ALIGN 64
+/** number of size classes per power of 2 */
+#define UMEM_ARENA_STEPS 4
+/** number of busy-waiting iterations before yielding the processor */
+#define UMEM_ARENA_SPIN 64
+/** maximum number of NUMA nodes */
+#define UMEM_ARENA_MAX_NODES 1024
+
+/** @This defines a size class of buffers. */
+struct umem_arena_class {
+    /** pool of buffers in front of the free list */
+    struct upool upool;
+    /** size (in octets) of the buffers */
+    size_t size;
+    /** list of free buffers, linked through their first octets */
+    void *free_list;
+    /** pointer to the arena manager */
+    struct umem_arena_mgr *arena_mgr;
+};
+
+UBASE_FROM_TO(umem_arena_class, upool, upool, upool)
+
+/** @This describes a free extent of the region, stored in its first
+ * octets. */
+struct umem_arena_extent {
+    /** next free extent, at a higher address */
+    struct umem_arena_extent *next;
+    /** size (in octets) of the extent */
+    size_t size;
+};
+
+/** @This defines the private data structures of the umem arena manager. */
+struct umem_arena_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** common management structure */
+    struct umem_mgr mgr;
+
+    /** start of the reserved memory */
+    void *map;
+    /** size of the reserved memory */
+    size_t map_size;
+    /** start of the region, aligned on a huge page */
+    uint8_t *base;
+    /** size of the region */
+    size_t size;
+    /** free extents of the region, sorted by address and merged */
+    struct umem_arena_extent *extents;
+    /** number of buffers in the free lists of the classes */
+    size_t nb_free;
+    /** lock protecting the free lists and the extents */
+    uatomic_uint32_t lock;
+
+    /** number of size classes */
+    unsigned int nb_classes;
+    /** size classes */
+    struct umem_arena_class classes[];
+};
+
+UBASE_FROM_TO(umem_arena_mgr, umem_mgr, umem_mgr, mgr)
+UBASE_FROM_TO(umem_arena_mgr, urefcount, urefcount, urefcount)
+
+/** @internal @This takes the lock of the arena.
+ *
+ * @param arena_mgr pointer to the arena manager
+ */
+static inline void umem_arena_lock(struct umem_arena_mgr *arena_mgr)
+{
+    uint32_t unlocked = 0;
+    unsigned int spin = 0;
+    while (!uatomic_compare_exchange(&arena_mgr->lock, &unlocked, 1)) {
+        do {
+            if (++spin < UMEM_ARENA_SPIN)
+                uatomic_relax();
+            else
+                sched_yield();
+        } while (uatomic_load(&arena_mgr->lock));
+        unlocked = 0;
+    }
+}
+
+/** @internal @This releases the lock of the arena.
+ *
+ * @param arena_mgr pointer to the arena manager
+ */
+static inline void umem_arena_unlock(struct umem_arena_mgr *arena_mgr)
+{
+    uatomic_store(&arena_mgr->lock, 0);
+}
+
+/** @internal @This returns the space taken in the region by a buffer.
+ *
+ * @param size size (in octets) of the buffer
+ * @return size (in octets) rounded up to the granularity of the region
+ */
+static inline size_t umem_arena_footprint(size_t size)
+{
+    return (size + UMEM_ARENA_ALIGN - 1) & ~(size_t)(UMEM_ARENA_ALIGN - 1);
+}
+
+/** @internal @This carves a buffer from the first free extent large enough,
+ * and keeps what remains of the extent on both sides. It must be called with
+ * the lock held.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param size size (in octets) of the buffer
+ * @return pointer to the buffer, or NULL if no extent is large enough
+ */
+static void *umem_arena_carve(struct umem_arena_mgr *arena_mgr, size_t size)
+{
+    uintptr_t align = size < UMEM_ARENA_HUGE_PAGE ?
+                      UMEM_ARENA_ALIGN : UMEM_ARENA_HUGE_PAGE;
+    size = umem_arena_footprint(size);
+
+    struct umem_arena_extent **extent_p = &arena_mgr->extents;
+    for ( ; *extent_p != NULL; extent_p = &(*extent_p)->next) {
+        struct umem_arena_extent *extent = *extent_p;
+        uintptr_t start = (uintptr_t)extent;
+        uintptr_t end = start + extent->size;
+        uintptr_t buffer = (start + align - 1) & ~(align - 1);
+        if (buffer > end || size > end - buffer)
+            continue;
+
+        struct umem_arena_extent *next = extent->next;
+        if (buffer + size < end) {
+            struct umem_arena_extent *after =
+                (struct umem_arena_extent *)(buffer + size);
+            after->next = next;
+            after->size = end - buffer - size;
+            next = after;
+        }
+        if (buffer > start) {
+            extent->next = next;
+            extent->size = buffer - start;
+        } else
+            *extent_p = next;
+        return (void *)buffer;
+    }
+    return NULL;
+}
+
+/** @internal @This merges two lists of extents sorted by address.
+ *
+ * @param a first list
+ * @param b second list
+ * @return merged list
+ */
+static struct umem_arena_extent *
+    umem_arena_merge(struct umem_arena_extent *a, struct umem_arena_extent *b)
+{
+    struct umem_arena_extent *list = NULL;
+    struct umem_arena_extent **tail_p = &list;
+    while (a != NULL && b != NULL) {
+        struct umem_arena_extent **first_p = a < b ? &a : &b;
+        *tail_p = *first_p;
+        tail_p = &(*first_p)->next;
+        *first_p = (*first_p)->next;
+    }
+    *tail_p = a != NULL ? a : b;
+    return list;
+}
+
+/** @internal @This sorts a list of extents by address.
+ *
+ * @param list list of extents
+ * @return sorted list
+ */
+static struct umem_arena_extent *
+    umem_arena_sort(struct umem_arena_extent *list)
+{
+    if (list == NULL || list->next == NULL)
+        return list;
+
+    struct umem_arena_extent *middle = list;
+    struct umem_arena_extent *end = list->next;
+    while (end != NULL && end->next != NULL) {
+        middle = middle->next;
+        end = end->next->next;
+    }
+    struct umem_arena_extent *second = middle->next;
+    middle->next = NULL;
+    return umem_arena_merge(umem_arena_sort(list), umem_arena_sort(second));
+}
+
+/** @internal @This gives the buffers of the free lists of all classes back to
+ * the free extents, and merges adjacent extents, so that the space may be
+ * carved again for buffers of any size. It must be called with the lock
+ * held.
+ *
+ * @param arena_mgr pointer to the arena manager
+ */
+static void umem_arena_reclaim(struct umem_arena_mgr *arena_mgr)
+{
+    if (!arena_mgr->nb_free)
+        return;
+
+    struct umem_arena_extent *list = NULL;
+    for (unsigned int i = 0; i < arena_mgr->nb_classes; i++) {
+        struct umem_arena_class *class = &arena_mgr->classes[i];
+        size_t footprint = umem_arena_footprint(class->size);
+        void *buffer = class->free_list;
+        while (buffer != NULL) {
+            struct umem_arena_extent *extent = buffer;
+            memcpy(&buffer, buffer, sizeof(void *));
+            extent->next = list;
+            extent->size = footprint;
+            list = extent;
+        }
+        class->free_list = NULL;
+    }
+    arena_mgr->nb_free = 0;
+
+    list = umem_arena_merge(arena_mgr->extents, umem_arena_sort(list));
+    for (struct umem_arena_extent *extent = list; extent != NULL;
+         extent = extent->next) {
+        while (extent->next != NULL &&
+               (uint8_t *)extent + extent->size == (uint8_t *)extent->next) {
+            extent->size += extent->next->size;
+            extent->next = extent->next->next;
+        }
+    }
+    arena_mgr->extents = list;
+}
+
+/** @internal @This takes a buffer from the free list of a class, or carves
+ * a new one from the free extents of the region.
+ *
+ * @param class pointer to the size class
+ * @return pointer to the buffer, or NULL if no extent is large enough
+ */
+static void *umem_arena_take(struct umem_arena_class *class)
+{
+    struct umem_arena_mgr *arena_mgr = class->arena_mgr;
+    void *buffer;
+
+    umem_arena_lock(arena_mgr);
+    buffer = class->free_list;
+    if (buffer != NULL) {
+        memcpy(&class->free_list, buffer, sizeof(void *));
+        arena_mgr->nb_free--;
+    } else
+        buffer = umem_arena_carve(arena_mgr, class->size);
+    umem_arena_unlock(arena_mgr);
+    return buffer;
+}
+
+/** @internal @This allocates a buffer for the pool of a class. When the
+ * region is exhausted, the pools of the other classes are emptied and all
+ * free buffers are merged back into the region before trying again, so that
+ * space released by buffers of another size can be reused.
+ *
+ * @param upool pointer to upool
+ * @return pointer to the buffer, or NULL if the region is exhausted
+ */
+static void *umem_arena_alloc_inner(struct upool *upool)
+{
+    struct umem_arena_class *class = umem_arena_class_from_upool(upool);
+    struct umem_arena_mgr *arena_mgr = class->arena_mgr;
+    void *buffer = umem_arena_take(class);
+    if (likely(buffer != NULL))
+        return buffer;
+
+    for (unsigned int i = 0; i < arena_mgr->nb_classes; i++)
+        if (&arena_mgr->classes[i] != class)
+            upool_vacuum(&arena_mgr->classes[i].upool);
+
+    umem_arena_lock(arena_mgr);
+    umem_arena_reclaim(arena_mgr);
+    umem_arena_unlock(arena_mgr);
+    return umem_arena_take(class);
+}
+
+/** @internal @This puts a buffer back into the free list of its class.
+ *
+ * @param upool pointer to upool
+ * @param buffer pointer to the buffer
+ */
+static void umem_arena_free_inner(struct upool *upool, void *buffer)
+{
+    struct umem_arena_class *class = umem_arena_class_from_upool(upool);
+    struct umem_arena_mgr *arena_mgr = class->arena_mgr;
+
+    umem_arena_lock(arena_mgr);
+    memcpy(buffer, &class->free_list, sizeof(void *));
+    class->free_list = buffer;
+    arena_mgr->nb_free++;
+    umem_arena_unlock(arena_mgr);
+}
+
+/** @internal @This returns the index of the class in which to find buffers
+ * of the given size.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param wanted desired size of the umem
+ * @return index of the class, or nb_classes if the size is too large
+ */
+static unsigned int umem_arena_find(struct umem_arena_mgr *arena_mgr,
+                                    size_t wanted)
+{
+    unsigned int low = 0, high = arena_mgr->nb_classes;
+    while (low < high) {
+        unsigned int middle = (low + high) / 2;
+        if (wanted <= arena_mgr->classes[middle].size)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return low;
+}
+
+/** @This allocates a new umem buffer space.
+ *
+ * @param mgr management structure
+ * @param umem caller-allocated structure, filled in with the required pointer
+ * and size (previous content is discarded)
+ * @param size requested size of the umem
+ * @return false if the memory couldn't be allocated (umem left untouched)
+ */
+static bool umem_arena_alloc(struct umem_mgr *mgr, struct umem *umem,
+                             size_t size)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(mgr);
+    unsigned int pool = umem_arena_find(arena_mgr, size);
+    if (unlikely(pool >= arena_mgr->nb_classes))
+        return false;
+
+    struct umem_arena_class *class = &arena_mgr->classes[pool];
+    uint8_t *buffer = upool_alloc(&class->upool, uint8_t *);
+    if (unlikely(buffer == NULL))
+        return false;
+
+    umem->buffer = buffer;
+    umem->size = size;
+    umem->real_size = class->size;
+    umem->mgr = mgr;
+    return true;
+}
+
+/** @This frees a umem.
+ *
+ * @param umem pointer to umem
+ */
+static void umem_arena_free(struct umem *umem)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(umem->mgr);
+    unsigned int pool = umem_arena_find(arena_mgr, umem->real_size);
+
+    assert(pool < arena_mgr->nb_classes);
+    upool_free(&arena_mgr->classes[pool].upool, umem->buffer);
+    umem->buffer = NULL;
+    umem->mgr = NULL;
+}
+
+/** @This resizes a umem.
+ *
+ * @param umem caller-allocated structure, previously successfully passed to
+ * @ref umem_alloc, and filled in with the new pointer and size
+ * @param new_size new requested size of the umem
+ * @return false if the memory couldn't be allocated (umem left untouched)
+ */
+static bool umem_arena_realloc(struct umem *umem, size_t new_size)
+{
+    if (likely(new_size <= umem->real_size)) {
+        umem->size = new_size;
+        return true;
+    }
+
+    struct umem new_umem;
+    if (!umem_arena_alloc(umem->mgr, &new_umem, new_size))
+        return false;
+    memcpy(new_umem.buffer, umem->buffer, umem->size);
+    umem_arena_free(umem);
+    *umem = new_umem;
+    return true;
+}
+
+/** @This empties the pools of all size classes into their free lists, then
+ * gives all free buffers back to the free extents of the region, merging
+ * adjacent ones. Space released by buffers of a size that is no longer used
+ * may then be carved for other sizes. The region itself is not given back
+ * to the system.
+ *
+ * @param mgr pointer to umem manager
+ */
+static void umem_arena_mgr_vacuum(struct umem_mgr *mgr)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(mgr);
+
+    for (unsigned int i = 0; i < arena_mgr->nb_classes; i++)
+        upool_vacuum(&arena_mgr->classes[i].upool);
+
+    umem_arena_lock(arena_mgr);
+    umem_arena_reclaim(arena_mgr);
+    umem_arena_unlock(arena_mgr);
+}
+
+/** @This returns the statistics of the pools of a umem manager.
+ *
+ * @param mgr pointer to umem manager
+ * @param stats filled in with the statistics
+ */
+static void umem_arena_mgr_get_stats(struct umem_mgr *mgr,
+                                     struct upool_stats *stats)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(mgr);
+
+    for (unsigned int i = 0; i < arena_mgr->nb_classes; i++)
+        upool_add_stats(&arena_mgr->classes[i].upool, stats);
+}
+
+/** @internal @This binds the region of the arena to a NUMA node, before
+ * its pages are touched.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param numa_node NUMA node, or -1
+ * @return false in case of error
+ */
+static bool umem_arena_bind(struct umem_arena_mgr *arena_mgr, int numa_node)
+{
+    if (numa_node < 0)
+        return true;
+#ifdef HAVE_MEMPOLICY
+    unsigned long nodemask[UMEM_ARENA_MAX_NODES / (8 * sizeof(unsigned long))];
+    if (unlikely(numa_node >= UMEM_ARENA_MAX_NODES))
+        return false;
+    memset(nodemask, 0, sizeof(nodemask));
+    nodemask[numa_node / (8 * sizeof(unsigned long))] |=
+        1UL << (numa_node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, arena_mgr->base, arena_mgr->size,
+                   MPOL_PREFERRED, nodemask, UMEM_ARENA_MAX_NODES + 1, 0) == 0;
+#else
+    return false;
+#endif
+}
+
+/** @internal @This reserves the region of the arena.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param flags bitmask of @ref umem_arena_flags
+ * @param numa_node NUMA node of the region, or -1
+ * @return false in case of error
+ */
+static bool umem_arena_map(struct umem_arena_mgr *arena_mgr,
+                           unsigned int flags, int numa_node)
+{
+    size_t size = arena_mgr->size;
+#ifdef HAVE_MMAP
+    int mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *map = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (flags & UMEM_ARENA_HUGETLB) {
+        /* huge pages are naturally aligned */
+        arena_mgr->map_size = size;
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   mmap_flags | MAP_HUGETLB, -1, 0);
+        arena_mgr->base = map;
+    }
+#endif
+    if (map == MAP_FAILED) {
+        /* over-reserve to align the region on a huge page */
+        arena_mgr->map_size = size + UMEM_ARENA_HUGE_PAGE;
+        map = mmap(NULL, arena_mgr->map_size, PROT_READ | PROT_WRITE,
+                   mmap_flags, -1, 0);
+        if (unlikely(map == MAP_FAILED))
+            return false;
+        arena_mgr->base = (uint8_t *)(((uintptr_t)map +
+                    UMEM_ARENA_HUGE_PAGE - 1) &
+                ~(uintptr_t)(UMEM_ARENA_HUGE_PAGE - 1));
+#ifdef MADV_HUGEPAGE
+        madvise(arena_mgr->base, size, MADV_HUGEPAGE);
+#endif
+    }
+    arena_mgr->map = map;
+
+    if (unlikely(!umem_arena_bind(arena_mgr, numa_node))) {
+        munmap(map, arena_mgr->map_size);
+        return false;
+    }
+
+    if ((flags & UMEM_ARENA_MLOCK) &&
+        unlikely(mlock(arena_mgr->base, size) < 0)) {
+        munmap(map, arena_mgr->map_size);
+        return false;
+    }
+    return true;
+#else
+    if (flags & UMEM_ARENA_MLOCK)
+        return false;
+    arena_mgr->map_size = size + UMEM_ARENA_HUGE_PAGE;
+    arena_mgr->map = malloc(arena_mgr->map_size);
+    if (unlikely(arena_mgr->map == NULL))
+        return false;
+    arena_mgr->base = (uint8_t *)(((uintptr_t)arena_mgr->map +
+                UMEM_ARENA_HUGE_PAGE - 1) &
+            ~(uintptr_t)(UMEM_ARENA_HUGE_PAGE - 1));
+    if (unlikely(!umem_arena_bind(arena_mgr, numa_node))) {
+        free(arena_mgr->map);
+        return false;
+    }
+    return true;
+#endif
+}
+
+/** @This frees a umem manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void umem_arena_mgr_free(struct urefcount *urefcount)
+{
+    struct umem_arena_mgr *arena_mgr =
+        umem_arena_mgr_from_urefcount(urefcount);
+
+    for (unsigned int i = 0; i < arena_mgr->nb_classes; i++)
+        upool_clean(&arena_mgr->classes[i].upool);
+    uatomic_clean(&arena_mgr->lock);
+
+#ifdef HAVE_MMAP
+    munmap(arena_mgr->map, arena_mgr->map_size);
+#else
+    free(arena_mgr->map);
+#endif
+
+    urefcount_clean(urefcount);
+    free(arena_mgr);
+}
+
+/** @internal @This computes the sizes of the classes. Between two powers of
+ * 2, intermediate sizes are added in steps of a quarter of the lower one, as
+ * long as the steps are multiples of the granularity of the region.
+ *
+ * @param pool0_size size (in octets) of the smallest class
+ * @param nb_pools number of power of 2 sizes
+ * @param classes array of classes whose sizes are filled in, or NULL
+ * @return number of classes
+ */
+static unsigned int umem_arena_sizes(size_t pool0_size, unsigned int nb_pools,
+                                     struct umem_arena_class *classes)
+{
+    unsigned int nb_classes = 0;
+    for (unsigned int i = 0; i < nb_pools; i++) {
+        size_t size = pool0_size << i;
+        unsigned int steps = i + 1 < nb_pools &&
+            size / UMEM_ARENA_STEPS >= UMEM_ARENA_ALIGN ? UMEM_ARENA_STEPS : 1;
+        for (unsigned int j = 0; j < steps; j++) {
+            if (classes != NULL)
+                classes[nb_classes].size = size + j * (size / UMEM_ARENA_STEPS);
+            nb_classes++;
+        }
+    }
+    return nb_classes;
+}
+
+/** @This allocates a new instance of the umem arena manager.
+ *
+ * @param arena_size size (in octets) of the region to reserve
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param nb_pools number of power of 2 buffer sizes, with intermediate sizes
+ * in quarter steps between them; larger buffers cannot be allocated
+ * @param flags bitmask of @ref umem_arena_flags
+ * @param numa_node NUMA node of the region, or -1 to follow the memory policy
+ * of the thread touching the pages first
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_arena_mgr_alloc_node(size_t arena_size,
+                                           size_t pool0_size,
+                                           unsigned int nb_pools,
+                                           unsigned int flags, int numa_node)
+{
+    if (unlikely(!arena_size || !nb_pools || pool0_size < sizeof(void *) ||
+                 (pool0_size & (pool0_size - 1))))
+        return NULL;
+
+    unsigned int nb_classes = umem_arena_sizes(pool0_size, nb_pools, NULL);
+    size_t extra_size = upool_sizeof(UMEM_ARENA_POOL_DEPTH);
+    struct umem_arena_mgr *arena_mgr =
+        malloc(sizeof(struct umem_arena_mgr) +
+               (sizeof(struct umem_arena_class) + extra_size) * nb_classes);
+    if (unlikely(arena_mgr == NULL))
+        return NULL;
+
+    if (flags & UMEM_ARENA_HUGETLB)
+        arena_size = (arena_size + UMEM_ARENA_HUGE_PAGE - 1) &
+                     ~(size_t)(UMEM_ARENA_HUGE_PAGE - 1);
+    arena_mgr->size = arena_size;
+    if (unlikely(!umem_arena_map(arena_mgr, flags, numa_node))) {
+        free(arena_mgr);
+        return NULL;
+    }
+    uatomic_init(&arena_mgr->lock, 0);
+
+    /* the whole region is a single free extent */
+    arena_mgr->extents = NULL;
+    arena_mgr->nb_free = 0;
+    if (arena_size >= UMEM_ARENA_ALIGN) {
+        arena_mgr->extents = (struct umem_arena_extent *)arena_mgr->base;
+        arena_mgr->extents->next = NULL;
+        arena_mgr->extents->size =
+            arena_size & ~(size_t)(UMEM_ARENA_ALIGN - 1);
+    }
+
+    arena_mgr->nb_classes = nb_classes;
+    umem_arena_sizes(pool0_size, nb_pools, arena_mgr->classes);
+
+    uint8_t *extra = (uint8_t *)arena_mgr + sizeof(struct umem_arena_mgr) +
+                     sizeof(struct umem_arena_class) * nb_classes;
+    for (unsigned int i = 0; i < nb_classes; i++) {
+        struct umem_arena_class *class = &arena_mgr->classes[i];
+        class->free_list = NULL;
+        class->arena_mgr = arena_mgr;
+        upool_init(&class->upool, NULL, UMEM_ARENA_POOL_DEPTH, extra,
+                   umem_arena_alloc_inner, umem_arena_free_inner);
+        extra += extra_size;
+    }
+
+    urefcount_init(umem_arena_mgr_to_urefcount(arena_mgr),
+                   umem_arena_mgr_free);
+    arena_mgr->mgr.refcount = umem_arena_mgr_to_urefcount(arena_mgr);
+    arena_mgr->mgr.umem_alloc = umem_arena_alloc;
+    arena_mgr->mgr.umem_realloc = umem_arena_realloc;
+    arena_mgr->mgr.umem_free = umem_arena_free;
+    arena_mgr->mgr.umem_mgr_vacuum = umem_arena_mgr_vacuum;
+    arena_mgr->mgr.umem_mgr_get_stats = umem_arena_mgr_get_stats;
+
+    return umem_arena_mgr_to_umem_mgr(arena_mgr);
+}
+
+/** @This allocates a new instance of the umem arena manager.
+ *
+ * @param arena_size size (in octets) of the region to reserve
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param nb_pools number of power of 2 buffer sizes, with intermediate sizes
+ * in quarter steps between them; larger buffers cannot be allocated
+ * @param flags bitmask of @ref umem_arena_flags
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_arena_mgr_alloc(size_t arena_size, size_t pool0_size,
+                                      unsigned int nb_pools,
+                                      unsigned int flags)
+{
+    return umem_arena_mgr_alloc_node(arena_size, pool0_size, nb_pools, flags,
+                                     -1);
+}
@@ -8,7 +8,7 @@
 
 #include "upipe/ubase.h"
 #include "upipe/urefcount.h"
-#include "upipe/ulifo.h"
+#include "upipe/upool.h"
 #include "upipe/umem.h"
 #include "upipe/umem_pool.h"
 
@@ -16,6 +16,16 @@
 #include <stdbool.h>
 #include <assert.h>
 
+/** @This defines a pool of buffers of the same size. */
+struct umem_pool_class {
+    /** pool of buffers */
+    struct upool upool;
+    /** size (in octets) of the buffers */
+    size_t size;
+};
+
+UBASE_FROM_TO(umem_pool_class, upool, upool, upool)
+
 /** @This defines the private data structures of the umem pool manager. */
 struct umem_pool_mgr {
     /** refcount management structure */
@@ -29,12 +39,32 @@ struct umem_pool_mgr {
     /** number of pools of buffers */
     size_t nb_pools;
     /** buffer pools */
-    struct ulifo pools[];
+    struct umem_pool_class pools[];
 };
 
 UBASE_FROM_TO(umem_pool_mgr, umem_mgr, umem_mgr, mgr)
 UBASE_FROM_TO(umem_pool_mgr, urefcount, urefcount, urefcount)
 
+/** @internal @This allocates a new buffer for a pool.
+ *
+ * @param upool pointer to upool
+ * @return pointer to the buffer, or NULL in case of allocation failure
+ */
+static void *umem_pool_alloc_inner(struct upool *upool)
+{
+    return malloc(umem_pool_class_from_upool(upool)->size);
+}
+
+/** @internal @This frees a buffer of a pool.
+ *
+ * @param upool pointer to upool
+ * @param buffer pointer to the buffer
+ */
+static void umem_pool_free_inner(struct upool *upool, void *buffer)
+{
+    free(buffer);
+}
+
 /** @internal @This returns the nearest bigger size to allocate for a umem of
  * the given size to fit into and returns the index of the appropriate pool.
  *
@@ -75,8 +105,8 @@ static bool umem_pool_alloc(struct umem_mgr *mgr, struct umem *umem,
     uint8_t *buffer = NULL;
 
     if (likely(pool < pool_mgr->nb_pools))
-        buffer = ulifo_pop(&pool_mgr->pools[pool], uint8_t *);
-    if (unlikely(buffer == NULL))
+        buffer = upool_alloc(&pool_mgr->pools[pool].upool, uint8_t *);
+    else
         buffer = malloc(real_size);
     if (unlikely(buffer == NULL))
         return false;
@@ -100,8 +130,9 @@ static void umem_pool_free(struct umem *umem)
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(umem->mgr);
     unsigned int pool = umem_pool_find(umem->mgr, umem->real_size, NULL);
 
-    if (unlikely(pool >= pool_mgr->nb_pools ||
-                 !ulifo_push(&pool_mgr->pools[pool], umem->buffer)))
+    if (likely(pool < pool_mgr->nb_pools))
+        upool_free(&pool_mgr->pools[pool].upool, umem->buffer);
+    else
         free(umem->buffer);
     umem->buffer = NULL;
     umem->mgr = NULL;
@@ -141,11 +172,22 @@ static void umem_pool_mgr_vacuum(struct umem_mgr *mgr)
 {
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(mgr);
 
-    for (unsigned int i = 0; i < pool_mgr->nb_pools; i++) {
-        uint8_t *buffer;
-        while ((buffer = ulifo_pop(&pool_mgr->pools[i], uint8_t *)) != NULL)
-            free(buffer);
-    }
+    for (unsigned int i = 0; i < pool_mgr->nb_pools; i++)
+        upool_vacuum(&pool_mgr->pools[i].upool);
+}
+
+/** @This returns the statistics of the pools of a umem manager.
+ *
+ * @param mgr pointer to umem manager
+ * @param stats filled in with the statistics
+ */
+static void umem_pool_mgr_get_stats(struct umem_mgr *mgr,
+                                    struct upool_stats *stats)
+{
+    struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(mgr);
+
+    for (unsigned int i = 0; i < pool_mgr->nb_pools; i++)
+        upool_add_stats(&pool_mgr->pools[i].upool, stats);
 }
 
 /** @This frees a umem manager.
@@ -155,10 +197,8 @@ static void umem_pool_mgr_vacuum(struct umem_mgr *mgr)
 static void umem_pool_mgr_free(struct urefcount *urefcount)
 {
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_urefcount(urefcount);
-    umem_pool_mgr_vacuum(umem_pool_mgr_to_umem_mgr(pool_mgr));
-
     for (unsigned int i = 0; i < pool_mgr->nb_pools; i++)
-        ulifo_clean(&pool_mgr->pools[i]);
+        upool_clean(&pool_mgr->pools[i].upool);
 
     urefcount_clean(urefcount);
     free(pool_mgr);
@@ -178,14 +218,14 @@ static void umem_pool_mgr_free(struct urefcount *urefcount)
 struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
 {
     size_t alloc_size = sizeof(struct umem_pool_mgr) +
-                        sizeof(struct ulifo) * nb_pools;
+                        sizeof(struct umem_pool_class) * nb_pools;
     unsigned int pools_depths[nb_pools];
     va_list args;
     va_start(args, nb_pools);
     for (unsigned int i = 0; i < nb_pools; i++) {
         pools_depths[i] = va_arg(args, unsigned int);
         assert(pools_depths[i] <= UINT16_MAX);
-        alloc_size += ulifo_sizeof(pools_depths[i]);
+        alloc_size += upool_sizeof(pools_depths[i]);
     }
     va_end(args);
 
@@ -197,11 +237,13 @@ struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
     pool_mgr->nb_pools = nb_pools;
 
     void *extra = (void *)pool_mgr + sizeof(struct umem_pool_mgr) +
-                  sizeof(struct ulifo) * nb_pools;
+                  sizeof(struct umem_pool_class) * nb_pools;
 
     for (unsigned int i = 0; i < nb_pools; i++) {
-        ulifo_init(&pool_mgr->pools[i], pools_depths[i], extra);
-        extra += ulifo_sizeof(pools_depths[i]);
+        pool_mgr->pools[i].size = pool0_size << i;
+        upool_init(&pool_mgr->pools[i].upool, NULL, pools_depths[i], extra,
+                   umem_pool_alloc_inner, umem_pool_free_inner);
+        extra += upool_sizeof(pools_depths[i]);
     }
 
     urefcount_init(umem_pool_mgr_to_urefcount(pool_mgr), umem_pool_mgr_free);
@@ -210,6 +252,7 @@ struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
     pool_mgr->mgr.umem_realloc = umem_pool_realloc;
     pool_mgr->mgr.umem_free = umem_pool_free;
     pool_mgr->mgr.umem_mgr_vacuum = umem_pool_mgr_vacuum;
+    pool_mgr->mgr.umem_mgr_get_stats = umem_pool_mgr_get_stats;
 
     return umem_pool_mgr_to_umem_mgr(pool_mgr);
 }
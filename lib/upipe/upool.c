@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short Upipe pool of buffers, based on @ref ulifo and per-thread caches
+ */
+
+#include "upipe/upool.h"
+#include "upipe/ulist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+/** identifies the calling thread by its address */
+__thread uint8_t upool_thread;
+
+/** list of pools with per-thread caches */
+static struct uchain upool_list = { &upool_list, &upool_list };
+/** protects the list of pools */
+static pthread_mutex_t upool_list_lock = PTHREAD_MUTEX_INITIALIZER;
+/** key whose destructor releases the caches of an exiting thread */
+static pthread_key_t upool_key;
+/** creates the key once */
+static pthread_once_t upool_key_once = PTHREAD_ONCE_INIT;
+
+/** @internal @This releases the caches owned by an exiting thread. The
+ * elements are moved to the shared LIFOs, so that other threads may use
+ * them.
+ *
+ * @param opaque unused
+ */
+static void upool_thread_exit(void *opaque)
+{
+    void *self = &upool_thread;
+    struct uchain *uchain;
+
+    pthread_mutex_lock(&upool_list_lock);
+    ulist_foreach (&upool_list, uchain) {
+        struct upool *upool = upool_from_uchain(uchain);
+        for (unsigned int i = 0; i < UPOOL_CACHES; i++) {
+            struct upool_cache *cache = &upool->caches[i];
+            if (uatomic_ptr_load(&cache->owner) != self)
+                continue;
+            upool_cache_drain(upool, cache, cache->count);
+            uatomic_ptr_store(&cache->owner, NULL);
+        }
+    }
+    pthread_mutex_unlock(&upool_list_lock);
+}
+
+/** @internal @This creates the key releasing the caches. */
+static void upool_key_init(void)
+{
+    if (unlikely(pthread_key_create(&upool_key, upool_thread_exit))) {
+        fprintf(stderr, "upool: unable to create thread key\n");
+        abort();
+    }
+}
+
+/** @This registers the calling thread so that the caches it claims are
+ * released when it exits.
+ */
+void upool_thread_claim(void)
+{
+    pthread_once(&upool_key_once, upool_key_init);
+    pthread_setspecific(upool_key, &upool_thread);
+}
+
+/** @This registers a upool with per-thread caches, so that exiting threads
+ * can release their caches.
+ *
+ * @param upool pointer to a upool structure
+ */
+void upool_register(struct upool *upool)
+{
+    pthread_mutex_lock(&upool_list_lock);
+    ulist_add(&upool_list, upool_to_uchain(upool));
+    pthread_mutex_unlock(&upool_list_lock);
+}
+
+/** @This unregisters a upool with per-thread caches.
+ *
+ * @param upool pointer to a upool structure
+ */
+void upool_unregister(struct upool *upool)
+{
+    pthread_mutex_lock(&upool_list_lock);
+    ulist_delete(upool_to_uchain(upool));
+    pthread_mutex_unlock(&upool_list_lock);
+}
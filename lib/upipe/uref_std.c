@@ -113,6 +113,12 @@ static int uref_std_mgr_control(struct uref_mgr *mgr, int command, va_list args)
         case UREF_MGR_VACUUM:
             uref_std_mgr_vacuum(mgr);
             return UBASE_ERR_NONE;
+        case UREF_MGR_GET_STATS: {
+            struct uref_std_mgr *std_mgr = uref_std_mgr_from_uref_mgr(mgr);
+            struct upool_stats *stats = va_arg(args, struct upool_stats *);
+            upool_add_stats(&std_mgr->uref_pool, stats);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -19,13 +19,40 @@
 #ifdef HAVE_UTRACE
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <link.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #define UTRACE_MAGIC "UTRACE01"
+/** magic of a dump of the thread rings */
+#define UTRACE_RING_MAGIC "UTRACER1"
+/** default number of records in each thread ring */
+#define UTRACE_RING_RECORDS 8192
+/** size of a record in the thread rings */
+#define UTRACE_RECORD_SIZE 128
+/** the record is the first of an event */
+#define UTRACE_RECORD_FIRST 0x1
+/** the record is the last of an event */
+#define UTRACE_RECORD_LAST 0x2
+/** number of records copied on the stack before writing them to the dump */
+#define UTRACE_DUMP_BATCH 16
 
 enum utrace_id {
     UTRACE_DUMP_GRAPH,
@@ -66,16 +93,230 @@ enum utrace_id {
     UTRACE_ULOG_ADD_PREFIX,
 };
 
-static bool utrace_initialized;
+/** where events are written */
+enum utrace_mode {
+    /** tracing is disabled */
+    UTRACE_MODE_NONE,
+    /** events are written in order to a file (UTRACE_FD) */
+    UTRACE_MODE_STREAM,
+    /** the header of the ring dumps is being built */
+    UTRACE_MODE_HEADER,
+    /** events are written to per-thread rings (UTRACE_RING) */
+    UTRACE_MODE_RING,
+};
+
+/** fixed-size record of a thread ring; an event is written to as many
+ * consecutive records as needed */
+struct utrace_record {
+    /** index of the record in the thread plus one, or 0 while it is being
+     * written */
+    uint64_t seq;
+    /** timestamp counter at the beginning of the event */
+    uint64_t tsc;
+    /** number of octets in data */
+    uint16_t size;
+    /** UTRACE_RECORD_FIRST and/or UTRACE_RECORD_LAST */
+    uint16_t flags;
+    /** reserved */
+    uint32_t reserved;
+    /** part of the encoded event */
+    uint8_t data[UTRACE_RECORD_SIZE - 24];
+};
+
+/** lock-free ring of the events of a thread, with a single writer (the
+ * thread itself) and a single reader (the dump) */
+struct utrace_ring {
+    /** next ring in the list of threads */
+    struct utrace_ring *next;
+    /** thread ID */
+    uint64_t tid;
+    /** number of records published */
+    uint64_t head;
+    /** record being written */
+    struct utrace_record *cur;
+    /** records, indexed by sequence modulo the ring size */
+    struct utrace_record records[];
+};
+
+enum utrace_state {
+    UTRACE_STATE_NONE,
+    UTRACE_STATE_BUSY,
+    UTRACE_STATE_READY,
+};
+
+static int utrace_state = UTRACE_STATE_NONE;
+static enum utrace_mode utrace_mode = UTRACE_MODE_NONE;
 static FILE *utrace_f;
 
+/** dump file name */
+static char *utrace_ring_path;
+/** number of records per ring minus one */
+static uint64_t utrace_ring_mask;
+/** flight recorder window in seconds, or 0 to dump the whole rings */
+static double utrace_ring_window;
+/** list of thread rings */
+static struct utrace_ring *utrace_rings;
+/** ring of the current thread */
+static __thread struct utrace_ring *utrace_ring_self;
+/** key freeing the ring of a thread when it exits */
+static pthread_key_t utrace_ring_key;
+/** true while a dump is in progress or a ring is being unlinked */
+static bool utrace_ring_dumping;
+/** magic and modules list written at the beginning of each dump */
+static uint8_t *utrace_ring_header;
+/** size of utrace_ring_header */
+static size_t utrace_ring_header_size;
+/** timestamp counter when tracing started */
+static uint64_t utrace_tsc0;
+/** monotonic time when tracing started */
+static uint64_t utrace_ns0;
+
 static void utrace_init(void);
 
+/** @This returns the monotonic time in nanoseconds. */
+static uint64_t utrace_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** @This returns the timestamp counter of the CPU, or the monotonic time
+ * if it is not available. */
+static inline uint64_t utrace_tsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t cnt;
+    __asm__ volatile ("mrs %0, cntvct_el0" : "=r" (cnt));
+    return cnt;
+#else
+    return utrace_ns();
+#endif
+}
+
+/** @This returns the ring of the current thread, allocating it on the
+ * first event. */
+static struct utrace_ring *utrace_ring_get(void)
+{
+    struct utrace_ring *ring = utrace_ring_self;
+    if (likely(ring != NULL))
+        return ring;
+
+    ring = malloc(sizeof (*ring) +
+                  (utrace_ring_mask + 1) * sizeof (struct utrace_record));
+    if (ring == NULL)
+        return NULL;
+    ring->tid = syscall(SYS_gettid);
+    ring->head = 0;
+    ring->cur = NULL;
+
+    struct utrace_ring *next = __atomic_load_n(&utrace_rings,
+                                               __ATOMIC_RELAXED);
+    do {
+        ring->next = next;
+    } while (!__atomic_compare_exchange_n(&utrace_rings, &next, ring, true,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+    utrace_ring_self = ring;
+    pthread_setspecific(utrace_ring_key, ring);
+    return ring;
+}
+
+/** @This unlinks and frees the ring of an exiting thread. The dump flag is
+ * taken so that no dump walks the ring while it is freed; other threads
+ * may still push their rings at the head of the list concurrently. */
+static void utrace_ring_free(void *opaque)
+{
+    struct utrace_ring *ring = opaque;
+    while (__atomic_exchange_n(&utrace_ring_dumping, true, __ATOMIC_ACQUIRE))
+        sched_yield();
+
+    struct utrace_ring *prev = ring;
+    if (!__atomic_compare_exchange_n(&utrace_rings, &prev, ring->next, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        /* rings were pushed in front of ours */
+        while (prev->next != ring)
+            prev = prev->next;
+        prev->next = ring->next;
+    }
+    if (utrace_ring_self == ring)
+        utrace_ring_self = NULL;
+
+    __atomic_store_n(&utrace_ring_dumping, false, __ATOMIC_RELEASE);
+    free(ring);
+}
+
+/** @This starts writing the next record of a ring. */
+static void utrace_ring_open(struct utrace_ring *ring, uint64_t tsc,
+                             uint16_t flags)
+{
+    struct utrace_record *record =
+        &ring->records[ring->head & utrace_ring_mask];
+    __atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->tsc = tsc;
+    record->size = 0;
+    record->flags = flags;
+    ring->cur = record;
+}
+
+/** @This makes the record being written visible to the dump. */
+static void utrace_ring_publish(struct utrace_ring *ring)
+{
+    uint64_t seq = ring->head + 1;
+    __atomic_store_n(&ring->cur->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->head, seq, __ATOMIC_RELEASE);
+}
+
+static void utrace_ring_write(const uint8_t *buf, size_t len)
+{
+    struct utrace_ring *ring = utrace_ring_self;
+    if (unlikely(ring == NULL || ring->cur == NULL))
+        return;
+
+    while (len > 0) {
+        struct utrace_record *record = ring->cur;
+        if (record->size == sizeof (record->data)) {
+            utrace_ring_publish(ring);
+            utrace_ring_open(ring, record->tsc, 0);
+            record = ring->cur;
+        }
+        size_t size = sizeof (record->data) - record->size;
+        if (size > len)
+            size = len;
+        memcpy(record->data + record->size, buf, size);
+        record->size += size;
+        buf += size;
+        len -= size;
+    }
+}
+
 static void utrace_write(const void *buf, size_t len)
 {
-    utrace_init();
-    if (utrace_f != NULL && len > 0)
-        assert(fwrite_unlocked(buf, len, 1, utrace_f) == 1);
+    if (len == 0)
+        return;
+
+    switch (utrace_mode) {
+        case UTRACE_MODE_NONE:
+            break;
+        case UTRACE_MODE_STREAM:
+            assert(fwrite_unlocked(buf, len, 1, utrace_f) == 1);
+            break;
+        case UTRACE_MODE_HEADER: {
+            uint8_t *header = realloc(utrace_ring_header,
+                                      utrace_ring_header_size + len);
+            assert(header != NULL);
+            memcpy(header + utrace_ring_header_size, buf, len);
+            utrace_ring_header = header;
+            utrace_ring_header_size += len;
+            break;
+        }
+        case UTRACE_MODE_RING:
+            utrace_ring_write(buf, len);
+            break;
+    }
 }
 
 static void utrace_write_uint(uint64_t val)
@@ -124,8 +365,20 @@ static void utrace_write_ptr(void *val)
 
 static void utrace_write_id(enum utrace_id val)
 {
-    if (utrace_f != NULL)
-        flockfile(utrace_f);
+    utrace_init();
+    switch (utrace_mode) {
+        case UTRACE_MODE_STREAM:
+            flockfile(utrace_f);
+            break;
+        case UTRACE_MODE_RING: {
+            struct utrace_ring *ring = utrace_ring_get();
+            if (ring != NULL)
+                utrace_ring_open(ring, utrace_tsc(), UTRACE_RECORD_FIRST);
+            break;
+        }
+        default:
+            break;
+    }
     utrace_write_uint(val);
 }
 
@@ -233,8 +486,119 @@ static void utrace_write_uref(struct uref *uref)
 
 static void utrace_end(void)
 {
-    if (utrace_f != NULL)
-        funlockfile(utrace_f);
+    switch (utrace_mode) {
+        case UTRACE_MODE_STREAM:
+            funlockfile(utrace_f);
+            break;
+        case UTRACE_MODE_RING: {
+            struct utrace_ring *ring = utrace_ring_self;
+            if (ring != NULL && ring->cur != NULL) {
+                ring->cur->flags |= UTRACE_RECORD_LAST;
+                utrace_ring_publish(ring);
+                ring->cur = NULL;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/** @This writes a buffer to a file descriptor, from a signal handler. */
+static void utrace_ring_dump_write(int fd, const void *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t ret = write(fd, buf, len);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        buf = (const uint8_t *)buf + ret;
+        len -= ret;
+    }
+}
+
+/** @This writes the rings of all threads to the UTRACE_RING file. It only
+ * uses async-signal-safe functions, so that it may be called from a signal
+ * handler, and may run while the threads keep writing events: the records
+ * overwritten during the dump are skipped.
+ *
+ * The dump is made of the header (magic and modules list), the timestamp
+ * counter and monotonic time when tracing started and at the time of the
+ * dump, then for each thread its ID followed by its records and a record
+ * with a zero sequence. The rings of the threads that already exited are
+ * not dumped.
+ *
+ * Nothing is dumped if tracing is not initialized yet: this function never
+ * initializes it, as the signal may be received during the initialization.
+ */
+void utrace_ring_dump(void)
+{
+    if (__atomic_load_n(&utrace_state, __ATOMIC_ACQUIRE) !=
+            UTRACE_STATE_READY ||
+        utrace_mode != UTRACE_MODE_RING ||
+        __atomic_exchange_n(&utrace_ring_dumping, true, __ATOMIC_ACQUIRE))
+        return;
+
+    int fd = open(utrace_ring_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd == -1) {
+        __atomic_store_n(&utrace_ring_dumping, false, __ATOMIC_RELEASE);
+        return;
+    }
+
+    uint64_t clock[4] = { utrace_tsc0, utrace_ns0, utrace_tsc(), utrace_ns() };
+    uint64_t since = 0;
+    if (utrace_ring_window > 0 && clock[3] > clock[1]) {
+        /* flight recorder: only keep the last seconds */
+        double ticks = utrace_ring_window * 1000000000. *
+            (clock[2] - clock[0]) / (clock[3] - clock[1]);
+        if (ticks < clock[2])
+            since = clock[2] - ticks;
+    }
+    utrace_ring_dump_write(fd, utrace_ring_header, utrace_ring_header_size);
+    utrace_ring_dump_write(fd, clock, sizeof (clock));
+
+    struct utrace_ring *ring = __atomic_load_n(&utrace_rings,
+                                               __ATOMIC_ACQUIRE);
+    for ( ; ring != NULL; ring = ring->next) {
+        struct utrace_record batch[UTRACE_DUMP_BATCH];
+        unsigned int count = 0;
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t seq = head > utrace_ring_mask ? head - utrace_ring_mask : 1;
+
+        utrace_ring_dump_write(fd, &ring->tid, sizeof (ring->tid));
+        for ( ; seq <= head; seq++) {
+            const struct utrace_record *record =
+                &ring->records[(seq - 1) & utrace_ring_mask];
+            if (__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) != seq)
+                continue;
+            memcpy(&batch[count], record, sizeof (*record));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&record->seq, __ATOMIC_RELAXED) != seq ||
+                batch[count].tsc < since)
+                continue;
+            batch[count].seq = seq;
+            if (++count == UTRACE_DUMP_BATCH) {
+                utrace_ring_dump_write(fd, batch, sizeof (batch));
+                count = 0;
+            }
+        }
+        memset(&batch[count++], 0, sizeof (struct utrace_record));
+        utrace_ring_dump_write(fd, batch, count * sizeof (struct utrace_record));
+    }
+
+    close(fd);
+    __atomic_store_n(&utrace_ring_dumping, false, __ATOMIC_RELEASE);
+}
+
+/** @This dumps the rings when the UTRACE_RING_SIGNAL signal is received. */
+static void utrace_ring_signal(int signum)
+{
+    int err = errno;
+    utrace_ring_dump();
+    errno = err;
 }
 
 static int handle_phdr(struct dl_phdr_info *info, size_t size, void *data)
@@ -254,22 +618,87 @@ static int handle_phdr(struct dl_phdr_info *info, size_t size, void *data)
     return 0;
 }
 
+/** @This sets up the ring mode. */
+static void utrace_ring_init(const char *path)
+{
+    uint64_t records = UTRACE_RING_RECORDS;
+    const char *records_str = getenv("UTRACE_RING_RECORDS");
+    if (records_str != NULL && strtoull(records_str, NULL, 0) > 1)
+        records = strtoull(records_str, NULL, 0);
+    /* round up to a power of 2 */
+    utrace_ring_mask = 1;
+    while (utrace_ring_mask < records)
+        utrace_ring_mask <<= 1;
+    utrace_ring_mask--;
+
+    const char *window_str = getenv("UTRACE_RING_SECONDS");
+    if (window_str != NULL)
+        utrace_ring_window = atof(window_str);
+
+    utrace_ring_path = strdup(path);
+    assert(utrace_ring_path != NULL);
+    if (unlikely(pthread_key_create(&utrace_ring_key, utrace_ring_free))) {
+        fprintf(stderr, "upipe: unable to create the tracing thread key\n");
+        abort();
+    }
+
+    utrace_mode = UTRACE_MODE_HEADER;
+    utrace_write(UTRACE_RING_MAGIC, 8);
+    dl_iterate_phdr(handle_phdr, NULL);
+    utrace_write_ptr(NULL);
+    utrace_tsc0 = utrace_tsc();
+    utrace_ns0 = utrace_ns();
+    utrace_mode = UTRACE_MODE_RING;
+
+    const char *signal_str = getenv("UTRACE_RING_SIGNAL");
+    if (signal_str != NULL && atoi(signal_str) > 0) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof (sa));
+        sa.sa_handler = utrace_ring_signal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(atoi(signal_str), &sa, NULL);
+    }
+    atexit(utrace_ring_dump);
+
+    fprintf(stderr, "upipe: tracing enabled in %"PRIu64" records per thread, "
+            "dumped to %s\n", utrace_ring_mask + 1, utrace_ring_path);
+}
+
 static void utrace_init(void)
 {
-    if (!utrace_initialized) {
-        utrace_initialized = true;
-        const char *fd_str = getenv("UTRACE_FD");
-        if (fd_str == NULL)
-            return;
+    int state = __atomic_load_n(&utrace_state, __ATOMIC_ACQUIRE);
+    if (likely(state == UTRACE_STATE_READY))
+        return;
+
+    state = UTRACE_STATE_NONE;
+    if (!__atomic_compare_exchange_n(&utrace_state, &state, UTRACE_STATE_BUSY,
+                                     false, __ATOMIC_ACQUIRE,
+                                     __ATOMIC_ACQUIRE)) {
+        /* another thread is initializing */
+        while (__atomic_load_n(&utrace_state, __ATOMIC_ACQUIRE) !=
+               UTRACE_STATE_READY)
+            sched_yield();
+        return;
+    }
+
+    const char *fd_str = getenv("UTRACE_FD");
+    const char *ring_str = getenv("UTRACE_RING");
+    if (fd_str != NULL) {
         int fd = atoi(fd_str);
         utrace_f = fdopen(fd, "w");
         assert(utrace_f);
         fprintf(stderr, "upipe: tracing enabled on fd %d\n", fd);
 
+        utrace_mode = UTRACE_MODE_STREAM;
         utrace_write(UTRACE_MAGIC, 8);
         dl_iterate_phdr(handle_phdr, NULL);
         utrace_write_ptr(NULL);
+    } else if (ring_str != NULL) {
+        utrace_ring_init(ring_str);
     }
+
+    __atomic_store_n(&utrace_state, UTRACE_STATE_READY, __ATOMIC_RELEASE);
 }
 
 #define w_str()  utrace_write_str(va_arg(ap, const char *))
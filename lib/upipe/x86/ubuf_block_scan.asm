@@ -0,0 +1,115 @@
+;******************************************************************************
+;* Start code and sync word scanning
+;*
+;* SPDX-License-Identifier: MIT
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION .text
+
+%macro scan_startcode 0
+
+; uintptr_t ubuf_block_scan_startcode(const uint8_t *p, uintptr_t positions)
+cglobal ubuf_block_scan_startcode, 2, 4, 4, p, positions, i, mask
+    pxor     m3, m3                 ; 0x00
+    pcmpeqb  m1, m1
+    pxor     m2, m2
+    psubb    m2, m1                 ; 0x01
+
+    xor      id, id
+    and      positionsq, -mmsize
+    jz .end
+
+.loop:
+    movu     m0, [pq + iq]
+    movu     m1, [pq + iq + 1]
+    pcmpeqb  m0, m3
+    pcmpeqb  m1, m3
+    pand     m0, m1
+    movu     m1, [pq + iq + 2]
+    pcmpeqb  m1, m2
+    pand     m0, m1
+    pmovmskb maskd, m0
+    test     maskd, maskd
+    jnz .found
+
+    add      iq, mmsize
+    cmp      iq, positionsq
+    jb .loop
+
+.end:
+    mov      eax, id
+    RET
+
+.found:
+    bsf      maskd, maskd
+    add      iq, maskq
+    mov      eax, id
+    RET
+%endmacro
+
+%macro scan_sync 0
+
+; uintptr_t ubuf_block_scan_sync(const uint8_t *p, uintptr_t positions,
+;                                uintptr_t stride, uintptr_t count,
+;                                uintptr_t word)
+cglobal ubuf_block_scan_sync, 5, 7, 3, p, positions, stride, span, word, k, start
+    movd     xm2, wordd
+%if cpuflag(avx2)
+    vpbroadcastb m2, xm2
+%else
+    punpcklbw m2, m2
+    pshuflw  m2, m2, 0
+    punpcklqdq m2, m2
+%endif
+
+    dec      spanq
+    imul     spanq, strideq         ; distance to the last sync word
+    mov      startq, pq
+    and      positionsq, -mmsize
+    add      positionsq, pq         ; end of the scanned positions
+    cmp      pq, positionsq
+    jae .end
+
+.loop:
+    movu     m0, [pq]
+    pcmpeqb  m0, m2
+    mov      kq, strideq
+.inner:
+    cmp      kq, spanq
+    ja .check
+    movu     m1, [pq + kq]
+    pcmpeqb  m1, m2
+    pand     m0, m1
+    add      kq, strideq
+    jmp .inner
+
+.check:
+    pmovmskb wordd, m0
+    test     wordd, wordd
+    jnz .found
+
+    add      pq, mmsize
+    cmp      pq, positionsq
+    jb .loop
+
+.end:
+    sub      pq, startq
+    mov      eax, pd
+    RET
+
+.found:
+    bsf      wordd, wordd
+    add      pq, wordq
+    sub      pq, startq
+    mov      eax, pd
+    RET
+%endmacro
+
+INIT_XMM sse2
+scan_startcode
+scan_sync
+INIT_YMM avx2
+scan_startcode
+scan_sync
@@ -0,0 +1,1064 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short implementation of a Upipe event loop using io_uring
+ *
+ * Readiness pumps are implemented with one-shot poll operations which are
+ * re-armed after dispatch, timers with timeout operations and signals with
+ * a poll on a signalfd. All pending submissions are handed over to the
+ * kernel by the same io_uring_enter() call that waits for completions.
+ */
+
+#include "upipe/ubase.h"
+#include "upipe/urefcount.h"
+#include "upipe/uclock.h"
+#include "upipe/umutex.h"
+#include "upipe/upump.h"
+#include "upipe/upump_common.h"
+#include "upump-uring/upump_uring.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include <linux/io_uring.h>
+
+/** number of submission queue entries */
+#define UPUMP_URING_ENTRIES 256
+
+/** @This stores management parameters and local structures.
+ */
+struct upump_uring_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** io_uring descriptor */
+    int fd;
+
+    /** submission queue head (written by the kernel) */
+    unsigned int *sq_head;
+    /** submission queue tail */
+    unsigned int *sq_tail;
+    /** submission queue mask */
+    unsigned int sq_mask;
+    /** number of submission queue entries */
+    unsigned int sq_entries;
+    /** local submission queue tail */
+    unsigned int sq_local_tail;
+    /** submission queue entries */
+    struct io_uring_sqe *sqes;
+
+    /** completion queue head */
+    unsigned int *cq_head;
+    /** completion queue tail (written by the kernel) */
+    unsigned int *cq_tail;
+    /** completion queue mask */
+    unsigned int cq_mask;
+    /** completion queue entries */
+    struct io_uring_cqe *cqes;
+
+    /** submission queue mapping */
+    void *sq_map;
+    /** size of the submission queue mapping */
+    size_t sq_map_size;
+    /** completion queue mapping, or NULL if shared with the submission
+     * queue */
+    void *cq_map;
+    /** size of the completion queue mapping */
+    size_t cq_map_size;
+    /** size of the submission queue entries mapping */
+    size_t sqes_size;
+
+    /** number of started idlers */
+    unsigned int idlers;
+    /** currently dispatching pumps */
+    bool running;
+    /** list of allocated upump structures */
+    struct uchain upumps;
+    /** list of triggered upump structures */
+    struct uchain ready;
+
+    /** common structure */
+    struct upump_common_mgr common_mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(upump_uring_mgr, upump_mgr, upump_mgr, common_mgr.mgr)
+UBASE_FROM_TO(upump_uring_mgr, urefcount, urefcount, urefcount)
+
+/** @This stores local structures.
+ */
+struct upump_uring {
+    /** structure for the list of allocated pumps */
+    struct uchain uchain;
+    /** structure for the list of triggered pumps */
+    struct uchain uchain_ready;
+
+    /** type of event to watch */
+    int event;
+    /** file descriptor, or signalfd */
+    int fd;
+
+    /** true if the pump is really started (not blocked) */
+    bool active;
+    /** true if an operation is submitted */
+    bool inflight;
+    /** true if the pump is in the list of triggered pumps */
+    bool ready;
+    /** result of the last operation */
+    int32_t res;
+
+    /** private structure */
+    union {
+        struct {
+            uint64_t after;
+            uint64_t repeat;
+            bool expired;
+            struct __kernel_timespec ts;
+        } timer;
+        int signal;
+        struct {
+            uint8_t *buffer;
+            size_t size;
+            uint64_t offset;
+            struct msghdr *msghdr;
+            /** operation completed but not dispatched yet */
+            bool completed;
+            /** waiting for readiness after EAGAIN */
+            bool polling;
+        } io;
+    };
+
+    /** upump should be freed after upumps list traversal */
+    bool free;
+
+    /** common structure */
+    struct upump_common common;
+};
+
+UBASE_FROM_TO(upump_uring, upump, upump, common.upump)
+UBASE_FROM_TO(upump_uring, uchain, uchain, uchain)
+UBASE_FROM_TO(upump_uring, uchain, uchain_ready, uchain_ready)
+
+/** @internal @This checks if a pump performs I/O operations.
+ *
+ * @param upump_uring pointer to pump
+ * @return true if the pump is a read or recv pump
+ */
+static inline bool upump_uring_is_io(struct upump_uring *upump_uring)
+{
+    return upump_uring->event == UPUMP_URING_TYPE_READ ||
+           upump_uring->event == UPUMP_URING_TYPE_RECV ||
+           upump_uring->event == UPUMP_URING_TYPE_RECVMSG;
+}
+
+/** @internal @This submits the pending entries and optionally waits for
+ * completions.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ * @param wait_nr number of completions to wait for
+ * @return an error code
+ */
+static int upump_uring_mgr_enter(struct upump_uring_mgr *uring_mgr,
+                                 unsigned int wait_nr)
+{
+    __atomic_store_n(uring_mgr->sq_tail, uring_mgr->sq_local_tail,
+                     __ATOMIC_RELEASE);
+    unsigned int to_submit = uring_mgr->sq_local_tail -
+        __atomic_load_n(uring_mgr->sq_head, __ATOMIC_ACQUIRE);
+
+    int ret = syscall(__NR_io_uring_enter, uring_mgr->fd, to_submit, wait_nr,
+                      IORING_ENTER_GETEVENTS, NULL, 0);
+    if (unlikely(ret < 0)) {
+        switch (errno) {
+            case EINTR:
+            case EAGAIN:
+            case EBUSY:
+                /* completions must be reaped first */
+                return UBASE_ERR_NONE;
+            default:
+                return UBASE_ERR_EXTERNAL;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @hidden */
+static void upump_uring_mgr_reap(struct upump_uring_mgr *uring_mgr);
+
+/** @internal @This gets a free submission queue entry.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ * @param upump_uring pump the entry is submitted for, or NULL
+ * @return pointer to a zeroed submission queue entry
+ */
+static struct io_uring_sqe *upump_uring_get_sqe(
+        struct upump_uring_mgr *uring_mgr, struct upump_uring *upump_uring)
+{
+    while (uring_mgr->sq_local_tail -
+           __atomic_load_n(uring_mgr->sq_head, __ATOMIC_ACQUIRE) >=
+           uring_mgr->sq_entries) {
+        upump_uring_mgr_enter(uring_mgr, 0);
+        upump_uring_mgr_reap(uring_mgr);
+    }
+
+    struct io_uring_sqe *sqe =
+        &uring_mgr->sqes[uring_mgr->sq_local_tail & uring_mgr->sq_mask];
+    uring_mgr->sq_local_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uintptr_t)upump_uring;
+    if (upump_uring != NULL)
+        upump_uring->inflight = true;
+    return sqe;
+}
+
+/** @internal @This submits the operation of a pump.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ * @param upump_uring pointer to pump
+ */
+static void upump_uring_submit(struct upump_uring_mgr *uring_mgr,
+                               struct upump_uring *upump_uring)
+{
+    struct io_uring_sqe *sqe;
+
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_TIMER: {
+            uint64_t value = upump_uring->timer.after;
+            upump_uring->timer.ts.tv_sec = value / UCLOCK_FREQ;
+            upump_uring->timer.ts.tv_nsec = ((value % UCLOCK_FREQ) *
+                                             1000000000) / UCLOCK_FREQ;
+            upump_uring->timer.expired = false;
+            sqe = upump_uring_get_sqe(uring_mgr, upump_uring);
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->addr = (uintptr_t)&upump_uring->timer.ts;
+            sqe->len = 1;
+            break;
+        }
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_SIGNAL:
+            sqe = upump_uring_get_sqe(uring_mgr, upump_uring);
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = upump_uring->fd;
+            sqe->poll32_events = POLLIN;
+            break;
+        case UPUMP_TYPE_FD_WRITE:
+            sqe = upump_uring_get_sqe(uring_mgr, upump_uring);
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = upump_uring->fd;
+            sqe->poll32_events = POLLOUT;
+            break;
+        case UPUMP_URING_TYPE_READ:
+        case UPUMP_URING_TYPE_RECV:
+        case UPUMP_URING_TYPE_RECVMSG:
+            if (upump_uring->io.completed)
+                break;
+            if (upump_uring->event == UPUMP_URING_TYPE_RECVMSG ?
+                upump_uring->io.msghdr == NULL :
+                upump_uring->io.buffer == NULL)
+                break;
+            sqe = upump_uring_get_sqe(uring_mgr, upump_uring);
+            sqe->fd = upump_uring->fd;
+            if (upump_uring->io.polling) {
+                sqe->opcode = IORING_OP_POLL_ADD;
+                sqe->poll32_events = POLLIN;
+            } else if (upump_uring->event == UPUMP_URING_TYPE_READ) {
+                sqe->opcode = IORING_OP_READ;
+                sqe->addr = (uintptr_t)upump_uring->io.buffer;
+                sqe->len = upump_uring->io.size;
+                sqe->off = upump_uring->io.offset;
+            } else if (upump_uring->event == UPUMP_URING_TYPE_RECV) {
+                sqe->opcode = IORING_OP_RECV;
+                sqe->addr = (uintptr_t)upump_uring->io.buffer;
+                sqe->len = upump_uring->io.size;
+            } else {
+                sqe->opcode = IORING_OP_RECVMSG;
+                sqe->addr = (uintptr_t)upump_uring->io.msghdr;
+                sqe->len = 1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/** @internal @This handles a completion.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ * @param upump_uring pump the operation was submitted for
+ * @param res result of the operation
+ */
+static void upump_uring_complete(struct upump_uring_mgr *uring_mgr,
+                                 struct upump_uring *upump_uring, int32_t res)
+{
+    upump_uring->inflight = false;
+
+    if (upump_uring_is_io(upump_uring)) {
+        if (upump_uring->io.polling) {
+            if (res == -ECANCELED)
+                return;
+            upump_uring->io.polling = false;
+            if (upump_uring->active)
+                upump_uring_submit(uring_mgr, upump_uring);
+            return;
+        }
+        if (res == -ECANCELED)
+            return;
+        if (res == -EAGAIN) {
+            /* non-blocking descriptor, wait until it is readable */
+            upump_uring->io.polling = true;
+            if (upump_uring->active)
+                upump_uring_submit(uring_mgr, upump_uring);
+            return;
+        }
+        /* keep the result of a stopped pump until it is started again */
+        upump_uring->io.completed = true;
+        upump_uring->res = res;
+    } else {
+        if (!upump_uring->active || res == -ECANCELED)
+            return;
+        upump_uring->res = res;
+    }
+
+    if (upump_uring->active && !upump_uring->ready) {
+        upump_uring->ready = true;
+        ulist_add(&uring_mgr->ready, &upump_uring->uchain_ready);
+    }
+}
+
+/** @internal @This reaps all available completions.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ */
+static void upump_uring_mgr_reap(struct upump_uring_mgr *uring_mgr)
+{
+    unsigned int head = *uring_mgr->cq_head;
+    unsigned int tail = __atomic_load_n(uring_mgr->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        struct io_uring_cqe *cqe =
+            &uring_mgr->cqes[head & uring_mgr->cq_mask];
+        struct upump_uring *upump_uring =
+            (struct upump_uring *)(uintptr_t)cqe->user_data;
+        int32_t res = cqe->res;
+        head++;
+        __atomic_store_n(uring_mgr->cq_head, head, __ATOMIC_RELEASE);
+
+        if (upump_uring != NULL)
+            upump_uring_complete(uring_mgr, upump_uring, res);
+        tail = __atomic_load_n(uring_mgr->cq_tail, __ATOMIC_ACQUIRE);
+    }
+}
+
+/** @internal @This cancels the operation of a pump, and waits until the
+ * kernel no longer references it.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ * @param upump_uring pointer to pump
+ */
+static void upump_uring_cancel(struct upump_uring_mgr *uring_mgr,
+                               struct upump_uring *upump_uring)
+{
+    if (upump_uring->ready) {
+        upump_uring->ready = false;
+        ulist_delete(&upump_uring->uchain_ready);
+    }
+    if (!upump_uring->inflight)
+        return;
+
+    struct io_uring_sqe *sqe = upump_uring_get_sqe(uring_mgr, NULL);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = (uintptr_t)upump_uring;
+    while (upump_uring->inflight) {
+        if (unlikely(!ubase_check(upump_uring_mgr_enter(uring_mgr, 1))))
+            break;
+        upump_uring_mgr_reap(uring_mgr);
+    }
+}
+
+/** @This allocates a new upump_uring.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_uring_mgr structure
+ * @param event type of event to watch for
+ * @param args optional parameters depending on event type
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static struct upump *upump_uring_alloc(struct upump_mgr *mgr,
+                                       int event, va_list args)
+{
+    if (event >= UPUMP_TYPE_LOCAL) {
+        unsigned int signature = va_arg(args, unsigned int);
+        if (signature != mgr->signature)
+            return NULL;
+    }
+
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+    struct upump_uring *upump_uring =
+        upool_alloc(&uring_mgr->common_mgr.upump_pool, struct upump_uring *);
+    if (unlikely(upump_uring == NULL))
+        return NULL;
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+
+    switch (event) {
+        case UPUMP_TYPE_IDLER:
+            upump_uring->fd = -1;
+            break;
+        case UPUMP_TYPE_TIMER: {
+            uint64_t after = va_arg(args, uint64_t);
+            uint64_t repeat = va_arg(args, uint64_t);
+            upump_uring->fd = -1;
+            upump_uring->timer.after = after;
+            upump_uring->timer.repeat = repeat;
+            upump_uring->timer.expired = false;
+            break;
+        }
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_FD_WRITE:
+            upump_uring->fd = va_arg(args, int);
+            break;
+        case UPUMP_TYPE_SIGNAL: {
+            int signal = va_arg(args, int);
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, signal);
+            int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+            if (fd == -1) {
+                upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+                return NULL;
+            }
+            upump_uring->fd = fd;
+            upump_uring->signal = signal;
+            break;
+        }
+        case UPUMP_URING_TYPE_READ:
+        case UPUMP_URING_TYPE_RECV:
+        case UPUMP_URING_TYPE_RECVMSG:
+            upump_uring->fd = va_arg(args, int);
+            upump_uring->io.buffer = NULL;
+            upump_uring->io.size = 0;
+            upump_uring->io.offset = (uint64_t)-1;
+            upump_uring->io.msghdr = NULL;
+            upump_uring->io.completed = false;
+            upump_uring->io.polling = false;
+            break;
+        default:
+            upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+            return NULL;
+    }
+    uchain_init(&upump_uring->uchain);
+    uchain_init(&upump_uring->uchain_ready);
+    upump_uring->event = event;
+    upump_uring->active = false;
+    upump_uring->inflight = false;
+    upump_uring->ready = false;
+    upump_uring->res = 0;
+    upump_uring->free = false;
+    ulist_add(&uring_mgr->upumps, &upump_uring->uchain);
+
+    upump_common_init(upump);
+
+    return upump;
+}
+
+/** @This starts a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_start(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+
+    upump_uring->active = true;
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_IDLER:
+            uring_mgr->idlers++;
+            break;
+        case UPUMP_TYPE_SIGNAL: {
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, upump_uring->signal);
+            sigprocmask(SIG_BLOCK, &mask, NULL);
+            upump_uring_submit(uring_mgr, upump_uring);
+            break;
+        }
+        case UPUMP_URING_TYPE_READ:
+        case UPUMP_URING_TYPE_RECV:
+        case UPUMP_URING_TYPE_RECVMSG:
+            if (upump_uring->io.completed) {
+                upump_uring->ready = true;
+                ulist_add(&uring_mgr->ready, &upump_uring->uchain_ready);
+                break;
+            }
+            /* fallthrough */
+        default:
+            upump_uring_submit(uring_mgr, upump_uring);
+            break;
+    }
+}
+
+/** @This stops a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_stop(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+
+    upump_uring->active = false;
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_IDLER:
+            uring_mgr->idlers--;
+            break;
+        case UPUMP_TYPE_SIGNAL: {
+            upump_uring_cancel(uring_mgr, upump_uring);
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, upump_uring->signal);
+            sigprocmask(SIG_UNBLOCK, &mask, NULL);
+            break;
+        }
+        default:
+            upump_uring_cancel(uring_mgr, upump_uring);
+            break;
+    }
+}
+
+/** @This restarts a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_restart(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_TIMER: {
+            bool pending = upump_uring->inflight || upump_uring->ready;
+            upump_uring->active = false;
+            upump_uring_cancel(uring_mgr, upump_uring);
+            upump_uring->active = true;
+
+            /* a pending repeating timer is rearmed with its period */
+            uint64_t after = upump_uring->timer.after;
+            if (pending && upump_uring->timer.repeat)
+                upump_uring->timer.after = upump_uring->timer.repeat;
+            upump_uring_submit(uring_mgr, upump_uring);
+            upump_uring->timer.after = after;
+            break;
+        }
+        default:
+            if (!upump_uring->active)
+                upump_uring_real_start(upump, status);
+            break;
+    }
+}
+
+/** @This releases the memory space previously used by a pump.
+ *
+ * @param upump description structure of the pump
+ */
+static void upump_uring_free(struct upump *upump)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    upump_stop(upump);
+    upump_common_clean(upump);
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    if (upump_uring->event == UPUMP_TYPE_SIGNAL)
+        close(upump_uring->fd);
+    if (uring_mgr->running)
+        upump_uring->free = true;
+    else {
+        ulist_delete(&upump_uring->uchain);
+        upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+    }
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upump_uring or NULL in case of allocation error
+ */
+static void *upump_uring_alloc_inner(struct upool *upool)
+{
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_pool(upool);
+    struct upump_uring *upump_uring = malloc(sizeof(struct upump_uring));
+    if (unlikely(upump_uring == NULL))
+        return NULL;
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    upump->mgr = upump_common_mgr_to_upump_mgr(common_mgr);
+    return upump_uring;
+}
+
+/** @internal @This frees a upump_uring.
+ *
+ * @param upool pointer to upool
+ * @param upump_uring pointer to a upump_uring structure to free
+ */
+static void upump_uring_free_inner(struct upool *upool, void *upump_uring)
+{
+    free(upump_uring);
+}
+
+/** @internal @This sets the buffer of the next I/O operation.
+ *
+ * @param upump description structure of the pump
+ * @param buffer buffer to fill in
+ * @param size size of the buffer
+ * @param offset offset to read from
+ * @param msghdr message header to fill in
+ * @return an error code
+ */
+static int _upump_uring_set_buffer(struct upump *upump, uint8_t *buffer,
+                                   size_t size, uint64_t offset,
+                                   struct msghdr *msghdr)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    if (unlikely(upump_uring->inflight || upump_uring->io.completed))
+        return UBASE_ERR_BUSY;
+
+    upump_uring->io.buffer = buffer;
+    upump_uring->io.size = size;
+    upump_uring->io.offset = offset;
+    upump_uring->io.msghdr = msghdr;
+    if (upump_uring->active)
+        upump_uring_submit(uring_mgr, upump_uring);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This gets the result of the completed I/O operation.
+ *
+ * @param upump description structure of the pump
+ * @param ret_p filled in with the result
+ * @return an error code
+ */
+static int _upump_uring_get_result(struct upump *upump, ssize_t *ret_p)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    if (upump_uring->res < 0) {
+        errno = -upump_uring->res;
+        *ret_p = -1;
+    } else
+        *ret_p = upump_uring->res;
+    return UBASE_ERR_NONE;
+}
+
+/** @This processes control commands on a upump_uring.
+ *
+ * @param upump description structure of the pump
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_uring_control(struct upump *upump, int command, va_list args)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+
+    switch (command) {
+        case UPUMP_START:
+            upump_common_start(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_RESTART:
+            upump_common_restart(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_STOP:
+            upump_common_stop(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_FREE:
+            upump_uring_free(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_GET_STATUS: {
+            int *status_p = va_arg(args, int *);
+            upump_common_get_status(upump, status_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_SET_STATUS: {
+            int status = va_arg(args, int);
+            upump_common_set_status(upump, status);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_ALLOC_BLOCKER: {
+            struct upump_blocker **p = va_arg(args, struct upump_blocker **);
+            *p = upump_common_blocker_alloc(upump);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_FREE_BLOCKER: {
+            struct upump_blocker *blocker =
+                va_arg(args, struct upump_blocker *);
+            upump_common_blocker_free(blocker);
+            return UBASE_ERR_NONE;
+        }
+
+        case UPUMP_URING_SET_BUFFER: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_URING_SIGNATURE)
+            uint8_t *buffer = va_arg(args, uint8_t *);
+            size_t size = va_arg(args, size_t);
+            uint64_t offset = va_arg(args, uint64_t);
+            if (upump_uring->event != UPUMP_URING_TYPE_READ &&
+                upump_uring->event != UPUMP_URING_TYPE_RECV)
+                return UBASE_ERR_INVALID;
+            return _upump_uring_set_buffer(upump, buffer, size, offset,
+                                           NULL);
+        }
+        case UPUMP_URING_SET_MSGHDR: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_URING_SIGNATURE)
+            struct msghdr *msghdr = va_arg(args, struct msghdr *);
+            if (upump_uring->event != UPUMP_URING_TYPE_RECVMSG)
+                return UBASE_ERR_INVALID;
+            return _upump_uring_set_buffer(upump, NULL, 0, (uint64_t)-1,
+                                           msghdr);
+        }
+        case UPUMP_URING_GET_RESULT: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_URING_SIGNATURE)
+            ssize_t *ret_p = va_arg(args, ssize_t *);
+            if (!upump_uring_is_io(upump_uring))
+                return UBASE_ERR_INVALID;
+            return _upump_uring_get_result(upump, ret_p);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This dispatches a triggered pump.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ * @param upump_uring pointer to pump
+ */
+static void upump_uring_dispatch(struct upump_uring_mgr *uring_mgr,
+                                 struct upump_uring *upump_uring)
+{
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_TIMER:
+            if (upump_uring->timer.repeat) {
+                uint64_t after = upump_uring->timer.after;
+                upump_uring->timer.after = upump_uring->timer.repeat;
+                upump_uring_submit(uring_mgr, upump_uring);
+                upump_uring->timer.after = after;
+            } else
+                upump_uring->timer.expired = true;
+            upump_common_dispatch(upump);
+            return;
+
+        case UPUMP_TYPE_SIGNAL: {
+            struct signalfd_siginfo siginfo;
+            while (read(upump_uring->fd, &siginfo, sizeof(siginfo)) ==
+                   sizeof(siginfo));
+            break;
+        }
+        case UPUMP_URING_TYPE_READ:
+        case UPUMP_URING_TYPE_RECV:
+        case UPUMP_URING_TYPE_RECVMSG:
+            /* the buffer is consumed */
+            upump_uring->io.completed = false;
+            upump_uring->io.buffer = NULL;
+            upump_uring->io.msghdr = NULL;
+            upump_common_dispatch(upump);
+            return;
+
+        default:
+            break;
+    }
+
+    upump_common_dispatch(upump);
+    if (upump_uring->active && !upump_uring->free && !upump_uring->inflight)
+        upump_uring_submit(uring_mgr, upump_uring);
+}
+
+/** @internal @This counts the pumps preventing the event loop from
+ * returning.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ * @return number of blocking pumps
+ */
+static unsigned int upump_uring_mgr_blocking(struct upump_uring_mgr *uring_mgr)
+{
+    unsigned int blocking = 0;
+    struct uchain *uchain;
+    ulist_foreach(&uring_mgr->upumps, uchain) {
+        struct upump_uring *upump_uring = upump_uring_from_uchain(uchain);
+        if (!upump_uring->active || !upump_uring->common.status ||
+            upump_uring->free)
+            continue;
+        if (upump_uring->event == UPUMP_TYPE_TIMER &&
+            upump_uring->timer.expired)
+            continue;
+        blocking++;
+    }
+    return blocking;
+}
+
+/** @internal @This runs an event loop.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param mutex mutual exclusion primitives to access the event loop
+ * @return an error code
+ */
+static int upump_uring_mgr_run(struct upump_mgr *mgr, struct umutex *mutex)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+    int err = UBASE_ERR_NONE;
+
+    if (mutex != NULL)
+        umutex_lock(mutex);
+
+    while (upump_uring_mgr_blocking(uring_mgr) > 0) {
+        bool wait = uring_mgr->idlers == 0 && ulist_empty(&uring_mgr->ready);
+
+        if (mutex != NULL && wait)
+            umutex_unlock(mutex);
+        err = upump_uring_mgr_enter(uring_mgr, wait ? 1 : 0);
+        if (mutex != NULL && wait)
+            umutex_lock(mutex);
+        if (unlikely(!ubase_check(err)))
+            break;
+
+        upump_uring_mgr_reap(uring_mgr);
+
+        uring_mgr->running = true;
+
+        if (ulist_empty(&uring_mgr->ready)) {
+            struct uchain *uchain;
+            ulist_foreach(&uring_mgr->upumps, uchain) {
+                struct upump_uring *upump_uring =
+                    upump_uring_from_uchain(uchain);
+                if (upump_uring->event == UPUMP_TYPE_IDLER &&
+                    upump_uring->active && !upump_uring->free)
+                    upump_common_dispatch(upump_uring_to_upump(upump_uring));
+            }
+        }
+
+        struct uchain *uchain;
+        while ((uchain = ulist_pop(&uring_mgr->ready)) != NULL) {
+            struct upump_uring *upump_uring =
+                upump_uring_from_uchain_ready(uchain);
+            upump_uring->ready = false;
+            if (upump_uring->active && !upump_uring->free)
+                upump_uring_dispatch(uring_mgr, upump_uring);
+        }
+
+        uring_mgr->running = false;
+
+        struct uchain *uchain_tmp;
+        ulist_delete_foreach(&uring_mgr->upumps, uchain, uchain_tmp) {
+            struct upump_uring *upump_uring = upump_uring_from_uchain(uchain);
+            if (upump_uring->free) {
+                ulist_delete(&upump_uring->uchain);
+                upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+            }
+        }
+    }
+
+    if (mutex != NULL)
+        umutex_unlock(mutex);
+
+    return err;
+}
+
+/** @This processes control commands on a upump_uring_mgr.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_uring_mgr_control(struct upump_mgr *mgr,
+                                   int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_MGR_RUN: {
+            struct umutex *mutex = va_arg(args, struct umutex *);
+            return upump_uring_mgr_run(mgr, mutex);
+        }
+        case UPUMP_MGR_VACUUM:
+            upump_common_mgr_vacuum(mgr);
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This unmaps the rings and closes the io_uring descriptor.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ */
+static void upump_uring_mgr_close(struct upump_uring_mgr *uring_mgr)
+{
+    if (uring_mgr->sqes != NULL)
+        munmap(uring_mgr->sqes, uring_mgr->sqes_size);
+    if (uring_mgr->cq_map != NULL)
+        munmap(uring_mgr->cq_map, uring_mgr->cq_map_size);
+    if (uring_mgr->sq_map != NULL)
+        munmap(uring_mgr->sq_map, uring_mgr->sq_map_size);
+    close(uring_mgr->fd);
+}
+
+/** @internal @This sets up the io_uring instance and maps its rings.
+ *
+ * @param uring_mgr pointer to upump_uring_mgr structure
+ * @return an error code
+ */
+static int upump_uring_mgr_open(struct upump_uring_mgr *uring_mgr)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CLAMP;
+#ifdef IORING_SETUP_COOP_TASKRUN
+    params.flags |= IORING_SETUP_COOP_TASKRUN;
+#endif
+    int fd = syscall(__NR_io_uring_setup, UPUMP_URING_ENTRIES, &params);
+    if (fd < 0 && errno == EINVAL) {
+        /* older kernel */
+        memset(&params, 0, sizeof(params));
+        fd = syscall(__NR_io_uring_setup, UPUMP_URING_ENTRIES, &params);
+    }
+    if (fd < 0)
+        return UBASE_ERR_EXTERNAL;
+
+    uring_mgr->fd = fd;
+    uring_mgr->sq_map = NULL;
+    uring_mgr->cq_map = NULL;
+    uring_mgr->sqes = NULL;
+
+    uring_mgr->sq_map_size = params.sq_off.array +
+                             params.sq_entries * sizeof(unsigned int);
+    uring_mgr->cq_map_size = params.cq_off.cqes +
+                             params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && uring_mgr->cq_map_size > uring_mgr->sq_map_size)
+        uring_mgr->sq_map_size = uring_mgr->cq_map_size;
+
+    void *sq_map = mmap(NULL, uring_mgr->sq_map_size,
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQ_RING);
+    if (sq_map == MAP_FAILED) {
+        upump_uring_mgr_close(uring_mgr);
+        return UBASE_ERR_EXTERNAL;
+    }
+    uring_mgr->sq_map = sq_map;
+
+    void *cq_map = sq_map;
+    if (!single_mmap) {
+        cq_map = mmap(NULL, uring_mgr->cq_map_size,
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_CQ_RING);
+        if (cq_map == MAP_FAILED) {
+            upump_uring_mgr_close(uring_mgr);
+            return UBASE_ERR_EXTERNAL;
+        }
+        uring_mgr->cq_map = cq_map;
+    }
+
+    uring_mgr->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, uring_mgr->sqes_size,
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        upump_uring_mgr_close(uring_mgr);
+        return UBASE_ERR_EXTERNAL;
+    }
+    uring_mgr->sqes = sqes;
+
+    uint8_t *sq = sq_map;
+    uring_mgr->sq_head = (unsigned int *)(sq + params.sq_off.head);
+    uring_mgr->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    uring_mgr->sq_mask = *(unsigned int *)(sq + params.sq_off.ring_mask);
+    uring_mgr->sq_entries = params.sq_entries;
+    uring_mgr->sq_local_tail = *uring_mgr->sq_tail;
+    unsigned int *array = (unsigned int *)(sq + params.sq_off.array);
+    for (unsigned int i = 0; i < params.sq_entries; i++)
+        array[i] = i;
+
+    uint8_t *cq = cq_map;
+    uring_mgr->cq_head = (unsigned int *)(cq + params.cq_off.head);
+    uring_mgr->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    uring_mgr->cq_mask = *(unsigned int *)(cq + params.cq_off.ring_mask);
+    uring_mgr->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return UBASE_ERR_NONE;
+}
+
+/** @This frees a upump manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upump_uring_mgr_free(struct urefcount *urefcount)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_urefcount(urefcount);
+    upump_common_mgr_clean(upump_uring_mgr_to_upump_mgr(uring_mgr));
+    upump_uring_mgr_close(uring_mgr);
+    free(uring_mgr);
+}
+
+/** @This allocates and initializes a upump_uring_mgr structure.
+ *
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL if io_uring
+ * is not available
+ */
+struct upump_mgr *upump_uring_mgr_alloc(uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth)
+{
+    struct upump_uring_mgr *uring_mgr =
+        malloc(sizeof(struct upump_uring_mgr) +
+               upump_common_mgr_sizeof(upump_pool_depth,
+                                       upump_blocker_pool_depth));
+    if (unlikely(uring_mgr == NULL))
+        return NULL;
+
+    if (unlikely(!ubase_check(upump_uring_mgr_open(uring_mgr)))) {
+        free(uring_mgr);
+        return NULL;
+    }
+
+    struct upump_mgr *mgr = upump_uring_mgr_to_upump_mgr(uring_mgr);
+    mgr->signature = UPUMP_URING_SIGNATURE;
+    urefcount_init(upump_uring_mgr_to_urefcount(uring_mgr),
+                   upump_uring_mgr_free);
+    uring_mgr->common_mgr.mgr.refcount =
+        upump_uring_mgr_to_urefcount(uring_mgr);
+    uring_mgr->common_mgr.mgr.upump_alloc = upump_uring_alloc;
+    uring_mgr->common_mgr.mgr.upump_control = upump_uring_control;
+    uring_mgr->common_mgr.mgr.upump_mgr_control = upump_uring_mgr_control;
+    upump_common_mgr_init(mgr, upump_pool_depth, upump_blocker_pool_depth,
+                          uring_mgr->upool_extra,
+                          upump_uring_real_start, upump_uring_real_stop,
+                          upump_uring_real_restart,
+                          upump_uring_alloc_inner, upump_uring_free_inner);
+
+    ulist_init(&uring_mgr->upumps);
+    ulist_init(&uring_mgr->ready);
+    uring_mgr->idlers = 0;
+    uring_mgr->running = false;
+    return mgr;
+}
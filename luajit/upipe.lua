@@ -292,6 +292,7 @@ local sig = {
     void = fourcc('v','o','i','d'),
     flow = fourcc('f','l','o','w'),
     rtp_fec = fourcc('r','f','c',' '),
+    rtp_fec_enc = fourcc('r','f','c','e'),
 }
 
 ffi.metatype("struct upipe_mgr", {
@@ -30,6 +30,10 @@ tests += ubuf_block_mem_test
 ubuf_block_mem_test-src = ubuf_block_mem_test.c
 ubuf_block_mem_test-libs = libupipe
 
+tests += ubuf_block_mmap_test
+ubuf_block_mmap_test-src = ubuf_block_mmap_test.c
+ubuf_block_mmap_test-libs = libupipe
+
 tests += ubuf_pic_clear_test
 ubuf_pic_clear_test-src = ubuf_pic_clear_test.c
 ubuf_pic_clear_test-libs = libupipe
@@ -54,6 +58,17 @@ tests += udeal_test
 udeal_test-src = udeal_test.c
 udeal_test-libs = libupump_ev pthread
 
+tests += udict_hash_test.sh
+udict_hash_test.sh-deps = udict_hash_test
+
+test-targets += udict_hash_bench
+udict_hash_bench-src = udict_hash_bench.c
+udict_hash_bench-libs = libupipe
+
+test-targets += udict_hash_test
+udict_hash_test-src = udict_hash_test.c
+udict_hash_test-libs = libupipe
+
 tests += udict_inline_test.sh
 udict_inline_test.sh-deps = udict_inline_test
 
@@ -72,14 +87,22 @@ tests += umem_alloc_test
 umem_alloc_test-src = umem_alloc_test.c
 umem_alloc_test-libs = libupipe
 
+tests += umem_arena_test
+umem_arena_test-src = umem_arena_test.c
+umem_arena_test-libs = libupipe
+
 tests += umem_pool_test
 umem_pool_test-src = umem_pool_test.c
-umem_pool_test-libs = libupipe
+umem_pool_test-libs = libupipe pthread
 
 tests += upipe_a52_framer_test
 upipe_a52_framer_test-src = upipe_a52_framer_test.c
 upipe_a52_framer_test-libs = libupipe libupipe_framers bitstream
 
+tests += upipe_aes_encrypt_test
+upipe_aes_encrypt_test-src = upipe_aes_encrypt_test.c
+upipe_aes_encrypt_test-libs = libupipe libupipe_modules
+
 tests += upipe_aggregate_test
 upipe_aggregate_test-src = upipe_aggregate_test.c
 upipe_aggregate_test-libs = libupipe libupipe_modules
@@ -246,6 +269,10 @@ test-targets += upipe_h265_framer_test_build
 upipe_h265_framer_test_build-src = upipe_h265_framer_test_build.c
 upipe_h265_framer_test_build-libs = libupipe libupipe_x265 bitstream
 
+tests += upipe_hls_sink_test
+upipe_hls_sink_test-src = upipe_hls_sink_test.c
+upipe_hls_sink_test-libs = libupipe libupipe_hls bitstream
+
 tests += upipe_htons_test
 upipe_htons_test-src = upipe_htons_test.c
 upipe_htons_test-libs = libupipe libupipe_modules
@@ -255,6 +282,10 @@ upipe_http_src_test-src = upipe_http_src_test.c
 upipe_http_src_test-libs = libupipe libupipe_modules libupump_ev
 upipe_http_src_test-opt-libs = libupipe_bearssl libupipe_openssl
 
+tests += upipe_input_chain_test
+upipe_input_chain_test-src = upipe_input_chain_test.c
+upipe_input_chain_test-libs = libupipe
+
 tests += upipe_interlace_test
 upipe_interlace_test-src = upipe_interlace_test.c
 upipe_interlace_test-libs = libupipe libupipe_modules
@@ -290,6 +321,17 @@ upipe_multicat_test-src = upipe_multicat_test.c
 upipe_multicat_test-deps = upipe_fsink
 upipe_multicat_test-libs = libupipe libupipe_modules libupump_ev
 
+tests += upipe_netmap_test
+upipe_netmap_test-src = upipe_netmap_test.c
+upipe_netmap_test-libs = libupipe libupipe_netmap libupump_ev
+
+tests += upipe_xdp_test.sh
+upipe_xdp_test.sh-deps = upipe_xdp_test
+
+test-targets += upipe_xdp_test
+upipe_xdp_test-src = upipe_xdp_test.c
+upipe_xdp_test-libs = libupipe libupipe_xdp libupump_ev
+
 tests += upipe_null_test
 upipe_null_test-src = upipe_null_test.c
 upipe_null_test-libs = libupipe libupipe_modules
@@ -313,6 +355,11 @@ tests += upipe_probe_uref_test
 upipe_probe_uref_test-src = upipe_probe_uref_test.c
 upipe_probe_uref_test-libs = libupipe libupipe_modules
 
+tests += upipe_pthread_transfer_test
+upipe_pthread_transfer_test-src = upipe_pthread_transfer_test.c
+upipe_pthread_transfer_test-libs = libupipe libupipe_pthread libupump_ev \
+                                   pthread
+
 tests += upipe_queue_test
 upipe_queue_test-src = upipe_queue_test.c
 upipe_queue_test-libs = libupipe libupipe_modules libupump_ev
@@ -325,10 +372,28 @@ tests += upipe_row_split_test
 upipe_row_split_test-src = upipe_row_split_test.c
 upipe_row_split_test-libs = libupipe libupipe_modules libupump_ev
 
+tests += upipe_rtcp_fb_receiver_test
+upipe_rtcp_fb_receiver_test-src = upipe_rtcp_fb_receiver_test.c
+upipe_rtcp_fb_receiver_test-libs = libupipe libupipe_modules libupipe_filters \
+                                   bitstream
+
 tests += upipe_rtp_decaps_test
 upipe_rtp_decaps_test-src = upipe_rtp_decaps_test.c
 upipe_rtp_decaps_test-libs = libupipe libupipe_modules bitstream
 
+tests += upipe_rtp_fec_test
+upipe_rtp_fec_test-src = upipe_rtp_fec_test.c
+upipe_rtp_fec_test-libs = libupipe libupipe_ts libupump_ev bitstream
+
+tests += upipe_rtp_fec_enc_test
+upipe_rtp_fec_enc_test-src = upipe_rtp_fec_enc_test.c
+upipe_rtp_fec_enc_test-libs = libupipe libupipe_ts libupump_ev bitstream
+
+tests += upipe_rtp_feedback_test
+upipe_rtp_feedback_test-src = upipe_rtp_feedback_test.c
+upipe_rtp_feedback_test-libs = libupipe libupipe_modules libupipe_filters \
+                               libupump_ev bitstream
+
 tests += upipe_rtp_prepend_test
 upipe_rtp_prepend_test-src = upipe_rtp_prepend_test.c
 upipe_rtp_prepend_test-libs = libupipe libupipe_modules bitstream
@@ -417,6 +482,14 @@ tests += upipe_ts_encaps_test
 upipe_ts_encaps_test-src = upipe_ts_encaps_test.c
 upipe_ts_encaps_test-libs = libupipe libupipe_ts bitstream
 
+test-targets += upipe_ts_mux_bench
+upipe_ts_mux_bench-src = upipe_ts_mux_bench.c
+upipe_ts_mux_bench-libs = libupipe libupipe_modules libupipe_ts
+
+tests += upipe_ts_mux_scheduler_test
+upipe_ts_mux_scheduler_test-src = upipe_ts_mux_scheduler_test.c
+upipe_ts_mux_scheduler_test-libs = libupipe libupipe_ts bitstream
+
 tests += upipe_ts_nit_decoder_test
 upipe_ts_nit_decoder_test-src = upipe_ts_nit_decoder_test.c
 upipe_ts_nit_decoder_test-libs = libupipe libupipe_ts bitstream
@@ -641,12 +714,35 @@ tests += upump_ev_test
 upump_ev_test-src = upump_ev_test.c upump_common_test.c upump_common_test.h
 upump_ev_test-libs = libupump_ev
 
+tests += upump_pthread_pool_test
+upump_pthread_pool_test-src = upump_pthread_pool_test.c \
+                              upump_pthread_pool_common_test.c \
+                              upump_pthread_pool_common_test.h
+upump_pthread_pool_test-libs = libupipe libupipe_pthread libupipe_modules \
+                               libupump_ev pthread
+
+tests += upump_pthread_pool_uring_test
+upump_pthread_pool_uring_test-src = upump_pthread_pool_uring_test.c \
+                                    upump_pthread_pool_common_test.c \
+                                    upump_pthread_pool_common_test.h
+upump_pthread_pool_uring_test-libs = libupipe libupipe_pthread \
+                                     libupipe_modules libupump_uring pthread
+
 tests += upump_srt_test
 upump_srt_test-src = upump_srt_test.c upump_common_test.c upump_common_test.h
 upump_srt_test-libs = libupump_srt srt
 
+tests += upump_uring_test
+upump_uring_test-src = upump_uring_test.c upump_common_test.c \
+                       upump_common_test.h
+upump_uring_test-libs = libupump_uring
+
 $(builddir)/upump_common_test.o: CFLAGS += $(call try_cc,-Wno-logical-op)
 
+tests += uqueue_spsc_test
+uqueue_spsc_test-src = uqueue_spsc_test.c
+uqueue_spsc_test-libs = libupump_ev libev pthread
+
 tests += uref_dump_test.sh
 uref_dump_test.sh-deps = uref_dump_test
 
@@ -671,6 +767,14 @@ ustring_test.sh-deps = ustring_test
 test-targets += ustring_test
 ustring_test-src = ustring_test.c
 
+tests += utrace_ring_test.sh
+utrace_ring_test.sh-deps = utrace_ring_test
+
+test-targets += utrace_ring_test
+utrace_ring_test-src = utrace_ring_test.c
+utrace_ring_test-deps = utrace
+utrace_ring_test-libs = libupipe pthread
+
 tests += uuri_test
 uuri_test-src = uuri_test.c
 uuri_test-libs = libupipe
@@ -2,12 +2,15 @@ tests = checkasm
 checkasm-deps = x86asm
 
 checkasm-src = \
+    aes.c \
     checkasm.c \
     checkasm.h \
     planar10_input.c \
     planar8_input.c \
     sdi_input.c \
     timer.h \
+    ts_crc.c \
+    ubuf_block_scan.c \
     uyvy_input.c \
     v210_input.c
 
@@ -19,6 +22,15 @@ checkasm-cppflags = -I$(top_srcdir)
 checkasm-libs = libavutil
 
 $(builddir)/checkasm: \
+    $(top_builddir)/lib/upipe-modules/aes.o \
+    $(top_builddir)/lib/upipe-modules/aes_aarch64.o \
+    $(top_builddir)/lib/upipe-modules/aes_x86.o \
+    $(top_builddir)/lib/upipe/ubuf_block_scan.o \
+    $(top_builddir)/lib/upipe/ubuf_block_scan_aarch64.o \
+    $(top_builddir)/lib/upipe/x86/ubuf_block_scan.o \
+    $(top_builddir)/lib/upipe-ts/upipe_ts_crc.o \
+    $(top_builddir)/lib/upipe-ts/upipe_ts_crc_aarch64.o \
+    $(top_builddir)/lib/upipe-ts/upipe_ts_crc_x86.o \
     $(top_builddir)/lib/upipe-v210/v210enc.o \
     $(top_builddir)/lib/upipe-v210/v210dec.o \
     $(top_builddir)/lib/upipe-v210/x86/v210enc.o \
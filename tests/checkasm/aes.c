@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "checkasm.h"
+#include "lib/upipe-modules/aes.h"
+
+#define NUM_BLOCKS 256
+
+static void randomize(uint8_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+static void check_cbc(upipe_aes128_cbc_func func, const char *name)
+{
+    uint8_t key[16], round_keys[UPIPE_AES128_ROUND_KEYS_SIZE];
+    uint8_t iv[16];
+    uint8_t src[16 * NUM_BLOCKS];
+
+    randomize(key, sizeof(key));
+    randomize(iv, sizeof(iv));
+    randomize(src, sizeof(src));
+    upipe_aes128_expand_key(key, round_keys);
+
+    if (check_func(func, "%s", name)) {
+        static const int counts[] = { 1, 3, 7, 8, 9, 15, 16, 17, NUM_BLOCKS };
+        uint8_t buf0[16 * NUM_BLOCKS], buf1[16 * NUM_BLOCKS];
+        uint8_t iv0[16], iv1[16];
+        declare_func(void, uint8_t *buf, uintptr_t blocks,
+                     const uint8_t *round_keys, uint8_t *iv);
+
+        for (int i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+            memcpy(buf0, src, 16 * counts[i]);
+            memcpy(buf1, src, 16 * counts[i]);
+            memcpy(iv0, iv, sizeof(iv));
+            memcpy(iv1, iv, sizeof(iv));
+            call_ref(buf0, counts[i], round_keys, iv0);
+            call_new(buf1, counts[i], round_keys, iv1);
+            if (memcmp(buf0, buf1, 16 * counts[i]) || memcmp(iv0, iv1, 16))
+                fail();
+        }
+        bench_new(buf1, NUM_BLOCKS, round_keys, iv1);
+    }
+    report("%s", name);
+}
+
+void checkasm_check_aes(void)
+{
+    struct {
+        upipe_aes128_cbc_func decrypt;
+        upipe_aes128_cbc_func encrypt;
+    } s = {
+        .decrypt = upipe_aes128_cbc_decrypt_c,
+        .encrypt = upipe_aes128_cbc_encrypt_c,
+    };
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    int cpu_flags = av_get_cpu_flags();
+
+#ifdef AV_CPU_FLAG_AESNI
+    if (cpu_flags & AV_CPU_FLAG_AESNI) {
+        s.decrypt = upipe_aes128_cbc_decrypt_aesni;
+        s.encrypt = upipe_aes128_cbc_encrypt_aesni;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AESNI && cpu_flags & AV_CPU_FLAG_AVX2 &&
+        __builtin_cpu_supports("vaes"))
+        s.decrypt = upipe_aes128_cbc_decrypt_vaes;
+#endif
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+    if (av_get_cpu_flags() & AV_CPU_FLAG_ARMV8 &&
+        getauxval(AT_HWCAP) & HWCAP_AES) {
+        s.decrypt = upipe_aes128_cbc_decrypt_armv8;
+        s.encrypt = upipe_aes128_cbc_encrypt_armv8;
+    }
+#endif
+
+    check_cbc(s.decrypt, "aes128_cbc_decrypt");
+    check_cbc(s.encrypt, "aes128_cbc_encrypt");
+}
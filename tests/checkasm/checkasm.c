@@ -75,9 +75,12 @@ static const struct {
     const char *name;
     void (*func)(void);
 } tests[] = {
+    { "aes", checkasm_check_aes },
     { "planar10_input", checkasm_check_planar10_input },
     { "planar8_input", checkasm_check_planar8_input },
     { "sdi_input", checkasm_check_sdi_input },
+    { "ts_crc", checkasm_check_ts_crc },
+    { "ubuf_block_scan", checkasm_check_ubuf_block_scan },
     { "uyvy_input", checkasm_check_uyvy_input },
     { "v210_input", checkasm_check_v210_input },
     { NULL, NULL }
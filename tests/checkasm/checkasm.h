@@ -78,9 +78,12 @@
 #define HAVE_RDTSC 0
 #include "timer.h"
 
+void checkasm_check_aes(void);
 void checkasm_check_planar10_input(void);
 void checkasm_check_planar8_input(void);
 void checkasm_check_sdi_input(void);
+void checkasm_check_ts_crc(void);
+void checkasm_check_ubuf_block_scan(void);
 void checkasm_check_uyvy_input(void);
 void checkasm_check_v210_input(void);
 
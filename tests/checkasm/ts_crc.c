@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "checkasm.h"
+#include "lib/upipe-ts/upipe_ts_crc.h"
+
+#define MAX_SIZE 4096
+
+static void randomize(uint8_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+void checkasm_check_ts_crc(void)
+{
+    upipe_ts_crc32_func func = upipe_ts_crc32_c;
+    uint8_t buf[MAX_SIZE + 1];
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    int cpu_flags = av_get_cpu_flags();
+
+#ifdef AV_CPU_FLAG_CLMUL
+    if (cpu_flags & AV_CPU_FLAG_CLMUL && cpu_flags & AV_CPU_FLAG_SSSE3)
+        func = upipe_ts_crc32_clmul;
+#endif
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+    if (av_get_cpu_flags() & AV_CPU_FLAG_ARMV8 &&
+        getauxval(AT_HWCAP) & HWCAP_PMULL)
+        func = upipe_ts_crc32_pmull;
+#endif
+
+    randomize(buf, sizeof(buf));
+
+    if (check_func(func, "ts_crc32")) {
+        declare_func(uint32_t, uint32_t crc, const uint8_t *p, uintptr_t size);
+
+        for (int size = 0; size <= 300; size++) {
+            /* unaligned buffers and arbitrary initial CRCs */
+            uint32_t crc = rnd();
+            if (call_ref(crc, buf + (size & 1), size) !=
+                call_new(crc, buf + (size & 1), size))
+                fail();
+        }
+        if (call_ref(0xffffffff, buf, MAX_SIZE) !=
+            call_new(0xffffffff, buf, MAX_SIZE))
+            fail();
+        bench_new(0xffffffff, buf, MAX_SIZE);
+    }
+    report("ts_crc32");
+}
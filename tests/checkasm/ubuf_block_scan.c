@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "checkasm.h"
+#include "lib/upipe/ubuf_block_scan.h"
+
+#define NUM_POSITIONS 4096
+#define TS_SIZE 188
+#define TS_COUNT 3
+
+static void randomize_startcode(uint8_t *buf, int size, int pos)
+{
+    /* mostly zeros and ones to exercise the false candidates */
+    for (int i = 0; i < size; i++) {
+        int r = rnd() & 7;
+        buf[i] = r < 3 ? 0 : r < 5 ? 1 : rnd();
+        if (i >= 2 && buf[i - 2] == 0 && buf[i - 1] == 0 && buf[i] == 1)
+            buf[i] = 2;
+    }
+    if (pos >= 0) {
+        buf[pos] = 0;
+        buf[pos + 1] = 0;
+        buf[pos + 2] = 1;
+    }
+}
+
+static void randomize_sync(uint8_t *buf, int size, int pos)
+{
+    for (int i = 0; i < size; i++) {
+        buf[i] = rnd();
+        /* lots of isolated sync words */
+        if (!(rnd() & 15) || buf[i] == 0x47)
+            buf[i] = (rnd() & 1) ? 0x47 : 0x48;
+    }
+    for (int i = 0; i < NUM_POSITIONS; i++) {
+        int k;
+        for (k = 0; k < TS_COUNT; k++)
+            if (buf[i + k * TS_SIZE] != 0x47)
+                break;
+        if (k == TS_COUNT)
+            buf[i] = 0x48;
+    }
+    if (pos >= 0)
+        for (int k = 0; k < TS_COUNT; k++)
+            buf[pos + k * TS_SIZE] = 0x47;
+}
+
+void checkasm_check_ubuf_block_scan(void)
+{
+    struct {
+        uintptr_t (*startcode)(const uint8_t *p, uintptr_t positions);
+        uintptr_t (*sync)(const uint8_t *p, uintptr_t positions,
+                          uintptr_t stride, uintptr_t count, uintptr_t word);
+    } s = {
+        .startcode = upipe_ubuf_block_scan_startcode_c,
+        .sync = upipe_ubuf_block_scan_sync_c,
+    };
+
+#ifdef HAVE_X86ASM
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        s.startcode = upipe_ubuf_block_scan_startcode_sse2;
+        s.sync = upipe_ubuf_block_scan_sync_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AVX2) {
+        s.startcode = upipe_ubuf_block_scan_startcode_avx2;
+        s.sync = upipe_ubuf_block_scan_sync_avx2;
+    }
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+    if (av_get_cpu_flags() & AV_CPU_FLAG_NEON &&
+        getauxval(AT_HWCAP) & HWCAP_ASIMD) {
+        s.startcode = upipe_ubuf_block_scan_startcode_neon;
+        s.sync = upipe_ubuf_block_scan_sync_neon;
+    }
+#endif
+
+    if (check_func(s.startcode, "ubuf_block_scan_startcode")) {
+        static const int positions[] = { -1, 0, 1, 31, 32, 63, 1000,
+                                         NUM_POSITIONS - 1 };
+        uint8_t buf[NUM_POSITIONS + 2];
+        declare_func(uintptr_t, const uint8_t *p, uintptr_t positions);
+
+        for (int i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+            randomize_startcode(buf, sizeof(buf), positions[i]);
+            uintptr_t ref = call_ref(buf, NUM_POSITIONS);
+            uintptr_t new = call_new(buf, NUM_POSITIONS);
+            if (ref != new)
+                fail();
+        }
+        randomize_startcode(buf, sizeof(buf), -1);
+        bench_new(buf, NUM_POSITIONS);
+    }
+    report("ubuf_block_scan_startcode");
+
+    if (check_func(s.sync, "ubuf_block_scan_sync")) {
+        static const int positions[] = { -1, 0, 1, 31, 32, 63, 1000,
+                                         NUM_POSITIONS - 1 };
+        uint8_t buf[NUM_POSITIONS + (TS_COUNT - 1) * TS_SIZE];
+        declare_func(uintptr_t, const uint8_t *p, uintptr_t positions,
+                     uintptr_t stride, uintptr_t count, uintptr_t word);
+
+        for (int i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+            randomize_sync(buf, sizeof(buf), positions[i]);
+            uintptr_t ref = call_ref(buf, NUM_POSITIONS, TS_SIZE, TS_COUNT,
+                                     0x47);
+            uintptr_t new = call_new(buf, NUM_POSITIONS, TS_SIZE, TS_COUNT,
+                                     0x47);
+            if (ref != new)
+                fail();
+        }
+        randomize_sync(buf, sizeof(buf), -1);
+        bench_new(buf, NUM_POSITIONS, TS_SIZE, TS_COUNT, 0x47);
+    }
+    report("ubuf_block_scan_sync");
+}
@@ -254,6 +254,37 @@ int main(int argc, char **argv)
     ubase_assert(ubuf_block_find(ubuf1, &offset, 2, 2, 3));
     assert(offset == 2);
 
+    /* test ubuf_block_find with start codes, inside and across segments */
+    ubuf2 = ubuf_block_alloc(mgr, 64);
+    assert(ubuf2 != NULL);
+    wanted = -1;
+    ubase_assert(ubuf_block_write(ubuf2, 0, &wanted, &w));
+    assert(wanted == 64);
+    memset(w, 0xff, 64);
+    w[40] = 0; w[41] = 0; w[42] = 2;
+    w[50] = 0; w[51] = 0; w[52] = 1;
+    w[62] = 0; w[63] = 0;
+    ubase_assert(ubuf_block_unmap(ubuf2, 0));
+    ubuf3 = ubuf_block_alloc(mgr, 64);
+    assert(ubuf3 != NULL);
+    wanted = -1;
+    ubase_assert(ubuf_block_write(ubuf3, 0, &wanted, &w));
+    memset(w, 0xff, 64);
+    w[0] = 1;
+    w[62] = 0;
+    ubase_assert(ubuf_block_unmap(ubuf3, 0));
+    ubase_assert(ubuf_block_append(ubuf2, ubuf3));
+    offset = 0;
+    ubase_assert(ubuf_block_find(ubuf2, &offset, 3, 0, 0, 1));
+    assert(offset == 50);
+    offset++;
+    ubase_assert(ubuf_block_find(ubuf2, &offset, 3, 0, 0, 1));
+    assert(offset == 62);
+    offset++;
+    ubase_nassert(ubuf_block_find(ubuf2, &offset, 3, 0, 0, 1));
+    assert(offset == 64 + 62);
+    ubuf_free(ubuf2);
+
     /* test ubuf_block_stream */
     struct ubuf_block_stream s;
     ubuf_block_stream_init(&s, ubuf1, 0);
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for ubuf manager for block formats pointing to mapped
+ * files
+ */
+
+#undef NDEBUG
+
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block.h"
+#include "upipe/ubuf_block_mmap.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define UBUF_POOL_DEPTH     1
+#define FILE_SIZE           (3 * 4096 + 100)
+
+/** checks that a block contains the file pattern from the given offset */
+static void check_block(struct ubuf *ubuf, uint64_t offset, size_t size)
+{
+    size_t ubuf_size;
+    ubase_assert(ubuf_block_size(ubuf, &ubuf_size));
+    assert(ubuf_size == size);
+
+    int read_size = -1;
+    const uint8_t *r;
+    ubase_assert(ubuf_block_read(ubuf, 0, &read_size, &r));
+    assert(read_size == size);
+    for (size_t i = 0; i < size; i++)
+        assert(r[i] == (uint8_t)(offset + i));
+    ubase_assert(ubuf_block_unmap(ubuf, 0));
+}
+
+int main(int argc, char **argv)
+{
+    char path[] = "ubuf_block_mmap_test.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    unlink(path);
+
+    uint8_t buffer[FILE_SIZE];
+    for (int i = 0; i < FILE_SIZE; i++)
+        buffer[i] = i;
+    assert(write(fd, buffer, FILE_SIZE) == FILE_SIZE);
+
+    /* windows of one page, to test overlapping windows */
+    struct ubuf_mgr *mgr = ubuf_block_mmap_mgr_alloc(UBUF_POOL_DEPTH, 1);
+    assert(mgr != NULL);
+
+    /* no file */
+    assert(ubuf_block_mmap_alloc(mgr, 0, 42) == NULL);
+
+    /* plain blocks are allocated in memory */
+    struct ubuf *ubuf0 = ubuf_block_alloc(mgr, 42);
+    assert(ubuf0 != NULL);
+    int write_size = -1;
+    uint8_t *w;
+    ubase_assert(ubuf_block_write(ubuf0, 0, &write_size, &w));
+    assert(write_size == 42);
+    memset(w, 0, write_size);
+    ubase_assert(ubuf_block_unmap(ubuf0, 0));
+    ubuf_free(ubuf0);
+
+    /* the window size is rounded up to the page size */
+    uint64_t window_size;
+    ubase_assert(ubuf_block_mmap_mgr_get_window(mgr, &window_size));
+    assert(window_size == (uint64_t)sysconf(_SC_PAGESIZE));
+    ubase_assert(ubuf_block_mmap_mgr_set_window(mgr, 0));
+    ubase_assert(ubuf_block_mmap_mgr_get_window(mgr, &window_size));
+    assert(window_size == UBUF_BLOCK_MMAP_DEF_WINDOW);
+    ubase_assert(ubuf_block_mmap_mgr_set_window(mgr, 1));
+
+    ubase_assert(ubuf_block_mmap_mgr_set_fd(mgr, fd));
+    uint64_t size;
+    ubase_assert(ubuf_block_mmap_mgr_get_size(mgr, &size));
+    assert(size == FILE_SIZE);
+
+    struct ubuf *ubuf1 = ubuf_block_mmap_alloc(mgr, 100, 200);
+    assert(ubuf1 != NULL);
+    check_block(ubuf1, 100, 200);
+    printf("Passed 1\n");
+
+    /* the block crosses the end of the window */
+    struct ubuf *ubuf2 = ubuf_block_mmap_alloc(mgr, 4000, 200);
+    assert(ubuf2 != NULL);
+    check_block(ubuf2, 4000, 200);
+    check_block(ubuf1, 100, 200);
+    printf("Passed 2\n");
+
+    /* the mapping is shared */
+    write_size = -1;
+    ubase_nassert(ubuf_block_write(ubuf2, 0, &write_size, &w));
+    struct ubuf *ubuf3 = ubuf_dup(ubuf2);
+    assert(ubuf3 != NULL);
+    check_block(ubuf3, 4000, 200);
+    ubuf_free(ubuf3);
+    ubuf3 = ubuf_block_splice(ubuf2, 50, 100);
+    assert(ubuf3 != NULL);
+    check_block(ubuf3, 4050, 100);
+    ubase_assert(ubuf_block_append(ubuf3, ubuf_dup(ubuf1)));
+    ubase_assert(ubuf_block_size(ubuf3, &size));
+    assert(size == 300);
+    ubuf_free(ubuf3);
+    printf("Passed 3\n");
+
+    /* the size is truncated at the end of the file */
+    ubuf3 = ubuf_block_mmap_alloc(mgr, FILE_SIZE - 50, 200);
+    assert(ubuf3 != NULL);
+    check_block(ubuf3, FILE_SIZE - 50, 50);
+    ubuf_free(ubuf3);
+    assert(ubuf_block_mmap_alloc(mgr, FILE_SIZE, 200) == NULL);
+    printf("Passed 4\n");
+
+    /* the file grows */
+    assert(write(fd, buffer, 100) == 100);
+    ubuf3 = ubuf_block_mmap_alloc(mgr, FILE_SIZE, 100);
+    assert(ubuf3 != NULL);
+    ubase_assert(ubuf_block_size(ubuf3, &size));
+    assert(size == 100);
+    ubuf_free(ubuf3);
+    printf("Passed 5\n");
+
+    /* blocks outlive the file */
+    ubase_assert(ubuf_block_mmap_mgr_set_fd(mgr, -1));
+    close(fd);
+    assert(ubuf_block_mmap_alloc(mgr, 0, 42) == NULL);
+    check_block(ubuf1, 100, 200);
+    check_block(ubuf2, 4000, 200);
+
+    /* the mapping is private */
+    write_size = -1;
+    ubase_assert(ubuf_block_write(ubuf2, 0, &write_size, &w));
+    assert(write_size == 200);
+    w[0] = 0;
+    ubase_assert(ubuf_block_unmap(ubuf2, 0));
+    ubuf_free(ubuf1);
+    ubuf_free(ubuf2);
+    printf("Passed 6\n");
+
+    ubuf_mgr_release(mgr);
+    return 0;
+}
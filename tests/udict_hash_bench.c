@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short benchmark of the hash manager of dictionary attributes against the
+ * inline manager
+ *
+ * Each udict is filled in with the given number of named attributes, after
+ * a few shorthand attributes like those of a typical uref, and the named
+ * attributes are then read and overwritten in turn.
+ */
+
+#undef NDEBUG
+
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_hash.h"
+#include "upipe/udict_inline.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 10
+#define DEFAULT_ATTRIBUTES 32
+#define DEFAULT_LOOPS 100000
+
+/** names of the named attributes */
+static char (*names)[32];
+
+/** @This returns a monotonic date in nanoseconds. */
+static uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/** @This runs the benchmark on a udict manager.
+ *
+ * @param label name of the manager
+ * @param mgr udict manager
+ * @param attributes number of named attributes
+ * @param loops number of loops
+ */
+static void bench(const char *label, struct udict_mgr *mgr,
+                  unsigned int attributes, unsigned int loops)
+{
+    struct udict *udict = udict_alloc(mgr, 0);
+    assert(udict != NULL);
+
+    ubase_assert(udict_set_string(udict, "block.mpegts.", UDICT_TYPE_FLOW_DEF,
+                                  NULL));
+    ubase_assert(udict_set_unsigned(udict, 42, UDICT_TYPE_CLOCK_LATENCY,
+                                    NULL));
+    ubase_assert(udict_set_unsigned(udict, 42, UDICT_TYPE_CLOCK_DURATION,
+                                    NULL));
+    for (unsigned int i = 0; i < attributes; i++)
+        ubase_assert(udict_set_unsigned(udict, i, UDICT_TYPE_UNSIGNED,
+                                        names[i]));
+
+    uint64_t sum = 0;
+    uint64_t start = now();
+    for (unsigned int j = 0; j < loops; j++)
+        for (unsigned int i = 0; i < attributes; i++) {
+            uint64_t u;
+            ubase_assert(udict_get_unsigned(udict, &u, UDICT_TYPE_UNSIGNED,
+                                            names[i]));
+            sum += u;
+        }
+    uint64_t get = now() - start;
+
+    start = now();
+    for (unsigned int j = 0; j < loops; j++)
+        for (unsigned int i = 0; i < attributes; i++)
+            ubase_assert(udict_set_unsigned(udict, j, UDICT_TYPE_UNSIGNED,
+                                            names[i]));
+    uint64_t set = now() - start;
+
+    uint64_t ops = (uint64_t)loops * attributes;
+    printf("%s: %u attributes, get %.1f ns, set %.1f ns (%"PRIu64")\n",
+           label, attributes, (double)get / ops, (double)set / ops, sum);
+    udict_free(udict);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int attributes = argc > 1 ? atoi(argv[1]) : DEFAULT_ATTRIBUTES;
+    unsigned int loops = argc > 2 ? atoi(argv[2]) : DEFAULT_LOOPS;
+    assert(attributes > 0 && loops > 0);
+
+    names = malloc(attributes * sizeof(*names));
+    assert(names != NULL);
+    for (unsigned int i = 0; i < attributes; i++)
+        snprintf(names[i], sizeof(names[i]), "x.bench.attribute%u", i);
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *inline_mgr =
+        udict_inline_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr, -1, -1);
+    assert(inline_mgr != NULL);
+    struct udict_mgr *hash_mgr =
+        udict_hash_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr, -1, -1);
+    assert(hash_mgr != NULL);
+
+    bench("inline", inline_mgr, attributes, loops);
+    bench("hash", hash_mgr, attributes, loops);
+
+    udict_mgr_release(inline_mgr);
+    udict_mgr_release(hash_mgr);
+    umem_mgr_release(umem_mgr);
+    free(names);
+    return 0;
+}
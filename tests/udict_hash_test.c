@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2012-2013 OpenHeadend S.A.R.L.
+ * Copyright (C) 2026 EasyTools
+ *
+ * Authors: Christophe Massiot
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for the hash manager of dictionary attributes
+ */
+
+#undef NDEBUG
+
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_hash.h"
+#include "upipe/udict_dump.h"
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 1
+
+#define SALUTATION "Hello everyone, this is just some padding to make the structure bigger, if you don't mind."
+
+int main(int argc, char **argv)
+{
+    struct uprobe *uprobe = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_DEBUG);
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *mgr = udict_hash_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr,
+                                                 -1, -1);
+    assert(mgr != NULL);
+
+    struct udict *udict1 = udict_alloc(mgr, 0);
+    assert(udict1 != NULL);
+
+    uint8_t opaque[27];
+    memset(opaque, 0xaa, sizeof(opaque));
+    struct udict_opaque o;
+    o.v = opaque;
+    o.size = sizeof(opaque);
+    ubase_assert(udict_set_opaque(udict1, o, UDICT_TYPE_OPAQUE, "x.opaque"));
+    char opaque_hex[55];
+    memset(opaque_hex, 'a', sizeof(opaque_hex) - 1);
+    opaque_hex[sizeof(opaque_hex) - 1] = '\0';
+    ubase_assert(udict_set_opaque_from_hex(udict1, opaque_hex,
+                                           UDICT_TYPE_OPAQUE, "x.opaque_hex"));
+    ubase_assert(udict_set_string(udict1, "pouet", UDICT_TYPE_FLOW_DEF, NULL));
+    ubase_assert(udict_set_void(udict1, NULL, UDICT_TYPE_FLOW_ERROR, NULL));
+    ubase_assert(udict_set_bool(udict1, true, UDICT_TYPE_BOOL, "x.truc"));
+    ubase_assert(udict_set_unsigned(udict1, UINT64_MAX, UDICT_TYPE_CLOCK_DURATION,
+                              NULL));
+    ubase_assert(udict_set_int(udict1, INT64_MAX, UDICT_TYPE_INT, "x.date"));
+    ubase_assert(udict_set_float(udict1, 1.0, UDICT_TYPE_FLOAT, "x.version"));
+    ubase_assert(udict_set_string(udict1, SALUTATION, UDICT_TYPE_STRING,
+                            "x.salutation"));
+    struct urational rational = { .num = 64, .den = 45 };
+    ubase_assert(udict_set_rational(udict1, rational, UDICT_TYPE_RATIONAL, "x.ar"));
+
+    ubase_assert(udict_get_opaque(udict1, &o, UDICT_TYPE_OPAQUE, "x.opaque"));
+    assert(o.size == sizeof(opaque));
+    assert(!memcmp(opaque, o.v, sizeof(opaque)));
+    ubase_assert(udict_get_opaque(udict1, &o, UDICT_TYPE_OPAQUE, "x.opaque_hex"));
+    assert(o.size == sizeof(opaque));
+    assert(!memcmp(opaque, o.v, sizeof(opaque)));
+    const char *string;
+    ubase_assert(udict_get_string(udict1, &string, UDICT_TYPE_FLOW_DEF, NULL));
+    assert(!strcmp(string, "pouet"));
+    ubase_nassert(udict_get_void(udict1, NULL, UDICT_TYPE_VOID, "f.eof"));
+    ubase_assert(udict_get_void(udict1, NULL, UDICT_TYPE_FLOW_ERROR, NULL));
+
+    ubase_assert(udict_delete(udict1, UDICT_TYPE_FLOW_ERROR, NULL));
+    ubase_assert(udict_delete(udict1, UDICT_TYPE_FLOW_DEF, NULL));
+    ubase_nassert(udict_delete(udict1, UDICT_TYPE_VOID, "x.truc"));
+    ubase_nassert(udict_delete(udict1, UDICT_TYPE_BOOL, "k.pts"));
+
+    bool b;
+    ubase_assert(udict_get_bool(udict1, &b, UDICT_TYPE_BOOL, "x.truc"));
+    assert(b);
+    uint64_t u;
+    ubase_assert(udict_get_unsigned(udict1, &u, UDICT_TYPE_CLOCK_DURATION, NULL));
+    assert(u == UINT64_MAX);
+    int64_t d;
+    ubase_assert(udict_get_int(udict1, &d, UDICT_TYPE_INT, "x.date"));
+    assert(d == INT64_MAX);
+    double f;
+    ubase_assert(udict_get_float(udict1, &f, UDICT_TYPE_FLOAT, "x.version"));
+    assert(f == 1.0);
+    ubase_assert(udict_get_string(udict1, &string, UDICT_TYPE_STRING,
+                            "x.salutation"));
+    assert(!strcmp(string, SALUTATION));
+    struct urational r;
+    ubase_assert(udict_get_rational(udict1, &r, UDICT_TYPE_RATIONAL, "x.ar"));
+    assert(r.num == 64 && r.den == 45);
+
+    /* TODO: Test all shorthand attributes. */
+
+    o.v = opaque;
+    o.size = sizeof(opaque);
+
+    ubase_assert(udict_set_opaque(udict1, o, UDICT_TYPE_PIC_BAR_DATA, NULL));
+    ubase_assert(udict_set_opaque(udict1, o, UDICT_TYPE_PIC_CEA_708, NULL));
+
+    ubase_assert(udict_get_opaque(udict1, &o, UDICT_TYPE_PIC_CEA_708, NULL));
+    assert(o.size == sizeof(opaque));
+    assert(!memcmp(opaque, o.v, sizeof(opaque)));
+    ubase_assert(udict_get_opaque(udict1, &o, UDICT_TYPE_PIC_BAR_DATA, NULL));
+    assert(o.size == sizeof(opaque));
+    assert(!memcmp(opaque, o.v, sizeof(opaque)));
+
+    udict_dump(udict1, uprobe);
+
+    struct udict *udict2 = udict_dup(udict1);
+    assert(udict2 != NULL);
+    udict_dump(udict2, uprobe);
+    udict_free(udict2);
+
+    udict2 = udict_copy(mgr, udict1);
+    assert(udict2 != NULL);
+    udict_dump(udict2, uprobe);
+    udict_free(udict2);
+
+    udict_free(udict1);
+
+    {
+        struct udict *udict1 = udict_alloc(mgr, 0);
+        struct udict *udict2 = udict_alloc(mgr, 0);
+
+        udict_set_string(udict1, "void.", UDICT_TYPE_STRING, "f.def");
+        udict_set_string(udict2, "pic.", UDICT_TYPE_STRING, "f.def");
+        assert(udict_cmp(udict1, udict2) != 0);
+        udict_set_string(udict1, "pic.", UDICT_TYPE_STRING, "f.def");
+        assert(udict_cmp(udict1, udict2) == 0);
+        udict_free(udict1);
+        udict_free(udict2);
+    }
+
+    {
+        /* grow the udict past its initial capacity, with deletions */
+        struct udict *udict1 = udict_alloc(mgr, 0);
+        char name[32];
+        for (int i = 0; i < 1000; i++) {
+            snprintf(name, sizeof(name), "x.attr%d", i);
+            ubase_assert(udict_set_unsigned(udict1, i, UDICT_TYPE_UNSIGNED,
+                                            name));
+            if (i % 3 == 0)
+                ubase_assert(udict_delete(udict1, UDICT_TYPE_UNSIGNED, name));
+        }
+        ubase_assert(udict_set_string(udict1, "a", UDICT_TYPE_STRING,
+                                      "x.attr1"));
+        ubase_assert(udict_set_string(udict1, SALUTATION, UDICT_TYPE_STRING,
+                                      "x.attr1"));
+        ubase_nassert(udict_get_void(udict1, NULL, UDICT_TYPE_VOID,
+                                     "x.never_set"));
+
+        struct udict *udict2 = udict_dup(udict1);
+        assert(udict2 != NULL);
+        for (int i = 0; i < 1000; i++) {
+            snprintf(name, sizeof(name), "x.attr%d", i);
+            uint64_t u;
+            if (i % 3 == 0) {
+                ubase_nassert(udict_get_unsigned(udict2, &u,
+                                                 UDICT_TYPE_UNSIGNED, name));
+            } else {
+                ubase_assert(udict_get_unsigned(udict2, &u,
+                                                UDICT_TYPE_UNSIGNED, name));
+                assert(u == (uint64_t)i);
+            }
+        }
+        const char *string;
+        ubase_assert(udict_get_string(udict2, &string, UDICT_TYPE_STRING,
+                                      "x.attr1"));
+        assert(!strcmp(string, SALUTATION));
+        assert(udict_cmp(udict1, udict2) == 0);
+        udict_free(udict1);
+        udict_free(udict2);
+    }
+
+    {
+        /* registered shorthands */
+        enum udict_type type, type2;
+        const char *name;
+        enum udict_type base_type;
+        ubase_assert(udict_hash_register_shorthand("x.custom",
+                                                   UDICT_TYPE_UNSIGNED, &type));
+        assert(type > UDICT_TYPE_PIC_BAR_DATA);
+        ubase_assert(udict_hash_register_shorthand("x.custom",
+                                                   UDICT_TYPE_UNSIGNED, &type2));
+        assert(type2 == type);
+        ubase_nassert(udict_hash_register_shorthand("x.custom",
+                                                    UDICT_TYPE_BOOL, &type2));
+        ubase_assert(udict_hash_register_shorthand("f.def", UDICT_TYPE_STRING,
+                                                   &type2));
+        assert(type2 == UDICT_TYPE_FLOW_DEF);
+
+        struct udict *udict1 = udict_alloc(mgr, 0);
+        ubase_assert(udict_set_unsigned(udict1, 42, type, NULL));
+        uint64_t u;
+        ubase_assert(udict_get_unsigned(udict1, &u, type, NULL));
+        assert(u == 42);
+        ubase_assert(udict_name(udict1, type, &name, &base_type));
+        assert(!strcmp(name, "x.custom"));
+        assert(base_type == UDICT_TYPE_UNSIGNED);
+        ubase_nassert(udict_set_unsigned(udict1, 42, type + 1, NULL));
+        udict_free(udict1);
+    }
+
+    udict_mgr_release(mgr);
+
+    umem_mgr_release(umem_mgr);
+    uprobe_release(uprobe);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for umem arena manager
+ */
+
+#undef NDEBUG
+
+#include "upipe/umem.h"
+#include "upipe/umem_arena.h"
+#include "upipe/upool.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define ARENA_SIZE (4 * 1024 * 1024)
+
+int main(int argc, char **argv)
+{
+    assert(umem_arena_mgr_alloc(ARENA_SIZE, 24, 4, 0) == NULL);
+    assert(umem_arena_mgr_alloc(ARENA_SIZE, 32, 0, 0) == NULL);
+
+    struct umem_mgr *mgr = umem_arena_mgr_alloc_simple(ARENA_SIZE,
+                                                       UMEM_ARENA_HUGETLB);
+    assert(mgr != NULL);
+
+    struct umem umem;
+    assert(umem_alloc(mgr, &umem, 42));
+    uint8_t *p = umem_buffer(&umem);
+    assert(p != NULL);
+    assert(!((uintptr_t)p % 64));
+    memset(p, 0x42, 42);
+    printf("Passed 1\n");
+
+    assert(umem_realloc(&umem, 64));
+    assert(umem_buffer(&umem) == p);
+    assert(umem_realloc(&umem, 8192));
+    p = umem_buffer(&umem);
+    assert(p != NULL);
+    assert(p[0] == 0x42);
+    assert(p[41] == 0x42);
+    memset(p + 42, 0x43, 8192 - 42);
+    umem_free(&umem);
+    printf("Passed 2\n");
+
+    /* released buffers are reused */
+    assert(umem_alloc(mgr, &umem, 8000));
+    assert(umem_buffer(&umem) == p);
+    umem_free(&umem);
+    printf("Passed 3\n");
+
+    /* the arena is a hard limit; keep a small buffer in the first huge
+     * page so that it cannot be carved for a large buffer */
+    struct umem big[2];
+    assert(!umem_alloc(mgr, &big[0], 33 * 1024 * 1024));
+    assert(umem_alloc(mgr, &umem, 42));
+    assert(umem_alloc(mgr, &big[0], 2 * 1024 * 1024));
+    assert(!((uintptr_t)umem_buffer(&big[0]) % (2 * 1024 * 1024)));
+    uint8_t *q = umem_buffer(&big[0]);
+    memset(q, 0, 2 * 1024 * 1024);
+    assert(!umem_alloc(mgr, &big[1], 2 * 1024 * 1024));
+    umem_free(&big[0]);
+    assert(umem_alloc(mgr, &big[1], 2 * 1024 * 1024));
+    assert(umem_buffer(&big[1]) == q);
+    umem_free(&big[1]);
+    umem_free(&umem);
+    printf("Passed 4\n");
+
+    struct upool_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    assert(!umem_mgr_get_stats(mgr, &stats));
+    assert(stats.hits == 3);
+    assert(stats.misses == 4);
+
+    /* space released by buffers of other sizes is reused */
+    assert(umem_alloc(mgr, &umem, ARENA_SIZE));
+    assert(umem_buffer(&umem) < p);
+    umem_free(&umem);
+    printf("Passed 5\n");
+
+    /* sizes are rounded up to the next quarter of a power of 2 */
+    assert(umem_alloc(mgr, &umem, 5000));
+    assert(umem.real_size == 5120);
+    assert(umem_realloc(&umem, 5120));
+    assert(umem.real_size == 5120);
+    assert(umem_realloc(&umem, 6000));
+    assert(umem.real_size == 6144);
+    umem_free(&umem);
+
+    /* vacuum merges released buffers back into the region */
+    umem_mgr_vacuum(mgr);
+    assert(umem_alloc(mgr, &umem, ARENA_SIZE));
+    umem_free(&umem);
+    printf("Passed 6\n");
+
+    umem_mgr_release(mgr);
+
+    /* NUMA placement, if the system supports it */
+    assert(umem_arena_mgr_alloc_node(ARENA_SIZE, 32, 4, 0, 4096) == NULL);
+    mgr = umem_arena_mgr_alloc_node(ARENA_SIZE, 32, 8, 0, 0);
+    if (mgr != NULL) {
+        assert(umem_alloc(mgr, &umem, 4096));
+        memset(umem_buffer(&umem), 0x42, 4096);
+        umem_free(&umem);
+        umem_mgr_release(mgr);
+    }
+    printf("Passed 7\n");
+    return 0;
+}
@@ -14,11 +14,25 @@
 
 #include "upipe/umem.h"
 #include "upipe/umem_pool.h"
+#include "upipe/upool.h"
 
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+
+#define NB_BUFFERS 64
+
+static struct umem umems[NB_BUFFERS];
+
+/** releases the buffers allocated by the main thread */
+static void *thread_free(void *unused)
+{
+    for (int i = 0; i < NB_BUFFERS; i++)
+        umem_free(&umems[i]);
+    return NULL;
+}
 
 int main(int argc, char **argv)
 {
@@ -70,6 +84,35 @@ int main(int argc, char **argv)
     umem_free(&umem);
     printf("Passed 6\n");
 
+    struct upool_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    assert(!umem_mgr_get_stats(mgr, &stats));
+    /* only the 8 Ki buffer was reused */
+    assert(stats.hits == 1);
+    assert(stats.misses == 3);
+    assert(stats.cross_frees == 0);
+    printf("Passed 7\n");
+
+    for (int i = 0; i < NB_BUFFERS; i++)
+        assert(umem_alloc(mgr, &umems[i], 32));
+    pthread_t thread;
+    assert(!pthread_create(&thread, NULL, thread_free, NULL));
+    assert(!pthread_join(thread, NULL));
+
+    memset(&stats, 0, sizeof(stats));
+    assert(!umem_mgr_get_stats(mgr, &stats));
+    assert(stats.cross_frees == NB_BUFFERS);
+    /* the buffers released by the thread are available to the others */
+    for (int i = 0; i < NB_BUFFERS; i++)
+        assert(umem_alloc(mgr, &umems[i], 32));
+    memset(&stats, 0, sizeof(stats));
+    assert(!umem_mgr_get_stats(mgr, &stats));
+    assert(stats.hits > 1);
+    for (int i = 0; i < NB_BUFFERS; i++)
+        umem_free(&umems[i]);
+    umem_mgr_vacuum(mgr);
+    printf("Passed 8\n");
+
     umem_mgr_release(mgr);
     return 0;
 }
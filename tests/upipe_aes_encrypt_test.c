@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for aes encrypt and decrypt modules
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_flow.h"
+#include "upipe/uref_std.h"
+#include "upipe/upipe.h"
+#include "upipe-modules/upipe_aes_encrypt.h"
+#include "upipe-modules/upipe_aes_decrypt.h"
+#include "upipe-modules/uref_aes_flow.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 10
+#define UREF_POOL_DEPTH 10
+#define UBUF_POOL_DEPTH 10
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+#define LOOPBACK_SIZE 1000
+
+/* NIST SP 800-38A F.2.1 CBC-AES128.Encrypt */
+static const uint8_t key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint8_t iv[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t plaintext[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+    0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+    0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+    0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+/* followed by the encrypted PKCS-7 padding block */
+static const uint8_t ciphertext[80] = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46,
+    0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee,
+    0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+    0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b,
+    0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+    0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09,
+    0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7,
+    0x8c, 0xb8, 0x28, 0x07, 0x23, 0x0e, 0x13, 0x21,
+    0xd3, 0xfa, 0xe0, 0x0d, 0x18, 0xcc, 0x20, 0x12
+};
+
+static uint8_t received[LOOPBACK_SIZE + 16];
+static size_t received_size = 0;
+static bool received_end = false;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr,
+                                struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    assert(uref != NULL);
+    assert(!received_end);
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(received_size + size <= sizeof(received));
+    ubase_assert(uref_block_extract(uref, 0, size,
+                                    received + received_size));
+    received_size += size;
+    received_end = ubase_check(uref_block_get_end(uref));
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr aes_test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** sends a buffer in chunks of the given sizes */
+static void send(struct upipe *upipe, struct uref_mgr *uref_mgr,
+                 struct ubuf_mgr *ubuf_mgr, const uint8_t *buf, size_t size,
+                 const size_t *chunks)
+{
+    size_t offset = 0;
+    for (unsigned i = 0; offset < size; i++) {
+        size_t chunk = chunks[i];
+        if (chunk > size - offset)
+            chunk = size - offset;
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, chunk);
+        assert(uref != NULL);
+        int wsize = -1;
+        uint8_t *wbuf;
+        ubase_assert(uref_block_write(uref, 0, &wsize, &wbuf));
+        assert(wsize == chunk);
+        memcpy(wbuf, buf + offset, chunk);
+        ubase_assert(uref_block_unmap(uref, 0));
+        offset += chunk;
+        if (offset == size)
+            uref_block_set_end(uref);
+        upipe_input(upipe, uref, NULL);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                         UBUF_POOL_DEPTH,
+                                                         umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *uprobe_stdio = uprobe_stdio_alloc(&uprobe, stdout,
+                                                     UPROBE_LOG_LEVEL);
+    assert(uprobe_stdio != NULL);
+
+    struct upipe *upipe_sink = upipe_void_alloc(&aes_test_mgr,
+                                                uprobe_use(uprobe_stdio));
+    assert(upipe_sink != NULL);
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, "foo.");
+    assert(flow_def != NULL);
+    ubase_assert(uref_aes_set_key(flow_def, key, sizeof(key)));
+    ubase_assert(uref_aes_set_iv(flow_def, iv, sizeof(iv)));
+
+    struct upipe_mgr *upipe_aes_encrypt_mgr = upipe_aes_encrypt_mgr_alloc();
+    assert(upipe_aes_encrypt_mgr != NULL);
+    struct upipe_mgr *upipe_aes_decrypt_mgr = upipe_aes_decrypt_mgr_alloc();
+    assert(upipe_aes_decrypt_mgr != NULL);
+
+    /* known answer */
+    struct upipe *upipe_aes_encrypt = upipe_void_alloc(upipe_aes_encrypt_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "aes encrypt"));
+    assert(upipe_aes_encrypt != NULL);
+    ubase_assert(upipe_aes_encrypt_set_padding(upipe_aes_encrypt,
+                UPIPE_AES_ENCRYPT_PADDING_PKCS7));
+    ubase_assert(upipe_set_flow_def(upipe_aes_encrypt, flow_def));
+    ubase_assert(upipe_set_output(upipe_aes_encrypt, upipe_sink));
+
+    struct uref *output_flow_def;
+    ubase_assert(upipe_get_flow_def(upipe_aes_encrypt, &output_flow_def));
+    ubase_assert(uref_flow_match_def(output_flow_def, "block.aes.foo."));
+    ubase_assert(uref_aes_match_method(output_flow_def, "AES-128"));
+
+    static const size_t kat_chunks[] = { 40, 24 };
+    send(upipe_aes_encrypt, uref_mgr, ubuf_mgr, plaintext, sizeof(plaintext),
+         kat_chunks);
+    assert(received_end);
+    assert(received_size == sizeof(ciphertext));
+    assert(!memcmp(received, ciphertext, sizeof(ciphertext)));
+    upipe_release(upipe_aes_encrypt);
+    printf("Passed 1\n");
+
+    /* loopback through the decrypt pipe */
+    upipe_aes_encrypt = upipe_void_alloc(upipe_aes_encrypt_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "aes encrypt"));
+    assert(upipe_aes_encrypt != NULL);
+    ubase_assert(upipe_aes_encrypt_set_padding(upipe_aes_encrypt,
+                UPIPE_AES_ENCRYPT_PADDING_PKCS7));
+    ubase_assert(upipe_set_flow_def(upipe_aes_encrypt, flow_def));
+
+    struct upipe *upipe_aes_decrypt = upipe_void_alloc_output(
+            upipe_aes_encrypt, upipe_aes_decrypt_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "aes decrypt"));
+    assert(upipe_aes_decrypt != NULL);
+    ubase_assert(upipe_aes_decrypt_set_padding(upipe_aes_decrypt,
+                UPIPE_AES_DECRYPT_PADDING_PKCS7));
+    ubase_assert(upipe_set_output(upipe_aes_decrypt, upipe_sink));
+
+    uint8_t loopback[LOOPBACK_SIZE];
+    for (unsigned i = 0; i < LOOPBACK_SIZE; i++)
+        loopback[i] = i * 7 + (i >> 8);
+    received_size = 0;
+    received_end = false;
+    static const size_t loopback_chunks[] = { 1, 15, 16, 200, 7, 500, 300 };
+    send(upipe_aes_encrypt, uref_mgr, ubuf_mgr, loopback, sizeof(loopback),
+         loopback_chunks);
+    assert(received_size == sizeof(loopback));
+    assert(!memcmp(received, loopback, sizeof(loopback)));
+    printf("Passed 2\n");
+
+    upipe_release(upipe_aes_decrypt);
+    upipe_release(upipe_aes_encrypt);
+    uref_free(flow_def);
+
+    /* release everything */
+    upipe_mgr_release(upipe_aes_encrypt_mgr); // nop
+    upipe_mgr_release(upipe_aes_decrypt_mgr); // nop
+
+    test_free(upipe_sink);
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(uprobe_stdio);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
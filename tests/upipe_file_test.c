@@ -48,7 +48,8 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 
 static void usage(const char *argv0) {
-    fprintf(stdout, "Usage: %s [-d <delay>] [-a|-o] <source file> <sink file>\n", argv0);
+    fprintf(stdout, "Usage: %s [-d <delay>] [-m <window>] [-a|-o] <source file> <sink file>\n", argv0);
+    fprintf(stdout, "-m : map the source file by windows of the given size\n");
     fprintf(stdout, "-a : append\n");
     fprintf(stdout, "-o : overwrite\n");
     exit(EXIT_FAILURE);
@@ -75,13 +76,17 @@ int main(int argc, char *argv[])
 {
     const char *src_file, *sink_file;
     int64_t delay = 0;
+    uint64_t mmap_window = 0;
     enum upipe_fsink_mode mode = UPIPE_FSINK_CREATE;
     int opt;
-    while ((opt = getopt(argc, argv, "d:ao")) != -1) {
+    while ((opt = getopt(argc, argv, "d:m:ao")) != -1) {
         switch (opt) {
             case 'd':
                 delay = atoi(optarg);
                 break;
+            case 'm':
+                mmap_window = strtoull(optarg, NULL, 0);
+                break;
             case 'a':
                 mode = UPIPE_FSINK_APPEND;
                 break;
@@ -134,6 +139,8 @@ int main(int argc, char *argv[])
                              UPROBE_LOG_LEVEL, "file source"));
     assert(upipe_fsrc != NULL);
     ubase_assert(upipe_set_output_size(upipe_fsrc, READ_SIZE));
+    if (mmap_window)
+        ubase_assert(upipe_fsrc_set_mmap(upipe_fsrc, mmap_window));
     ubase_assert(upipe_set_uri(upipe_fsrc, src_file));
     uint64_t size;
     if (ubase_check(upipe_src_get_size(upipe_fsrc, &size)))
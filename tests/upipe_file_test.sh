@@ -10,3 +10,5 @@ trap cleanup EXIT
 
 "$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test "$srcdir"/upipe_ts_test.ts "$TMP"/test
 cmp --quiet "$TMP"/test "$srcdir"/upipe_ts_test.ts
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test -m 65536 "$srcdir"/upipe_ts_test.ts "$TMP"/test_mmap
+cmp --quiet "$TMP"/test_mmap "$srcdir"/upipe_ts_test.ts
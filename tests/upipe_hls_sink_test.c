@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for hls sink module
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uclock.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_clock.h"
+#include "upipe/uref_m3u_master.h"
+#include "upipe/uref_std.h"
+#include "upipe/upipe.h"
+#include "upipe-hls/upipe_hls_sink.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#include <bitstream/mpeg/ts.h>
+
+#define UDICT_POOL_DEPTH 10
+#define UREF_POOL_DEPTH 10
+#define UBUF_POOL_DEPTH 10
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+/** TS packets per buffer */
+#define PACKETS 7
+/** duration of a buffer */
+#define BUFFER_DURATION (UCLOCK_FREQ / 10)
+/** buffers between random access points */
+#define GOP 10
+/** total number of buffers */
+#define BUFFERS 65
+
+static char dir[] = "/tmp/upipe_hls_sink_test.XXXXXX";
+static char content[65536];
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** reads a file of the output directory */
+static const char *load(const char *name)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return NULL;
+    size_t size = fread(content, 1, sizeof(content) - 1, file);
+    content[size] = '\0';
+    fclose(file);
+    return content;
+}
+
+/** checks whether a file exists in the output directory */
+static bool exists(const char *name)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    struct stat st;
+    return !stat(path, &st);
+}
+
+/** sends a buffer of TS packets, with a random access point in the middle
+ * if random is true */
+static void send(struct upipe *upipe, struct uref_mgr *uref_mgr,
+                 struct ubuf_mgr *ubuf_mgr, unsigned int i, bool random)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr,
+                                         PACKETS * TS_SIZE);
+    assert(uref != NULL);
+    int size = -1;
+    uint8_t *buffer;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == PACKETS * TS_SIZE);
+    for (unsigned int j = 0; j < PACKETS; j++) {
+        uint8_t *ts = buffer + j * TS_SIZE;
+        memset(ts, 0xff, TS_SIZE);
+        ts_init(ts);
+        ts_set_pid(ts, 0x100);
+        ts_set_payload(ts);
+        ts_set_cc(ts, i * PACKETS + j);
+        ts_set_adaptation(ts, 1);
+        if (random && j == 2)
+            tsaf_set_randomaccess(ts);
+    }
+    uref_block_unmap(uref, 0);
+    uref_clock_set_cr_sys(uref, UCLOCK_FREQ + i * BUFFER_DURATION);
+    upipe_input(upipe, uref, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    assert(mkdtemp(dir) != NULL);
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                         UBUF_POOL_DEPTH,
+                                                         umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *uprobe_stdio = uprobe_stdio_alloc(&uprobe, stdout,
+                                                     UPROBE_LOG_LEVEL);
+    assert(uprobe_stdio != NULL);
+
+    struct upipe_mgr *upipe_hls_sink_mgr = upipe_hls_sink_mgr_alloc();
+    assert(upipe_hls_sink_mgr != NULL);
+    struct upipe *upipe = upipe_void_alloc(upipe_hls_sink_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "hls sink"));
+    assert(upipe != NULL);
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, "mpegts.");
+    assert(flow_def != NULL);
+    ubase_assert(uref_m3u_master_set_codecs(flow_def, "avc1.64001f"));
+    ubase_assert(upipe_set_flow_def(upipe, flow_def));
+    uref_free(flow_def);
+
+    ubase_assert(upipe_hls_sink_set_path(upipe, dir, "test"));
+    ubase_assert(upipe_hls_sink_set_target_duration(upipe, UCLOCK_FREQ));
+    ubase_assert(upipe_hls_sink_set_part_duration(upipe, UCLOCK_FREQ / 2));
+    ubase_assert(upipe_hls_sink_set_window(upipe, 3));
+
+    const char *m3u8;
+    unsigned int i;
+    for (i = 0; i < 16; i++)
+        send(upipe, uref_mgr, ubuf_mgr, i, !(i % GOP));
+
+    /* segment 0 is complete, segment 1 has one part */
+    m3u8 = load("test.m3u8");
+    assert(m3u8 != NULL);
+    printf("%s", m3u8);
+    assert(strstr(m3u8, "#EXT-X-PART-INF:PART-TARGET=0.500\n"));
+    assert(strstr(m3u8, "#EXT-X-MEDIA-SEQUENCE:0\n"));
+    assert(strstr(m3u8, "#EXTINF:1.000,\ntest-0.ts\n"));
+    assert(strstr(m3u8, "#EXT-X-PART:DURATION=0.500,URI=\"test-1.ts\","
+                        "BYTERANGE=6580@0,INDEPENDENT=YES\n"));
+    assert(strstr(m3u8, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"test-1.ts\","
+                        "BYTERANGE-START=6580\n"));
+    assert(!strstr(m3u8, "#EXT-X-ENDLIST"));
+    assert(!exists("test.m3u8.tmp"));
+
+    const char *master = load("master.m3u8");
+    assert(master != NULL);
+    printf("%s", master);
+    assert(strstr(master, "#EXT-X-STREAM-INF:BANDWIDTH=105280,"
+                          "CODECS=\"avc1.64001f\"\ntest.m3u8\n"));
+    printf("Passed 1\n");
+
+    for ( ; i < BUFFERS; i++)
+        send(upipe, uref_mgr, ubuf_mgr, i, !(i % GOP));
+    upipe_release(upipe);
+
+    m3u8 = load("test.m3u8");
+    assert(m3u8 != NULL);
+    printf("%s", m3u8);
+    assert(strstr(m3u8, "#EXT-X-TARGETDURATION:1\n"));
+    assert(strstr(m3u8, "#EXT-X-MEDIA-SEQUENCE:4\n"));
+    assert(!strstr(m3u8, "test-3.ts"));
+    assert(strstr(m3u8, "#EXT-X-PART:DURATION=0.500,URI=\"test-4.ts\","
+                        "BYTERANGE=6580@6580\n"));
+    assert(strstr(m3u8, "#EXTINF:1.000,\ntest-5.ts\n"));
+    assert(strstr(m3u8, "#EXTINF:0.400,\ntest-6.ts\n"));
+    assert(strstr(m3u8, "#EXT-X-ENDLIST\n"));
+    assert(!strstr(m3u8, "#EXT-X-PRELOAD-HINT"));
+
+    /* one segment out of the window is kept on disk */
+    assert(!exists("test-2.ts"));
+    assert(exists("test-3.ts"));
+    for (i = 3; i <= 6; i++) {
+        struct stat st;
+        char path[256];
+        snprintf(path, sizeof(path), "%s/test-%u.ts", dir, i);
+        assert(!stat(path, &st));
+        assert(st.st_size == (i < 6 ? GOP : BUFFERS % GOP) *
+                             PACKETS * TS_SIZE);
+        unlink(path);
+    }
+    printf("Passed 2\n");
+
+    /* the input is dropped until the first random access point, and a
+     * segment without random access point is cut after the target */
+    upipe = upipe_void_alloc(upipe_hls_sink_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "hls sink overrun"));
+    assert(upipe != NULL);
+    flow_def = uref_block_flow_alloc_def(uref_mgr, "mpegts.");
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(upipe, flow_def));
+    uref_free(flow_def);
+    ubase_assert(upipe_hls_sink_set_path(upipe, dir, "overrun"));
+    ubase_assert(upipe_hls_sink_set_master(upipe, NULL));
+    ubase_assert(upipe_hls_sink_set_target_duration(upipe, UCLOCK_FREQ));
+
+    for (i = 0; i < 5; i++)
+        send(upipe, uref_mgr, ubuf_mgr, i, false);
+    assert(!exists("overrun.m3u8"));
+    for ( ; i < 5 + 2 * 13; i++)
+        send(upipe, uref_mgr, ubuf_mgr, i, i == 5);
+    upipe_release(upipe);
+
+    m3u8 = load("overrun.m3u8");
+    assert(m3u8 != NULL);
+    printf("%s", m3u8);
+    assert(strstr(m3u8, "#EXT-X-TARGETDURATION:1\n"));
+    assert(strstr(m3u8, "#EXTINF:1.300,\noverrun-0.ts\n"));
+    assert(strstr(m3u8, "#EXTINF:1.200,\noverrun-1.ts\n"));
+    assert(!exists("overrun-2.ts"));
+    for (i = 0; i <= 1; i++) {
+        struct stat st;
+        char path[256];
+        snprintf(path, sizeof(path), "%s/overrun-%u.ts", dir, i);
+        assert(!stat(path, &st));
+        assert(st.st_size == 13 * PACKETS * TS_SIZE);
+        unlink(path);
+    }
+    printf("Passed 3\n");
+
+    /* a path change mid-stream ends the playlist and starts a new one */
+    upipe = upipe_void_alloc(upipe_hls_sink_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "hls sink path"));
+    assert(upipe != NULL);
+    flow_def = uref_block_flow_alloc_def(uref_mgr, "mpegts.");
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(upipe, flow_def));
+    uref_free(flow_def);
+    ubase_assert(upipe_hls_sink_set_path(upipe, dir, "first"));
+    ubase_assert(upipe_hls_sink_set_master(upipe, NULL));
+    ubase_assert(upipe_hls_sink_set_target_duration(upipe, 2 * UCLOCK_FREQ));
+    ubase_assert(upipe_hls_sink_set_window(upipe, 1));
+
+    for (i = 0; i < 4 * GOP + 5; i++)
+        send(upipe, uref_mgr, ubuf_mgr, i, !(i % GOP));
+    ubase_assert(upipe_hls_sink_set_path(upipe, dir, "second"));
+
+    m3u8 = load("first.m3u8");
+    assert(m3u8 != NULL);
+    printf("%s", m3u8);
+    assert(strstr(m3u8, "#EXT-X-TARGETDURATION:2\n"));
+    assert(strstr(m3u8, "#EXT-X-MEDIA-SEQUENCE:2\n"));
+    assert(strstr(m3u8, "#EXTINF:0.400,\nfirst-2.ts\n"));
+    assert(strstr(m3u8, "#EXT-X-ENDLIST\n"));
+    assert(!exists("first-0.ts"));
+
+    /* the new playlist waits for a random access point, and advertises
+     * its own target duration */
+    ubase_assert(upipe_hls_sink_set_target_duration(upipe, UCLOCK_FREQ));
+    for ( ; i < 8 * GOP; i++)
+        send(upipe, uref_mgr, ubuf_mgr, i, !(i % GOP));
+    upipe_release(upipe);
+
+    m3u8 = load("second.m3u8");
+    assert(m3u8 != NULL);
+    printf("%s", m3u8);
+    assert(strstr(m3u8, "#EXT-X-TARGETDURATION:1\n"));
+    assert(strstr(m3u8, "#EXT-X-MEDIA-SEQUENCE:2\n"));
+    assert(strstr(m3u8, "#EXTINF:0.900,\nsecond-2.ts\n"));
+    assert(!strstr(m3u8, "first-"));
+
+    /* the segments of the first playlist were not expired by the second */
+    assert(exists("first-1.ts"));
+    assert(exists("first-2.ts"));
+    assert(!exists("second-0.ts"));
+    assert(exists("second-1.ts"));
+    assert(exists("second-2.ts"));
+    assert(!exists("second-3.ts"));
+    printf("Passed 4\n");
+
+    char path[256];
+    for (i = 1; i <= 2; i++) {
+        snprintf(path, sizeof(path), "%s/first-%u.ts", dir, i);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/second-%u.ts", dir, i);
+        unlink(path);
+    }
+    snprintf(path, sizeof(path), "%s/first.m3u8", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/second.m3u8", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/test.m3u8", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/overrun.m3u8", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/master.m3u8", dir);
+    unlink(path);
+    assert(!rmdir(dir));
+
+    /* release everything */
+    upipe_mgr_release(upipe_hls_sink_mgr); // nop
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(uprobe_stdio);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for chained input of urefs
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ulist.h"
+#include "upipe/uref.h"
+#include "upipe/uref_std.h"
+#include "upipe/upipe.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define NB_UREFS 7
+
+static struct uref *urefs[NB_UREFS];
+static int counter = 0;
+static int chain_counter = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    assert(counter < NB_UREFS);
+    assert(uref == urefs[counter]);
+    counter++;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static void test_input_chain(struct upipe *upipe, struct uchain *list,
+                             struct upump **upump_p)
+{
+    chain_counter++;
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(list)) != NULL)
+        test_input(upipe, uref_from_uchain(uchain), upump_p);
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe without chained input */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = NULL
+};
+
+/** helper phony pipe with chained input */
+static struct upipe_mgr test_chain_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = NULL,
+    .upipe_input_chain = test_input_chain
+};
+
+/** fills a list of urefs */
+static void fill_chain(struct uref_mgr *uref_mgr, struct uchain *list)
+{
+    for (int i = 0; i < NB_UREFS; i++) {
+        urefs[i] = uref_alloc(uref_mgr);
+        assert(urefs[i] != NULL);
+        ulist_add(list, uref_to_uchain(urefs[i]));
+    }
+    counter = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+
+    struct uchain list;
+    ulist_init(&list);
+
+    /* fallback to upipe_input */
+    struct upipe *upipe = upipe_void_alloc(&test_mgr, uprobe_use(logger));
+    assert(upipe != NULL);
+    fill_chain(uref_mgr, &list);
+    upipe_input_chain(upipe, &list, NULL);
+    assert(ulist_empty(&list));
+    assert(counter == NB_UREFS);
+    assert(chain_counter == 0);
+    upipe_input_chain(upipe, &list, NULL);
+    assert(counter == NB_UREFS);
+    test_free(upipe);
+
+    /* chained input */
+    upipe = upipe_void_alloc(&test_chain_mgr, uprobe_use(logger));
+    assert(upipe != NULL);
+    fill_chain(uref_mgr, &list);
+    upipe_input_chain(upipe, &list, NULL);
+    assert(ulist_empty(&list));
+    assert(counter == NB_UREFS);
+    assert(chain_counter == 1);
+
+    /* an empty list is not delivered */
+    upipe_input_chain(upipe, &list, NULL);
+    assert(chain_counter == 1);
+    test_free(upipe);
+
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    return 0;
+}
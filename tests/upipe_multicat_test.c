@@ -65,6 +65,7 @@ static struct upump *idler;
 static uint64_t rotate = 0;
 static uint64_t rotate_offset = 0;
 static uint64_t gen_systime = 0;
+static uint64_t mmap_window = 0;
 
 static void sig_handler(int sig)
 {
@@ -73,7 +74,7 @@ static void sig_handler(int sig)
 }
 
 static void usage(const char *argv0) {
-    fprintf(stdout, "Usage: %s [-r <rotate> [-O <rotate offset>]] <dest dir> <suffix>\n", argv0);
+    fprintf(stdout, "Usage: %s [-r <rotate> [-O <rotate offset>]] [-m <window>] <dest dir> <suffix>\n", argv0);
     exit(EXIT_FAILURE);
 }
 
@@ -135,7 +136,9 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     upipe_dbg(upipe, "===> received input uref");
     uref_dump(uref, upipe->uprobe);
 
-    static uint64_t systime = 0;
+    static uint64_t systime = UINT64_MAX;
+    if (systime == UINT64_MAX)
+        systime = rotate_offset;
     uint64_t cr_sys;
     ubase_assert(uref_clock_get_cr_sys(uref, &cr_sys));
     assert(cr_sys == systime);
@@ -195,7 +198,7 @@ int main(int argc, char *argv[])
 
     signal (SIGINT, sig_handler);
 
-    while ((opt = getopt(argc, argv, "r:O:")) != -1) {
+    while ((opt = getopt(argc, argv, "r:O:m:")) != -1) {
         switch (opt) {
             case 'r':
                 rotate = strtoull(optarg, NULL, 0);
@@ -203,6 +206,9 @@ int main(int argc, char *argv[])
             case 'O':
                 gen_systime = rotate_offset = strtoull(optarg, NULL, 0);
                 break;
+            case 'm':
+                mmap_window = strtoull(optarg, NULL, 0);
+                break;
             default:
                 usage(argv[0]);
         }
@@ -321,13 +327,15 @@ int main(int argc, char *argv[])
     ubase_assert(upipe_set_flow_def(msrc, flow));
     uref_free(flow);
     ubase_assert(upipe_set_output_size(msrc, sizeof(uint64_t)));
+    if (mmap_window)
+        ubase_assert(upipe_msrc_set_mmap(msrc, mmap_window));
 
     struct upipe *test = upipe_void_alloc(&test_mgr, uprobe_use(logger));
     assert(test != NULL);
     ubase_assert(upipe_set_output(msrc, test));
 
     // fire !
-    ubase_assert(upipe_src_set_position(msrc, 0));
+    ubase_assert(upipe_src_set_position(msrc, rotate_offset));
     upump_mgr_run(upump_mgr, NULL);
 
     // release everything
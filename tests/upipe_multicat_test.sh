@@ -9,3 +9,4 @@ cleanup() { rm -rf "$TMP"; }
 trap cleanup EXIT
 
 "$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_multicat_test -r 270000000 -O 135000000 "$TMP"/ .bar
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_multicat_test -r 270000000 -O 135000000 -m 4096 "$TMP"/ .bar
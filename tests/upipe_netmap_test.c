@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short unit tests for netmap source and sink pipes
+ *
+ * The sink and the source are connected through two ports of a VALE
+ * switch, so no network interface is required, but the netmap kernel module
+ * must be loaded. The test is skipped otherwise.
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uprobe_uref_mgr.h"
+#include "upipe/uprobe_upump_mgr.h"
+#include "upipe/uprobe_uclock.h"
+#include "upipe/uprobe_ubuf_mem.h"
+#include "upipe/uclock.h"
+#include "upipe/uclock_std.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_std.h"
+#include "upipe/upump.h"
+#include "upump-ev/upump_ev.h"
+#include "upipe/upipe.h"
+#include "upipe/upipe_helper_upipe.h"
+#include "upipe-netmap/upipe_netmap_source.h"
+#include "upipe-netmap/upipe_netmap_sink.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <net/if.h>
+
+#define NETMAP_WITH_LIBS
+#include <net/netmap.h>
+#include <net/netmap_user.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define BUF_SIZE 1316
+#define NB_PACKETS 100
+#define FORMAT "This is packet number %d"
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct upipe *upipe_netmap_source;
+static struct upipe *upipe_netmap_sink;
+static int counter = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+struct netmap_test {
+    int counter;
+    struct uref *urefs[NB_PACKETS];
+    struct uref *copies[NB_PACKETS];
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+UPIPE_HELPER_UPIPE(netmap_test, upipe, 0);
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct netmap_test *netmap_test = malloc(sizeof(struct netmap_test));
+    assert(netmap_test != NULL);
+    netmap_test->counter = 0;
+    upipe_init(&netmap_test->upipe, mgr, uprobe);
+    upipe_throw_ready(&netmap_test->upipe);
+    return &netmap_test->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct netmap_test *netmap_test = netmap_test_from_upipe(upipe);
+    assert(netmap_test->counter < NB_PACKETS);
+
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size == BUF_SIZE);
+
+    /* copy the packet through the manager of the netmap ubuf, as a pipe
+     * writing to a shared buffer would do */
+    struct uref *copy = uref_dup(uref);
+    assert(copy != NULL);
+    struct ubuf *ubuf = ubuf_block_copy(uref->ubuf->mgr, uref->ubuf, 0, size);
+    assert(ubuf != NULL);
+    uref_attach_ubuf(copy, ubuf);
+    netmap_test->copies[netmap_test->counter] = copy;
+
+    /* keep all packets, so that received buffers are held */
+    netmap_test->urefs[netmap_test->counter++] = uref;
+    if (netmap_test->counter == NB_PACKETS)
+        ubase_assert(upipe_set_uri(upipe_netmap_source, NULL));
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    struct netmap_test *netmap_test = netmap_test_from_upipe(upipe);
+    assert(netmap_test->counter == NB_PACKETS);
+
+    for (int i = 0; i < NB_PACKETS; i++) {
+        uint8_t buf[BUF_SIZE], str[BUF_SIZE];
+        const uint8_t *rbuf = uref_block_peek(netmap_test->urefs[i], 0,
+                                              BUF_SIZE, buf);
+        assert(rbuf != NULL);
+        memset(str, 0, sizeof(str));
+        snprintf((char *)str, sizeof(str), FORMAT, i);
+        assert(!memcmp(str, rbuf, BUF_SIZE));
+        uref_block_peek_unmap(netmap_test->urefs[i], 0, buf, rbuf);
+        uref_free(netmap_test->urefs[i]);
+
+        uint8_t *wbuf;
+        int size = -1;
+        ubase_assert(uref_block_write(netmap_test->copies[i], 0, &size,
+                                      &wbuf));
+        assert(size == BUF_SIZE);
+        assert(!memcmp(str, wbuf, BUF_SIZE));
+        uref_block_unmap(netmap_test->copies[i], 0);
+        uref_free(netmap_test->copies[i]);
+    }
+
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(netmap_test);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr netmap_test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/* packet generator */
+static void genpackets(struct upump *upump)
+{
+    for (int i = 0; i < 10 && counter < NB_PACKETS; i++) {
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, BUF_SIZE);
+        assert(uref != NULL);
+        uint8_t *buf;
+        int size = -1;
+        ubase_assert(uref_block_write(uref, 0, &size, &buf));
+        assert(size == BUF_SIZE);
+        memset(buf, 0, size);
+        snprintf((char *)buf, BUF_SIZE, FORMAT, counter);
+        uref_block_unmap(uref, 0);
+        counter++;
+        upipe_input(upipe_netmap_sink, uref, NULL);
+    }
+    if (counter == NB_PACKETS)
+        upump_stop(upump);
+}
+
+int main(int argc, char *argv[])
+{
+    struct nm_desc *d = nm_open("vale0:upipe_probe", NULL, 0, NULL);
+    if (d == NULL) {
+        printf("netmap is not available, skipping\n");
+        return 0;
+    }
+    nm_close(d);
+
+    /* env */
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    struct uclock *uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    struct upipe *netmap_test = upipe_void_alloc(&netmap_test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "netmap_test"));
+    assert(netmap_test != NULL);
+
+    struct upipe_mgr *upipe_netmap_source_mgr = upipe_netmap_source_mgr_alloc();
+    assert(upipe_netmap_source_mgr != NULL);
+    upipe_netmap_source = upipe_void_alloc(upipe_netmap_source_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "netmap source"));
+    assert(upipe_netmap_source != NULL);
+    ubase_assert(upipe_set_output(upipe_netmap_source, netmap_test));
+    ubase_assert(upipe_attach_uclock(upipe_netmap_source));
+    ubase_assert(upipe_set_uri(upipe_netmap_source, "vale0:upipe_rx-0/R"));
+
+    struct upipe_mgr *upipe_netmap_sink_mgr = upipe_netmap_sink_mgr_alloc();
+    assert(upipe_netmap_sink_mgr != NULL);
+    upipe_netmap_sink = upipe_void_alloc(upipe_netmap_sink_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "netmap sink"));
+    assert(upipe_netmap_sink != NULL);
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_netmap_sink, flow_def));
+    uref_free(flow_def);
+    ubase_assert(upipe_netmap_sink_set_udp(upipe_netmap_sink,
+                                           "10.0.0.1:1000", "239.0.0.1:5000",
+                                           NULL, NULL));
+    ubase_assert(upipe_set_uri(upipe_netmap_sink, "vale0:upipe_tx"));
+
+    struct upump *write_pump = upump_alloc_idler(upump_mgr, genpackets,
+                                                 NULL, NULL);
+    assert(write_pump != NULL);
+    upump_start(write_pump);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(counter == NB_PACKETS);
+    assert(netmap_test_from_upipe(netmap_test)->counter == NB_PACKETS);
+
+    /* release */
+    upump_free(write_pump);
+    upipe_release(upipe_netmap_sink);
+    upipe_release(upipe_netmap_source);
+    test_free(netmap_test);
+    upipe_mgr_release(upipe_netmap_source_mgr); /* nop */
+    upipe_mgr_release(upipe_netmap_sink_mgr); /* nop */
+    upump_mgr_release(upump_mgr);
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for the placement of pthread transfer threads
+ */
+
+#undef NDEBUG
+
+#define _GNU_SOURCE
+
+#include "upipe/ubase.h"
+#include "upipe/ulog.h"
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/upipe.h"
+#include "upipe/upump.h"
+#include "upipe-pthread/upipe_pthread_transfer.h"
+#include "upipe-pthread/uprobe_pthread_upump_mgr.h"
+#include "upump-ev/upump_ev.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sched.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+#define XFER_QUEUE 255
+#define XFER_POOL 1
+
+/** number of placement notices */
+static unsigned int placed = 0;
+/** CPU the last placed thread was running on */
+static int placed_cpu = -1;
+/** upump manager of the main thread */
+static struct upump_mgr *upump_mgr;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    if (event == UPROBE_LOG) {
+        va_list args_copy;
+        va_copy(args_copy, args);
+        struct ulog *ulog = va_arg(args_copy, struct ulog *);
+        va_end(args_copy);
+        if (ulog->level == UPROBE_LOG_NOTICE &&
+            strstr(ulog->format, "placed") != NULL) {
+            placed++;
+            placed_cpu = sched_getcpu();
+        }
+    }
+    return uprobe_throw_next(uprobe, upipe, event, args);
+}
+
+/** @This runs a transfer thread until its manager is released.
+ *
+ * @param uprobe_main probe providing the upump manager
+ * @param cpus list of CPUs or NULL
+ * @param numa_node NUMA node or -1
+ */
+static void run(struct uprobe *uprobe_main, const char *cpus, int numa_node)
+{
+    struct upipe_mgr *xfer_mgr =
+        upipe_pthread_xfer_mgr_alloc_placed(XFER_QUEUE, XFER_POOL,
+                uprobe_use(uprobe_main), upump_ev_mgr_alloc_loop,
+                UPUMP_POOL, UPUMP_BLOCKER_POOL, NULL, NULL, NULL,
+                INT_MAX, "worker", cpus, numa_node, 0);
+    assert(xfer_mgr != NULL);
+    upipe_mgr_release(xfer_mgr);
+
+    upump_mgr_run(upump_mgr, NULL);
+}
+
+int main(int argc, char **argv)
+{
+    upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+
+    struct uprobe *logger = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, logger);
+    struct uprobe *uprobe_main = uprobe_pthread_upump_mgr_alloc(
+            uprobe_use(&uprobe));
+    assert(uprobe_main != NULL);
+    ubase_assert(uprobe_pthread_upump_mgr_set(uprobe_main, upump_mgr));
+
+    /* explicit list of CPUs */
+    run(uprobe_main, "0", -1);
+    assert(placed == 1);
+    assert(placed_cpu == 0);
+
+    /* CPUs and memory of a node */
+    run(uprobe_main, NULL, 0);
+    assert(placed == 2);
+
+    uprobe_release(uprobe_main);
+    uprobe_clean(&uprobe);
+    upump_mgr_release(upump_mgr);
+    return 0;
+}
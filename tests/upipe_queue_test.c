@@ -21,6 +21,7 @@
 #include "upipe/umem_alloc.h"
 #include "upipe/udict.h"
 #include "upipe/udict_inline.h"
+#include "upipe/ulist.h"
 #include "upipe/uref.h"
 #include "upipe/uref_std.h"
 #include "upipe/uref_block_flow.h"
@@ -49,6 +50,20 @@ static struct uref_mgr *uref_mgr;
 static struct urequest request;
 static bool request_was_unregistered = false;
 
+/** sends a chain of urefs to the queue sink */
+static void send_chain(unsigned int nb)
+{
+    struct uchain urefs;
+    ulist_init(&urefs);
+    for (unsigned int i = 0; i < nb; i++) {
+        struct uref *uref = uref_alloc(uref_mgr);
+        assert(uref != NULL);
+        ulist_add(&urefs, uref_to_uchain(uref));
+    }
+    upipe_input_chain(upipe_qsink, &urefs, NULL);
+    assert(ulist_empty(&urefs));
+}
+
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
                  int event, va_list args)
@@ -229,6 +244,50 @@ int main(int argc, char *argv[])
                              "queue sink"),
             upipe_qsrc);
     assert(upipe_qsink != NULL);
+    /* a chain is pushed to the queue at once */
+    send_chain(4);
+    ubase_assert(upipe_qsrc_get_length(upipe_qsrc, &length));
+    assert(length == 4);
+    upipe_release(upipe_qsrc);
+    upipe_release(upipe_qsink);
+
+    /* single-producer queues accept a single sink at a time */
+    upipe_qsrc = upipe_qsrc_alloc_spsc(upipe_qsrc_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "spsc queue source"), 1000, 100);
+    assert(upipe_qsrc != NULL);
+    ubase_assert(upipe_qsrc_get_max_length(upipe_qsrc, &length));
+    assert(length == 1000);
+
+    upipe_qsink = upipe_qsink_alloc(upipe_qsink_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "spsc queue sink"),
+            upipe_qsrc);
+    assert(upipe_qsink != NULL);
+    struct upipe *upipe_qsink2 = upipe_qsink_alloc(upipe_qsink_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "spsc queue sink 2"),
+            upipe_qsrc);
+    assert(upipe_qsink2 == NULL);
+
+    for (int i = 0; i < 300; i++) {
+        uref = uref_alloc(uref_mgr);
+        assert(uref != NULL);
+        upipe_input(upipe_qsink, uref, NULL);
+    }
+    ubase_assert(upipe_qsrc_get_length(upipe_qsrc, &length));
+    assert(length == 300);
+    /* chains longer than a batch are pushed in several batches */
+    send_chain(200);
+    ubase_assert(upipe_qsrc_get_length(upipe_qsrc, &length));
+    assert(length == 500);
+    upipe_release(upipe_qsink);
+
+    upipe_qsink = upipe_qsink_alloc(upipe_qsink_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "spsc queue sink 3"),
+            upipe_qsrc);
+    assert(upipe_qsink != NULL);
     upipe_release(upipe_qsrc);
     upipe_release(upipe_qsink);
 
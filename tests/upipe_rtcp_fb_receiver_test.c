@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short unit tests for the rtcpfb module, retransmitting RTP packets
+ * requested by RTCP feedback
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uprobe_uref_mgr.h"
+#include "upipe/uprobe_ubuf_mem.h"
+#include "upipe/uprobe_uclock.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/uclock.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_clock.h"
+#include "upipe/uref_std.h"
+#include "upipe/upipe.h"
+#include "upipe-filters/upipe_rtcp_fb_receiver.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <bitstream/ietf/rtp.h>
+#include <bitstream/ietf/rtcp.h>
+#include <bitstream/ietf/rtcp_fb.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define PAYLOAD_SIZE 100
+#define PACKET_SIZE (RTP_HEADER_SIZE + PAYLOAD_SIZE)
+#define FIRST_SEQNUM 65530
+#define PACKETS 16
+#define MAX_RECEIVED 64
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static uint64_t now = UCLOCK_FREQ;
+
+/** sequence numbers received by the sink */
+static uint16_t received[MAX_RECEIVED];
+/** true if the received packet was flagged as retransmitted */
+static bool retransmitted[MAX_RECEIVED];
+static unsigned int nb_received = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_NEED_UPUMP_MGR:
+        case UPROBE_SOURCE_END:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper uclock */
+static uint64_t test_now(struct uclock *unused)
+{
+    return now;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    const uint8_t *buf;
+    int size = -1;
+    ubase_assert(uref_block_read(uref, 0, &size, &buf));
+    assert(size == PACKET_SIZE);
+    assert(nb_received < MAX_RECEIVED);
+    uint8_t ssrc[4];
+    rtp_get_ssrc(buf, ssrc);
+    received[nb_received] = rtp_get_seqnum(buf);
+    retransmitted[nb_received] = ssrc[3] & 1;
+    upipe_dbg_va(upipe, "received %hu%s", received[nb_received],
+                 retransmitted[nb_received] ? " (retransmitted)" : "");
+    nb_received++;
+    uref_block_unmap(uref, 0);
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** sends a RTP packet */
+static void send_packet(struct upipe *upipe, uint16_t seqnum)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, PACKET_SIZE);
+    assert(uref != NULL);
+    uint8_t *buf;
+    int size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buf));
+    memset(buf, 0, size);
+    rtp_set_hdr(buf);
+    rtp_set_seqnum(buf, seqnum);
+    uref_block_unmap(uref, 0);
+    uref_clock_set_cr_sys(uref, now);
+    upipe_input(upipe, uref, NULL);
+}
+
+/** sends a RTCP packet */
+static void send_rtcp(struct upipe *upipe, const uint8_t *rtcp, int size)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, size);
+    assert(uref != NULL);
+    uint8_t *buf;
+    ubase_assert(uref_block_write(uref, 0, &size, &buf));
+    memcpy(buf, rtcp, size);
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe, uref, NULL);
+}
+
+/** sends a generic NACK with the given FCIs */
+static void send_nack(struct upipe *upipe, const uint16_t *ids,
+                      const uint16_t *masks, unsigned int nb)
+{
+    uint8_t buf[RTCP_FB_HEADER_SIZE + 4 * RTCP_FB_FCI_GENERIC_NACK_SIZE];
+    int size = RTCP_FB_HEADER_SIZE + nb * RTCP_FB_FCI_GENERIC_NACK_SIZE;
+    assert(size <= sizeof(buf));
+    memset(buf, 0, size);
+    rtcp_set_rtp_version(buf);
+    rtcp_fb_set_fmt(buf, RTCP_PT_RTPFB_GENERIC_NACK);
+    rtcp_set_pt(buf, RTCP_PT_RTPFB);
+    rtcp_set_length(buf, size / 4 - 1);
+    for (unsigned int i = 0; i < nb; i++) {
+        uint8_t *fci = &buf[RTCP_FB_HEADER_SIZE +
+                            i * RTCP_FB_FCI_GENERIC_NACK_SIZE];
+        rtcp_fb_nack_set_packet_id(fci, ids[i]);
+        rtcp_fb_nack_set_bitmask_lost(fci, masks[i]);
+    }
+    send_rtcp(upipe, buf, size);
+}
+
+/** sends a RIST range NACK */
+static void send_range(struct upipe *upipe, uint16_t start, uint16_t pkts)
+{
+    uint8_t buf[16];
+    memset(buf, 0, sizeof(buf));
+    rtcp_set_rtp_version(buf);
+    rtcp_set_pt(buf, RTCP_PT_APP);
+    rtcp_set_length(buf, sizeof(buf) / 4 - 1);
+    memcpy(&buf[8], "RIST", 4);
+    buf[12] = start >> 8;
+    buf[13] = start;
+    buf[14] = pkts >> 8;
+    buf[15] = pkts;
+    send_rtcp(upipe, buf, sizeof(buf));
+}
+
+/** checks that the sink received the given retransmissions */
+static void check_retransmitted(unsigned int from, const uint16_t *seqnums,
+                                unsigned int nb)
+{
+    assert(nb_received == from + nb);
+    for (unsigned int i = 0; i < nb; i++) {
+        assert(received[from + i] == seqnums[i]);
+        assert(retransmitted[from + i]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+
+    struct uclock uclock;
+    uclock.refcount = NULL;
+    uclock.uclock_now = test_now;
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, &uclock);
+    assert(logger != NULL);
+
+    struct upipe_mgr *upipe_rtcpfb_mgr = upipe_rtcpfb_mgr_alloc();
+    assert(upipe_rtcpfb_mgr != NULL);
+    struct upipe *rtcpfb = upipe_void_alloc(upipe_rtcpfb_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "rtcpfb"));
+    assert(rtcpfb != NULL);
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(rtcpfb, flow_def));
+
+    struct upipe *rtcp = upipe_void_alloc_sub(rtcpfb,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "rtcp"));
+    assert(rtcp != NULL);
+    ubase_assert(upipe_set_flow_def(rtcp, flow_def));
+    uref_free(flow_def);
+
+    struct upipe *sink = upipe_void_alloc(&test_mgr, uprobe_use(logger));
+    assert(sink != NULL);
+    ubase_assert(upipe_set_output(rtcpfb, sink));
+
+    /* packets are output immediately, across the seqnum wraparound */
+    for (unsigned int i = 0; i < PACKETS; i++)
+        send_packet(rtcpfb, FIRST_SEQNUM + i);
+    assert(nb_received == PACKETS);
+    for (unsigned int i = 0; i < PACKETS; i++) {
+        assert(received[i] == (uint16_t)(FIRST_SEQNUM + i));
+        assert(!retransmitted[i]);
+    }
+
+    size_t buffered, buffered_bytes;
+    uint64_t retrans, retrans_bytes;
+    ubase_assert(upipe_rtcpfb_get_buffer_stats(rtcpfb, &buffered,
+                                               &buffered_bytes,
+                                               &retrans_bytes));
+    assert(buffered == PACKETS);
+    assert(buffered_bytes == PACKETS * PACKET_SIZE);
+    assert(retrans_bytes == 0);
+
+    /* FCI bitmask across the wraparound: 65534, 65535 and 1 */
+    unsigned int from = nb_received;
+    {
+        static const uint16_t ids[] = { 65534 };
+        static const uint16_t masks[] = { 0x0005 };
+        static const uint16_t expected[] = { 65534, 65535, 1 };
+        send_nack(rtcp, ids, masks, 1);
+        check_retransmitted(from, expected, 3);
+    }
+
+    /* several FCIs in one packet, and unknown seqnums are ignored */
+    from = nb_received;
+    {
+        static const uint16_t ids[] = { 2, 9, 100 };
+        static const uint16_t masks[] = { 0x8000, 0x0000, 0x0001 };
+        static const uint16_t expected[] = { 2, 9 };
+        send_nack(rtcp, ids, masks, 3);
+        check_retransmitted(from, expected, 2);
+    }
+
+    /* RIST range */
+    from = nb_received;
+    {
+        static const uint16_t expected[] = { 65535, 0, 1 };
+        send_range(rtcp, 65535, 3);
+        check_retransmitted(from, expected, 3);
+    }
+
+    ubase_assert(upipe_rtcpfb_get_stats(rtcpfb, &retrans));
+    assert(retrans == 8);
+    ubase_assert(upipe_rtcpfb_get_stats(rtcpfb, &retrans));
+    assert(retrans == 0);
+    ubase_assert(upipe_rtcpfb_get_buffer_stats(rtcpfb, &buffered,
+                                               &buffered_bytes,
+                                               &retrans_bytes));
+    assert(buffered == PACKETS);
+    assert(retrans_bytes == 8 * PACKET_SIZE);
+    ubase_assert(upipe_rtcpfb_get_buffer_stats(rtcpfb, &buffered,
+                                               &buffered_bytes,
+                                               &retrans_bytes));
+    assert(retrans_bytes == 0);
+
+    /* a duplicate replaces the buffered packet */
+    send_packet(rtcpfb, (uint16_t)(FIRST_SEQNUM + PACKETS));
+    send_packet(rtcpfb, (uint16_t)(FIRST_SEQNUM + PACKETS));
+    ubase_assert(upipe_rtcpfb_get_buffer_stats(rtcpfb, &buffered,
+                                               &buffered_bytes,
+                                               &retrans_bytes));
+    assert(buffered == PACKETS + 1);
+    assert(buffered_bytes == (PACKETS + 1) * PACKET_SIZE);
+
+    /* a sequence going back restarts the buffer */
+    send_packet(rtcpfb, 3);
+    ubase_assert(upipe_rtcpfb_get_buffer_stats(rtcpfb, &buffered,
+                                               &buffered_bytes,
+                                               &retrans_bytes));
+    assert(buffered == 1);
+    assert(buffered_bytes == PACKET_SIZE);
+    from = nb_received;
+    {
+        static const uint16_t ids[] = { 2 };
+        static const uint16_t masks[] = { 0x0001 };
+        static const uint16_t expected[] = { 3 };
+        send_nack(rtcp, ids, masks, 1);
+        check_retransmitted(from, expected, 1);
+    }
+
+    upipe_release(rtcp);
+    upipe_release(rtcpfb);
+    test_free(sink);
+
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for RTP FEC generator module
+ *
+ * The generated streams are fed back to the RTP FEC decoder through a lossy
+ * link, and every media packet must be recovered.
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uprobe_upump_mgr.h"
+#include "upipe/uprobe_uclock.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/uclock.h"
+#include "upipe/uclock_std.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_clock.h"
+#include "upipe/uref_flow.h"
+#include "upipe/uref_std.h"
+#include "upipe/upump.h"
+#include "upipe/upipe.h"
+#include "upump-ev/upump_ev.h"
+#include "upipe-ts/upipe_rtp_fec.h"
+#include "upipe-ts/upipe_rtp_fec_enc.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <bitstream/mpeg/ts.h>
+#include <bitstream/ietf/rtp.h>
+#include <bitstream/smpte/2022_1_fec.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+#define PT 33
+#define COLS 5
+#define ROWS 4
+#define MATRICES 40
+#define PACKETS (COLS * ROWS * MATRICES)
+#define PAYLOAD_SIZE (7 * TS_SIZE)
+#define PACKET_SIZE (RTP_HEADER_SIZE + PAYLOAD_SIZE)
+#define FIRST_SEQNUM 65000
+/** loss probability, in 1/256 */
+#define LOSS 8
+
+static struct uclock *uclock;
+static uint64_t date_sys;
+static uint32_t prng = 0x12345678;
+static struct upipe *upipe_rtp_fec;
+static struct upipe *upipe_rtp_fec_enc;
+
+/** media packets, indexed from the first sequence number */
+static uint8_t packets[PACKETS][PACKET_SIZE];
+/** packets received by the sink */
+static bool received[PACKETS];
+static unsigned int nb_received = 0;
+static unsigned int nb_lost = 0;
+static unsigned int nb_col = 0;
+static unsigned int nb_row = 0;
+static int last_received = -1;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_LOG:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** lossy link between the generator and the decoder */
+struct test_link {
+    /** decoder subpipe */
+    struct upipe *target;
+    /** true for the main stream */
+    bool main;
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UBASE_FROM_TO(test_link, upipe, upipe, upipe)
+
+/** returns true if the next packet is to be dropped */
+static bool drop(void)
+{
+    /* xorshift32 */
+    prng ^= prng << 13;
+    prng ^= prng >> 17;
+    prng ^= prng << 5;
+    return (prng & 0xff) < LOSS;
+}
+
+/** helper phony pipe */
+static struct upipe *link_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct test_link *link = malloc(sizeof(struct test_link));
+    assert(link != NULL);
+    link->target = NULL;
+    link->main = false;
+    upipe_init(&link->upipe, mgr, uprobe);
+    return &link->upipe;
+}
+
+/** helper phony pipe */
+static void link_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct test_link *link = test_link_from_upipe(upipe);
+    if (link->main) {
+        uint8_t buffer[RTP_HEADER_SIZE];
+        ubase_assert(uref_block_extract(uref, 0, RTP_HEADER_SIZE, buffer));
+        int idx = (uint16_t)(rtp_get_seqnum(buffer) - FIRST_SEQNUM);
+        assert(idx < PACKETS);
+        /* keep the date reference and the last matrices for the latency */
+        if (idx && idx < PACKETS - 2 * COLS * ROWS && drop()) {
+            nb_lost++;
+            uref_free(uref);
+            return;
+        }
+    } else {
+        uint8_t buffer[RTP_HEADER_SIZE + SMPTE_2022_FEC_HEADER_SIZE];
+        ubase_assert(uref_block_extract(uref, 0, sizeof(buffer), buffer));
+        assert(rtp_get_type(buffer) == 96);
+        const uint8_t *fec = buffer + RTP_HEADER_SIZE;
+        if (smpte_fec_check_d(fec)) {
+            assert(smpte_fec_get_offset(fec) == 1);
+            assert(smpte_fec_get_na(fec) == COLS);
+            nb_row++;
+        } else {
+            assert(smpte_fec_get_offset(fec) == COLS);
+            assert(smpte_fec_get_na(fec) == ROWS);
+            nb_col++;
+        }
+        if (drop()) {
+            uref_free(uref);
+            return;
+        }
+    }
+    uref_clock_set_date_sys(uref, date_sys++, UREF_DATE_CR);
+    upipe_input(link->target, uref, upump_p);
+}
+
+/** helper phony pipe */
+static int link_control(struct upipe *upipe, int command, va_list args)
+{
+    struct test_link *link = test_link_from_upipe(upipe);
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            if (!link->main)
+                ubase_assert(uref_flow_match_def(flow_def, "block.rtp.fec."));
+            return upipe_set_flow_def(link->target, flow_def);
+        }
+        case UPIPE_REGISTER_REQUEST:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static struct upipe_mgr link_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = link_alloc,
+    .upipe_input = link_input,
+    .upipe_control = link_control
+};
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uint8_t buffer[PACKET_SIZE];
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size == PACKET_SIZE);
+    ubase_assert(uref_block_extract(uref, 0, PACKET_SIZE, buffer));
+    uref_free(uref);
+
+    int idx = (uint16_t)(rtp_get_seqnum(buffer) - FIRST_SEQNUM);
+    assert(idx < PACKETS);
+    assert(idx > last_received);
+    assert(!memcmp(buffer + 2, packets[idx] + 2, PACKET_SIZE - 2));
+    last_received = idx;
+    received[idx] = true;
+    nb_received++;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_REGISTER_REQUEST:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** stops the test */
+static void stop(struct upump *upump)
+{
+    struct upipe_rtp_fec_stats stats;
+    ubase_assert(upipe_rtp_fec_get_stats(upipe_rtp_fec, &stats));
+    printf("lost %u recovered col %"PRIu64" row %"PRIu64
+           " iterative %"PRIu64" unrecoverable %"PRIu64"\n", nb_lost,
+           stats.col_recovered, stats.row_recovered,
+           stats.iterative_recovered, stats.unrecoverable);
+    assert(stats.col_recovered + stats.row_recovered > 0);
+
+    upipe_release(upipe_rtp_fec);
+    upump_stop(upump);
+    upump_free(upump);
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                         UBUF_POOL_DEPTH,
+                                                         umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr =
+        upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+
+    for (int i = 0; i < PACKETS; i++) {
+        uint8_t *packet = packets[i];
+        rtp_set_hdr(packet);
+        rtp_set_type(packet, PT);
+        rtp_set_seqnum(packet, FIRST_SEQNUM + i);
+        rtp_set_timestamp(packet, i * 1000);
+        for (int j = 0; j < PAYLOAD_SIZE; j++)
+            packet[RTP_HEADER_SIZE + j] = i * 7 + j;
+    }
+
+    /* decoder */
+    struct upipe_mgr *upipe_rtp_fec_mgr = upipe_rtp_fec_mgr_alloc();
+    assert(upipe_rtp_fec_mgr != NULL);
+    upipe_rtp_fec = upipe_rtp_fec_alloc(upipe_rtp_fec_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "fec"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "main"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "col"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "row"));
+    assert(upipe_rtp_fec != NULL);
+    ubase_assert(upipe_rtp_fec_set_pt(upipe_rtp_fec, PT));
+    ubase_assert(upipe_attach_uclock(upipe_rtp_fec));
+
+    struct upipe *upipe_sink = upipe_void_alloc(&test_mgr,
+                                                uprobe_use(logger));
+    assert(upipe_sink != NULL);
+    ubase_assert(upipe_set_output(upipe_rtp_fec, upipe_sink));
+
+    /* lossy links */
+    struct upipe *links[3];
+    for (int i = 0; i < 3; i++) {
+        links[i] = upipe_void_alloc(&link_mgr, uprobe_use(logger));
+        assert(links[i] != NULL);
+    }
+    test_link_from_upipe(links[0])->main = true;
+    ubase_assert(upipe_rtp_fec_get_main_sub(upipe_rtp_fec,
+                &test_link_from_upipe(links[0])->target));
+    ubase_assert(upipe_rtp_fec_get_col_sub(upipe_rtp_fec,
+                &test_link_from_upipe(links[1])->target));
+    ubase_assert(upipe_rtp_fec_get_row_sub(upipe_rtp_fec,
+                &test_link_from_upipe(links[2])->target));
+
+    /* generator */
+    struct upipe_mgr *upipe_rtp_fec_enc_mgr = upipe_rtp_fec_enc_mgr_alloc();
+    assert(upipe_rtp_fec_enc_mgr != NULL);
+    upipe_rtp_fec_enc = upipe_rtp_fec_enc_alloc(upipe_rtp_fec_enc_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "fec enc"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "enc col"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "enc row"));
+    assert(upipe_rtp_fec_enc != NULL);
+
+    unsigned int cols, rows;
+    ubase_assert(upipe_rtp_fec_enc_get_matrix(upipe_rtp_fec_enc,
+                                              &cols, &rows));
+    assert(cols == 10 && rows == 10);
+    ubase_nassert(upipe_rtp_fec_enc_set_matrix(upipe_rtp_fec_enc, 0, 4));
+    ubase_nassert(upipe_rtp_fec_enc_set_matrix(upipe_rtp_fec_enc, 4, 256));
+    ubase_assert(upipe_rtp_fec_enc_set_matrix(upipe_rtp_fec_enc, COLS, ROWS));
+    ubase_assert(upipe_rtp_fec_enc_get_matrix(upipe_rtp_fec_enc,
+                                              &cols, &rows));
+    assert(cols == COLS && rows == ROWS);
+
+    struct upipe *enc_col, *enc_row;
+    ubase_assert(upipe_rtp_fec_enc_get_col_sub(upipe_rtp_fec_enc, &enc_col));
+    ubase_assert(upipe_rtp_fec_enc_get_row_sub(upipe_rtp_fec_enc, &enc_row));
+    ubase_assert(upipe_set_output(upipe_rtp_fec_enc, links[0]));
+    ubase_assert(upipe_set_output(enc_col, links[1]));
+    ubase_assert(upipe_set_output(enc_row, links[2]));
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+    ubase_nassert(upipe_set_flow_def(upipe_rtp_fec_enc, flow_def));
+    ubase_assert(uref_flow_set_def(flow_def, "block.rtp.mpegts."));
+    ubase_assert(upipe_set_flow_def(upipe_rtp_fec_enc, flow_def));
+    uref_free(flow_def);
+
+    date_sys = uclock_now(uclock);
+    for (int i = 0; i < PACKETS; i++) {
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, PACKET_SIZE);
+        assert(uref != NULL);
+        uint8_t *w;
+        int size = -1;
+        ubase_assert(uref_block_write(uref, 0, &size, &w));
+        memcpy(w, packets[i], PACKET_SIZE);
+        uref_block_unmap(uref, 0);
+        upipe_input(upipe_rtp_fec_enc, uref, NULL);
+    }
+    assert(nb_row == PACKETS / COLS);
+    /* the column FEC of the last matrix is still pending */
+    assert(nb_col == (MATRICES - 1) * COLS);
+
+    upipe_release(upipe_rtp_fec_enc);
+    assert(nb_col == MATRICES * COLS);
+    upipe_mgr_release(upipe_rtp_fec_enc_mgr); // nop
+
+    struct upump *upump = upump_alloc_timer(upump_mgr, stop, NULL, NULL,
+                                            UCLOCK_FREQ / 2, 0);
+    assert(upump != NULL);
+    upump_start(upump);
+    upump_mgr_run(upump_mgr, NULL);
+
+    /* every packet after the first buffered matrices must be output */
+    for (int i = 2 * COLS * ROWS; i < PACKETS; i++)
+        assert(received[i]);
+    printf("received %u packets\n", nb_received);
+
+    upipe_mgr_release(upipe_rtp_fec_mgr); // nop
+    for (int i = 0; i < 3; i++) {
+        upipe_clean(links[i]);
+        free(test_link_from_upipe(links[i]));
+    }
+    test_free(upipe_sink);
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    upump_mgr_release(upump_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
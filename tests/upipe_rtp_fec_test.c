@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for RTP FEC module
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uprobe_upump_mgr.h"
+#include "upipe/uprobe_uclock.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/uclock.h"
+#include "upipe/uclock_std.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_clock.h"
+#include "upipe/uref_std.h"
+#include "upipe/upump.h"
+#include "upipe/upipe.h"
+#include "upump-ev/upump_ev.h"
+#include "upipe-ts/upipe_rtp_fec.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <bitstream/mpeg/ts.h>
+#include <bitstream/ietf/rtp.h>
+#include <bitstream/smpte/2022_1_fec.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+#define PT 33
+#define COLS 4
+#define ROWS 3
+#define MATRICES 7
+#define PACKETS (COLS * ROWS * MATRICES)
+#define PAYLOAD_SIZE (7 * TS_SIZE)
+#define PACKET_SIZE (RTP_HEADER_SIZE + PAYLOAD_SIZE)
+#define FIRST_SEQNUM 65520
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct uclock *uclock;
+static uint64_t date_sys;
+static struct upipe *upipe_rtp_fec;
+
+/** media packets, indexed from the first sequence number */
+static uint8_t packets[PACKETS][PACKET_SIZE];
+/** packets received by the sink */
+static bool received[PACKETS];
+static unsigned int nb_received = 0;
+static int last_received = -1;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_LOG:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uint8_t buffer[PACKET_SIZE];
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size == PACKET_SIZE);
+    ubase_assert(uref_block_extract(uref, 0, PACKET_SIZE, buffer));
+    uref_free(uref);
+
+    int idx = (uint16_t)(rtp_get_seqnum(buffer) - FIRST_SEQNUM);
+    assert(idx < PACKETS);
+    assert(idx > last_received);
+    assert(!memcmp(buffer + 2, packets[idx] + 2, PACKET_SIZE - 2));
+    last_received = idx;
+    received[idx] = true;
+    nb_received++;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** sends a buffer to a subpipe of the FEC pipe */
+static void send_buffer(struct upipe *sub, const uint8_t *buffer, int size)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, size);
+    assert(uref != NULL);
+    uint8_t *w;
+    ubase_assert(uref_block_write(uref, 0, &size, &w));
+    memcpy(w, buffer, size);
+    uref_block_unmap(uref, 0);
+    uref_clock_set_date_sys(uref, date_sys++, UREF_DATE_CR);
+    upipe_input(sub, uref, NULL);
+}
+
+/** sends a FEC packet protecting the given packets */
+static void send_fec(struct upipe *sub, int first, int step, int items,
+                     bool row)
+{
+    uint8_t buffer[RTP_HEADER_SIZE + SMPTE_2022_FEC_HEADER_SIZE +
+                   PAYLOAD_SIZE];
+    uint8_t *fec = buffer + RTP_HEADER_SIZE;
+    uint8_t *payload = fec + SMPTE_2022_FEC_HEADER_SIZE;
+    uint32_t ts_rec = 0;
+
+    memset(buffer, 0, sizeof(buffer));
+    rtp_set_hdr(buffer);
+    rtp_set_type(buffer, 96);
+    rtp_set_seqnum(buffer, first);
+    for (int i = 0; i < items; i++) {
+        const uint8_t *packet = packets[first + i * step];
+        ts_rec ^= rtp_get_timestamp(packet);
+        for (int j = 0; j < PAYLOAD_SIZE; j++)
+            payload[j] ^= packet[RTP_HEADER_SIZE + j];
+    }
+    smpte_fec_set_snbase_low(fec, FIRST_SEQNUM + first);
+    smpte_fec_set_length_rec(fec, items % 2 ? PAYLOAD_SIZE : 0);
+    smpte_fec_set_ts_recovery(fec, ts_rec);
+    if (row) {
+        smpte_fec_set_d(fec);
+        smpte_fec_set_offset(fec, 1);
+        smpte_fec_set_na(fec, COLS);
+    } else {
+        smpte_fec_set_offset(fec, COLS);
+        smpte_fec_set_na(fec, ROWS);
+    }
+    send_buffer(sub, buffer, sizeof(buffer));
+}
+
+/** stops the test */
+static void stop(struct upump *upump)
+{
+    struct upipe_rtp_fec_stats stats;
+    ubase_assert(upipe_rtp_fec_get_stats(upipe_rtp_fec, &stats));
+    printf("recovered col %"PRIu64" row %"PRIu64" iterative %"PRIu64"\n",
+           stats.col_recovered, stats.row_recovered,
+           stats.iterative_recovered);
+    assert(stats.col_recovered >= 2);
+    assert(stats.row_recovered >= 2);
+    assert(stats.iterative_recovered >= 1);
+
+    upipe_release(upipe_rtp_fec);
+    upump_stop(upump);
+    upump_free(upump);
+}
+
+/** returns true if the packet at the given position is lost */
+static bool lost(int matrix, int row, int col)
+{
+    /* two losses in a row, and a lost column FEC: requires a second pass */
+    if (matrix == 2)
+        return row == 0 && (col == 0 || col == 1);
+    /* recovered by the row FEC */
+    if (matrix == 3)
+        return row == 1 && col == 2;
+    /* recovered by the column FEC */
+    if (matrix == 4)
+        return row == 2 && col == 3;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr =
+        upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+
+    for (int i = 0; i < PACKETS; i++) {
+        uint8_t *packet = packets[i];
+        rtp_set_hdr(packet);
+        rtp_set_type(packet, PT);
+        rtp_set_seqnum(packet, FIRST_SEQNUM + i);
+        rtp_set_timestamp(packet, i * 1000);
+        for (int j = 0; j < PAYLOAD_SIZE; j++)
+            packet[RTP_HEADER_SIZE + j] = i * 7 + j;
+    }
+
+    struct upipe_mgr *upipe_rtp_fec_mgr = upipe_rtp_fec_mgr_alloc();
+    assert(upipe_rtp_fec_mgr != NULL);
+    upipe_rtp_fec = upipe_rtp_fec_alloc(upipe_rtp_fec_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "fec"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "main"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "col"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "row"));
+    assert(upipe_rtp_fec != NULL);
+    ubase_assert(upipe_rtp_fec_set_pt(upipe_rtp_fec, PT));
+    ubase_assert(upipe_attach_uclock(upipe_rtp_fec));
+
+    struct upipe *main_sub, *col_sub, *row_sub;
+    ubase_assert(upipe_rtp_fec_get_main_sub(upipe_rtp_fec, &main_sub));
+    ubase_assert(upipe_rtp_fec_get_col_sub(upipe_rtp_fec, &col_sub));
+    ubase_assert(upipe_rtp_fec_get_row_sub(upipe_rtp_fec, &row_sub));
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(main_sub, flow_def));
+    uref_free(flow_def);
+
+    struct upipe *upipe_sink = upipe_void_alloc(&test_mgr,
+                                                uprobe_use(logger));
+    assert(upipe_sink != NULL);
+    ubase_assert(upipe_set_output(upipe_rtp_fec, upipe_sink));
+
+    /* the first packet is only used as a date reference */
+    date_sys = uclock_now(uclock);
+    send_buffer(main_sub, packets[0], PACKET_SIZE);
+
+    for (int m = 0; m < MATRICES; m++) {
+        int base = m * COLS * ROWS;
+        for (int r = 0; r < ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                int idx = base + r * COLS + c;
+                if (idx && !lost(m, r, c))
+                    send_buffer(main_sub, packets[idx], PACKET_SIZE);
+            }
+            if (!(m == 4 && r == 2))
+                send_fec(row_sub, base + r * COLS, 1, COLS, true);
+        }
+        for (int c = 0; c < COLS; c++)
+            if (!(m == 2 && c == 1))
+                send_fec(col_sub, base + c, COLS, ROWS, false);
+    }
+
+    struct upump *upump = upump_alloc_timer(upump_mgr, stop, NULL, NULL,
+                                            UCLOCK_FREQ / 2, 0);
+    assert(upump != NULL);
+    upump_start(upump);
+    upump_mgr_run(upump_mgr, NULL);
+
+    /* every packet after the first buffered matrix must be output */
+    for (int i = 2 * COLS * ROWS; i < PACKETS; i++)
+        assert(received[i]);
+    printf("received %u packets\n", nb_received);
+
+    upipe_mgr_release(upipe_rtp_fec_mgr); // nop
+    test_free(upipe_sink);
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    upump_mgr_release(upump_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
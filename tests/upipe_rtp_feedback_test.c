@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short unit tests for the rtpfb module, reordering RTP packets and
+ * requesting retransmissions of lost ones
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uprobe_uref_mgr.h"
+#include "upipe/uprobe_ubuf_mem.h"
+#include "upipe/uprobe_upump_mgr.h"
+#include "upipe/uprobe_uclock.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/uclock.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_clock.h"
+#include "upipe/uref_std.h"
+#include "upipe/upump.h"
+#include "upipe/upipe.h"
+#include "upump-ev/upump_ev.h"
+#include "upipe-filters/upipe_rtp_feedback.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include <bitstream/ietf/rtp.h>
+#include <bitstream/ietf/rtcp.h>
+#include <bitstream/ietf/rtcp_fb.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define PAYLOAD_SIZE 100
+#define PACKET_SIZE (RTP_HEADER_SIZE + PAYLOAD_SIZE)
+/** latency of the pipe, in ms */
+#define LATENCY 1000
+/** default round-trip time of the pipe */
+#define RTT (LATENCY * UCLOCK_FREQ / 1000 / 7)
+#define FIRST_SEQNUM 65520
+#define LAST_SEQNUM 15
+#define MAX_RECEIVED 64
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static uint64_t now = UCLOCK_FREQ;
+static struct upipe *rtpfb;
+static struct upipe *rtpfb_output;
+static struct upipe *sink;
+static struct upipe *nack_sink;
+
+/** sequence numbers received by the sink */
+static uint16_t received[MAX_RECEIVED];
+static unsigned int nb_received = 0;
+/** FCIs of the last NACK packet */
+static uint16_t nack_ids[MAX_RECEIVED];
+static uint16_t nack_masks[MAX_RECEIVED];
+static unsigned int nb_fcis = 0;
+static unsigned int nb_nacks = 0;
+
+/** order in which packets are sent: 65524, 65525, 65527, 65535, 1 and 10
+ * are missing, 65526 is reordered, 3 and 65526 are duplicated */
+static const uint16_t sent[] = {
+    65520, 65521, 65522, 65523, 65528, 65526, 65529, 65530, 65531, 65532,
+    65533, 65534, 0, 2, 3, 4, 5, 6, 7, 8, 9, 11, 12, 13, 14, 15, 3, 65526
+};
+#define NB_SENT (sizeof(sent) / sizeof(sent[0]))
+#define NB_BUFFERED 26
+/** packets still missing after the retransmission of 65524 and 1 */
+static const uint16_t lost[] = { 65525, 65527, 65535, 10 };
+#define NB_LOST (sizeof(lost) / sizeof(lost[0]))
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_SOURCE_END:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper uclock */
+static uint64_t test_now(struct uclock *unused)
+{
+    return now;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe receiving RTP packets */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    const uint8_t *buf;
+    int size = -1;
+    ubase_assert(uref_block_read(uref, 0, &size, &buf));
+    assert(size == PACKET_SIZE);
+    assert(nb_received < MAX_RECEIVED);
+    received[nb_received] = rtp_get_seqnum(buf);
+    upipe_dbg_va(upipe, "received %hu", received[nb_received]);
+    nb_received++;
+    uref_block_unmap(uref, 0);
+    uref_free(uref);
+}
+
+/** helper phony pipe receiving RTCP packets */
+static void test_input_nack(struct upipe *upipe, struct uref *uref,
+                            struct upump **upump_p)
+{
+    const uint8_t *buf;
+    int size = -1;
+    ubase_assert(uref_block_read(uref, 0, &size, &buf));
+    assert(size >= RTCP_FB_HEADER_SIZE);
+    assert(rtp_check_hdr(buf));
+    assert(rtcp_get_pt(buf) == RTCP_PT_RTPFB);
+    assert(rtcp_fb_get_fmt(buf) == RTCP_PT_RTPFB_GENERIC_NACK);
+    assert((rtcp_get_length(buf) + 1) * 4 == size);
+
+    nb_nacks++;
+    nb_fcis = (size - RTCP_FB_HEADER_SIZE) / RTCP_FB_FCI_GENERIC_NACK_SIZE;
+    assert(nb_fcis <= MAX_RECEIVED);
+    for (unsigned int i = 0; i < nb_fcis; i++) {
+        const uint8_t *fci = &buf[RTCP_FB_HEADER_SIZE +
+                                  i * RTCP_FB_FCI_GENERIC_NACK_SIZE];
+        nack_ids[i] = rtcp_fb_nack_get_packet_id(fci);
+        nack_masks[i] = rtcp_fb_nack_get_bitmask_lost(fci);
+        upipe_dbg_va(upipe, "NACK %hu (+0x%hx)", nack_ids[i], nack_masks[i]);
+    }
+    uref_block_unmap(uref, 0);
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** helper phony pipe */
+static struct upipe_mgr test_nack_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input_nack,
+    .upipe_control = test_control
+};
+
+/** sends a RTP packet */
+static void send_packet(uint16_t seqnum)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, PACKET_SIZE);
+    assert(uref != NULL);
+    uint8_t *buf;
+    int size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buf));
+    memset(buf, 0, size);
+    rtp_set_hdr(buf);
+    rtp_set_seqnum(buf, seqnum);
+    uref_block_unmap(uref, 0);
+    uref_clock_set_cr_sys(uref, now);
+    upipe_input(rtpfb, uref, NULL);
+}
+
+/** returns true if a packet is expected to be lost */
+static bool is_lost(uint16_t seqnum)
+{
+    for (unsigned int i = 0; i < NB_LOST; i++)
+        if (lost[i] == seqnum)
+            return true;
+    return false;
+}
+
+/** runs the steps of the test, leaving time to the timers of the pipe */
+static void step(struct upump *upump)
+{
+    static int state = 0;
+    unsigned expected_seqnum, last_output_seqnum;
+    size_t buffered, nacks, repaired, loss, dups, buffered_bytes;
+    uint64_t repaired_bytes;
+
+    switch (state++) {
+        case 0:
+            /* let the NACK timer see the holes */
+            now += RTT / 2;
+            break;
+
+        case 1:
+            /* one NACK packet, the bitmask crossing the wraparound */
+            assert(nb_nacks == 1);
+            assert(nb_fcis == 2);
+            assert(nack_ids[0] == 65524);
+            assert(nack_masks[0] == 0x1405);
+            assert(nack_ids[1] == 10);
+            assert(nack_masks[1] == 0);
+
+            ubase_assert(upipe_rtpfb_get_stats(rtpfb, &expected_seqnum,
+                    &last_output_seqnum, &buffered, &nacks, &repaired,
+                    &loss, &dups));
+            assert(expected_seqnum == LAST_SEQNUM + 1);
+            assert(last_output_seqnum == UINT_MAX);
+            assert(buffered == NB_BUFFERED);
+            assert(nacks == 6);
+            assert(repaired == 1);
+            assert(loss == 0);
+            assert(dups == 2);
+            ubase_assert(upipe_rtpfb_get_buffer_stats(rtpfb,
+                    &buffered_bytes, &repaired_bytes));
+            assert(buffered_bytes == NB_BUFFERED * PACKET_SIZE);
+            assert(repaired_bytes == PACKET_SIZE);
+
+            /* retransmissions, and another round of NACKs */
+            send_packet(65524);
+            send_packet(1);
+            now += RTT * 13 / 10;
+            break;
+
+        case 2:
+            /* only the packets still missing are requested again */
+            assert(nb_nacks == 2);
+            assert(nb_fcis == 2);
+            assert(nack_ids[0] == 65525);
+            assert(nack_masks[0] == 0x202);
+            assert(nack_ids[1] == 10);
+            assert(nack_masks[1] == 0);
+
+            /* the output of all packets */
+            now += LATENCY * UCLOCK_FREQ / 1000;
+            break;
+
+        case 3: {
+            unsigned int nb = 0;
+            for (uint16_t seqnum = FIRST_SEQNUM;
+                 seqnum != (uint16_t)(LAST_SEQNUM + 1); seqnum++) {
+                if (is_lost(seqnum))
+                    continue;
+                assert(nb < nb_received);
+                assert(received[nb] == seqnum);
+                nb++;
+            }
+            assert(nb == nb_received);
+
+            ubase_assert(upipe_rtpfb_get_stats(rtpfb, &expected_seqnum,
+                    &last_output_seqnum, &buffered, &nacks, &repaired,
+                    &loss, &dups));
+            assert(expected_seqnum == UINT_MAX);
+            assert(last_output_seqnum == LAST_SEQNUM);
+            assert(buffered == 0);
+            assert(repaired == 2);
+            assert(loss == NB_LOST);
+            assert(dups == 0);
+            ubase_assert(upipe_rtpfb_get_buffer_stats(rtpfb,
+                    &buffered_bytes, &repaired_bytes));
+            assert(buffered_bytes == 0);
+            assert(repaired_bytes == 2 * PACKET_SIZE);
+
+            upipe_release(rtpfb_output);
+            upipe_release(rtpfb);
+            upump_stop(upump);
+            upump_free(upump);
+            break;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr =
+        upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+
+    struct uclock uclock;
+    uclock.refcount = NULL;
+    uclock.uclock_now = test_now;
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, &uclock);
+    assert(logger != NULL);
+
+    struct upipe_mgr *upipe_rtpfb_mgr = upipe_rtpfb_mgr_alloc();
+    assert(upipe_rtpfb_mgr != NULL);
+    rtpfb = upipe_void_alloc(upipe_rtpfb_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "rtpfb"));
+    assert(rtpfb != NULL);
+    ubase_assert(upipe_set_option(rtpfb, "latency", "1000"));
+
+    rtpfb_output = upipe_void_alloc_sub(rtpfb,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "rtcp"));
+    assert(rtpfb_output != NULL);
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(rtpfb, flow_def));
+    uref_free(flow_def);
+
+    sink = upipe_void_alloc(&test_mgr, uprobe_use(logger));
+    assert(sink != NULL);
+    ubase_assert(upipe_set_output(rtpfb, sink));
+    nack_sink = upipe_void_alloc(&test_nack_mgr, uprobe_use(logger));
+    assert(nack_sink != NULL);
+    ubase_assert(upipe_set_output(rtpfb_output, nack_sink));
+
+    for (unsigned int i = 0; i < NB_SENT; i++)
+        send_packet(sent[i]);
+
+    struct upump *upump = upump_alloc_timer(upump_mgr, step, NULL, NULL,
+                                            UCLOCK_FREQ / 10,
+                                            UCLOCK_FREQ / 10);
+    assert(upump != NULL);
+    upump_start(upump);
+    upump_mgr_run(upump_mgr, NULL);
+
+    test_free(sink);
+    test_free(nack_sink);
+
+    upump_mgr_release(upump_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
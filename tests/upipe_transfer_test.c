@@ -33,6 +33,7 @@
 #define UPUMP_BLOCKER_POOL 1
 #define XFER_QUEUE 255
 #define XFER_POOL 1
+#define XFER_SPIN 100
 
 static struct upump_mgr *upump_mgr = NULL;
 static bool transferred = false;
@@ -134,8 +135,11 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe, int event, va_list
     return UBASE_ERR_NONE;
 }
 
-int main(int argc, char **argv)
+static void run(bool spsc)
 {
+    transferred = false;
+    got_uri = false;
+
     struct upump_mgr *upump_mgr =
         upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
 
@@ -157,7 +161,8 @@ int main(int argc, char **argv)
             uprobe_pfx_alloc(uprobe_xfer, UPROBE_LOG_VERBOSE, "test"));
     assert(upipe_test != NULL);
 
-    struct upipe_mgr *upipe_xfer_mgr =
+    struct upipe_mgr *upipe_xfer_mgr = spsc ?
+        upipe_xfer_mgr_alloc_spsc(XFER_QUEUE, XFER_POOL, NULL, XFER_SPIN) :
         upipe_xfer_mgr_alloc(XFER_QUEUE, XFER_POOL, NULL);
     assert(upipe_xfer_mgr != NULL);
 
@@ -185,5 +190,11 @@ int main(int argc, char **argv)
     uprobe_release(uprobe_stdio);
     uprobe_release(uprobe_upump_mgr);
     upump_mgr_release(upump_mgr);
+}
+
+int main(int argc, char **argv)
+{
+    run(false);
+    run(true);
     return 0;
 }
@@ -32,6 +32,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include <bitstream/mpeg/ts.h>
@@ -219,6 +220,43 @@ int main(int argc, char *argv[])
     assert(!nb_packets);
     assert(!pcr);
 
+    /* run of packets of the same PID, as output by ts_split in vector mode */
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 3 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 3 * TS_SIZE);
+    for (int i = 0; i < 3; i++) {
+        ts_init(buffer + i * TS_SIZE);
+        ts_set_cc(buffer + i * TS_SIZE, 4 + i);
+        ts_set_payload(buffer + i * TS_SIZE);
+    }
+    /* the payloads are merged into a single uref */
+    discontinuity = UBASE_ERR_INVALID;
+    payload_size = 3 * (TS_SIZE - TS_HEADER_SIZE);
+    uref_block_unmap(uref, 0);
+    nb_packets++;
+    upipe_input(upipe_ts_decaps, uref, NULL);
+    assert(!nb_packets);
+
+    /* run with a duplicate packet in the middle */
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 3 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 3 * TS_SIZE);
+    memset(buffer, 0xff, size);
+    for (int i = 0; i < 3; i++) {
+        ts_init(buffer + i * TS_SIZE);
+        ts_set_cc(buffer + i * TS_SIZE, i ? 6 + i : 7);
+        ts_set_payload(buffer + i * TS_SIZE);
+    }
+    payload_size = TS_SIZE - TS_HEADER_SIZE;
+    uref_block_unmap(uref, 0);
+    nb_packets += 2;
+    upipe_input(upipe_ts_decaps, uref, NULL);
+    assert(!nb_packets);
+
     upipe_release(upipe_ts_decaps);
     upipe_mgr_release(upipe_ts_decaps_mgr); // nop
 
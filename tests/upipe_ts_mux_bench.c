@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short benchmark of the TS mux module as a function of the number of
+ * inputs
+ *
+ * Each input is an MPEG-1 layer 2 audio elementary stream in its own
+ * program, and the mux runs in file mode, as fast as possible, to a null
+ * sink.
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uprobe_uref_mgr.h"
+#include "upipe/uprobe_ubuf_mem.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_clock.h"
+#include "upipe/uref_flow.h"
+#include "upipe/uref_sound_flow.h"
+#include "upipe/uref_std.h"
+#include "upipe/uclock.h"
+#include "upipe/upipe.h"
+#include "upipe-modules/upipe_null.h"
+#include "upipe-ts/upipe_ts_mux.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 10
+#define UREF_POOL_DEPTH 10
+#define UBUF_POOL_DEPTH 10
+#define UPROBE_LOG_LEVEL UPROBE_LOG_WARNING
+#define DEFAULT_FRAMES 1000
+#define SAMPLE_RATE 48000
+#define SAMPLES 1152
+#define OCTETRATE 24000
+#define FRAME_SIZE (OCTETRATE * SAMPLES / SAMPLE_RATE)
+#define FRAME_DURATION (UCLOCK_FREQ * SAMPLES / SAMPLE_RATE)
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct uprobe *logger;
+
+/** returns the monotonic time in nanoseconds */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** muxes the given number of frames on the given number of inputs, and
+ * prints the throughput */
+static void bench(unsigned int nb_inputs, unsigned int nb_frames)
+{
+    struct upipe_mgr *upipe_ts_mux_mgr = upipe_ts_mux_mgr_alloc();
+    assert(upipe_ts_mux_mgr != NULL);
+    struct upipe *upipe_ts_mux = upipe_void_alloc(upipe_ts_mux_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "ts mux"));
+    assert(upipe_ts_mux != NULL);
+    upipe_mgr_release(upipe_ts_mux_mgr);
+    ubase_assert(upipe_ts_mux_set_cr_prog(upipe_ts_mux, 0));
+
+    struct upipe_mgr *upipe_null_mgr = upipe_null_mgr_alloc();
+    assert(upipe_null_mgr != NULL);
+    struct upipe *upipe_null = upipe_void_alloc_output(upipe_ts_mux,
+            upipe_null_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "null"));
+    assert(upipe_null != NULL);
+    upipe_mgr_release(upipe_null_mgr);
+    upipe_release(upipe_null);
+
+    struct uref *program_flow_def = uref_alloc_control(uref_mgr);
+    assert(program_flow_def != NULL);
+    ubase_assert(uref_flow_set_def(program_flow_def, "void."));
+
+    struct uref *input_flow_def =
+        uref_block_flow_alloc_def(uref_mgr, "mp2.sound.");
+    assert(input_flow_def != NULL);
+    ubase_assert(uref_block_flow_set_octetrate(input_flow_def, OCTETRATE));
+    ubase_assert(uref_sound_flow_set_rate(input_flow_def, SAMPLE_RATE));
+    ubase_assert(uref_sound_flow_set_samples(input_flow_def, SAMPLES));
+
+    struct upipe *inputs[nb_inputs];
+    for (unsigned int i = 0; i < nb_inputs; i++) {
+        struct upipe *program = upipe_void_alloc_sub(upipe_ts_mux,
+                uprobe_pfx_alloc_va(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                    "program %u", i));
+        assert(program != NULL);
+        ubase_assert(upipe_set_flow_def(program, program_flow_def));
+
+        inputs[i] = upipe_void_alloc_sub(program,
+                uprobe_pfx_alloc_va(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                    "input %u", i));
+        assert(inputs[i] != NULL);
+        ubase_assert(upipe_set_flow_def(inputs[i], input_flow_def));
+        upipe_release(program);
+    }
+    uref_free(program_flow_def);
+    uref_free(input_flow_def);
+
+    uint64_t begin = now_ns();
+    for (unsigned int frame = 0; frame < nb_frames; frame++) {
+        uint64_t dts = UCLOCK_FREQ + (uint64_t)frame * FRAME_DURATION;
+        for (unsigned int i = 0; i < nb_inputs; i++) {
+            struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr,
+                                                 FRAME_SIZE);
+            assert(uref != NULL);
+            int size = -1;
+            uint8_t *buffer;
+            ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+            memset(buffer, 0xff, size);
+            ubase_assert(uref_block_unmap(uref, 0));
+            uref_clock_set_dts_sys(uref, dts);
+            uref_clock_set_dts_prog(uref, dts);
+            uref_clock_set_dts_pts_delay(uref, 0);
+            uref_clock_set_duration(uref, FRAME_DURATION);
+            upipe_input(inputs[i], uref, NULL);
+        }
+    }
+
+    for (unsigned int i = 0; i < nb_inputs; i++)
+        upipe_release(inputs[i]);
+    upipe_release(upipe_ts_mux);
+    uint64_t elapsed = now_ns() - begin;
+
+    uint64_t nb_urefs = (uint64_t)nb_inputs * nb_frames;
+    printf("%u inputs: %"PRIu64" frames in %"PRIu64" ms, "
+           "%"PRIu64" frames/s, %"PRIu64" ns/frame\n",
+           nb_inputs, nb_urefs, elapsed / 1000000,
+           elapsed ? nb_urefs * 1000000000 / elapsed : 0,
+           nb_urefs ? elapsed / nb_urefs : 0);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stdout, "Usage: %s [-f <frames per input>] <number of inputs>...\n",
+            argv0);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int nb_frames = DEFAULT_FRAMES;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:")) != -1) {
+        switch (opt) {
+            case 'f':
+                nb_frames = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind >= argc)
+        usage(argv[0]);
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+
+    logger = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    for (int i = optind; i < argc; i++) {
+        unsigned int nb_inputs = strtoul(argv[i], NULL, 0);
+        if (!nb_inputs)
+            usage(argv[0]);
+        bench(nb_inputs, nb_frames);
+    }
+
+    uprobe_release(logger);
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for the scheduling of the inputs of the TS mux module
+ *
+ * Two muxes are fed with the same programs and elementary streams, one
+ * with the default heap scheduler and one with the linear scheduler, and
+ * their outputs must be identical.
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uprobe_uref_mgr.h"
+#include "upipe/uprobe_ubuf_mem.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_clock.h"
+#include "upipe/uref_flow.h"
+#include "upipe/uref_sound_flow.h"
+#include "upipe/uref_std.h"
+#include "upipe/uclock.h"
+#include "upipe/upipe.h"
+#include "upipe-ts/upipe_ts_mux.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <bitstream/mpeg/ts.h>
+
+#define UDICT_POOL_DEPTH 10
+#define UREF_POOL_DEPTH 10
+#define UBUF_POOL_DEPTH 10
+#define UPROBE_LOG_LEVEL UPROBE_LOG_WARNING
+#define NB_PROGRAMS 4
+#define MAX_INPUTS 3
+#define NB_FRAMES 200
+#define SAMPLE_RATE 48000
+#define SAMPLES 1152
+#define FRAME_DURATION (UCLOCK_FREQ * SAMPLES / SAMPLE_RATE)
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct uprobe *logger;
+
+/** octetrates of the inputs, per program */
+static const uint64_t octetrates[NB_PROGRAMS][MAX_INPUTS] = {
+    { 24000, 0, 0 },
+    { 32000, 16000, 0 },
+    { 48000, 24000, 8000 },
+    { 16000, 16000, 0 },
+};
+
+/** phony pipe accumulating the output of a mux */
+struct test_sink {
+    /** output TS */
+    uint8_t *buffer;
+    /** size of the output TS */
+    size_t size;
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct test_sink *sink = malloc(sizeof(struct test_sink));
+    assert(sink != NULL);
+    sink->buffer = NULL;
+    sink->size = 0;
+    upipe_init(&sink->upipe, mgr, uprobe);
+    return &sink->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct test_sink *sink = container_of(upipe, struct test_sink, upipe);
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size && !(size % TS_SIZE));
+    sink->buffer = realloc(sink->buffer, sink->size + size);
+    assert(sink->buffer != NULL);
+    ubase_assert(uref_block_extract(uref, 0, size,
+                                    sink->buffer + sink->size));
+    sink->size += size;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    struct test_sink *sink = container_of(upipe, struct test_sink, upipe);
+    upipe_clean(upipe);
+    free(sink->buffer);
+    free(sink);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** allocates a mux with the given scheduler and its programs and inputs */
+static struct upipe *mux_alloc(bool linear, struct upipe *sink,
+                               struct upipe *inputs[NB_PROGRAMS][MAX_INPUTS])
+{
+    struct upipe_mgr *upipe_ts_mux_mgr = upipe_ts_mux_mgr_alloc();
+    assert(upipe_ts_mux_mgr != NULL);
+    struct upipe *upipe_ts_mux = upipe_void_alloc(upipe_ts_mux_mgr,
+            uprobe_pfx_alloc_va(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                "ts mux %s", linear ? "linear" : "heap"));
+    assert(upipe_ts_mux != NULL);
+    upipe_mgr_release(upipe_ts_mux_mgr);
+    ubase_assert(upipe_ts_mux_set_linear_scheduler(upipe_ts_mux, linear));
+    ubase_assert(upipe_ts_mux_set_cr_prog(upipe_ts_mux, 0));
+    ubase_assert(upipe_set_output(upipe_ts_mux, sink));
+
+    struct uref *program_flow_def = uref_alloc_control(uref_mgr);
+    assert(program_flow_def != NULL);
+    ubase_assert(uref_flow_set_def(program_flow_def, "void."));
+
+    for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+        struct upipe *program = upipe_void_alloc_sub(upipe_ts_mux,
+                uprobe_pfx_alloc_va(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                    "program %u", i));
+        assert(program != NULL);
+        ubase_assert(upipe_set_flow_def(program, program_flow_def));
+
+        for (unsigned int j = 0; j < MAX_INPUTS; j++) {
+            inputs[i][j] = NULL;
+            if (!octetrates[i][j])
+                continue;
+
+            struct uref *input_flow_def =
+                uref_block_flow_alloc_def(uref_mgr, "mp2.sound.");
+            assert(input_flow_def != NULL);
+            ubase_assert(uref_block_flow_set_octetrate(input_flow_def,
+                                                       octetrates[i][j]));
+            ubase_assert(uref_sound_flow_set_rate(input_flow_def,
+                                                  SAMPLE_RATE));
+            ubase_assert(uref_sound_flow_set_samples(input_flow_def,
+                                                     SAMPLES));
+
+            inputs[i][j] = upipe_void_alloc_sub(program,
+                    uprobe_pfx_alloc_va(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                        "input %u.%u", i, j));
+            assert(inputs[i][j] != NULL);
+            ubase_assert(upipe_set_flow_def(inputs[i][j], input_flow_def));
+            uref_free(input_flow_def);
+        }
+        upipe_release(program);
+    }
+    uref_free(program_flow_def);
+    return upipe_ts_mux;
+}
+
+/** feeds a frame to an input */
+static void input_frame(struct upipe *input, uint64_t octetrate,
+                        unsigned int frame, uint64_t jitter)
+{
+    size_t frame_size = octetrate * SAMPLES / SAMPLE_RATE;
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, frame_size);
+    assert(uref != NULL);
+    int size = -1;
+    uint8_t *buffer;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    for (int k = 0; k < size; k++)
+        buffer[k] = octetrate / 1000 + frame + k;
+    ubase_assert(uref_block_unmap(uref, 0));
+
+    uint64_t dts = UCLOCK_FREQ + (uint64_t)frame * FRAME_DURATION + jitter;
+    uref_clock_set_dts_sys(uref, dts);
+    uref_clock_set_dts_prog(uref, dts);
+    uref_clock_set_dts_pts_delay(uref, 0);
+    uref_clock_set_duration(uref, FRAME_DURATION);
+    upipe_input(input, uref, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+
+    logger = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    struct upipe *sinks[2];
+    struct upipe *muxes[2];
+    struct upipe *inputs[2][NB_PROGRAMS][MAX_INPUTS];
+    for (int m = 0; m < 2; m++) {
+        sinks[m] = upipe_void_alloc(&test_mgr, uprobe_use(logger));
+        assert(sinks[m] != NULL);
+        muxes[m] = mux_alloc(m, sinks[m], inputs[m]);
+    }
+
+    for (unsigned int frame = 0; frame < NB_FRAMES; frame++) {
+        for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+            for (unsigned int j = 0; j < MAX_INPUTS; j++) {
+                /* the last input of program 2 is deleted halfway */
+                if (i == 2 && j == 2 && frame == NB_FRAMES / 2) {
+                    for (int m = 0; m < 2; m++) {
+                        upipe_release(inputs[m][i][j]);
+                        inputs[m][i][j] = NULL;
+                    }
+                }
+                if (inputs[0][i][j] == NULL)
+                    continue;
+
+                /* inputs with the same rate are offset to create ties
+                 * and near-ties in the heaps */
+                uint64_t jitter = (j * UCLOCK_FREQ / 1000) * (i % 2);
+                for (int m = 0; m < 2; m++)
+                    input_frame(inputs[m][i][j], octetrates[i][j], frame,
+                                jitter);
+            }
+        }
+    }
+
+    for (int m = 0; m < 2; m++) {
+        for (unsigned int i = 0; i < NB_PROGRAMS; i++)
+            for (unsigned int j = 0; j < MAX_INPUTS; j++)
+                upipe_release(inputs[m][i][j]);
+        upipe_release(muxes[m]);
+    }
+
+    struct test_sink *heap = container_of(sinks[0], struct test_sink, upipe);
+    struct test_sink *linear = container_of(sinks[1], struct test_sink, upipe);
+    printf("heap scheduler: %zu octets, linear scheduler: %zu octets\n",
+           heap->size, linear->size);
+    assert(heap->size > NB_FRAMES * TS_SIZE);
+    assert(heap->size == linear->size);
+    assert(!memcmp(heap->buffer, linear->buffer, heap->size));
+
+    test_free(sinks[0]);
+    test_free(sinks[1]);
+
+    uprobe_release(logger);
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -74,6 +74,7 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
 struct test {
     uint16_t pid;
     bool got_packet;
+    unsigned int packets;
     struct upipe upipe;
 };
 
@@ -88,6 +89,7 @@ static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
     assert(test != NULL);
     upipe_init(&test->upipe, mgr, uprobe);
     test->got_packet = false;
+    test->packets = 0;
     test->pid = pid;
     return &test->upipe;
 }
@@ -99,13 +101,19 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     struct test *test = container_of(upipe, struct test, upipe);
     assert(uref != NULL);
     test->got_packet = true;
-    const uint8_t *buffer;
-    int size = -1;
-    ubase_assert(uref_block_read(uref, 0, &size, &buffer));
-    assert(size == TS_SIZE); //because of the way we allocated it
-    assert(ts_validate(buffer));
-    assert(ts_get_pid(buffer) == test->pid);
-    uref_block_unmap(uref, 0);
+    size_t uref_size;
+    ubase_assert(uref_block_size(uref, &uref_size));
+    assert(uref_size && uref_size % TS_SIZE == 0);
+    for (int offset = 0; offset < uref_size; offset += TS_SIZE) {
+        const uint8_t *buffer;
+        int size = TS_SIZE;
+        ubase_assert(uref_block_read(uref, offset, &size, &buffer));
+        assert(size == TS_SIZE); //because of the way we allocated it
+        assert(ts_validate(buffer));
+        assert(ts_get_pid(buffer) == test->pid);
+        uref_block_unmap(uref, offset);
+        test->packets++;
+    }
     uref_free(uref);
 }
 
@@ -215,6 +223,23 @@ int main(int argc, char *argv[])
     uref_block_unmap(uref, 0);
     upipe_input(upipe_ts_split, uref, NULL);
 
+    /* vector of packets, as output by ts_sync in vector mode */
+    static const uint16_t pids[] = { 68, 68, 69, 100, 68 };
+    const int nb_pids = sizeof(pids) / sizeof(pids[0]);
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, nb_pids * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == nb_pids * TS_SIZE);
+    for (int i = 0; i < nb_pids; i++) {
+        ts_pad(buffer + i * TS_SIZE);
+        ts_set_pid(buffer + i * TS_SIZE, pids[i]);
+    }
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_split, uref, NULL);
+    assert(container_of(upipe_sink68, struct test, upipe)->packets == 4);
+    assert(container_of(upipe_sink69, struct test, upipe)->packets == 2);
+
     upipe_release(upipe_ts_split_output68);
     upipe_release(upipe_ts_split_output69);
     upipe_release(upipe_ts_split);
@@ -40,6 +40,10 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 
 static unsigned int nb_packets = 0;
+/** maximum number of packets per uref */
+static unsigned int max_vector = 1;
+/** number of packets in the last uref */
+static unsigned int last_vector = 0;
 static int expect_loss = -1;
 
 /** definition of our uprobe */
@@ -79,16 +83,20 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     assert(uref != NULL);
     size_t size;
     ubase_assert(uref_block_size(uref, &size));
-    assert(size == TS_SIZE);
+    assert(size && size % TS_SIZE == 0);
+    assert(size / TS_SIZE <= max_vector);
+    last_vector = size / TS_SIZE;
 
-    const uint8_t *buffer;
-    int rsize = 1;
-    ubase_assert(uref_block_read(uref, 0, &rsize, &buffer));
-    assert(rsize == 1);
-    assert(ts_validate(buffer));
-    uref_block_unmap(uref, 0);
+    for (int offset = 0; offset < size; offset += TS_SIZE) {
+        const uint8_t *buffer;
+        int rsize = 1;
+        ubase_assert(uref_block_read(uref, offset, &rsize, &buffer));
+        assert(rsize == 1);
+        assert(ts_validate(buffer));
+        uref_block_unmap(uref, offset);
+        nb_packets--;
+    }
     uref_free(uref);
-    nb_packets--;
 }
 
 /** helper phony pipe */
@@ -216,6 +224,45 @@ int main(int argc, char *argv[])
     ubase_assert(upipe_ts_sync_get_sync(upipe_ts_sync, &sync));
     assert(sync == 4);
 
+    nb_packets++;
+    upipe_release(upipe_ts_sync);
+    assert(!nb_packets);
+
+    /* vector mode */
+    upipe_ts_sync = upipe_void_alloc(upipe_ts_sync_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "ts sync vector"));
+    assert(upipe_ts_sync != NULL);
+    uref = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(uref != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_sync, uref));
+    ubase_assert(upipe_set_output(upipe_ts_sync, upipe_sink));
+    uref_free(uref);
+
+    unsigned int vector;
+    ubase_assert(upipe_ts_sync_get_vector(upipe_ts_sync, &vector));
+    assert(vector == 1);
+    ubase_nassert(upipe_ts_sync_set_vector(upipe_ts_sync, 0));
+    ubase_assert(upipe_ts_sync_set_vector(upipe_ts_sync, 8));
+    ubase_assert(upipe_ts_sync_get_vector(upipe_ts_sync, &vector));
+    assert(vector == 8);
+    ubase_nassert(upipe_set_output_size(upipe_ts_sync, 204));
+    max_vector = 8;
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 10 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 10 * TS_SIZE);
+    for (int i = 0; i < 10; i++)
+        ts_pad(buffer + i * TS_SIZE);
+    uref_block_unmap(uref, 0);
+    /* the last packet is held until the next sync word is seen */
+    nb_packets += 9;
+    upipe_input(upipe_ts_sync, uref, NULL);
+    assert(!nb_packets);
+    assert(last_vector == 1);
+
     nb_packets++;
     upipe_release(upipe_ts_sync);
     assert(!nb_packets);
@@ -31,6 +31,7 @@
 #include "upipe/uref.h"
 #include "upipe/uref_block.h"
 #include "upipe/uref_block_flow.h"
+#include "upipe/uref_clock.h"
 #include "upipe/uref_std.h"
 #include "upipe/upump.h"
 #include "upump-ev/upump_ev.h"
@@ -46,6 +47,9 @@
 #include <assert.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
 
 #define UDICT_POOL_DEPTH 0
 #define UREF_POOL_DEPTH 0
@@ -74,6 +78,7 @@ int sockfd;
 struct ubuf_mgr *ubuf_mgr;
 struct uref_mgr *uref_mgr;
 struct upump *write_pump;
+struct uclock *uclock;
 struct addrinfo hints, *servinfo, *p;
 struct upipe *upipe_udpsrc;
 struct upipe *upipe_udpsink;
@@ -129,6 +134,10 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     struct udpsrc_test *udpsrc_test = udpsrc_test_from_upipe(upipe);
     assert(uref != NULL);
 
+    uint64_t cr_sys;
+    ubase_assert(uref_clock_get_cr_sys(uref, &cr_sys));
+    assert(cr_sys <= uclock_now(uclock));
+
     if ((rbuf = uref_block_peek(uref, 0, -1, buf))) {
         upipe_dbg_va(upipe, "Received string: %s", rbuf);
         snprintf((char *)str, sizeof(str), FORMAT, udpsrc_test->counter);
@@ -220,6 +229,7 @@ static void genpackets2(struct upump *upump)
         memset(buf, 0, size);
         snprintf((char *)buf, BUF_SIZE, FORMAT, counter);
         uref_block_unmap(uref, 0);
+        uref_clock_set_cr_sys(uref, uclock_now(uclock) + UCLOCK_FREQ / 100);
         counter++;
         upipe_input(upipe_udpsink, uref, NULL);
     }
@@ -228,6 +238,7 @@ static void genpackets2(struct upump *upump)
 int main(int argc, char *argv[])
 {
     char udp_uri[512], port_str[8];
+    unsigned int batch;
     int i, port;
     bool ret;
 
@@ -245,7 +256,7 @@ int main(int argc, char *argv[])
     struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
             UPUMP_BLOCKER_POOL);
     assert(upump_mgr != NULL);
-    struct uclock *uclock = uclock_std_alloc(0);
+    uclock = uclock_std_alloc(0);
     assert(uclock != NULL);
     struct uprobe uprobe;
     uprobe_init(&uprobe, catch, NULL);
@@ -327,6 +338,11 @@ int main(int argc, char *argv[])
     assert(upipe_udpsink != NULL);
     ubase_assert(upipe_set_flow_def(upipe_udpsink, flow_def));
     uref_free(flow_def);
+    ubase_assert(upipe_attach_uclock(upipe_udpsink));
+    ubase_assert(upipe_udpsink_set_batch(upipe_udpsink, 8));
+    ubase_assert(upipe_udpsink_get_batch(upipe_udpsink, &batch));
+    assert(batch == 8);
+    upipe_udpsink_set_gso(upipe_udpsink, true);
 
     /* reset source uri */
     for (i=0; i < 10; i++) {
@@ -338,8 +354,36 @@ int main(int argc, char *argv[])
         }
     }
     assert(ret);
+    ubase_assert(upipe_udpsrc_set_batch(upipe_udpsrc, 8));
+    ubase_assert(upipe_udpsrc_set_timestamp(upipe_udpsrc,
+                                            UPIPE_UDPSRC_TIMESTAMP_SOFTWARE));
+    ubase_assert(upipe_udpsrc_get_batch(upipe_udpsrc, &batch));
+    assert(batch == 8);
     ubase_assert(upipe_set_uri(upipe_udpsink, udp_uri+1));
 
+#ifdef SO_TXTIME
+    /* SO_TXTIME is set on the open socket */
+    if (ubase_check(upipe_udpsink_set_txtime(upipe_udpsink, CLOCK_MONOTONIC))) {
+        int fd;
+        struct sock_txtime sock_txtime;
+        socklen_t len = sizeof(sock_txtime);
+        ubase_assert(upipe_udpsink_get_fd(upipe_udpsink, &fd));
+        assert(getsockopt(fd, SOL_SOCKET, SO_TXTIME, &sock_txtime,
+                          &len) == 0);
+        assert(sock_txtime.clockid == CLOCK_MONOTONIC);
+        assert(sock_txtime.flags == SOF_TXTIME_REPORT_ERRORS);
+        uint64_t dropped;
+        ubase_assert(upipe_udpsink_get_txtime_dropped(upipe_udpsink, &dropped));
+        assert(dropped == 0);
+
+        ubase_assert(upipe_udpsink_set_txtime(upipe_udpsink, -1));
+        len = sizeof(sock_txtime);
+        assert(getsockopt(fd, SOL_SOCKET, SO_TXTIME, &sock_txtime,
+                          &len) == 0);
+        assert(sock_txtime.flags == 0);
+    }
+#endif
+
     /* redefine write pump */
     write_pump = upump_alloc_idler(upump_mgr, genpackets2, NULL, NULL);
     assert(write_pump);
@@ -348,6 +392,8 @@ int main(int argc, char *argv[])
     /* fire again */
     upump_mgr_run(upump_mgr, NULL);
 
+    assert(udpsrc_test_from_upipe(udpsrc_test)->counter == 210);
+
     /* release */
     upump_free(write_pump);
     upipe_release(upipe_udpsrc);
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/** @file
+ * @short unit tests for AF_XDP source and sink pipes
+ *
+ * The sink and the source are bound to the two ends of a veth pair, given
+ * on the command line (see upipe_xdp_test.sh). Half of the packets are
+ * allocated with the ubuf manager provided by the sink, and sent without
+ * copy. The test is skipped if AF_XDP sockets are not available.
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/uprobe_prefix.h"
+#include "upipe/uprobe_uref_mgr.h"
+#include "upipe/uprobe_upump_mgr.h"
+#include "upipe/uprobe_uclock.h"
+#include "upipe/uprobe_ubuf_mem.h"
+#include "upipe/uclock.h"
+#include "upipe/uclock_std.h"
+#include "upipe/umem.h"
+#include "upipe/umem_alloc.h"
+#include "upipe/udict.h"
+#include "upipe/udict_inline.h"
+#include "upipe/ubuf.h"
+#include "upipe/ubuf_block_mem.h"
+#include "upipe/uref.h"
+#include "upipe/uref_block.h"
+#include "upipe/uref_block_flow.h"
+#include "upipe/uref_std.h"
+#include "upipe/urequest.h"
+#include "upipe/upump.h"
+#include "upump-ev/upump_ev.h"
+#include "upipe/upipe.h"
+#include "upipe/upipe_helper_upipe.h"
+#include "upipe-xdp/ubuf_block_xdp.h"
+#include "upipe-xdp/upipe_xdp_source.h"
+#include "upipe-xdp/upipe_xdp_sink.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define BUF_SIZE 1316
+#define NB_PACKETS 100
+#define TIMEOUT (UCLOCK_FREQ * 5)
+#define FORMAT "This is packet number %d"
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct ubuf_mgr *xdp_mgr = NULL;
+static struct upipe *upipe_xdp_source;
+static struct upipe *upipe_xdp_sink;
+static struct upump *write_pump;
+static struct upump *timeout_pump;
+static int counter = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+struct xdp_test {
+    int counter;
+    struct uref *urefs[NB_PACKETS];
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+UPIPE_HELPER_UPIPE(xdp_test, upipe, 0);
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct xdp_test *xdp_test = malloc(sizeof(struct xdp_test));
+    assert(xdp_test != NULL);
+    xdp_test->counter = 0;
+    upipe_init(&xdp_test->upipe, mgr, uprobe);
+    upipe_throw_ready(&xdp_test->upipe);
+    return &xdp_test->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct xdp_test *xdp_test = xdp_test_from_upipe(upipe);
+    assert(xdp_test->counter < NB_PACKETS);
+
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size == BUF_SIZE);
+
+    /* received packets are not copied */
+    uint64_t addr;
+    ubase_assert(ubuf_block_xdp_get_addr(uref->ubuf, &addr));
+
+    /* keep all packets, so that received frames are held */
+    xdp_test->urefs[xdp_test->counter++] = uref;
+    if (xdp_test->counter == NB_PACKETS) {
+        ubase_assert(upipe_set_uri(upipe_xdp_source, NULL));
+        upump_stop(timeout_pump);
+    }
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    struct xdp_test *xdp_test = xdp_test_from_upipe(upipe);
+    assert(xdp_test->counter == NB_PACKETS);
+
+    for (int i = 0; i < NB_PACKETS; i++) {
+        uint8_t buf[BUF_SIZE], str[BUF_SIZE];
+        const uint8_t *rbuf = uref_block_peek(xdp_test->urefs[i], 0,
+                                              BUF_SIZE, buf);
+        assert(rbuf != NULL);
+        memset(str, 0, sizeof(str));
+        snprintf((char *)str, sizeof(str), FORMAT, i);
+        assert(!memcmp(str, rbuf, BUF_SIZE));
+        uref_block_peek_unmap(xdp_test->urefs[i], 0, buf, rbuf);
+        uref_free(xdp_test->urefs[i]);
+    }
+
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(xdp_test);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr xdp_test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** receives the ubuf manager provided by the sink */
+static int provide_ubuf_mgr(struct urequest *urequest, va_list args)
+{
+    struct ubuf_mgr *mgr = va_arg(args, struct ubuf_mgr *);
+    struct uref *flow_format = va_arg(args, struct uref *);
+    uref_free(flow_format);
+    ubuf_mgr_release(xdp_mgr);
+    xdp_mgr = mgr;
+    return UBASE_ERR_NONE;
+}
+
+/* packet generator */
+static void genpackets(struct upump *upump)
+{
+    for (int i = 0; i < 10 && counter < NB_PACKETS; i++) {
+        struct uref *uref = uref_block_alloc(uref_mgr,
+                counter % 2 ? ubuf_mgr : xdp_mgr, BUF_SIZE);
+        assert(uref != NULL);
+        uint8_t *buf;
+        int size = -1;
+        ubase_assert(uref_block_write(uref, 0, &size, &buf));
+        assert(size == BUF_SIZE);
+        memset(buf, 0, size);
+        snprintf((char *)buf, BUF_SIZE, FORMAT, counter);
+        uref_block_unmap(uref, 0);
+        counter++;
+        upipe_input(upipe_xdp_sink, uref, NULL);
+    }
+    if (counter == NB_PACKETS)
+        upump_stop(upump);
+}
+
+/* stops the test if packets are lost */
+static void timeout(struct upump *upump)
+{
+    fprintf(stderr, "timeout, %d packets received\n",
+            xdp_test_from_upipe(upump_get_opaque(upump, struct upipe *))
+                ->counter);
+    abort();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        printf("usage: %s <sink interface> <source interface>\n", argv[0]);
+        return 0;
+    }
+    int fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (fd < 0) {
+        printf("AF_XDP is not available, skipping\n");
+        return 0;
+    }
+    close(fd);
+
+    /* env */
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    struct uclock *uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    struct upipe *xdp_test = upipe_void_alloc(&xdp_test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "xdp_test"));
+    assert(xdp_test != NULL);
+
+    struct upipe_mgr *upipe_xdp_source_mgr = upipe_xdp_source_mgr_alloc();
+    assert(upipe_xdp_source_mgr != NULL);
+    upipe_xdp_source = upipe_void_alloc(upipe_xdp_source_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "xdp source"));
+    assert(upipe_xdp_source != NULL);
+    ubase_assert(upipe_set_output(upipe_xdp_source, xdp_test));
+    ubase_assert(upipe_attach_uclock(upipe_xdp_source));
+    ubase_assert(upipe_set_uri(upipe_xdp_source, argv[2]));
+
+    struct upipe_mgr *upipe_xdp_sink_mgr = upipe_xdp_sink_mgr_alloc();
+    assert(upipe_xdp_sink_mgr != NULL);
+    upipe_xdp_sink = upipe_void_alloc(upipe_xdp_sink_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "xdp sink"));
+    assert(upipe_xdp_sink != NULL);
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_xdp_sink, flow_def));
+    ubase_assert(upipe_xdp_sink_set_udp(upipe_xdp_sink,
+                                        "10.0.0.1:1000", "10.0.0.2:5000",
+                                        NULL, NULL));
+    ubase_assert(upipe_set_uri(upipe_xdp_sink, argv[1]));
+
+    struct urequest request;
+    urequest_init_ubuf_mgr(&request, flow_def, provide_ubuf_mgr, NULL);
+    ubase_assert(upipe_register_request(upipe_xdp_sink, &request));
+    assert(xdp_mgr != NULL);
+    ubase_assert(upipe_unregister_request(upipe_xdp_sink, &request));
+    urequest_clean(&request);
+
+    write_pump = upump_alloc_idler(upump_mgr, genpackets, NULL, NULL);
+    assert(write_pump != NULL);
+    upump_start(write_pump);
+    timeout_pump = upump_alloc_timer(upump_mgr, timeout, xdp_test, NULL,
+                                     TIMEOUT, 0);
+    assert(timeout_pump != NULL);
+    upump_start(timeout_pump);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(counter == NB_PACKETS);
+    assert(xdp_test_from_upipe(xdp_test)->counter == NB_PACKETS);
+
+    /* release */
+    upump_free(timeout_pump);
+    upump_free(write_pump);
+    ubuf_mgr_release(xdp_mgr);
+    upipe_release(upipe_xdp_sink);
+    upipe_release(upipe_xdp_source);
+    test_free(xdp_test);
+    upipe_mgr_release(upipe_xdp_source_mgr); /* nop */
+    upipe_mgr_release(upipe_xdp_sink_mgr); /* nop */
+    upump_mgr_release(upump_mgr);
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
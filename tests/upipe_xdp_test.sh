@@ -0,0 +1,18 @@
+#!/bin/sh
+
+srcdir="$1"
+
+# the test runs in a new network namespace, with a veth pair
+if ! unshare -n true 2>/dev/null || ! which ip >/dev/null 2>&1; then
+    echo "network namespaces are not available, skipping"
+    exit 0
+fi
+
+exec unshare -n sh -c '
+    if ! ip link add xdp0 type veth peer name xdp1 2>/dev/null; then
+        echo "veth interfaces are not available, skipping"
+        exit 0
+    fi
+    ip link set xdp0 up && ip link set xdp1 up || exit 1
+    exec "$1"/valgrind_wrapper.sh "$1" ./upipe_xdp_test xdp0 xdp1
+' sh "$srcdir"
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short common unit tests for pools of worker threads
+ */
+
+#undef NDEBUG
+
+#include "upipe/ubase.h"
+#include "upipe/uclock.h"
+#include "upipe/uprobe.h"
+#include "upipe/uprobe_stdio.h"
+#include "upipe/upipe.h"
+#include "upipe/upump.h"
+#include "upipe-modules/upipe_transfer.h"
+#include "upipe-pthread/upipe_pthread_transfer.h"
+#include "upipe-pthread/uprobe_pthread_upump_mgr.h"
+#include "upipe-pthread/upump_pthread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <assert.h>
+
+#include "upump_pthread_pool_common_test.h"
+
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+#define XFER_QUEUE 255
+#define XFER_POOL 1
+#define NB_THREADS 3
+#define NB_LANES 16
+#define NB_LOOPS 1000
+#define NB_TICKS 3
+
+/** @This describes the pipeline run by a lane. */
+struct lane {
+    /** upump manager of the lane */
+    struct upump_mgr *upump_mgr;
+    /** pipe between the idler and the read watcher */
+    int pipefd[2];
+    /** idler writing to the pipe */
+    struct upump *idler;
+    /** watcher reading from the pipe */
+    struct upump *reader;
+    /** repeated timer */
+    struct upump *timer;
+    /** true while a callback is running (atomic) */
+    bool busy;
+    /** number of bytes written */
+    unsigned int written;
+    /** number of bytes read */
+    unsigned int read;
+    /** number of timer events */
+    unsigned int ticks;
+};
+
+static struct lane lanes[NB_LANES];
+/** number of lanes which completed (atomic) */
+static unsigned int done = 0;
+/** probe providing the upump manager of the current thread */
+static struct uprobe *uprobe_main;
+
+/** @This checks that the callbacks of a lane run one at a time, in a worker
+ * thread, and with the upump manager of the lane provided by the probe. */
+static void enter(struct lane *lane)
+{
+    assert(!__atomic_exchange_n(&lane->busy, true, __ATOMIC_ACQUIRE));
+
+    struct upump_mgr *upump_mgr = NULL;
+    uprobe_throw(uprobe_main, NULL, UPROBE_NEED_UPUMP_MGR, &upump_mgr);
+    assert(upump_mgr == lane->upump_mgr);
+    upump_mgr_release(upump_mgr);
+}
+
+/** @This stops the pipeline of a lane once all counts are reached. */
+static void leave(struct lane *lane)
+{
+    if (lane->written >= NB_LOOPS && lane->read == lane->written &&
+        lane->ticks >= NB_TICKS) {
+        upump_free(lane->idler);
+        upump_free(lane->reader);
+        upump_free(lane->timer);
+        close(lane->pipefd[0]);
+        close(lane->pipefd[1]);
+        __atomic_add_fetch(&done, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&lane->busy, false, __ATOMIC_RELEASE);
+        upump_mgr_release(lane->upump_mgr);
+        return;
+    }
+    __atomic_store_n(&lane->busy, false, __ATOMIC_RELEASE);
+}
+
+static void idler_cb(struct upump *upump)
+{
+    struct lane *lane = upump_get_opaque(upump, struct lane *);
+    enter(lane);
+    char c = 0;
+    if (write(lane->pipefd[1], &c, 1) == 1 && ++lane->written >= NB_LOOPS)
+        upump_stop(upump);
+    leave(lane);
+}
+
+static void reader_cb(struct upump *upump)
+{
+    struct lane *lane = upump_get_opaque(upump, struct lane *);
+    enter(lane);
+    char buffer[64];
+    ssize_t ret = read(lane->pipefd[0], buffer, sizeof(buffer));
+    assert(ret > 0);
+    lane->read += ret;
+    leave(lane);
+}
+
+static void timer_cb(struct upump *upump)
+{
+    struct lane *lane = upump_get_opaque(upump, struct lane *);
+    enter(lane);
+    lane->ticks++;
+    leave(lane);
+}
+
+/** @This sets up the pipeline of a lane, from the lane itself. */
+static void setup_cb(struct upump *upump)
+{
+    struct lane *lane = upump_get_opaque(upump, struct lane *);
+    enter(lane);
+    upump_free(upump);
+
+    assert(pipe(lane->pipefd) != -1);
+    assert(fcntl(lane->pipefd[1], F_SETFL, O_NONBLOCK) != -1);
+    lane->idler = upump_alloc_idler(lane->upump_mgr, idler_cb, lane, NULL);
+    assert(lane->idler != NULL);
+    lane->reader = upump_alloc_fd_read(lane->upump_mgr, reader_cb, lane, NULL,
+                                       lane->pipefd[0]);
+    assert(lane->reader != NULL);
+    lane->timer = upump_alloc_timer(lane->upump_mgr, timer_cb, lane, NULL,
+                                    UCLOCK_FREQ / 1000, UCLOCK_FREQ / 1000);
+    assert(lane->timer != NULL);
+    upump_start(lane->idler);
+    upump_start(lane->reader);
+    upump_start(lane->timer);
+    leave(lane);
+}
+
+void run_pool(struct upump_mgr *upump_mgr, upump_mgr_alloc upump_mgr_alloc)
+{
+    struct uprobe *logger = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    uprobe_main = uprobe_pthread_upump_mgr_alloc(logger);
+    assert(uprobe_main != NULL);
+    ubase_assert(uprobe_pthread_upump_mgr_set(uprobe_main, upump_mgr));
+
+    /* invalid number of threads */
+    assert(upump_pthread_pool_alloc(0, uprobe_use(uprobe_main),
+                                    upump_mgr_alloc, UPUMP_POOL,
+                                    UPUMP_BLOCKER_POOL) == NULL);
+
+    struct upump_pthread_pool *pool =
+        upump_pthread_pool_alloc(NB_THREADS, uprobe_use(uprobe_main),
+                                 upump_mgr_alloc, UPUMP_POOL,
+                                 UPUMP_BLOCKER_POOL);
+    assert(pool != NULL);
+
+    for (unsigned int i = 0; i < NB_LANES; i++) {
+        struct lane *lane = &lanes[i];
+        lane->upump_mgr = upump_pthread_pool_mgr_alloc(pool, UPUMP_POOL,
+                                                       UPUMP_BLOCKER_POOL);
+        assert(lane->upump_mgr != NULL);
+        assert(lane->upump_mgr->signature == UPUMP_PTHREAD_POOL_SIGNATURE);
+        struct upump *upump = upump_alloc_timer(lane->upump_mgr, setup_cb,
+                                                lane, NULL, 0, 0);
+        assert(upump != NULL);
+        upump_start(upump);
+    }
+
+    /* a manager that was never attached is freed when it is released */
+    struct upipe_mgr *xfer_mgr = upipe_xfer_mgr_alloc(XFER_QUEUE, XFER_POOL,
+                                                      NULL);
+    assert(xfer_mgr != NULL);
+    upipe_mgr_release(xfer_mgr);
+
+    /* the command pump of the manager is detached when it is released */
+    xfer_mgr =
+        upipe_pthread_xfer_mgr_alloc_pool(XFER_QUEUE, XFER_POOL, pool,
+                                          UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(xfer_mgr != NULL);
+    upipe_mgr_release(xfer_mgr);
+
+    /* the workers are joined once all lanes are released */
+    upump_pthread_pool_release(pool);
+    upump_mgr_run(upump_mgr, NULL);
+    assert(done == NB_LANES);
+    for (unsigned int i = 0; i < NB_LANES; i++) {
+        assert(lanes[i].read == lanes[i].written);
+        assert(lanes[i].ticks >= NB_TICKS);
+    }
+
+    uprobe_release(uprobe_main);
+}
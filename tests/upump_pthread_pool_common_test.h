@@ -0,0 +1,10 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _TESTS_UPUMP_PTHREAD_POOL_COMMON_TEST_H_
+#define _TESTS_UPUMP_PTHREAD_POOL_COMMON_TEST_H_
+void run_pool(struct upump_mgr *upump_mgr, upump_mgr_alloc upump_mgr_alloc);
+#endif
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for pools of worker threads (using libev)
+ */
+
+#undef NDEBUG
+
+#include "upipe/upump.h"
+#include "upump-ev/upump_ev.h"
+
+#include <assert.h>
+
+#include "upump_pthread_pool_common_test.h"
+
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+
+int main(int argc, char **argv)
+{
+    struct upump_mgr *upump_mgr =
+        upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    run_pool(upump_mgr, upump_ev_mgr_alloc_loop);
+    upump_mgr_release(upump_mgr);
+    return 0;
+}
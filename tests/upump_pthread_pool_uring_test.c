@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for pools of worker threads (using io_uring)
+ */
+
+#undef NDEBUG
+
+#include "upipe/upump.h"
+#include "upump-uring/upump_uring.h"
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "upump_pthread_pool_common_test.h"
+
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+
+int main(int argc, char **argv)
+{
+    struct upump_mgr *upump_mgr =
+        upump_uring_mgr_alloc(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    if (upump_mgr == NULL) {
+        printf("io_uring is not available, skipping\n");
+        return 0;
+    }
+    run_pool(upump_mgr, upump_uring_mgr_alloc);
+    upump_mgr_release(upump_mgr);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 Open Broadcast Systems Ltd
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for upump manager with io_uring event loop
+ */
+
+#undef NDEBUG
+
+#include "upump-uring/upump_uring.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <assert.h>
+
+#include "upump_common_test.h"
+
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+#define NB_READS 16
+
+static int pipefd[2];
+static uint8_t buffer[64];
+static unsigned int nb_reads = 0;
+
+static void write_idler_cb(struct upump *upump)
+{
+    char str[sizeof(buffer)];
+    snprintf(str, sizeof(str), "read %u", nb_reads);
+    assert(write(pipefd[1], str, strlen(str) + 1) == strlen(str) + 1);
+    upump_stop(upump);
+}
+
+static void read_cb(struct upump *upump)
+{
+    struct upump *write_idler = upump_get_opaque(upump, struct upump *);
+    ssize_t ret;
+    ubase_assert(upump_uring_get_result(upump, &ret));
+
+    char str[sizeof(buffer)];
+    snprintf(str, sizeof(str), "read %u", nb_reads);
+    assert(ret == strlen(str) + 1);
+    assert(!strcmp((const char *)buffer, str));
+    memset(buffer, 0, sizeof(buffer));
+
+    if (++nb_reads == NB_READS) {
+        upump_stop(upump);
+        return;
+    }
+    ubase_assert(upump_uring_set_buffer(upump, buffer, sizeof(buffer),
+                                        (uint64_t)-1));
+    upump_start(write_idler);
+}
+
+static void run_read(struct upump_mgr *mgr)
+{
+    assert(pipe(pipefd) != -1);
+    /* the pump must wait for the descriptor to become readable */
+    assert(fcntl(pipefd[0], F_SETFL, O_NONBLOCK) != -1);
+
+    struct upump *write_idler = upump_alloc_idler(mgr, write_idler_cb, NULL,
+                                                  NULL);
+    assert(write_idler != NULL);
+    struct upump *reader = upump_uring_alloc_read(mgr, read_cb, write_idler,
+                                                  NULL, pipefd[0]);
+    assert(reader != NULL);
+    ubase_assert(upump_uring_set_buffer(reader, buffer, sizeof(buffer),
+                                        (uint64_t)-1));
+    upump_start(reader);
+    upump_start(write_idler);
+    ubase_assert(upump_mgr_run(mgr, NULL));
+    assert(nb_reads == NB_READS);
+
+    /* a stopped pump no longer reads */
+    ubase_assert(upump_uring_set_buffer(reader, buffer, sizeof(buffer),
+                                        (uint64_t)-1));
+    upump_start(reader);
+    upump_stop(reader);
+    assert(write(pipefd[1], "x", 1) == 1);
+    upump_free(reader);
+    upump_free(write_idler);
+    char c;
+    assert(read(pipefd[0], &c, 1) == 1);
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+}
+
+int main(int argc, char **argv)
+{
+    struct upump_mgr *mgr = upump_uring_mgr_alloc(UPUMP_POOL,
+                                                  UPUMP_BLOCKER_POOL);
+    if (mgr == NULL) {
+        printf("io_uring is not available, skipping\n");
+        return 0;
+    }
+    run_read(mgr);
+    run(mgr);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for uqueues in single-producer single-consumer mode
+ * (using libev)
+ */
+
+#undef NDEBUG
+
+#include "upipe/ubase.h"
+#include "upipe/uqueue.h"
+#include "upipe/upump.h"
+#include "upipe/upump_blocker.h"
+#include "upump-ev/upump_ev.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define UQUEUE_MAX_DEPTH 6
+#define UQUEUE_BATCH 4
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+#define NB_LOOPS 100000
+
+static struct uqueue uqueue;
+static unsigned int nb_loops = NB_LOOPS;
+/** next element to push, starting at 1 as elements may not be NULL */
+static uintptr_t pushed;
+/** next element expected to be popped */
+static uintptr_t popped;
+static struct upump_blocker *blocker;
+static struct upump *upump_push;
+
+static void push_ready(struct upump *upump)
+{
+    upump_blocker_free(blocker);
+    blocker = NULL;
+    upump_stop(upump_push);
+}
+
+static void push(struct upump *upump)
+{
+    /* sleep from time to time, so that the consumer goes to sleep */
+    if (unlikely(!(pushed % 1000))) {
+        struct timespec timeout = { .tv_sec = 0, .tv_nsec = 100000 };
+        assert(!nanosleep(&timeout, NULL));
+    }
+
+    if (unlikely(!uqueue_push(&uqueue, (void *)pushed))) {
+        blocker = upump_blocker_alloc(upump, NULL, NULL);
+        upump_start(upump_push);
+    } else if (unlikely(pushed++ >= nb_loops))
+        upump_stop(upump);
+}
+
+static void *push_thread(void *unused)
+{
+    struct upump_mgr *upump_mgr =
+        upump_ev_mgr_alloc_loop(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+
+    upump_push = uqueue_upump_alloc_push(&uqueue, upump_mgr, push_ready, NULL,
+                                         NULL);
+    assert(upump_push != NULL);
+
+    struct upump *upump = upump_alloc_idler(upump_mgr, push, NULL, NULL);
+    assert(upump != NULL);
+    upump_start(upump);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    upump_free(upump);
+    upump_free(upump_push);
+    upump_mgr_release(upump_mgr);
+    return NULL;
+}
+
+static void pop(struct upump *upump)
+{
+    void *elements[UQUEUE_BATCH];
+    unsigned int nb = uqueue_pop_batch(&uqueue, elements, UQUEUE_BATCH);
+    assert(nb <= UQUEUE_BATCH);
+    for (unsigned int i = 0; i < nb; i++)
+        assert((uintptr_t)elements[i] == popped++);
+    assert(uqueue_length(&uqueue) <= UQUEUE_MAX_DEPTH);
+    if (unlikely(popped > nb_loops))
+        upump_stop(upump);
+}
+
+static void run(unsigned int spin)
+{
+    uint8_t *buffer = malloc(uqueue_spsc_sizeof(UQUEUE_MAX_DEPTH));
+    assert(buffer != NULL);
+    assert(uqueue_init_spsc(&uqueue, UQUEUE_MAX_DEPTH, spin, buffer));
+    assert(uqueue_length(&uqueue) == 0);
+    pushed = popped = 1;
+
+    struct ev_loop *loop = ev_default_loop(0);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc(loop, UPUMP_POOL,
+                                                     UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    struct upump *upump = uqueue_upump_alloc_pop(&uqueue, upump_mgr, pop, NULL,
+                                                 NULL);
+    assert(upump != NULL);
+
+    pthread_t id;
+    assert(pthread_create(&id, NULL, push_thread, NULL) == 0);
+
+    upump_start(upump);
+    ev_loop(loop, 0);
+
+    assert(!pthread_join(id, NULL));
+    assert(popped == nb_loops + 1);
+    assert(uqueue_pop(&uqueue, void *) == NULL);
+
+    upump_free(upump);
+    upump_mgr_release(upump_mgr);
+    ev_default_destroy();
+
+    uqueue_clean(&uqueue);
+    free(buffer);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        nb_loops = atoi(argv[1]);
+
+    /* size and invalid lengths */
+    assert(uqueue_spsc_sizeof(5) < uqueue_spsc_sizeof(9));
+    uint8_t *buffer = malloc(uqueue_spsc_sizeof(1));
+    assert(buffer != NULL);
+    assert(!uqueue_init_spsc(&uqueue, 0, 0, buffer));
+    assert(!uqueue_init_spsc(&uqueue, (UINT32_C(1) << 31) + 1, 0, buffer));
+
+    /* single thread, full queue */
+    assert(uqueue_init_spsc(&uqueue, 1, 0, buffer));
+    assert(uqueue_push(&uqueue, (void *)1));
+    assert(!uqueue_push(&uqueue, (void *)2));
+    assert(uqueue_length(&uqueue) == 1);
+    assert(uqueue_pop(&uqueue, void *) == (void *)1);
+    assert(uqueue_push(&uqueue, (void *)2));
+    assert(uqueue_pop(&uqueue, void *) == (void *)2);
+    assert(uqueue_pop(&uqueue, void *) == NULL);
+    uqueue_clean(&uqueue);
+    free(buffer);
+
+    /* two threads, sleeping consumer, then busy-polling consumer */
+    run(0);
+    run(10000);
+    return 0;
+}
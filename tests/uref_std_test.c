@@ -18,8 +18,10 @@
 #include "upipe/udict_inline.h"
 #include "upipe/uref.h"
 #include "upipe/uref_std.h"
+#include "upipe/upool.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #define UDICT_POOL_DEPTH 1
@@ -53,6 +55,13 @@ int main(int argc, char **argv)
     assert(uref1 != NULL);
     uref_free(uref1);
 
+    struct upool_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    ubase_assert(uref_mgr_get_stats(mgr, &stats));
+    assert(stats.hits == 2);
+    assert(stats.misses == 2);
+    assert(stats.cross_frees == 0);
+
     uref_mgr_release(mgr);
     udict_mgr_release(udict_mgr);
     umem_mgr_release(umem_mgr);
@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2026 EasyTools
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file
+ * @short unit tests for the per-thread rings of the trace backend
+ *
+ * Several threads trace control commands carrying their index and a counter,
+ * while the main thread dumps the rings from a signal handler. Every dump is
+ * parsed back: the events must be whole, and the counters of each thread
+ * must be increasing. Once the threads are done, the rings must have
+ * wrapped, and only the last events must be left.
+ */
+
+#undef NDEBUG
+
+#include "upipe/uprobe.h"
+#include "upipe/upipe.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <signal.h>
+#include <pthread.h>
+
+#define NB_THREADS 4
+#define NB_EVENTS 20000
+/** number of records per thread ring */
+#define NB_RECORDS 64
+/** key of the traced options */
+#define OPTION_KEY "utrace_ring_test"
+/** padding making each event span several records */
+#define OPTION_PADDING 160
+
+/* layout of the dump, from utrace.c */
+#define UTRACE_RING_MAGIC "UTRACER1"
+#define UTRACE_RECORD_SIZE 128
+#define UTRACE_RECORD_FIRST 0x1
+#define UTRACE_RECORD_LAST 0x2
+#define UTRACE_UPIPE_CONTROL_ENTER 9
+
+struct utrace_record {
+    uint64_t seq;
+    uint64_t tsc;
+    uint16_t size;
+    uint16_t flags;
+    uint32_t reserved;
+    uint8_t data[UTRACE_RECORD_SIZE - 24];
+};
+
+/** results of the parsing of a dump */
+struct dump {
+    /** number of thread rings */
+    unsigned int nb_rings;
+    /** number of records of each test thread */
+    unsigned int nb_records[NB_THREADS];
+    /** number of whole events of each test thread */
+    unsigned int nb_events[NB_THREADS];
+    /** first and last counters of each test thread */
+    unsigned int first[NB_THREADS];
+    unsigned int last[NB_THREADS];
+};
+
+static const char *dump_path;
+static pthread_barrier_t barrier;
+static unsigned int nb_done = 0;
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    assert(command == UPIPE_SET_OPTION);
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = NULL,
+    .upipe_control = test_control
+};
+
+/** traces events from a thread, then waits for the last dump */
+static void *thread_trace(void *arg)
+{
+    unsigned int thread = (uintptr_t)arg;
+    struct upipe *upipe = upipe_void_alloc(&test_mgr, NULL);
+    assert(upipe != NULL);
+
+    char value[32 + OPTION_PADDING + 1];
+    pthread_barrier_wait(&barrier);
+    for (unsigned int i = 0; i < NB_EVENTS; i++) {
+        int len = snprintf(value, 32, "%u %u ", thread, i);
+        memset(value + len, 'a' + thread, OPTION_PADDING);
+        value[len + OPTION_PADDING] = '\0';
+        ubase_assert(upipe_set_option(upipe, OPTION_KEY, value));
+    }
+    __atomic_fetch_add(&nb_done, 1, __ATOMIC_RELEASE);
+
+    /* keep the ring of the thread until it is dumped */
+    pthread_barrier_wait(&barrier);
+    pthread_barrier_wait(&barrier);
+    test_free(upipe);
+    return NULL;
+}
+
+/** reads an unsigned LEB128 integer */
+static uint64_t read_uint(const uint8_t **p_p, const uint8_t *end)
+{
+    uint64_t val = 0;
+    for (unsigned int shift = 0; ; shift += 7) {
+        assert(*p_p < end && shift < 64);
+        uint8_t c = *(*p_p)++;
+        val |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return val;
+    }
+}
+
+/** reads a zigzag-encoded integer */
+static int64_t read_int(const uint8_t **p_p, const uint8_t *end)
+{
+    uint64_t val = read_uint(p_p, end);
+    return (val >> 1) ^ -(int64_t)(val & 1);
+}
+
+/** reads a string, and returns its length */
+static int64_t read_str(const uint8_t **p_p, const uint8_t *end,
+                        const char **str_p)
+{
+    int64_t len = read_int(p_p, end);
+    assert(len >= 0 && len <= end - *p_p);
+    *str_p = (const char *)*p_p;
+    *p_p += len;
+    return len;
+}
+
+/** checks a whole event of a thread ring, and returns the index of the test
+ * thread which traced it, or -1 if it is not one of our options */
+static int parse_event(struct dump *dump, const uint8_t *p, const uint8_t *end)
+{
+    if (read_uint(&p, end) != UTRACE_UPIPE_CONTROL_ENTER)
+        return -1;
+    read_uint(&p, end);
+    if (read_int(&p, end) != UPIPE_SET_OPTION)
+        return -1;
+    const char *str;
+    int64_t len = read_str(&p, end, &str);
+    if (len != strlen(OPTION_KEY) || memcmp(str, OPTION_KEY, len))
+        return -1;
+    len = read_str(&p, end, &str);
+    assert(p == end);
+
+    char value[32 + OPTION_PADDING + 1];
+    assert(len < sizeof(value));
+    memcpy(value, str, len);
+    value[len] = '\0';
+    unsigned int thread, i;
+    int prefix;
+    assert(sscanf(value, "%u %u %n", &thread, &i, &prefix) == 2);
+    assert(thread < NB_THREADS && i < NB_EVENTS);
+    assert(len == prefix + OPTION_PADDING);
+    for (int j = prefix; j < len; j++)
+        assert(value[j] == 'a' + thread);
+
+    if (dump->nb_events[thread]++)
+        assert(i > dump->last[thread]);
+    else
+        dump->first[thread] = i;
+    dump->last[thread] = i;
+    return thread;
+}
+
+/** parses a dump of the thread rings */
+static void parse_dump(struct dump *dump)
+{
+    memset(dump, 0, sizeof(*dump));
+
+    FILE *f = fopen(dump_path, "r");
+    assert(f != NULL);
+    assert(!fseek(f, 0, SEEK_END));
+    long dump_size = ftell(f);
+    assert(dump_size > 0);
+    rewind(f);
+    uint8_t *buffer = malloc(dump_size);
+    assert(buffer != NULL);
+    assert(fread(buffer, dump_size, 1, f) == 1);
+    fclose(f);
+
+    const uint8_t *p = buffer, *end = buffer + dump_size;
+    assert(end - p >= 8 && !memcmp(p, UTRACE_RING_MAGIC, 8));
+    p += 8;
+
+    /* modules list */
+    while (read_uint(&p, end)) {
+        const char *name;
+        read_str(&p, end, &name);
+    }
+
+    uint64_t clock[4];
+    assert(end - p >= sizeof(clock));
+    memcpy(clock, p, sizeof(clock));
+    p += sizeof(clock);
+    assert(clock[2] >= clock[0] && clock[3] >= clock[1]);
+
+    while (p < end) {
+        uint8_t event[4 * UTRACE_RECORD_SIZE];
+        size_t size = 0;
+        bool in_event = false;
+        uint64_t prev = 0;
+        int thread = -1;
+        unsigned int nb_records = 0;
+        struct utrace_record record;
+
+        /* thread ID */
+        assert(end - p >= sizeof(uint64_t));
+        p += sizeof(uint64_t);
+        dump->nb_rings++;
+
+        for ( ; ; ) {
+            assert(end - p >= sizeof(record));
+            memcpy(&record, p, sizeof(record));
+            p += sizeof(record);
+            if (!record.seq)
+                break;
+            assert(record.seq > prev);
+            assert(record.size <= sizeof(record.data));
+            nb_records++;
+
+            if (record.flags & UTRACE_RECORD_FIRST) {
+                in_event = true;
+                size = 0;
+            } else if (in_event && record.seq != prev + 1) {
+                /* records were overwritten during the dump */
+                in_event = false;
+            }
+            prev = record.seq;
+            if (!in_event)
+                continue;
+
+            assert(size + record.size <= sizeof(event));
+            memcpy(event + size, record.data, record.size);
+            size += record.size;
+            if (record.flags & UTRACE_RECORD_LAST) {
+                int ret = parse_event(dump, event, event + size);
+                if (ret != -1) {
+                    /* a ring only holds the events of its thread */
+                    assert(thread == -1 || thread == ret);
+                    thread = ret;
+                }
+                in_event = false;
+            }
+        }
+
+        assert(nb_records <= NB_RECORDS);
+        if (thread != -1)
+            dump->nb_records[thread] = nb_records;
+    }
+    free(buffer);
+}
+
+int main(int argc, char **argv)
+{
+    assert(argc == 2);
+    dump_path = argv[1];
+
+    /* tracing is set up on the first event */
+    char signal_str[16];
+    snprintf(signal_str, sizeof(signal_str), "%d", SIGUSR1);
+    assert(!setenv("UTRACE_RING", dump_path, 1));
+    assert(!setenv("UTRACE_RING_RECORDS", "64", 1));
+    assert(!setenv("UTRACE_RING_SIGNAL", signal_str, 1));
+
+    struct upipe *upipe = upipe_void_alloc(&test_mgr, NULL);
+    assert(upipe != NULL);
+    ubase_assert(upipe_set_option(upipe, "utrace", "main"));
+
+    pthread_t threads[NB_THREADS];
+    assert(!pthread_barrier_init(&barrier, NULL, NB_THREADS + 1));
+    for (unsigned int i = 0; i < NB_THREADS; i++)
+        assert(!pthread_create(&threads[i], NULL, thread_trace,
+                               (void *)(uintptr_t)i));
+
+    /* dumps while the threads are writing */
+    struct dump dump;
+    unsigned int nb_dumps = 0;
+    pthread_barrier_wait(&barrier);
+    do {
+        assert(!raise(SIGUSR1));
+        parse_dump(&dump);
+        nb_dumps++;
+    } while (__atomic_load_n(&nb_done, __ATOMIC_ACQUIRE) < NB_THREADS);
+    printf("%u dumps while writing\n", nb_dumps);
+
+    /* dump of the wrapped rings */
+    pthread_barrier_wait(&barrier);
+    assert(!raise(SIGUSR1));
+    parse_dump(&dump);
+    assert(dump.nb_rings == NB_THREADS + 1);
+    for (unsigned int i = 0; i < NB_THREADS; i++) {
+        /* the first event may have lost its first records */
+        assert(dump.nb_records[i] == NB_RECORDS);
+        assert(dump.last[i] == NB_EVENTS - 1);
+        assert(dump.first[i] > 0);
+        assert(dump.last[i] - dump.first[i] + 1 == dump.nb_events[i]);
+        assert(dump.nb_events[i] >= NB_RECORDS / 3 - 1);
+    }
+    pthread_barrier_wait(&barrier);
+
+    for (unsigned int i = 0; i < NB_THREADS; i++)
+        assert(!pthread_join(threads[i], NULL));
+    assert(!pthread_barrier_destroy(&barrier));
+
+    /* the rings of the threads which exited are not dumped */
+    assert(!raise(SIGUSR1));
+    parse_dump(&dump);
+    assert(dump.nb_rings == 1);
+
+    test_free(upipe);
+    return 0;
+}
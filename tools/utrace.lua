@@ -26,6 +26,7 @@ ffi.cdef [[
     typedef struct _IO_FILE FILE;
     FILE *fopen(const char *pathname, const char *mode);
     FILE *fdopen(int fd, const char *mode);
+    FILE *tmpfile(void);
     void *rewind(FILE *stream);
     int fgetc_unlocked(FILE *stream);
     size_t fread_unlocked(void *ptr, size_t size, size_t n, FILE *stream);
@@ -139,6 +140,16 @@ ffi.cdef [[
                                  Dwarf_Addr *dwbias, Dwarf_Addr *symbias,
                                  const char **mainfile,
                                  const char **debugfile);
+
+    // utrace.c
+    struct utrace_record {
+        uint64_t seq;
+        uint64_t tsc;
+        uint16_t size;
+        uint16_t flags;
+        uint32_t reserved;
+        uint8_t data[104];
+    };
 ]]
 
 local UCLOCK_FREQ = 27000000
@@ -221,6 +232,10 @@ local function enum(e)
 end
 
 local utrace_magic = "UTRACE01"
+local utrace_ring_magic = "UTRACER1"
+
+local UTRACE_RECORD_FIRST = 0x1
+local UTRACE_RECORD_LAST = 0x2
 
 local ubase_err = enum {
     'none', 'unknown', 'alloc', 'nospc', 'upump', 'unhandled', 'invalid',
@@ -288,6 +303,11 @@ local function usage()
         "\n",
         "  utrace graph [<options>] [<name>]...\n",
         "    -i, --input <file>     input file name [utrace.data]\n",
+        "\n",
+        "  utrace merge [<options>]\n",
+        "    -i, --input <file>     ring dump file name (UTRACE_RING) [utrace.ring]\n",
+        "    -o, --output <file>    output file name [utrace.data]\n",
+        "    -t, --text             print the merged timeline\n",
         "\n")
     os.exit(1)
 end
@@ -304,6 +324,8 @@ local show_leaks = false
 local filename = "utrace.data"
 local show_log = 6
 local dump_graphs
+local merge_output = "utrace.data"
+local merge_text = false
 
 local calls = enum {
     -- uprobe
@@ -428,6 +450,17 @@ elseif command == "graph" then
 
     dump_graphs = enum(arg)
 
+elseif command == "merge" then
+    filename = "utrace.ring"
+    while arg[1] and arg[1]:sub(1, 1) == "-" do
+        local opt = shift()
+        if opt == "--input" or opt == "-i" then filename = shift()
+        elseif opt == "--output" or opt == "-o" then merge_output = shift()
+        elseif opt == "--text" or opt == "-t" then merge_text = true
+        else usage()
+        end
+    end
+
 else
     usage()
 end
@@ -437,7 +470,9 @@ if f == nil then fatal("%s: %m", filename) end
 local buf_8 = ffi.new("char[8]")
 assert(ffi.C.fread_unlocked(buf_8, 8, 1, f) == 1)
 
-if ffi.string(buf_8, 8) == utrace_magic then
+local magic = ffi.string(buf_8, 8)
+local ring = magic == utrace_ring_magic
+if magic == utrace_magic or ring then
     ffi.C.rewind(f)
 else
     ffi.C.fclose(f)
@@ -567,6 +602,133 @@ local function read_uref()
     return ref
 end
 
+local utrace_id = enum {
+    'dump_graph',
+    'uprobe_init', 'uprobe_clean', 'uprobe_throw_enter', 'uprobe_throw_leave',
+    'upipe_alloc_enter', 'upipe_alloc_leave', 'upipe_init', 'upipe_clean',
+    'upipe_control_enter', 'upipe_control_leave',
+    'upipe_throw_enter', 'upipe_throw_leave',
+    'upipe_input_enter', 'upipe_input_leave',
+    'urequest_init', 'urequest_clean', 'urequest_free',
+    'urequest_provide_enter', 'urequest_provide_leave',
+    'upump_alloc_enter', 'upump_alloc_leave',
+    'upump_control_enter', 'upump_control_leave',
+    'ulog_init', 'ulog_add_prefix',
+}
+
+local function encode_uint(v)
+    -- ULEB128 encoding
+    v = ffi.cast("uint64_t", v)
+    local t = {}
+    while v >= 0x80 do
+        insert(t, string.char(tonumber(band(v, 0x7f)) + 0x80))
+        v = rsh(v, 7)
+    end
+    insert(t, string.char(tonumber(v)))
+    return concat(t)
+end
+
+local function write_lstr(o, str)
+    if #str > 0 then
+        assert(ffi.C.fwrite_unlocked(str, #str, 1, o) == 1)
+    end
+end
+
+local function ring_merge(o)
+    -- merge the per-thread rings of a dump into one trace, in timestamp order
+    uassert(read_lstr(8) == utrace_ring_magic,
+        "%s: unrecognized file format", filename)
+
+    local header = { utrace_magic }
+    while true do
+        local addr = read_uint()
+        insert(header, encode_uint(addr))
+        if addr == 0 then break end
+        local path = read_str()
+        insert(header, encode_uint(#path * 2))
+        insert(header, path)
+    end
+
+    local clock_buf = read_buf(32)
+    local clock = ffi.cast("uint64_t *", clock_buf)
+    local tsc0 = clock[0]
+    local ticks_per_ns = 1
+    if clock[3] > clock[1] then
+        ticks_per_ns = tonumber(clock[2] - clock[0]) /
+                       tonumber(clock[3] - clock[1])
+    end
+
+    local events = {}
+    local record_size = ffi.sizeof("struct utrace_record")
+    local tid_buf = ffi.new("uint64_t[1]")
+    while ffi.C.fread_unlocked(tid_buf, 8, 1, f) == 1 do
+        local tid = tonumber(tid_buf[0])
+        local event, prev
+        while true do
+            local buf = read_buf(record_size)
+            local record = ffi.cast("struct utrace_record *", buf)
+            local seq = record.seq
+            if seq == 0 then break end
+            if band(record.flags, UTRACE_RECORD_FIRST) ~= 0 then
+                event = { tsc = record.tsc, tid = tid, n = #events, data = {} }
+            elseif event and seq ~= prev + 1 then
+                -- records were overwritten, drop the partial event
+                event = nil
+            end
+            if event then
+                insert(event.data, ffi.string(record.data, record.size))
+                if band(record.flags, UTRACE_RECORD_LAST) ~= 0 then
+                    event.data = concat(event.data)
+                    insert(events, event)
+                    event = nil
+                end
+            end
+            prev = seq
+        end
+    end
+
+    table.sort(events, function (a, b)
+        if a.tsc ~= b.tsc then return a.tsc < b.tsc end
+        return a.n < b.n
+    end)
+
+    if not o then
+        for _, event in ipairs(events) do
+            local ns = event.tsc > tsc0 and
+                tonumber(event.tsc - tsc0) / ticks_per_ns or 0
+            print(fmt("%14.6f %8d %s", ns / 1e9, event.tid,
+                utrace_id[event.data:byte(1)] or "?"))
+        end
+        return
+    end
+
+    write_lstr(o, concat(header))
+    for _, event in ipairs(events) do
+        write_lstr(o, event.data)
+    end
+end
+
+if command == "merge" then
+    if merge_text then
+        ring_merge()
+    else
+        local o = ffi.C.fopen(merge_output, "w")
+        if o == nil then fatal("%s: %m", merge_output) end
+        ring_merge(o)
+        ffi.C.fclose(o)
+    end
+    ffi.C.fclose(f)
+    return
+elseif ring then
+    -- other commands read ring dumps through a merged temporary trace
+    local o = ffi.C.tmpfile()
+    assert(o ~= nil)
+    ring_merge(o)
+    ffi.C.fclose(f)
+    ffi.C.rewind(o)
+    f = o
+end
+
 local id_d = {}
 local id_n = {
     pipe=0, probe=0, request=0, pump=0, log=0,